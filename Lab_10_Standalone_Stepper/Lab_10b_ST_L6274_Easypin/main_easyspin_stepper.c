@@ -10,6 +10,9 @@
 //
 // History:
 //   04/30/15 - Created to support St "EasySpin" shield/board. Duquaine
+//   10/19/26 - IRQ priorities from the board's IRQ_PRIO_xxx classes. With
+//              USES_IRQ_BOTTOM_HALF, the step clock handler is run as a
+//              deferred timer callback, instead of inside the TIM3 ISR.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -257,11 +260,11 @@ int  configure_stepper_motor (void)
      // A subsequent call to pin_Enable_IRQ() will enable the NVIC interrupt.
      //--------------------------------------------------------------------------
     pin_Config_IRQ_Pin (L6474_IRQ_PIN, GPIO_RUPT_MODE_FALLING, PIN_USE_PULLUP,
-                        L6474_EXTI_IRQ_NUM, 5);
+                        L6474_EXTI_IRQ_NUM, IRQ_PRIO_HOUSEKEEP);
 
 // BUG in above code not setting IRQn right ?
         /* Set Priority of External Line Interrupt used for the Flag interrupt*/
-     HAL_NVIC_SetPriority (L6474_EXTI_IRQ_NUM, 5, 0);     // EXTI15_10_IRQn
+     HAL_NVIC_SetPriority (L6474_EXTI_IRQ_NUM, IRQ_PRIO_HOUSEKEEP, 0); // EXTI15_10_IRQn
         /* Enable the External Line Interrupt used for the Flag interrupt */
      HAL_NVIC_EnableIRQ (L6474_EXTI_IRQ_NUM);
 
@@ -320,9 +323,17 @@ int  configure_stepper_motor (void)
        // Setup the callback handler for the PWM/Timer Interrupt
        //---------------------------------------------------------
     tim_handle = (TIM_HandleTypeDef*) board_timerpwm_get_handle (L6474_PWM_1_MODULE); // !!! CHEAP HACK - WVD FIX THIS !!! ???
+#if defined(USES_IRQ_BOTTOM_HALF)
+        // run the step clock / speed ramp logic after the TIM3 ISR returns,
+        // so it does not hold off the other HARD_RT (motor, ADC) interrupts
+    timer_Set_Callback_Deferred (L6474_PWM_1_MODULE,
+                                 timer_period_completed_callback,
+                                 tim_handle);
+#else
     timer_Set_Callback (L6474_PWM_1_MODULE,
                         timer_period_completed_callback,
                         tim_handle);      // !!! CHEAP HACK - WVD FIX THIS !!! ???
+#endif
 
        //-------------------------------------------------------------------
        // Enable the PWM module and its associated channels, and
@@ -686,7 +697,7 @@ void  HAL_TIM_PWM_MspInit (TIM_HandleTypeDef* htim_pwm)
     HAL_GPIO_Init (easySPIN_PWM_1_PORT, &GPIO_InitStruct);
 
        /* Set Interrupt Group Priority of Timer3 Interrupt*/
-    HAL_NVIC_SetPriority(easySPIN_PWM1_IRQn, 4, 0);
+    HAL_NVIC_SetPriority(easySPIN_PWM1_IRQn, IRQ_PRIO_HARD_RT, 0);
 
        /* Enable the timer3 global Interrupt */
     HAL_NVIC_EnableIRQ(easySPIN_PWM1_IRQn);
@@ -706,7 +717,7 @@ void  HAL_TIM_PWM_MspInit (TIM_HandleTypeDef* htim_pwm)
     HAL_GPIO_Init (easySPIN_PWM_2_PORT, &GPIO_InitStruct);
 
        /* Set Interrupt Group Priority of Timer2 Interrupt*/
-    HAL_NVIC_SetPriority(easySPIN_PWM2_IRQn, 4, 0);
+    HAL_NVIC_SetPriority(easySPIN_PWM2_IRQn, IRQ_PRIO_HARD_RT, 0);
 
        /* Enable the timer2 global Interrupt */
     HAL_NVIC_EnableIRQ(easySPIN_PWM2_IRQn);
@@ -726,7 +737,7 @@ void  HAL_TIM_PWM_MspInit (TIM_HandleTypeDef* htim_pwm)
     HAL_GPIO_Init (easySPIN_PWM_3_PORT, &GPIO_InitStruct);
 
        /* Set Interrupt Group Priority of Timer4 Interrupt*/
-    HAL_NVIC_SetPriority(easySPIN_PWM3_IRQn, 3, 0);
+    HAL_NVIC_SetPriority(easySPIN_PWM3_IRQn, IRQ_PRIO_HARD_RT, 0);
 
        /* Enable the timer4 global Interrupt */
     HAL_NVIC_EnableIRQ(easySPIN_PWM3_IRQn);
@@ -56,6 +56,13 @@
 // in the default parms config file, then enable the include for it below.
 #include "default_project_config_parms.h"
 
+        // Run the step clock handler from a PendSV bottom half, instead of
+        // inside the TIM3 ISR, and keep ISR timing per priority class
+        // (sys_Get_IRQ_Stats). Either one needs board_STM32_irq.c added to
+        // the build; without them the project does not need that file.
+//#define  USES_IRQ_BOTTOM_HALF
+//#define  USES_IRQ_STATS
+
 #endif                          //  __PROJ_CONF_PARMS_H__
 
 //*****************************************************************************
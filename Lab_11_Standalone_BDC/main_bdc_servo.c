@@ -0,0 +1,125 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                                main_bdc_servo.c
+//
+//
+// Closed loop position control of a brushed DC gear motor with a quadrature
+// encoder, through an IN1/IN2 H-bridge (e.g. DRV8833 or TB6612 board).
+//
+//    TIM3 CH1/CH2  (PA6 / PA7)   20 kHz PWM to the H-bridge IN1 / IN2
+//    TIM4 CH1/CH2  (PB6 / PB7)   encoder A / B
+//
+// The position / velocity loops run at 1 kHz / 1 kHz from TIM3's update
+// interrupt (10 kHz tick, velocity every 10 ticks). The main loop moves
+// the motor back and forth one output shaft turn, and reports the tick's
+// cycle counts and the loop's period jitter.
+//
+// Needs USES_BDC_MOTOR in project_config_parms.h.
+//
+// History:
+//   10/19/26 - Created for the BDC motor lab.
+//
+// -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//******************************************************************************
+
+#include "user_api.h"                 // pull in defs for User API calls
+
+#include "bdc_motor.h"                // BDC cascaded loops
+
+#include <stdio.h>
+
+#define  PWM_FREQUENCY         20000
+#define  LOOP_DIV                  2    // control tick = 20 kHz / 2 = 10 kHz
+#define  VEL_DIV                  10    // velocity loop = 1 kHz
+#define  COUNTS_PER_TURN        2000    // 500 line encoder, x4
+#define  ENCODER_FILTER            4
+
+        //------------------------------------------------------------------
+        // Gains (Q12) for a small 12 V motor, no current sensing:
+        //   position:  counts -> Q8 counts/ms,  ~10 Hz bandwidth
+        //   velocity:  Q8 counts/ms -> duty,    ff = duty per unit speed
+        //------------------------------------------------------------------
+#define  POS_KP                65536
+#define  VEL_MAX               25600    // 100 counts/ms = 3000 rpm
+#define  VEL_KP                16384
+#define  VEL_KI                  328
+#define  VEL_KFF                2760
+
+    BDC_MOTOR   motor;
+    BDC_STATS   stats;
+    char        console_buf [100];
+
+
+/*******************************************************************************
+*                                MAIN                Application's entry point
+*******************************************************************************/
+
+int  main (int argc, char **argv)
+{
+    long       pwm_period;
+    int32_t    target;
+    int        rc;
+
+    sys_Init (0, 0);                    // Turn off WDT, init MCU clocks, ...
+
+    pwm_period = (board_sys_IO_clock_get_frequency() / PWM_FREQUENCY) - 1;
+    rc = pwm_Init (PWM_MODULE_3, pwm_period, 0);
+    if (rc == 0)
+       rc = timer_Encoder_Init (TIMER_4, ENCODER_FILTER, 0);
+
+    bdc_motor_init (&motor, 16, VEL_DIV, 1, 0);
+    bdc_motor_set_gains (&motor.pos_pid, POS_KP, 0, 0, 4096, VEL_MAX);
+    bdc_motor_set_gains (&motor.vel_pid, VEL_KP, VEL_KI, 0, VEL_KFF, BDC_DUTY_MAX);
+
+    if (rc == 0)
+       rc = bdc_Attach (&motor, PWM_MODULE_3, PWM_CHANNEL_1, PWM_CHANNEL_2, TIMER_4);
+    if (rc == 0)
+       rc = bdc_Start (PWM_MODULE_3, LOOP_DIV);
+    if (rc != 0)
+       { sprintf (console_buf, "\n\rBDC init failed, rc = %d\n\r", rc);
+         CONSOLE_WRITE (console_buf);
+         while (1)
+           ;
+       }
+
+    bdc_motor_set_mode (&motor, BDC_MODE_POSITION);
+
+    target = COUNTS_PER_TURN;
+    while (1)
+      {
+        bdc_motor_set_position (&motor, target, 0);
+        sys_Delay_Millis (1000);
+
+        bdc_Get_Stats (PWM_MODULE_3, &stats);
+        sprintf (console_buf, "pos %ld  tick %lu cyc (max %lu)  period %lu-%lu cyc\n\r",
+                 (long) motor.position, (unsigned long) stats.last_cycles,
+                 (unsigned long) stats.max_cycles,
+                 (unsigned long) stats.min_period_cycles,
+                 (unsigned long) stats.max_period_cycles);
+        CONSOLE_WRITE (console_buf);
+
+        target = (target == 0) ? COUNTS_PER_TURN : 0;
+      }
+}
@@ -53,6 +53,12 @@
 // into here, and then modify them as necessary. 
 // Then comment out the #include "default_project_config_parms.h" statement below
 
+// Closed loop brushed DC motor control:  encoder mode timer + cascaded
+// position / velocity / current loops (boards/STM32_Bds/board_STM32_bdc.c)
+#define USES_BDC_MOTOR            1
+//#define BDC_MAX_MOTORS            4
+//#define BDC_VEL_FILTER_SHIFT      1   // velocity filter: 0 = none, 2-3 = smoother
+
 // Otherwise. if you want to use the rest of the (non-overriden) parms located
 // in the default parms config file, then enable the include for it below.
 #include "default_project_config_parms.h"
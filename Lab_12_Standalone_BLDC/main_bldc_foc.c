@@ -0,0 +1,115 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                                main_bldc_foc.c
+//
+//
+// Field Oriented Control of a 3 phase BLDC / PMSM motor, through a 3 phase
+// power stage (e.g. X-NUCLEO-IHM07M1 style: 6 FETs, low side shunts and
+// current amps on phases A and B).
+//
+// TIM1 generates 20 kHz center-aligned complementary PWM, and triggers an
+// ADC1 injected conversion of the 2 phase currents at the top of each
+// period. The FOC current loop (common/foc_engine.c) runs in the ADC ISR.
+// This main loop just spins the motor up open loop, ramps the torque
+// current, and reports the ISR's cycle counts on the console.
+//
+// Needs USES_BLDC_FOC in project_config_parms.h, and an F4 or F7 board.
+//
+// History:
+//   10/19/26 - Created for the BLDC FOC lab.
+//
+// -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//******************************************************************************
+
+#include "user_api.h"                 // pull in defs for User API calls
+
+#include "foc_engine.h"               // FOC engine
+
+#include <stdio.h>
+
+        //------------------------------------------------------------------
+        // Motor / power stage parameters.  The PI gains are for a current
+        // loop bandwidth of ~1 kHz on a 0.5 ohm, 1 mH motor, 24 V bus and
+        // +/- 10 A current amps:  Kp = L*wc, Ki = R*wc  (see foc_engine.h)
+        //------------------------------------------------------------------
+#define  PWM_HZ                20000
+#define  DEADTIME_NS             500
+#define  ADC_CHAN_PHASE_A          0    // PA0
+#define  ADC_CHAN_PHASE_B         11    // PC1
+#define  FOC_KP                10723    // Q12
+#define  FOC_KI                  268    // Q12, per PWM period
+#define  AMPS_FULL_SCALE          10
+#define  IQ_TARGET       (32767 / AMPS_FULL_SCALE * 2)   // 2 A of torque current
+#define  OPEN_LOOP_STEP           66    // 66 * 20000 / 65536 = 20 Hz electrical
+
+    FOC_CTL   foc_ctl;
+    char      console_buf [80];
+
+
+/*******************************************************************************
+*                                MAIN                Application's entry point
+*******************************************************************************/
+
+int  main (int argc, char **argv)
+{
+    uint32_t   isr_count,  last_cycles,  max_cycles;
+    int16_t    iq_ref;
+    int        rc;
+
+    sys_Init (0, 0);                    // Turn off WDT, init MCU clocks, ...
+
+    foc_init (&foc_ctl, FOC_KP, FOC_KI, FOC_VMAX_LINEAR);
+
+    rc = bldc_Init (PWM_MODULE_1, PWM_HZ, DEADTIME_NS,
+                    ADC_CHAN_PHASE_A, ADC_CHAN_PHASE_B, &foc_ctl);
+    if (rc == 0)
+       rc = bldc_Calibrate (1024);      // current amp offsets, outputs off
+    if (rc != 0)
+       { sprintf (console_buf, "\n\rBLDC init failed, rc = %d\n\r", rc);
+         CONSOLE_WRITE (console_buf);
+         while (1)
+           ;
+       }
+
+    bldc_Set_Open_Loop_Step (OPEN_LOOP_STEP);     // no position sensor yet
+    bldc_Start();
+
+    iq_ref = 0;
+    while (1)
+      {
+        if (iq_ref < IQ_TARGET)
+           { iq_ref += 64;               // soft start the torque current
+             bldc_Set_Current_Ref (&foc_ctl, 0, iq_ref);
+           }
+
+        bldc_Get_Stats (&isr_count, &last_cycles, &max_cycles);
+        sprintf (console_buf, "isr %lu  cycles %lu  max %lu  iq %d  vq %d\n\r",
+                 (unsigned long) isr_count, (unsigned long) last_cycles,
+                 (unsigned long) max_cycles, foc_ctl.iq, foc_ctl.vq);
+        CONSOLE_WRITE (console_buf);
+
+        sys_Delay_Millis (250);
+      }
+}
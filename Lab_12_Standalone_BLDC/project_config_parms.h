@@ -52,6 +52,12 @@
 // into here, and then modify them as necessary. 
 // Then comment out the #include "default_project_config_parms.h" statement below
 
+// Field Oriented Control engine:  TIM1/TIM8 center-aligned PWM + ADC1
+// injected current sampling (boards/STM32_Bds/board_STM32_bldc.c)
+#define USES_BLDC_FOC             1
+//#define BLDC_ADC_TRIGGER_ADVANCE  0   // timer ticks to start sampling early
+//#define BLDC_CURRENT_INVERT       1   // amp output falls with +ve current
+
 // Otherwise. if you want to use the rest of the (non-overriden) parms located
 // in the default parms config file, then enable the include for it below.
 #include "default_project_config_parms.h"
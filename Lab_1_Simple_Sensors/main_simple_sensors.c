@@ -145,6 +145,10 @@
 
 #include "device_config_common.h"    // TEMP HACK
 
+#if defined(USES_ADC_DSP) && defined(STM32_MCU)
+#include "adc_dsp_filter.h"          // oversample / filter / scale ADC results
+#endif
+
 
          // Timer_1 is being used by PWM support
 void  timerXR_callback (void *callback_parm, int interrupt_flags);
@@ -178,6 +182,11 @@ inline void   inline_High (uint32_t gpio_port,  unsigned long pin)
 
          int      loop_on_pwms       = 0;   // PWM    DEBUG TEST
 
+#if defined(USES_ADC_DSP) && defined(STM32_MCU)
+         ADC_DSP_STAGE  adc_dsp_stage;      // oversamples light and pot sensors
+         int16_t  adc_dsp_eng_results [ADC_DSP_MAX_CHANNELS];  // in millivolts
+#endif
+
          char     test_wave     = 1;            // Type of wave to test: 1 - 4
          char     startup_dacs  = 3;            // 1 = chan 1, 2 = chan 2, 3 = both
          int      dac_frequency = DAC_WAVE_FREQUENCY;
@@ -468,6 +477,20 @@ if (startup_dacs == 2 || startup_dacs == 3)
                                                 // to read ADCs when DMA is done
     using_adc_callbacks = 1;     // ensure flag is sert to denote we are using ADC callback
 
+#if defined(USES_ADC_DSP) && defined(STM32_MCU)
+         //------------------------------------------------------------
+         // Average 16 samples of the light sensor and potentiometer
+         // (2 extra bits of resolution) and report them in millivolts.
+         // Results are picked up by sensor_read_process().
+         //------------------------------------------------------------
+    adc_dsp_init (&adc_dsp_stage, 3, 0L, 0L);
+    adc_dsp_config_channel (&adc_dsp_stage, 0, ADC_DSP_MODE_BOXCAR, 4, 0);
+    adc_dsp_config_channel (&adc_dsp_stage, 1, ADC_DSP_MODE_BOXCAR, 4, 0);
+    adc_dsp_set_scaling (&adc_dsp_stage, 0, 0, 3300);   // 3.3V Vref, in mV
+    adc_dsp_set_scaling (&adc_dsp_stage, 1, 0, 3300);
+    adc_Set_DSP_Stage (ADCMD, &adc_dsp_stage);
+#endif
+
     adc_Enable (ADCMD);          // Startup the ADCs, so they
                                  // are ready to sample when Timer trigger fires
 
@@ -919,8 +942,16 @@ adc_trigger_starts++;
     if (using_adc_callbacks)
        {      // pull the information from the callback buffer.
               // update associated fields in "Process Image"
+#if defined(USES_ADC_DSP) && defined(STM32_MCU)
+         if (adc_dsp_get_results (&adc_dsp_stage, adc_dsp_eng_results))
+            {      // new filtered values, already scaled to millivolts
+              mcu_proc_image.light_sense_adc   = adc_dsp_eng_results[0];
+              mcu_proc_image.potentiometer_adc = adc_dsp_eng_results[1];
+            }
+#else
          mcu_proc_image.light_sense_adc   = adc_callback_chan_results[0];
          mcu_proc_image.potentiometer_adc = adc_callback_chan_results[1];
+#endif
          mcu_proc_image.temp_sense_adc    = 0;  // adc_callback_chan_results[2];
        }
       else
@@ -940,7 +971,8 @@ adc_trigger_starts++;
                mcu_proc_image.temp_sense_adc    = 0;    // adc_result_array[2];
             }
        }
-// need to scale these in future: light to lumens, temp to Celcius or Farenh or Kelvin, potentiometer to volts
+// need to scale these in future: light to lumens, temp to Celcius or Farenh or Kelvin.
+//   With USES_ADC_DSP, light and potentiometer are already reported in millivolts.
 
              //------------------------------------------------------------
              // Update Process Image using latest set of GPIO Input results
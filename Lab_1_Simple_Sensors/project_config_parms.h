@@ -55,6 +55,12 @@
 
 //#define CONSOLE_STARTUP_INPUT_WAIT  5
 
+        // Oversample/filter the ADC sensors in the DMA ISR (STM32 only)
+//#define USES_ADC_DSP                1
+
+        // Log ADC sequences via DMA into a crash-safe FRAM ring (MSP430 FRxxxx only)
+//#define USES_ADC_FRAM_LOG           1
+
 
            //---------------------------------------------
            //  put any project specific settings in here.
@@ -33,6 +33,19 @@
 *
 *  History:
 *    03/19/15 - Initial version bring up. Works putting out raw values. Duquaine
+*    10/19/26 - Optionally log readings via the Binary Log (USES_BINLOG),
+*               instead of sprintf + blocking CONSOLE_WRITE.
+*    10/19/26 - Optionally init the sensors through the boot sequencer
+*               (USES_BOOT_SEQ): the pressure and hum/temp sensors' first
+*               conversion waits overlap, and the IMU and magnetometer are
+*               brought up on first use, after the first sample. With
+*               USES_BOOT_PROFILE, each init step and the time-to-first-
+*               sample are printed as JSON, for either init path.
+*    10/19/26 - USES_STANDBY_CYCLE: after a few readings, save the last
+*               pressure and go into standby, on an RTC wakeup. The wakeup
+*               is a warm boot: the pressure and hum/temp sensors stayed
+*               powered, so their warm steps skip the first conversion
+*               wait, and the pressure change over the standby is printed.
 *
 * -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 *
@@ -74,6 +87,71 @@
 #include <math.h>
 #include <errno.h>
 
+#if defined(USES_BINLOG)
+#include "binlog.h"                    // deferred-formatting binary log
+         uint32_t         binlog_ring [BINLOG_RING_WORDS];
+#endif
+
+#if defined(USES_BOOT_PROFILE)
+#include "boot_prof.h"                 // boot time profiler
+         char             bootProf [768]; // profile JSON, printed once
+#endif
+
+#if defined(USES_BOOT_SEQ)
+#include "boot_seq.h"                  // concurrent / lazy device init
+
+                         // time from a sensor's init to its first valid
+                         // conversion - override in project_config_parms.h
+#if !defined(BARO_FIRST_CONV_MS)
+#define  BARO_FIRST_CONV_MS      40    /* LPS25H */
+#endif
+#if !defined(HUM_TEMP_FIRST_CONV_MS)
+#define  HUM_TEMP_FIRST_CONV_MS  80    /* HTS221 */
+#endif
+
+#define  BARO_TASK               0     // boot_seq task ids
+#define  HUM_TEMP_TASK           1
+#define  IMU_TASK                2
+#define  MAG_TASK                3
+
+static int  baro_boot_step (BOOT_SEQ *seq, BOOT_TASK *task);
+static int  hum_temp_boot_step (BOOT_SEQ *seq, BOOT_TASK *task);
+static int  imu_boot_step (BOOT_SEQ *seq, BOOT_TASK *task);
+static int  mag_boot_step (BOOT_SEQ *seq, BOOT_TASK *task);
+
+#if defined(USES_STANDBY_CYCLE)
+                         // readings per wakeup, and how long to stay in
+                         // standby - override in project_config_parms.h
+#if !defined(STANDBY_AFTER_SAMPLES)
+#define  STANDBY_AFTER_SAMPLES   10
+#endif
+#if !defined(STANDBY_SECS)
+#define  STANDBY_SECS            60
+#endif
+
+static int  baro_warm_step (BOOT_SEQ *seq, BOOT_TASK *task);
+static int  hum_temp_warm_step (BOOT_SEQ *seq, BOOT_TASK *task);
+#define  BARO_WARM_STEP          baro_warm_step
+#define  HUM_TEMP_WARM_STEP      hum_temp_warm_step
+
+         float            PRESSURE_Before;     // last reading before standby
+         float            PRESSURE_Change;
+         int              pressure_restored;   //   1 = valid (warm boot)
+         int              num_samples;
+#else
+#define  BARO_WARM_STEP          0L
+#define  HUM_TEMP_WARM_STEP      0L
+#endif
+
+         BOOT_SEQ         boot_seq;
+         BOOT_TASK        boot_tasks [] =
+            { { "baro",     baro_boot_step,     BARO_WARM_STEP,     0L, 0, 0 },
+              { "hum_temp", hum_temp_boot_step, HUM_TEMP_WARM_STEP, 0L, 0, 0 },
+              { "imu",      imu_boot_step,      0L, 0L, 0, BOOT_TASK_LAZY },
+              { "mag",      mag_boot_step,      0L, 0L, 0, BOOT_TASK_LAZY }
+            };
+#endif
+
 void floatToInt(float in, int32_t *out_int, int32_t *out_dec, int32_t dec_prec);
 
                                       // globals
@@ -121,11 +199,144 @@ static void  floatToInt (float in, int32_t *out_int,
 }
 
 
+#if defined(USES_BOOT_SEQ)
+/******************************************************************
+*  boot_seq step functions, one per sensor.
+*
+*  The BSP_xxx_Init() calls themselves block on their I2C
+*  transfers, which are short. The win is the wait for each
+*  sensor's first conversion: those now overlap each other,
+*  instead of the first read landing on a stale value.
+*  A failed BSP_xxx_Init() fails the task with -1.
+*******************************************************************/
+static int  baro_boot_step (BOOT_SEQ *seq, BOOT_TASK *task)
+{
+    switch (task->phase++)
+      { case 0:  if (BSP_PRESSURE_Init() != 0)
+                    return (-1);
+                 return (BOOT_WAIT_MS(BARO_FIRST_CONV_MS));
+        default: return (BOOT_DONE);
+      }
+}
+
+static int  hum_temp_boot_step (BOOT_SEQ *seq, BOOT_TASK *task)
+{
+    switch (task->phase++)
+      { case 0:  if (BSP_HUM_TEMP_Init() != 0)
+                    return (-1);
+                 return (BOOT_WAIT_MS(HUM_TEMP_FIRST_CONV_MS));
+        default: return (BOOT_DONE);
+      }
+}
+
+static int  imu_boot_step (BOOT_SEQ *seq, BOOT_TASK *task)
+{
+    return ((BSP_IMU_6AXES_Init() == 0) ? BOOT_DONE : -1);
+}
+
+static int  mag_boot_step (BOOT_SEQ *seq, BOOT_TASK *task)
+{
+    return ((BSP_MAGNETO_Init() == 0) ? BOOT_DONE : -1);
+}
+
+#if defined(USES_STANDBY_CYCLE)
+/******************************************************************
+*  Warm steps: after standby, for the sensors that were up when
+*  enter_standby() committed.
+*
+*  The X-NUCLEO-IKS01A1 is not powered down with the MCU, so the
+*  sensors kept converting: their output registers already hold a
+*  fresh value, and there is no first conversion wait. The BSP
+*  still needs its Init() call, to set up its I2C and driver tables.
+*******************************************************************/
+static int  baro_warm_step (BOOT_SEQ *seq, BOOT_TASK *task)
+{
+    uint32_t  state;
+
+    if (BSP_PRESSURE_Init() != 0)
+       return (-1);
+    if (boot_seq_get_state(seq, BARO_TASK, &state) == 0)
+       { memcpy (&PRESSURE_Before, &state, sizeof(state));
+         pressure_restored = 1;
+       }
+    return (BOOT_DONE);
+}
+
+static int  hum_temp_warm_step (BOOT_SEQ *seq, BOOT_TASK *task)
+{
+    return ((BSP_HUM_TEMP_Init() == 0) ? BOOT_DONE : -1);
+}
+
+
+/******************************************************************
+*  enter_standby
+*
+*         Save the last pressure reading for the warm boot, commit
+*         the boot_seq state, and go into standby until the RTC
+*         wakeup. Does not return: the wakeup is a reset.
+*         If the RTC can not be set up, carries on awake.
+*******************************************************************/
+static void  enter_standby (void)
+{
+    uint32_t  state;
+    float     pressure;
+
+    if (board_rtc_init(RTC_CLOCK_SOURCE_LSE) != 0
+      || board_rtc_wakeup_start(STANDBY_SECS * 1000UL) != 0)
+       { CONSOLE_WRITE ("  RTC wakeup setup failed, staying awake\r\n");
+         return;
+       }
+
+    pressure = PRESSURE_Value;
+    memcpy (&state, &pressure, sizeof(state));
+    boot_seq_save_state (&boot_seq, BARO_TASK, state);
+    boot_seq_commit (&boot_seq);           // the wakeup is a warm boot
+
+    CONSOLE_WRITE ("Entering standby.\r\n\r\n");
+    sys_Delay_Millis (10);                 // let the UART drain
+
+    __HAL_PWR_CLEAR_FLAG (PWR_FLAG_WU);    // else we wake right back up
+    HAL_PWR_EnterSTANDBYMode();
+}
+#endif
+#endif
+
+
+#if defined(USES_BOOT_PROFILE)
+/******************************************************************
+*  print_boot_profile
+*
+*         Write the boot profile out to the console as JSON.
+*******************************************************************/
+static void  print_boot_profile (void)
+{
+    TCODEC_ENC  enc;
+
+    tcodec_enc_init (&enc, bootProf, sizeof(bootProf) - 1, TCODEC_JSON);
+    boot_prof_encode (&enc);
+    if (tcodec_enc_finish(&enc) < 0)
+       { CONSOLE_WRITE ("BOOT: profile too big\r\n");
+         return;
+       }
+    CONSOLE_WRITE ("BOOT: ");
+    CONSOLE_WRITE (bootProf);
+    CONSOLE_WRITE ("\r\n");
+}
+#endif
+
+
 /*******************************************************************************
 *                                   main
 *******************************************************************************/
 int  main (int argc, char** argv)
 {
+#if defined(USES_BOOT_PROFILE)
+    int   first_sample = 1;
+#if ! defined(USES_BOOT_SEQ)
+    int   prof_id;
+#endif
+#endif
+
     sys_Init (0,0);                 // initialize board: setup clocks, GPIOs,...
 
     Uart_BaudRate = 115200;
@@ -135,11 +346,44 @@ int  main (int argc, char** argv)
     pin_Low (LED1);                     // set it off initially
 
 
+#if defined(USES_BINLOG)
+                                    // binary log is drained to the console UART
+    binlog_init (binlog_ring, BINLOG_RING_WORDS, UART_MD, 0);
+#endif
+
     CONSOLE_WRITE (initMsg);        // Indicate iniatlize MEMS started
 
                /**************************************************************
                *          Initialize each of the sensors
                **************************************************************/
+#if defined(USES_BOOT_SEQ)
+               // pressure and hum/temp now, concurrently. IMU and magneto
+               // are lazy: brought up in the main loop, on first use.
+    mems_rc = boot_seq_init (&boot_seq, boot_tasks, 4);
+    if (mems_rc == 0)
+       mems_rc = boot_seq_run (&boot_seq, 500);
+#else
+#if defined(USES_BOOT_PROFILE)
+    prof_id = boot_prof_begin ("baro");
+    mems_rc = BSP_PRESSURE_Init();
+    boot_prof_end (prof_id, mems_rc);
+    if (mems_rc == 0)
+       { prof_id = boot_prof_begin ("hum_temp");
+         mems_rc = BSP_HUM_TEMP_Init();
+         boot_prof_end (prof_id, mems_rc);
+       }
+       else CONSOLE_WRITE ("  BSP_PRESSURE_Init() failed ! \r\n");
+    if (mems_rc == 0)
+       { prof_id = boot_prof_begin ("imu");
+         mems_rc = BSP_IMU_6AXES_Init();
+         boot_prof_end (prof_id, mems_rc);
+       }
+    if (mems_rc == 0)
+       { prof_id = boot_prof_begin ("mag");
+         mems_rc = BSP_MAGNETO_Init();
+         boot_prof_end (prof_id, mems_rc);
+       }
+#else
     mems_rc = BSP_PRESSURE_Init();
     if (mems_rc == 0)
        mems_rc = BSP_HUM_TEMP_Init();
@@ -148,6 +392,8 @@ int  main (int argc, char** argv)
        mems_rc = BSP_IMU_6AXES_Init();
     if (mems_rc == 0)
        mems_rc = BSP_MAGNETO_Init();
+#endif
+#endif
 
     if (mems_rc == 0)
        CONSOLE_WRITE (cmpltMsg);          // tell user we are good to go
@@ -170,6 +416,17 @@ int  main (int argc, char** argv)
                //-------------------------------------------------------------
         BSP_PRESSURE_GetPressure ((float*) &PRESSURE_Value);
         floatToInt (PRESSURE_Value, &pd1, &pd2, 2);
+#if defined(USES_BOOT_SEQ) && defined(USES_STANDBY_CYCLE)
+        if (pressure_restored)
+           { PRESSURE_Change = PRESSURE_Value - PRESSURE_Before;
+             floatToInt ((PRESSURE_Change < 0) ? -PRESSURE_Change : PRESSURE_Change,
+                         &d1, &d2, 2);
+             sprintf (dataOut, "PRESSURE change over standby: %c%d.%02d\n\r",
+                      (PRESSURE_Change < 0) ? '-' : '+', (int) d1, (int) d2);
+             CONSOLE_WRITE (dataOut);
+             pressure_restored = 0;
+           }
+#endif
 
                //-------------------------------------------------------------
                // read in Humidity and Temperature data, convert to print form
@@ -179,6 +436,17 @@ int  main (int argc, char** argv)
         floatToInt (HUMIDITY_Value, &d1, &d2, 2);
         floatToInt (TEMPERATURE_Value, &d3, &d4, 2);
 
+#if defined(USES_BOOT_PROFILE)
+        if (first_sample)
+           boot_prof_first_sample();   // time-to-first-sample
+#endif
+
+#if defined(USES_BOOT_SEQ)
+               // first use of the IMU and magneto: bring them up now.
+               // If one fails, its values are left at 0.
+        if (boot_seq_require(&boot_seq, IMU_TASK, 200) == 0)
+           {
+#endif
                //------------------------------------------------------------
                // read Accelerometer data into a X/Y/Z struct.
                //------------------------------------------------------------
@@ -196,6 +464,11 @@ int  main (int argc, char** argv)
         data[3] = GYR_Value.AXIS_X;
         data[4] = GYR_Value.AXIS_Y;
         data[5] = GYR_Value.AXIS_Z;
+#if defined(USES_BOOT_SEQ)
+           }
+        if (boot_seq_require(&boot_seq, MAG_TASK, 200) == 0)
+           {
+#endif
 
                //------------------------------------------------------------
                // read Magnometer data into a X/Y/Z struct.
@@ -205,10 +478,30 @@ int  main (int argc, char** argv)
         data[6] = MAG_Value.AXIS_X;
         data[7] = MAG_Value.AXIS_Y;
         data[8] = MAG_Value.AXIS_Z;
+#if defined(USES_BOOT_SEQ)
+           }
+#endif
+
+#if defined(USES_BOOT_PROFILE)
+        if (first_sample)
+           { print_boot_profile();    // includes the lazy IMU / magneto init
+             first_sample = 0;
+           }
+#endif
 
                /**************************************************************
                *          Write out the sensor results to the UART
                **************************************************************/
+#if defined(USES_BINLOG)
+               // log the raw values only. tools/binlog_decode.py does the
+               // formatting on the host, so no floatToInt()/sprintf needed.
+        BLOG ("PRESSURE: %.2f     HUM: %.2f     TEMP: %.2f",
+              BLOG_F(PRESSURE_Value), BLOG_F(HUMIDITY_Value), BLOG_F(TEMPERATURE_Value));
+        BLOG ("ACC_X: %d, ACC_Y: %d, ACC_Z: %d", data[0], data[1], data[2]);
+        BLOG ("GYR_X: %d, GYR_Y: %d, GYR_Z: %d", data[3], data[4], data[5]);
+        BLOG ("MAG_X: %d, MAG_Y: %d, MAG_Z: %d", data[6], data[7], data[8]);
+        binlog_service();          // kick off background send to the UART
+#else
                // write out Pressure, Humidity, and Temperature data
         sprintf (dataOut, "PRESSURE: %d.%d     HUM: %d.%d     TEMP: %d.%d\n\r",
                 (int) pd1, (int) pd2,  (int) d1, (int) d2, (int) d3, (int) d4);
@@ -225,8 +518,13 @@ int  main (int argc, char** argv)
         sprintf (dataOut, "MAG_X: %d, MAG_Y: %d, MAG_Z: %d\n\r\n\r",
                  (int) data[6], (int) data[7], (int) data[8]);
         CONSOLE_WRITE (dataOut);
+#endif
 
         pin_Toggle (LED1);         // toggle LED to show we are alive
+#if defined(USES_BOOT_SEQ) && defined(USES_STANDBY_CYCLE)
+        if (++num_samples >= STANDBY_AFTER_SAMPLES)
+           enter_standby();
+#endif
         sys_Delay_Millis (1000);   // then wait 1 second before do next reading
       }                            //  end  while()
 }
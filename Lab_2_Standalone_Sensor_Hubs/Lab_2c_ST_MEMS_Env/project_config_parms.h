@@ -46,6 +46,25 @@
            //  put any project specific settings in here.
            //---------------------------------------------
 
+        // log sensor readings via the Binary Log (common/binlog.c) instead of
+        // sprintf + CONSOLE_WRITE. Decode on the host with
+        // tools/binlog_decode.py, using this project's .elf file.
+//#define USES_BINLOG            1
+
+        // print how long each init step took, and the time-to-first-sample,
+        // as JSON on the console (common/boot_prof.c)
+//#define USES_BOOT_PROFILE      1
+
+        // init the sensors through the boot sequencer (common/boot_seq.c):
+        // overlapped first-conversion waits, IMU / magneto on first use
+//#define USES_BOOT_SEQ          1
+
+        // with USES_BOOT_SEQ: after STANDBY_AFTER_SAMPLES readings, go into
+        // standby for STANDBY_SECS, then warm boot (boot_seq warm steps).
+        // Needs board_STM32_rtc.c, with RTC_CLOCK_SOURCE_LSE defined, for
+        // the RTC wakeup and backup registers.
+//#define USES_STANDBY_CYCLE     1
+
 // use the default_project_config_parms.h (in the ~/boards directory) as 
 // the template for what parameters are supported.
 
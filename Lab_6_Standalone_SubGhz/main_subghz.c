@@ -20,6 +20,7 @@
 *
 *  History:
 *    09/12/15 - Created for Industrial IoT OpenSource project.  Duquaine
+*    10/19/26 - Optionally route STOP mode through tickless idle.
 * -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 *
 * The MIT License (MIT)
@@ -99,6 +100,9 @@ int  main (void)
 
 #if defined(LPM_ENABLE)
     SystemPower_Config();          // Configure the system Power for LPW
+#if defined(USES_TICKLESS_IDLE)
+    sys_Set_Stop_Handler (MCU_Enter_StopMode); // tickless idle enters STOP via us
+#endif
     Enter_LP_mode();
 #endif
 
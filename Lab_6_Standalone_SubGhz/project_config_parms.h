@@ -78,6 +78,11 @@
 //#define  USES_CONSOLE_WRITE     1
 //#define USES_CONSOLE_READ      1
 
+        // STOP via tickless idle: keeps SysTick ms / VTIMERs in step across
+        // STOP, and restores the PLL on wakeup. board_rtc_init() is needed
+        // to account for the time spent in STOP.
+//#define USES_TICKLESS_IDLE     1
+
            //---------------------------------------------
            //  put any project specific settings in here.
            //---------------------------------------------
@@ -226,6 +226,10 @@ volatile FlagStatus   xStartRx     = RESET, rx_timeout  = RESET, exitTime = RESE
 volatile FlagStatus   datasendFlag = RESET,  wakeupFlag = RESET;
 volatile FlagStatus   PushButtonStatusWakeup = RESET;
 volatile FlagStatus   PushButtonStatusData   = RESET;
+         // No RX / TX ring here: the exchange is stop and wait (send, then
+         // wait for the reply), so only one frame is ever in flight, and the
+         // flags above hand it over. A received frame goes into a PKT_BUF
+         // (AppliGetRxPktBuf); a layer that keeps frames queues those.
                                          /* IRQ status struct declaration */
 static __IO uint32_t  KEYStatusData   = 0x00;
 uint8_t               TxFrameBuff [MAX_BUFFER_LEN] = {0x00};
@@ -261,6 +265,15 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
 void HAL_SYSTICK_Callback(void);
 void process_Spirit_IRQ_request(void);         // WVD ADD
 
+#if defined(USES_TICKLESS_IDLE)
+        // Go through tickless idle, so the SysTick ms count / VTIMERs are
+        // caught up and the PLL is restored when we wake up. It calls
+        // MCU_Enter_StopMode() (see main) to actually enter STOP.
+#define  MCU_STOP()    sys_Idle (LPM_IDLE_FOREVER, 0)
+#else
+#define  MCU_STOP()    pMCU_LPM_Comm->McuStopMode()
+#endif
+
 
 /******************************************************************************
 * @brief  Initializes RF Transceiver's HAL.
@@ -462,6 +475,91 @@ appli_send_buf_completed++;    // WVD DEBUG
 }
 
 
+#if defined(USES_PKTBUF)
+/******************************************************************************
+*                                 AppliSendPktBuf
+*
+* @brief  Same as AppliSendBuff(), but the data is in a packet buffer. The
+*         5 byte frame header is pushed into the buffer's headroom, and the
+*         frame goes to the radio FIFO straight from the buffer (no copy
+*         into TxFrameBuff). The caller still owns pb: the header is pulled
+*         back off before returning.
+* @param  AppliFrame_t *xTxFrame = header fields (DataBuff is not used)
+*         PKT_BUF *pb = data to send, one block, at most MAX_BUFFER_LEN - 5
+* @retval 0, or -1 if the data does not fit in one radio frame
+*******************************************************************************/
+int  AppliSendPktBuf (AppliFrame_t *xTxFrame, PKT_BUF *pb)
+{
+  uint8_t  *hdr;
+
+  if (pb == 0L || pb->next != 0L || pb->len > (MAX_BUFFER_LEN - 5))
+     return (-1);
+  hdr = pktbuf_push (pb, 5);
+  if (hdr == 0L)
+     return (-1);                      // no headroom for the frame header
+  hdr[0] = xTxFrame->Cmd;              // Setup header
+  hdr[1] = xTxFrame->CmdLen;
+  hdr[2] = xTxFrame->Cmdtag;
+  hdr[3] = xTxFrame->CmdType;
+  hdr[4] = (uint8_t) (pb->len - 5);
+
+  pRadioDriver = &spirit_cb;
+  pRadioDriver->DisableIrq();          // Re-config Spirit chip IRQs
+  pRadioDriver->EnableTxIrq();
+  pRadioDriver->SetPayloadLen ((uint8_t) pb->len);
+  pRadioDriver->SetRxTimeout (RECEIVE_TIMEOUT);
+  pRadioDriver->ClearIrqStatus();
+  pRadioDriver->SetDestinationAddress (DESTINATION_ADDRESS);
+  pRadioDriver->StartTx (pktbuf_data(pb), (uint8_t) pb->len);
+
+  pktbuf_pull (pb, 5);
+  return (0);
+}
+
+
+/******************************************************************************
+*                                 AppliGetRxPktBuf
+*
+* @brief  Once xRxDoneFlag is set, read the received frame from the radio
+*         FIFO straight into a packet buffer - the only copy on the way to
+*         the MQTT socket (see MQTTPublish_PktBuf). The 5 byte header is
+*         decoded into xRxHdr and stripped, so the buffer holds just the
+*         Data / Cmd bytes (xRxHdr->DataBuff points at them).
+* @param  AppliFrame_t *xRxHdr = where to put the header fields
+* @retval the buffer (caller frees it), or 0L if the pool is empty or the
+*         frame is too short (the frame is dropped)
+*******************************************************************************/
+PKT_BUF  *AppliGetRxPktBuf (AppliFrame_t *xRxHdr)
+{
+  PKT_BUF  *pb;
+  uint8_t  *frame;
+  uint8_t  cRxlen = MAX_BUFFER_LEN;
+
+  pb    = pktbuf_alloc (PKTBUF_HEADROOM);
+  frame = pktbuf_put (pb, MAX_BUFFER_LEN);
+  if (frame == 0L)
+     { pktbuf_free (pb);               // pool empty, or blocks too small
+       return (0L);
+     }
+  pRadioDriver = &spirit_cb;
+  pRadioDriver->GetRxPacket (frame, &cRxlen);
+  pktbuf_trim (pb, cRxlen);
+  if (cRxlen < 5)
+     { pktbuf_free (pb);
+       return (0L);
+     }
+
+  xRxHdr->Cmd      = frame[0];         // READ in HEADER
+  xRxHdr->CmdLen   = frame[1];
+  xRxHdr->Cmdtag   = frame[2];
+  xRxHdr->CmdType  = frame[3];
+  xRxHdr->DataLen  = frame[4];
+  xRxHdr->DataBuff = pktbuf_pull (pb, 5);
+  return (pb);
+}
+#endif
+
+
 /******************************************************************************
 *                                    AppliReceiveBuff
 *
@@ -472,7 +570,6 @@ appli_send_buf_completed++;    // WVD DEBUG
 *******************************************************************************/
 void  AppliReceiveBuff (uint8_t *RxFrameBuff, uint8_t cRxlen)
 {
-  uint8_t   xIndex = 0;
   uint8_t   ledToggleCtr = 0;
   /*float   rRSSIValue = 0;*/
 
@@ -535,10 +632,9 @@ appli_rcv_buf_data++;       // WVD DEBUG
        xRxFrame.CmdType = RxFrameBuff[3];
        xRxFrame.DataLen = RxFrameBuff[4];
 
-       for (xIndex = 5; xIndex < cRxlen; xIndex++)  // READ in Data / Cmd
-         {
-           xRxFrame.DataBuff[xIndex] = RxFrameBuff[xIndex];
-         }
+           // Data / Cmd is used in place, right after the header.
+           // (was copied into xRxFrame.DataBuff, which nothing had set up)
+       xRxFrame.DataBuff = &RxFrameBuff[5];
 
            //------------------------------------------------------
            //                 DECODE  Cmd/Ack  Rcvd
@@ -666,17 +762,17 @@ void  Enter_LP_mode (void)
 #if defined(MCU_STOP_MODE)&&defined(RF_SHUTDOWN)
   {
     pRadio_LPM_Comm->RadioShutDown();
-    pMCU_LPM_Comm->McuStopMode();
+    MCU_STOP();
   }
 #elif defined(MCU_STOP_MODE)&&defined(RF_STANDBY)
   {
     pRadio_LPM_Comm->RadioStandBy();
-    pMCU_LPM_Comm->McuStopMode();
+    MCU_STOP();
   }
 #elif defined(MCU_STOP_MODE)&&defined(RF_SLEEP)
   {
     pRadio_LPM_Comm->RadioSleep();
-    pMCU_LPM_Comm->McuStopMode();
+    MCU_STOP();
   }
 #elif defined(MCU_STANDBY_MODE)&&defined(RF_SHUTDOWN)
   {
@@ -709,7 +805,7 @@ void  Enter_LP_mode (void)
     pMCU_LPM_Comm->McuSleepMode();
   }
 #elif defined(MCU_STOP_MODE)
-  pMCU_LPM_Comm->McuStopMode();
+  MCU_STOP();
 
 #elif defined(MCU_STANDBY_MODE)
   pMCU_LPM_Comm->McuStandbyMode();
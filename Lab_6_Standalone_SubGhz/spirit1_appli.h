@@ -244,6 +244,12 @@ void P2PInterruptHandler(void);
 void Set_KeyStatus(FlagStatus val);
 void spirit_io_wait (int flags);        // WVD Add
 
+#if defined(USES_PKTBUF)
+#include "pkt_buf.h"
+int      AppliSendPktBuf (AppliFrame_t *xTxFrame, PKT_BUF *pb);
+PKT_BUF  *AppliGetRxPktBuf (AppliFrame_t *xRxHdr);
+#endif
+
 #endif /* __SPIRIT1_APPLI_H */
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
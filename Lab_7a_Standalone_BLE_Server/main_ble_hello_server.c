@@ -34,6 +34,10 @@
 *    06/10/15 - Got working with STM32 F0_72. Duq
 *    06/12/15 - Got working with STM32 F3_34 on first try. Duq
 *    06/08/15 - Integrate in ADC, PWM, CRC changes to match rest of STM32 bds.
+*    10/19/26 - Button sends and received data now go through mnet_send()/
+*               mnet_recv() (GATT stream transport).
+*    10/19/26 - Added BLE_BEACON_MODE: broadcast readings as a connectionless
+*               Beacon node.
 *
 * -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 *
@@ -276,9 +280,59 @@ int  main (int argc, char** argv)
 * @retval None
 ******************************************************************************/
     uint8_t data[20] = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F','G','H','I','J'};
+    uint8_t rcv_data [256];
+    int     rcv_len;
+
+#define  BLE_SOCKID   123       // the one BLE "socket" the BlueNRG driver supports
+
+#if defined(BLE_BEACON_MODE)
+#include "sample_service.h"     // BLE_Beacon_xxx hooks
+
+#define  BEACON_NUM_READINGS     8      /* sent as 2 pages of 6 + 2        */
+#define  BEACON_ADV_INTERVAL   200      /* ms between advertisements       */
+#define  BEACON_ROTATE_MS     1000      /* ms between pages                */
+
+    BEACON_READING  beacon_readings [BEACON_NUM_READINGS];
+    uint32_t        beacon_last_tick = 0;
+
+void  Beacon_Process (void)
+{
+    int   i;
+
+  if (set_connectable)
+     {        // advertise as a Beacon, instead of Make_Connection()
+       for (i = 0;  i < BEACON_NUM_READINGS;  i++)
+          beacon_readings[i].id = i;
+       BLE_Beacon_Start (SERVER_BDADDR[0] | (SERVER_BDADDR[1] << 8),
+                         beacon_readings, BEACON_NUM_READINGS,
+                         BEACON_ADV_INTERVAL, BEACON_ROTATE_MS);
+       set_connectable = FALSE;
+     }
+
+       // demo "process image":  reading 0 = uptime secs, 1 = button presses
+  if ((sys_Get_Time() - beacon_last_tick) >= 1000)
+     { beacon_last_tick = sys_Get_Time();
+       beacon_readings[0].value++;
+     }
+  if (BSP_PB_GetState(BUTTON_USER) == RESET)
+     {
+       while (BSP_PB_GetState(BUTTON_USER) == RESET) ;  // wait till button released
+       beacon_readings[1].value++;
+       pin_Toggle (LED1);
+     }
+
+  BLE_Beacon_Service (beacon_readings[1].value & 0x01);
+}
+#endif
+
 
 void  User_Process (void)
 {
+#if defined(BLE_BEACON_MODE)
+  Beacon_Process();
+  return;
+#endif
+
   if (set_connectable)
      {        //----------------------------------------------------------
               // Setup connection infrastruture to remote devices.
@@ -311,8 +365,18 @@ void  User_Process (void)
        if (connected && notification_enabled)
           {
                 /* Button was pressed - Send a toggle command to the remote device */
-            sendData (data, sizeof(data));
+            mnet_send (BLE_SOCKID, data, sizeof(data), 0);
           }
      }
+
+       //----------------------------------------------------------------------
+       // Pick up anything the remote side mnet_send()'ed to us
+       //----------------------------------------------------------------------
+  if (connected  &&  mnet_check_for_recv_data(BLE_SOCKID, 0) > 0)
+     {
+       rcv_len = mnet_recv (BLE_SOCKID, rcv_data, sizeof(rcv_data), 0);
+       if (rcv_len > 0)
+          mnet_send (BLE_SOCKID, rcv_data, rcv_len, 0);   // echo it back
+     }
 }
 
@@ -54,6 +54,10 @@
            //  put any project specific settings in here.
            //---------------------------------------------
 
+// Uncomment to run as a connectionless Beacon: broadcast our readings in
+// non-connectable advertisements, instead of connecting.
+//#define BLE_BEACON_MODE        1
+
 // use the default_project_config_parms.h (in the ~/boards directory) as 
 // the template for what parameters are supported.
 
@@ -26,6 +26,10 @@
 *    06/10/15 - Got working with STM32 F0_72. First shot out of the barrel ! Duq
 *    06/12/15 - Got working with STM32 F3_34 on first try. Duq
 *    06/08/15 - Integrate in ADC, PWM, CRC changes to match rest of STM32 bds.
+*    10/19/26 - Button sends and received data now go through mnet_send()/
+*               mnet_recv() (GATT stream transport).
+*    10/19/26 - Added BLE_BEACON_MODE: scan for Beacon nodes and track them
+*               in a node table.
 *
 * -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 *
@@ -224,9 +228,41 @@ int  main (int argc, char** argv)
 * @retval None
 ******************************************************************************/
     uint8_t data[20] = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F','G','H','I','J'};
+    uint8_t rcv_data [256];
+    int     rcv_len;
+    unsigned long  total_echoes = 0;           // DEBUG count of replies rcvd
+
+#define  BLE_SOCKID   123       // the one BLE "socket" the BlueNRG driver supports
+
+#if defined(BLE_BEACON_MODE)
+#include "sample_service.h"     // BLE_Beacon_xxx hooks
+
+#define  BEACON_TABLE_NODES     64      /* power of 2. ~90 bytes each.     */
+                                        /* Raise on the bigger RAM MCUs    */
+    BEACON_NODE     beacon_nodes [BEACON_TABLE_NODES];
+    BEACON_TABLE    beacon_table;
+
+void  Beacon_Process (void)
+{
+  if (set_connectable)
+     {        // scan for Beacons, instead of Make_Connection()
+       beacon_table_init (&beacon_table, beacon_nodes, BEACON_TABLE_NODES);
+       BLE_Beacon_Observe_Start (&beacon_table);
+       set_connectable = FALSE;
+     }
+       // beacon_table is filled in from the advertising report events.
+       // Look at it in the debugger, or via beacon_table_find().
+}
+#endif
+
 
 void  User_Process (void)
 {
+#if defined(BLE_BEACON_MODE)
+  Beacon_Process();
+  return;
+#endif
+
   if (set_connectable)
      {        //----------------------------------------------------------
               // Setup connection infrastruture to remote devices.
@@ -258,7 +294,17 @@ void  User_Process (void)
        if (connected && notification_enabled)
           {
                 /* Button was pressed - Send a toggle command to the remote device */
-            sendData (data, sizeof(data));
+            mnet_send (BLE_SOCKID, data, sizeof(data), 0);
           }
      }
+
+       //----------------------------------------------------------------------
+       // Pick up anything the remote side mnet_send()'ed to us
+       //----------------------------------------------------------------------
+  if (connected  &&  mnet_check_for_recv_data(BLE_SOCKID, 0) > 0)
+     {
+       rcv_len = mnet_recv (BLE_SOCKID, rcv_data, sizeof(rcv_data), 0);
+       if (rcv_len > 0)
+          total_echoes++;
+     }
 }
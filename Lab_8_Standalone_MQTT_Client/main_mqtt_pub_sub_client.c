@@ -29,6 +29,19 @@
 *    04/04/15 - Worked first shot out of the barrel with both CC3100 and W5200.
 *    05/27/15 - MSP430-FR6989 verified that it works (< 24 hours after rcvd board)! Duqu
 *    06/08/15 - Integrate in ADC, PWM, CRC changes to match rest of STM32 bds.
+*    10/19/26 - DEBUG_LOG in messageArrived() can go to the Binary Log
+*               (USES_BINLOG), so the callback no longer waits on the UART.
+*    10/19/26 - generateUniqueID() uses the unified CRC engine on every MCU.
+*    10/19/26 - On STM32, the RGB duty cycles from a message are set with one
+*               atomic pwm_Set_Duty_Cycles() call (no mixed-color period).
+*    10/19/26 - Payloads use the telemetry codec: the published status is a
+*               CBOR or compact JSON record encoded straight into pub_payload,
+*               and {"r":..,"g":..,"b":..} commands are decoded in place from
+*               the received message (no strncpy / strtok copies).
+*    10/19/26 - Optional latency tracing (USES_LAT_TRACE): each status publish
+*               is stamped per stage, and the per-stage percentiles are
+*               published on DIAG_TOPIC every LAT_REPORT_EVERY publishes, and
+*               shown on the console by the "lat" command.
 *
 * -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 *
@@ -65,6 +78,7 @@
 #define PUBLISH_TOPIC         "mqtt_pub_demo_que"
 #define SUBSCRIBE_TOPIC       "mqtt_sub_demo_que"
 #endif
+#define DIAG_TOPIC            "mqtt_diag_latency"   // latency stats (USES_LAT_TRACE)
 
 //#define  MQTT_BROKER_SERVER   "gigap7"   // our local Mosquitto server  DNS LOOKUP FAILS !
 //#define  MQTT_BROKER_SERVER  "iot.eclipse.org"  // remote PAHO test server
@@ -77,14 +91,43 @@
 #include <string.h>
 #include <errno.h>
 
+#include "crc_engine.h"               // CRC-32 for our unique client ID
+#include "telemetry_codec.h"          // CBOR / JSON payload encode + decode
+
+#if defined(USES_BINLOG)
+#include "binlog.h"                   // DEBUG_LOG -> deferred binary log
+         uint32_t   binlog_ring [BINLOG_RING_WORDS];
+#endif
+
+#if defined(USES_LAT_TRACE)
+#include "lat_trace.h"                // per-stage publish latency stats
+#define  LAT_REPORT_EVERY      100    // publish the stats every N status msgs
+#define  DIAG_PAYLOAD_SIZE     256    // encoded latency stats
+         LAT_TRACE       pub_trace;            // rides along with each status
+         unsigned char   diag_payload [DIAG_PAYLOAD_SIZE];
+#endif
+
 #define DO_LOOPBACK         1     // uncomment this so that we subscribe same
                                   // topic we publish to, creating a loopback
 
-#define MQ_BUFF_SIZE            62                // MQTT message buffer size
+#if defined(USES_LAT_TRACE)
+#define MQ_BUFF_SIZE           288                // room for the latency stats
+#else
+#define MQ_BUFF_SIZE            80                // MQTT message buffer size
+#endif
+#define PUB_PAYLOAD_SIZE        48                // encoded status record
+
+#if !defined(TELEMETRY_FORMAT)
+#define TELEMETRY_FORMAT    TCODEC_JSON   // or TCODEC_CBOR: ~35% smaller
+#endif
 #define MAC_ADDR_LEN            (6)
 
 #define MIN(X,Y) ((X) < (Y) ? (X) : (Y))
 
+#if !defined(PWM_RGB_MODULE)
+#define PWM_RGB_MODULE      PWM_MODULE_1  // timer driving the RGB LED (CH1/2/3)
+#endif
+
     int   CONFIG_MQ_TIMEOUT_MS = 1000;           // was 1000 (1 second)
 
     int    netwk_type        = NETWORK_TYPE;        // set default config parms
@@ -103,6 +146,7 @@
     Client                  hMQTTClient;                   // MQTT Client Handle
     MQTTPacket_connectData  cdata = MQTTPacket_connectData_initializer;
     MQTTMessage             pub_msg;
+    unsigned char           pub_payload [PUB_PAYLOAD_SIZE];
     unsigned char           snd_buf [MQ_BUFF_SIZE+2];
     unsigned char           rcv_buf [MQ_BUFF_SIZE+2];
 
@@ -122,6 +166,38 @@
 
     int                     coil_on    = 1;
 
+                         //-----------------------------------------------------
+                         //   Payload records, and their codec field tables
+                         //-----------------------------------------------------
+typedef struct status_rec                  // what we publish
+   {
+       TCODEC_STR  id;                     // our uniqueID
+       uint32_t    pub_msgs;
+       uint32_t    sub_msgs;
+   } STATUS_REC;
+
+const TCODEC_FIELD  status_fields[] =
+   { TCODEC_FIELD_NAMED ("id", STATUS_REC, id,       TCODEC_T_STR,    0),
+     TCODEC_FIELD_NAMED ("n",  STATUS_REC, pub_msgs, TCODEC_T_UINT32, 0),
+     TCODEC_FIELD_NAMED ("rx", STATUS_REC, sub_msgs, TCODEC_T_UINT32, 0)
+   };
+
+typedef struct rgb_cmd_rec                 // what we are sent: LED color
+   {
+       uint8_t     red;
+       uint8_t     green;
+       uint8_t     blue;
+   } RGB_CMD_REC;
+
+const TCODEC_FIELD  rgb_cmd_fields[] =
+   { TCODEC_FIELD_NAMED ("r",  RGB_CMD_REC, red,     TCODEC_T_UINT8,  0),
+     TCODEC_FIELD_NAMED ("g",  RGB_CMD_REC, green,   TCODEC_T_UINT8,  0),
+     TCODEC_FIELD_NAMED ("b",  RGB_CMD_REC, blue,    TCODEC_T_UINT8,  0)
+   };
+
+    STATUS_REC              status_rec;
+    RGB_CMD_REC             rgb_cmd = { 0, 0, 0 };
+
                          /* TCP MBAP Hdr ----------------------> | Actual MBUS Cmd  */
                          /*                                      | Force Single Coil */
                          /*  -- TID -- Protocol Id  Length   UID | Func  Coil #2    On/Off */
@@ -132,6 +208,8 @@
 #define  ON_OFF_OFFSET   10       /* offset into msg buf for ON/OFF flag */
 
 void  messageArrived (MessageData *md);            // local function prototypes
+int   encodeStatus (void);
+int   encodeLatencyStats (void);
 void  generateUniqueID (void);
 void  uart_get_config_info (void);
 void  process_user_cmds (void);
@@ -173,6 +251,21 @@ void  process_user_cmds (void)
        //-----------------------------------------
        //  process user commands to us
        //-----------------------------------------
+#if defined(USES_LAT_TRACE)
+    if (strcmp("lat",uart_cmd_buf) == 0)
+       {     // show the latency stats (JSON), usec: [count,min,p50,p90,p99,max]
+         TCODEC_ENC  enc;
+         tcodec_enc_init (&enc, diag_payload, sizeof(diag_payload)-1, TCODEC_JSON);
+         lat_trace_encode (&enc);
+         rc = tcodec_enc_finish (&enc);
+         if (rc > 0)
+            { diag_payload[rc] = '\0';
+              CONSOLE_WRITE ((char*) diag_payload);
+              CONSOLE_WRITE ("\n\r");
+            }
+         return;
+       }
+#endif
     if (strcmp("quit",uart_cmd_buf) || strcmp("exit",uart_cmd_buf))
        quit_flag = 1;        // user wants to terminate sending to MQTT
 
@@ -182,81 +275,33 @@ void  process_user_cmds (void)
 }
 
 /********************************************************************************
-*    generateUniqueID            - change this to a:  board_get_random_id() call   ??? !!!
+*    generateUniqueID
+*
+*        Build our MQTT client ID from a CRC-32 of the MAC address (plus the
+*        MSP432's factory random numbers), using the unified CRC engine
+*        (common/crc_engine.c). That uses the MCU's CRC unit if USES_CRC_HW.
 ********************************************************************************/
-#if defined(USES_TIVAWARE)
-#include "driverlib/crc.h"             // Tivaware version of DriverLib
-#endif
-
-#if defined(STM32F401xx) || defined(STM32F072xB) || defined(STM32F103xB) || defined(STM32F334x8) || defined(STM32L152xE) || defined(STM32L053xx)
-     // code was moved to board_F4.c and board_F0.c
-     extern  CRC_HandleTypeDef   CrcHandle;
-     extern  uint32_t            u32Buffer[];  // only supports 32-bit data bufs
-#else
-  #if defined(USE_HAL_DRIVER)            // STM32
-     CRC_HandleTypeDef   CrcHandle;
-     uint32_t            u32Buffer[6];  // only supports 32-bit data bufs
-  #endif
-#endif
-
-
 void  generateUniqueID (void)
 {
+    CRC_CTX   ctx;
     uint32_t  crcResult;
-    int       i;
-
-#if defined(USES_MSPWARE)
-            // MSP430 and MSP432: generate random seed from CRC unit
-    CRC32_setSeed (TLV_RANDOM_NUM_1, CRC32_MODE);
-    CRC32_set32BitData (TLV_RANDOM_NUM_2);
-    CRC32_set32BitData (TLV_RANDOM_NUM_3);
-    CRC32_set32BitData (TLV_RANDOM_NUM_4);
-    for (i = 0; i < 6; i++)
-        CRC32_set8BitData (macAddressVal[i], CRC32_MODE);
-    crcResult = CRC32_getResult (CRC32_MODE);
+#if defined(TLV_RANDOM_NUM_1)
+    uint32_t  tlv_random [4];
 #endif
 
-#if defined(USES_TIVAWARE)
-            // Tiva: generate random seed from CRC unit
-            // set initial seed as 12345678
-    board_unique_crcid_init (12345678, (CRC_CFG_SIZE_8BIT|CRC_CFG_INIT_SEED));
-
-    board_unique_crcid_compute (macAddressVal, 6, CRC_CFG_SIZE_8BIT);
-
-    crcResult = 12345678;     // BROKEN - NEEDS FIX
+    crc_init (&ctx, CRC_32);
+#if defined(TLV_RANDOM_NUM_1)
+            // MSP432: mix in the device's factory random number (TLV)
+    tlv_random[0] = TLV_RANDOM_NUM_1;
+    tlv_random[1] = TLV_RANDOM_NUM_2;
+    tlv_random[2] = TLV_RANDOM_NUM_3;
+    tlv_random[3] = TLV_RANDOM_NUM_4;
+    crc_update (&ctx, tlv_random, sizeof(tlv_random));
 #endif
+    crc_update (&ctx, macAddressVal, sizeof(macAddressVal));
+    crcResult = crc_final (&ctx);
 
-#if defined(USE_HAL_DRIVER)
-            // STM32: generate random seed from CRC unit
-#if defined(F4)
-    __HAL_RCC_CRC_CLK_ENABLE();      // turn on CRC module's clocks
-#endif
-#if defined(STM32F072xB)
-    __CRC_CLK_ENABLE();
-#endif
-       // Configure the CRC peripheral
-    CrcHandle.Instance = CRC;
-    i = HAL_CRC_Init (&CrcHandle);
-    if (i != HAL_OK)
-       {
-          while (1);                 // Initialization Error - hang for debugger
-       }
-    for (i = 0;  i < 6;  i++)
-       u32Buffer[i] = macAddressVal[i];  // convert from 8-bit to L.O. 32-bit
-
-    crcResult = HAL_CRC_Accumulate (&CrcHandle, u32Buffer, 6);  // yields 0
-    crcResult = HAL_CRC_Calculate (&CrcHandle, u32Buffer, 6);   // ditto WTF
-#endif
-
-#if defined(MSP430)
-    board_unique_crcid_init (0L, 0);     // no seed value supplied
-    crcResult = board_unique_crcid_compute (macAddressVal, sizeof(macAddressVal),
-                                            8);
-#endif
-
-    if (crcResult != 0)
-       sprintf (uniqueID, "%06X", crcResult);
-       else sprintf (uniqueID, "%06X", &macAddressVal[0]);  // use MAC as seed
+    sprintf (uniqueID, "%06lX", (unsigned long) crcResult);
 }
 
 
@@ -271,11 +316,14 @@ void  generateUniqueID (void)
 //****************************************************************************
 void  messageArrived (MessageData *data)
 {
-    char  topic_buf[24];
-    char  data_buf[MQ_BUFF_SIZE];
-
-    char  *tok;
-    long  color;
+    char      topic_buf[24];
+#if DECODE_LATER_WITH_JSON
+    uint32_t  found_mask;
+    int       rc;
+#if defined(STM32_MCU)
+    uint32_t  rgb_ccr[3];
+#endif
+#endif
 
     LED1_TOGGLE();    // toggle the LED each time we rcvd a msg
 
@@ -287,37 +335,101 @@ void  messageArrived (MessageData *data)
         DEBUG_LOG ("Topic name too long!\n\r");
         return;
       }
-        // Check for buffer overflow on data buffer
-    if (data->message->payloadlen >= sizeof(data_buf))
-      {
-        DEBUG_LOG ("Payload too long!\n\r");
-        return;
-      }
 
     strncpy (topic_buf, data->topicName->lenstring.data,
              MIN(sizeof(topic_buf), data->topicName->lenstring.len));
     topic_buf [data->topicName->lenstring.len] = 0;  // add trailing \0
 
-    strncpy (data_buf, data->message->payload,
-             MIN(sizeof(data_buf), data->message->payloadlen));
-    data_buf [data->message->payloadlen] = 0;        // add trailing \0
-
 #if DECODE_LATER_WITH_JSON
-    tok     = strtok (data_buf, " ");
-    color   = strtol (tok, NULL, 10);
-    TA0CCR1 = PWM_PERIOD * (color/255.0);     // set new CCR1 PWM duty cycle
-    tok     = strtok (NULL, " ");
-    color   = strtol (tok, NULL, 10);
-    TA0CCR2 = PWM_PERIOD * (color/255.0);     // set new CCR2 PWM duty cycle
-    tok     = strtok (NULL, " ");
-    color   = strtol (tok, NULL, 10);
-    TA0CCR3 = PWM_PERIOD * (color/255.0);     // set new CCR3 PWM duty cycle
+        // decode {"r":..,"g":..,"b":..} (JSON or CBOR) straight out of the
+        // MQTT receive buffer. Colors not in the message keep their values.
+        // Our own status records (DO_LOOPBACK) have no colors: ignored.
+    rc = tcodec_dec_record (data->message->payload, data->message->payloadlen,
+                            TCODEC_AUTO,
+                            rgb_cmd_fields, TCODEC_NUM_FIELDS(rgb_cmd_fields),
+                            &rgb_cmd, &found_mask);
+    if (rc < 0)
+      {
+        DEBUG_LOG ("Bad RGB command payload!\n\r");
+        return;
+      }
+    if (found_mask == 0)
+       return;                                // not a color command
+
+#if defined(STM32_MCU)
+        // all 3 colors change at the same PWM period boundary, so the LED
+        // never shows a mix of the old and new colors for a period.
+    rgb_ccr[0] = (PWM_PERIOD * (uint32_t) rgb_cmd.red)   / 255;
+    rgb_ccr[1] = (PWM_PERIOD * (uint32_t) rgb_cmd.green) / 255;
+    rgb_ccr[2] = (PWM_PERIOD * (uint32_t) rgb_cmd.blue)  / 255;
+    pwm_Set_Duty_Cycles (PWM_RGB_MODULE, rgb_ccr, 3, 0);  // CCR1/2/3 = R/G/B
+#else
+    TA0CCR1 = (PWM_PERIOD * (uint32_t) rgb_cmd.red)   / 255;  // new CCR1 duty cycle
+    TA0CCR2 = (PWM_PERIOD * (uint32_t) rgb_cmd.green) / 255;  // new CCR2 duty cycle
+    TA0CCR3 = (PWM_PERIOD * (uint32_t) rgb_cmd.blue)  / 255;  // new CCR3 duty cycle
+#endif                                        // STM32_MCU
 #endif
 
     return;
 }
 
 
+//****************************************************************************
+//
+//!    \brief Encode our status record into pub_payload.
+//!
+//!    Encoded straight into the buffer MQTTPublish() takes the payload
+//!    from: no sprintf, no intermediate strings.
+//!
+//! \return                        payload length, or ERR_TCODEC_OVERFLOW
+//
+//****************************************************************************
+int  encodeStatus (void)
+{
+    TCODEC_ENC  enc;
+    int         len;
+
+    status_rec.id.ptr   = uniqueID;
+    status_rec.id.len   = strlen (uniqueID);
+    status_rec.pub_msgs = num_pub_msgs;
+    status_rec.sub_msgs = num_sub_msgs;
+#if defined(USES_LAT_TRACE)
+    lat_trace_stamp (&pub_trace, LAT_STAGE_PROCESS);   // record is up to date
+#endif
+
+    tcodec_enc_init (&enc, pub_payload, sizeof(pub_payload), TELEMETRY_FORMAT);
+    tcodec_enc_record (&enc, status_fields, TCODEC_NUM_FIELDS(status_fields),
+                       &status_rec);
+    len = tcodec_enc_finish (&enc);
+#if defined(USES_LAT_TRACE)
+    lat_trace_stamp (&pub_trace, LAT_STAGE_ENCODE);
+#endif
+    return (len);
+}
+
+
+#if defined(USES_LAT_TRACE)
+//****************************************************************************
+//
+//!    \brief Encode the latency stats into diag_payload.
+//!
+//!    usec per stage: [count,min,p50,p90,p99,max]. "e2e" is from the
+//!    status sample being taken to the transport write completing.
+//!
+//! \return                        payload length, or ERR_TCODEC_OVERFLOW
+//
+//****************************************************************************
+int  encodeLatencyStats (void)
+{
+    TCODEC_ENC  enc;
+
+    tcodec_enc_init (&enc, diag_payload, sizeof(diag_payload), TELEMETRY_FORMAT);
+    lat_trace_encode (&enc);
+    return (tcodec_enc_finish (&enc));
+}
+#endif
+
+
 /*******************************************************************************
 *                                   main
 *******************************************************************************/
@@ -329,6 +441,14 @@ int  main (int argc, char** argv)
 
     LED1_INIT();                    // Setup LED1 for output
 
+#if defined(USES_BINLOG)
+    binlog_init (binlog_ring, BINLOG_RING_WORDS, UART_MD, 0);
+#endif
+#if defined(USES_LAT_TRACE)
+    sys_Timestamp_Init();           // start the cycle counter clock
+    lat_trace_init (LAT_TRACE_TICK_HZ);
+#endif
+
     if (console_read_wait > 0)
        uart_get_config_info();      // get server info from user via UART
 
@@ -443,6 +563,9 @@ int  main (int argc, char** argv)
                 // SUBSCRIBE messages will drive messageArrived() above.
                 //--------------------------------------------------------
         rc = MQTTYield (&hMQTTClient, 10);
+#if defined(USES_BINLOG)
+        binlog_service();          // drain any DEBUG_LOGs from messageArrived
+#endif
         if (rc != 0)
            {
                  // no packets received, try again later
@@ -456,13 +579,28 @@ int  main (int argc, char** argv)
 
 //      if (publishID)           // flag indicating send button was pushed
            {
+#if defined(USES_LAT_TRACE)
+             lat_trace_begin (&pub_trace, LAT_TRACE_NOW());  // sample taken now
+#endif
+             rc = encodeStatus();
+             if (rc < 0)
+                {
+                  CONSOLE_WRITE (" Status record does not fit in pub_payload. Terminating.\n\r");
+                  while (1) ;        // hang for debugger
+                }
              pub_msg.dup        = 0;
              pub_msg.id         = 0;
-             pub_msg.payload    = uniqueID;
-             pub_msg.payloadlen = 8;
+             pub_msg.payload    = pub_payload;
+             pub_msg.payloadlen = rc;
              pub_msg.qos        = QOS0;
              pub_msg.retained   = 0;
+#if defined(USES_LAT_TRACE)
+             lat_trace_set_current (&pub_trace);  // MQTT stamps PUBLISH, XMIT
+#endif
              rc = MQTTPublish (&hMQTTClient, PUBLISH_TOPIC, &pub_msg);
+#if defined(USES_LAT_TRACE)
+             lat_trace_close (&pub_trace);
+#endif
 
              if (rc != 0)
                 {
@@ -473,6 +611,19 @@ int  main (int argc, char** argv)
 
              num_pub_msgs++;         // inc count of # msgs we have published
 //           publishID = 0;          // clear the send button flag
+
+#if defined(USES_LAT_TRACE)
+             if ((num_pub_msgs % LAT_REPORT_EVERY) == 0)
+                {     // publish the stats, then start a new interval
+                  rc = encodeLatencyStats();
+                  if (rc > 0)
+                     { pub_msg.payload    = diag_payload;
+                       pub_msg.payloadlen = rc;
+                       MQTTPublish (&hMQTTClient, DIAG_TOPIC, &pub_msg);
+                     }
+                  lat_trace_reset();
+                }
+#endif
            }
 
         board_delay_ms (100);
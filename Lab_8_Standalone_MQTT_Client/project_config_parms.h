@@ -51,11 +51,27 @@
 
 //#define CONSOLE_STARTUP_INPUT_WAIT  5
 
+// STM32 only: route DEBUG_LOG to the Binary Log (common/binlog.c), and decode
+// it on the host with tools/binlog_decode.py and this project's .elf file.
+//#define USES_BINLOG               1
+
+// Unified CRC engine (common/crc_engine.c): use the MCU's CRC unit, and DMA
+// for large buffers. CRC_SLICE_BY_8 = faster software CRCs, but uses ~7 KB RAM.
+//#define USES_CRC_HW               1
+//#define CRC_USES_DMA              1
+//#define CRC_SLICE_BY_8            1
+
 
            //---------------------------------------------
            //  put any project specific settings in here.
            //---------------------------------------------
 
+        // per-stage latency of each status publish (common/lat_trace.c):
+        // "lat" on the console, and stats published on DIAG_TOPIC.
+        // STM32 only: needs the timestamp service (USES_TIMESTAMP).
+//#define USES_TIMESTAMP         1
+//#define USES_LAT_TRACE         1
+
 // use the default_project_config_parms.h (in the ~/boards directory) as 
 // the template for what parameters are supported.
 
@@ -0,0 +1,344 @@
+/********1*********2*********3*********4*********5*********6*********7**********
+*
+*                              ble_beacon.c
+*
+*
+* Connectionless BLE sensor Beacons:  advertising data encode/decode, page
+* rotation for the advertiser, and the observer's de-duplicating node table.
+* See ble_beacon.h for the advertisement layout.
+*
+* History:
+* --------
+*  10/19/26 - Created.
+*
+* -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*******************************************************************************/
+
+#include "ble_beacon.h"
+
+#include <string.h>
+
+
+/*******************************************************************************
+* beacon_encode
+*
+*            Build the advertising data for a Beacon message.
+*
+*            BEACON_ADD_FLAGS_AD prepends a Flags AD structure, for stacks
+*            that do not add one on their own.  (BlueNRG's
+*            aci_gap_set_discoverable() already does).
+*
+*            Returns the # bytes of advertising data, or BEACON_ERR_xxx.
+*******************************************************************************/
+int  beacon_encode (BEACON_MSG *msg, uint8_t *adv_data, int max_length, int flags)
+{
+    uint8_t   *p;
+    int       ad_len;
+    int       i;
+
+    if (msg == 0L || adv_data == 0L || msg->num_readings > BEACON_MAX_READINGS
+       || msg->page >= BEACON_MAX_PAGES)
+       return (BEACON_ERR_INVALID_PARM);
+
+    ad_len = BEACON_HDR_LEN + 3 * msg->num_readings;
+    if (flags & BEACON_ADD_FLAGS_AD)
+       ad_len += 3;
+    if (ad_len > max_length  ||  ad_len > BEACON_ADV_MAX_LEN)
+       return (BEACON_ERR_BAD_LENGTH);
+
+    p = adv_data;
+    if (flags & BEACON_ADD_FLAGS_AD)
+       { *p++ = 2;
+         *p++ = AD_TYPE_FLAGS_VALUE;
+         *p++ = AD_FLAGS_LE_GENERAL_NO_BREDR;
+       }
+    *p++ = (uint8_t) (BEACON_HDR_LEN - 1 + 3 * msg->num_readings);  // AD len
+    *p++ = AD_TYPE_MANUF_SPECIFIC;
+    *p++ = (uint8_t) BEACON_COMPANY_ID;
+    *p++ = (uint8_t) (BEACON_COMPANY_ID >> 8);
+    *p++ = (uint8_t) ((BEACON_VERSION << 4) | msg->page);
+    *p++ = (uint8_t) msg->node_id;
+    *p++ = (uint8_t) (msg->node_id >> 8);
+    *p++ = msg->seq;
+    *p++ = msg->digital_bits;
+    for (i = 0;  i < msg->num_readings;  i++)
+      {
+        *p++ = msg->readings[i].id;
+        *p++ = (uint8_t) msg->readings[i].value;
+        *p++ = (uint8_t) (msg->readings[i].value >> 8);
+      }
+
+    return (ad_len);
+}
+
+
+/*******************************************************************************
+* beacon_decode
+*
+*            Walk the AD structures of a received advertisement, and decode
+*            our Manufacturer Specific Beacon data, if present.
+*
+*            Returns 0 if a Beacon was decoded, or BEACON_ERR_xxx.
+*******************************************************************************/
+int  beacon_decode (uint8_t *adv_data, int adv_length, BEACON_MSG *msg)
+{
+    uint8_t   *ad;
+    int       pos;
+    int       ad_len;
+    int       nreadings;
+    int       i;
+
+    if (adv_data == 0L || msg == 0L)
+       return (BEACON_ERR_INVALID_PARM);
+
+    pos = 0;
+    while (pos < adv_length)
+      {
+        ad_len = adv_data[pos];         // length of type + data
+        if (ad_len == 0)
+           break;                       // early end of significant data
+        if (pos + 1 + ad_len > adv_length)
+           return (BEACON_ERR_BAD_LENGTH);
+        ad = &adv_data[pos];
+
+        if (ad[1] == AD_TYPE_MANUF_SPECIFIC  &&  ad_len >= BEACON_HDR_LEN - 1
+           && ad[2] == (uint8_t) BEACON_COMPANY_ID
+           && ad[3] == (uint8_t) (BEACON_COMPANY_ID >> 8)
+           && (ad[4] >> 4) == BEACON_VERSION)
+           {
+             nreadings = (ad_len - (BEACON_HDR_LEN - 1)) / 3;
+             if ((ad_len - (BEACON_HDR_LEN - 1)) % 3 != 0
+                || nreadings > BEACON_MAX_READINGS)
+                return (BEACON_ERR_BAD_LENGTH);
+
+             msg->page         = ad[4] & 0x0F;
+             msg->node_id      = ad[5] | (ad[6] << 8);
+             msg->seq          = ad[7];
+             msg->digital_bits = ad[8];
+             msg->num_readings = (uint8_t) nreadings;
+             ad += BEACON_HDR_LEN;
+             for (i = 0;  i < nreadings;  i++, ad += 3)
+               {
+                 msg->readings[i].id    = ad[0];
+                 msg->readings[i].value = ad[1] | (ad[2] << 8);
+               }
+             return (0);                // denote success
+           }
+
+        pos += 1 + ad_len;              // step to next AD structure
+      }
+
+    return (BEACON_ERR_NOT_BEACON);
+}
+
+
+/*******************************************************************************
+* beacon_tx_init
+*
+*            Setup a Beacon node. readings is the App's array of readings,
+*            which it keeps up to date in place.  It is sent in pages of
+*            BEACON_MAX_READINGS, one page per rotation.
+*******************************************************************************/
+int  beacon_tx_init (BEACON_TX *tx, uint16_t node_id,
+                     BEACON_READING *readings, int num_readings)
+{
+    if (tx == 0L || num_readings < 0
+       || num_readings > BEACON_MAX_READINGS * BEACON_MAX_PAGES
+       || (num_readings > 0 && readings == 0L))
+       return (BEACON_ERR_INVALID_PARM);
+
+    memset (tx, 0, sizeof(BEACON_TX));
+    tx->node_id      = node_id;
+    tx->readings     = readings;
+    tx->num_readings = (uint8_t) num_readings;
+
+    return (0);                         // denote success
+}
+
+
+/*******************************************************************************
+* beacon_tx_next
+*
+*            Rotate to the next page of readings, and build its advertising
+*            data. Called once per rotation interval.
+*
+*            Returns the # bytes of advertising data, or BEACON_ERR_xxx.
+*******************************************************************************/
+int  beacon_tx_next (BEACON_TX *tx, uint8_t *adv_data, int max_length, int flags)
+{
+    BEACON_MSG  msg;
+    int         num_pages;
+    int         first;
+    int         i;
+
+    num_pages = (tx->num_readings + BEACON_MAX_READINGS - 1) / BEACON_MAX_READINGS;
+    if (num_pages == 0)
+       num_pages = 1;                   // digital bits only
+    if (tx->next_page >= num_pages)
+       tx->next_page = 0;
+
+    msg.node_id      = tx->node_id;
+    msg.page         = tx->next_page;
+    msg.seq          = tx->seq;
+    msg.digital_bits = tx->digital_bits;
+    first            = tx->next_page * BEACON_MAX_READINGS;
+    msg.num_readings = 0;
+    for (i = first;  i < tx->num_readings  &&  i < first + BEACON_MAX_READINGS;  i++)
+       msg.readings [msg.num_readings++] = tx->readings[i];
+
+    tx->seq++;
+    tx->next_page++;
+
+    return (beacon_encode(&msg, adv_data, max_length, flags));
+}
+
+
+/*******************************************************************************
+* beacon_table_init
+*
+*            Setup an observer node table over the App supplied array.
+*            num_entries must be a power of 2.
+*******************************************************************************/
+int  beacon_table_init (BEACON_TABLE *tbl, BEACON_NODE *nodes, int num_entries)
+{
+    if (tbl == 0L || nodes == 0L || num_entries < 1 || num_entries > 0x8000
+       || (num_entries & (num_entries - 1)) != 0)
+       return (BEACON_ERR_INVALID_PARM);
+
+    memset (nodes, 0, num_entries * sizeof(BEACON_NODE));
+    tbl->nodes     = nodes;
+    tbl->size      = (uint16_t) num_entries;
+    tbl->num_nodes = 0;
+    tbl->evictions = 0;
+
+    return (0);                         // denote success
+}
+
+
+/*******************************************************************************
+* beacon_table_find
+*
+*            Look up a node. Open addressing, with linear probing.
+*******************************************************************************/
+BEACON_NODE  *beacon_table_find (BEACON_TABLE *tbl, uint16_t node_id)
+{
+    BEACON_NODE  *node;
+    uint16_t     slot;
+    uint16_t     i;
+
+    slot = (uint16_t) (node_id ^ (node_id >> 7));
+    for (i = 0;  i < tbl->size;  i++)
+      {
+        node = &tbl->nodes [(slot + i) & (tbl->size - 1)];
+        if ( ! node->in_use)
+           return (0L);                 // hit an empty slot: not in table
+        if (node->node_id == node_id)
+           return (node);
+      }
+
+    return (0L);
+}
+
+
+/*******************************************************************************
+* beacon_table_update
+*
+*            Fold a decoded Beacon into the node table.
+*
+*            The same advertisement is heard many times (every advertising
+*            event, on all 3 channels), so repeats of a node's last seq # are
+*            counted and dropped. A jump of more than 1 in seq # counts the
+*            pages that were missed. A backwards jump is taken as the node
+*            having restarted, and just re-syncs.
+*
+*            If the table is full, the node that has been silent the longest
+*            is replaced.
+*
+*            Returns BEACON_NEW_NODE, BEACON_NEW, or BEACON_DUPLICATE.
+*******************************************************************************/
+int  beacon_table_update (BEACON_TABLE *tbl, BEACON_MSG *msg, int rssi,
+                          uint32_t now_ms)
+{
+    BEACON_NODE  *node;
+    uint8_t      gap;
+    int          rc;
+    int          i;
+
+    node = beacon_table_find (tbl, msg->node_id);
+    if (node != 0L)
+       {
+         node->rssi = (int8_t) rssi;
+         if (msg->seq == node->last_seq)
+            { node->duplicates++;
+              return (BEACON_DUPLICATE);
+            }
+         gap = (uint8_t) (msg->seq - node->last_seq);
+         if (gap < 128)
+            node->pages_missed += gap - 1;
+         rc = BEACON_NEW;
+       }
+      else {
+             node = 0L;
+             if (tbl->num_nodes < tbl->size)
+                {       // take the first free slot in the probe sequence
+                  uint16_t slot = (uint16_t) (msg->node_id ^ (msg->node_id >> 7));
+                  for (i = 0;  i < tbl->size;  i++)
+                    { node = &tbl->nodes [(slot + i) & (tbl->size - 1)];
+                      if ( ! node->in_use)
+                         break;
+                    }
+                  tbl->num_nodes++;
+                }
+               else {   // full: replace the node silent the longest.  No slot
+                        // ever goes empty, so probing still finds every node.
+                      node = &tbl->nodes[0];
+                      for (i = 1;  i < tbl->size;  i++)
+                        if ((int32_t) (tbl->nodes[i].last_seen - node->last_seen) < 0)
+                           node = &tbl->nodes[i];
+                      tbl->evictions++;
+                    }
+             memset (node, 0, sizeof(BEACON_NODE));
+             node->in_use  = 1;
+             node->node_id = msg->node_id;
+             node->rssi    = (int8_t) rssi;
+             rc = BEACON_NEW_NODE;
+           }
+
+    node->last_seq     = msg->seq;
+    node->last_seen    = now_ms;
+    node->digital_bits = msg->digital_bits;
+    node->pages_rcvd++;
+    for (i = 0;  i < msg->num_readings;  i++)
+      {
+        if (msg->readings[i].id < BEACON_MAX_IDS)
+           { node->values [msg->readings[i].id] = msg->readings[i].value;
+             node->value_mask |= (1UL << msg->readings[i].id);
+           }
+      }
+
+    return (rc);
+}
+
+/******************************************************************************/
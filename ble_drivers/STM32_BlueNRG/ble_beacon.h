@@ -0,0 +1,162 @@
+/********1*********2*********3*********4*********5*********6*********7**********
+*
+*                              ble_beacon.h
+*
+*
+* Definitions for connectionless BLE sensor Beacons.
+*
+* Instead of a full GAP connection per sensor node, each node broadcasts its
+* "process image" readings inside the Manufacturer Specific Data of its
+* (non-connectable) advertisements. An observer just scans, so it can follow
+* hundreds of nodes, and picks up a node again the moment it is back in range.
+*
+* A node's readings are split into pages of up to BEACON_MAX_READINGS, and
+* the advertised page is rotated at a configurable interval. The sequence #
+* is bumped on every rotation, so an observer can tell a new page from the
+* many repeats of the same advertisement, and count the pages it missed.
+*
+* Manufacturer Specific AD layout  (fits in a legacy 31 byte advertisement,
+* after the 3 byte Flags AD):
+*
+*      len, 0xFF                 AD header
+*      company id   (2)          BEACON_COMPANY_ID, little endian
+*      ver | page   (1)          hi nibble = BEACON_VERSION, lo = page #
+*      node id      (2)          little endian
+*      seq          (1)          bumped on every new page
+*      digital bits (1)          8 on/off inputs/outputs  (switches, LEDs)
+*      readings     (3 each)     id, value (16 bit, little endian)
+*
+* The encode/decode and the observer's node table are pure C, with no
+* BlueNRG dependencies, so they can be exercised on a host.
+*
+* History:
+* --------
+*  10/19/26 - Created.
+*
+* -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*******************************************************************************/
+
+#ifndef __BLE_BEACON_H__
+#define __BLE_BEACON_H__
+
+#include "user_api.h"                 // MCU and Board specific parms/pins/etc
+
+#define  BEACON_COMPANY_ID     0xFFFF  /* SIG id reserved for internal testing */
+#define  BEACON_VERSION             1
+#define  BEACON_MAX_READINGS        6  /* readings per advertisement (page)    */
+#define  BEACON_MAX_PAGES          16
+#define  BEACON_MAX_IDS            32  /* reading ids 0-31 tracked per node    */
+#define  BEACON_HDR_LEN             9  /* AD len+type, company, ver, node, seq, bits */
+#define  BEACON_ADV_MAX_LEN        31  /* legacy advertising data size         */
+
+#define  AD_TYPE_FLAGS_VALUE     0x01
+#define  AD_TYPE_MANUF_SPECIFIC  0xFF
+#define  AD_FLAGS_LE_GENERAL_NO_BREDR  0x06
+
+            // Valid values for flags on beacon_encode()
+#define  BEACON_ADD_FLAGS_AD   0x0001  /* prepend Flags AD (if stack does not) */
+
+            // Return codes from beacon_table_update()
+#define  BEACON_DUPLICATE           0  /* repeat of the last page seen         */
+#define  BEACON_NEW                 1  /* a new page from a known node         */
+#define  BEACON_NEW_NODE            2  /* first time this node was seen        */
+
+#define  BEACON_ERR_NOT_BEACON     -1  /* no Beacon in the advertising data    */
+#define  BEACON_ERR_BAD_LENGTH     -2  /* malformed/truncated AD structure     */
+#define  BEACON_ERR_INVALID_PARM   -3
+
+
+typedef struct beacon_reading_def       /* one sensor/actuator reading */
+   {
+       uint8_t    id;                   // App assigned id: 0 - BEACON_MAX_IDS-1
+       uint16_t   value;
+   } BEACON_READING;
+
+
+typedef struct beacon_msg_def           /* a decoded Beacon advertisement */
+   {
+       uint16_t   node_id;
+       uint8_t    page;
+       uint8_t    seq;
+       uint8_t    digital_bits;
+       uint8_t    num_readings;
+       BEACON_READING  readings [BEACON_MAX_READINGS];
+   } BEACON_MSG;
+
+
+typedef struct beacon_tx_def            /* Beacon node (advertiser) state */
+   {
+       uint16_t   node_id;
+       uint8_t    seq;
+       uint8_t    next_page;
+       uint8_t    digital_bits;         // App updates these in place
+       uint8_t    num_readings;
+       BEACON_READING  *readings;       // App's "process image" readings,
+   } BEACON_TX;                         //   updated in place by the App
+
+
+typedef struct beacon_node_def          /* Observer: one entry per node heard */
+   {
+       uint16_t   node_id;
+       uint8_t    in_use;
+       uint8_t    last_seq;
+       int8_t     rssi;                 // of last advertisement
+       uint8_t    digital_bits;
+       uint32_t   last_seen;            // App timestamp (ms) of last new page
+       uint32_t   value_mask;           // which values[] have been received
+       uint16_t   values [BEACON_MAX_IDS];
+       uint32_t   pages_rcvd;           // # new pages decoded
+       uint32_t   pages_missed;         // # pages skipped, per seq #
+       uint32_t   duplicates;           // # repeat advertisements ignored
+   } BEACON_NODE;
+
+
+typedef struct beacon_table_def         /* Observer node table */
+   {
+       BEACON_NODE  *nodes;             // App supplied array
+       uint16_t   size;                 // # entries. Must be a power of 2
+       uint16_t   num_nodes;            // # entries in use
+       uint32_t   evictions;            // # stale nodes replaced: table full
+   } BEACON_TABLE;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int   beacon_encode (BEACON_MSG *msg, uint8_t *adv_data, int max_length, int flags);
+int   beacon_decode (uint8_t *adv_data, int adv_length, BEACON_MSG *msg);
+
+int   beacon_tx_init (BEACON_TX *tx, uint16_t node_id,
+                      BEACON_READING *readings, int num_readings);
+int   beacon_tx_next (BEACON_TX *tx, uint8_t *adv_data, int max_length, int flags);
+
+int   beacon_table_init (BEACON_TABLE *tbl, BEACON_NODE *nodes, int num_entries);
+int   beacon_table_update (BEACON_TABLE *tbl, BEACON_MSG *msg, int rssi,
+                           uint32_t now_ms);
+BEACON_NODE *beacon_table_find (BEACON_TABLE *tbl, uint16_t node_id);
+
+#endif                          //  __BLE_BEACON_H__
+
+/******************************************************************************/
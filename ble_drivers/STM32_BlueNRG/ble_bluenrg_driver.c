@@ -47,6 +47,15 @@
 *             initialized, otherwise can get into a race condition with EXTI
 *             interrupts at startup on slower processors (L0, L1). Duq
 *  06/20/15 - Increased STACKSIZE to handle startup nesting issues. Duq
+*  10/19/26 - mnet_send()/mnet_recv() now run over a segmenting GATT stream
+*             transport (ble_stream.c), with TX pool flow control.
+*  10/19/26 - Added connectionless Beacon mode (ble_beacon.c): a node
+*             broadcasts its readings in non-connectable advertisements,
+*             an observer scans and tracks them in a per-node table.
+*  10/19/26 - mnet_connect_network() is now BLE_Connect_Network_Start() plus
+*             BLE_Connect_Network_Poll(), so the App can overlap the ~10 ms
+*             BlueNRG reset pulse / boot with its other init. The stack
+*             config steps are timed by the boot profiler (USES_BOOT_PROFILE).
 *
 * -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 *
@@ -77,10 +86,24 @@
 
 #include "mnet_call_api.h"            // Defs for common COMM TCP/BLE/MQTT API
 
+#include "sample_service.h"           // BlueNRG ACI calls, sample service handles
+#include "ble_stream.h"               // GATT stream transport for send/recv
+#include "ble_beacon.h"               // connectionless Beacon encode/decode
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
 
+#if defined(USES_BOOT_PROFILE)
+#include "boot_prof.h"                // boot time profiler
+#define  BLE_PROF_BEGIN(name)   _g_ble_prof_id = boot_prof_begin (name)
+#define  BLE_PROF_END(rc)       boot_prof_end (_g_ble_prof_id, rc)
+    int              _g_ble_prof_id = -1;
+#else
+#define  BLE_PROF_BEGIN(name)
+#define  BLE_PROF_END(rc)
+#endif
+
 
     int              debug_spi    = 0;        // SPI DEBUG LOOP for Scope Trace
     unsigned char    tcp_tmp_array[6];        // Debug
@@ -102,6 +125,8 @@ void  BlueNRG_GPIO_Init (SPI_HandleTypeDef* hspi);    // DEBUG
 extern volatile uint8_t   set_connectable;    // defined in ble_sample_service.c
 extern volatile int       connected;          // KEY CONTROL VARIABLES
 extern volatile uint8_t   notification_enabled;
+extern volatile uint16_t  connection_handle;
+extern          uint16_t  sampleServHandle,  TXCharHandle;
 
 //-----------------------------------------------------------------------------
 // Uncomment the line corresponding to the role you want to have
@@ -130,6 +155,51 @@ extern uint8_t            SERVER_BDADDR[];
 volatile int16_t   BLE_Status2;           // DEBUG ONLY  CRAZY ASS COMPILER
 volatile int16_t   BLE_Status;            // are globals to assist debugging
 
+              //--------------------------------------------------
+              //  GATT stream transport behind mnet_send/mnet_recv
+              //--------------------------------------------------
+#define  BLE_STREAM_SOCKID           123     // we only allow one BLE connection
+
+              // Connection interval requested by a SERVER (peripheral) once
+              // a client connects, in 1.25 ms units: 7.5 - 15 ms, no slave
+              // latency, 4 sec supervision timeout.  A CLIENT (central)
+              // sets its interval via CONN_P1/CONN_P2 in connection_config.h
+#define  BLE_STREAM_CONN_INTERVAL_MIN  6
+#define  BLE_STREAM_CONN_INTERVAL_MAX 12
+#define  BLE_STREAM_SUPERV_TIMEOUT   400     // in 10 ms units
+
+    BLE_STREAM         _g_ble_stream;
+
+              //--------------------------------------------------
+              //  connectionless Beacon mode
+              //--------------------------------------------------
+              // Observer scan interval/window, in 0.625 ms units. Window ==
+              // interval: listen continuously, so no nodes are missed.
+#define  BLE_BEACON_SCAN_INTERVAL   0x0010   // 10 ms
+#define  BLE_BEACON_SCAN_WINDOW     0x0010
+
+    BEACON_TX          _g_beacon_tx;          // broadcaster: our readings
+    BEACON_TABLE       *_g_beacon_table = 0L; // observer: nodes heard
+    uint32_t           _g_beacon_rotate_ms;
+    uint32_t           _g_beacon_last_rotate;
+    uint32_t           _g_beacon_not_beacon = 0;  // # other adverts heard
+
+              //--------------------------------------------------
+              //  non-blocking network connect (reset pulse timing)
+              //--------------------------------------------------
+#define  BLE_CONN_IDLE               0       // Start not called, or done
+#define  BLE_CONN_RESET_LOW          1       // RESET held low
+#define  BLE_CONN_BOOTING            2       // RESET released, BlueNRG booting
+#define  BLE_RESET_PULSE_MS          5       // as BlueNRG_RST() used
+#define  BLE_BOOT_WAIT_MS            5
+
+    uint8_t            _g_ble_conn_state = BLE_CONN_IDLE;
+    uint32_t           _g_ble_conn_ms;        // sys_Get_Time() at last change
+
+static int  ble_stream_tx_segment (void *tx_parm, uint8_t *seg, int seg_len);
+static void ble_stream_poll (void);
+static int  ble_bluenrg_configure (void);
+
 
 /*******************************************************************************
 * mnet_connect_network
@@ -142,11 +212,40 @@ volatile int16_t   BLE_Status;            // are globals to assist debugging
 *            On success, the function returns a non-negative integer of the
 *            network id to use.
 *            On error, -1 is returned, and errno is set appropriately.
+*
+*            Blocks through the BlueNRG reset pulse. To do other init during
+*            it, call BLE_Connect_Network_Start() / _Poll() instead.
 *******************************************************************************/
 int  mnet_connect_network (int network_type, int net_addr_type, char *AP_SSID,
                            char *AP_PWD, int AP_security, int net_flags)
 {
-    int   retVal;
+    int   rc;
+
+    rc = BLE_Connect_Network_Start (network_type, net_addr_type, AP_SSID,
+                                    AP_PWD, AP_security, net_flags);
+    if (rc < 0)
+       return (rc);
+
+    while ((rc = BLE_Connect_Network_Poll()) == EAGAIN)
+      ;                         // ~10 ms: reset pulse, then BlueNRG boot
+    return (rc);
+}
+
+
+/*******************************************************************************
+* BLE_Connect_Network_Start
+*
+*            First half of mnet_connect_network(): set up the BlueNRG's GPIOs,
+*            SPI and IRQ, and start its reset pulse. Returns right away, with
+*            RESET held low.  Then call BLE_Connect_Network_Poll() until it
+*            stops returning EAGAIN.
+*
+*            On success, returns 0.
+*            On error, -1 is returned, and errno is set appropriately.
+*******************************************************************************/
+int  BLE_Connect_Network_Start (int network_type, int net_addr_type, char *AP_SSID,
+                                char *AP_PWD, int AP_security, int net_flags)
+{
   GPIO_InitTypeDef  GPIO_InitStruct;    // ST LOGIC  TEMP HACK
   extern SPI_HandleTypeDef  SpiHandle;  // ST LOGIC  TEMP HACK
 
@@ -182,7 +281,7 @@ int  mnet_connect_network (int network_type, int net_addr_type, char *AP_SSID,
     pin_Config (BLE_BLUENRG_RESET, GPIO_OUTPUT, PIN_USE_PULLUP);
 
     ASSERT_BlueNRG_RESET();     // Ensure RESET pin is asserted to reset the HW.
-                                // It is cleared in the BlueNRG_RST() call below
+                                // It is released by BLE_Connect_Network_Poll()
 
        //-----------------------------------------------------------------
        //  Initialize the GPIO used as the SPI CS Chip Select for BlueNRG
@@ -231,8 +330,68 @@ int  mnet_connect_network (int network_type, int net_addr_type, char *AP_SSID,
 
     HCI_Init();                // Initialize the BlueNRG HCI support
 
-    BlueNRG_RST();             // Reset BlueNRG hardware and then ENABLE BlueNRG
+       //-------------------------------------------------------------------
+       //  Start the reset pulse. BlueNRG_RST() used to hold RESET low 5 ms,
+       //  then wait 5 ms for the BlueNRG to boot: BLE_Connect_Network_Poll()
+       //  times both, so the caller's other init can run meanwhile.
+       //-------------------------------------------------------------------
+    BLE_PROF_BEGIN ("ble_rst");
+    pin_Low (BLE_BLUENRG_RESET);
+    _g_ble_conn_ms    = sys_Get_Time();
+    _g_ble_conn_state = BLE_CONN_RESET_LOW;
+
+    return (0);           // denote reset pulse started
+}
+
+
+/*******************************************************************************
+* BLE_Connect_Network_Poll
+*
+*            Second half of mnet_connect_network(). Returns EAGAIN while the
+*            reset pulse / BlueNRG boot is still running. Once it is done,
+*            it configures the BLE stack (address, GATT, GAP, services),
+*            which blocks on each HCI command's reply, and returns the
+*            network id to use.
+*
+*            On error, -1 is returned, and errno is set appropriately.
+*******************************************************************************/
+int  BLE_Connect_Network_Poll (void)
+{
+    uint32_t  now;
+
+    now = sys_Get_Time();
+    switch (_g_ble_conn_state)
+      {
+        case BLE_CONN_RESET_LOW:
+                if ((now - _g_ble_conn_ms) <= BLE_RESET_PULSE_MS)
+                   return (EAGAIN);
+                pin_High (BLE_BLUENRG_RESET);   // release RESET: BlueNRG boots
+                _g_ble_conn_ms    = now;
+                _g_ble_conn_state = BLE_CONN_BOOTING;
+                return (EAGAIN);
+
+        case BLE_CONN_BOOTING:
+                if ((now - _g_ble_conn_ms) <= BLE_BOOT_WAIT_MS)
+                   return (EAGAIN);
+                _g_ble_conn_state = BLE_CONN_IDLE;
+                BLE_PROF_END (0);
+                return (ble_bluenrg_configure());
+
+        default:
+                errno = EDEVSTART_FAILED;       // Start was not called
+                return (-1);
+      }
+}
+
 
+/*******************************************************************************
+* ble_bluenrg_configure
+*
+*            Configure the BlueNRG stack, once it has booted. Each aci_xxx()
+*            call blocks until the BlueNRG replies (or the HCI times out).
+*******************************************************************************/
+static int  ble_bluenrg_configure (void)
+{
        //--------------------------------
        //  Setup our 6 byte BLE address
        //--------------------------------
@@ -244,9 +403,11 @@ int  mnet_connect_network (int network_type, int net_addr_type, char *AP_SSID,
              Osal_MemCpy (bdaddr, SERVER_BDADDR, BDADDR_SIZE);
            }
 
+    BLE_PROF_BEGIN ("ble_addr");
     ret = aci_hal_write_config_data (CONFIG_DATA_PUBADDR_OFFSET,
                                      CONFIG_DATA_PUBADDR_LEN,  // 09/13/15 - F3_03 is dying in this on a TIMEOUT too
                                      bdaddr);    // 06/20/15 L0 Is dying this due to Timeout not seeing a reply!!!  WVD
+    BLE_PROF_END (ret);
     if (ret)
        {
 //       PRINTF ("Setting BD_ADDR failed.\n");
@@ -255,7 +416,12 @@ int  mnet_connect_network (int network_type, int net_addr_type, char *AP_SSID,
          return (-1);
        }
 
+    ble_stream_init (&_g_ble_stream, ble_stream_tx_segment, 0L,
+                     BLE_STREAM_SEG_SIZE);
+
+    BLE_PROF_BEGIN ("ble_gatt");
     ret = aci_gatt_init();        // Init the GATT (data) component of stack
+    BLE_PROF_END (ret);
     if (ret)
        {
 //       PRINTF ("GATT_Init failed.\n");
@@ -267,6 +433,7 @@ int  mnet_connect_network (int network_type, int net_addr_type, char *AP_SSID,
 
 //-------------------------------------
 // -- OR --  do these as Connect logic for client, and Listen logic for Server
+    BLE_PROF_BEGIN ("ble_gap");
     if (BLE_Role == SERVER)     // pass as either Network_Type or as Flags argument
        {                        // Setup our GAP (connection) role as the Peripheral
                                 // GATT Server that Advertises its services
@@ -278,6 +445,7 @@ int  mnet_connect_network (int network_type, int net_addr_type, char *AP_SSID,
              ret = aci_gap_init (GAP_CENTRAL_ROLE, &service_handle,
                                  &dev_name_char_handle, &appearance_char_handle);
            }
+    BLE_PROF_END (ret);
 
     if (ret != BLE_STATUS_SUCCESS)
        {
@@ -308,7 +476,9 @@ int  mnet_connect_network (int network_type, int net_addr_type, char *AP_SSID,
                 // Actual Advertisements won't flow until we hit Make_Connection()
                 // logic in main's User_Process() logic.
                 //-----------------------------------------------------------------
+         BLE_PROF_BEGIN ("ble_svc");
          ret = Add_Sample_Service();
+         BLE_PROF_END (ret);
 
 //       if (ret == BLE_STATUS_SUCCESS)
 //          PRINTF ("Service added successfully.\n");
@@ -401,11 +571,9 @@ int  mnet_connect_server (int netid, char *Server_Id, int Server_Port,
 *******************************************************************************/
 int  mnet_check_for_recv_data (int sockid, int flags)
 {
-    unsigned short   RSR_len = 0;
-
-//    RSR_len = getSn_RX_RSR (sockid);
+    ble_stream_poll();
 
-    return (RSR_len);
+    return (ble_stream_check_for_recv_data(&_g_ble_stream));
 }
 
 
@@ -496,25 +664,35 @@ int  mnet_network_get_next (char **node_name,  int *name_length, int *sec_type,
 *
 *            Read in a received block of data from a connection.
 *
+*            Hands back one complete buffer, exactly as the remote side passed
+*            it to its mnet_send(), re-assembled from the GATT segments.
+*
 *            On success, the function returns a non-negative integer of the
 *            actual length of data received.
+*            Returns EAGAIN if nothing has been received yet.
 *            On error, -1 is returned, and errno is set appropriately.
 *******************************************************************************/
 int  mnet_recv (int sockid, unsigned char *buf, int max_length, int flags)
 {
     BLE_Status = 0;
 
-       /* Ensure Rx data is present --  HACK FOR NOW  */
-//  W5200_RSR_len = getSn_RX_RSR (sockid);
-//  if (W5200_RSR_len >= max_length)
-//     { BLE_Status = recv (sockid, buf, max_length);   // read received data
-//       return (BLE_Status);
-//     }
-//   else if (W5200_RSR_len < max_length &&  W5200_RSR_len != -1)
-//            return (EAGAIN);     // full length not rcvd yet - try again later
-
-    errno = ELENGTH_MISMATCH;
-    return (-1);                // no data (or not enough) in pipe
+    ble_stream_poll();
+
+    BLE_Status = ble_stream_read (&_g_ble_stream, buf, max_length);
+    if (BLE_Status > 0)
+       return (BLE_Status);           // pass back length of received data
+
+    if (BLE_Status < 0)
+       { errno = ELENGTH_MISMATCH;    // buf is too small for next block
+         return (-1);
+       }
+
+    if ( ! connected)
+       { errno = ENOTCONN;
+         return (-1);
+       }
+
+    return (EAGAIN);                  // nothing rcvd yet - try again later
 }
 
 
@@ -523,6 +701,11 @@ int  mnet_recv (int sockid, unsigned char *buf, int max_length, int flags)
 *
 *            Send a block of data over a connection.
 *
+*            The block is queued on the GATT stream, and segmented out over
+*            as many notifications (Server) or writes (Client) as needed.
+*            If the stream's TX ring is full, this waits (running HCI events)
+*            until enough earlier data has gone out.
+*
 *            On success, the function returns a non-negative integer of the
 *            actual length of data sent.
 *            On error, -1 is returned, and errno is set appropriately.
@@ -530,13 +713,232 @@ int  mnet_recv (int sockid, unsigned char *buf, int max_length, int flags)
 int  mnet_send (int sockid, unsigned char *buf, int buf_length, int flags)
 {
     BLE_Status = 0;
-//  BLE_Status = send (sockid, buf, buf_length, (bool) WINDOWFULL_FLAG_OFF);
 
-    if (BLE_Status >= buf_length)
-       return (buf_length);       // denote it all was sent
+    while (connected)
+      {
+        BLE_Status = ble_stream_write (&_g_ble_stream, buf, buf_length);
+        if (BLE_Status > 0)
+           return (buf_length);       // denote it all was queued
+
+        if (BLE_Status < 0)
+           { errno = ELENGTH_MISMATCH;  // larger than TX ring can hold
+             return (-1);
+           }
 
-    errno = ELENGTH_MISMATCH;
-    return (-1);                  // denote error instead
+        HCI_Process();                // TX ring full: run events till it drains
+        ble_stream_poll();
+      }
+
+    errno = ENOTCONN;
+    return (-1);                      // denote error instead
+}
+
+
+/*******************************************************************************
+* BLE_Stream_xxx
+*
+*            Hooks called from the sample service's BlueNRG event callbacks
+*            (ble_sample_service.c) to drive the GATT stream.
+*******************************************************************************/
+void  BLE_Stream_Connected (uint16_t conn_handle)
+{
+    ble_stream_reset (&_g_ble_stream);
+
+    if (BLE_Role == SERVER)
+       {       // ask the central for a short connection interval
+         aci_l2cap_connection_parameter_update_request (conn_handle,
+                                       BLE_STREAM_CONN_INTERVAL_MIN,
+                                       BLE_STREAM_CONN_INTERVAL_MAX,
+                                       0, BLE_STREAM_SUPERV_TIMEOUT);
+       }
+}
+
+void  BLE_Stream_Disconnected (void)
+{
+    ble_stream_reset (&_g_ble_stream);
+}
+
+void  BLE_Stream_Rcv_Segment (uint8_t *data, int length)
+{
+    ble_stream_rx_segment (&_g_ble_stream, data, length);
+}
+
+void  BLE_Stream_Tx_Pool_Available (void)
+{
+    ble_stream_tx_pool_available (&_g_ble_stream);
+}
+
+
+/*******************************************************************************
+* BLE_Beacon_Start
+*
+*            Start broadcasting as a connectionless Beacon node. Must be a
+*            SERVER (peripheral).  Issued in place of Make_Connection().
+*
+*            readings is the App's "process image", which it updates in
+*            place.  A new page of them is advertised every rotate_ms, when
+*            the App calls BLE_Beacon_Service().
+*
+*            Returns 0 on success, -1 on error.
+*******************************************************************************/
+int  BLE_Beacon_Start (uint16_t node_id, BEACON_READING *readings,
+                       int num_readings, int adv_interval_ms, int rotate_ms)
+{
+    tBleStatus  ret;
+    uint16_t    adv_interval;
+    uint8_t     adv_data [BEACON_ADV_MAX_LEN];
+    int         adv_len;
+
+    if (BLE_Role != SERVER || adv_interval_ms < 100 || rotate_ms < adv_interval_ms)
+       return (-1);   // non-connectable adverts must be at least 100 ms apart
+
+    if (beacon_tx_init(&_g_beacon_tx, node_id, readings, num_readings) < 0)
+       return (-1);
+    _g_beacon_rotate_ms = rotate_ms;
+
+    adv_interval = (uint16_t) ((adv_interval_ms * 8) / 5);  // 0.625 ms units
+
+    hci_le_set_scan_resp_data (0, NULL);      // no Scan Responses
+         // Advertising_Event_Type, Adv_Interval_Min, Adv_Interval_Max,
+         // Address_Type, Adv_Filter_Policy, Local_Name_Length, Local_Name,
+         // Service_Uuid_Length, Service_Uuid_List, Slave_Conn_Interval_Min/Max
+         // The stack inserts the Flags AD itself.
+    ret = aci_gap_set_discoverable (ADV_NONCONN_IND, adv_interval, adv_interval,
+                                    PUBLIC_ADDR, NO_WHITE_LIST_USE,
+                                    0, NULL, 0, NULL, 0, 0);
+    if (ret != BLE_STATUS_SUCCESS)
+       return (-1);
+
+    adv_len = beacon_tx_next (&_g_beacon_tx, adv_data, sizeof(adv_data) - 3, 0);
+    if (adv_len < 0  ||  aci_gap_update_adv_data(adv_len, adv_data) != BLE_STATUS_SUCCESS)
+       return (-1);
+
+    _g_beacon_last_rotate = sys_Get_Time();
+
+    return (0);                         // denote success
+}
+
+
+/*******************************************************************************
+* BLE_Beacon_Service
+*
+*            Called from the App's main loop. Once every rotate interval,
+*            puts the next page of readings (with the App's latest values)
+*            into the advertising data.  The controller keeps sending the
+*            same advertisement in between, with no MCU involvement.
+*******************************************************************************/
+void  BLE_Beacon_Service (uint8_t digital_bits)
+{
+    uint8_t     adv_data [BEACON_ADV_MAX_LEN];
+    int         adv_len;
+    uint32_t    now;
+
+    now = sys_Get_Time();
+    if ((now - _g_beacon_last_rotate) < _g_beacon_rotate_ms)
+       return;
+    _g_beacon_last_rotate = now;
+
+    _g_beacon_tx.digital_bits = digital_bits;
+    adv_len = beacon_tx_next (&_g_beacon_tx, adv_data, sizeof(adv_data) - 3, 0);
+    if (adv_len > 0)
+       aci_gap_update_adv_data (adv_len, adv_data);
+}
+
+
+/*******************************************************************************
+* BLE_Beacon_Observe_Start
+*
+*            Start scanning for Beacon nodes. Must be a CLIENT (central).
+*            Issued in place of Make_Connection().  Decoded Beacons are
+*            folded into the App supplied table (see beacon_table_init()).
+*
+*            The controller's duplicate filter is turned off: with it on,
+*            a node's later pages would be dropped as "already seen".
+*
+*            Returns 0 on success, -1 on error.
+*******************************************************************************/
+int  BLE_Beacon_Observe_Start (BEACON_TABLE *table)
+{
+    tBleStatus  ret;
+
+    if (BLE_Role != CLIENT || table == 0L)
+       return (-1);
+
+    _g_beacon_table = table;
+
+         // Scan_Interval, Scan_Window, Own_Address_Type, Filter_Duplicates
+    ret = aci_gap_start_general_discovery_proc (BLE_BEACON_SCAN_INTERVAL,
+                                                BLE_BEACON_SCAN_WINDOW,
+                                                PUBLIC_ADDR, 0);
+    if (ret != BLE_STATUS_SUCCESS)
+       return (-1);
+
+    return (0);                         // denote success
+}
+
+
+/*******************************************************************************
+* BLE_Beacon_Adv_Report
+*
+*            Hook called from HCI_Event_CB() (ble_sample_service.c) for each
+*            advertising report received while observing.
+*******************************************************************************/
+void  BLE_Beacon_Adv_Report (uint8_t *data, int length, int rssi)
+{
+    BEACON_MSG  msg;
+
+    if (_g_beacon_table == 0L)
+       return;                          // not observing
+
+    if (beacon_decode(data, length, &msg) < 0)
+       { _g_beacon_not_beacon++;        // someone else's advert
+         return;
+       }
+
+    beacon_table_update (_g_beacon_table, &msg, rssi, sys_Get_Time());
+}
+
+
+/*******************************************************************************
+* ble_stream_tx_segment
+*
+*            Send one stream segment over the air.  The BlueNRG reports
+*            INSUFFICIENT_RESOURCES when all its TX buffers are in use.
+*******************************************************************************/
+static int  ble_stream_tx_segment (void *tx_parm, uint8_t *seg, int seg_len)
+{
+    tBleStatus  ret;
+
+    if ( ! connected)
+       return (-1);
+
+    if (BLE_Role == SERVER)
+       ret = aci_gatt_update_char_value (sampleServHandle, TXCharHandle, 0,
+                                         seg_len, seg);
+       else ret = aci_gatt_write_without_response (connection_handle,
+                                                   RX_HANDLE+1, seg_len, seg);
+
+    if (ret == BLE_STATUS_SUCCESS)
+       return (BLE_STREAM_TX_OK);
+    if (ret == BLE_STATUS_INSUFFICIENT_RESOURCES)
+       return (BLE_STREAM_TX_BUSY);   // TX pool full. Resumes on pool event
+
+    return (-1);
+}
+
+
+/*******************************************************************************
+* ble_stream_poll
+*
+*            Push out any queued TX segments.  BlueNRG firmware that does not
+*            generate TX-Pool-Available events just gets retried on each poll.
+*******************************************************************************/
+static void  ble_stream_poll (void)
+{
+#if ! defined(EVT_BLUE_GATT_TX_POOL_AVAILABLE)
+    _g_ble_stream.tx_blocked = 0;
+#endif
+    ble_stream_pump (&_g_ble_stream);
 }
 
 
@@ -190,10 +190,7 @@ void  receiveData  (uint8_t* data_buffer, uint8_t Nb_bytes)
 
   pin_Toggle (LED1);             // Green LED on Nucleos D13 pin
 
-  for(int i = 0; i < Nb_bytes; i++)
-    {
-      PRINTF ("%c", data_buffer[i]);
-    }
+  BLE_Stream_Rcv_Segment (data_buffer, Nb_bytes);  // re-assembled for mnet_recv()
 }
 
 
@@ -264,6 +261,8 @@ void  GAP_ConnectionComplete_CB (uint8_t addr[6], uint16_t handle)
   connected = TRUE;
   connection_handle = handle;
 
+  BLE_Stream_Connected (handle);          // reset stream, ask for short interval
+
   PRINTF ("Connected to device:");
   for (int i = 5; i > 0; i--)
     {
@@ -285,6 +284,8 @@ void  GAP_DisconnectionComplete_CB (void)
 
   connected = FALSE;
 
+  BLE_Stream_Disconnected();
+
   PRINTF ("Disconnected\n");
 
        /* Make the device connectable again. */
@@ -369,6 +370,16 @@ void  HCI_Event_CB (void *pckt)
                   GAP_ConnectionComplete_CB (cc->peer_bdaddr, cc->handle);
                  }
                  break;
+
+        case EVT_LE_ADVERTISING_REPORT:
+                 {         // Beacon observer. BlueNRG sends 1 report per event,
+                           // and the RSSI byte follows the adv data
+                  le_advertising_info *pr = (void *) (evt->data + 1);
+
+                  BLE_Beacon_Adv_Report (pr->data_RSSI, pr->data_length,
+                                         (int8_t) pr->data_RSSI[pr->data_length]);
+                 }
+                 break;
        }
     }
     break;
@@ -400,6 +411,14 @@ void  HCI_Event_CB (void *pckt)
           GATT_Notification_CB (evt->attr_handle, evt->data_length - 2, evt->attr_value);
         }
         break;
+
+#if defined(EVT_BLUE_GATT_TX_POOL_AVAILABLE)
+      case EVT_BLUE_GATT_TX_POOL_AVAILABLE:
+        {         // BlueNRG freed up TX buffers: resume the GATT stream
+          BLE_Stream_Tx_Pool_Available();
+        }
+        break;
+#endif
       }
     }
     break;
@@ -0,0 +1,340 @@
+/********1*********2*********3*********4*********5*********6*********7**********
+*
+*                              ble_stream.c
+*
+*
+* BLE GATT Stream transport: segments arbitrary length SDUs across GATT
+* notifications/writes with TX pool flow control, and re-assembles them on
+* the receive side.  See ble_stream.h for the segment layout.
+*
+* All calls are made from main loop level: the BlueNRG HCI_Process() call
+* dispatches the RX and TX-Pool-Available events, so no locking is needed.
+*
+* History:
+* --------
+*  10/19/26 - Created.
+*  10/19/26 - Use ring_buf.h for the TX / RX rings (was local ring_copy_xx).
+*
+* -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*******************************************************************************/
+
+#include "ble_stream.h"
+
+#include <string.h>
+
+RING_SIZE_CHECK (ble_stream_tx, BLE_STREAM_TX_RING_SIZE);
+RING_SIZE_CHECK (ble_stream_rx, BLE_STREAM_RX_RING_SIZE);
+
+#define  RX_IDLE          0             // waiting for a START segment
+#define  RX_ASSEMBLING    1             // filling in an SDU
+#define  RX_DISCARDING    2             // dropping rest of a bad SDU
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+
+
+/*******************************************************************************
+* ble_stream_init
+*
+*            Setup a stream.  seg_size is the max # bytes per GATT
+*            notification/write  (ATT_MTU - 3).
+*******************************************************************************/
+void  ble_stream_init (BLE_STREAM *strm, BLE_STREAM_TX_FN tx_fn, void *tx_parm,
+                       int seg_size)
+{
+    if (seg_size < 4 || seg_size > BLE_STREAM_MAX_SEG_SIZE)
+       seg_size = BLE_STREAM_SEG_SIZE;
+
+    memset (strm, 0, sizeof(BLE_STREAM));
+    strm->tx_fn    = tx_fn;
+    strm->tx_parm  = tx_parm;
+    strm->seg_size = (uint8_t) seg_size;
+    ring_buf_init (&strm->tx_q, strm->tx_ring, BLE_STREAM_TX_RING_SIZE);
+    ring_buf_init (&strm->rx_q, strm->rx_ring, BLE_STREAM_RX_RING_SIZE);
+}
+
+
+/*******************************************************************************
+* ble_stream_reset
+*
+*            Flush everything queued in both directions, and restart the
+*            sequence #s.  Called on every connect and disconnect.
+*******************************************************************************/
+void  ble_stream_reset (BLE_STREAM *strm)
+{
+    ring_buf_reset (&strm->tx_q);
+    strm->tx_sdu_left = 0;
+    strm->tx_seq      = 0;
+    strm->tx_blocked  = 0;
+
+    ring_buf_reset (&strm->rx_q);
+    strm->rx_sdu_len  = 0;
+    strm->rx_sdu_got  = 0;
+    strm->rx_seq      = 0;
+    strm->rx_state    = RX_IDLE;
+}
+
+
+/*******************************************************************************
+* ble_stream_write
+*
+*            Queue an SDU for sending, and start pushing it out.
+*
+*            Returns buf_length if it was queued, 0 if the TX ring does not
+*            have room for it yet (call again after ble_stream_pump()), or
+*            -1 if it is larger than the TX ring can ever hold.
+*******************************************************************************/
+int  ble_stream_write (BLE_STREAM *strm, uint8_t *buf, int buf_length)
+{
+    uint8_t    len_hdr [2];
+
+    if (buf_length < 1  ||  buf_length > BLE_STREAM_TX_RING_SIZE - 2)
+       return (-1);
+
+    if (ring_buf_space (&strm->tx_q) < buf_length + 2)
+       {
+         ble_stream_pump (strm);        // try to make some room
+         return (0);
+       }
+
+    len_hdr[0] = (uint8_t) buf_length;
+    len_hdr[1] = (uint8_t) (buf_length >> 8);
+    ring_buf_poke (&strm->tx_q, 0, len_hdr, 2);
+    ring_buf_poke (&strm->tx_q, 2, buf, buf_length);
+    ring_buf_write_commit (&strm->tx_q, buf_length + 2);
+
+    ble_stream_pump (strm);
+
+    return (buf_length);
+}
+
+
+/*******************************************************************************
+* ble_stream_pump
+*
+*            Hand as many segments to the radio as it will take.  Stops when
+*            the TX ring is empty, or the radio reports it is out of TX
+*            buffers (resumed by ble_stream_tx_pool_available()).
+*
+*            Returns # segments sent, or < 0 if the radio reported an error.
+*******************************************************************************/
+int  ble_stream_pump (BLE_STREAM *strm)
+{
+    uint8_t    seg [BLE_STREAM_MAX_SEG_SIZE];
+    uint8_t    len_hdr [2];
+    uint16_t   sdu_left;
+    int        hdr_len;
+    int        data_len;
+    int        sent;
+    int        rc;
+
+    sent = 0;
+    while (strm->tx_blocked == 0  &&  ! ring_buf_is_empty (&strm->tx_q))
+      {
+        sdu_left = strm->tx_sdu_left;
+        if (sdu_left == 0)
+           {       // next segment starts a new SDU: pick up its length
+             ring_buf_peek (&strm->tx_q, 0, len_hdr, 2);
+             sdu_left = len_hdr[0] | (len_hdr[1] << 8);
+             seg[0]   = BLE_STREAM_START | (strm->tx_seq & BLE_STREAM_SEQ_MASK);
+             seg[1]   = len_hdr[0];
+             seg[2]   = len_hdr[1];
+             hdr_len  = 3;
+           }
+          else {
+                 seg[0]  = strm->tx_seq & BLE_STREAM_SEQ_MASK;
+                 hdr_len = 1;
+               }
+
+        data_len = strm->seg_size - hdr_len;
+        if (data_len > sdu_left)
+           data_len = sdu_left;
+        ring_buf_peek (&strm->tx_q, (hdr_len == 3 ? 2 : 0),
+                       &seg[hdr_len], data_len);
+
+        rc = (strm->tx_fn) (strm->tx_parm, seg, hdr_len + data_len);
+        if (rc == BLE_STREAM_TX_BUSY)
+           {       // radio TX pool is full. Retry same segment later.
+             strm->tx_blocked = 1;
+             strm->stats.tx_pool_waits++;
+             break;
+           }
+        if (rc < 0)
+           return (rc);
+
+               // segment is on its way. Consume it from the ring.
+        ring_buf_read_commit (&strm->tx_q, (hdr_len == 3 ? 2 : 0) + data_len);
+        strm->tx_sdu_left = sdu_left - (uint16_t) data_len;
+        strm->tx_seq++;
+        strm->stats.tx_bytes += data_len;
+        strm->stats.tx_segments++;
+        sent++;
+      }
+
+    return (sent);
+}
+
+
+/*******************************************************************************
+* ble_stream_tx_pool_available
+*
+*            The radio freed up TX buffers  (TX-Pool-Available event).
+*******************************************************************************/
+void  ble_stream_tx_pool_available (BLE_STREAM *strm)
+{
+    strm->tx_blocked = 0;
+    ble_stream_pump (strm);
+}
+
+
+/*******************************************************************************
+* ble_stream_rx_segment
+*
+*            A segment arrived (GATT notification or attribute write).
+*            Re-assemble it into the RX ring.
+*******************************************************************************/
+void  ble_stream_rx_segment (BLE_STREAM *strm, uint8_t *seg, int seg_len)
+{
+    uint8_t    len_hdr [2];
+    int        data_len;
+
+    if (seg_len < 1)
+       return;
+
+    strm->stats.rx_segments++;
+
+    if ((seg[0] & BLE_STREAM_SEQ_MASK) != strm->rx_seq)
+       {       // lost a segment. Whatever SDU it was part of is gone.
+         if (strm->rx_state == RX_ASSEMBLING)
+            strm->stats.rx_seq_errors++;
+         strm->rx_state = RX_DISCARDING;
+       }
+    strm->rx_seq = (seg[0] + 1) & BLE_STREAM_SEQ_MASK;
+
+    if (seg[0] & BLE_STREAM_START)
+       {
+         if (strm->rx_state == RX_ASSEMBLING)
+            strm->stats.rx_seq_errors++;   // previous SDU was cut short
+         if (seg_len < 3)
+            { strm->rx_state = RX_DISCARDING;
+              return;
+            }
+         strm->rx_sdu_len = seg[1] | (seg[2] << 8);
+         strm->rx_sdu_got = 0;
+         if (strm->rx_sdu_len == 0
+            ||  ring_buf_space (&strm->rx_q) < strm->rx_sdu_len + 2)
+            { strm->stats.rx_drops++;      // App is not keeping up
+              strm->rx_state = RX_DISCARDING;
+              return;
+            }
+         strm->rx_state = RX_ASSEMBLING;
+         seg     += 3;
+         seg_len -= 3;
+       }
+      else {
+             if (strm->rx_state != RX_ASSEMBLING)
+                return;                 // tail end of a dropped SDU
+             seg++;
+             seg_len--;
+           }
+
+    data_len = seg_len;
+    if (data_len > strm->rx_sdu_len - strm->rx_sdu_got)
+       { strm->stats.rx_seq_errors++;   // more data than the SDU length said
+         strm->rx_state = RX_DISCARDING;
+         return;
+       }
+       // assemble after the (not yet written) length hdr, past the head
+    ring_buf_poke (&strm->rx_q, 2 + strm->rx_sdu_got, seg, data_len);
+    strm->rx_sdu_got += (uint16_t) data_len;
+
+    if (strm->rx_sdu_got == strm->rx_sdu_len)
+       {       // SDU is complete. Write its length, and publish it.
+         len_hdr[0] = (uint8_t) strm->rx_sdu_len;
+         len_hdr[1] = (uint8_t) (strm->rx_sdu_len >> 8);
+         ring_buf_poke (&strm->rx_q, 0, len_hdr, 2);
+         ring_buf_write_commit (&strm->rx_q, strm->rx_sdu_len + 2);
+         strm->stats.rx_bytes += strm->rx_sdu_len;
+         strm->rx_state = RX_IDLE;
+       }
+}
+
+
+/*******************************************************************************
+* ble_stream_read
+*
+*            Pass back the next complete SDU.
+*
+*            Returns its length, 0 if none is waiting, or -1 if max_length is
+*            too small to hold it  (the SDU is left queued).
+*******************************************************************************/
+int  ble_stream_read (BLE_STREAM *strm, uint8_t *buf, int max_length)
+{
+    int    sdu_len;
+
+    sdu_len = ble_stream_check_for_recv_data (strm);
+    if (sdu_len == 0)
+       return (0);
+    if (sdu_len > max_length)
+       return (-1);
+
+    ring_buf_peek (&strm->rx_q, 2, buf, sdu_len);
+    ring_buf_read_commit (&strm->rx_q, sdu_len + 2);
+
+    return (sdu_len);
+}
+
+
+/*******************************************************************************
+* ble_stream_check_for_recv_data
+*
+*            Returns the length of the next complete SDU, or 0 if none.
+*******************************************************************************/
+int  ble_stream_check_for_recv_data (BLE_STREAM *strm)
+{
+    uint8_t    len_hdr [2];
+
+    if (ring_buf_peek (&strm->rx_q, 0, len_hdr, 2) != 2)
+       return (0);
+
+    return (len_hdr[0] | (len_hdr[1] << 8));
+}
+
+
+/*******************************************************************************
+* ble_stream_tx_pending
+*
+*            Returns # bytes (including SDU length hdrs) still waiting to go.
+*******************************************************************************/
+int  ble_stream_tx_pending (BLE_STREAM *strm)
+{
+    return (ring_buf_count (&strm->tx_q));
+}
+
+
+/******************************************************************************/
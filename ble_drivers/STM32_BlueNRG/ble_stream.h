@@ -0,0 +1,143 @@
+/********1*********2*********3*********4*********5*********6*********7**********
+*
+*                              ble_stream.h
+*
+*
+* Definitions for the BLE GATT Stream transport, that sits underneath
+* mnet_send() / mnet_recv() in ble_bluenrg_driver.c.
+*
+* An arbitrary length buffer (SDU) handed to mnet_send() is queued into a TX
+* ring, then cut into ATT sized segments, which go out as back to back GATT
+* notifications (Server) or Write-Without-Response (Client). As many segments
+* as the BlueNRG has TX buffers for are queued at once, so several go out in
+* each connection interval. When the BlueNRG runs out of buffers, sending
+* pauses until its TX-Pool-Available event arrives.
+*
+* The receive side re-assembles the segments back into whole SDUs in an RX
+* ring, which mnet_recv() then hands out one SDU at a time.
+*
+* Segment layout  (seg_size = ATT_MTU - 3 = 20 bytes by default):
+*
+*      byte 0     header:  0x80 = first segment of SDU | 7 bit sequence #
+*      byte 1-2   SDU length, little endian      (first segment only)
+*      byte 3..   SDU data                       (byte 1.. on later segments)
+*
+* The sequence # runs across all segments, so a lost segment is detected,
+* and the SDU it belonged to is dropped, rather than delivered corrupted.
+*
+* This module has no BlueNRG dependencies: the driver supplies the "send one
+* segment" routine, so the segmenting/re-assembly/flow control logic can be
+* exercised on a host against a simulated HCI peer.
+*
+* History:
+* --------
+*  10/19/26 - Created.
+*  10/19/26 - TX / RX rings are now ring_buf.h RING_BUFs.
+*
+* -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*******************************************************************************/
+
+#ifndef __BLE_STREAM_H__
+#define __BLE_STREAM_H__
+
+#include "user_api.h"                 // MCU and Board specific parms/pins/etc
+#include "ring_buf.h"
+
+#define  BLE_STREAM_SEG_SIZE        20     /* default ATT MTU 23 - 3 byte ATT hdr */
+#define  BLE_STREAM_MAX_SEG_SIZE   244     /* largest LE data length ATT payload  */
+#define  BLE_STREAM_START         0x80     /* segment hdr: first segment of SDU   */
+#define  BLE_STREAM_SEQ_MASK      0x7F
+
+#ifndef BLE_STREAM_TX_RING_SIZE
+#define  BLE_STREAM_TX_RING_SIZE   512     /* bytes. Must be a power of 2         */
+#endif
+#ifndef BLE_STREAM_RX_RING_SIZE
+#define  BLE_STREAM_RX_RING_SIZE   512     /* bytes. Must be a power of 2         */
+#endif
+
+            // Return codes from the BLE_STREAM_TX_FN segment send routine
+#define  BLE_STREAM_TX_OK            0     /* segment was queued on the radio     */
+#define  BLE_STREAM_TX_BUSY          1     /* no TX buffers: wait for pool event  */
+
+
+        // Driver supplied routine that sends one segment over the air.
+        // Returns BLE_STREAM_TX_OK, BLE_STREAM_TX_BUSY, or < 0 on error.
+typedef int (*BLE_STREAM_TX_FN) (void *tx_parm, uint8_t *seg, int seg_len);
+
+
+typedef struct ble_stream_stats_def     /* BLE Stream statistics */
+   {
+       uint32_t   tx_bytes;             // # SDU bytes sent
+       uint32_t   tx_segments;          // # segments handed to the radio
+       uint32_t   tx_pool_waits;        // # times radio ran out of TX buffers
+       uint32_t   rx_bytes;             // # SDU bytes delivered to RX ring
+       uint32_t   rx_segments;          // # segments received
+       uint32_t   rx_drops;             // # SDUs dropped: RX ring full
+       uint32_t   rx_seq_errors;        // # SDUs dropped: lost/bad segment
+   } BLE_STREAM_STATS;
+
+
+typedef struct ble_stream_def           /* BLE Stream control block */
+   {
+       BLE_STREAM_TX_FN  tx_fn;         // sends one segment over the air
+       void       *tx_parm;
+       uint8_t    seg_size;             // max bytes per segment
+
+                  //--- TX side:  ring of queued [len16][data] SDUs ---
+       uint8_t    tx_ring [BLE_STREAM_TX_RING_SIZE];
+       RING_BUF   tx_q;                 // tail = next byte to send
+       uint16_t   tx_sdu_left;          // bytes left in SDU being segmented
+       uint8_t    tx_seq;               // next TX segment sequence #
+       uint8_t    tx_blocked;           // 1 = waiting for TX pool available
+
+                  //--- RX side:  ring of re-assembled [len16][data] SDUs ---
+       uint8_t    rx_ring [BLE_STREAM_RX_RING_SIZE];
+       RING_BUF   rx_q;                 // head = end of last whole SDU
+       uint16_t   rx_sdu_len;           // length of SDU being re-assembled
+       uint16_t   rx_sdu_got;           // # bytes of it received so far
+       uint8_t    rx_seq;               // next expected RX sequence #
+       uint8_t    rx_state;             // idle / assembling / discarding
+
+       BLE_STREAM_STATS  stats;
+   } BLE_STREAM;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+void  ble_stream_init (BLE_STREAM *strm, BLE_STREAM_TX_FN tx_fn, void *tx_parm,
+                       int seg_size);
+void  ble_stream_reset (BLE_STREAM *strm);
+int   ble_stream_write (BLE_STREAM *strm, uint8_t *buf, int buf_length);
+int   ble_stream_pump (BLE_STREAM *strm);
+void  ble_stream_tx_pool_available (BLE_STREAM *strm);
+void  ble_stream_rx_segment (BLE_STREAM *strm, uint8_t *seg, int seg_len);
+int   ble_stream_read (BLE_STREAM *strm, uint8_t *buf, int max_length);
+int   ble_stream_check_for_recv_data (BLE_STREAM *strm);
+int   ble_stream_tx_pending (BLE_STREAM *strm);
+
+#endif                          //  __BLE_STREAM_H__
+
+/******************************************************************************/
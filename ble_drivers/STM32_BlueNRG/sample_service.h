@@ -62,6 +62,7 @@
 #include "debug.h"
 
 #include "role_type.h"
+#include "ble_beacon.h"
 
 /**
 * @brief Handle of TX Characteristic on the Server. The handle should be
@@ -88,6 +89,24 @@ void GATT_Notification_CB(uint16_t attr_handle, uint8_t attr_len,
                           uint8_t *attr_value);
 void HCI_Event_CB(void *pckt);
 
+       /* GATT stream hooks, in ble_bluenrg_driver.c */
+void BLE_Stream_Connected(uint16_t conn_handle);
+void BLE_Stream_Disconnected(void);
+void BLE_Stream_Rcv_Segment(uint8_t *data, int length);
+void BLE_Stream_Tx_Pool_Available(void);
+
+       /* non-blocking mnet_connect_network(), in ble_bluenrg_driver.c */
+int  BLE_Connect_Network_Start(int network_type, int net_addr_type, char *AP_SSID,
+                               char *AP_PWD, int AP_security, int net_flags);
+int  BLE_Connect_Network_Poll(void);
+
+       /* connectionless Beacon mode, in ble_bluenrg_driver.c */
+int  BLE_Beacon_Start(uint16_t node_id, BEACON_READING *readings,
+                      int num_readings, int adv_interval_ms, int rotate_ms);
+void BLE_Beacon_Service(uint8_t digital_bits);
+int  BLE_Beacon_Observe_Start(BEACON_TABLE *table);
+void BLE_Beacon_Adv_Report(uint8_t *data, int length, int rssi);
+
 #ifdef __cplusplus
 }
 #endif
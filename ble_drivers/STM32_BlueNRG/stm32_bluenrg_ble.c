@@ -103,10 +103,10 @@ void  BlueNRG_GPIO_Init (SPI_HandleTypeDef* hspi)
          //---------------------------------------------------
          // Configure IRQ pin:  PA0 - Arduino A0 on Nucleo
          //---------------------------------------------------
-    pin_Config_IRQ_Pin (BLE_BLUENRG_IRQ_PIN, GPIO_RUPT_MODE_RISING, 0, BLE_BLUENRG_IRQn, 4);
+    pin_Config_IRQ_Pin (BLE_BLUENRG_IRQ_PIN, GPIO_RUPT_MODE_RISING, 0, BLE_BLUENRG_IRQn, IRQ_PRIO_COMMS);
 
          // and setup associated NVIC EXTI entries
-    HAL_NVIC_SetPriority (BLE_BLUENRG_IRQn, 4, 0);
+    HAL_NVIC_SetPriority (BLE_BLUENRG_IRQn, IRQ_PRIO_COMMS, 0);
     HAL_NVIC_EnableIRQ (BLE_BLUENRG_IRQn);
 
 
@@ -182,7 +182,7 @@ void  BlueNRG_GPIO_Init (SPI_HandleTypeDef* hspi)
 
  #if L0_TESTING_MOVED     // 06/20/15
         /* Configure the NVIC for SPI */
-    HAL_NVIC_SetPriority (BNRG_SPI_EXTI_IRQn, 4, 0);
+    HAL_NVIC_SetPriority (BNRG_SPI_EXTI_IRQn, IRQ_PRIO_COMMS, 0);
     HAL_NVIC_EnableIRQ (BNRG_SPI_EXTI_IRQn);
  #endif
    }
@@ -298,8 +298,6 @@ int32_t  BlueNRG_SPI_Read_All (SPI_HandleTypeDef *hspi, uint8_t *buffer,
 {
   uint16_t          byte_count;
   uint8_t           len = 0;
-  uint8_t           char_ff = 0xff;
-  volatile uint8_t  read_char;
 
   uint8_t   header_master [HEADER_SIZE] = { 0x0b, 0x00, 0x00, 0x00, 0x00 };
   uint8_t   header_slave [HEADER_SIZE];
@@ -326,16 +324,14 @@ int32_t  BlueNRG_SPI_Read_All (SPI_HandleTypeDef *hspi, uint8_t *buffer,
               byte_count = buff_size;
             }
 
-         for (len = 0; len < byte_count; len++)
-           {
-////         HAL_SPI_TransmitReceive (hspi, &char_ff, (uint8_t*) &read_char,
-////                                  1, TIMEOUT_DURATION);
-             spi_Write_Read (BLE_BLUENRG_SPI_ID,
-                             &char_ff, (uint8_t*) &read_char,
-                             1, 0);
-
-             buffer[len] = read_char;
-           }
+             // 10/19/26 - read the whole event in one SPI transfer, straight
+             // into the caller's buffer (was 1 spi_Write_Read() call and 1
+             // copy per byte). The buffer is pre-filled with the 0xFF dummy
+             // bytes to clock out: each byte is sent before its reply is
+             // stored over it, so the same buffer serves for both.
+         memset (buffer, 0xFF, byte_count);
+         spi_Write_Read (BLE_BLUENRG_SPI_ID, buffer, buffer, byte_count, 0);
+         len = (uint8_t) byte_count;
        }
     }
 
@@ -18,6 +18,7 @@
 //
 //  History:
 //    09/24/15 - Verified tables. Duq
+//    10/19/26 - NVIC priority from the IRQ_PRIO_COMMS class.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -450,7 +451,7 @@ void  board_uart_enable_nvic_irq (int module_id)
 #endif
      }
 
-    HAL_NVIC_SetPriority (nvic_irq, 1, 1);
+    HAL_NVIC_SetPriority (nvic_irq, IRQ_PRIO_COMMS, 0);
     HAL_NVIC_EnableIRQ (nvic_irq);
 }
 
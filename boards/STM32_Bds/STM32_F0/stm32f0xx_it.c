@@ -102,6 +102,9 @@ void SVC_Handler(void)
   */
 void PendSV_Handler(void)
 {
+#if defined(USES_IRQ_BOTTOM_HALF)
+    board_bh_dispatch();                   // run deferred ISR callback work
+#endif
 }
 
 /******************************************************************************
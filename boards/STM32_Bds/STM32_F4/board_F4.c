@@ -740,7 +740,7 @@ void  board_uart_enable_nvic_irq (int module_id)
              break;
      }
 
-    HAL_NVIC_SetPriority (nvic_irq, 1, 1);
+    HAL_NVIC_SetPriority (nvic_irq, IRQ_PRIO_COMMS, 0);
     HAL_NVIC_EnableIRQ (nvic_irq);
 }
 
@@ -16,6 +16,7 @@
 //
 //  History:
 //    08/16/15 - Verified tables. Duq
+//    10/19/26 - NVIC priority from the IRQ_PRIO_COMMS class.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -420,7 +421,7 @@ void  board_spi_enable_nvic_irq (int module_id)
                nvic_irq = SPI3_IRQn;
        else nvic_irq = SPI4_IRQn;
 
-    HAL_NVIC_SetPriority (nvic_irq, 1, 1);
+    HAL_NVIC_SetPriority (nvic_irq, IRQ_PRIO_COMMS, 0);
     HAL_NVIC_EnableIRQ (nvic_irq);
 }
 
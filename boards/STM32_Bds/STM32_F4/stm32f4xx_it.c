@@ -170,6 +170,9 @@ void DebugMon_Handler(void)
   */
 void PendSV_Handler(void)
 {
+#if defined(USES_IRQ_BOTTOM_HALF)
+    board_bh_dispatch();                   // run deferred ISR callback work
+#endif
 }
 
 
@@ -16,6 +16,7 @@
 //
 //  History:
 //    10/14/15 - Verified tables. Duq
+//    10/19/26 - NVIC priority from the IRQ_PRIO_COMMS class.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -394,12 +395,12 @@ void  board_i2c_enable_nvic_irq (int module_id)
              nvic_errq = I2C2_ER_IRQn;
            }
 
-         /* Enable and set I2C _NORMAL_ Interrupt to the highest priority */
-    HAL_NVIC_SetPriority (nvic_irq, 1, 1);
+         /* Enable and set I2C _NORMAL_ Interrupt to the COMMS class priority */
+    HAL_NVIC_SetPriority (nvic_irq, IRQ_PRIO_COMMS, 0);
     HAL_NVIC_EnableIRQ (nvic_irq);
 
-         /* Enable and set I2C _ERROR_ Interrupt to the highest priority */
-    HAL_NVIC_SetPriority (nvic_errq, 0, 0);   // this is mainly a F4 thing
+         /* Enable and set I2C _ERROR_ Interrupt to the COMMS class priority */
+    HAL_NVIC_SetPriority (nvic_errq, IRQ_PRIO_COMMS, 0); // this is mainly a F4 thing
     HAL_NVIC_EnableIRQ (nvic_errq);
 }
 
@@ -12,6 +12,7 @@
 //
 //  History:
 //    08/25/15 - Verified tables. 16 physical channels on ADC1/2/3.  Duq
+//    10/19/26 - NVIC priority from the IRQ_PRIO_HARD_RT class.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -494,7 +495,7 @@ void  HAL_ADC_MspInit (ADC_HandleTypeDef *hadc)
   __HAL_LINKDMA(hadc, DMA_Handle, DmaHandle);
 
       /* NVIC configuration for DMA Input data interrupt */
-  HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 1, 0);
+  HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, IRQ_PRIO_HARD_RT, 0);
   HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
 }
 
@@ -9,6 +9,16 @@
 *  History:
 *    03/10/15 - Simplify file includes. Duquaine
 *    08/17/15 - Refactored common sys/gpio routines to simplify maintenance. Duq
+*    10/19/26 - Added 64-bit monotonic timestamp service (USES_TIMESTAMP).
+*    10/19/26 - Added tickless low power idle (USES_TICKLESS_IDLE), and made
+*               VTIMER expiration checks safe across the 49 day ms wrap.
+*    10/19/26 - board_init() sets the interrupt priority plan.
+*    10/19/26 - Added boot time profiling of board_init() (USES_BOOT_PROFILE),
+*               and board_get_reset_cause() for warm boot detection.
+*    10/19/26 - STOP wakeup restores the board_init() clock options (HSE),
+*               and moves the DWT timestamp on by the time spent in STOP.
+*    10/19/26 - board_irq_plan_init() moved here from board_STM32_irq.c, so
+*               that file is only needed for bottom halves / ISR stats.
 * -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 *
 * The MIT License (MIT)
@@ -41,6 +51,13 @@
 #include "user_api.h"         // pull in high level User API defs
 #include "boarddef.h"         // pull in MCU platform defs and board_xx() protos
 
+#if defined(USES_TIMESTAMP)
+#include "timestamp.h"        // 64-bit timestamp engine
+#endif
+#if defined(USES_BOOT_PROFILE)
+#include "boot_prof.h"        // boot time profiler
+#endif
+
 
 /*******************************************************************************
 *     Pull in the appropriate board_xxx.c file, based on MCU device type
@@ -148,12 +165,30 @@
     int8_t               IntIsMasked;
 
     uint32_t   _g_SysClk_Ticks = MCU_CLOCK_SPEED; // Global to hold clock frequency (ticks/sec)
+    int        _g_SysClk_option_flags = 0;     // board_init() clock options (e.g. HSE)
 
     uint32_t   _g_systick_millisecs = 0; // Global to how many 1 ms ticks have
                                          // accumulated startup (poor mans TOD)
 
     char       _g_vtimers_active    = 0; // Optional VTIMER support
 
+#if defined(USES_TIMESTAMP)
+                    //--------------------------------------------------------
+                    // Cortex-M3/M4/M7 use the DWT cycle counter, extended to
+                    // 64 bits by the SysTick ISR. Cortex-M0/M0+ (F0/L0) have
+                    // no DWT, so they combine a 64-bit millisecond count with
+                    // the current SysTick down-counter value.
+                    //--------------------------------------------------------
+#if defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+#define  TSTAMP_USES_DWT     1
+#else
+#define  TSTAMP_USES_DWT     0
+#endif
+    TSTAMP_CLOCK  _g_tstamp_clock;          // timestamp clock state
+    char          _g_tstamp_active = 0;     // 1 = board_timestamp_init() done
+    volatile uint32_t  _g_systick_millisecs_hi = 0; // upper 32 bits of ms count
+#endif
+
 
     long       Systick_Frequency  = 100;    // 10 ms ticks
     long       SysTick_Reload_Val = 0;      // actual TMR reload value
@@ -222,6 +257,13 @@ void  board_init (long mcu_clock_rate, int option_flags)
 {
     uint32_t  SysFreq;
     uint32_t  SysCoreClk;
+#if defined(USES_BOOT_PROFILE)
+    int       bp_id;
+
+    boot_prof_init();               // boot time 0 = now
+#endif
+
+    _g_SysClk_option_flags = option_flags;  // re-used on clock restores (STOP)
 
        //-----------------------------------------------------------------------
        // Reset all peripherals, Initialize Flash interface and Systick.
@@ -248,18 +290,36 @@ void  board_init (long mcu_clock_rate, int option_flags)
        //--------------------------------------
        // Invoke MCU dependent CPU clock setup
        //--------------------------------------
+#if defined(USES_BOOT_PROFILE)
+    bp_id = boot_prof_begin ("clk");
+#endif
     if (mcu_clock_rate != 0)
        board_system_clock_config (mcu_clock_rate,option_flags); // user has specified MCU speed
        else board_system_clock_config (MCU_CLOCK_SPEED,option_flags);  // use default MCU speed
     SysFreq    = HAL_RCC_GetSysClockFreq();        // ensure we now have valid clocks
     SysCoreClk = HAL_RCC_GetHCLKFreq();
+#if defined(USES_BOOT_PROFILE)
+    boot_prof_clock_changed();
+    boot_prof_end (bp_id, 0);
+    bp_id = boot_prof_begin ("hal");
+#endif
 
     HAL_Init();                     // Invoke ST's HAL startup logic
 
+#if defined(USES_BOOT_PROFILE)
+    boot_prof_end (bp_id, 0);
+#endif
 #else
 
+#if defined(USES_BOOT_PROFILE)
+    bp_id = boot_prof_begin ("hal");
+#endif
     HAL_Init();                     // Invoke ST's HAL startup logic
                                     // Note that it always enables SYSTICK timer.
+#if defined(USES_BOOT_PROFILE)
+    boot_prof_end (bp_id, 0);
+    bp_id = boot_prof_begin ("clk");
+#endif
 
        //--------------------------------------
        // Invoke MCU dependent CPU clock setup
@@ -271,12 +331,110 @@ void  board_init (long mcu_clock_rate, int option_flags)
                                   option_flags);  // use default MCU speed
 
     __enable_irq();                 // Ensure interrupts enabled for SysTick
+#if defined(USES_BOOT_PROFILE)
+    boot_prof_clock_changed();      // clock config updated SystemCoreClock
+    boot_prof_end (bp_id, 0);
 #endif
+#endif
+
+       //--------------------------------------------------------------
+       // Set the interrupt priority plan (grouping, SysTick, PendSV).
+       // Must follow the clock config, which resets SysTick's priority.
+       //--------------------------------------------------------------
+    board_irq_plan_init();
 
        //------------------------------------------
        // Invoke MCU dependent GPIO clock startup
        //------------------------------------------
+#if defined(USES_BOOT_PROFILE)
+    bp_id = boot_prof_begin ("gpio");
+#endif
     board_gpio_init();
+#if defined(USES_BOOT_PROFILE)
+    boot_prof_end (bp_id, 0);
+#endif
+}
+
+
+//******************************************************************************
+//  board_irq_plan_init
+//
+//            Set the NVIC grouping and the core (SysTick / PendSV) interrupt
+//            priorities of the interrupt plan (IRQ_PRIO_xxx in boarddef.h).
+//            Called by board_init() after the clock config, since HAL_Init()
+//            and HAL_RCC_ClockConfig() both reset the SysTick priority to
+//            TICK_INT_PRIORITY.  Safe to call again (e.g. after STOP mode).
+//******************************************************************************
+
+void  board_irq_plan_init (void)
+{
+#if defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+    HAL_NVIC_SetPriorityGrouping (NVIC_PRIORITYGROUP_4); // all pre-emption bits
+#endif
+    HAL_NVIC_SetPriority (SysTick_IRQn, IRQ_PRIO_HOUSEKEEP, 0);
+    HAL_NVIC_SetPriority (PendSV_IRQn, IRQ_PRIO_BOTTOM_HALF, 0);
+
+#if defined(USES_IRQ_STATS) && defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+       //---------------------------------------------------------------
+       // DWT cycle counter for the ISR timing stats (board_STM32_irq.c)
+       //---------------------------------------------------------------
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(STM32F746xx) || defined(STM32F746NGHx)
+    DWT->LAR = 0xC5ACCE55;                 // M7: unlock DWT for writes
+#endif
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+
+//******************************************************************************
+//  board_get_reset_cause
+//
+//            Return what caused the last reset, as RESET_CAUSE_xxx flags.
+//            The RCC / PWR flags are read and cleared on the first call, and
+//            the result is kept, so every later call sees the same value.
+//
+//            Note: most STM32s also set the pin reset flag on a power on,
+//            brown out, software or watchdog reset (they drive NRST low),
+//            so test the other flags first.
+//******************************************************************************
+
+uint32_t  board_get_reset_cause (void)
+{
+    static uint32_t  reset_cause = 0;
+    static char      reset_cause_read = 0;
+
+    if (reset_cause_read)
+       return (reset_cause);
+
+#if defined(RCC_FLAG_PORRST)
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_PORRST))
+       reset_cause |= RESET_CAUSE_POWER_ON;
+#endif
+#if defined(RCC_FLAG_BORRST)
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_BORRST))
+       reset_cause |= RESET_CAUSE_POWER_ON;
+#endif
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_PINRST))
+       reset_cause |= RESET_CAUSE_PIN;
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_SFTRST))
+       reset_cause |= RESET_CAUSE_SOFTWARE;
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_IWDGRST) || __HAL_RCC_GET_FLAG(RCC_FLAG_WWDGRST))
+       reset_cause |= RESET_CAUSE_WATCHDOG;
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_LPWRRST))
+       reset_cause |= RESET_CAUSE_LOW_POWER;
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+
+#if defined(PWR_FLAG_SB)
+    __HAL_RCC_PWR_CLK_ENABLE();
+    if (__HAL_PWR_GET_FLAG(PWR_FLAG_SB))
+       { reset_cause |= RESET_CAUSE_STANDBY;
+         __HAL_PWR_CLEAR_FLAG (PWR_FLAG_SB);
+       }
+#endif
+
+    reset_cause_read = 1;
+    return (reset_cause);
 }
 
 
@@ -479,6 +637,15 @@ void  HAL_IncTick (void)
 {
     _g_systick_millisecs++;  // inc Systick counter (add 1 for each 1 ms rupt)
 
+#if defined(USES_TIMESTAMP)
+    if (_g_systick_millisecs == 0)
+       _g_systick_millisecs_hi++;      // 32-bit ms count wrapped (49.7 days)
+#if (TSTAMP_USES_DWT)
+    if (_g_tstamp_active)
+       tstamp_tick (&_g_tstamp_clock, DWT->CYCCNT);   // track CYCCNT half periods
+#endif
+#endif
+
 #if defined(USES_MQTT)
     extern  unsigned long    MilliTimer;
     MilliTimer++;            // update MQTTCC3100.c's associated Timer
@@ -887,9 +1054,9 @@ void  board_vtimer_check_expiration (uint32_t gsystick_millisecs)
         if (_g_vtimer_flags[i] != VTIMER_BUSY)
            continue;                       // timer is not active, skip it
 
-        if (_g_vtimer_expire [i] > gsystick_millisecs)
+        if ((int32_t) (_g_vtimer_expire [i] - gsystick_millisecs) > 0)
            continue;                       // still not reach the timeout value
-// ??? TBD - CHECK TIMER, MUST ALSO HANDLE 49-day wrap-around ??? !!!
+                                           // (signed diff handles 49-day wrap)
 
                  //----------------------------------------------------------
                  // The VTIMER has reached its expiration time, so set
@@ -909,6 +1076,38 @@ void  board_vtimer_check_expiration (uint32_t gsystick_millisecs)
 }
 
 
+//*****************************************************************************
+//  board_vtimer_next_expiration
+//
+//               Return the number of milliseconds until the earliest active
+//               VTIMER expires (0 if one is already due), or 0xFFFFFFFF if
+//               no VTIMERs are active. Used by tickless idle to decide how
+//               long it can stay asleep.
+//*****************************************************************************
+
+uint32_t  board_vtimer_next_expiration (uint32_t gsystick_millisecs)
+{
+    int       i;
+    int32_t   remaining;
+    uint32_t  next_ms;
+
+    next_ms = 0xFFFFFFFF;
+    for (i = 0; i < 10;  i++)
+      {
+        if (_g_vtimer_flags[i] != VTIMER_BUSY)
+           continue;                       // timer is not active, skip it
+
+        remaining = (int32_t) (_g_vtimer_expire [i] - gsystick_millisecs);
+        if (remaining <= 0)
+           return (0);                     // already due
+        if ((uint32_t) remaining < next_ms)
+           next_ms = (uint32_t) remaining;
+      }
+
+    return (next_ms);
+}
+
+
 //*****************************************************************************
 //  board_vtimer_start
 //
@@ -997,4 +1196,406 @@ int  board_vtimer_reset (unsigned int vtimer_id)
     return (0);               // denote completed successfully
 }
 
+
+
+#if defined(USES_TIMESTAMP)
+//*****************************************************************************
+//*****************************************************************************
+//
+//                      COMMON     TIMESTAMP    Routines
+//
+//*****************************************************************************
+//*****************************************************************************
+
+//    Provides a wrap-free 64-bit monotonic timestamp, that can be taken from
+//    any ISR or thread level in a handful of instructions (see timestamp.h).
+//    Event sources (ADC DMA frames, UART receives, ...) store the raw 64-bit
+//    tick count, and convert it to usec only when the App asks for it.
+//
+//    The clock runs off the CPU crystal, and can be disciplined against the
+//    RTC (LSE) or network time, by periodically calling
+//    board_timestamp_discipline_rtc() / board_timestamp_discipline().
+//    A VTIMER callback every 60 seconds or so works well.
+
+
+//*****************************************************************************
+//  board_timestamp_init
+//
+//          Turn on the DWT cycle counter (if present), and start the
+//          timestamp clock at 0 usec.
+//*****************************************************************************
+int  board_timestamp_init (void)
+{
+    int   rc;
+
+#if (TSTAMP_USES_DWT)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // enable DWT/ITM blocks
+#if defined(STM32F746xx) || defined(STM32F746NGHx)
+    DWT->LAR = 0xC5ACCE55;                 // M7: unlock DWT for writes
+#endif
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;   // start the cycle counter
+
+    _g_tstamp_active = 0;                  // keep SysTick off while we init
+    rc = tstamp_init (&_g_tstamp_clock, SystemCoreClock, DWT->CYCCNT);
+#else
+    _g_tstamp_active = 0;
+    rc = tstamp_init (&_g_tstamp_clock, SystemCoreClock, board_timestamp_get_ticks());
+#endif
+    if (rc != 0)
+       return (rc);
+
+    _g_tstamp_active = 1;
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  board_timestamp_get_ticks
+//
+//          Return the current 64-bit tick count (CPU clock cycles).
+//          Lock-free, callable from any ISR level, including ones that
+//          run at a higher priority than SysTick.
+//*****************************************************************************
+uint64_t  board_timestamp_get_ticks (void)
+{
+#if (TSTAMP_USES_DWT)
+    uint32_t   half_periods;
+
+    half_periods = _g_tstamp_clock.half_periods;     // MUST be read before CYCCNT
+
+    return (tstamp_extend (half_periods, DWT->CYCCNT));
+#else
+    uint32_t   ms_lo;
+    uint32_t   ms_hi;
+    uint32_t   reload;
+    uint32_t   val;
+    int        wrap_pending;
+
+    reload = SysTick->LOAD;
+    do {        // re-read if a SysTick rupt bumped the ms count under us
+         ms_lo = *((volatile uint32_t*) &_g_systick_millisecs);
+         ms_hi = _g_systick_millisecs_hi;
+         val   = SysTick->VAL;
+         wrap_pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+       } while (ms_lo != *((volatile uint32_t*) &_g_systick_millisecs));
+
+        //---------------------------------------------------------------------
+        // If SysTick reloaded but its ISR has not run yet (we are at a higher
+        // priority, or rupts are masked), the ms count is one behind. A high
+        // VAL means it was read after the reload, so account for that ms.
+        //---------------------------------------------------------------------
+    if (wrap_pending && val > (reload >> 1))
+       { if (++ms_lo == 0)
+            ms_hi++;
+       }
+
+    return (((((uint64_t) ms_hi << 32) | ms_lo) * (reload + 1)) + (reload - val));
+#endif
+}
+
+
+//*****************************************************************************
+//  board_timestamp_get_usec
+//
+//          Return the current monotonic time, in usec since
+//          board_timestamp_init(). Never goes backwards, never wraps.
+//*****************************************************************************
+uint64_t  board_timestamp_get_usec (void)
+{
+    return (tstamp_ticks_to_usec (&_g_tstamp_clock, board_timestamp_get_ticks()));
+}
+
+
+//*****************************************************************************
+//  board_timestamp_get_wall_usec
+//
+//          Return the current wall clock time in usec, in the epoch of the
+//          last discipline reference (usec of day for the RTC, usec since
+//          1970 for SNTP, ...). Returns monotonic time if never disciplined.
+//*****************************************************************************
+uint64_t  board_timestamp_get_wall_usec (void)
+{
+    return (tstamp_get_wall_usec (&_g_tstamp_clock, board_timestamp_get_ticks()));
+}
+
+
+//*****************************************************************************
+//  board_timestamp_ticks_to_usec
+//
+//          Convert a stored 64-bit tick count (e.g. an ADC frame or UART
+//          receive timestamp) to monotonic usec.
+//*****************************************************************************
+uint64_t  board_timestamp_ticks_to_usec (uint64_t ticks)
+{
+    return (tstamp_ticks_to_usec (&_g_tstamp_clock, ticks));
+}
+
+
+//*****************************************************************************
+//  board_timestamp_discipline
+//
+//          Discipline the timestamp clock against an external reference,
+//          e.g. SNTP or a network time sync message, taken "now".
+//          Returns TSTAMP_DISCIPLINE_xxx (>= 0), or a negative error code.
+//*****************************************************************************
+int  board_timestamp_discipline (uint64_t ref_usec)
+{
+    if (_g_tstamp_active == 0)
+       return (ERR_TIMESTAMP_INVALID_PARM);
+
+    return (tstamp_discipline (&_g_tstamp_clock, board_timestamp_get_ticks(), ref_usec));
+}
+
+
+//*****************************************************************************
+//  board_timestamp_discipline_rtc
+//
+//          Discipline the timestamp clock against the RTC. board_rtc_init()
+//          must have been called. Blocks for up to 1 RTC sub-second step
+//          (~4 ms), to line up with the sub-second edge.
+//          Returns TSTAMP_DISCIPLINE_xxx (>= 0), or a negative error code.
+//*****************************************************************************
+int  board_timestamp_discipline_rtc (void)
+{
+    uint64_t   usec_of_day;
+    uint64_t   ticks;
+    int        rc;
+
+    if (_g_tstamp_active == 0)
+       return (ERR_TIMESTAMP_INVALID_PARM);
+
+    rc = board_rtc_get_usec_of_day (&usec_of_day, &ticks);
+    if (rc != 0)
+       return (rc);
+
+    return (tstamp_discipline (&_g_tstamp_clock, ticks, usec_of_day));
+}
+#endif                          //  USES_TIMESTAMP
+
+
+#if defined(USES_TICKLESS_IDLE)
+//*****************************************************************************
+//*****************************************************************************
+//
+//                      COMMON     LOW  POWER  IDLE    Routines
+//
+//*****************************************************************************
+//*****************************************************************************
+
+//    Normally the 1 ms SysTick runs forever, so even an idle node wakes up
+//    1000 times a second. board_lowpower_idle() looks at when the next
+//    VTIMER (or App supplied deadline) is due, and if it is far enough out,
+//    turns off SysTick, arms the RTC wakeup timer, and enters STOP mode.
+//    On wakeup (timer or any other rupt), it restores the clocks, and adds
+//    the time spent in STOP (measured with the RTC sub-second counter) to
+//    the 1 ms SysTick count, so VTIMERs and timeouts stay on schedule.
+//
+//    board_rtc_init() must have been called to use STOP. Without the RTC,
+//    idle falls back to a WFI sleep, which still wakes every 1 ms.
+//
+//    Note: STOP turns off all high speed clocks, so pass LPM_SLEEP_ONLY
+//          while any DMA/UART/SPI I/O is in progress.
+
+#define  LPM_MIN_STOP_MS    3    /* shorter idles are not worth a clock restart */
+
+    LPM_ENTRY_HANDLER   _g_lpm_stop_handler = 0L; // optional App STOP entry
+    uint32_t   _g_lpm_wakeups       = 0;    // total # wakeups
+    uint32_t   _g_lpm_timer_wakeups = 0;    // # wakeups from RTC wakeup timer
+    uint64_t   _g_lpm_sleep_cycles  = 0;    // CPU cycles spent in WFI sleep
+    uint32_t   _g_lpm_stop_ms       = 0;    // milliseconds spent in STOP
+    uint32_t   _g_lpm_stats_start   = 0;    // SysTick ms when stats were reset
+    uint32_t   _g_lpm_subsec_rem    = 0;    // left over RTC sub-sec fraction
+
+
+//*****************************************************************************
+//  board_lowpower_set_stop_handler
+//
+//          Supply an App routine to enter STOP mode (e.g. one that also puts
+//          the radio to sleep). The default is HAL_PWR_EnterSTOPMode() with
+//          the low power regulator on. Passing 0L restores the default.
+//          It is called with interrupts disabled, and must return on wakeup.
+//*****************************************************************************
+void  board_lowpower_set_stop_handler (LPM_ENTRY_HANDLER stop_handler)
+{
+    _g_lpm_stop_handler = stop_handler;
+}
+
+
+//*****************************************************************************
+//  board_lowpower_idle
+//
+//          Idle the MCU until the next VTIMER is due, max_idle_ms has
+//          elapsed (LPM_IDLE_FOREVER = no App deadline), or any rupt occurs.
+//
+//          Returns which mode was used: LPM_MODE_RUN (work already due),
+//          LPM_MODE_SLEEP (WFI, SysTick kept running), or LPM_MODE_STOP.
+//*****************************************************************************
+int  board_lowpower_idle (uint32_t max_idle_ms, int flags)
+{
+    uint32_t   idle_ms;
+    uint32_t   vtimer_ms;
+    uint32_t   start_count;
+    uint32_t   end_count;
+    uint32_t   per_sec;
+    uint32_t   reload;
+    uint32_t   val_before;
+    uint32_t   val_after;
+    uint64_t   elapsed;
+    int        use_stop;
+    int        rtc_ok;
+    int        timer_fired;
+
+    idle_ms   = max_idle_ms;
+    vtimer_ms = board_vtimer_next_expiration (_g_systick_millisecs);
+    if (vtimer_ms < idle_ms)
+       idle_ms = vtimer_ms;
+    if (idle_ms == 0)
+       return (LPM_MODE_RUN);             // something is already due
+
+    board_disable_global_interrupts();    // rupts still wake us from WFI,
+                                          // but their ISRs run after we fix
+                                          // up the SysTick count
+    use_stop = ((flags & LPM_SLEEP_ONLY) == 0  &&  idle_ms >= LPM_MIN_STOP_MS);
+    rtc_ok   = 0;
+    if (use_stop)
+       rtc_ok = (board_rtc_get_subsec_count (&start_count, &per_sec, 0) == 0);
+    if (use_stop && ! rtc_ok && idle_ms != LPM_IDLE_FOREVER)
+       use_stop = 0;                      // can not time a STOP w/o the RTC
+
+    if ( ! use_stop)
+       {     //--------------------------------------------------------------
+             // Light sleep: core clock stops, SysTick keeps running and
+             // wakes us within 1 ms. Measure the time asleep in cycles.
+             //--------------------------------------------------------------
+         reload     = SysTick->LOAD + 1;
+         val_before = SysTick->VAL;
+         __WFI();
+         val_after  = SysTick->VAL;
+         if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+            _g_lpm_sleep_cycles += val_before + (reload - val_after);
+            else if (val_before > val_after)
+                    _g_lpm_sleep_cycles += val_before - val_after;
+         _g_lpm_wakeups++;
+         board_enable_global_interrupts();
+         return (LPM_MODE_SLEEP);
+       }
+
+          //------------------------------------------------------------------
+          // Tickless STOP: turn off SysTick, arm the RTC wakeup timer (unless
+          // no deadline at all), and stop. On wakeup, high speed clocks are
+          // back on HSI/MSI, so restore the PLL config first.
+          //------------------------------------------------------------------
+    HAL_SuspendTick();
+    if (idle_ms != LPM_IDLE_FOREVER)
+       board_rtc_wakeup_start (idle_ms);
+
+    if (_g_lpm_stop_handler != 0L)
+       (_g_lpm_stop_handler) ();
+       else HAL_PWR_EnterSTOPMode (PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+
+    board_system_clock_config (_g_SysClk_Ticks, _g_SysClk_option_flags);  // same clock source as boot
+    board_irq_plan_init();               // clock config reset SysTick priority
+
+    timer_fired = 0;
+    if (idle_ms != LPM_IDLE_FOREVER)
+       timer_fired = board_rtc_wakeup_stop();
+
+    if (rtc_ok  &&  board_rtc_get_subsec_count (&end_count, &per_sec, 1) == 0)
+       {     //--------------------------------------------------------------
+             // Add the time spent in STOP to the SysTick ms count. Carry
+             // the sub-millisecond remainder over, so repeated short idles
+             // do not drift.
+             //--------------------------------------------------------------
+         if (end_count < start_count)
+            end_count += 86400L * per_sec;          // crossed midnight
+         elapsed = ((uint64_t) (end_count - start_count) * 1000) + _g_lpm_subsec_rem;
+         _g_lpm_subsec_rem = (uint32_t) (elapsed % per_sec);
+         board_systick_advance ((uint32_t) (elapsed / per_sec));
+         _g_lpm_stop_ms += (uint32_t) (elapsed / per_sec);
+       }
+
+    HAL_ResumeTick();
+    _g_lpm_wakeups++;
+    if (timer_fired)
+       _g_lpm_timer_wakeups++;
+
+    board_enable_global_interrupts();     // any pending ISRs run now
+
+    return (LPM_MODE_STOP);
+}
+
+
+//*****************************************************************************
+//  board_lowpower_get_stats
+//
+//          Report wakeups per hour, and time spent in each power mode, since
+//          startup or the last reset of the stats.
+//*****************************************************************************
+void  board_lowpower_get_stats (LOWPOWER_STATS *stats, int reset_flag)
+{
+    uint32_t   total_ms;
+    uint32_t   sleep_ms;
+
+    total_ms = _g_systick_millisecs - _g_lpm_stats_start;
+    sleep_ms = (uint32_t) ((_g_lpm_sleep_cycles * 1000) / SystemCoreClock);
+
+    stats->total_ms      = total_ms;
+    stats->stop_ms       = _g_lpm_stop_ms;
+    stats->sleep_ms      = sleep_ms;
+    stats->run_ms        = 0;
+    if (total_ms > _g_lpm_stop_ms + sleep_ms)
+       stats->run_ms = total_ms - _g_lpm_stop_ms - sleep_ms;
+    stats->wakeups       = _g_lpm_wakeups;
+    stats->timer_wakeups = _g_lpm_timer_wakeups;
+    stats->wakeups_per_hour = 0;
+    if (total_ms > 0)
+       stats->wakeups_per_hour = (uint32_t) (((uint64_t) _g_lpm_wakeups * 3600000L) / total_ms);
+
+    if (reset_flag)
+       {
+         _g_lpm_wakeups       = 0;
+         _g_lpm_timer_wakeups = 0;
+         _g_lpm_sleep_cycles  = 0;
+         _g_lpm_stop_ms       = 0;
+         _g_lpm_stats_start   = _g_systick_millisecs;
+       }
+}
+
+
+//*****************************************************************************
+//  board_systick_advance
+//
+//          Catch the 1 ms SysTick count (and anything driven off it) up with
+//          time that passed while SysTick was turned off.
+//*****************************************************************************
+void  board_systick_advance (uint32_t elapsed_ms)
+{
+    uint32_t   prev_ms;
+
+    prev_ms = _g_systick_millisecs;
+    _g_systick_millisecs += elapsed_ms;
+
+#if defined(USES_TIMESTAMP)
+    if (_g_systick_millisecs < prev_ms)
+       _g_systick_millisecs_hi++;         // 32-bit ms count wrapped
+#if (TSTAMP_USES_DWT)
+        // CYCCNT stopped along with the core clock: move the timestamp
+        // base forward by the time it missed. (Without DWT, the ticks are
+        // built from the ms count above, so they are already caught up.)
+    if (_g_tstamp_active)
+       tstamp_advance (&_g_tstamp_clock, board_timestamp_get_ticks(),
+                       (uint64_t) elapsed_ms * 1000);
+#endif
+#else
+    (void) prev_ms;
+#endif
+
+#if defined(USES_MQTT)
+    extern  unsigned long    MilliTimer;
+    MilliTimer += elapsed_ms;             // keep MQTT keepalive timer in step
+#endif
+}
+#endif                          //  USES_TICKLESS_IDLE
+
 #endif                          //  __BOARD_COMMON_C__
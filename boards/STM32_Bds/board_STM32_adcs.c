@@ -21,6 +21,11 @@
 //    04/12/15 - Added multi-channel ADC support. Duq
 //    05/25/15 - Fixed lingering issues in ADC DMA support. Duqu
 //    07/18/15 - Reworked to provide better factoring. Duq
+//    10/19/26 - Added optional DSP filter stage, run from the DMA ISRs.
+//    10/19/26 - Timestamp each DMA frame (USES_TIMESTAMP).
+//    10/19/26 - board_adc_get_frame_ticks(), for latency trace origins.
+//    10/19/26 - DMA IRQ uses the IRQ_PRIO_HARD_RT class. Added deferred
+//               (bottom half) callbacks, and ISR timing (USES_IRQ_STATS).
 //
 // The MIT License (MIT)
 //
@@ -48,6 +53,11 @@
 #include "user_api.h"               // pull in defs for User API calls
 
 #include <math.h>
+#include <string.h>
+
+#if defined(USES_ADC_DSP)
+#include "adc_dsp_filter.h"         // optional oversample/filter/scale stage
+#endif
 
 #define  INT_OFFSET      4          // Indexing offset used for Internal Sensors
 
@@ -97,6 +107,18 @@ typedef struct adc_ctl_io_ctl_def       /* ADC Control and Status definition */
 
        ADC_CB_EVENT_HANDLER  adc_callback_handler; // optional callback routine
        void       *adc_callback_parm;              // user callback parm
+#if defined(USES_ADC_DSP)
+       ADC_DSP_STAGE  *adc_dsp_stage;              // optional DSP filter stage
+#endif
+#if defined(USES_TIMESTAMP)
+       uint64_t   adc_frame_ticks;                 // timestamp of last DMA frame
+#endif
+#if defined(USES_IRQ_BOTTOM_HALF)
+       uint8_t    adc_cb_deferred;      // 1 = callback is run from a bottom half
+       uint8_t    adc_bh_id;            // bottom half id + 1  (0 = none yet)
+       volatile uint8_t  adc_bh_ready;  // which snapshot is the newest
+       uint16_t   adc_bh_results[2][22]; // frame snapshots for the bottom half
+#endif
 
        uint16_t   adc_trigger_user_api_id; // User API id for the trigger
        uint16_t   adc_trigger_timer;       // Index to correct Timer/PWM - was _g_trigger_atmrpwm
@@ -149,6 +171,10 @@ ADC_TRIGGER_BLK  *board_adc_get_trigger_block (int module_id, int trigger_type);
 ADC_TRIGGER_BLK  *board_adc_lookup_trigger (unsigned int module_id, int trigger_type,
                                         ADC_IO_CONTROL_BLK *adc_blk, int flags);
 void  board_adc_enable_clocks (int module_id);
+static void  board_adc_invoke_callback (ADC_IO_CONTROL_BLK *adc_blk);
+#if defined(USES_IRQ_BOTTOM_HALF)
+static void  board_adc_bh_handler (void *parm, uint32_t events);
+#endif
 
 
      //------------------------------------------------------------------------
@@ -757,7 +783,7 @@ int  board_adc_init (unsigned int module_id, uint32_t clock_rate,  int trigger_t
               //          Configure the NVIC for DMA interrupts
               // Configure NVIC for DMA transfer complete interrupt.
               //----------------------------------------------------------
-         HAL_NVIC_SetPriority (DMA_STREAM_IRQ, 0, 0);
+         HAL_NVIC_SetPriority (DMA_STREAM_IRQ, IRQ_PRIO_HARD_RT, 0);
          HAL_NVIC_EnableIRQ (DMA_STREAM_IRQ);
        }
 
@@ -1296,9 +1322,178 @@ int  board_adc_set_callback (unsigned int module_id,
         //----------------------------------------------------------------
     adc_blk->adc_callback_handler = callback_function;
     adc_blk->adc_callback_parm    = callback_parm;
+#if defined(USES_IRQ_BOTTOM_HALF)
+    adc_blk->adc_cb_deferred      = 0;    // called right from the DMA ISR
+#endif
+
+    return (0);                           // denote success
+}
+
+
+#if defined(USES_IRQ_BOTTOM_HALF)
+//*****************************************************************************
+//  board_adc_set_callback_deferred
+//
+//          Same as board_adc_set_callback(), but the callback is run from a
+//          bottom half (PendSV, IRQ_PRIO_BOTTOM_HALF) after the DMA ISR
+//          returns, so the App's processing does not hold off the other
+//          HARD_RT interrupts.  The DMA ISR copies the frame into one of
+//          two snapshot buffers, so the callback sees a stable copy even
+//          while the next frame is DMA'ed in.  If frames arrive faster than
+//          the callback runs, it is passed only the newest frame (the BH
+//          stats' coalesced count says how many were skipped). The callback
+//          must finish within one frame period.
+//*****************************************************************************
+int  board_adc_set_callback_deferred (unsigned int module_id,
+                                      ADC_CB_EVENT_HANDLER  callback_function,
+                                      void *callback_parm)
+{
+    ADC_IO_CONTROL_BLK  *adc_blk;
+    int                 bh_id;
+
+       // Get the associated control and status params for this ADC module
+    adc_blk = (ADC_IO_CONTROL_BLK*) board_adc_get_io_control_block (module_id);
+    if (adc_blk == 0L)
+       return (ERR_ADC_MODULE_ID_OUT_OF_RANGE);
+
+    if (adc_blk->adc_bh_id == 0)
+       {      // first use for this module: get it a bottom half
+         bh_id = board_bh_register (board_adc_bh_handler, adc_blk);
+         if (bh_id < 0)
+            return (bh_id);
+         adc_blk->adc_bh_id = (uint8_t) (bh_id + 1);
+       }
+
+    adc_blk->adc_cb_deferred      = 0;    // no window with the wrong parm
+    adc_blk->adc_callback_handler = callback_function;
+    adc_blk->adc_callback_parm    = callback_parm;
+    adc_blk->adc_cb_deferred      = 1;
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  board_adc_bh_handler
+//
+//          Bottom half for a deferred ADC callback: pass the App the newest
+//          frame snapshot.
+//*****************************************************************************
+static void  board_adc_bh_handler (void *parm, uint32_t events)
+{
+    ADC_IO_CONTROL_BLK  *adc_blk;
+
+    adc_blk = (ADC_IO_CONTROL_BLK*) parm;
+    if (adc_blk->adc_callback_handler != 0L)
+       (adc_blk->adc_callback_handler) (adc_blk->adc_callback_parm,
+                                        adc_blk->adc_bh_results [adc_blk->adc_bh_ready],
+                                        adc_blk->adc_active_channels,
+                                        0);       // invoke user handler
+}
+#endif
+
+
+//*****************************************************************************
+//  board_adc_invoke_callback
+//
+//          Called by the DMA ISRs: if a ADC completion callback has been
+//          configured, invoke it, or schedule it if it is deferred.
+//*****************************************************************************
+static void  board_adc_invoke_callback (ADC_IO_CONTROL_BLK *adc_blk)
+{
+#if defined(USES_IRQ_BOTTOM_HALF)
+    int   snap;
+#endif
+
+    if (adc_blk->adc_callback_handler == 0L)
+       return;
+
+#if defined(USES_IRQ_BOTTOM_HALF)
+    if (adc_blk->adc_cb_deferred)
+       {      // snapshot into the buffer the bottom half is not reading
+         snap = adc_blk->adc_bh_ready ^ 1;
+         memcpy (adc_blk->adc_bh_results[snap], adc_blk->adc_conv_results,
+                 adc_blk->adc_active_channels * sizeof(uint16_t));
+         adc_blk->adc_bh_ready = (uint8_t) snap;
+         board_bh_schedule (adc_blk->adc_bh_id - 1, 1);
+         return;
+       }
+#endif
+
+    (adc_blk->adc_callback_handler) (adc_blk->adc_callback_parm,
+                                     adc_blk->adc_conv_results,
+                                     adc_blk->adc_active_channels,
+                                     0);          // Invoke user handler
+}
+
+
+#if defined(USES_ADC_DSP)
+//*****************************************************************************
+//  board_adc_set_dsp_stage
+//
+//          Attach a DSP filter stage (see adc_dsp_filter.h) to an ADC module.
+//          Every DMA completion then runs the new results through the stage,
+//          right after the (raw) ADC callback, if any, has been invoked.
+//          The stage is run in the DMA ISR, so it must stay resident.
+//          Passing 0L detaches the stage.
+//*****************************************************************************
+int  board_adc_set_dsp_stage (unsigned int module_id, ADC_DSP_STAGE *dsp_stage)
+{
+    ADC_IO_CONTROL_BLK  *adc_blk;
+
+       // Get the associated control and status params for this ADC module
+    adc_blk = (ADC_IO_CONTROL_BLK*) board_adc_get_io_control_block (module_id);
+    if (adc_blk == 0L)
+       return (ERR_ADC_MODULE_ID_OUT_OF_RANGE);
+
+    adc_blk->adc_dsp_stage = dsp_stage;
 
     return (0);                           // denote success
 }
+#endif
+
+
+#if defined(USES_TIMESTAMP)
+//*****************************************************************************
+//  board_adc_get_frame_timestamp
+//
+//          Return the monotonic timestamp (usec) of when the last DMA frame
+//          of results completed. It is taken on entry to the DMA ISR, so it
+//          is on the same timebase as UART, capture, ... event timestamps.
+//*****************************************************************************
+int  board_adc_get_frame_timestamp (unsigned int module_id, uint64_t *frame_usec)
+{
+    ADC_IO_CONTROL_BLK  *adc_blk;
+
+    adc_blk = (ADC_IO_CONTROL_BLK*) board_adc_get_io_control_block (module_id);
+    if (adc_blk == 0L)
+       return (ERR_ADC_MODULE_ID_OUT_OF_RANGE);
+
+    *frame_usec = board_timestamp_ticks_to_usec (adc_blk->adc_frame_ticks);
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  board_adc_get_frame_ticks
+//
+//          Return the raw tick count of when the last DMA frame completed.
+//          Used as the origin stamp of a latency trace (lat_trace.h).
+//*****************************************************************************
+int  board_adc_get_frame_ticks (unsigned int module_id, uint64_t *frame_ticks)
+{
+    ADC_IO_CONTROL_BLK  *adc_blk;
+
+    adc_blk = (ADC_IO_CONTROL_BLK*) board_adc_get_io_control_block (module_id);
+    if (adc_blk == 0L)
+       return (ERR_ADC_MODULE_ID_OUT_OF_RANGE);
+
+    *frame_ticks = adc_blk->adc_frame_ticks;
+
+    return (0);                           // denote success
+}
+#endif
 
 
 //*****************************************************************************
@@ -1399,13 +1594,7 @@ void   HAL_ADC_ConvCpltCallback (ADC_HandleTypeDef *adc_Handle)
        //-------------------------------------------------------------
        // If a ADC completion callback has been configured, invoke it
        //-------------------------------------------------------------
-    if (adc_blk->adc_callback_handler != 0L)
-       {
-          (adc_blk->adc_callback_handler) (adc_blk->adc_callback_parm,
-                                           adc_blk->adc_conv_results,
-                                           adc_blk->adc_active_channels,
-                                           0);       // invoke user handler
-       }
+    board_adc_invoke_callback (adc_blk);
 #endif
 }
 
@@ -1429,11 +1618,20 @@ void   HAL_ADC_ConvCpltCallback (ADC_HandleTypeDef *adc_Handle)
 void  DMA_ADC1_ISR_IRQHandler (void)
 {
     ADC_IO_CONTROL_BLK  *adc_blk;
+#if defined(USES_IRQ_STATS)
+    uint32_t            t_start;
+
+    t_start = IRQ_CYCLE_COUNT();
+#endif
 
     dma_rupt_seen++;                               // DEBUG COUNTER
 
     adc_blk = (ADC_IO_CONTROL_BLK*) board_adc_get_io_control_block (ADC_M1);
 
+#if defined(USES_TIMESTAMP)
+    adc_blk->adc_frame_ticks = board_timestamp_get_ticks(); // stamp end of frame
+#endif
+
     adc_blk->ADC_DMA_complete = ADC_DMA_STATE_IO_COMPLETE;   // set status that
                              // ADCs and DMA I/O has completed.
                              // Used by adc_Check_All_Complete() logic.
@@ -1449,14 +1647,30 @@ void  DMA_ADC1_ISR_IRQHandler (void)
        //-------------------------------------------------------------
        // If a ADC completion callback has been configured, invoke it
        //-------------------------------------------------------------
-    if (adc_blk->adc_callback_handler != 0L)
-       {
-          (adc_blk->adc_callback_handler) (adc_blk->adc_callback_parm,
-                                           adc_blk->adc_conv_results,
-                                           adc_blk->adc_active_channels,
-                                           0);        // Invoke user handler
-       }
+    board_adc_invoke_callback (adc_blk);
 
+#if defined(USES_ADC_DSP)
+       //-------------------------------------------------------------
+       // If a DSP filter stage has been attached, run the new frame
+       // through it. It invokes its own (filtered) callback, if any.
+       //-------------------------------------------------------------
+    if (adc_blk->adc_dsp_stage != 0L)
+       adc_dsp_process_frame (adc_blk->adc_dsp_stage,
+                              adc_blk->adc_conv_results,
+                              adc_blk->adc_active_channels);
+#endif
+
+#if defined(USES_IRQ_STATS)
+       //-------------------------------------------------------------
+       // Run time only: the DMA transfer complete event carries no
+       // time, and CNT of a triggering timer would include the whole
+       // conversion sequence, not just the ISR's entry latency. The
+       // timer update ISRs (and the BLDC current loop) record latency
+       // for this class.
+       //-------------------------------------------------------------
+    board_irq_stats_record (IRQ_CLASS_HARD_RT, IRQ_LATENCY_UNKNOWN,
+                            IRQ_CYCLE_COUNT() - t_start);
+#endif
 //  HAL_ADC_Stop_DMA(hadc);  // ??? need - bit is blow up when re-enable ADC_IT
 }
 
@@ -1477,11 +1691,20 @@ void  DMA_ADC1_ISR_IRQHandler (void)
 void  DMA_ADC2_ISR_IRQHandler (void)
 {
     ADC_IO_CONTROL_BLK  *adc_blk;
+#if defined(USES_IRQ_STATS)
+    uint32_t            t_start;
+
+    t_start = IRQ_CYCLE_COUNT();
+#endif
 
     dma_rupt_seen++;                               // DEBUG COUNTER
 
     adc_blk = (ADC_IO_CONTROL_BLK*) board_adc_get_io_control_block (ADC_M2);
 
+#if defined(USES_TIMESTAMP)
+    adc_blk->adc_frame_ticks = board_timestamp_get_ticks(); // stamp end of frame
+#endif
+
     adc_blk->ADC_DMA_complete = ADC_DMA_STATE_IO_COMPLETE;   // set status that
                              // ADCs and DMA I/O has completed.
                              // Used by adc_Check_All_Complete() logic.
@@ -1497,14 +1720,23 @@ void  DMA_ADC2_ISR_IRQHandler (void)
        //-------------------------------------------------------------
        // If a ADC completion callback has been configured, invoke it
        //-------------------------------------------------------------
-    if (adc_blk->adc_callback_handler != 0L)
-       {
-          (adc_blk->adc_callback_handler) (adc_blk->adc_callback_parm,
-                                           adc_blk->adc_conv_results,
-                                           adc_blk->adc_active_channels,
-                                           0);        // Invoke user handler
-       }
+    board_adc_invoke_callback (adc_blk);
 
+#if defined(USES_ADC_DSP)
+       //-------------------------------------------------------------
+       // If a DSP filter stage has been attached, run the new frame
+       // through it. It invokes its own (filtered) callback, if any.
+       //-------------------------------------------------------------
+    if (adc_blk->adc_dsp_stage != 0L)
+       adc_dsp_process_frame (adc_blk->adc_dsp_stage,
+                              adc_blk->adc_conv_results,
+                              adc_blk->adc_active_channels);
+#endif
+
+#if defined(USES_IRQ_STATS)
+    board_irq_stats_record (IRQ_CLASS_HARD_RT, IRQ_LATENCY_UNKNOWN,   // see ADC1
+                            IRQ_CYCLE_COUNT() - t_start);
+#endif
 //  HAL_ADC_Stop_DMA(hadc);  // ??? need - bit is blow up when re-enable ADC_IT
 }
 #endif
@@ -1526,11 +1758,20 @@ void  DMA_ADC2_ISR_IRQHandler (void)
 void  DMA_ADC3_ISR_IRQHandler (void)
 {
     ADC_IO_CONTROL_BLK  *adc_blk;
+#if defined(USES_IRQ_STATS)
+    uint32_t            t_start;
+
+    t_start = IRQ_CYCLE_COUNT();
+#endif
 
     dma_rupt_seen++;                               // DEBUG COUNTER
 
     adc_blk = (ADC_IO_CONTROL_BLK*) board_adc_get_io_control_block (ADC_M3);
 
+#if defined(USES_TIMESTAMP)
+    adc_blk->adc_frame_ticks = board_timestamp_get_ticks(); // stamp end of frame
+#endif
+
     adc_blk->ADC_DMA_complete = ADC_DMA_STATE_IO_COMPLETE;   // set status that
                              // ADCs and DMA I/O has completed.
                              // Used by adc_Check_All_Complete() logic.
@@ -1546,14 +1787,23 @@ void  DMA_ADC3_ISR_IRQHandler (void)
        //-------------------------------------------------------------
        // If a ADC completion callback has been configured, invoke it
        //-------------------------------------------------------------
-    if (adc_blk->adc_callback_handler != 0L)
-       {
-          (adc_blk->adc_callback_handler) (adc_blk->adc_callback_parm,
-                                           adc_blk->adc_conv_results,
-                                           adc_blk->adc_active_channels,
-                                           0);        // Invoke user handler
-       }
+    board_adc_invoke_callback (adc_blk);
+
+#if defined(USES_ADC_DSP)
+       //-------------------------------------------------------------
+       // If a DSP filter stage has been attached, run the new frame
+       // through it. It invokes its own (filtered) callback, if any.
+       //-------------------------------------------------------------
+    if (adc_blk->adc_dsp_stage != 0L)
+       adc_dsp_process_frame (adc_blk->adc_dsp_stage,
+                              adc_blk->adc_conv_results,
+                              adc_blk->adc_active_channels);
+#endif
 
+#if defined(USES_IRQ_STATS)
+    board_irq_stats_record (IRQ_CLASS_HARD_RT, IRQ_LATENCY_UNKNOWN,   // see ADC1
+                            IRQ_CYCLE_COUNT() - t_start);
+#endif
 //  HAL_ADC_Stop_DMA(hadc);  // ??? need - bit is blow up when re-enable ADC_IT
 }
 #endif
@@ -1575,11 +1825,20 @@ void  DMA_ADC3_ISR_IRQHandler (void)
 void  DMA_ADC4_ISR_IRQHandler (void)
 {
     ADC_IO_CONTROL_BLK  *adc_blk;
+#if defined(USES_IRQ_STATS)
+    uint32_t            t_start;
+
+    t_start = IRQ_CYCLE_COUNT();
+#endif
 
     dma_rupt_seen++;                               // DEBUG COUNTER
 
     adc_blk = (ADC_IO_CONTROL_BLK*) board_adc_get_io_control_block (ADC_M4);
 
+#if defined(USES_TIMESTAMP)
+    adc_blk->adc_frame_ticks = board_timestamp_get_ticks(); // stamp end of frame
+#endif
+
     adc_blk->ADC_DMA_complete = ADC_DMA_STATE_IO_COMPLETE;   // set status that
                              // ADCs and DMA I/O has completed.
                              // Used by adc_Check_All_Complete() logic.
@@ -1595,14 +1854,23 @@ void  DMA_ADC4_ISR_IRQHandler (void)
        //-------------------------------------------------------------
        // If a ADC completion callback has been configured, invoke it
        //-------------------------------------------------------------
-    if (adc_blk->adc_callback_handler != 0L)
-       {
-          (adc_blk->adc_callback_handler) (adc_blk->adc_callback_parm,
-                                           adc_blk->adc_conv_results,
-                                           adc_blk->adc_active_channels,
-                                           0);        // Invoke user handler
-       }
+    board_adc_invoke_callback (adc_blk);
 
+#if defined(USES_ADC_DSP)
+       //-------------------------------------------------------------
+       // If a DSP filter stage has been attached, run the new frame
+       // through it. It invokes its own (filtered) callback, if any.
+       //-------------------------------------------------------------
+    if (adc_blk->adc_dsp_stage != 0L)
+       adc_dsp_process_frame (adc_blk->adc_dsp_stage,
+                              adc_blk->adc_conv_results,
+                              adc_blk->adc_active_channels);
+#endif
+
+#if defined(USES_IRQ_STATS)
+    board_irq_stats_record (IRQ_CLASS_HARD_RT, IRQ_LATENCY_UNKNOWN,   // see ADC1
+                            IRQ_CYCLE_COUNT() - t_start);
+#endif
 //  HAL_ADC_Stop_DMA(hadc);  // ??? need - bit is blow up when re-enable ADC_IT
 }
 #endif
@@ -0,0 +1,345 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                           board_STM32_bdc.c
+//
+//
+//  Timer plumbing for the closed loop brushed DC motor controller
+//  (common/bdc_motor.c).  Enabled by USES_BDC_MOTOR.
+//
+//    - Each motor has an encoder timer (timer_Encoder_Init()), and a pair
+//      of channels on a PWM timer driving an IN1/IN2 style H-bridge
+//      (DRV8833, TB6612 in PWM/PWM mode, L298 ...): forward = PWM on IN1
+//      with IN2 low, reverse = the other way round.
+//
+//    - A 4 channel PWM timer drives 2 motors. All the motors on one PWM
+//      timer are run from that timer's update (rollover) interrupt, every
+//      loop_div PWM periods, so the control rate is locked to the PWM
+//      and has no jitter from thread level code.
+//
+//    - New duty values are written to the CCRs, which are preloaded
+//      (OCxPE, set by pwm_Config_Channel()), so they only take effect at
+//      the next update event:  no short or glitched PWM pulses.
+//
+//  Each tick's execution time, and the time between ticks, are measured
+//  with the DWT cycle counter (Cortex-M3 and up) and kept as last/max, so
+//  the CPU cost and the loop rate jitter can be checked on the target.
+//
+//  Typical setup:
+//      pwm_Init (PWM_MODULE_3, pwm_period, 0);        20 kHz PWM
+//      timer_Encoder_Init (TIMER_4, 4, 0);
+//      bdc_motor_init (&motor, 16, 10, 1, 0);
+//      bdc_motor_set_gains (&motor.vel_pid, ...);     ...
+//      bdc_Attach (&motor, PWM_MODULE_3, PWM_CHANNEL_1, PWM_CHANNEL_2, TIMER_4);
+//      bdc_Start (PWM_MODULE_3, 2);                   10 kHz control tick
+//
+//  History:
+//    10/19/26 - Created for the BDC motor lab.
+// -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "user_api.h"
+
+#if defined(USES_BDC_MOTOR)
+
+#include "bdc_motor.h"
+
+#ifndef BDC_MAX_MOTORS
+#define  BDC_MAX_MOTORS            4
+#endif
+#ifndef BDC_MAX_PWM_TIMERS
+#define  BDC_MAX_PWM_TIMERS        2
+#endif
+
+#if defined(__CORTEX_M) && (__CORTEX_M >= 3)
+#define  BDC_USES_DWT              1
+#define  BDC_CYCLES()              DWT->CYCCNT
+#else
+#define  BDC_USES_DWT              0
+#define  BDC_CYCLES()              0
+#endif
+
+
+typedef struct bdc_drive_def              /* one motor's hardware */
+   {
+       BDC_MOTOR          *motor;
+       TIM_TypeDef        *enc_tim;       // encoder timer
+       volatile uint32_t  *ccr_fwd;       // CCR driving IN1
+       volatile uint32_t  *ccr_rev;       // CCR driving IN2
+       uint8_t            pwm_module;
+   } BDC_DRIVE;
+
+typedef struct bdc_group_def              /* motors run from one PWM timer */
+   {
+       TIM_TypeDef        *pwm_tim;
+       uint8_t            pwm_module;
+       uint8_t            loop_div;
+       uint8_t            div_count;
+       uint8_t            num_drives;
+       BDC_DRIVE          *drive [BDC_MAX_MOTORS];
+       BDC_STATS          stats;
+       uint32_t           last_start;     // DWT count at the previous tick
+   } BDC_GROUP;
+
+    static BDC_DRIVE    _g_bdc_drives [BDC_MAX_MOTORS];
+    static BDC_GROUP    _g_bdc_groups [BDC_MAX_PWM_TIMERS];
+    static int          _g_bdc_num_drives = 0;
+
+static void       board_bdc_tick (void *callback_parm, int rupt_id);
+static BDC_GROUP  *board_bdc_find_group (unsigned int pwm_module, int create);
+static volatile uint32_t  *board_bdc_ccr (TIM_TypeDef *tim, int chan_id);
+
+
+/*************************************************************************
+* @brief  Attach a motor to its encoder timer and 2 PWM channels.
+*         pwm_Init() must already have been done on pwm_module, and
+*         timer_Encoder_Init() on enc_module. Both channels are setup
+*         (preloaded PWM, 0 % duty) by this call.
+*
+* @retval 0 on success, else ERR_BDC_xxx or ERR_PWM_xxx
+*************************************************************************/
+int  board_bdc_attach (struct bdc_motor_def *motor, unsigned int pwm_module,
+                       int chan_fwd, int chan_rev, unsigned int enc_module)
+{
+    TIM_HandleTypeDef  *pwm_hdl;
+    TIM_HandleTypeDef  *enc_hdl;
+    BDC_GROUP          *grp;
+    BDC_DRIVE          *drv;
+    int                rc;
+
+    if (motor == 0L || chan_fwd == chan_rev)
+       return (ERR_BDC_INVALID_PARM);
+    if (_g_bdc_num_drives >= BDC_MAX_MOTORS)
+       return (ERR_BDC_TOO_MANY_MOTORS);
+
+    pwm_hdl = board_timerpwm_get_handle (pwm_module);
+    enc_hdl = board_timerpwm_get_handle (enc_module);
+    if (pwm_hdl == 0L || pwm_hdl->Instance == 0L
+       || enc_hdl == 0L || enc_hdl->Instance == 0L)
+       return (ERR_PWM_MODULE_NOT_INITIALIZED);
+
+    grp = board_bdc_find_group (pwm_module, 1);
+    if (grp == 0L || grp->num_drives >= BDC_MAX_MOTORS)
+       return (ERR_BDC_TOO_MANY_MOTORS);
+
+    drv = &_g_bdc_drives [_g_bdc_num_drives];
+    drv->ccr_fwd = board_bdc_ccr (pwm_hdl->Instance, chan_fwd);
+    drv->ccr_rev = board_bdc_ccr (pwm_hdl->Instance, chan_rev);
+    if (drv->ccr_fwd == 0L || drv->ccr_rev == 0L)
+       return (ERR_BDC_INVALID_PARM);
+
+    rc = board_timerpwm_config_channel (pwm_module, chan_fwd, 0, TIMER_MODE_PWM, 0);
+    if (rc == 0)
+       rc = board_timerpwm_config_channel (pwm_module, chan_rev, 0, TIMER_MODE_PWM, 0);
+    if (rc < 0)
+       return (rc);
+
+    drv->motor      = motor;
+    drv->enc_tim    = enc_hdl->Instance;
+    drv->pwm_module = (uint8_t) pwm_module;
+    bdc_motor_zero (motor, drv->enc_tim->CNT);
+
+    board_disable_global_interrupts();    // the tick may already be running
+    grp->drive [grp->num_drives++] = drv;
+    board_enable_global_interrupts();
+    _g_bdc_num_drives++;
+
+    return (0);                           // denote success
+}
+
+
+/*************************************************************************
+* @brief  Start the control tick for all motors on pwm_module: runs every
+*         loop_div PWM periods, from the timer's update interrupt.
+*         This enables the PWM timer (do not call pwm_Enable() as well),
+*         and takes over its timer callback.
+*************************************************************************/
+int  board_bdc_start (unsigned int pwm_module, int loop_div)
+{
+    BDC_GROUP   *grp;
+    int         rc;
+
+    if (loop_div < 1 || loop_div > 255)
+       return (ERR_BDC_INVALID_PARM);
+    grp = board_bdc_find_group (pwm_module, 0);
+    if (grp == 0L)
+       return (ERR_BDC_INVALID_PARM);     // no motors attached to it
+
+    grp->loop_div  = (uint8_t) loop_div;
+    grp->div_count = 0;
+    memset (&grp->stats, 0, sizeof(BDC_STATS));
+    grp->stats.min_period_cycles = 0xFFFFFFFF;
+#if (BDC_USES_DWT)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(STM32F746xx) || defined(STM32F746NGHx)
+    DWT->LAR = 0xC5ACCE55;                // M7: unlock DWT for writes
+#endif
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    rc = board_timerpwm_set_callback (pwm_module, board_bdc_tick, grp);
+    if (rc == 0)
+       rc = board_timerpwm_enable (pwm_module, TIMER_PERIOD_INTERRUPT_ENABLED);
+
+    return (rc);
+}
+
+
+/*************************************************************************
+* @brief  Stop the control tick on pwm_module, and set all its motors'
+*         outputs to 0 (coast).
+*************************************************************************/
+int  board_bdc_stop (unsigned int pwm_module)
+{
+    BDC_GROUP   *grp;
+    int         i;
+
+    grp = board_bdc_find_group (pwm_module, 0);
+    if (grp == 0L)
+       return (ERR_BDC_INVALID_PARM);
+
+    board_timerpwm_set_callback (pwm_module, 0L, 0L);
+    for (i = 0;  i < grp->num_drives;  i++)
+      { *grp->drive[i]->ccr_fwd = 0;
+        *grp->drive[i]->ccr_rev = 0;
+        bdc_motor_set_mode (grp->drive[i]->motor, BDC_MODE_OFF);
+      }
+
+    return (0);                           // denote success
+}
+
+
+/*************************************************************************
+* @brief  Return the control tick statistics for pwm_module's motors.
+*************************************************************************/
+int  board_bdc_get_stats (unsigned int pwm_module, BDC_STATS *stats)
+{
+    BDC_GROUP   *grp;
+
+    grp = board_bdc_find_group (pwm_module, 0);
+    if (grp == 0L || stats == 0L)
+       return (ERR_BDC_INVALID_PARM);
+
+    board_disable_global_interrupts();    // consistent snapshot
+    *stats = grp->stats;
+    board_enable_global_interrupts();
+
+    return (0);                           // denote success
+}
+
+
+/*************************************************************************
+* @brief  PWM timer update interrupt callback:  every loop_div periods,
+*         run one step of each attached motor, and write its CCRs.
+*************************************************************************/
+static void  board_bdc_tick (void *callback_parm, int rupt_id)
+{
+    BDC_GROUP   *grp;
+    BDC_DRIVE   *drv;
+    uint32_t    t_start;
+    uint32_t    cycles;
+    uint32_t    arr;
+    int32_t     duty;
+    int         i;
+
+    if (rupt_id != TIMER_ROLLOVER_INTERRUPT)
+       return;
+    grp = (BDC_GROUP*) callback_parm;
+    if (++grp->div_count < grp->loop_div)
+       return;
+    grp->div_count = 0;
+
+    t_start = BDC_CYCLES();
+    if (grp->stats.ticks != 0)
+       { cycles = t_start - grp->last_start;
+         if (cycles > grp->stats.max_period_cycles)
+            grp->stats.max_period_cycles = cycles;
+         if (cycles < grp->stats.min_period_cycles)
+            grp->stats.min_period_cycles = cycles;
+       }
+    grp->last_start = t_start;
+
+    arr = grp->pwm_tim->ARR;
+    for (i = 0;  i < grp->num_drives;  i++)
+      { drv  = grp->drive [i];
+        duty = bdc_motor_step (drv->motor, drv->enc_tim->CNT);
+        if (duty >= 0)
+           { *drv->ccr_rev = 0;
+             *drv->ccr_fwd = ((uint32_t) duty * arr) >> 15;
+           }
+           else { *drv->ccr_fwd = 0;
+                  *drv->ccr_rev = ((uint32_t) (-duty) * arr) >> 15;
+                }
+      }
+
+    cycles = BDC_CYCLES() - t_start;
+    grp->stats.ticks++;
+    grp->stats.last_cycles = cycles;
+    if (cycles > grp->stats.max_cycles)
+       grp->stats.max_cycles = cycles;
+}
+
+
+/*************************************************************************
+* @brief  Find the motor group for a PWM timer, optionally creating it.
+*************************************************************************/
+static BDC_GROUP  *board_bdc_find_group (unsigned int pwm_module, int create)
+{
+    TIM_HandleTypeDef  *pwm_hdl;
+    int                i;
+
+    for (i = 0;  i < BDC_MAX_PWM_TIMERS;  i++)
+      if (_g_bdc_groups[i].pwm_tim != 0L && _g_bdc_groups[i].pwm_module == pwm_module)
+         return (&_g_bdc_groups[i]);
+
+    if ( ! create)
+       return (0L);
+    pwm_hdl = board_timerpwm_get_handle (pwm_module);
+    for (i = 0;  i < BDC_MAX_PWM_TIMERS;  i++)
+      if (_g_bdc_groups[i].pwm_tim == 0L)
+         { _g_bdc_groups[i].pwm_module = (uint8_t) pwm_module;
+           _g_bdc_groups[i].loop_div   = 1;
+           _g_bdc_groups[i].pwm_tim    = pwm_hdl->Instance;
+           return (&_g_bdc_groups[i]);
+         }
+
+    return (0L);                          // all groups in use
+}
+
+
+/*************************************************************************
+* @brief  Address of the CCR register for a PWM channel (1-4).
+*         CCR1-CCR4 are consecutive in TIM_TypeDef.
+*************************************************************************/
+static volatile uint32_t  *board_bdc_ccr (TIM_TypeDef *tim, int chan_id)
+{
+    if (chan_id < PWM_CHANNEL_1 || chan_id > PWM_CHANNEL_4)
+       return (0L);
+
+    return (&tim->CCR1 + (chan_id - PWM_CHANNEL_1));
+}
+
+#endif                          // USES_BDC_MOTOR
+
+//*****************************************************************************
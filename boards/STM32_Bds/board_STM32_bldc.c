@@ -0,0 +1,634 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                           board_STM32_bldc.c
+//
+//
+//  Timer / ADC plumbing for the Field Oriented Control engine
+//  (common/foc_engine.c), used to drive a 3 phase BLDC / PMSM motor from
+//  a TIM1 or TIM8 advanced timer.  Enabled by USES_BLDC_FOC.
+//
+//    - The timer runs center-aligned (up/down) with 3 complementary channel
+//      pairs (CH1-3 + CH1N-3N), with dead time inserted by the timer.
+//      The repetition counter makes the update (CCR preload) event happen
+//      only at the bottom of the count, so each period is symmetric.
+//
+//    - CH4 is not an output. Its compare event, at the top of the count
+//      (less BLDC_ADC_TRIGGER_ADVANCE ticks), triggers an ADC1 injected
+//      conversion of the 2 phase current channels. At the top of the count
+//      all 3 low side FETs are on, so low side shunts see the phase currents,
+//      and this is the point furthest from any switching edge.
+//
+//    - The injected end of conversion (JEOC) interrupt runs foc_run() and
+//      writes the new CCR1-3 values. They take effect at the next bottom.
+//      That ISR is the whole current loop: nothing else is needed at
+//      thread level except setting the current references.
+//
+//  The rotor angle comes from a caller supplied callback (encoder, hall
+//  interpolation, observer), called from the ISR.  With no callback, the
+//  angle is ramped open loop by a fixed step per PWM period, which is
+//  enough to spin a motor up and to check the wiring.
+//
+//  The ISR's execution time is measured with the DWT cycle counter, and
+//  kept as last/max, so the loop's CPU budget can be checked on the target.
+//  With USES_IRQ_STATS, the ISR also records its entry latency in the
+//  IRQ_CLASS_HARD_RT stats: the timer's count at ISR entry says exactly how
+//  long ago the CC4 trigger was.  That includes the (fixed) ADC conversion
+//  time, so max - min latency is the interrupt latency jitter.
+//
+//  Supported on the F4 and F7 families (TIM8 only where the MCU has it).
+//  The other families return ERR_BLDC_NOT_SUPPORTED.
+//
+//  This module owns ADC1's injected group and ADC_IRQHandler. Regular ADC
+//  conversions (board_STM32_adcs.c) can still be used on ADC2/ADC3.
+//
+//  History:
+//    10/19/26 - Created for the BLDC FOC lab.
+//    10/19/26 - IRQ priority from the IRQ_PRIO_HARD_RT class, and trigger to
+//               ISR entry latency recorded (USES_IRQ_STATS).
+// -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "user_api.h"
+
+#if defined(USES_BLDC_FOC)
+
+#include "foc_engine.h"
+
+     //------------------------------------------------------------------------
+     //
+     // Pull in        MCU dependent #defines
+     //
+     //------------------------------------------------------------------------
+
+#if defined(STM32F401xC) || defined(STM32F401xE) || defined(STM32F411xE) \
+ || defined(STM32F446xx) || defined(STM32F746xx) || defined(STM32F746NGHx)
+#define  BLDC_SUPPORTED            1
+#endif
+
+#ifndef BLDC_ADC_TRIGGER_ADVANCE
+#define  BLDC_ADC_TRIGGER_ADVANCE  0     /* ticks before the top of the count  */
+#endif                                   /* to start sampling (covers S/H time)*/
+#ifndef BLDC_ADC_SAMPLE_TIME
+#define  BLDC_ADC_SAMPLE_TIME      ADC_SAMPLETIME_15CYCLES
+#endif
+#ifndef BLDC_ADC_IRQ_PRIORITY
+#define  BLDC_ADC_IRQ_PRIORITY  IRQ_PRIO_HARD_RT  /* current loop: motor class */
+#endif
+#define  BLDC_ADC_MIDSCALE      2048     /* 12-bit ADC, 0 A = mid scale       */
+#define  BLDC_CAL_TIMEOUT_MS     500
+
+#define  BLDC_MODE_IDLE            0
+#define  BLDC_MODE_CALIBRATE       1
+#define  BLDC_MODE_RUN             2
+
+
+#if defined(BLDC_SUPPORTED)
+
+typedef struct bldc_pin_def               /* one PWM output pin */
+   {
+       GPIO_TypeDef  *port;
+       uint16_t      pin;
+   } BLDC_PIN;
+
+    // CH1, CH2, CH3, CH1N, CH2N, CH3N.  Override with BLDC_TIM1_PINS /
+    // BLDC_TIM8_PINS in project_config_parms.h if the power stage is wired
+    // to the alternate pins.
+#ifndef BLDC_TIM1_PINS
+#define  BLDC_TIM1_PINS  { {GPIOA,GPIO_PIN_8}, {GPIOA,GPIO_PIN_9},  {GPIOA,GPIO_PIN_10}, \
+                           {GPIOB,GPIO_PIN_13},{GPIOB,GPIO_PIN_14}, {GPIOB,GPIO_PIN_15} }
+#endif
+#ifndef BLDC_TIM8_PINS
+#define  BLDC_TIM8_PINS  { {GPIOC,GPIO_PIN_6}, {GPIOC,GPIO_PIN_7},  {GPIOC,GPIO_PIN_8},  \
+                           {GPIOA,GPIO_PIN_5}, {GPIOB,GPIO_PIN_0},  {GPIOB,GPIO_PIN_1} }
+#endif
+
+    static const BLDC_PIN  _g_bldc_tim1_pins [6] = BLDC_TIM1_PINS;
+#if defined(TIM8)
+    static const BLDC_PIN  _g_bldc_tim8_pins [6] = BLDC_TIM8_PINS;
+#endif
+
+    static TIM_HandleTypeDef   _g_bldc_TimHdl;
+    static ADC_HandleTypeDef   _g_bldc_AdcHdl;
+    static TIM_TypeDef         *_g_bldc_tim    = 0L;
+    static FOC_CTL             *_g_bldc_foc    = 0L;
+    static BLDC_ANGLE_HANDLER  _g_bldc_angle_cb   = 0L;
+    static void                *_g_bldc_angle_parm = 0L;
+    static uint32_t            _g_bldc_arr     = 0;
+    static uint16_t            _g_bldc_offset_a = BLDC_ADC_MIDSCALE;
+    static uint16_t            _g_bldc_offset_b = BLDC_ADC_MIDSCALE;
+
+    static volatile uint8_t    _g_bldc_mode       = BLDC_MODE_IDLE;
+    static volatile uint16_t   _g_bldc_open_angle = 0;
+    static volatile int16_t    _g_bldc_open_step  = 0;
+    static volatile uint32_t   _g_bldc_cal_sum_a  = 0;
+    static volatile uint32_t   _g_bldc_cal_sum_b  = 0;
+    static volatile int        _g_bldc_cal_count  = 0;
+    static volatile uint32_t   _g_bldc_isr_count  = 0;
+    static volatile uint32_t   _g_bldc_isr_cycles = 0;
+    static volatile uint32_t   _g_bldc_isr_max    = 0;
+#if defined(USES_IRQ_STATS)
+    static uint32_t            _g_bldc_cycles_per_tick_q8 = 256; // CPU cycles per timer tick
+#endif
+
+void  ADC_IRQHandler (void);                       // Function Prototypes
+int   board_timerpwm_enable_clock (int module_id);
+static int      board_bldc_adc_gpio (int adc_chan, int configure);
+static int16_t  board_bldc_scale_current (uint32_t raw, uint16_t offset);
+
+#endif                          // BLDC_SUPPORTED
+
+
+/*************************************************************************
+* @brief  Setup the advanced timer for center-aligned complementary PWM,
+*         and ADC1's injected group to sample 2 phase currents at the
+*         top of each PWM period.  Outputs stay off until board_bldc_start().
+*
+*         module_id    1 (TIM1) or 8 (TIM8)
+*         pwm_hz       PWM (and current loop) rate, e.g. 20000
+*         deadtime_ns  dead time between the high and low side FETs
+*         adc_chan_a/b ADC1 channels (0-15) of the phase A and B current amps
+*         foc          FOC control block, already setup by foc_init()
+*
+* @retval 0 on success, else ERR_BLDC_xxx
+*************************************************************************/
+int  board_bldc_init (unsigned int module_id, long pwm_hz, int deadtime_ns,
+                      int adc_chan_a, int adc_chan_b, FOC_CTL *foc)
+{
+#if ! defined(BLDC_SUPPORTED)
+    return (ERR_BLDC_NOT_SUPPORTED);
+#else
+    TIM_OC_InitTypeDef       ocConfig;
+    ADC_InjectionConfTypeDef injConfig;
+    GPIO_InitTypeDef         GPIO_InitStruct;
+    const BLDC_PIN           *pins;
+    uint32_t                 timclk;
+    uint32_t                 dt_ticks;
+    uint32_t                 inj_trigger;
+    uint8_t                  gpio_af;
+    int                      i;
+    int                      rc;
+
+    if (foc == 0L || pwm_hz <= 0 || deadtime_ns < 0)
+       return (ERR_BLDC_INVALID_PARM);
+    if (board_bldc_adc_gpio(adc_chan_a,0) != 0 || board_bldc_adc_gpio(adc_chan_b,0) != 0
+       || adc_chan_a == adc_chan_b)
+       return (ERR_BLDC_INVALID_PARM);
+
+    if (module_id == 1)
+       { _g_bldc_tim = TIM1;
+         pins        = _g_bldc_tim1_pins;
+         gpio_af     = GPIO_AF1_TIM1;
+         inj_trigger = ADC_EXTERNALTRIGINJECCONV_T1_CC4;
+       }
+#if defined(TIM8)
+      else if (module_id == 8)
+       { _g_bldc_tim = TIM8;
+         pins        = _g_bldc_tim8_pins;
+         gpio_af     = GPIO_AF3_TIM8;
+         inj_trigger = ADC_EXTERNALTRIGINJECCONV_T8_CC4;
+       }
+#endif
+      else return (ERR_BLDC_INVALID_PARM);   // only TIM1/TIM8 have complementary + dead time
+
+        //---------------------------------------------------------------
+        // timer clock = PCLK2, doubled if APB2 is divided down.
+        // Center-aligned: one PWM period = 2 * ARR ticks.
+        //---------------------------------------------------------------
+    timclk = HAL_RCC_GetPCLK2Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE2) != 0)
+       timclk *= 2;
+    _g_bldc_arr = timclk / (2 * (uint32_t) pwm_hz);
+    if (_g_bldc_arr < 100 || _g_bldc_arr > 0xFFFF)
+       return (ERR_BLDC_INVALID_PARM);      // PWM rate out of range for this clock
+    dt_ticks = (((uint32_t) deadtime_ns * (timclk / 1000000UL)) + 999) / 1000;
+#if defined(USES_IRQ_STATS)
+    _g_bldc_cycles_per_tick_q8 = (uint32_t) (((uint64_t) SystemCoreClock << 8) / timclk);
+#endif
+
+    _g_bldc_foc  = foc;
+    _g_bldc_mode = BLDC_MODE_IDLE;
+
+        //---------------------------------------------------------------
+        //                     PWM  timer
+        //---------------------------------------------------------------
+    board_timerpwm_enable_clock (module_id);
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    __HAL_RCC_GPIOC_CLK_ENABLE();
+
+    GPIO_InitStruct.Mode  = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Pull  = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+    GPIO_InitStruct.Alternate = gpio_af;
+    for (i = 0;  i < 6;  i++)
+      { GPIO_InitStruct.Pin = pins[i].pin;
+        HAL_GPIO_Init (pins[i].port, &GPIO_InitStruct);
+      }
+
+    memset (&_g_bldc_TimHdl, 0, sizeof(_g_bldc_TimHdl));
+    _g_bldc_TimHdl.Instance               = _g_bldc_tim;
+    _g_bldc_TimHdl.Init.Prescaler         = 0;
+    _g_bldc_TimHdl.Init.CounterMode       = TIM_COUNTERMODE_CENTERALIGNED2; // CCxIF on up count
+    _g_bldc_TimHdl.Init.Period            = _g_bldc_arr;
+    _g_bldc_TimHdl.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
+    _g_bldc_TimHdl.Init.RepetitionCounter = 1;   // update (CCR load) at bottom only
+    if (HAL_TIM_PWM_Init(&_g_bldc_TimHdl) != HAL_OK)
+       return (ERR_BLDC_INIT_FAILED);
+
+    memset (&ocConfig, 0, sizeof(ocConfig));
+    ocConfig.OCMode       = TIM_OCMODE_PWM1;     // high side on while CNT < CCR
+    ocConfig.Pulse        = _g_bldc_arr / 2;     // 50 % = 0 V across the windings
+    ocConfig.OCPolarity   = TIM_OCPOLARITY_HIGH;
+    ocConfig.OCNPolarity  = TIM_OCNPOLARITY_HIGH;
+    ocConfig.OCFastMode   = TIM_OCFAST_DISABLE;
+    ocConfig.OCIdleState  = TIM_OCIDLESTATE_RESET;
+    ocConfig.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+    if (HAL_TIM_PWM_ConfigChannel(&_g_bldc_TimHdl, &ocConfig, TIM_CHANNEL_1) != HAL_OK
+       || HAL_TIM_PWM_ConfigChannel(&_g_bldc_TimHdl, &ocConfig, TIM_CHANNEL_2) != HAL_OK
+       || HAL_TIM_PWM_ConfigChannel(&_g_bldc_TimHdl, &ocConfig, TIM_CHANNEL_3) != HAL_OK)
+       return (ERR_BLDC_INIT_FAILED);
+
+    ocConfig.OCMode = TIM_OCMODE_TIMING;         // CH4: ADC trigger event only
+    ocConfig.Pulse  = _g_bldc_arr - BLDC_ADC_TRIGGER_ADVANCE;
+    if (HAL_TIM_OC_ConfigChannel(&_g_bldc_TimHdl, &ocConfig, TIM_CHANNEL_4) != HAL_OK)
+       return (ERR_BLDC_INIT_FAILED);
+
+    rc = board_timerpwm_set_dead_time (module_id, (int) dt_ticks, (int) dt_ticks);
+    if (rc != 0)
+       return (rc);
+
+        //---------------------------------------------------------------
+        //              ADC1  injected group  (2 channels)
+        //---------------------------------------------------------------
+    __HAL_RCC_ADC1_CLK_ENABLE();
+    board_bldc_adc_gpio (adc_chan_a, 1);         // current amp inputs to analog mode
+    board_bldc_adc_gpio (adc_chan_b, 1);
+
+    memset (&_g_bldc_AdcHdl, 0, sizeof(_g_bldc_AdcHdl));
+    _g_bldc_AdcHdl.Instance                   = ADC1;
+    _g_bldc_AdcHdl.Init.ClockPrescaler        = ADC_CLOCKPRESCALER_PCLK_DIV4;
+    _g_bldc_AdcHdl.Init.Resolution            = ADC_RESOLUTION_12B;
+    _g_bldc_AdcHdl.Init.ScanConvMode          = ENABLE;
+    _g_bldc_AdcHdl.Init.ContinuousConvMode    = DISABLE;
+    _g_bldc_AdcHdl.Init.DiscontinuousConvMode = DISABLE;
+    _g_bldc_AdcHdl.Init.NbrOfConversion       = 1;
+    _g_bldc_AdcHdl.Init.ExternalTrigConv      = ADC_SOFTWARE_START;
+    _g_bldc_AdcHdl.Init.ExternalTrigConvEdge  = ADC_EXTERNALTRIGCONVEDGE_NONE;
+    _g_bldc_AdcHdl.Init.DataAlign             = ADC_DATAALIGN_RIGHT;
+    _g_bldc_AdcHdl.Init.DMAContinuousRequests = DISABLE;
+    _g_bldc_AdcHdl.Init.EOCSelection          = ADC_EOC_SEQ_CONV;
+    if (HAL_ADC_Init(&_g_bldc_AdcHdl) != HAL_OK)
+       return (ERR_BLDC_INIT_FAILED);
+
+    memset (&injConfig, 0, sizeof(injConfig));
+    injConfig.InjectedNbrOfConversion       = 2;
+    injConfig.InjectedSamplingTime          = BLDC_ADC_SAMPLE_TIME;
+    injConfig.ExternalTrigInjecConv         = inj_trigger;
+    injConfig.ExternalTrigInjecConvEdge     = ADC_EXTERNALTRIGINJECCONVEDGE_RISING;
+    injConfig.AutoInjectedConv              = DISABLE;
+    injConfig.InjectedDiscontinuousConvMode = DISABLE;
+    injConfig.InjectedChannel               = adc_chan_a;    // -> JDR1
+    injConfig.InjectedRank                  = 1;
+    if (HAL_ADCEx_InjectedConfigChannel(&_g_bldc_AdcHdl, &injConfig) != HAL_OK)
+       return (ERR_BLDC_INIT_FAILED);
+    injConfig.InjectedChannel               = adc_chan_b;    // -> JDR2
+    injConfig.InjectedRank                  = 2;
+    if (HAL_ADCEx_InjectedConfigChannel(&_g_bldc_AdcHdl, &injConfig) != HAL_OK)
+       return (ERR_BLDC_INIT_FAILED);
+
+    HAL_NVIC_SetPriority (ADC_IRQn, BLDC_ADC_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ (ADC_IRQn);
+    if (HAL_ADCEx_InjectedStart_IT(&_g_bldc_AdcHdl) != HAL_OK)
+       return (ERR_BLDC_INIT_FAILED);
+
+        //---------------------------------------------------------------
+        // DWT cycle counter for the ISR timing stats
+        //---------------------------------------------------------------
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(STM32F746xx) || defined(STM32F746NGHx)
+    DWT->LAR = 0xC5ACCE55;                       // M7: unlock DWT for writes
+#endif
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+        //---------------------------------------------------------------
+        // start the counter and the channels, with MOE still off: the
+        // ADC is triggered every period, but the outputs stay disabled
+        //---------------------------------------------------------------
+    HAL_TIM_PWM_Start (&_g_bldc_TimHdl, TIM_CHANNEL_1);
+    HAL_TIMEx_PWMN_Start (&_g_bldc_TimHdl, TIM_CHANNEL_1);
+    HAL_TIM_PWM_Start (&_g_bldc_TimHdl, TIM_CHANNEL_2);
+    HAL_TIMEx_PWMN_Start (&_g_bldc_TimHdl, TIM_CHANNEL_2);
+    HAL_TIM_PWM_Start (&_g_bldc_TimHdl, TIM_CHANNEL_3);
+    HAL_TIMEx_PWMN_Start (&_g_bldc_TimHdl, TIM_CHANNEL_3);
+    HAL_TIM_OC_Start (&_g_bldc_TimHdl, TIM_CHANNEL_4);
+    _g_bldc_tim->BDTR &= ~TIM_BDTR_MOE;
+
+    return (0);                           // denote success
+#endif
+}
+
+
+/*************************************************************************
+* @brief  Set the rotor angle source. Called from the ADC ISR once per
+*         PWM period, it returns the electrical angle (65536 = 360 deg).
+*         Passing 0L reverts to the open loop angle ramp.
+*************************************************************************/
+int  board_bldc_set_angle_callback (BLDC_ANGLE_HANDLER callback_function,
+                                    void *callback_parm)
+{
+#if ! defined(BLDC_SUPPORTED)
+    return (ERR_BLDC_NOT_SUPPORTED);
+#else
+    _g_bldc_angle_cb   = 0L;              // never let the ISR see a mixed pair
+    _g_bldc_angle_parm = callback_parm;
+    _g_bldc_angle_cb   = callback_function;
+
+    return (0);                           // denote success
+#endif
+}
+
+
+/*************************************************************************
+* @brief  Set the open loop angle step, added to the angle every PWM
+*         period when there is no angle callback.
+*         Electrical Hz = step * pwm_hz / 65536.  Negative = reverse.
+*************************************************************************/
+int  board_bldc_set_open_loop_step (int angle_step)
+{
+#if ! defined(BLDC_SUPPORTED)
+    return (ERR_BLDC_NOT_SUPPORTED);
+#else
+    if (angle_step < -32768 || angle_step > 32767)
+       return (ERR_BLDC_INVALID_PARM);
+    _g_bldc_open_step = (int16_t) angle_step;
+
+    return (0);                           // denote success
+#endif
+}
+
+
+/*************************************************************************
+* @brief  Measure the current amps' zero current offsets, by averaging
+*         num_samples conversions with the outputs off.  Must be called
+*         with the motor stopped (not after board_bldc_start()).
+*
+* @retval 0 on success, else ERR_BLDC_xxx
+*************************************************************************/
+int  board_bldc_calibrate (int num_samples)
+{
+#if ! defined(BLDC_SUPPORTED)
+    return (ERR_BLDC_NOT_SUPPORTED);
+#else
+    uint32_t   start;
+
+    if (_g_bldc_foc == 0L || _g_bldc_mode == BLDC_MODE_RUN)
+       return (ERR_BLDC_INVALID_PARM);
+    if (num_samples <= 0 || num_samples > 65536)
+       return (ERR_BLDC_INVALID_PARM);
+
+    _g_bldc_cal_sum_a = 0;
+    _g_bldc_cal_sum_b = 0;
+    _g_bldc_cal_count = num_samples;
+    _g_bldc_mode      = BLDC_MODE_CALIBRATE;
+
+    start = HAL_GetTick();
+    while (_g_bldc_cal_count > 0)
+      { if ((HAL_GetTick() - start) > BLDC_CAL_TIMEOUT_MS)
+           { _g_bldc_mode = BLDC_MODE_IDLE;
+             return (ERR_BLDC_INIT_FAILED);     // ADC is not being triggered
+           }
+      }
+
+    _g_bldc_offset_a = (uint16_t) (_g_bldc_cal_sum_a / num_samples);
+    _g_bldc_offset_b = (uint16_t) (_g_bldc_cal_sum_b / num_samples);
+
+    return (0);                           // denote success
+#endif
+}
+
+
+/*************************************************************************
+* @brief  Start the current loop and turn on the PWM outputs (MOE).
+*         The PI integrators are cleared, and the outputs start at 50 %.
+*************************************************************************/
+int  board_bldc_start (void)
+{
+#if ! defined(BLDC_SUPPORTED)
+    return (ERR_BLDC_NOT_SUPPORTED);
+#else
+    if (_g_bldc_foc == 0L)
+       return (ERR_BLDC_INVALID_PARM);
+
+    _g_bldc_mode = BLDC_MODE_IDLE;        // keep the ISR out while we reset
+    foc_reset (_g_bldc_foc);
+    _g_bldc_tim->CCR1 = _g_bldc_arr / 2;
+    _g_bldc_tim->CCR2 = _g_bldc_arr / 2;
+    _g_bldc_tim->CCR3 = _g_bldc_arr / 2;
+    _g_bldc_isr_max   = 0;
+    _g_bldc_mode      = BLDC_MODE_RUN;
+    _g_bldc_tim->BDTR |= TIM_BDTR_MOE;    // outputs on
+
+    return (0);                           // denote success
+#endif
+}
+
+
+/*************************************************************************
+* @brief  Turn off the PWM outputs (all FETs off) and stop the loop.
+*************************************************************************/
+int  board_bldc_stop (void)
+{
+#if ! defined(BLDC_SUPPORTED)
+    return (ERR_BLDC_NOT_SUPPORTED);
+#else
+    if (_g_bldc_tim == 0L)
+       return (ERR_BLDC_INVALID_PARM);
+
+    _g_bldc_tim->BDTR &= ~TIM_BDTR_MOE;   // outputs off first
+    _g_bldc_mode = BLDC_MODE_IDLE;
+
+    return (0);                           // denote success
+#endif
+}
+
+
+/*************************************************************************
+* @brief  Return the current loop ISR statistics:  # of ISRs, and the
+*         last and max ISR execution times in CPU cycles.
+*************************************************************************/
+int  board_bldc_get_stats (uint32_t *isr_count, uint32_t *last_cycles,
+                           uint32_t *max_cycles)
+{
+#if ! defined(BLDC_SUPPORTED)
+    return (ERR_BLDC_NOT_SUPPORTED);
+#else
+    if (isr_count != 0L)
+       *isr_count = _g_bldc_isr_count;
+    if (last_cycles != 0L)
+       *last_cycles = _g_bldc_isr_cycles;
+    if (max_cycles != 0L)
+       *max_cycles = _g_bldc_isr_max;
+
+    return (0);                           // denote success
+#endif
+}
+
+
+#if defined(BLDC_SUPPORTED)
+
+/*************************************************************************
+* @brief  ADC1 interrupt:  the injected conversions are done. This is the
+*         FOC current loop.
+*************************************************************************/
+void  ADC_IRQHandler (void)
+{
+    uint32_t   t_start;
+    uint32_t   raw_a,  raw_b;
+    uint32_t   cycles;
+    uint16_t   angle;
+    FOC_CTL    *foc;
+#if defined(USES_IRQ_STATS)
+    uint32_t   cnt;
+    uint32_t   trig_ticks;
+
+    cnt = _g_bldc_tim->CNT;                       // grab it first thing
+#endif
+
+    if ((ADC1->SR & ADC_SR_JEOC) == 0)
+       return;
+    t_start  = DWT->CYCCNT;
+    ADC1->SR = ~(ADC_SR_JEOC | ADC_SR_JSTRT);    // rc_w0: clear just these
+    raw_a = ADC1->JDR1;
+    raw_b = ADC1->JDR2;
+    _g_bldc_isr_count++;
+
+    if (_g_bldc_mode == BLDC_MODE_RUN)
+       { foc = _g_bldc_foc;
+         if (_g_bldc_angle_cb != 0L)
+            angle = (_g_bldc_angle_cb) (_g_bldc_angle_parm);
+            else { _g_bldc_open_angle += _g_bldc_open_step;
+                   angle = _g_bldc_open_angle;
+                 }
+
+         foc_run (foc, board_bldc_scale_current(raw_a, _g_bldc_offset_a),
+                  board_bldc_scale_current(raw_b, _g_bldc_offset_b), angle);
+
+                   // loaded by the timer at the next bottom of the count
+         _g_bldc_tim->CCR1 = ((uint32_t) foc->duty[0] * _g_bldc_arr) >> 15;
+         _g_bldc_tim->CCR2 = ((uint32_t) foc->duty[1] * _g_bldc_arr) >> 15;
+         _g_bldc_tim->CCR3 = ((uint32_t) foc->duty[2] * _g_bldc_arr) >> 15;
+       }
+      else if (_g_bldc_mode == BLDC_MODE_CALIBRATE && _g_bldc_cal_count > 0)
+       { _g_bldc_cal_sum_a += raw_a;
+         _g_bldc_cal_sum_b += raw_b;
+         _g_bldc_cal_count--;
+         if (_g_bldc_cal_count == 0)
+            _g_bldc_mode = BLDC_MODE_IDLE;
+       }
+
+    cycles = DWT->CYCCNT - t_start;
+    _g_bldc_isr_cycles = cycles;
+    if (cycles > _g_bldc_isr_max)
+       _g_bldc_isr_max = cycles;
+
+#if defined(USES_IRQ_STATS)
+        //---------------------------------------------------------------
+        // Ticks since the CC4 trigger at ARR - ADVANCE on the up count.
+        // Past the top of the count the timer is counting down. Still
+        // below the trigger point on the up count = over a period late.
+        //---------------------------------------------------------------
+    if (_g_bldc_tim->CR1 & TIM_CR1_DIR)
+       trig_ticks = BLDC_ADC_TRIGGER_ADVANCE + (_g_bldc_arr - cnt);
+       else if (cnt >= _g_bldc_arr - BLDC_ADC_TRIGGER_ADVANCE)
+               trig_ticks = cnt - (_g_bldc_arr - BLDC_ADC_TRIGGER_ADVANCE);
+       else trig_ticks = (2 * _g_bldc_arr) + cnt - (_g_bldc_arr - BLDC_ADC_TRIGGER_ADVANCE);
+    board_irq_stats_record (IRQ_CLASS_HARD_RT,
+                            (trig_ticks * _g_bldc_cycles_per_tick_q8) >> 8,
+                            cycles);
+#endif
+}
+
+
+/*************************************************************************
+* @brief  Raw 12-bit ADC value to a Q15 current (1.0 = amp full scale).
+*         Define BLDC_CURRENT_INVERT if the amp's output falls with
+*         positive (into the motor) phase current.
+*************************************************************************/
+static int16_t  board_bldc_scale_current (uint32_t raw, uint16_t offset)
+{
+    int32_t   value;
+
+    value = ((int32_t) raw - (int32_t) offset) << 4;
+#if defined(BLDC_CURRENT_INVERT)
+    value = -value;
+#endif
+    if (value > 32767)
+       value = 32767;
+       else if (value < -32767)
+               value = -32767;
+
+    return ((int16_t) value);
+}
+
+
+/*************************************************************************
+* @brief  Validate an ADC1 channel (0-15), and if configure is set,
+*         set its GPIO to analog mode.
+*
+* @retval 0 on success, ERR_BLDC_INVALID_PARM if not a GPIO channel.
+*************************************************************************/
+static int  board_bldc_adc_gpio (int adc_chan, int configure)
+{
+    GPIO_InitTypeDef   GPIO_InitStruct;
+    GPIO_TypeDef       *port;
+    uint16_t           pin;
+
+    if (adc_chan < 0 || adc_chan > 15)
+       return (ERR_BLDC_INVALID_PARM);
+    if (adc_chan <= 7)
+       { port = GPIOA;   pin = (uint16_t) (1 << adc_chan); }         // PA0-PA7
+       else if (adc_chan <= 9)
+       { port = GPIOB;   pin = (uint16_t) (1 << (adc_chan - 8)); }   // PB0-PB1
+       else
+       { port = GPIOC;   pin = (uint16_t) (1 << (adc_chan - 10)); }  // PC0-PC5
+
+    if ( ! configure)
+       return (0);                        // validate only
+
+    GPIO_InitStruct.Pin   = pin;
+    GPIO_InitStruct.Mode  = GPIO_MODE_ANALOG;
+    GPIO_InitStruct.Pull  = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    GPIO_InitStruct.Alternate = 0;
+    HAL_GPIO_Init (port, &GPIO_InitStruct);
+
+    return (0);
+}
+
+#endif                          // BLDC_SUPPORTED
+
+#endif                          // USES_BLDC_FOC
+
+//*****************************************************************************
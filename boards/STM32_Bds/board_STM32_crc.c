@@ -0,0 +1,337 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                           board_STM32_crc.c
+//
+//
+//  Common Logic for the CRC unit on STM32 MCUs, as used by the unified CRC
+//  engine (common/crc_engine.c) when USES_CRC_HW is defined.
+//
+//  There are two flavors of STM32 CRC unit:
+//
+//    - F0, F3, F7, L0, L4:  have INIT and input bit reversal. Most also have
+//      a programmable polynomial (CRC_CR_POLYSIZE), so they do all three of
+//      CRC-16/Modbus, CRC-16/CCITT and CRC-32.  Data is fed a byte at a time
+//      (CPU, or DMA with CRC_USES_DMA) so no byte order fixups are needed.
+//      F030/F070 have the fixed CRC-32 polynomial only.
+//
+//    - F1, F2, F4, L1:  fixed CRC-32 polynomial, 32-bit words only, MSB
+//      first, and no INIT register (DR always resets to 0xFFFFFFFF).
+//      Standard (LSB first) CRC-32 is done by feeding bit reversed words
+//      (RBIT), and a running CRC is re-loaded by first writing the one
+//      "seed" word that takes the unit from 0xFFFFFFFF to that value.
+//      Any trailing 1-3 bytes are left for software. The RBIT can not be
+//      done by DMA, so these are always CPU fed.
+//
+//  The unit holds one CRC at a time. If it is already in use (an ISR CRC
+//  interrupted a thread level one) board_crc_hw_update() returns
+//  ERR_CRC_HW_UNAVAILABLE, and the engine does that chunk in software.
+//
+//  History:
+//    10/19/26 - Created for the unified CRC engine.
+// -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "user_api.h"
+
+#if defined(USES_CRC_HW)
+
+#include "crc_engine.h"
+
+     //------------------------------------------------------------------------
+     //
+     // Pull in        MCU dependent #defines
+     //
+     //------------------------------------------------------------------------
+
+#if defined(CRC_CR_REV_IN)
+#define  CRC_HAS_INIT          1         // INIT register + input reversal
+#endif
+
+#if defined(CRC_USES_DMA) && defined(CRC_HAS_INIT)
+    // memory-to-memory capable DMA stream/channel to feed the CRC unit.
+    // Override in project_config_parms.h if it clashes with the App's DMA.
+#if defined(STM32F746xx)
+#ifndef CRC_DMA_INSTANCE
+#define  CRC_DMA_INSTANCE      DMA2_Stream6
+#define  CRC_DMA_CHANNEL       DMA_CHANNEL_0
+#define  CRC_DMA_CLK_ENABLE()  __HAL_RCC_DMA2_CLK_ENABLE()
+#endif
+#elif defined(STM32L476xx)
+#ifndef CRC_DMA_INSTANCE
+#define  CRC_DMA_INSTANCE      DMA2_Channel6
+#define  CRC_DMA_REQUEST       DMA_REQUEST_0
+#define  CRC_DMA_CLK_ENABLE()  __HAL_RCC_DMA2_CLK_ENABLE()
+#endif
+#elif defined(STM32F072xB) || defined(STM32F091xC) || defined(STM32F303xC) || defined(STM32F303xE) || defined(STM32F334x8)
+#ifndef CRC_DMA_INSTANCE
+#define  CRC_DMA_INSTANCE      DMA1_Channel5
+#define  CRC_DMA_CLK_ENABLE()  __HAL_RCC_DMA1_CLK_ENABLE()
+#endif
+#endif
+#endif                          // CRC_USES_DMA
+
+     //------------------------------------------------------------------------
+     //  Polynomials, in the unit's MSB first form
+     //------------------------------------------------------------------------
+#define  CRC_POLY_MODBUS       0x8005
+#define  CRC_POLY_CCITT        0x1021
+#define  CRC_POLY_32           0x04C11DB7UL
+
+    static volatile uint8_t    _g_crc_hw_busy      = 0;
+    static uint8_t             _g_crc_hw_clock_on  = 0;
+#if defined(CRC_DMA_INSTANCE)
+    static DMA_HandleTypeDef   _g_crc_dma_handle;
+    static uint8_t             _g_crc_dma_inited   = 0;
+#endif
+
+static uint32_t  board_crc_reflect (uint32_t value, int width);
+#if ! defined(CRC_HAS_INIT)
+static uint32_t  board_crc_seed_word (uint32_t target);
+#endif
+#if defined(CRC_DMA_INSTANCE)
+static int       board_crc_dma_feed (const uint8_t *buf, int length);
+#endif
+
+
+/*************************************************************************
+* @brief  Run a chunk of data through the CRC unit, starting from (and
+*         updating) the running CRC *crc, in crc_engine's form: the LSB
+*         first register for reflected algos, MSB first for CRC_16_CCITT.
+*
+* @retval # bytes processed (the front of buf), or ERR_CRC_HW_UNAVAILABLE
+*         if the unit can not do that algo, or is busy.
+*************************************************************************/
+int  board_crc_hw_update (int algo, uint32_t *crc, const uint8_t *buf,
+                          int length)
+{
+    uint32_t   int_state;
+    uint32_t   state;
+    int        done;
+#if defined(CRC_HAS_INIT)
+    uint32_t   cr;
+    int        width;
+#else
+    uint32_t   word;
+#endif
+
+#if ! defined(CRC_CR_POLYSIZE)
+    if (algo != CRC_32)
+       return (ERR_CRC_HW_UNAVAILABLE);   // fixed CRC-32 polynomial only
+#endif
+#if ! defined(CRC_HAS_INIT)
+    if (length < 4)
+       return (ERR_CRC_HW_UNAVAILABLE);   // unit is 32-bit words only
+#endif
+
+    int_state = __get_PRIMASK();
+    __disable_irq();                      // claim the unit
+    if (_g_crc_hw_busy)
+       { __set_PRIMASK (int_state);
+         return (ERR_CRC_HW_UNAVAILABLE); // an interrupted CRC is using it
+       }
+    _g_crc_hw_busy = 1;
+    __set_PRIMASK (int_state);
+
+    if ( ! _g_crc_hw_clock_on)
+       {
+#if defined(__HAL_RCC_CRC_CLK_ENABLE)
+         __HAL_RCC_CRC_CLK_ENABLE();      // turn on CRC module's clocks
+#else
+         __CRC_CLK_ENABLE();
+#endif
+         _g_crc_hw_clock_on = 1;
+       }
+
+#if defined(CRC_HAS_INIT)
+            //---------------------------------------------------------------
+            // Load the running CRC into INIT (MSB first form), then feed
+            // bytes. Reflected algos get each input byte bit reversed.
+            //---------------------------------------------------------------
+    width = (algo == CRC_32) ? 32 : 16;
+    cr    = 0;
+    if (algo != CRC_16_CCITT)
+       cr |= CRC_CR_REV_IN_0;             // bit reversal done by byte
+#if defined(CRC_CR_POLYSIZE)
+    if (width == 16)
+       cr |= CRC_CR_POLYSIZE_0;           // 16-bit polynomial
+    CRC->POL = (algo == CRC_32) ? CRC_POLY_32
+             : (algo == CRC_16_CCITT) ? CRC_POLY_CCITT : CRC_POLY_MODBUS;
+#endif
+    CRC->CR   = cr;
+    CRC->INIT = (algo == CRC_16_CCITT) ? *crc : board_crc_reflect (*crc, width);
+    CRC->CR   = cr | CRC_CR_RESET;        // DR = INIT
+
+    done = 0;
+#if defined(CRC_DMA_INSTANCE)
+    if (length >= CRC_DMA_MIN_LENGTH)
+       { done = board_crc_dma_feed (buf, length);
+         if (done < 0)
+            { _g_crc_hw_busy = 0;         // *crc is untouched, so the engine
+              return (ERR_CRC_HW_UNAVAILABLE);  // redoes it all in software
+            }
+       }
+#endif
+    for ( ;  done < length;  done++)
+       *(__IO uint8_t*) &CRC->DR = buf[done];
+
+    state = CRC->DR;
+    if (width == 16)
+       state &= 0xFFFF;
+
+#else
+            //---------------------------------------------------------------
+            // F1/F2/F4/L1: DR resets to 0xFFFFFFFF, and MSB first words.
+            // Write the seed word that moves it to the running CRC, then
+            // RBIT'ed data words. RBIT of a little endian word puts byte 0's
+            // bit 0 at bit 31, which is what an LSB first CRC processes first.
+            //---------------------------------------------------------------
+    CRC->CR = CRC_CR_RESET;
+    state   = board_crc_reflect (*crc, 32);
+    if (state != 0xFFFFFFFFUL)
+       CRC->DR = board_crc_seed_word (state);
+    for (done = 0;  done + 4 <= length;  done += 4)
+      { memcpy (&word, &buf[done], 4);    // buf may not be word aligned
+        CRC->DR = __RBIT (word);
+      }
+    state = CRC->DR;
+#endif
+
+    *crc = (algo == CRC_16_CCITT) ? state
+         : board_crc_reflect (state, (algo == CRC_32) ? 32 : 16);
+
+    _g_crc_hw_busy = 0;                   // release the unit
+
+    return (done);
+}
+
+
+/*************************************************************************
+* @brief  Reverse the low width bits of value.
+*************************************************************************/
+static uint32_t  board_crc_reflect (uint32_t value, int width)
+{
+#if defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+    value = __RBIT (value);
+#else
+    uint32_t   result;                  // M0/M0+ have no RBIT instruction
+    int        i;
+
+    for (i = 0, result = 0;  i < 32;  i++, value >>= 1)
+       result = (result << 1) | (value & 1);
+    value = result;
+#endif
+    return (width == 32 ? value : (value >> (32 - width)));
+}
+
+
+#if ! defined(CRC_HAS_INIT)
+/*************************************************************************
+* @brief  Compute the data word that takes the CRC unit from its reset
+*         value (0xFFFFFFFF) to target.
+*
+*         Writing word w does  DR = step32 (DR ^ w),  where step32 is 32
+*         shifts of the polynomial. That is invertible (the polynomial's
+*         bit 0 is set, so bit 0 of each result tells if a 1 was shifted
+*         out), so we undo the 32 shifts, then xor out the reset value.
+*************************************************************************/
+static uint32_t  board_crc_seed_word (uint32_t target)
+{
+    int        i;
+
+    for (i = 0;  i < 32;  i++)
+       {
+         if (target & 1)
+            target = ((target ^ CRC_POLY_32) >> 1) | 0x80000000UL;
+            else target = target >> 1;
+       }
+
+    return (target ^ 0xFFFFFFFFUL);
+}
+#endif
+
+
+#if defined(CRC_DMA_INSTANCE)
+/*************************************************************************
+* @brief  Feed buf into the CRC DR with a memory-to-memory DMA, byte wide.
+*         Polled: the caller waits, but the bytes go in at bus speed
+*         rather than CPU loop speed.
+*
+* @retval # bytes fed (0 if the DMA could not be set up: CPU does them),
+*         or -1 if a transfer failed part way (unit state is unknown).
+*************************************************************************/
+static int  board_crc_dma_feed (const uint8_t *buf, int length)
+{
+    int        done;
+    int        chunk;
+
+    if ( ! _g_crc_dma_inited)
+       {
+         CRC_DMA_CLK_ENABLE();
+         memset (&_g_crc_dma_handle, 0, sizeof(_g_crc_dma_handle));
+         _g_crc_dma_handle.Instance                 = CRC_DMA_INSTANCE;
+#if defined(CRC_DMA_CHANNEL)
+         _g_crc_dma_handle.Init.Channel             = CRC_DMA_CHANNEL;
+         _g_crc_dma_handle.Init.FIFOMode            = DMA_FIFOMODE_ENABLE;
+         _g_crc_dma_handle.Init.FIFOThreshold       = DMA_FIFO_THRESHOLD_FULL;
+         _g_crc_dma_handle.Init.MemBurst            = DMA_MBURST_SINGLE;
+         _g_crc_dma_handle.Init.PeriphBurst         = DMA_PBURST_SINGLE;
+#endif
+#if defined(CRC_DMA_REQUEST)
+         _g_crc_dma_handle.Init.Request             = CRC_DMA_REQUEST;
+#endif
+            // for memory-to-memory, the "peripheral" side is the source
+         _g_crc_dma_handle.Init.Direction           = DMA_MEMORY_TO_MEMORY;
+         _g_crc_dma_handle.Init.PeriphInc           = DMA_PINC_ENABLE;
+         _g_crc_dma_handle.Init.MemInc              = DMA_MINC_DISABLE;
+         _g_crc_dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+         _g_crc_dma_handle.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+         _g_crc_dma_handle.Init.Mode                = DMA_NORMAL;
+         _g_crc_dma_handle.Init.Priority            = DMA_PRIORITY_LOW;
+         if (HAL_DMA_Init(&_g_crc_dma_handle) != HAL_OK)
+            return (0);
+         _g_crc_dma_inited = 1;
+       }
+
+    for (done = 0;  done < length;  done += chunk)
+      {
+        chunk = (length - done) > 0xFFFF ? 0xFFFF : (length - done);
+        if (HAL_DMA_Start(&_g_crc_dma_handle, (uint32_t) &buf[done],
+                          (uint32_t) &CRC->DR, chunk) != HAL_OK)
+           break;
+        if (HAL_DMA_PollForTransfer(&_g_crc_dma_handle, HAL_DMA_FULL_TRANSFER,
+                                    100) != HAL_OK)
+           { HAL_DMA_Abort (&_g_crc_dma_handle);
+             _g_crc_dma_inited = 0;       // re-init it next time
+             return (-1);                 // unit state unknown
+           }
+      }
+
+    return (done);
+}
+#endif
+
+#endif                          // USES_CRC_HW
+
+/******************************************************************************/
@@ -34,6 +34,7 @@
 //    12/30/14 - Created for Industrial IoT OpenSource project.  Duq
 //    06/08/15 - Integrate in ADC, PWM, CRC changes to match rest of STM32 bds.
 //    07/31/15 - Reworked to provide better factoring for DAC support. Duq
+//    10/19/26 - DMA IRQs use the IRQ_PRIO_HARD_RT class.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -793,7 +794,7 @@ volatile long  period_ticks;
        {     //-----------------------------------------------------------------
              // Configure the NVIC interrupt for the DMA used for DAC Channel 1
              //-----------------------------------------------------------------
-         HAL_NVIC_SetPriority (DAC_CHAN_1_NVIC_IRQn, 2, 0);
+         HAL_NVIC_SetPriority (DAC_CHAN_1_NVIC_IRQn, IRQ_PRIO_HARD_RT, 0);
          HAL_NVIC_EnableIRQ (DAC_CHAN_1_NVIC_IRQn);   // will invoke DMA1_Channel2_3_IRQHandler()
 
              //---------------------------------------------------
@@ -811,7 +812,7 @@ volatile long  period_ticks;
        {     //-----------------------------------------------------------------
              // Configure the NVIC interrupt for the DMA used for DAC Channel 2
              //-----------------------------------------------------------------
-         HAL_NVIC_SetPriority (DAC_CHAN_2_NVIC_IRQn, 2, 0);
+         HAL_NVIC_SetPriority (DAC_CHAN_2_NVIC_IRQn, IRQ_PRIO_HARD_RT, 0);
          HAL_NVIC_EnableIRQ (DAC_CHAN_2_NVIC_IRQn);   // will invoke DMA1_Channel4_5_IRQHandler()
 
              //---------------------------------------------------
@@ -20,6 +20,7 @@
 //    05/30/15 - Created for Industrial IoT OpenSource project.  Duq
 //    07/30/15 - Reworked to provide better factoring. Worked first shot. Duq
 //    08/10/15 - Tweaked Interrrupt Handling. Duquaine
+//    10/19/26 - I2C and DMA IRQs use the IRQ_PRIO_COMMS class.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -377,7 +378,7 @@ init_pI2cHdl   = pI2cHdl;          // DEBUG ONLY
          //    I2C2  DMA and Interrupts  Enable
          //----------------------------------------
     board_i2c_dma_init();
-    HAL_NVIC_SetPriority (I2C2_IRQn, 0, 0);
+    HAL_NVIC_SetPriority (I2C2_IRQn, IRQ_PRIO_COMMS, 0);
     HAL_NVIC_EnableIRQ (I2C2_IRQn);
 #endif
 
@@ -522,11 +523,11 @@ init_pI2cHdl   = pI2cHdl;          // DEBUG ONLY
 
       /*##-4- Configure the NVIC for DMA #########################################*/
       /* NVIC configuration for DMA transfer complete interrupt (I2C3_TX) */
-  HAL_NVIC_SetPriority (I2Cx_DMA_TX_IRQn, 0, 1);
+  HAL_NVIC_SetPriority (I2Cx_DMA_TX_IRQn, IRQ_PRIO_COMMS, 0);
   HAL_NVIC_EnableIRQ (I2Cx_DMA_TX_IRQn);
 
       /* NVIC configuration for DMA transfer complete interrupt (I2C3_RX) */
-  HAL_NVIC_SetPriority (I2Cx_DMA_RX_IRQn, 0, 0);
+  HAL_NVIC_SetPriority (I2Cx_DMA_RX_IRQn, IRQ_PRIO_COMMS, 0);
   HAL_NVIC_EnableIRQ (I2Cx_DMA_RX_IRQn);
 #endif                                        //  #if defined(USE_DMA)
 
@@ -573,9 +574,9 @@ void  board_i2c_dma_init (void)
         //--------------------------------------------
         //    DMA interrupts init
         //--------------------------------------------
-    HAL_NVIC_SetPriority (DMA1_Channel4_IRQn, 0, 0);   // I2C RX
+    HAL_NVIC_SetPriority (DMA1_Channel4_IRQn, IRQ_PRIO_COMMS, 0);   // I2C RX
     HAL_NVIC_EnableIRQ (DMA1_Channel4_IRQn);
-    HAL_NVIC_SetPriority (DMA1_Channel5_IRQn, 0, 0);   // I2C TX
+    HAL_NVIC_SetPriority (DMA1_Channel5_IRQn, IRQ_PRIO_COMMS, 0);   // I2C TX
     HAL_NVIC_EnableIRQ (DMA1_Channel5_IRQn);
 #endif
 }
@@ -0,0 +1,314 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                           board_STM32_irq.c
+//
+//
+//  Board level interrupt plan:  deferred bottom halves, and ISR timing
+//  per priority class.
+//
+//  The priority classes themselves need no code here: board_irq_plan_init()
+//  in board.c (called from board_init) sets the NVIC to all pre-emption
+//  bits, SysTick to IRQ_PRIO_HOUSEKEEP and PendSV to IRQ_PRIO_BOTTOM_HALF,
+//  and the drivers set their own IRQs to the classes in boarddef.h
+//  (IRQ_PRIO_HARD_RT, IRQ_PRIO_COMMS, ...). This file is only needed in
+//  the build with USES_IRQ_BOTTOM_HALF or USES_IRQ_STATS.
+//
+//  Bottom halves  (USES_IRQ_BOTTOM_HALF)
+//  -------------
+//  A driver or App registers a handler once, at thread level:
+//
+//      bh_id = board_bh_register (my_handler, my_parm);
+//
+//  and its ISR then does the minimum (clear the hardware, grab the data)
+//  and calls board_bh_schedule (bh_id, events).  That ORs the event bits
+//  into the handler's pending set, and pends PendSV. PendSV_Handler calls
+//  board_bh_dispatch(), which runs every handler with events, lowest id
+//  (first registered) first.  PendSV is the lowest priority, so the
+//  handlers run right after the last nested ISR returns, ahead of the main
+//  loop, but every ISR can pre-empt them.  If an ISR schedules a handler
+//  again before it has run, the events merge into one run (counted in
+//  BH_STATS.coalesced: a sign the handler can not keep up).
+//
+//  The board uses this for timer_Set_Callback_Deferred() and
+//  adc_Set_Callback_Deferred(), so App callbacks (e.g. a stepper's step
+//  clock handler) no longer add to the HARD_RT ISR time.
+//
+//  Do not use with an RTOS that owns PendSV for its context switch.
+//
+//  ISR timing  (USES_IRQ_STATS, Cortex-M3/M4/M7 - uses the DWT counter)
+//  ----------
+//  ISRs record their run time, and when they can tell their entry latency,
+//  per priority class with board_irq_stats_record(). For the HARD_RT
+//  class, the timer update ISRs and the BLDC current loop can tell (the
+//  timer's CNT at entry is the time since the event); the ADC DMA ISRs
+//  record run time only. The bottom half dispatcher records each run
+//  as IRQ_CLASS_BOTTOM_HALF, with schedule to run latency.
+//  board_irq_get_stats() returns the min/max per class, so the worst case
+//  HARD_RT latency can be checked on the target, under the real load.
+//
+//  History:
+//    10/19/26 - Created for the interrupt priority plan.
+// -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "user_api.h"
+#include <string.h>
+
+#if BH_MAX_HANDLERS > 32
+#error "BH_MAX_HANDLERS must be <= 32 (one pending bit each)"
+#endif
+
+            // a few instruction critical section, usable from any level
+#define  IRQ_LOCK()     uint32_t int_state = __get_PRIMASK();  __disable_irq()
+#define  IRQ_UNLOCK()   __set_PRIMASK (int_state)
+
+#if defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+#define  IRQ_HAS_GROUPING    1          // M3+: priority grouping, DWT, CLZ/RBIT
+#else
+#define  IRQ_HAS_GROUPING    0
+#endif
+
+
+#if defined(USES_IRQ_STATS)
+    static IRQ_CLASS_STATS   _g_irq_class_stats [IRQ_NUM_CLASSES];
+#endif
+
+#if defined(USES_IRQ_BOTTOM_HALF)
+typedef struct bh_entry_def              /* one registered bottom half */
+   {
+       BH_EVENT_HANDLER   handler;
+       void               *parm;
+       uint32_t           events;        // pending events, ORed in by schedule
+       uint32_t           sched_cycles;  // IRQ_CYCLE_COUNT() at first schedule
+       BH_STATS           stats;
+   } BH_ENTRY;
+
+    static BH_ENTRY            _g_bh_table [BH_MAX_HANDLERS];
+    static volatile uint32_t   _g_bh_pending = 0;   // bit n = entry n has events
+    static volatile int        _g_bh_count   = 0;   // # entries registered
+#endif
+
+
+//*****************************************************************************
+//  board_irq_stats_record
+//
+//          Called by an ISR at its exit: add one run to its class's stats.
+//          latency_cycles is from the hardware event to the ISR's entry, or
+//          IRQ_LATENCY_UNKNOWN.  A no-op unless USES_IRQ_STATS.
+//*****************************************************************************
+void  board_irq_stats_record (int irq_class, uint32_t latency_cycles,
+                              uint32_t run_cycles)
+{
+#if defined(USES_IRQ_STATS)
+    IRQ_CLASS_STATS  *st;
+
+    if ((unsigned int) irq_class >= IRQ_NUM_CLASSES)
+       return;
+    st = &_g_irq_class_stats [irq_class];
+    {
+      IRQ_LOCK();                       // a class may have been overridden to
+      st->count++;                      // share levels: keep the update whole
+      if (latency_cycles != IRQ_LATENCY_UNKNOWN)
+         { if (st->latency_samples++ == 0 || latency_cycles < st->min_latency_cycles)
+              st->min_latency_cycles = latency_cycles;
+           if (latency_cycles > st->max_latency_cycles)
+              st->max_latency_cycles = latency_cycles;
+         }
+      st->last_run_cycles = run_cycles;
+      if (run_cycles > st->max_run_cycles)
+         st->max_run_cycles = run_cycles;
+      IRQ_UNLOCK();
+    }
+#endif
+}
+
+
+//*****************************************************************************
+//  board_irq_get_stats
+//
+//          Return one priority class's ISR timing. reset_flag = 1 clears it.
+//*****************************************************************************
+int  board_irq_get_stats (int irq_class, IRQ_CLASS_STATS *stats, int reset_flag)
+{
+    if ((unsigned int) irq_class >= IRQ_NUM_CLASSES || stats == 0L)
+       return (ERR_IRQ_INVALID_PARM);
+
+#if defined(USES_IRQ_STATS)
+    {
+      IRQ_LOCK();
+      *stats = _g_irq_class_stats [irq_class];
+      if (reset_flag)
+         memset (&_g_irq_class_stats[irq_class], 0, sizeof(IRQ_CLASS_STATS));
+      IRQ_UNLOCK();
+    }
+#else
+    memset (stats, 0, sizeof(IRQ_CLASS_STATS));
+#endif
+    return (0);                         // denote success
+}
+
+
+#if defined(USES_IRQ_BOTTOM_HALF)
+
+//*****************************************************************************
+//  board_bh_register
+//
+//          Add a bottom half handler. Returns its id (0 = most urgent, in
+//          the order registered), for board_bh_schedule(), or an ERR_IRQ_xxx
+//          code. Handlers can not be removed: register once, at startup.
+//*****************************************************************************
+int  board_bh_register (BH_EVENT_HANDLER handler, void *parm)
+{
+    BH_ENTRY  *bh;
+    int       bh_id;
+
+    if (handler == 0L)
+       return (ERR_IRQ_INVALID_PARM);
+    {
+      IRQ_LOCK();
+      bh_id = _g_bh_count;
+      if (bh_id < BH_MAX_HANDLERS)
+         { bh = &_g_bh_table [bh_id];
+           memset (bh, 0, sizeof(BH_ENTRY));
+           bh->handler = handler;
+           bh->parm    = parm;
+           _g_bh_count = bh_id + 1;
+         }
+      IRQ_UNLOCK();
+    }
+    if (bh_id >= BH_MAX_HANDLERS)
+       return (ERR_IRQ_BH_TABLE_FULL);
+
+    return (bh_id);
+}
+
+
+//*****************************************************************************
+//  board_bh_schedule
+//
+//          Called from an ISR (or thread level): OR events into the handler's
+//          pending set and pend PendSV. events must be non-zero; it is
+//          passed to the handler, so an ISR can say what happened (e.g.
+//          1 << interrupt type).
+//*****************************************************************************
+int  board_bh_schedule (int bh_id, uint32_t events)
+{
+    BH_ENTRY  *bh;
+
+    if ((unsigned int) bh_id >= (unsigned int) _g_bh_count || events == 0)
+       return (ERR_IRQ_INVALID_PARM);
+
+    bh = &_g_bh_table [bh_id];
+    {
+      IRQ_LOCK();
+      if (bh->events == 0)
+         bh->sched_cycles = IRQ_CYCLE_COUNT();  // latency is from the first one
+         else bh->stats.coalesced++;
+      bh->events    |= events;
+      _g_bh_pending |= (1UL << bh_id);
+      IRQ_UNLOCK();
+    }
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;         // run board_bh_dispatch()
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  board_bh_dispatch
+//
+//          Run every bottom half that has events. Called by PendSV_Handler.
+//          Rescans after each handler, so a more urgent (lower id) handler
+//          that was scheduled meanwhile runs next.
+//*****************************************************************************
+void  board_bh_dispatch (void)
+{
+    BH_ENTRY  *bh;
+    uint32_t  pending;
+    uint32_t  events;
+    uint32_t  t_sched;
+    uint32_t  t_start;
+    uint32_t  latency;
+    uint32_t  cycles;
+    int       bh_id;
+
+    while ((pending = _g_bh_pending) != 0)
+      {
+#if (IRQ_HAS_GROUPING)
+        bh_id = (int) __CLZ (__RBIT(pending));  // lowest set bit
+#else
+        for (bh_id = 0;  (pending & 1) == 0;  bh_id++)
+          pending >>= 1;
+#endif
+        bh = &_g_bh_table [bh_id];
+        {
+          IRQ_LOCK();
+          events     = bh->events;
+          t_sched    = bh->sched_cycles;
+          bh->events = 0;
+          _g_bh_pending &= ~(1UL << bh_id);
+          IRQ_UNLOCK();
+        }
+
+        t_start = IRQ_CYCLE_COUNT();
+        (bh->handler) (bh->parm, events);
+        cycles  = IRQ_CYCLE_COUNT() - t_start;
+        latency = t_start - t_sched;
+
+        bh->stats.runs++;
+        bh->stats.last_latency_cycles = latency;
+        if (latency > bh->stats.max_latency_cycles)
+           bh->stats.max_latency_cycles = latency;
+        if (cycles > bh->stats.max_run_cycles)
+           bh->stats.max_run_cycles = cycles;
+#if defined(USES_IRQ_STATS)
+        board_irq_stats_record (IRQ_CLASS_BOTTOM_HALF, latency, cycles);
+#endif
+      }
+}
+
+
+//*****************************************************************************
+//  board_bh_get_stats
+//
+//          Return one bottom half's stats. reset_flag = 1 clears them.
+//*****************************************************************************
+int  board_bh_get_stats (int bh_id, BH_STATS *stats, int reset_flag)
+{
+    if ((unsigned int) bh_id >= (unsigned int) _g_bh_count || stats == 0L)
+       return (ERR_IRQ_INVALID_PARM);
+    {
+      IRQ_LOCK();
+      *stats = _g_bh_table[bh_id].stats;
+      if (reset_flag)
+         memset (&_g_bh_table[bh_id].stats, 0, sizeof(BH_STATS));
+      IRQ_UNLOCK();
+    }
+    return (0);                         // denote success
+}
+
+#endif                          // USES_IRQ_BOTTOM_HALF
+
+//*****************************************************************************
@@ -12,6 +12,12 @@
 //
 //  History:
 //    08/03/15 - Added for Industrial IoT OpenSource project data logging.  Duq
+//    10/19/26 - Added edge aligned usec-of-day read, to discipline the
+//               64-bit timestamp service (USES_TIMESTAMP).
+//    10/19/26 - Added wakeup timer and fast sub-second count, for tickless
+//               low power idle (USES_TICKLESS_IDLE).
+//    10/19/26 - RTC IRQs use the IRQ_PRIO_HOUSEKEEP class.
+//    10/19/26 - Added backup register read/write, for warm boot state.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -257,6 +263,40 @@ void  board_rtc_enable_clocks (int module_id);
 //*****************************************************************************
 //*****************************************************************************
      RTC_HandleTypeDef    RtcHandle;
+     RTC_HandleTypeDef    RtcBkpHandle;   // backup regs only: no RTC init needed
+
+                 // # RTC backup registers (kept through standby and VBAT)
+#if defined(STM32F746xx) || defined(STM32F746NGHx) || defined(STM32L476xx)
+#define  RTC_BKP_NUM_REGS       32
+#elif defined(STM32F401xC) || defined(STM32F401xE) || defined(STM32F411xE) \
+   || defined(STM32F446xx) || defined(STM32F429xx)
+#define  RTC_BKP_NUM_REGS       20
+#elif defined(STM32F303xC) || defined(STM32F303xE) || defined(STM32F334x8)
+#define  RTC_BKP_NUM_REGS       16
+#elif defined(STM32F103xB)
+#define  RTC_BKP_NUM_REGS       10
+#define  RTC_BKP_FIRST_REG       1     /* F1 BKP data regs are numbered from 1 */
+#else
+#define  RTC_BKP_NUM_REGS        5     /* F0 / L0 / L1: use the smallest */
+#endif
+#if !defined(RTC_BKP_FIRST_REG)
+#define  RTC_BKP_FIRST_REG       0
+#endif
+
+#if defined(USES_TICKLESS_IDLE)
+                 // F0 / L0 share 1 RTC vector for alarm/wakeup/tamper
+#if defined(STM32F030x8) || defined(STM32F070xB) || defined(STM32F072xB) \
+    || defined(STM32F091xC) || defined(STM32L053xx)
+#define  RTC_WAKEUP_IRQ          RTC_IRQn
+#define  RTC_WAKEUP_IRQHandler   RTC_IRQHandler
+#else
+#define  RTC_WAKEUP_IRQ          RTC_WKUP_IRQn
+#define  RTC_WAKEUP_IRQHandler   RTC_WKUP_IRQHandler
+#endif
+#define  RTC_WUT_MAX_COUNT       0xFFFF    /* 16-bit wakeup auto-reload */
+
+void  RTC_WAKEUP_IRQHandler (void);
+#endif
 
 
 //*****************************************************************************
@@ -369,7 +409,7 @@ int  board_rtc_init (int rtc_clock_type)
                  //------------------------------------------------------------
                  // enable the interupt handler ISRs to catch RTC timestamps
                  //------------------------------------------------------------
-    HAL_NVIC_SetPriority (TAMP_STAMP_IRQn, 0x0F, 0); // Configure NVIC for RTC TimeStamp
+    HAL_NVIC_SetPriority (TAMP_STAMP_IRQn, IRQ_PRIO_HOUSEKEEP, 0); // Configure NVIC for RTC TimeStamp
     HAL_NVIC_EnableIRQ (TAMP_STAMP_IRQn);            // and enable the IRQs
 
 //#endif                  // defined(EXCEEDS_32K_IAR_LIMIT)       // WVD ADD
@@ -443,6 +483,200 @@ int  board_rtc_get_time (uint8_t *hh, uint8_t *mm, uint8_t *ss,
 
 
 
+#if defined(USES_TIMESTAMP)
+/*************************************************************************
+* @brief  Get the current time of day in microseconds, plus the 64-bit
+*         timestamp tick count it corresponds to.
+*
+*         The RTC sub-seconds register only changes every 1/(SynchPrediv+1)
+*         seconds (~3.9 ms with the usual 32768 Hz LSE), so a plain read
+*         is off by up to one sub-second step. Instead, we wait (at most
+*         ~10 ms) for the sub-second count to change, and take the tick
+*         count right at that edge. That makes the pair exact, to within a
+*         couple of RTCCLK shadow register cycles.
+*
+* @param  usec_of_day - microseconds since midnight
+* @param  ticks       - board_timestamp_get_ticks() at that instant
+* @retval 0 if worked, else negative error code
+*************************************************************************/
+int  board_rtc_get_usec_of_day (uint64_t *usec_of_day, uint64_t *ticks)
+{
+    RTC_TimeTypeDef   stimestructure;
+    RTC_DateTypeDef   sdatestructure;
+    uint32_t          ssr;
+    uint32_t          start_ms;
+    uint32_t          prediv;
+    uint32_t          hours;
+
+    if (RtcHandle.Instance == 0L)
+       return (ERR_TIMESTAMP_NO_REFERENCE);     // board_rtc_init() not called
+
+    start_ms = board_systick_timer_get_value();
+    ssr = RtcHandle.Instance->SSR;
+    while (RtcHandle.Instance->SSR == ssr)
+      { if ((board_systick_timer_get_value() - start_ms) > 10)
+           return (ERR_TIMESTAMP_NO_REFERENCE); // RTC is not ticking
+      }
+    *ticks = board_timestamp_get_ticks();       // stamp the sub-second edge
+
+       // Note: the date must be read after the time, to unlock the shadow regs
+    HAL_RTC_GetTime (&RtcHandle, &stimestructure, FORMAT_BIN);
+    HAL_RTC_GetDate (&RtcHandle, &sdatestructure, FORMAT_BIN);
+
+    hours = stimestructure.Hours;
+    if (RtcHandle.Init.HourFormat == RTC_HOURFORMAT_12)
+       {                                        // convert to 0-23 hours
+         hours = hours % 12;
+         if (stimestructure.TimeFormat == RTC_HOURFORMAT12_PM)
+            hours += 12;
+       }
+
+    prediv = RtcHandle.Init.SynchPrediv;        // SubSeconds counts down
+    *usec_of_day = ((uint64_t) (hours * 3600L + stimestructure.Minutes * 60L
+                                + stimestructure.Seconds) * 1000000L)
+                 + (((uint64_t) (prediv - stimestructure.SubSeconds) * 1000000L)
+                    / (prediv + 1));
+
+    return (0);           // denote success
+}
+#endif
+
+
+
+#if defined(USES_TICKLESS_IDLE)
+/*************************************************************************
+* @brief  Get the number of RTC sub-second counts since midnight.
+*
+*         Reads the RTC registers directly (SSR, then TR, then DR to
+*         unlock the shadow registers), so it is cheap enough to call on
+*         every entry/exit of low power idle. After a wakeup from STOP,
+*         pass resync = 1 so the shadow registers get re-synchronized first.
+*
+* @param  subsec_count   - # sub-second counts since midnight
+* @param  subsec_per_sec - # sub-second counts per second  (SynchPrediv+1)
+* @param  resync         - 1 = wait for RSF after a wakeup from STOP
+* @retval 0 if worked, else negative error code
+*************************************************************************/
+int  board_rtc_get_subsec_count (uint32_t *subsec_count, uint32_t *subsec_per_sec,
+                                 int resync)
+{
+    uint32_t   ssr;
+    uint32_t   tr;
+    uint32_t   hours;
+    uint32_t   secs;
+    uint32_t   prediv;
+
+    if (RtcHandle.Instance == 0L)
+       return (ERR_TIMESTAMP_NO_REFERENCE);     // board_rtc_init() not called
+
+    if (resync)
+       HAL_RTC_WaitForSynchro (&RtcHandle);
+
+    ssr = RtcHandle.Instance->SSR;              // locks TR/DR shadow regs
+    tr  = RtcHandle.Instance->TR;
+    (void) RtcHandle.Instance->DR;              // unlocks the shadow regs
+
+    hours = RTC_Bcd2ToByte ((uint8_t) ((tr & (RTC_TR_HT | RTC_TR_HU)) >> 16));
+    if (RtcHandle.Init.HourFormat == RTC_HOURFORMAT_12)
+       {                                        // convert to 0-23 hours
+         hours = hours % 12;
+         if (tr & RTC_TR_PM)
+            hours += 12;
+       }
+    secs = (hours * 3600L)
+         + (RTC_Bcd2ToByte ((uint8_t) ((tr & (RTC_TR_MNT | RTC_TR_MNU)) >> 8)) * 60L)
+         +  RTC_Bcd2ToByte ((uint8_t) (tr & (RTC_TR_ST | RTC_TR_SU)));
+
+    prediv = RtcHandle.Init.SynchPrediv;        // SSR counts down
+    *subsec_per_sec = prediv + 1;
+    *subsec_count   = (secs * (prediv + 1)) + (prediv - (ssr & prediv));
+
+    return (0);           // denote success
+}
+
+
+/*************************************************************************
+* @brief  Start the RTC wakeup timer, to wake up from STOP mode.
+*
+*         Runs off RTCCLK/16 (2048 Hz with a 32768 Hz LSE), for up to
+*         ~32 seconds. Longer times switch to the 1 Hz ck_spre clock,
+*         which is good for up to 18 hours.
+*
+* @param  wakeup_ms - time till wakeup, in milliseconds
+* @retval 0 if worked, else negative error code
+*************************************************************************/
+int  board_rtc_wakeup_start (uint32_t wakeup_ms)
+{
+    uint32_t   rtcclk_hz;
+    uint32_t   wut_count;
+
+    if (RtcHandle.Instance == 0L)
+       return (ERR_TIMESTAMP_NO_REFERENCE);     // board_rtc_init() not called
+
+    rtcclk_hz = (RtcHandle.Init.AsynchPrediv + 1) * (RtcHandle.Init.SynchPrediv + 1);
+    wut_count = (uint32_t) (((uint64_t) wakeup_ms * (rtcclk_hz / 16)) / 1000);
+
+    if (wut_count > RTC_WUT_MAX_COUNT)
+       {                       // too long for RTCCLK/16, so use 1 Hz ck_spre
+         wut_count = wakeup_ms / 1000;
+         if (wut_count > RTC_WUT_MAX_COUNT)
+            wut_count = RTC_WUT_MAX_COUNT;
+         HAL_RTCEx_SetWakeUpTimer_IT (&RtcHandle, wut_count - 1,
+                                      RTC_WAKEUPCLOCK_CK_SPRE_16BITS);
+       }
+      else
+       {
+         if (wut_count < 1)
+            wut_count = 1;
+         HAL_RTCEx_SetWakeUpTimer_IT (&RtcHandle, wut_count - 1,
+                                      RTC_WAKEUPCLOCK_RTCCLK_DIV16);
+       }
+
+    HAL_NVIC_SetPriority (RTC_WAKEUP_IRQ, IRQ_PRIO_HOUSEKEEP, 0);
+    HAL_NVIC_EnableIRQ (RTC_WAKEUP_IRQ);
+
+    return (0);           // denote success
+}
+
+
+/*************************************************************************
+* @brief  Stop the RTC wakeup timer, and clear any pending wakeup event.
+*
+*         Called right after a wakeup, with interrupts still disabled, so
+*         the wakeup ISR never needs to run.
+*
+* @retval 1 if the wakeup timer is what woke us up, else 0
+*************************************************************************/
+int  board_rtc_wakeup_stop (void)
+{
+    int   fired;
+
+    fired = (__HAL_RTC_WAKEUPTIMER_GET_FLAG (&RtcHandle, RTC_FLAG_WUTF) != 0);
+
+    HAL_RTCEx_DeactivateWakeUpTimer (&RtcHandle);
+    __HAL_RTC_WAKEUPTIMER_CLEAR_FLAG (&RtcHandle, RTC_FLAG_WUTF);
+    __HAL_RTC_WAKEUPTIMER_EXTI_CLEAR_FLAG();
+    HAL_NVIC_ClearPendingIRQ (RTC_WAKEUP_IRQ);
+
+    return (fired);
+}
+
+
+/*************************************************************************
+*                          RTC  Wakeup  ISR
+*
+* @brief  Only runs if a wakeup fires while we are awake (e.g. a rupt
+*         woke us up early, and the timer popped before it was stopped).
+*         Just clear the wakeup flags.
+*************************************************************************/
+void  RTC_WAKEUP_IRQHandler (void)
+{
+    HAL_RTCEx_WakeUpTimerIRQHandler (&RtcHandle);
+}
+#endif
+
+
+
 /*************************************************************************
 * @brief  Configure the current date         (Month / Day / Year)
 *
@@ -511,4 +745,46 @@ int  board_rtc_set_time (uint8_t hh, uint8_t mm, uint8_t ss)
     return (0);           // denote success
 }
 
+/*************************************************************************
+* @brief  Read an RTC backup register. These keep their value through a
+*         reset, standby, and (with a VBAT supply) power off, so are used
+*         to pass state to a warm boot (see boot_seq.h).
+*
+* @param  reg_num - 0 to the MCU's # of backup registers - 1
+* @param  value   - where to return the register's value
+* @retval 0 if worked, else negative error code
+*************************************************************************/
+int  board_rtc_backup_read (int reg_num, uint32_t *value)
+{
+    if (reg_num < 0 || reg_num >= RTC_BKP_NUM_REGS || value == 0L)
+       return (ERR_RTC_BKP_INVALID_REG);
+
+    RtcBkpHandle.Instance = RTC;
+    __HAL_RCC_PWR_CLK_ENABLE();
+    *value = HAL_RTCEx_BKUPRead (&RtcBkpHandle, reg_num + RTC_BKP_FIRST_REG);
+
+    return (0);           // denote success
+}
+
+
+/*************************************************************************
+* @brief  Write an RTC backup register.
+*
+* @param  reg_num - 0 to the MCU's # of backup registers - 1
+* @param  value   - the value to be kept
+* @retval 0 if worked, else negative error code
+*************************************************************************/
+int  board_rtc_backup_write (int reg_num, uint32_t value)
+{
+    if (reg_num < 0 || reg_num >= RTC_BKP_NUM_REGS)
+       return (ERR_RTC_BKP_INVALID_REG);
+
+    RtcBkpHandle.Instance = RTC;
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();     // turn off backup domain write protect
+    HAL_RTCEx_BKUPWrite (&RtcBkpHandle, reg_num + RTC_BKP_FIRST_REG, value);
+
+    return (0);           // denote success
+}
+
 /******************************************************************************/
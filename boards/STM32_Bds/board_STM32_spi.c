@@ -25,6 +25,9 @@
 //               re-write all their code. Duq
 //    10/17/15 - Ensure a minimal "spi timeout" value is set for SPI read/write
 //               (in case user app forgets), otherwise get immediate timeouts. Duq
+//    10/19/26 - Added the shared SPI bus manager plumbing (USES_SPI_BUS):
+//               queued DMA transactions with automatic CS, see spi_bus.h.
+//    10/19/26 - SPI and DMA IRQs use the IRQ_PRIO_COMMS class.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -394,7 +397,7 @@ int  board_spi_init (unsigned int spi_module_id,
          //    SPI2  DMA and Interrupts  Enable
          //----------------------------------------
     board_spi_dma_init();
-    HAL_NVIC_SetPriority (SPI2_IRQn, 0, 0);
+    HAL_NVIC_SetPriority (SPI2_IRQn, IRQ_PRIO_COMMS, 0);
     HAL_NVIC_EnableIRQ (SPI2_IRQn);
 #endif
 
@@ -541,11 +544,11 @@ int  board_spi_init (unsigned int spi_module_id,
 
       /*##-4- Configure the NVIC for DMA #########################################*/
       /* NVIC configuration for DMA transfer complete interrupt (SPI3_TX) */
-  HAL_NVIC_SetPriority (SPIx_DMA_TX_IRQn, 0, 1);
+  HAL_NVIC_SetPriority (SPIx_DMA_TX_IRQn, IRQ_PRIO_COMMS, 0);
   HAL_NVIC_EnableIRQ (SPIx_DMA_TX_IRQn);
 
       /* NVIC configuration for DMA transfer complete interrupt (SPI3_RX) */
-  HAL_NVIC_SetPriority (SPIx_DMA_RX_IRQn, 0, 0);
+  HAL_NVIC_SetPriority (SPIx_DMA_RX_IRQn, IRQ_PRIO_COMMS, 0);
   HAL_NVIC_EnableIRQ (SPIx_DMA_RX_IRQn);
 #endif                                        //  #if defined(USE_DMA)
 
@@ -592,9 +595,9 @@ void  board_spi_dma_init (void)
         //--------------------------------------------
         //    DMA interrupts init
         //--------------------------------------------
-    HAL_NVIC_SetPriority (DMA1_Channel4_IRQn, 0, 0);   // SPI RX
+    HAL_NVIC_SetPriority (DMA1_Channel4_IRQn, IRQ_PRIO_COMMS, 0);   // SPI RX
     HAL_NVIC_EnableIRQ (DMA1_Channel4_IRQn);
-    HAL_NVIC_SetPriority (DMA1_Channel5_IRQn, 0, 0);   // SPI TX
+    HAL_NVIC_SetPriority (DMA1_Channel5_IRQn, IRQ_PRIO_COMMS, 0);   // SPI TX
     HAL_NVIC_EnableIRQ (DMA1_Channel5_IRQn);
 #endif
 }
@@ -1139,6 +1142,340 @@ int  board_spi_write_read (unsigned int spi_module_id, uint8_t *transmit_buffer,
 }
 
 
+#if defined(USES_SPI_BUS)
+//*****************************************************************************
+//*****************************************************************************
+//                         SHARED   SPI   BUS   MANAGER
+//
+//  Board plumbing for common/spi_bus.c: the 3 bus operations, the default
+//  DMA mapping, and the HAL completion hooks. Transfers use DMA when the
+//  SPI handle has DMA streams linked to it, else HAL interrupt mode.
+//*****************************************************************************
+//*****************************************************************************
+#include "spi_bus.h"
+
+     //------------------------------------------------------------------------
+     // Default DMA mapping used by board_spibus_init(). DMA request lines
+     // are hard wired per SPI module. SPI1 on the F7 has no default, because
+     // both of its RX streams are used by the ADCs. Other MCUs/modules run in
+     // interrupt mode, or can use DMA by linking DMA handles (hdmatx/hdmarx)
+     // into the SPI handle before calling board_spibus_init(). The App then
+     // supplies the DMA stream IRQ handlers (HAL_DMA_IRQHandler()).
+     //------------------------------------------------------------------------
+#if defined(STM32F401xC) || defined(STM32F401xE) || defined(STM32F411xE) \
+ || defined(STM32F446xx) || defined(STM32F746xx) || defined(STM32F746NGHx)
+#define  SPIBUS_HAS_DMA_DEFAULTS   1
+
+typedef struct spibus_dma_map_def      /* default DMA streams for one SPI */
+    {
+        DMA_Stream_TypeDef  *rx_stream;
+        DMA_Stream_TypeDef  *tx_stream;
+        uint32_t            channel;   // DMA_CHANNEL_x request for both
+        IRQn_Type           rx_irq;
+        IRQn_Type           tx_irq;
+    } SPIBUS_DMA_MAP;
+
+const SPIBUS_DMA_MAP  _g_spibus_dma_map [4] =
+    {   { 0L, 0L, 0, (IRQn_Type) 0, (IRQn_Type) 0 },      // no SPI0
+#if defined(STM32F746xx) || defined(STM32F746NGHx)
+        { 0L, 0L, 0, (IRQn_Type) 0, (IRQn_Type) 0 },      // SPI1: streams in use by ADC
+#else
+        { DMA2_Stream2, DMA2_Stream3, DMA_CHANNEL_3, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn },
+#endif
+        { DMA1_Stream3, DMA1_Stream4, DMA_CHANNEL_0, DMA1_Stream3_IRQn, DMA1_Stream4_IRQn },
+        { DMA1_Stream0, DMA1_Stream7, DMA_CHANNEL_0, DMA1_Stream0_IRQn, DMA1_Stream7_IRQn },
+    };
+#endif
+
+typedef struct spibus_hw_def           /* board side of one SPI bus */
+    {
+        SPI_HandleTypeDef  *hspi;      // HAL handle of the SPI module
+        SPI_BUS            *bus;       // bus engine that owns the module
+        DMA_HandleTypeDef  hdma_rx;    // default DMA streams (if mapped)
+        DMA_HandleTypeDef  hdma_tx;
+        uint8_t            use_dma;    // 1 = DMA transfers, 0 = interrupt
+    } SPIBUS_HW;
+
+    SPIBUS_HW   _g_spibus_hw [MAX_SPI+1];
+
+static int   board_spibus_configure (void *hw, int mode, uint32_t clock_hz);
+static int   board_spibus_start (void *hw, const uint8_t *tx, uint8_t *rx, uint16_t length);
+static void  board_spibus_set_cs (void *hw, int cs_pin, int level);
+static int   board_spibus_hal_event (SPI_HandleTypeDef *hspi, int status);
+
+const SPI_BUS_OPS  _g_spibus_ops = { board_spibus_configure,
+                                     board_spibus_start,
+                                     board_spibus_set_cs };
+
+
+/*******************************************************************************
+* board_spibus_init
+*
+*         Hand a SPI module over to a bus manager (see common/spi_bus.h).
+*
+*         The module (and its SCLK/MISO/MOSI pins) must already be set up
+*         with spi_Init(). spi_module_id is either the physical module
+*         (SPI_M1 ...) or a spi_Init() id (SPI_ID_2_B ...).
+*
+*         flags:  SPIBUS_USE_INTERRUPTS  do not use the default DMA streams.
+*
+*         caller_hspi  the SPI handle passed to spi_Init_Extended() if one
+*                      was used (e.g. BlueNRG's SpiHandle), else 0L.
+*******************************************************************************/
+int  board_spibus_init (SPI_BUS *bus, unsigned int spi_module_id, int flags,
+                        SPI_HandleTypeDef *caller_hspi)
+{
+    SPI_HandleTypeDef  *hspi;
+    SPI_IO_BUF_BLK     *ioblock;
+    SPIBUS_HW          *hw;
+    int                module;
+
+    module = (spi_module_id > 0x0F) ? ((spi_module_id >> 4) & 0x0F) : spi_module_id;
+    if (module < 1 || module > MAX_SPI)
+       return (ERR_SPI_NUM_OUT_OF_RANGE);
+
+    hspi = caller_hspi;
+    if (hspi == 0L)
+       hspi = (SPI_HandleTypeDef*) _g_spi_typedef_handle [module];
+    if (bus == 0L || hspi == 0L || hspi->Instance == 0L)
+       return (ERR_SPIBUS_NOT_INITIALIZED);
+
+    hw = &_g_spibus_hw [module];
+    if (hspi->hdmarx == &hw->hdma_rx)
+       { hspi->hdmarx = 0L;                    // re-init: drop our old DMA links
+         hspi->hdmatx = 0L;
+       }
+    memset (hw, 0, sizeof(SPIBUS_HW));
+    hw->hspi = hspi;
+
+        // SPIx_IRQHandler -> board_spi_IRQ_Handler(module) must reach our handle
+    ioblock = (SPI_IO_BUF_BLK*) _g_spi_io_blk_address [module];
+    ioblock->spi_handle = hspi;
+
+    if (hspi->hdmarx != 0L && hspi->hdmatx != 0L)
+       hw->use_dma = 1;                        // caller linked DMA streams
+#if defined(SPIBUS_HAS_DMA_DEFAULTS)
+      else if ((flags & SPIBUS_USE_INTERRUPTS) == 0
+               && module < 4 && _g_spibus_dma_map[module].rx_stream != 0L)
+       { const SPIBUS_DMA_MAP  *map = &_g_spibus_dma_map [module];
+
+         __HAL_RCC_DMA1_CLK_ENABLE();
+         __HAL_RCC_DMA2_CLK_ENABLE();
+
+         hw->hdma_rx.Instance                 = map->rx_stream;
+         hw->hdma_rx.Init.Channel             = map->channel;
+         hw->hdma_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+         hw->hdma_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+         hw->hdma_rx.Init.MemInc              = DMA_MINC_ENABLE;
+         hw->hdma_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+         hw->hdma_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+         hw->hdma_rx.Init.Mode                = DMA_NORMAL;
+         hw->hdma_rx.Init.Priority            = DMA_PRIORITY_HIGH;   // RX first: no overruns
+         hw->hdma_rx.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+
+         hw->hdma_tx.Instance                 = map->tx_stream;
+         hw->hdma_tx.Init                     = hw->hdma_rx.Init;
+         hw->hdma_tx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+         hw->hdma_tx.Init.Priority            = DMA_PRIORITY_MEDIUM;
+
+         if (HAL_DMA_Init(&hw->hdma_rx) != HAL_OK || HAL_DMA_Init(&hw->hdma_tx) != HAL_OK)
+            return (ERR_SPIBUS_NOT_INITIALIZED);
+         __HAL_LINKDMA (hspi, hdmarx, hw->hdma_rx);
+         __HAL_LINKDMA (hspi, hdmatx, hw->hdma_tx);
+
+         HAL_NVIC_SetPriority (map->rx_irq, IRQ_PRIO_COMMS, 0);
+         HAL_NVIC_EnableIRQ (map->rx_irq);
+         HAL_NVIC_SetPriority (map->tx_irq, IRQ_PRIO_COMMS, 0);
+         HAL_NVIC_EnableIRQ (map->tx_irq);
+         hw->use_dma = 1;
+       }
+#endif
+
+        // SPI IRQ: interrupt mode transfers, and DMA mode error reporting
+    board_spi_enable_nvic_irq (module);
+
+    spibus_init (bus, &_g_spibus_ops, hw);
+    hw->bus = bus;                             // now route HAL completions
+
+    return (0);                                // denote success
+}
+
+
+//*****************************************************************************
+//  board_spibus_configure
+//
+//          Switch the SPI module to another device's mode and clock rate.
+//          Picks the fastest baud prescalar that does not exceed clock_hz.
+//          Only called between transactions, so the SPI is not busy.
+//*****************************************************************************
+static int  board_spibus_configure (void *hw, int mode, uint32_t clock_hz)
+{
+    SPI_HandleTypeDef  *hspi;
+    uint32_t           pclk;
+    uint32_t           br;
+    uint32_t           cr1;
+
+    hspi = ((SPIBUS_HW*) hw)->hspi;
+
+    pclk = HAL_RCC_GetPCLK1Freq();
+#if defined(RCC_CFGR_PPRE2)
+    if (hspi->Instance == SPI1
+#if defined(SPI4)
+        || hspi->Instance == SPI4
+#endif
+#if defined(SPI5)
+        || hspi->Instance == SPI5
+#endif
+#if defined(SPI6)
+        || hspi->Instance == SPI6
+#endif
+       )
+       pclk = HAL_RCC_GetPCLK2Freq();          // these SPIs are on APB2
+#endif
+
+    for (br = 0;  br < 7;  br++)               // SCLK = PCLK / 2^(br+1)
+      if ((pclk >> (br + 1)) <= clock_hz)
+         break;
+
+    cr1 = hspi->Instance->CR1 & ~(SPI_CR1_BR | SPI_CR1_CPOL | SPI_CR1_CPHA | SPI_CR1_SPE);
+    cr1 |= (br << 3);
+    if (mode & 0x02)
+       cr1 |= SPI_CR1_CPOL;
+    if (mode & 0x01)
+       cr1 |= SPI_CR1_CPHA;
+
+    __HAL_SPI_DISABLE (hspi);                  // BR/CPOL/CPHA need SPE off
+    hspi->Instance->CR1 = cr1;
+    __HAL_SPI_ENABLE (hspi);
+
+         // keep the HAL's view in step, in case the handle is re-initialized
+    hspi->Init.BaudRatePrescaler = (br << 3);
+    hspi->Init.CLKPolarity = (mode & 0x02) ? SPI_POLARITY_HIGH : SPI_POLARITY_LOW;
+    hspi->Init.CLKPhase    = (mode & 0x01) ? SPI_PHASE_2EDGE : SPI_PHASE_1EDGE;
+
+    return (0);                                // denote success
+}
+
+
+//*****************************************************************************
+//  board_spibus_start
+//
+//          Start one segment, via DMA or HAL interrupt mode. Completion comes
+//          back through the HAL_SPI_xxCpltCallback()s below.
+//*****************************************************************************
+static int  board_spibus_start (void *hw, const uint8_t *tx, uint8_t *rx, uint16_t length)
+{
+    SPI_HandleTypeDef  *hspi;
+    HAL_StatusTypeDef  rc;
+
+    hspi = ((SPIBUS_HW*) hw)->hspi;
+
+    if (((SPIBUS_HW*) hw)->use_dma)
+       { if (tx != 0L && rx != 0L)
+            rc = HAL_SPI_TransmitReceive_DMA (hspi, (uint8_t*) tx, rx, length);
+            else if (tx != 0L)
+                    rc = HAL_SPI_Transmit_DMA (hspi, (uint8_t*) tx, length);
+            else rc = HAL_SPI_Receive_DMA (hspi, rx, length);
+       }
+      else
+       { if (tx != 0L && rx != 0L)
+            rc = HAL_SPI_TransmitReceive_IT (hspi, (uint8_t*) tx, rx, length);
+            else if (tx != 0L)
+                    rc = HAL_SPI_Transmit_IT (hspi, (uint8_t*) tx, length);
+            else rc = HAL_SPI_Receive_IT (hspi, rx, length);
+       }
+
+    return (rc == HAL_OK ? 0 : ERR_SPIBUS_XFER_FAILED);
+}
+
+
+//*****************************************************************************
+//  board_spibus_set_cs
+//*****************************************************************************
+static void  board_spibus_set_cs (void *hw, int cs_pin, int level)
+{
+    board_gpio_write_pin (cs_pin, level ? PIN_HIGH : PIN_LOW);
+}
+
+
+//*****************************************************************************
+//  board_spibus_hal_event
+//
+//          Called from the HAL SPI completion/error callbacks. If the SPI
+//          belongs to a bus, hand the segment status to the bus engine
+//          (which starts the next segment / transaction) and return 1.
+//*****************************************************************************
+static int  board_spibus_hal_event (SPI_HandleTypeDef *hspi, int status)
+{
+    int   i;
+
+    for (i = 1;  i <= MAX_SPI;  i++)
+      if (_g_spibus_hw[i].bus != 0L && _g_spibus_hw[i].hspi == hspi)
+         { spibus_segment_done (_g_spibus_hw[i].bus, status);
+           return (1);
+         }
+    return (0);                                // not one of ours
+}
+
+
+void  HAL_SPI_TxCpltCallback (SPI_HandleTypeDef *hspi)
+{
+    board_spibus_hal_event (hspi, 0);
+}
+
+void  HAL_SPI_RxCpltCallback (SPI_HandleTypeDef *hspi)
+{
+    board_spibus_hal_event (hspi, 0);
+}
+
+
+#if defined(SPIBUS_HAS_DMA_DEFAULTS)
+//******************************************************************************
+//                 SPI  BUS   DMA   ISR / IRQ     Handlers
+//******************************************************************************
+void  DMA1_Stream3_IRQHandler (void);
+void  DMA1_Stream4_IRQHandler (void);
+void  DMA1_Stream0_IRQHandler (void);
+void  DMA1_Stream7_IRQHandler (void);
+
+void  DMA1_Stream3_IRQHandler (void)           // SPI2 RX
+{
+    HAL_DMA_IRQHandler (&_g_spibus_hw[2].hdma_rx);
+}
+
+void  DMA1_Stream4_IRQHandler (void)           // SPI2 TX
+{
+    HAL_DMA_IRQHandler (&_g_spibus_hw[2].hdma_tx);
+}
+
+void  DMA1_Stream0_IRQHandler (void)           // SPI3 RX
+{
+    HAL_DMA_IRQHandler (&_g_spibus_hw[3].hdma_rx);
+}
+
+void  DMA1_Stream7_IRQHandler (void)           // SPI3 TX
+{
+    HAL_DMA_IRQHandler (&_g_spibus_hw[3].hdma_tx);
+}
+
+#if ! defined(STM32F746xx) && ! defined(STM32F746NGHx)
+void  DMA2_Stream2_IRQHandler (void);
+void  DMA2_Stream3_IRQHandler (void);
+
+void  DMA2_Stream2_IRQHandler (void)           // SPI1 RX
+{
+    HAL_DMA_IRQHandler (&_g_spibus_hw[1].hdma_rx);
+}
+
+void  DMA2_Stream3_IRQHandler (void)           // SPI1 TX
+{
+    HAL_DMA_IRQHandler (&_g_spibus_hw[1].hdma_tx);
+}
+#endif
+#endif                                         // SPIBUS_HAS_DMA_DEFAULTS
+#endif                                         // USES_SPI_BUS
+
+
    extern    int   rupt_module_id;            // TEMP_HACK
 
 
@@ -1155,6 +1492,10 @@ void HAL_SPI_ErrorCallback (SPI_HandleTypeDef *hspi)
 {
     SPI_IO_BUF_BLK     *ioblock;
 
+#if defined(USES_SPI_BUS)
+    if (board_spibus_hal_event(hspi, ERR_SPIBUS_XFER_FAILED))
+       return;                                  // SPI belongs to a bus
+#endif
     ioblock = (SPI_IO_BUF_BLK*) _g_spi_io_blk_address [rupt_module_id];    // get assoc I/O block
     ioblock->spi_state = SPI_STATE_ERROR_COMPLETE;   // set ending status
 
@@ -1181,6 +1522,10 @@ void  HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
 {
     SPI_IO_BUF_BLK     *ioblock;
 
+#if defined(USES_SPI_BUS)
+    if (board_spibus_hal_event(hspi, 0))
+       return;                                  // SPI belongs to a bus
+#endif
     ioblock = (SPI_IO_BUF_BLK*) _g_spi_io_blk_address [rupt_module_id];    // get assoc I/O block
     ioblock->spi_state = SPI_STATE_IO_COMPLETED;  // Tag as successful I/O
 
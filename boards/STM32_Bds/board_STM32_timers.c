@@ -21,6 +21,17 @@
 //    04/30/15 - Added multi-channel PWM support.  WORKS.   Duq
 //    07/03/15 - Merge in changes for Timer / PWM enhancements. Duq
 //    07/16/15 - Reworked to provide better factoring. Duq
+//    10/19/26 - Added DMA based Input Capture (frequency/period/duty). Also
+//               scale timer_Get_CCR_Capture_Value() by the prescalar.
+//    10/19/26 - Fix board_timerpwm_set_dead_time(): it cleared the wrong
+//               BDTR bits and wrote raw ticks into the non-linear DTG field.
+//    10/19/26 - Added quadrature encoder mode (board_timerpwm_encoder_init).
+//    10/19/26 - Added atomic multi-channel duty cycle update, and DMA burst
+//               duty cycle streaming (USES_PWM_STREAM).
+//    10/19/26 - Timer IRQs use the IRQ_PRIO_HARD_RT class. Added deferred
+//               (bottom half) callbacks, and ISR timing (USES_IRQ_STATS).
+//               Fix TIM3_IRQHandler passing the TIM2 registers.
+//    10/19/26 - ISR timing records the entry latency of update interrupts.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -258,6 +269,104 @@ int   board_timerpwm_config_gpios (void *pwmblkp, int chan_id);
 #endif
 
 
+#if defined(USES_INPUT_CAPTURE)
+#include "input_capture.h"
+     //------------------------------------------------------------------------
+     // Default DMA mapping used by timer_Capture_Start(). DMA request lines
+     // are hard wired per Timer/CCR, so only one (32-bit) timer/channel per
+     // MCU family is pre-mapped. Other timer/channels can be used by passing
+     // board_timerpwm_capture_start() a DMA handle with its Instance (and
+     // Channel/Request) already filled in, and its DMA clock turned on.
+     //
+     // The ring position is read from the DMA counter (NDTR/CNDTR) whenever
+     // timer_Capture_Update() is called. Ring laps are counted off the DMA's
+     // Transfer Complete (TC) flag, by the DMA ISR (ICAP_DMA_IRQn) and by
+     // timer_Capture_Update() itself, so that an update that comes more than
+     // one ring late is seen by the engine as an overrun (edges_lost).
+     //
+     // F0: the DMA1_Channel4_5 IRQ is shared with DAC channel 2, so no ISR
+     // is installed. Laps are then only counted on updates, and the App must
+     // call timer_Capture_Update() at least once per ring, or call
+     // board_timerpwm_capture_dma_isr() from its own shared DMA handler.
+     //------------------------------------------------------------------------
+#if defined(STM32F401xC) || defined(STM32F401xE) || defined(STM32F411xE) \
+ || defined(STM32F446xx) || defined(STM32F746xx) || defined(STM32F746NGHx)
+#define  ICAP_DMA_TIMER            TIMER_5          /* TIM5_CH1 = PA0 = A0 */
+#define  ICAP_DMA_CHANNEL          TIMER_CHANNEL_1
+#define  ICAP_DMA_INSTANCE         DMA1_Stream2
+#define  ICAP_DMA_SET_REQUEST(h)   (h)->Init.Channel = DMA_CHANNEL_6
+#define  ICAP_DMA_CLK_ENABLE()     __HAL_RCC_DMA1_CLK_ENABLE()
+#define  ICAP_DMA_IRQn             DMA1_Stream2_IRQn
+#define  ICAP_DMA_IRQHandler       DMA1_Stream2_IRQHandler
+#endif
+
+#if defined(STM32L476xx)
+#define  ICAP_DMA_TIMER            TIMER_2          /* TIM2_CH1 = PA0 = A0 */
+#define  ICAP_DMA_CHANNEL          TIMER_CHANNEL_1
+#define  ICAP_DMA_INSTANCE         DMA1_Channel5
+#define  ICAP_DMA_SET_REQUEST(h)   (h)->Init.Request = DMA_REQUEST_4
+#define  ICAP_DMA_CLK_ENABLE()     __HAL_RCC_DMA1_CLK_ENABLE()
+#define  ICAP_DMA_IRQn             DMA1_Channel5_IRQn
+#define  ICAP_DMA_IRQHandler       DMA1_Channel5_IRQHandler
+#endif
+
+#if defined(__STM32F072__) || defined(STM32F072xB) || defined(__STM32F091__) || defined(STM32F091xC)
+#define  ICAP_DMA_TIMER            TIMER_2          /* TIM2_CH1 = PA0 = A0 */
+#define  ICAP_DMA_CHANNEL          TIMER_CHANNEL_1
+#define  ICAP_DMA_INSTANCE         DMA1_Channel5
+#define  ICAP_DMA_SET_REQUEST(h)   /* F0 request mapping is fixed */
+#define  ICAP_DMA_CLK_ENABLE()     __HAL_RCC_DMA1_CLK_ENABLE()
+#endif
+
+typedef struct tmr_capture_def         /* DMA Input Capture, one per timer */
+    {
+        ICAP_ENGINE        *icap;      // engine that processes the ring
+        DMA_HandleTypeDef  *hdma;      // DMA moving CCRx into the ring
+        uint32_t           hal_channel;// HAL TIM_CHANNEL_x being captured
+        volatile uint32_t  laps;       // # times DMA has wrapped the ring (TC)
+    } TMR_CAPTURE_BLK;
+
+    TMR_CAPTURE_BLK    _g_timer_capture [MAX_TIMER+1];
+    DMA_HandleTypeDef  _g_DMA_timer_capture;          // default capture DMA
+#endif                                                // USES_INPUT_CAPTURE
+
+
+#if defined(USES_PWM_STREAM)
+     //------------------------------------------------------------------------
+     // Default DMA mapping used by pwm_Stream_Start(). The stream is driven
+     // by the timer's Update (UP) DMA request, which is hard wired to one
+     // DMA stream/channel per timer, so only TIM1 is pre-mapped. Other timers
+     // can be streamed by passing board_timerpwm_stream_start() a DMA handle
+     // with its Instance (and Channel/Request) already filled in, and its
+     // DMA clock turned on.
+     //------------------------------------------------------------------------
+#if defined(STM32F401xC) || defined(STM32F401xE) || defined(STM32F411xE) \
+ || defined(STM32F446xx) || defined(STM32F746xx) || defined(STM32F746NGHx)
+#define  PWMSTREAM_DMA_TIMER            TIMER_1          /* TIM1_UP */
+#define  PWMSTREAM_DMA_INSTANCE         DMA2_Stream5
+#define  PWMSTREAM_DMA_SET_REQUEST(h)   (h)->Init.Channel = DMA_CHANNEL_6
+#define  PWMSTREAM_DMA_CLK_ENABLE()     __HAL_RCC_DMA2_CLK_ENABLE()
+#endif
+
+#if defined(STM32L476xx)
+#define  PWMSTREAM_DMA_TIMER            TIMER_1          /* TIM1_UP */
+#define  PWMSTREAM_DMA_INSTANCE         DMA1_Channel6
+#define  PWMSTREAM_DMA_SET_REQUEST(h)   (h)->Init.Request = DMA_REQUEST_7
+#define  PWMSTREAM_DMA_CLK_ENABLE()     __HAL_RCC_DMA1_CLK_ENABLE()
+#endif
+
+typedef struct tmr_stream_def          /* DMA burst duty streaming, one per timer */
+    {
+        DMA_HandleTypeDef  *hdma;      // DMA moving the sequence into TIMx->DMAR
+        uint16_t           num_channels; // # CCRs written per update (CCR1..CCRn)
+        uint16_t           num_steps;  // # update events in the sequence
+    } TMR_STREAM_BLK;
+
+    TMR_STREAM_BLK     _g_timer_stream [MAX_TIMER+1];
+    DMA_HandleTypeDef  _g_DMA_timer_stream;           // default stream DMA
+#endif                                                // USES_PWM_STREAM
+
+
 //*****************************************************************************
 //*****************************************************************************
 //                      COMMON   TABLES and DEFINEs
@@ -331,6 +440,17 @@ int   board_timerpwm_config_gpios (void *pwmblkp, int chan_id);
 TMR_CB_EVENT_HANDLER  _g_ptimer_callback [MAX_TIMER+1] = { 0,0,0,0,0,0,0,0,0,0 };
     void              *_g_ptimer_callback_parm [MAX_TIMER+1];
 
+#if defined(USES_IRQ_BOTTOM_HALF)
+                           //--------------------------------------------------------
+                           // Deferred callbacks: the callback is run from a bottom
+                           // half (PendSV) instead of the timer ISR.
+                           // bh_id is the registered bottom half id + 1 (0 = none).
+                           //--------------------------------------------------------
+    uint8_t           _g_ptimer_deferred [MAX_TIMER+1];
+    uint8_t           _g_ptimer_bh_id [MAX_TIMER+1];
+static void  board_timerpwm_bh_handler (void *parm, uint32_t events);
+#endif
+
                            //--------------------------------------------------------
                            // Timer Prescalars used for each Timer module.
                            //--------------------------------------------------------
@@ -675,6 +795,384 @@ int  board_timerpwm_init (unsigned int module_id, int counter_type, long period_
 
                        // The rest of the Physical Timers logic
 
+#if defined(USES_INPUT_CAPTURE)
+//*****************************************************************************
+//  board_timerpwm_capture_start
+//
+//         Start DMA based Input Capture on one channel of a timer.
+//
+//         The timer is setup as a free running counter (full 16 or 32 bits)
+//         and every captured edge is DMA'ed (circular) into ring[]. The
+//         engine is initialized via icap_init(), so call icap_set_window()
+//         afterwards to change the stats window.
+//
+//         ring[] must be uint32_t for 32-bit timers (TIM2/TIM5), else uint16_t.
+//         Use timer_Set_Prescalar() beforehand to slow the counter down, so
+//         that the required timer_Capture_Update() rate is reasonable.
+//
+//         Only one capture channel per timer is supported.
+//*****************************************************************************
+int  board_timerpwm_capture_start (unsigned int module_id, int chan_id,
+                                   ICAP_ENGINE *icap, void *ring, int ring_size,
+                                   int flags, DMA_HandleTypeDef *caller_hdma)
+{
+    TIM_TypeDef         *timbase;
+    TIM_HandleTypeDef   *hdltimer;
+    TIM_IC_InitTypeDef  icConfig;
+    DMA_HandleTypeDef   *hdma;
+    TMPWM_CHANNEL_BLK   *pwmblkp;
+    uint32_t            hal_channel_num;
+    uint32_t            tick_hz;
+    int                 chan_index;
+    int                 rc;
+
+    if (module_id > MAX_TIMER)
+       return (ERR_TIMER_NUM_OUT_OF_RANGE);
+
+    timbase  = (TIM_TypeDef*) _g_timer_module_base [module_id];
+    hdltimer = (TIM_HandleTypeDef*) _g_timer_typedef_handle [module_id];
+    if (timbase == 0L || hdltimer == 0L)
+       return (ERR_TIMER_NUM_NOT_SUPPORTED);
+
+    hal_channel_num = board_timerpwm_channel_lookup (chan_id, &chan_index);
+    if (hal_channel_num == -1)
+       return (ERR_TIMER_CHANNEL_NUM_OUT_OF_RANGE);  // passed bad chan_id value
+
+       //-------------------------------------------------------------
+       // Use caller's DMA handle, else our default mapping (if any)
+       //-------------------------------------------------------------
+    hdma = caller_hdma;
+#if defined(ICAP_DMA_INSTANCE)
+    if (hdma == 0L && module_id == ICAP_DMA_TIMER && chan_id == ICAP_DMA_CHANNEL)
+       { hdma = &_g_DMA_timer_capture;
+         memset (hdma, 0, sizeof(DMA_HandleTypeDef));
+         hdma->Instance = ICAP_DMA_INSTANCE;
+         ICAP_DMA_SET_REQUEST (hdma);
+         ICAP_DMA_CLK_ENABLE();               // DMA controller clock enable
+       }
+#endif
+    if (hdma == 0L)
+       return (ERR_TIMER_CAPTURE_NO_DMA);
+
+    if (IS_TIM_32B_COUNTER_INSTANCE(timbase))
+       flags |= ICAP_32_BIT_COUNTER;
+       else flags &= ~(ICAP_32_BIT_COUNTER);
+
+    board_timerpwm_enable_clock (module_id);    // ensure Timer clock is turn on
+
+         // route the pin to the timer's CCR input
+    pwmblkp = (TMPWM_CHANNEL_BLK*) _g_tmrpwm_mod_channel_blk_lookup [module_id];
+    rc = board_timerpwm_config_gpios (pwmblkp, chan_id);
+    if (rc < 0)
+       return (rc);
+
+    tick_hz = (uint32_t) (board_sys_IO_clock_get_frequency()
+                          / (_g_tmpwm_prescalars[module_id] + 1));
+    rc = icap_init (icap, ring, ring_size, tick_hz, flags);
+    if (rc < 0)
+       return (rc);
+
+       //-------------------------------------------------------------
+       // Free running counter, using the full counter width
+       //-------------------------------------------------------------
+    memset (hdltimer, 0, sizeof(TIM_HandleTypeDef));
+    hdltimer->Instance           = timbase;
+    hdltimer->Init.Period        = icap->counter_mask;
+    hdltimer->Init.Prescaler     = _g_tmpwm_prescalars[module_id];
+    hdltimer->Init.ClockDivision = 0;
+    hdltimer->Init.CounterMode   = TIM_COUNTERMODE_UP;
+    if (HAL_TIM_IC_Init(hdltimer) != HAL_OK)
+       return (ERR_TIMER_CAPTURE_START_FAILED);
+
+    memset (&icConfig, 0, sizeof(icConfig));
+    if (flags & ICAP_BOTH_EDGES)
+       icConfig.ICPolarity = TIM_ICPOLARITY_BOTHEDGE;
+       else if (flags & ICAP_FALLING_EDGE)
+               icConfig.ICPolarity = TIM_ICPOLARITY_FALLING;
+       else icConfig.ICPolarity = TIM_ICPOLARITY_RISING;
+    icConfig.ICSelection = TIM_ICSELECTION_DIRECTTI;
+    switch (flags & ICAP_EVENT_DIV_MASK)
+      { case ICAP_EVENT_DIV_2:  icConfig.ICPrescaler = TIM_ICPSC_DIV2;  break;
+        case ICAP_EVENT_DIV_4:  icConfig.ICPrescaler = TIM_ICPSC_DIV4;  break;
+        case ICAP_EVENT_DIV_8:  icConfig.ICPrescaler = TIM_ICPSC_DIV8;  break;
+        default:                icConfig.ICPrescaler = TIM_ICPSC_DIV1;  break;
+      }
+    icConfig.ICFilter = 0;
+    if (HAL_TIM_IC_ConfigChannel(hdltimer, &icConfig, hal_channel_num) != HAL_OK)
+       return (ERR_TIMER_CAPTURE_START_FAILED);
+
+       //-------------------------------------------------------------
+       // Circular DMA: CCRx -> ring[]
+       //-------------------------------------------------------------
+    hdma->Init.Direction          = DMA_PERIPH_TO_MEMORY;
+    hdma->Init.PeriphInc          = DMA_PINC_DISABLE;
+    hdma->Init.MemInc             = DMA_MINC_ENABLE;
+    if (flags & ICAP_32_BIT_COUNTER)
+       { hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+         hdma->Init.MemDataAlignment    = DMA_MDATAALIGN_WORD;
+       }
+      else
+       { hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+         hdma->Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+       }
+    hdma->Init.Mode               = DMA_CIRCULAR;
+    hdma->Init.Priority           = DMA_PRIORITY_HIGH;
+    if (HAL_DMA_Init(hdma) != HAL_OK)
+       return (ERR_TIMER_CAPTURE_START_FAILED);
+    __HAL_LINKDMA (hdltimer, hdma[TIM_DMA_ID_CC1 + chan_index - 1], *hdma);
+
+    _g_timer_capture[module_id].icap        = icap;
+    _g_timer_capture[module_id].hdma        = hdma;
+    _g_timer_capture[module_id].hal_channel = hal_channel_num;
+    _g_timer_capture[module_id].laps        = 0;
+
+    _g_timer_runtime_TIM_handle [module_id] = hdltimer;
+    _g_tmpwm_module_status [module_id]      = TMR_PWM_NORMAL_INIT;
+
+    if (HAL_TIM_IC_Start_DMA(hdltimer, hal_channel_num, (uint32_t*) ring, ring_size) != HAL_OK)
+       return (ERR_TIMER_CAPTURE_START_FAILED);
+
+        // Only the once per lap TC interrupt is wanted: turn off the Half
+        // Transfer / error interrupts that HAL_TIM_IC_Start_DMA() enabled.
+    __HAL_DMA_DISABLE_IT (hdma, DMA_IT_HT | DMA_IT_TE);
+#if defined(DMA_IT_DME)
+    __HAL_DMA_DISABLE_IT (hdma, DMA_IT_DME);
+#endif
+#if defined(ICAP_DMA_IRQn)
+    if (hdma == &_g_DMA_timer_capture)
+       { HAL_NVIC_SetPriority (ICAP_DMA_IRQn, IRQ_PRIO_HOUSEKEEP, 0);
+         HAL_NVIC_EnableIRQ (ICAP_DMA_IRQn);  // counts laps, see ICAP_DMA_IRQHandler
+       }
+#endif
+
+    return (0);                              // denote completed OK
+}
+
+
+//*****************************************************************************
+//  board_timerpwm_capture_update
+//
+//         Hand all newly DMA'ed captures to the Input Capture engine.
+//         Must be called at least once per counter rollover and once per
+//         ring of edges (e.g. from the main loop or a vtimer callback).
+//
+//         Returns the # of new edges processed.
+//*****************************************************************************
+int  board_timerpwm_capture_update (unsigned int module_id)
+{
+    TMR_CAPTURE_BLK  *capblkp;
+    TIM_TypeDef      *timbase;
+    uint32_t         head;
+    uint32_t         laps;
+    uint32_t         counter_now;
+    uint32_t         primask;
+    int              tc_pending;
+
+    if (module_id > MAX_TIMER)
+       return (ERR_TIMER_NUM_OUT_OF_RANGE);
+
+    capblkp = &_g_timer_capture [module_id];
+    if (capblkp->icap == 0L)
+       return (ERR_PWM_MODULE_NOT_INITIALIZED);
+
+    timbase = (TIM_TypeDef*) _g_timer_module_base [module_id];
+
+       //-------------------------------------------------------------------
+       // Take a consistent (laps, head) pair. A TC that is still pending has
+       // not been counted by the DMA ISR yet, so count it here. Re-reading
+       // the TC flag around the counter read tells us which side of the
+       // wrap the counter value came from.
+       //
+       // Read the DMA position _before_ CNT, so every edge we hand over
+       // is guaranteed to be older than the "now" value we pass with it.
+       //-------------------------------------------------------------------
+    primask = __get_PRIMASK();
+    __disable_irq();
+    do {
+         tc_pending = (__HAL_DMA_GET_FLAG(capblkp->hdma,
+                          __HAL_DMA_GET_TC_FLAG_INDEX(capblkp->hdma)) != RESET);
+         head = capblkp->icap->ring_size - __HAL_DMA_GET_COUNTER(capblkp->hdma);
+       } while (tc_pending != (__HAL_DMA_GET_FLAG(capblkp->hdma,
+                          __HAL_DMA_GET_TC_FLAG_INDEX(capblkp->hdma)) != RESET));
+    if (tc_pending)
+       { __HAL_DMA_CLEAR_FLAG (capblkp->hdma,
+                               __HAL_DMA_GET_TC_FLAG_INDEX(capblkp->hdma));
+         capblkp->laps++;                         // DMA wrapped the ring
+       }
+    laps        = capblkp->laps;
+    counter_now = timbase->CNT;
+    __set_PRIMASK (primask);
+
+    if (head >= capblkp->icap->ring_size)         // counter reload window:
+       head = (tc_pending) ? 0 : capblkp->icap->ring_size;  // lap just ended
+
+    return (icap_update (capblkp->icap,
+                         (laps * capblkp->icap->ring_size) + head,
+                         counter_now));
+}
+
+
+//*****************************************************************************
+//  board_timerpwm_capture_dma_isr
+//
+//         Count one ring lap per DMA Transfer Complete. Called from the
+//         default capture DMA's IRQ handler, or from an App's DMA handler
+//         when a caller supplied DMA handle (or F0's shared IRQ) is used.
+//*****************************************************************************
+void  board_timerpwm_capture_dma_isr (unsigned int module_id)
+{
+    TMR_CAPTURE_BLK  *capblkp;
+
+    if (module_id > MAX_TIMER)
+       return;
+
+    capblkp = &_g_timer_capture [module_id];
+    if (capblkp->hdma == 0L)
+       return;
+
+    if (__HAL_DMA_GET_FLAG(capblkp->hdma,
+                           __HAL_DMA_GET_TC_FLAG_INDEX(capblkp->hdma)) != RESET)
+       { __HAL_DMA_CLEAR_FLAG (capblkp->hdma,
+                               __HAL_DMA_GET_TC_FLAG_INDEX(capblkp->hdma));
+         capblkp->laps++;                         // DMA wrapped the ring
+       }
+}
+
+
+#if defined(ICAP_DMA_IRQn)
+void  ICAP_DMA_IRQHandler (void);
+
+void  ICAP_DMA_IRQHandler (void)              // e.g. DMA1_Stream2_IRQHandler
+{
+    board_timerpwm_capture_dma_isr (ICAP_DMA_TIMER);
+}
+#endif
+
+
+//*****************************************************************************
+//  board_timerpwm_capture_stop
+//
+//         Stop DMA based Input Capture on a timer.
+//*****************************************************************************
+int  board_timerpwm_capture_stop (unsigned int module_id)
+{
+    TMR_CAPTURE_BLK    *capblkp;
+    TIM_HandleTypeDef  *hdltimer;
+
+    if (module_id > MAX_TIMER)
+       return (ERR_TIMER_NUM_OUT_OF_RANGE);
+
+    capblkp  = &_g_timer_capture [module_id];
+    hdltimer = (TIM_HandleTypeDef*) _g_timer_runtime_TIM_handle [module_id];
+    if (capblkp->icap == 0L || hdltimer == 0L)
+       return (ERR_PWM_MODULE_NOT_INITIALIZED);
+
+#if defined(ICAP_DMA_IRQn)
+    if (capblkp->hdma == &_g_DMA_timer_capture)
+       HAL_NVIC_DisableIRQ (ICAP_DMA_IRQn);
+#endif
+    HAL_TIM_IC_Stop_DMA (hdltimer, capblkp->hal_channel);
+    capblkp->icap = 0L;
+
+    return (0);                              // denote completed OK
+}
+#endif                                       // USES_INPUT_CAPTURE
+
+
+//*****************************************************************************
+//  board_timerpwm_encoder_init
+//
+//         Setup a timer in quadrature encoder mode: CH1/CH2 pins are the
+//         encoder's A/B outputs, and the counter counts all 4 edges (x4)
+//         up or down, over the timer's full width (16, or 32 bits on
+//         TIM2/TIM5).  Read it with board_timerpwm_encoder_get_count().
+//
+//         filter is the input filter (0-15, TIMx_CCMRx ICxF), to reject
+//         noise on long encoder cables.  flags TIMER_ENCODER_INVERT
+//         reverses the count direction.
+//*****************************************************************************
+int  board_timerpwm_encoder_init (unsigned int module_id, int filter, int flags)
+{
+    TIM_TypeDef             *timbase;
+    TIM_HandleTypeDef       *hdltimer;
+    TIM_Encoder_InitTypeDef encConfig;
+    TMPWM_CHANNEL_BLK       *pwmblkp;
+    int                     rc;
+
+    if (module_id > MAX_TIMER)
+       return (ERR_TIMER_NUM_OUT_OF_RANGE);
+    if (filter < 0 || filter > 15)
+       return (ERR_TIMER_ENCODER_INIT_FAILED);
+
+    timbase  = (TIM_TypeDef*) _g_timer_module_base [module_id];
+    hdltimer = (TIM_HandleTypeDef*) _g_timer_typedef_handle [module_id];
+    if (timbase == 0L || hdltimer == 0L)
+       return (ERR_TIMER_NUM_NOT_SUPPORTED);
+    if ( ! IS_TIM_ENCODER_INTERFACE_INSTANCE(timbase))
+       return (ERR_TIMER_NUM_NOT_SUPPORTED);    // basic timers have no encoder mode
+
+    board_timerpwm_enable_clock (module_id);    // ensure Timer clock is turn on
+
+         // route the encoder A/B pins to the timer's CH1/CH2 inputs
+    pwmblkp = (TMPWM_CHANNEL_BLK*) _g_tmrpwm_mod_channel_blk_lookup [module_id];
+    rc = board_timerpwm_config_gpios (pwmblkp, TIMER_CHANNEL_1);
+    if (rc < 0)
+       return (rc);
+    rc = board_timerpwm_config_gpios (pwmblkp, TIMER_CHANNEL_2);
+    if (rc < 0)
+       return (rc);
+
+    memset (hdltimer, 0, sizeof(TIM_HandleTypeDef));
+    hdltimer->Instance           = timbase;
+    hdltimer->Init.Prescaler     = 0;
+    hdltimer->Init.CounterMode   = TIM_COUNTERMODE_UP;
+    hdltimer->Init.Period        = IS_TIM_32B_COUNTER_INSTANCE(timbase) ? 0xFFFFFFFF : 0xFFFF;
+    hdltimer->Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+
+    memset (&encConfig, 0, sizeof(encConfig));
+    encConfig.EncoderMode  = TIM_ENCODERMODE_TI12;        // x4: count all edges
+    encConfig.IC1Polarity  = (flags & TIMER_ENCODER_INVERT) ? TIM_ICPOLARITY_FALLING
+                                                          : TIM_ICPOLARITY_RISING;
+    encConfig.IC1Selection = TIM_ICSELECTION_DIRECTTI;
+    encConfig.IC1Prescaler = TIM_ICPSC_DIV1;
+    encConfig.IC1Filter    = filter;
+    encConfig.IC2Polarity  = TIM_ICPOLARITY_RISING;
+    encConfig.IC2Selection = TIM_ICSELECTION_DIRECTTI;
+    encConfig.IC2Prescaler = TIM_ICPSC_DIV1;
+    encConfig.IC2Filter    = filter;
+    if (HAL_TIM_Encoder_Init(hdltimer, &encConfig) != HAL_OK)
+       return (ERR_TIMER_ENCODER_INIT_FAILED);
+
+    _g_timer_runtime_TIM_handle [module_id] = hdltimer;
+    if (HAL_TIM_Encoder_Start(hdltimer, TIM_CHANNEL_ALL) != HAL_OK)
+       return (ERR_TIMER_ENCODER_INIT_FAILED);
+    _g_tmpwm_module_status [module_id] = TMR_PWM_NORMAL_INIT;
+
+    return (0);                              // denote completed OK
+}
+
+
+//*****************************************************************************
+//  board_timerpwm_encoder_get_count
+//
+//         Return the encoder timer's raw counter.  It wraps at the timer's
+//         width: take differences between reads as a signed 16 (or 32) bit
+//         value to track position (bdc_motor_step() does this).
+//*****************************************************************************
+uint32_t  board_timerpwm_encoder_get_count (unsigned int module_id)
+{
+    TIM_TypeDef    *timbase;
+
+    if (module_id > MAX_TIMER)
+       return (0);
+    timbase = (TIM_TypeDef*) _g_timer_module_base [module_id];
+    if (timbase == 0L)
+       return (0);
+
+    return (timbase->CNT);
+}
+
+
 //*****************************************************************************
 //  board_timerpwm_check_completed
 //
@@ -1169,7 +1667,7 @@ int  board_timerpwm_enable (unsigned int module_id, int interrupt_flags)
               if (module_id == 20)
                  {     // TIM20 has a separate IRQn for ROLLOVERs/Updates
                    NVIC_EnableIRQ (TIM20_UP_IRQn);              // Enable NVIC
-                   NVIC_SetPriority (TIM20_UP_IRQn, 1);
+                   NVIC_SetPriority (TIM20_UP_IRQn, IRQ_PRIO_HARD_RT);
                  }
 #endif
 #if defined(HAS_TIM8)
@@ -1178,10 +1676,10 @@ int  board_timerpwm_enable (unsigned int module_id, int interrupt_flags)
    #if defined(STM32F303xE) || defined(STM32F303xC) || defined(STM32L476xx)
                             // just to be annoying, F3_03 uses diff NVIC id
                    NVIC_EnableIRQ (TIM8_UP_IRQn);                // Enable NVIC
-                   NVIC_SetPriority (TIM8_UP_IRQn, 1);
+                   NVIC_SetPriority (TIM8_UP_IRQn, IRQ_PRIO_HARD_RT);
    #else
                    NVIC_EnableIRQ (TIM8_UP_TIM13_IRQn);          // Enable NVIC
-                   NVIC_SetPriority (TIM8_UP_TIM13_IRQn, 1);
+                   NVIC_SetPriority (TIM8_UP_TIM13_IRQn, IRQ_PRIO_HARD_RT);
    #endif
                  }
                else if (module_id == 1)
@@ -1189,10 +1687,10 @@ int  board_timerpwm_enable (unsigned int module_id, int interrupt_flags)
    #if defined(STM32F303xE) || defined(STM32F303xC) || defined(STM32L476xx)
                             // just to be annoying, F3_03 uses diff NVIC id
                     NVIC_EnableIRQ (TIM1_UP_TIM16_IRQn);         // Enable NVIC
-                    NVIC_SetPriority (TIM1_UP_TIM16_IRQn, 1);
+                    NVIC_SetPriority (TIM1_UP_TIM16_IRQn, IRQ_PRIO_HARD_RT);
    #else
                     NVIC_EnableIRQ (TIM1_UP_TIM10_IRQn);         // Enable NVIC
-                    NVIC_SetPriority (TIM1_UP_TIM10_IRQn, 1);
+                    NVIC_SetPriority (TIM1_UP_TIM10_IRQn, IRQ_PRIO_HARD_RT);
    #endif
                  }
                else
@@ -1201,7 +1699,7 @@ int  board_timerpwm_enable (unsigned int module_id, int interrupt_flags)
                  {          // TIM1 has a separate IRQn for ROLLOVERs
   #if ! defined(STM32L152xE)
                     NVIC_EnableIRQ (TIM1_UP_TIM10_IRQn);         // Enable NVIC
-                    NVIC_SetPriority (TIM1_UP_TIM10_IRQn, 1);
+                    NVIC_SetPriority (TIM1_UP_TIM10_IRQn, IRQ_PRIO_HARD_RT);
   #endif
                  }
                else
@@ -1209,7 +1707,7 @@ int  board_timerpwm_enable (unsigned int module_id, int interrupt_flags)
                 {           // handle all the other timers ROLLOVERs
                             // find and set associated NVIC IRQ value
                     NVIC_EnableIRQ (irqn);                       // Enable NVIC
-                    NVIC_SetPriority (irqn, 1);
+                    NVIC_SetPriority (irqn, IRQ_PRIO_HARD_RT);
                 }
             }
 
@@ -1218,7 +1716,7 @@ int  board_timerpwm_enable (unsigned int module_id, int interrupt_flags)
                           // find and set associated NVIC IRQ value
                           //-----------------------------------------------
                      NVIC_EnableIRQ (irqn);                      // Enable NVIC
-                     NVIC_SetPriority (irqn, 1);
+                     NVIC_SetPriority (irqn, IRQ_PRIO_HARD_RT);
                 }
 
                    //---------------------------------------------------
@@ -1441,7 +1939,12 @@ long  board_timerpwm_get_CCR_capture_value (unsigned int module_id, int CCR_chan
 
     cap_value = HAL_TIM_ReadCapturedValue (hdltimer, CCR_channel_id);
 
-// ??? !!! must I adjust the value based on pre-scalar used ??? !!!
+       //---------------------------------------------------------------
+       // re-adjust capture value based on pre-scalar to get user's view,
+       // the same as is done for timer_Get_Current_Value()
+       //---------------------------------------------------------------
+    if (_g_tmpwm_prescalars[module_id] > 0)
+       cap_value = (cap_value * _g_tmpwm_prescalars[module_id]);
 
     return (cap_value);             // passback capture value
 }
@@ -1632,11 +2135,79 @@ int  board_timerpwm_set_callback (unsigned int module_id,
        //-------------------------------------------------------------------
     _g_ptimer_callback [module_id]      = callback_function;
     _g_ptimer_callback_parm [module_id] = callback_parm;
+#if defined(USES_IRQ_BOTTOM_HALF)
+    _g_ptimer_deferred [module_id]      = 0;    // called right from the ISR
+#endif
 
     return (0);                 // denote completed OK
 }
 
 
+#if defined(USES_IRQ_BOTTOM_HALF)
+//*****************************************************************************
+//  board_timerpwm_set_callback_deferred
+//
+//          Same as board_timerpwm_set_callback(), but the callback is run
+//          from a bottom half (PendSV, IRQ_PRIO_BOTTOM_HALF) after the timer
+//          ISR returns, so long callback work (e.g. a stepper's speed ramp)
+//          does not hold off the other HARD_RT interrupts.
+//          If several interrupts occur before the callback runs, it is
+//          called once per interrupt type that occurred (rollover first,
+//          then CCR1-4), not once per interrupt.
+//*****************************************************************************
+int  board_timerpwm_set_callback_deferred (unsigned int module_id,
+                                           TMR_CB_EVENT_HANDLER callback_function,
+                                           void *callback_parm)
+{
+    int   bh_id;
+
+    if (module_id > MAX_TIMER)
+       return (ERR_TIMER_NUM_OUT_OF_RANGE);
+
+    if (_g_ptimer_bh_id [module_id] == 0)
+       {      // first use for this timer: get it a bottom half
+         bh_id = board_bh_register (board_timerpwm_bh_handler,
+                                    (void*) module_id);
+         if (bh_id < 0)
+            return (bh_id);
+         _g_ptimer_bh_id [module_id] = (uint8_t) (bh_id + 1);
+       }
+
+    _g_ptimer_deferred [module_id]      = 0;    // no window with the wrong parm
+    _g_ptimer_callback [module_id]      = callback_function;
+    _g_ptimer_callback_parm [module_id] = callback_parm;
+    _g_ptimer_deferred [module_id]      = 1;
+
+    return (0);                 // denote completed OK
+}
+
+
+//*****************************************************************************
+//  board_timerpwm_bh_handler
+//
+//          Bottom half for a deferred timer callback. events has bit
+//          (1 << interrupt_type) set for each interrupt type that occurred.
+//*****************************************************************************
+static void  board_timerpwm_bh_handler (void *parm, uint32_t events)
+{
+    static const uint8_t  rupt_order[] = { TIMER_ROLLOVER_INTERRUPT,
+                                           TIMER_CCR1_INTERRUPT, TIMER_CCR2_INTERRUPT,
+                                           TIMER_CCR3_INTERRUPT, TIMER_CCR4_INTERRUPT };
+    TMR_CB_EVENT_HANDLER  callback;
+    int                   tim_index;
+    int                   i;
+
+    tim_index = (int) parm;
+    callback  = _g_ptimer_callback [tim_index];
+    if (callback == 0L)
+       return;
+    for (i = 0;  i < (int) sizeof(rupt_order);  i++)
+      if (events & (1UL << rupt_order[i]))
+         (callback) (_g_ptimer_callback_parm[tim_index], rupt_order[i]);
+}
+#endif
+
+
 
 //*****************************************************************************
 //  board_timerpwm_set_channel_output
@@ -1682,14 +2253,22 @@ int  board_timerpwm_set_channel_output (unsigned int module_id, int chan_id,
 //         Set the PWM's dead time between complementary PWM
 //         arrangements.  Use to avoid "shoot through" on the
 //         output FETs when working with Power or Motor H-bridges.
+//
+//         The dead time is in timer clock ticks (CKD = 0). BDTR's 8 bit DTG
+//         field is not linear above 127 ticks:
+//             DTG[7:5] = 0xx:   DT =        DTG[6:0]       * 1 tick
+//                        10x:   DT = (64 +  DTG[5:0]) * 2   ticks
+//                        110:   DT = (32 +  DTG[4:0]) * 8   ticks
+//                        111:   DT = (32 +  DTG[4:0]) * 16  ticks
+//         so the value is rounded UP to the next value the range can hold
+//         (never less dead time than asked for), and capped at 1008 ticks.
 //*****************************************************************************
 
 int  board_timerpwm_set_dead_time (unsigned int module_id, int rising_edge,
                                    int falling_edge)
 {
     TIM_TypeDef         *timbase;
-    int                 rc;
-    uint32_t            scaleduty;
+    uint32_t            dtg;
 
 #if defined(STM32L152xE)
     return (ERR_PWM_MODULE_NO_DEADTIME);
@@ -1705,8 +2284,19 @@ int  board_timerpwm_set_dead_time (unsigned int module_id, int rising_edge,
     if (timbase == 0L)
        return (ERR_TIMER_NUM_NOT_SUPPORTED);
 
-    timbase->BDTR &= ~(0xFF00);               // clear out any previous DT value
-    timbase->BDTR |= (rising_edge & 0x00FF);  // set 8 bit deadtime
+    if (rising_edge < 0)
+       return (ERR_PWM_INVALID_DEADTIME);
+    if (rising_edge <= 127)
+       dtg = rising_edge;
+       else if (rising_edge <= 254)
+               dtg = 0x80 | (((rising_edge + 1) >> 1) - 64);
+       else if (rising_edge <= 504)
+               dtg = 0xC0 | (((rising_edge + 7) >> 3) - 32);
+       else if (rising_edge <= 1008)
+               dtg = 0xE0 | (((rising_edge + 15) >> 4) - 32);
+       else dtg = 0xFF;                      // max: 1008 ticks
+
+    timbase->BDTR = (timbase->BDTR & ~TIM_BDTR_DTG) | dtg;  // replace DTG[7:0]
 
        // trailing edge is ignored, because STM32 F7 TIM1 only supports a
        // single deadtime value, that is used on both rising and falling edges.
@@ -1780,6 +2370,256 @@ int  board_timerpwm_set_duty_cycle (unsigned int module_id, int chan_id,
 }
 
 
+//******************************************************************************
+//  board_timerpwm_preload_enable
+//
+//        Turn on the preload (shadow) registers for CCR1..CCRn and ARR, so
+//        that new duty cycle / period values written by the CPU or by DMA
+//        only reach the comparators at the next update event, i.e. at a
+//        PWM period boundary, never part way through a period.
+//******************************************************************************
+static void  board_timerpwm_preload_enable (TIM_TypeDef *timbase, int num_channels)
+{
+    timbase->CCMR1 |= TIM_CCMR1_OC1PE;
+    if (num_channels > 1)
+       timbase->CCMR1 |= TIM_CCMR1_OC2PE;
+    if (num_channels > 2)
+       timbase->CCMR2 |= TIM_CCMR2_OC3PE;
+    if (num_channels > 3)
+       timbase->CCMR2 |= TIM_CCMR2_OC4PE;
+    timbase->CR1 |= TIM_CR1_ARPE;
+}
+
+
+//******************************************************************************
+//  board_timerpwm_set_duty_cycles
+//
+//        Set the duty cycles of channels 1 to num_channels of a timer as one
+//        atomic update, e.g. all 3 colors of an RGB LED, or all 3 phases of
+//        a motor bridge.
+//
+//        Calling board_timerpwm_set_duty_cycle() once per channel can let an
+//        update event land between the CCR writes, so for one PWM period
+//        the outputs run with a mix of old and new values (a visible color
+//        glitch on an LED, a torque spike on a motor).
+//
+//        Here the CCR preload registers are turned on, and the timer's
+//        update event is held off (CR1 UDIS) while the shadow CCRs are
+//        written, so the new values all reach the comparators at the same
+//        period boundary. If a period ends inside that (few instruction)
+//        window, its update event - and any rollover interrupt/callback -
+//        is skipped, and the new values take effect one period later.
+//
+//        ccr_values[0] goes to CCR1, ccr_values[1] to CCR2, etc.
+//******************************************************************************
+int  board_timerpwm_set_duty_cycles (unsigned int module_id, const uint32_t *ccr_values,
+                                     int num_channels, int flags)
+{
+    TIM_TypeDef         *timbase;
+    uint32_t            ccr [4];
+    int                 i;
+
+    if (module_id > MAX_TIMER)
+       return (ERR_TIMER_NUM_OUT_OF_RANGE);
+
+            // get ptr to associated TIM register
+    timbase  = (TIM_TypeDef*) _g_timer_module_base [module_id];
+    if (timbase == 0L)
+       return (ERR_TIMER_NUM_NOT_SUPPORTED);
+
+    if (ccr_values == 0L || num_channels < 1 || num_channels > 4)
+       return (ERR_PWM_CHANNEL_NUM_OUT_OF_RANGE);
+
+       //----------------------------------------------------------------
+       // do any needed Auto Pre-Scaling up front, so the window where
+       // the update event is held off is just the register writes.
+       //----------------------------------------------------------------
+    for (i = 0;  i < num_channels;  i++)
+      { ccr[i] = ccr_values[i];
+        if ( _g_tmpwm_prescalars[module_id] > 0 && (flags & TIMER_AUTO_PRESCALE))
+           ccr[i] = (ccr[i] / _g_tmpwm_prescalars[module_id]);
+      }
+
+    board_timerpwm_preload_enable (timbase, num_channels);
+
+    timbase->CR1 |= TIM_CR1_UDIS;        // hold off shadow -> active transfer
+    timbase->CCR1 = ccr[0];
+    if (num_channels > 1)
+       timbase->CCR2 = ccr[1];
+    if (num_channels > 2)
+       timbase->CCR3 = ccr[2];
+    if (num_channels > 3)
+       timbase->CCR4 = ccr[3];
+    timbase->CR1 &= ~(TIM_CR1_UDIS);     // next update loads all of them
+
+    return (0);                         // denote completed OK
+}
+
+
+#if defined(USES_PWM_STREAM)
+//******************************************************************************
+//  board_timerpwm_stream_start
+//
+//        Stream a pre-computed sequence of duty cycles into channels 1 to
+//        num_channels of a running PWM timer, with no CPU involvement.
+//
+//        The timer's DMA burst unit (DCR/DMAR) is pointed at CCR1, with a
+//        burst length of num_channels, and the Update DMA request is turned
+//        on. At every update event the DMA writes the next num_channels
+//        entries of duty_seq[] into the CCR1..CCRn preload registers, which
+//        then all take effect together at the following update event.
+//        duty_seq[] is laid out step by step:
+//            { step0_ccr1, step0_ccr2, ..,  step1_ccr1, step1_ccr2, .. }
+//
+//        Use it for LED fades/animations, or for a fixed waveform (e.g. a
+//        sine table for 3 phase open loop drive). One step is consumed per
+//        update event, so slow a sequence down with a longer PWM period,
+//        or on advanced timers (TIM1/TIM8) with the repetition counter.
+//
+//        duty_seq[] must be uint32_t for 32-bit timers (TIM2/TIM5), else
+//        uint16_t, and must stay valid while the stream is running. The
+//        values are raw CCR values (no auto pre-scaling is applied).
+//        PWM_STREAM_CIRCULAR replays the sequence until pwm_Stream_Stop().
+//
+//        The timer must already be setup via pwm_Init(), pwm_Config_Channel()
+//        and pwm_Enable().
+//******************************************************************************
+int  board_timerpwm_stream_start (unsigned int module_id, const void *duty_seq,
+                                  int num_channels, int num_steps, int flags,
+                                  DMA_HandleTypeDef *caller_hdma)
+{
+    TIM_TypeDef         *timbase;
+    DMA_HandleTypeDef   *hdma;
+    uint32_t            num_transfers;
+
+    if (module_id > MAX_TIMER)
+       return (ERR_TIMER_NUM_OUT_OF_RANGE);
+
+    timbase  = (TIM_TypeDef*) _g_timer_module_base [module_id];
+    if (timbase == 0L)
+       return (ERR_TIMER_NUM_NOT_SUPPORTED);
+    if (_g_tmpwm_module_status [module_id] == 0)
+       return (ERR_PWM_MODULE_NOT_INITIALIZED);
+
+    if (num_channels < 1 || num_channels > 4)
+       return (ERR_PWM_CHANNEL_NUM_OUT_OF_RANGE);
+    if (duty_seq == 0L || num_steps < 1)
+       return (ERR_PWM_CHANNEL_CONFIG_FAILED);
+    num_transfers = (uint32_t) num_channels * (uint32_t) num_steps;
+    if (num_transfers > 0xFFFF)
+       return (ERR_PWM_CHANNEL_CONFIG_FAILED);   // DMA count is only 16 bits
+
+    if (_g_timer_stream[module_id].hdma != 0L)
+       board_timerpwm_stream_stop (module_id);   // replace the current stream
+
+       //-------------------------------------------------------------
+       // Use caller's DMA handle, else our default mapping (if any)
+       //-------------------------------------------------------------
+    hdma = caller_hdma;
+#if defined(PWMSTREAM_DMA_INSTANCE)
+    if (hdma == 0L && module_id == PWMSTREAM_DMA_TIMER)
+       { hdma = &_g_DMA_timer_stream;
+         memset (hdma, 0, sizeof(DMA_HandleTypeDef));
+         hdma->Instance = PWMSTREAM_DMA_INSTANCE;
+         PWMSTREAM_DMA_SET_REQUEST (hdma);
+         PWMSTREAM_DMA_CLK_ENABLE();           // DMA controller clock enable
+       }
+#endif
+    if (hdma == 0L)
+       return (ERR_PWM_STREAM_NO_DMA);
+
+       //-------------------------------------------------------------
+       // DMA: duty_seq[] -> TIMx->DMAR, one burst per update event
+       //-------------------------------------------------------------
+    hdma->Init.Direction          = DMA_MEMORY_TO_PERIPH;
+    hdma->Init.PeriphInc          = DMA_PINC_DISABLE;
+    hdma->Init.MemInc             = DMA_MINC_ENABLE;
+    if (IS_TIM_32B_COUNTER_INSTANCE(timbase))
+       { hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+         hdma->Init.MemDataAlignment    = DMA_MDATAALIGN_WORD;
+       }
+      else
+       { hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+         hdma->Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+       }
+    if (flags & PWM_STREAM_CIRCULAR)
+       hdma->Init.Mode = DMA_CIRCULAR;
+       else hdma->Init.Mode = DMA_NORMAL;
+    hdma->Init.Priority           = DMA_PRIORITY_HIGH;
+    if (HAL_DMA_Init(hdma) != HAL_OK)
+       return (ERR_PWM_CHANNEL_START_FAILED);
+
+    board_timerpwm_preload_enable (timbase, num_channels);
+
+       // DMA burst: base = CCR1 (DBA), num_channels transfers per request (DBL)
+    timbase->DCR = TIM_DMABASE_CCR1 | ((uint32_t) (num_channels - 1) << 8);
+
+        // No DMA interrupts are used: pwm_Stream_Status() reads the DMA
+        // counter, and the DMA's NVIC IRQ is left disabled.
+    if (HAL_DMA_Start(hdma, (uint32_t) duty_seq, (uint32_t) &timbase->DMAR,
+                      num_transfers) != HAL_OK)
+       return (ERR_PWM_CHANNEL_START_FAILED);
+
+    _g_timer_stream[module_id].hdma         = hdma;
+    _g_timer_stream[module_id].num_channels = (uint16_t) num_channels;
+    _g_timer_stream[module_id].num_steps    = (uint16_t) num_steps;
+
+    timbase->DIER |= TIM_DIER_UDE;           // Update event -> DMA burst
+
+    return (0);                              // denote completed OK
+}
+
+
+//******************************************************************************
+//  board_timerpwm_stream_status
+//
+//        Returns the # of steps of the sequence not yet loaded into the
+//        CCRs (0 = a one shot sequence is done). For a circular stream it
+//        counts down to 1, then restarts at num_steps.
+//******************************************************************************
+int  board_timerpwm_stream_status (unsigned int module_id)
+{
+    TMR_STREAM_BLK   *strblkp;
+
+    if (module_id > MAX_TIMER)
+       return (ERR_TIMER_NUM_OUT_OF_RANGE);
+
+    strblkp = &_g_timer_stream [module_id];
+    if (strblkp->hdma == 0L)
+       return (0);                           // no stream running
+
+    return ((__HAL_DMA_GET_COUNTER(strblkp->hdma) + strblkp->num_channels - 1)
+             / strblkp->num_channels);
+}
+
+
+//******************************************************************************
+//  board_timerpwm_stream_stop
+//
+//        Stop a duty cycle stream. The CCRs keep the last values streamed.
+//******************************************************************************
+int  board_timerpwm_stream_stop (unsigned int module_id)
+{
+    TMR_STREAM_BLK   *strblkp;
+    TIM_TypeDef      *timbase;
+
+    if (module_id > MAX_TIMER)
+       return (ERR_TIMER_NUM_OUT_OF_RANGE);
+
+    strblkp = &_g_timer_stream [module_id];
+    timbase = (TIM_TypeDef*) _g_timer_module_base [module_id];
+    if (strblkp->hdma == 0L || timbase == 0L)
+       return (ERR_PWM_MODULE_NOT_INITIALIZED);
+
+    timbase->DIER &= ~(TIM_DIER_UDE);        // no more burst requests
+    HAL_DMA_Abort (strblkp->hdma);           // also frees the HAL DMA lock
+    strblkp->hdma = 0L;
+
+    return (0);                              // denote completed OK
+}
+#endif                                       // USES_PWM_STREAM
+
+
 //*****************************************************************************
 //  board_timerpwm_set_period
 //
@@ -1925,11 +2765,37 @@ void  TIM22_IRQHandler (void);
 volatile uint16_t      temp_hack_SR;
 volatile uint16_t      app_rupts_mask2;
 
+static void  board_timerpwm_invoke_callback (int tim_index, int interrupt_type)
+{
+    if (_g_ptimer_callback[tim_index] == 0L)
+       return;
+#if defined(USES_IRQ_BOTTOM_HALF)
+    if (_g_ptimer_deferred[tim_index])
+       {        // run it from the timer's bottom half, after the ISR returns
+         board_bh_schedule (_g_ptimer_bh_id[tim_index] - 1,
+                            (1UL << interrupt_type));
+         return;
+       }
+#endif
+                // Invoke user callback for the interrupt
+    (_g_ptimer_callback[tim_index]) (_g_ptimer_callback_parm[tim_index],
+                                     interrupt_type);
+}
+
+
 void  TIM_Common_IRQHandler (TIM_TypeDef *TIMbase, int tim_index)
 {
     register uint16_t  app_rupts_mask;
     int                interrupt_type;
     TIM_HandleTypeDef  *timHandle;
+#if defined(USES_IRQ_STATS)
+    uint32_t           t_start;
+    uint32_t           cnt;
+    uint32_t           latency;
+
+    cnt     = TIMbase->CNT;                   // grab it first thing
+    t_start = IRQ_CYCLE_COUNT();
+#endif
 
        //--------------------------------------------------------------
        // get a local copy of what interrupts the User App wants
@@ -1977,11 +2843,7 @@ temp_hack_SR = (uint16_t) TIMbase->SR;
             //---------------------------------------------------------
        interrupt_type = TIMER_ROLLOVER_INTERRUPT;
        TIMbase->SR    = ~(TIM_IT_UPDATE);            // clear the interrupt flag
-       if (_g_ptimer_callback[tim_index] != 0L)
-          {             // Invoke user callback for UPDATE / rollover rupt
-            (_g_ptimer_callback[tim_index]) (_g_ptimer_callback_parm[tim_index],
-                                             interrupt_type);
-          }
+       board_timerpwm_invoke_callback (tim_index, interrupt_type);
      }
 
   if (app_rupts_mask & TIM_SR_CC1IF)                // is it a CCR1  interrupt ?
@@ -1990,11 +2852,7 @@ temp_hack_SR = (uint16_t) TIMbase->SR;
             //---------------------------------------------------------
        interrupt_type = TIMER_CCR1_INTERRUPT;
        TIMbase->SR    = ~(TIM_IT_CC1);               // clear the interrupt flag
-       if (_g_ptimer_callback[tim_index] != 0L)
-          {             // Invoke user callback for the interrupt
-            (_g_ptimer_callback[tim_index]) (_g_ptimer_callback_parm[tim_index],
-                                             interrupt_type);
-          }
+       board_timerpwm_invoke_callback (tim_index, interrupt_type);
      }
 
   if (app_rupts_mask & TIM_SR_CC2IF)                // is it a CCR2  interrupt ?
@@ -2003,11 +2861,7 @@ temp_hack_SR = (uint16_t) TIMbase->SR;
             //---------------------------------------------------------
        interrupt_type = TIMER_CCR2_INTERRUPT;
        TIMbase->SR    = ~(TIM_IT_CC2);               // clear the interrupt flag
-       if (_g_ptimer_callback[tim_index] != 0L)
-          {             // Invoke user callback for the interrupt
-            (_g_ptimer_callback[tim_index]) (_g_ptimer_callback_parm[tim_index],
-                                             interrupt_type);
-          }
+       board_timerpwm_invoke_callback (tim_index, interrupt_type);
      }
 
   if (app_rupts_mask & TIM_SR_CC3IF)                // is it a CCR3  interrupt ?
@@ -2016,11 +2870,7 @@ temp_hack_SR = (uint16_t) TIMbase->SR;
             //---------------------------------------------------------
        interrupt_type = TIMER_CCR3_INTERRUPT;
        TIMbase->SR    = ~(TIM_IT_CC3);               // clear the interrupt flag
-       if (_g_ptimer_callback[tim_index] != 0L)
-          {             // Invoke user callback for the interrupt
-            (_g_ptimer_callback[tim_index]) (_g_ptimer_callback_parm[tim_index],
-                                             interrupt_type);
-          }
+       board_timerpwm_invoke_callback (tim_index, interrupt_type);
      }
 
   if (app_rupts_mask & TIM_SR_CC4IF)               // is it a CCR4  interrupt ?
@@ -2029,12 +2879,26 @@ temp_hack_SR = (uint16_t) TIMbase->SR;
             //---------------------------------------------------------
        interrupt_type = TIMER_CCR4_INTERRUPT;
        TIMbase->SR    = ~(TIM_IT_CC4);               // clear the interrupt flag
-       if (_g_ptimer_callback[tim_index] != 0L)
-          {             // Invoke user callback for the interrupt
-            (_g_ptimer_callback[tim_index]) (_g_ptimer_callback_parm[tim_index],
-                                             interrupt_type);
-          }
+       board_timerpwm_invoke_callback (tim_index, interrupt_type);
      }
+
+#if defined(USES_IRQ_STATS)
+       //---------------------------------------------------------------
+       // An update event on an edge aligned count restarts the counter,
+       // so CNT at entry says how long ago it fired: CNT ticks counting
+       // up, ARR - CNT counting down. A tick is (PSC + 1) CPU clocks, as
+       // in board_frequency_to_period_ticks(). CCR only interrupts, and
+       // center aligned counts (an update at both ends), can not tell.
+       //---------------------------------------------------------------
+  latency = IRQ_LATENCY_UNKNOWN;
+  if ((app_rupts_mask & TIM_SR_UIF)  &&  (TIMbase->CR1 & TIM_CR1_CMS) == 0)
+     { if (TIMbase->CR1 & TIM_CR1_DIR)
+          cnt = TIMbase->ARR - cnt;
+       latency = cnt * (TIMbase->PSC + 1);
+     }
+  board_irq_stats_record (IRQ_CLASS_HARD_RT, latency,
+                          IRQ_CYCLE_COUNT() - t_start);
+#endif
 }
 
 #if defined(HAS_TIM10)
@@ -2090,12 +2954,14 @@ void  TIM3_IRQHandler (void)                // NVIC IRQn is:    TIM3_IRQn
 
 tim3_TIM_rupts_seen++;
 
-  #if defined(USES_L6474)
+  #if defined(USES_L6474) && ! defined(USES_IRQ_BOTTOM_HALF)
     HAL_TIM_IRQHandler (&hTimPwm1);         // TIM3    09/08/15 TEMP HACK
 
     EasySpin_StepClockHandler (0);  // passes in Device Id  BRUTE FORCE callback
   #else
-    TIM_Common_IRQHandler (TIM2, 3);       // TIM3
+        // with bottom halves, the L6474 step clock handler is run by the
+        // App's deferred timer callback (timer_Set_Callback_Deferred)
+    TIM_Common_IRQHandler (TIM3, 3);       // TIM3
   #endif
 
 }
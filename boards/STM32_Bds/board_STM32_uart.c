@@ -19,6 +19,22 @@
 *   Note: _All_ UART Read/Write routines are interrupt based.
 *         HAL libraries calls are only used for GPIO Init and UART Init.
 *
+*   Receive side:
+*         The RX ISR only moves bytes from the USART into the port's RX
+*         ring (draining the RX FIFO, on parts that have one), and counts
+*         any overruns / line errors. Text line assembly (\r \n \b
+*         handling, echo-plex) is done at thread level, by the read calls
+*         pulling from the ring, so a burst from an AT command modem
+*         (ESP8266, SIM808) costs one short ISR per byte.
+*         The ring is UART_RX_BUF_SIZE bytes by default, or an App
+*         supplied buffer per port (board_uart_set_rx_buffer()).
+*         On parts with a receiver timeout (F7, L4), the end of a burst
+*         (line idle for UART_RX_TIMEOUT_BITS) is signalled to the App
+*         callback, as is every \r or \n, with UART_RX_DATA_READY.
+*         A text line read completing is signalled with UART_RX_COMPLETE,
+*         from the read call (thread level), not from the ISR.
+*         Lost data is never silent: board_uart_get_rx_stats() returns
+*         the dropped / overrun / error counts and sticky UART_RX_xxx flags.
 *
 *
 *  History:
@@ -38,10 +54,23 @@
 *   11/01/15 - Add more checks for RX errors that can lead to persistent ORE
 *              errors, causing looping in the UART common ISR.
 *              And clear associated ICR for those platforms that support it. Duq
+*   10/19/26 - Timestamp received bytes/frames (USES_TIMESTAMP).
 *   11/02/15 - Turn off TE (Transmit Enable) after last transmit byte sent, else
 *              can get lots of bogus trailing zeros rcvd by RX side, because
 *              Xmitter is still active (TDR = 0), even though rupts are turned off.
 *              Downside is it can cause intermitent FE Framing Errors.  ARGGGGG
+*   10/19/26 - Add board_uart_check_io_completed() for non-blocking transmits.
+*   10/19/26 - Internal RX queue is now a ring_buf.h RING_BUF (masked, no
+*              per byte modulo). Chars that arrive when it is full are
+*              dropped and counted, instead of overwriting the queue.
+*   10/19/26 - Reworked receive: the ISR just queues raw bytes, and line
+*              assembly moved out to the read calls (thread level). RX
+*              ring size is configurable, per port. Overruns are kept
+*              (the byte in RDR is queued, not discarded) and reported via
+*              board_uart_get_rx_stats(). Use the RX FIFO and receiver
+*              timeout on parts that have them.
+*   10/19/26 - Post UART_RX_COMPLETE again, when a text line is assembled.
+*   10/19/26 - The \r \n \b line processing moved to common/uart_line.c.
 * -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 *
 * The MIT License (MIT)
@@ -68,11 +97,26 @@
 *******************************************************************************/
 
 #define  USES_CIRC_BUF                1  // UART uses Circular buffer facility
-#define  IO_INTERNAL_CIRC_BUF_SIZE 0x7F  // modulo value for 128 byte buffer
 
 #include "user_api.h"                   // pull in API defs and MCU depdent defs
 #include "device_config_common.h"
 #include "boarddef.h"
+#include "ring_buf.h"
+#include "uart_line.h"
+
+                    // default RX ring, per port. Must be a power of 2.
+                    // Override in project_config_parms.h, or give a port
+                    // a bigger one with board_uart_set_rx_buffer().
+#if !defined(UART_RX_BUF_SIZE)
+#define  UART_RX_BUF_SIZE           128
+#endif
+                    // receiver timeout: idle time (in bit times) after a
+                    // burst, before the callback is told UART_RX_DATA_READY
+#if !defined(UART_RX_TIMEOUT_BITS)
+#define  UART_RX_TIMEOUT_BITS        40  /* ~4 chars */
+#endif
+
+RING_SIZE_CHECK (uart_rx_queue, UART_RX_BUF_SIZE);
 
 
 extern  uint32_t   _g_systick_millisecs;
@@ -80,7 +124,7 @@ extern  uint32_t   _g_systick_millisecs;
 //-------------------------------------------------
 //          Trace / Debug     Globals
 //-------------------------------------------------
-#define  UART_TRACE_BUF_SIZE   0x1FF
+#define  UART_TRACE_BUF_SIZE   0x1FF     // mask for the 512 byte trace bufs
 
         uint8_t    _g_rx_trace[UART_TRACE_BUF_SIZE+1];  // 512 byte RX trace
         int        _g_rx_trace_idx = 0;
@@ -115,19 +159,24 @@ typedef struct periph_io_block        // Peripheral I/O Control Block (I/O Buffe
         void       *io_HAL_handle;    // HAL Typedef Handle to use for this I/O
      IO_CB_EVENT_HANDLER io_callback_handler; // optional callback routine
         void             *io_callback_parm;   // user callback parm
-        uint8_t    *io_rcv_user_buf;
-        uint16_t   io_rcv_max_length;
-        uint16_t   io_rx_amt_rcvd;
+        UART_LINE  io_line;           // text line being assembled (thread level)
+#if defined(USES_TIMESTAMP)
+        uint64_t   io_rx_first_ticks; // timestamp of 1st byte of current frame
+        uint64_t   io_rx_last_ticks;  // timestamp of most recent rcvd byte
+#endif
 #if defined(USES_CIRC_BUF)
-        uint8_t    io_rx_buf [IO_INTERNAL_CIRC_BUF_SIZE+1];    // 128 bytes
-        int        io_buf_rx_head;    // head and tail ptrs for ioblock->io_rx_buf
-        int        io_buf_rx_tail;
-        int        io_buf_echo_head;  // head and tail ptrs for ioblock->io_echo_buf
-        int        io_buf_echo_tail;
-        uint8_t    *io_rcv_echo_ptr;  // current char being echo-plexed in user rcv buf
+        uint8_t    io_rx_buf [UART_RX_BUF_SIZE];  // default RX ring storage
+        uint8_t    *io_rx_app_buf;    // App supplied RX ring storage, or 0L
+        uint16_t   io_rx_app_size;
+        uint16_t   io_rx_max_queued;  // RX ring high water mark
+        RING_BUF   io_rx_q;           // RX queue: ISR = producer, reads = consumer
+        uint32_t   io_rx_rcvd;        // # chars queued
+        uint32_t   io_rx_drops;       // # chars dropped: RX queue was full
+        uint32_t   io_rx_overruns;    // # USART overruns (ORE): chars lost in HW
+        uint32_t   io_rx_errors;      // # framing / noise / parity errors
+        uint32_t   io_rx_truncated;   // # text lines cut short to fit the buffer
+        uint8_t    io_rx_flags;       // sticky UART_RX_xxx flags, since last stats reset
         uint8_t    io_do_echoplex;    // echo-plexing is turned on
-        uint8_t    io_is_string_IO;   // current operation is a read_text_line, etc
-        uint8_t    io_str_last_char;  // keeps track of user text input (\r \n ...)
 #endif
     } IO_BUF_BLK;
 
@@ -135,7 +184,7 @@ typedef struct periph_io_block        // Peripheral I/O Control Block (I/O Buffe
 
                // valid states for UART io_state_T and io_state_R
 #define  UART_STATE_XMIT_BUSY           1
-#define  UART_STATE_RCV_VIA_INTERRUPTS  2
+#define  UART_STATE_RCV_LINE            2   /* text line partly assembled */
 #define  UART_STATE_XMIT_COMPLETE       3
 #define  UART_STATE_RCV_COMPLETE        4
 #define  UART_STATE_RESET               5
@@ -143,11 +192,8 @@ typedef struct periph_io_block        // Peripheral I/O Control Block (I/O Buffe
 int  board_get_uart_io_block (unsigned int module_id, IO_BUF_BLK **ret_ioblock);
 int  board_uart_enable_clock (int module_id);       // internal routines
 void board_uart_enable_nvic_irq (int module_id);
-void  board_uart_perform_echoplex (int module_id, IO_BUF_BLK *ioblock, uint8_t *rcv_end_buf);
-int  board_uart_process_activation_chars (IO_BUF_BLK  *ioblock,
-                                          uint8_t in_char, uint8_t *read_buf);
-int  board_uart_read_common (unsigned int module_id, IO_BUF_BLK *ioblock, uint8_t *read_buf,
-                             int buf_max_length, int is_string_IO);
+void board_uart_line_begin (IO_BUF_BLK *ioblock, uint8_t *line_buf, int buf_max_length);
+int  board_uart_line_assemble (unsigned int module_id, IO_BUF_BLK *ioblock, int echo);
 int  board_get_uart_handle (int module_id, UART_HandleTypeDef **ret_UartHdl);
 void board_common_UART_IRQHandler (USART_TypeDef *uart_module, int uart_module_id);
 void USART1_IRQHandler (void);
@@ -248,16 +294,25 @@ void USART6_IRQHandler (void);
 #define  USART_SR_TEACK  USART_ISR_TEACK
 #define  USART_SR_IDLE   USART_ISR_IDLE        /* IDLE DETECT vs TE ? */
 #define  USART_SR_ORE    USART_ISR_ORE
-#define  USART_SR_OTHER_RE_ERRS  (USART_ISR_PE | USART_ISR_FE | USART_ISR_NE | USART_ISR_ORE | USART_ISR_RTOF | USART_ISR_ABRE)
-#define  USART_ICR_CLEAR_FLAGS   (USART_ICR_PECF | USART_ICR_FECF | USART_ICR_NCF | USART_ICR_ORECF | USART_ICR_RTOCF)
+#define  USART_SR_LINE_ERRS      (USART_ISR_PE | USART_ISR_FE | USART_ISR_NE)
+#define  USART_ICR_CLEAR_FLAGS   (USART_ICR_PECF | USART_ICR_FECF | USART_ICR_NCF)
+#define  USART_ICR_CLEAR_ORE     (USART_ICR_ORECF)
 #define  USART_ICR_CLEAR_IDLE    (USART_ICR_IDLECF)
+#define  UART_CLEAR_FLAGS(hw,flags)  (hw)->ICR = (flags)   /* write 1 to clear */
 #else
 #define  RCV_REG         DR
 #define  STATUS_REG      SR
 #define  XMIT_REG        DR
-#define  USART_SR_OTHER_RE_ERRS  (USART_SR_PE | USART_SR_FE | USART_SR_NE | USART_SR_ORE | USART_SR_RTOF | USART_SR_ABRE)
-#define  USART_ICR_CLEAR_FLAGS   (USART_CR_PECF | USART_CR_FECF | USART_CR_NCF | USART_CR_ORECF | USART_CR_RTOCF)
-#define  USART_ICR_CLEAR_IDLE    (USART_CR_IDLECF)
+#define  USART_SR_LINE_ERRS      (USART_SR_PE | USART_SR_FE | USART_SR_NE)
+#define  UART_CLEAR_FLAGS(hw,flags)      /* SR/DR parts: cleared by the SR read, then DR read */
+#endif
+
+              //-------------------------------------------------------------
+              // Parts whose USARTs have a receiver timeout (end of burst
+              // detect). USARTs with an RX FIFO (USART_CR1_FIFOEN) use it.
+              //-------------------------------------------------------------
+#if defined(STM32F746xx) || defined(STM32F746NGHx) || defined(STM32L476xx)
+#define  UART_HAS_RX_TIMEOUT   1
 #endif
 
 
@@ -434,7 +489,33 @@ int  board_uart_init (unsigned int module_id, int tx_pin_id,
          //-------------------------------------------------
          // prep for any rcv queuing and/or echo-plexing
          //-------------------------------------------------
-    ioblock->io_buf_rx_head   = ioblock->io_buf_rx_tail  = 0;  // reset head and tail ptrs to clr buf
+    if (ioblock->io_rx_app_buf != 0L)      // App gave this port its own RX buf
+       ring_buf_init (&ioblock->io_rx_q, ioblock->io_rx_app_buf, ioblock->io_rx_app_size);
+       else ring_buf_init (&ioblock->io_rx_q, ioblock->io_rx_buf, UART_RX_BUF_SIZE);
+    uart_line_reset (&ioblock->io_line);   // no text line in progress
+
+#if defined(USART_CR1_FIFOEN)
+       //-------------------------------------------------------------------
+       // USART has an RX FIFO: turn it on. RXNE (= RXFNE) then stays up
+       // while the FIFO has data, and the ISR drains it all in one pass,
+       // so the ISR can be held off for several char times without an ORE
+       //-------------------------------------------------------------------
+    CLEAR_BIT (uart_hwbase->CR1, USART_CR1_UE);   // FIFOEN: only when disabled
+    SET_BIT (uart_hwbase->CR1, USART_CR1_FIFOEN);
+    SET_BIT (uart_hwbase->CR1, USART_CR1_UE);
+#endif
+
+#if defined(UART_HAS_RX_TIMEOUT)
+       //-------------------------------------------------------------------
+       // Receiver timeout: RTOF is raised once the RX line has been idle
+       // for UART_RX_TIMEOUT_BITS after the last char, i.e. at the end of
+       // a burst (a modem's response). The ISR passes that on to the App
+       // callback as UART_RX_DATA_READY.
+       //-------------------------------------------------------------------
+    uart_hwbase->RTOR = UART_RX_TIMEOUT_BITS;
+    SET_BIT (uart_hwbase->CR2, USART_CR2_RTOEN);
+    SET_BIT (uart_hwbase->CR1, USART_CR1_RTOIE);
+#endif
 
 //#if defined(STM32L053xx)
 //#else
@@ -445,6 +526,43 @@ int  board_uart_init (unsigned int module_id, int tx_pin_id,
 }
 
 
+//*****************************************************************************
+//  board_uart_set_rx_buffer
+//
+//             Give a port its own RX ring storage, instead of the default
+//             UART_RX_BUF_SIZE bytes, e.g. a bigger one for a port talking
+//             to an AT command modem that bursts long responses.
+//             size must be a power of 2. Anything already queued is
+//             discarded. Can be called before or after uart_Init().
+//
+//        Returns:   0 if OK    or     ERR_UART_RX_BUF_INVALID
+//                                or   ERR_UART_MODULE_NUM_OUT_OF_RANGE
+//*****************************************************************************
+
+int  board_uart_set_rx_buffer (unsigned int module_id, uint8_t *rx_buf, int size)
+{
+    int            rc;
+    IO_BUF_BLK     *ioblock;
+    RING_BUF       new_q;
+
+    rc = board_get_uart_io_block (module_id, &ioblock);
+    if (rc != 0)
+       return (rc);
+
+    if (size > 0xFFFF || ring_buf_init(&new_q, rx_buf, size) != 0)
+       return (ERR_UART_RX_BUF_INVALID);
+
+  __disable_irq();               // swap the ring under the RX ISR's feet
+    ioblock->io_rx_app_buf  = rx_buf;
+    ioblock->io_rx_app_size = (uint16_t) size;
+    ioblock->io_rx_q        = new_q;
+    ioblock->io_line.buf    = 0L;
+  __enable_irq();
+
+    return (0);            // completed OK
+}
+
+
 //*****************************************************************************
 //  board_uart_rx_flush
 //
@@ -465,8 +583,10 @@ int  board_uart_rx_flush (unsigned int module_id, int flags)
        return (rc);
 
                  // reset/clear out the buffer, by resetting internal buf index
-    ioblock->io_buf_rx_head = ioblock->io_buf_rx_tail  = 0;  // reset head/tail ptrs to clr buf
-    ioblock->io_buf_echo_head = ioblock->io_buf_echo_tail = 0;
+  __disable_irq();               // ISR is the producer: hold it off
+    ring_buf_reset (&ioblock->io_rx_q);
+  __enable_irq();
+    uart_line_reset (&ioblock->io_line);  // and drop any partial text line
 
     return (0);  // denote completed OK
 }
@@ -500,108 +620,121 @@ int  board_uart_rx_flush (unsigned int module_id, int flags)
 //
 //  Returns:  0   +   a line of text in user_buf, ending with \0
 //            or ERR_UART_RCV_TIMED_OUT (-305)
+//            or ERR_UART_RX_BUF_INVALID
 //            or ERR_xxxMODULE_ID_OUT_OF_RANGE (-300/-301)
 //*****************************************************************************
 
 int  board_uart_console_read_fdx (unsigned int module_id, uint8_t *user_buf, int max_buf_len,
                                   int pause_time, int max_wait_time, int flags)
 {
-    char           in_char;
     int            rc;
-    int            amt_to_read;
-    uint8_t        *buf_begin;
     IO_BUF_BLK     *ioblock;
 
     rc = board_get_uart_io_block (module_id, &ioblock);
     if (rc != 0)
        return (rc);
+    if (user_buf == 0L || max_buf_len < 2)
+       return (ERR_UART_RX_BUF_INVALID);
 
              //----------------------------------------------------------------
              //              by definition, this is blocking logic.
              //
              // If user does NOT want blocking logic, then he needs to use
              // board_uart_rx_data_check() and board_uart_get_char() instead !
+             //
+             // A line that was left part way by a timeout is carried on with,
+             // if the same buffer is passed back in.
              //----------------------------------------------------------------
-    ioblock->io_state_R = UART_STATE_RCV_COMPLETE;   // denote we a NOT using a user buffer
+    if (ioblock->io_state_R != UART_STATE_RCV_LINE  ||  ioblock->io_line.buf != user_buf)
+       board_uart_line_begin (ioblock, user_buf, max_buf_len);
     ioblock->io_expiry_time = _g_systick_millisecs + max_wait_time;  // save any timeout
-    buf_begin   = user_buf;
-    *user_buf   = '\0';        // ensure buf is initially cleared
-    amt_to_read = max_buf_len;
-    while (amt_to_read)
+
+    while (1)
       {      //------------------------------------------------------------------------
-             //  we wait and process anything that gets queued in our internal buffers.
+             //  process (and echo) anything that has been queued by the RX ISR
              //------------------------------------------------------------------------
-        if (ioblock->io_buf_rx_tail != ioblock->io_buf_rx_head)
-           { in_char = ioblock->io_rx_buf [ioblock->io_buf_rx_tail];
-             ioblock->io_buf_rx_tail = (ioblock->io_buf_rx_tail + 1) % IO_INTERNAL_CIRC_BUF_SIZE;  // update tail ptr
-
-                      //----------------------------------------------
-                      // determine if it is an activation char or not
-                      //----------------------------------------------
-            rc = 0;
-            if (in_char == '\b' || in_char == 0x7F)
-               {     // process a backspace
-                 if (user_buf != buf_begin)
-                    {     // backspace the user buffer to erase the previous character
-                      user_buf--;
-                      *user_buf = '\0';
-                      amt_to_read++;
-                    }
-                 rc = 2;                       // echo, but do not save the char
-               }
-              else if (in_char == '\r' || in_char == '\n' )
-                      { if (ioblock->io_str_last_char == '\r' && user_buf != buf_begin)
-                           rc = 2;  // ignore this. is last part of \r\n sequence
-                           else { if (user_buf == buf_begin)
-                                     *user_buf++ = '\n';  // treat as a standalone \n only line
-                                   *user_buf = '\0';      // set end of string
-                                   rc = 1;
-                                }
-                        ioblock->io_str_last_char = in_char; // save for \r\n check
-                      }
-                      // echo the char
-            board_uart_write_bytes (module_id, &in_char, 1, UART_WAIT_FOR_COMPLETE);
-
-            if (rc == 0)             // add a normal char to user buffer
-               {
-                 *user_buf++ = in_char;
-                 amt_to_read--;
-                 if (amt_to_read == 1)
-                    {      // buffer is essentially full. add \0 and post complete
-                      *user_buf = '\0';
-                      rc = 1;
-                    }
-               }
-              else if (in_char == '\r')
-                      rc = 1;              // force end of line/string
-            if (rc == 1)
-               return (0); // Tell caller we have a complete line of text.
-                           // For anything else, keep going. Backspaces are auto-deleted
-                           // inside board_uart_process_activation_chars()
-               // we just processed a char. update any max timeput
-            ioblock->io_expiry_time = _g_systick_millisecs + max_wait_time;
+        if ( ! ring_buf_is_empty (&ioblock->io_rx_q))
+           {     // we have input: update any max timeout
+             ioblock->io_expiry_time = _g_systick_millisecs + max_wait_time;
+             if (board_uart_line_assemble (module_id, ioblock, 1))
+                return (0);    // Tell caller we have a complete line of text.
            }
-
-        if (ioblock->io_buf_rx_tail == ioblock->io_buf_rx_head)
-           {          //------------------------------------------------------------
+                      //------------------------------------------------------------
                       // buffer is temporarily empty. Wait till we rcv another char.
-                      // We depend upon the interrupt handler to add any newly
-                      // received characters to the internal io_rx_buf[] queue.
                       //------------------------------------------------------------
-             if (pause_time != 0)
-                HAL_Delay (pause_time);  // sleep for low power mode (LPM) to save battery
+        if (pause_time != 0)
+           HAL_Delay (pause_time);  // sleep for low power mode (LPM) to save battery
 
-             if (max_wait_time)          // user has a max_timeout
-                if (_g_systick_millisecs > ioblock->io_expiry_time)
-                   return (ERR_UART_RCV_TIMED_OUT);  // hit the TIMEOUT limit - bail !
-           }
+        if (max_wait_time)          // user has a max_timeout
+           if (_g_systick_millisecs > ioblock->io_expiry_time)
+              return (ERR_UART_RCV_TIMED_OUT);  // hit the TIMEOUT limit - bail !
          // loop back and process any newly received character(s)
       }
+}
+
+
+//*****************************************************************************
+//  board_uart_check_io_completed
+//
+//          Check if a transmit started with UART_IO_NON_BLOCKING has completed.
+//
+//          Flags:    UART_WAIT_FOR_COMPLETE  -  wait till I/O is complete.
+//
+//          Returns:
+//              True  (1) = Completed  (or no transmit was ever started)
+//              False (0) = Busy
+//*****************************************************************************
+int  board_uart_check_io_completed (unsigned int module_id, int flags)
+{
+    int            rc;
+    IO_BUF_BLK     *ioblock;
+
+    rc = board_get_uart_io_block (module_id, &ioblock);
+    if (rc != 0)
+       return (rc);
 
-    return (0);
+    if (ioblock->io_state_T == UART_STATE_XMIT_BUSY)
+       { if ((flags & UART_WAIT_FOR_COMPLETE) == 0)
+            return (0);                   // I/O still busy
+                  // in future, call SEMAPHORE in NO_RTOS instead (low power)
+         while (ioblock->io_state_T == UART_STATE_XMIT_BUSY)
+           ;
+       }
+
+    return (1);                           // I/O Completed successfully
 }
 
 
+#if defined(USES_TIMESTAMP)
+//*****************************************************************************
+//  board_uart_get_rx_timestamp
+//
+//             Return the monotonic timestamps (usec) of the first byte of the
+//             current/last received frame, and of the most recent byte.
+//             A frame starts with the first byte queued into an empty
+//             internal RX buffer.
+//             Either ptr can be 0L if not needed.
+//*****************************************************************************
+int  board_uart_get_rx_timestamp (unsigned int module_id, uint64_t *first_usec,
+                                  uint64_t *last_usec)
+{
+    int            rc;
+    IO_BUF_BLK     *ioblock;
+
+    rc = board_get_uart_io_block (module_id, &ioblock);
+    if (rc != 0)
+       return (rc);
+
+    if (first_usec != 0L)
+       *first_usec = board_timestamp_ticks_to_usec (ioblock->io_rx_first_ticks);
+    if (last_usec != 0L)
+       *last_usec  = board_timestamp_ticks_to_usec (ioblock->io_rx_last_ticks);
+
+    return (0);                     // denote success
+}
+#endif
+
+
 //*****************************************************************************
 //  board_uart_rx_data_check                 aka   CONSOLE_CHECK_FOR_READ_DATA
 //
@@ -624,7 +757,7 @@ int  board_uart_rx_data_check (unsigned int module_id)
 
 // ??? return actual amt of data queued instead, that way app has a clue how much rcvd ???
 
-    if (ioblock->io_buf_rx_head != ioblock->io_buf_rx_tail)
+    if ( ! ring_buf_is_empty (&ioblock->io_rx_q))
        return (1);                  // yes, we have some data in internal RX buf
 
     return (0);                     // no, no data has been received
@@ -649,6 +782,7 @@ int  board_uart_rx_data_check (unsigned int module_id)
 int  board_uart_get_char (unsigned int module_id, int flags, int max_wait_time)
 {
     int            in_char;
+    uint8_t        q_char;
     int            rc;
     IO_BUF_BLK     *ioblock;
 
@@ -658,20 +792,11 @@ int  board_uart_get_char (unsigned int module_id, int flags, int max_wait_time)
     _g_ioblock_uart_trc = ioblock;         // DEBUG trace current I/O Buf Block
 
 return_data_to_user:
-  __disable_irq();           // Disable interrupts to avoid Head/Tail corruption
-   if (ioblock->io_buf_rx_head != ioblock->io_buf_rx_tail)
+   if (ring_buf_get (&ioblock->io_rx_q, &q_char))
       {          // pull a char that is queued in internal RX buffer
-        in_char = ioblock->io_rx_buf [ioblock->io_buf_rx_tail];
-        ioblock->io_buf_rx_tail = (ioblock->io_buf_rx_tail + 1) % IO_INTERNAL_CIRC_BUF_SIZE;  // update tail ptr
-        if (ioblock->io_str_last_char == '\r'  &&  in_char == '\n')
-           {   // Yes, so ignore the \n, because we already gave end of cmd signal
-               // to the user. Avoid handling up a second "end of cmd".
-             ioblock->io_str_last_char = 0; // clear out \r, so we treat any new \n as real.
-           }
-       __enable_irq();              // Re-enable interrupts
+        in_char = q_char;
         return (in_char);           // hand it up to caller
       }
-  __enable_irq();                   // Re-enable interrupts
 
    if (flags & UART_IO_NON_BLOCKING)
       return (WARN_WOULD_BLOCK);
@@ -683,7 +808,7 @@ return_data_to_user:
    ioblock->io_expiry_time = _g_systick_millisecs + max_wait_time;
    while (1)
      {
-       if (ioblock->io_buf_rx_head != ioblock->io_buf_rx_tail)
+       if ( ! ring_buf_is_empty (&ioblock->io_rx_q))
           goto return_data_to_user;            // we finally got some data
        if (max_wait_time)                      // user has a max timeout value
           if (_g_systick_millisecs > ioblock->io_expiry_time)
@@ -696,134 +821,68 @@ return_data_to_user:
 
 
 //*****************************************************************************
-//  board_uart_process_activation_chars
-//
-//             Perform CP-V style "activation character" processing for
-//             received string/char data:  i.e. if we get a \r or \n, then
-//             treat it as an end of string, and hand the current data up to
-//             the calling user application.
-//             For backspaces, delete the current character in the buffer
-//             and back up 1, in the input string.
+//  board_uart_line_begin
 //
-//             This style of processing takes a major burden of the User App
-//             programmer, since he will see a "string_data\r\n" as a
-//             single record, and does not need to parse the data to find
-//             ending \r\n indicators. The app can wait for a complete
-//             "record" or string, rather than having to do byte-at-a-time
-//             (read_char) processing.
+//             Start assembling a new text line into line_buf.
+//*****************************************************************************
+
+void  board_uart_line_begin (IO_BUF_BLK *ioblock, uint8_t *line_buf, int buf_max_length)
+{
+    uart_line_begin (&ioblock->io_line, line_buf, buf_max_length);
+    ioblock->io_state_R = UART_STATE_RCV_LINE;
+}
+
+
+//*****************************************************************************
+//  board_uart_line_echo
 //
-//       Returns status to UART_Common_IRQ_Handler which called us
+//             uart_line_assemble() echo-plex hook: send the char back out
+//             the port it came in on.
 //*****************************************************************************
 
-int  board_uart_process_activation_chars (IO_BUF_BLK  *ioblock,
-                                          uint8_t in_char, uint8_t *read_buf)
+static void  board_uart_line_echo (void *echo_parm, uint8_t out_char)
 {
-    int   event;
+    board_uart_write_bytes ((unsigned int) (uintptr_t) echo_parm, &out_char, 1,
+                            UART_WAIT_FOR_COMPLETE);
+}
 
-    event = 0;          // categorize if incoming char is a signficant event
-    if (in_char == '\b' || in_char == 0x7F)
-       event = 1;                          // backspace event
-       else if (in_char == '\r')
-               event = 2;                  // carriage return event
-       else if (in_char == '\n')
-               event = 3;                  // new line event
 
-     switch (event)
-       {
-         case 0:
-               return (0);                 // not an activation char
-
-         case 1:                           // backspace activation char
-                  // handle BACKSPACE character - erase previous char by stepping back one.
-               if (ioblock->io_state_R == UART_STATE_RCV_VIA_INTERRUPTS)
-                  {       // we are working directly with user buffer via active READ
-                    if (ioblock->io_rx_amt_rcvd == 0) // 0 indicates 1st char in buf
-                       return (2);                // no chars in buf. discard it
-                    ioblock->io_rcv_user_buf--;   // backspace rcv buf 1 char
-                    ioblock->io_rcv_max_length++;
-                    return (2);                   // discard the backspace
-                  }
-                 else
-                  {       // update our internal RX queue
-                    if (ioblock->io_buf_rx_head == ioblock->io_buf_rx_tail)
-                       return (2);             // no chars in buf. discard it
-                    if (ioblock->io_buf_rx_head == 0)
-                       ioblock->io_buf_rx_head = IO_INTERNAL_CIRC_BUF_SIZE; // handle a wrap around
-                       else ioblock->io_buf_rx_head--;                    // update head ptr
-                    ioblock->io_rx_buf [ioblock->io_buf_rx_head] = '\0';  // clear out the prev char
-                    return (2);         // discard this char, but allow any echo
-                  }
-               break;
-
-         case 2:                           // carriage return \r activation char
-                          // handle CARRIAGE RETURN char - treat as end of line
-               if (ioblock->io_state_R == UART_STATE_RCV_VIA_INTERRUPTS)
-                  {       // we are working directly with user buffer via active READ
-                          //----------------------------------------------------------------
-                          // Check if \r is the only input char. in such a case, it is
-                          // telling the user that he received a null line  (CR only).
-                          // For cross-platform usage (Windows vs Unix), we always pass
-                          // back a \n\0 sequence, to denote a NULL line rcvd.
-                          //----------------------------------------------------------------
-                    ioblock->io_str_last_char = '\r';       // save \r, to handle any \r\n sequence check
-                    if (ioblock->io_rcv_user_buf != 0L)
-                       { if (ioblock->io_rx_amt_rcvd == 0)        // 0 indicates 1st char in buf
-                            {
-                              *ioblock->io_rcv_user_buf++ = '\n'; // move in a \n to denote standalone line (CR only)
-                              *ioblock->io_rcv_user_buf   = '\0'; // set end of string null terminator
-                            }
-                           else {     // strip it off, and denote end of string/text_line
-                                  *ioblock->io_rcv_user_buf   = '\0'; // set end of string null terminator (to an existing string)
-                                }
-                       }
-                    return (1);   // tell caller it is end of string/text_line
-                  }
-                 else
-                  {       // update our internal RX queue
-                          // convert it to a NL to denote an end of string/text_line
-                    read_buf [ioblock->io_buf_rx_head] = '\n';   // denote end of line
-                    ioblock->io_buf_rx_head = (ioblock->io_buf_rx_head + 1) % IO_INTERNAL_CIRC_BUF_SIZE; // update head ptr
-                    ioblock->io_str_last_char = '\r';  // save \r, to handle any \r\n sequence check
-                    return (2);
-                  }
-               break;
-
-         case 3:                           // new line \n activation char
-               if (ioblock->io_state_R == UART_STATE_RCV_VIA_INTERRUPTS)
-                  {       // we are working directly with user buffer via an active READ
-                    if (ioblock->io_str_last_char == '\r')
-                       {       // this is end of a \r\n sequence. Discard the \n
-                         ioblock->io_str_last_char = 0;  // clear \r\n sequence flag
-                         if (ioblock->io_rx_amt_rcvd > 0)
-                            return (1);   // tell rupt handler it is end of text_line
-                         return (2);      // otherwise, just discard it.
-                       }
-                    if (ioblock->io_rcv_user_buf != 0L)
-                       {
-                         if (ioblock->io_rx_amt_rcvd == 0)            // 0 indicates 1st char in buf
-                            {       // Otherwise, this is a standalone \n, without a previous \r.
-                               // treat similar to above - return a \n to tell user that he got a null line (NL only)
-                              *ioblock->io_rcv_user_buf++ = '\n';     // copy it
-                              *ioblock->io_rcv_user_buf   = '\0';     // set end of string null terminator
-                            }
-                           else {   // we already have a bunch of chars in the buffer
-                                  *ioblock->io_rcv_user_buf   = '\0'; // set end of string null terminator
-                                }
-                       }
-                    return (1);      // tell caller it is end of string/text_line
-                  }
-                 else
-                  {       // update our internal RX queue
-                    if (ioblock->io_str_last_char == '\r')
-                       { ioblock->io_str_last_char = 0;  // clear \r\n sequence flag
-                         return (2);      // discard it. strip the \n when part of a \r\n sequence
-                       }
-                      else return (0);    // just copy the \n to internal buf
-                  }
-               break;
-       }                                  //   end   switch()
-
-    return (0);                 // denote more string data needs to be read in
+//*****************************************************************************
+//  board_uart_line_assemble
+//
+//             Runs at thread level: pulls whatever the RX ISR has queued,
+//             into the line started by board_uart_line_begin(), and echoes
+//             each char if asked to. The \r \n \b processing is done by
+//             uart_line_assemble() (common/uart_line.c).
+//
+//             A line that fills the buffer is handed up as is, and counted
+//             as truncated.
+//             When the line completes, the App callback (if any) is told
+//             UART_RX_COMPLETE, from the caller's (thread) context.
+//
+//       Returns:  1 = the line is complete,  0 = RX queue is empty, more
+//                 chars are needed (the partial line is kept in ioblock).
+//*****************************************************************************
+
+int  board_uart_line_assemble (unsigned int module_id, IO_BUF_BLK *ioblock, int echo)
+{
+    if (uart_line_assemble (&ioblock->io_line, &ioblock->io_rx_q,
+                            echo ? board_uart_line_echo : 0L,
+                            (void*) (uintptr_t) module_id) == 0)
+       return (0);
+
+    if (ioblock->io_line.truncated)
+       { ioblock->io_rx_truncated++;
+         ioblock->io_rx_flags |= UART_RX_LINE_TRUNCATED;
+       }
+    ioblock->io_state_R = UART_STATE_RCV_COMPLETE;
+    if (ioblock->io_callback_handler != 0L)
+       {                                   // tell the App the line is ready.
+                                           // Called at thread level
+         (ioblock->io_callback_handler) (ioblock->io_callback_parm,
+                                         module_id, UART_RX_COMPLETE);
+       }
+    return (1);
 }
 
 
@@ -841,163 +900,137 @@ int  board_uart_process_activation_chars (IO_BUF_BLK  *ioblock,
 int  board_uart_read_bytes (unsigned int module_id,
                             uint8_t *read_buf, int buf_length, int flags)
 {
-    uint8_t        in_byte;
     int            rc;
+    int            amt_rcvd;
     IO_BUF_BLK     *ioblock;
 
     rc = board_get_uart_io_block (module_id, &ioblock);
     if (rc != 0)
        return (rc);
+    if (read_buf == 0L || buf_length <= 0)
+       return (ERR_UART_RX_BUF_INVALID);
+    _g_ioblock_uart_trc = ioblock;         // DEBUG trace current I/O Buf Block
 
-    ioblock->io_is_string_IO = 0; // denote is BINARY I/O, so _no_ Activation Char processing
+              // for TIMEOUT checking, generate expected end time
+    ioblock->io_expiry_time = _g_systick_millisecs + ioblock->io_max_timeout_val;
 
-    rc = board_uart_read_common (module_id,ioblock, read_buf, buf_length, 0);
+    amt_rcvd = 0;
+    while (1)
+      {    // copy whatever the RX ISR has queued, straight to the user buf
+        amt_rcvd += ring_buf_read (&ioblock->io_rx_q, read_buf + amt_rcvd,
+                                   buf_length - amt_rcvd);
+        if (amt_rcvd == buf_length)
+           return (1);                     // tell caller we filled buffer
 
-    return (rc);
+// in future, call SEMAPHORE in NO_RTOS instead (to allow low power)
+
+           // if there is a Timeout limit, see if we reached it
+        if (ioblock->io_max_timeout_val)          // user specified a max timeout
+           { if (_g_systick_millisecs > ioblock->io_expiry_time)
+                return (ERR_UART_RCV_TIMED_OUT);  // hit the limit - bail !
+           }
+      }
 }
 
 
 //*****************************************************************************
-//  board_uart_read_common
-//
-//           Reads a full string of characters or binary data from the UART.
-//
-//           For strings, the I/O Interrupt Handler does the following:
-//             When we hit an end of string sequence, e.g. \r\n (Windows)
-//             or \n (Linux/Unix), we return a 1 to denote a valid cmd present.
-//
-//             We normally strip off the trailing \n or \r and replace it with
-//             a \0, UNLESS the buffer is empty. In that case we put in \n\0
-//             so that the App can determine that it is a "null" line (no
-//             string, just a carriage return/line feed was hit at the console).
+//  board_uart_read_text_line                           aka   CONSOLE_READ_LINE
 //
-//             If it is not and end of line \n or \r, we continue to loop,
-//             waiting for more UART input. (So yes, this is a blocking call).
+//              Reads a full line of of characters from the UART.
+//              We keep reading until we see a \r\n or \n which denotes
+//              the end of a line of text. See board_uart_line_assemble().
 //
-//             If we reach the end of the buffer with no \n end of sequence,
-//             then we truncate the cmd and hand up the buffer with \0 at end.
-//
-//             Note this is an absolute BARE BONES implementation, in order
-//             to be able to run on small memory MCUs. The vendor's HAL
-//             libraries have major bloat-ware in there, so I am avoiding them.
+//              With UART_IO_NON_BLOCKING, returns WARN_WOULD_BLOCK until the
+//              line is complete: call again with the same read_buf, and it
+//              carries on with the partial line.
 //
 //        Returns:   1 if complete    or     ERR_UART_RCV_TIMED_OUT
-//
-// UART read_Xxxx() routines update only the RX tail pointer for internal RX circular queue.
+//                                    or     WARN_WOULD_BLOCK  (450)
+//                                    or     ERR_UART_RX_BUF_INVALID
 //*****************************************************************************
 
-int  board_uart_read_common (unsigned int module_id, IO_BUF_BLK *ioblock,
-                             uint8_t *user_read_buf, int buf_max_length,
-                             int is_string_IO)
+int  board_uart_read_text_line (unsigned int module_id,
+                                char *read_buf, int buf_max_length, int flags)
 {
-    char     *begin_buf;
-    char     in_char;
-    int      rc;
-    int      amt_left;
+    int            rc;
+    IO_BUF_BLK     *ioblock;
 
+    rc = board_get_uart_io_block (module_id, &ioblock);
+    if (rc != 0)
+       return (rc);
+    if (read_buf == 0L || buf_max_length < 2)
+       return (ERR_UART_RX_BUF_INVALID);
     _g_ioblock_uart_trc = ioblock;         // DEBUG trace current I/O Buf Block
 
-    begin_buf = user_read_buf;
-    ioblock->io_rx_amt_rcvd   = 0;
-    ioblock->io_rcv_echo_ptr  = user_read_buf;
-
-             //-----------------------------------------------------------------
-             // first, move any data from internal RX queue buffer to user buf.
-             //-----------------------------------------------------------------
-   amt_left = buf_max_length;
-__disable_irq();             // Disable interrupts to avoid Head/Tail corruption
-   while (ioblock->io_buf_rx_head != ioblock->io_buf_rx_tail)
-     {                       // copy from our internal buf to user app buf
-       in_char = ioblock->io_rx_buf [ioblock->io_buf_rx_tail];
-       *user_read_buf = in_char;
-       amt_left--;
-                             // update tail ptr
-       ioblock->io_buf_rx_tail = (ioblock->io_buf_rx_tail + 1) % IO_INTERNAL_CIRC_BUF_SIZE;
-       if (is_string_IO  &&  (in_char == '\n' || amt_left <= 1))
-          {        //------------------------------------------------------
-                   // we hit end of a string.  return this string to user
-                   // see if this is a standalone \n  (NL only or CR only)
-                   //------------------------------------------------------
-            if (user_read_buf == begin_buf)
-               {     // this is first char in buf so pass thru the standalone \n
-                 user_read_buf++;  // step to next position in buf to put \0
-               }                   // otherwise, overlay the trailing \n with \0
-            *(user_read_buf) = '\0';  // ensure null terminator \0 is appended
-            ioblock->io_str_last_char = 0;  // clear out any \r indicator
-          __enable_irq();          // Macro to re-enable rupts
-            return (1);            // tell caller we got a string
-          }
-         else if (amt_left == 0)
-                  {
-                  __enable_irq();  // Macro to re-enable rupts
-                    return (1);    // tell caller we filled buffer
-                  }
-                                   //----------------------------------------
-       user_read_buf++;            //  step to next char in user app buffer
-     }                             //----------------------------------------
-              //----------------------------------
-              // there is still more data needed
-              //----------------------------------
-    ioblock->io_rx_amt_rcvd    = buf_max_length - amt_left;
-    ioblock->io_rcv_max_length = amt_left;   // Save I/O length and user buf ptr
-         // start Interrupt reads _after_ the chars that were already rcvd in the above head/tail loop
-    ioblock->io_rcv_user_buf   = user_read_buf;   // points to next open position in user buf
-    ioblock->io_state_R  = UART_STATE_RCV_VIA_INTERRUPTS; // denote I/O in progress
+    if (ioblock->io_state_R != UART_STATE_RCV_LINE
+       ||  ioblock->io_line.buf != (uint8_t*) read_buf)
+       board_uart_line_begin (ioblock, (uint8_t*) read_buf, buf_max_length);
 
               // for TIMEOUT checking, generate expected end time
     ioblock->io_expiry_time = _g_systick_millisecs + ioblock->io_max_timeout_val;
 
-              //--------------------------------------------------------------
-              // Wait for intyerrupt handler to complete reading in the
-              // rest of the characters. It will move them direct to user buf
-              //--------------------------------------------------------------
-__enable_irq();              // Macro to re-enable interrupts
+    while (board_uart_line_assemble (module_id, ioblock, 0) == 0)
+      {
+        if (flags & UART_IO_NON_BLOCKING)
+           return (WARN_WOULD_BLOCK);      // partial line is kept for next call
 
 // in future, call SEMAPHORE in NO_RTOS instead (to allow low power)
 
-    while (ioblock->io_state_R == UART_STATE_RCV_VIA_INTERRUPTS)
-      {    // ioblock->io_state_R will be set to UART_STATE_RCV_COMPLETE in ISR
-           // when the max length has been reached, or an activation character rcvd.
-
            // if there is a Timeout limit, see if we reached it
         if (ioblock->io_max_timeout_val)          // user specified a max timeout
            { if (_g_systick_millisecs > ioblock->io_expiry_time)
                 return (ERR_UART_RCV_TIMED_OUT);  // hit the limit - bail !
            }
-      }                            //   end   while()
+      }
 
-  return (1);                      // tell caller we filled buffer
+    return (1);                      // tell caller we got a line
 }
 
 
 //*****************************************************************************
-//  board_uart_read_text_line                           aka   CONSOLE_READ_LINE
+//  board_uart_get_rx_stats
 //
-//              Reads a full line of of characters from the UART.
-//              We keep reading until we see a \r\n or \n which denotes
-//              the end of a line of text.
+//             Return a port's receive counters, and its sticky UART_RX_xxx
+//             flags (any data lost or cut short since the last reset).
+//             reset_flag = 1 clears them, after the copy.
 //
-//        Returns:   1 if complete    or     ERR_UART_RCV_TIMED_OUT
+//        Returns:   0 if OK    or     ERR_UART_MODULE_NUM_OUT_OF_RANGE
 //*****************************************************************************
 
-int  board_uart_read_text_line (unsigned int module_id,
-                                char *read_buf, int buf_max_length, int flags)
+int  board_uart_get_rx_stats (unsigned int module_id, UART_RX_STATS *stats,
+                              int reset_flag)
 {
-    char           in_char;
     int            rc;
-    int            amt_left;
     IO_BUF_BLK     *ioblock;
 
     rc = board_get_uart_io_block (module_id, &ioblock);
     if (rc != 0)
        return (rc);
 
-    ioblock->io_is_string_IO = 1; // denote is STRING I/O, so enable Activation Char processing
-
-    rc = board_uart_read_common (module_id, ioblock, (uint8_t*) read_buf,
-                                 buf_max_length, 1);
+  __disable_irq();               // counters are updated by the RX ISR
+    if (stats != 0L)
+       { stats->rcvd       = ioblock->io_rx_rcvd;
+         stats->drops      = ioblock->io_rx_drops;
+         stats->overruns   = ioblock->io_rx_overruns;
+         stats->errors     = ioblock->io_rx_errors;
+         stats->truncated  = ioblock->io_rx_truncated;
+         stats->queued     = (uint16_t) ring_buf_count (&ioblock->io_rx_q);
+         stats->max_queued = ioblock->io_rx_max_queued;
+         stats->buf_size   = (uint16_t) ring_buf_size (&ioblock->io_rx_q);
+         stats->flags      = ioblock->io_rx_flags;
+       }
+    if (reset_flag)
+       { ioblock->io_rx_rcvd       = 0;
+         ioblock->io_rx_drops      = 0;
+         ioblock->io_rx_overruns   = 0;
+         ioblock->io_rx_errors     = 0;
+         ioblock->io_rx_truncated  = 0;
+         ioblock->io_rx_max_queued = 0;
+         ioblock->io_rx_flags      = 0;
+       }
+  __enable_irq();
 
-    return (rc);
+    return (0);                              // indicate it worked OK
 }
 
 
@@ -1111,7 +1144,7 @@ tx_send_calls++;
            // send first byte in user buf   // Hopefully above eliminates the truncated 1st char we are seeing on RX side !
     tx_char = *ioblock->io_user_buffer++;      // Trace it
     _g_tx_trace[_g_tx_trace_idx] = tx_char;   // trace everything to a 512 byte buf
-    _g_tx_trace_idx = (_g_tx_trace_idx + 1) % UART_TRACE_BUF_SIZE; // auto-wrap trace index
+    _g_tx_trace_idx = (_g_tx_trace_idx + 1) & UART_TRACE_BUF_SIZE; // auto-wrap trace index
 
     pUartHdl->Instance->XMIT_REG = (uint32_t) tx_char;   // Send it
     ioblock->io_tx_amt_sent++;
@@ -1163,6 +1196,7 @@ int  board_uart_write_string (unsigned int module_id, char *outstr, int flags)
 //                            UART      ISRs
 //
 // ISR routine updates only the RX head pointer for internal RX circular queue.
+// It does no text line processing, so its time per char is short and fixed.
 //*****************************************************************************
 //*****************************************************************************
 
@@ -1170,10 +1204,14 @@ void  board_common_UART_IRQHandler (USART_TypeDef *uart_module, int uart_module_
 {
     UART_HandleTypeDef  *pUartHdl;
     uint32_t            rupt_flag;
+    uint32_t            status;
     uint8_t             in_char;
     uint8_t             tx_char;
-    int                 next_to_last_byte_idx;
-    int                 rc;
+    int                 queued;
+    int                 rx_event;
+#if defined(USES_TIMESTAMP)
+    int                 stamp_first;
+#endif
     IO_BUF_BLK          *ioblock;
 
     pUartHdl = (UART_HandleTypeDef*) _g_uart_typedef_handle_addr [uart_module_id];
@@ -1191,111 +1229,90 @@ void  board_common_UART_IRQHandler (USART_TypeDef *uart_module, int uart_module_
     if (rupt_flag != 0)
        {
 idle_rupt_count++;
-         pUartHdl->Instance->ICR |= USART_ICR_CLEAR_IDLE;  // clear and discard it
-//       in_char = (uint8_t) pUartHdl->Instance->RCV_REG;  // read and discard it ?
+         UART_CLEAR_FLAGS (pUartHdl->Instance, USART_ICR_CLEAR_IDLE);  // clear and discard it
        }
          //----------------------------------------
          //    Process a receive RXNE
          //----------------------------------------
-    rupt_flag = (pUartHdl->Instance->STATUS_REG & USART_SR_RXNE);
-    if (rupt_flag != 0  &&  (pUartHdl->Instance->CR1 & USART_CR1_RXNEIE))  // verify rupt is enabled
+    rx_event = 0;
+    status   = pUartHdl->Instance->STATUS_REG;
+    if ((status & USART_SR_RXNE)  &&  (pUartHdl->Instance->CR1 & USART_CR1_RXNEIE))  // verify rupt is enabled
        {
 rxne_rupt_count++;
-rx_char_rcvd++;
-                  //------------------------------
-                  //     process a rcvd byte.
-                  //-------------------------------
+         if (status & USART_SR_LINE_ERRS)
+            {     // framing / noise / parity error on the char in RDR.
+                  // It is still queued: the App's protocol checks catch it
+              ioblock->io_rx_errors++;
+              ioblock->io_rx_flags |= UART_RX_LINE_ERROR;
+              UART_CLEAR_FLAGS (pUartHdl->Instance, USART_ICR_CLEAR_FLAGS);
+            }
+#if defined(USES_TIMESTAMP)
+         if (ring_buf_is_empty (&ioblock->io_rx_q))   // queue was empty
+            stamp_first = 1;
+            else stamp_first = 0;
+         ioblock->io_rx_last_ticks = board_timestamp_get_ticks(); // stamp on arrival
+         if (stamp_first)
+            ioblock->io_rx_first_ticks = ioblock->io_rx_last_ticks;
+#endif
+                  //-------------------------------------------------------------
+                  // queue every rcvd byte that is waiting (with an RX FIFO,
+                  // there can be several). No line processing is done here:
+                  // the read calls do that at thread level.
                   // Note: reading in the byte automatically clears the RXNE rupt
-         in_char = (uint8_t) pUartHdl->Instance->RCV_REG;
-
+                  //-------------------------------------------------------------
+         do
+           { in_char = (uint8_t) pUartHdl->Instance->RCV_REG;
+rx_char_rcvd++;
 _g_rx_trace[_g_rx_trace_idx] = in_char;          // trace everything to a 512 byte buf
-_g_rx_trace_idx = (_g_rx_trace_idx + 1) % UART_TRACE_BUF_SIZE;     // auto-wrap trace index
-
-         rc = 0;
-         if (ioblock->io_is_string_IO && (in_char <= '\r' || in_char == 0x7F))
-            {     //---------------------------------------------------------------------
-                  // this is string I/O, so process any special chars like \b \r or \n
-                  // it returns 1 of 4 return codes:  0 = process normally,   do any echo
-                  //                                  1 = operation complete, do any echo
-                  //                                  2 = backspace: discard, do any echo
-                  //                                 -3 = other:     discard, do NOT echo
-                  //---------------------------------------------------------------------
-              rc = board_uart_process_activation_chars (ioblock, in_char, ioblock->io_rx_buf);
-            }
-
-         if (rc == 0)
-            { ioblock->io_str_last_char = in_char;    // save char, to handle any \r\n sequence check
-                        //------------------------------------------------
-                        // determine where to store the received char
-                        //------------------------------------------------
-              if (ioblock->io_state_R == UART_STATE_RCV_VIA_INTERRUPTS)
-                 {      //------------------------------------------------
-                        // we are in the middle of a user app active READ.
-                        // copy it directly to the user app's buffer.
-                        //------------------------------------------------
-                   *ioblock->io_rcv_user_buf++ = in_char;     // save char into user rcv buffer
-                   ioblock->io_rcv_max_length--;              // deduct # bytes left to rcv
-                  if (ioblock->io_is_string_IO)
-                     {     // see if we have hit the max size string/text_line we can put in buf
-                       if (ioblock->io_rcv_max_length == 1)
-                          {    // we've filled the buffer. Return completed buf to caller
-                            *ioblock->io_rcv_user_buf = '\0'; // append \0 to denote end of string/text_line
-                            rc = 1;                  // set condition as "read is complete"
-                          }
-                     }
-                    else if (ioblock->io_rcv_max_length == 0) // is a uart_read_bytes() op
-                            rc = 1;                  // set condition as "read is complete"
-                   ioblock->io_rx_amt_rcvd++;                 // inc # bytes rcvd
-                 }
-                else
-                 {      //--------------------------------------
-                        //  queue into our internal RX buffer.
-                        //--------------------------------------
-                  ioblock->io_rx_buf [ioblock->io_buf_rx_head] = in_char; // save char into our internal RX queue
-                        // update head ptr
-                  ioblock->io_buf_rx_head = (ioblock->io_buf_rx_head + 1) % IO_INTERNAL_CIRC_BUF_SIZE;
-                 }
-
-            }
-
-//  ??? NEED TO HANDLE ECHO-PLEX on  in_char   !!! ???   WVD  !!! ???    (if rc != 3)
-
-// 09/22/15
-//    RE-WORK THIS TO SLIDING / ROTATING INTERNAL BUFFER ala ARDUINO, and
-//    DISCARD CHARS IF REACH LIMIT, W/FLAG WARNING SET ON ANY USER RCV CALL
-//    ALSO, CHANGE uart_read_string() logic to operate as a higher level,
-//    that call lower level to just read chars, and upper level processes them
-//    Possibly change it to a "uart_console_read() call instead ???
-
-         if (ioblock->io_state_R == UART_STATE_RCV_VIA_INTERRUPTS  &&  rc == 1)
-            {        //-----------------------------------------------------------------------
-                     // we are all done with a user app "active READ".
-                     // Post the operation complete and issue any callback to user.
-                     //
-                     // Note: Unlike HAL, we do _NOT_ turn off RX rupts, because with full
-                     // duplex devices like SIM808 or ESP8266, there is always a timing window
-                     // to bite us. So any subsequent rcvd chars get queued in internal buf.
-                     //-----------------------------------------------------------------------
-              ioblock->io_state_R = UART_STATE_RCV_COMPLETE;   // set ending status
-if (ioblock->io_rx_amt_rcvd > 1)    // DEBUG HOOK for strings >  just \n
-              ioblock->io_rcv_user_buf = 0L;  // clear ptr to denote no more active user READ
-              if (ioblock->io_callback_handler != 0L)
-                 {                            // Invoke any user callback for the interrupt
-                    (ioblock->io_callback_handler) (ioblock->io_callback_parm,
-                                                    uart_module_id, UART_RX_COMPLETE);
-                 }
-            }
+_g_rx_trace_idx = (_g_rx_trace_idx + 1) & UART_TRACE_BUF_SIZE;     // auto-wrap trace index
+
+                        // save char into our internal RX queue. If the
+                        // App is not keeping up, drop it (and flag it).
+             if (ring_buf_put (&ioblock->io_rx_q, in_char))
+                { ioblock->io_rx_rcvd++;
+                  queued = ring_buf_count (&ioblock->io_rx_q);
+                  if (queued > ioblock->io_rx_max_queued)
+                     ioblock->io_rx_max_queued = (uint16_t) queued;
+                }
+               else
+                { ioblock->io_rx_drops++;
+                  ioblock->io_rx_flags |= UART_RX_BUF_FULL;
+                }
+             if (in_char == '\n' || in_char == '\r')
+                rx_event = 1;              // end of a text line: tell the App
+           } while (pUartHdl->Instance->STATUS_REG & USART_SR_RXNE);
        }                    //  end  if rupt_flag != 0
 
-         //------------------------------------------
-         //  Process a Receive Overrun ORE condition
-         //------------------------------------------
-    rupt_flag = pUartHdl->Instance->STATUS_REG & USART_SR_ORE;
-    if (rupt_flag != 0)  //  &&  (pUartHdl->Instance->CR1 & USART_CR1_OREIE))  // verify rupt is enabled
+         //------------------------------------------------------------------
+         //  Process a Receive Overrun ORE condition: a char arrived while
+         //  RDR was still full, and was lost in the USART. The char that
+         //  was in RDR is good, and was queued above: just count it, and
+         //  clear ORE (the SR/DR parts clear it with the SR then DR read).
+         //------------------------------------------------------------------
+    if (status & USART_SR_ORE)
        {
 ore_rupt_count++;
-         in_char = (uint8_t) pUartHdl->Instance->RCV_REG;   // discard whatr is in buffer
-         in_char = (uint8_t) pUartHdl->Instance->RCV_REG;   // hit a second time to be sure
+         ioblock->io_rx_overruns++;
+         ioblock->io_rx_flags |= UART_RX_OVERRUN;
+         UART_CLEAR_FLAGS (pUartHdl->Instance, USART_ICR_CLEAR_ORE);
+       }
+
+#if defined(UART_HAS_RX_TIMEOUT)
+         //------------------------------------------------------------------
+         //  Receiver timeout: the line has gone idle after a burst
+         //------------------------------------------------------------------
+    if (pUartHdl->Instance->STATUS_REG & USART_ISR_RTOF)
+       {
+         UART_CLEAR_FLAGS (pUartHdl->Instance, USART_ICR_RTOCF);
+         rx_event = 1;
+       }
+#endif
+
+    if (rx_event  &&  ioblock->io_callback_handler != 0L)
+       {                            // tell the App there is input to process.
+                                    // Called at ISR level: keep it short
+         (ioblock->io_callback_handler) (ioblock->io_callback_parm,
+                                         uart_module_id, UART_RX_DATA_READY);
        }
 
          //----------------------------------------
@@ -1310,7 +1327,7 @@ txe_rupt_count++;
             {     // send next byte in user buffer
               tx_char = *ioblock->io_user_buffer++;
               _g_tx_trace[_g_tx_trace_idx] = tx_char;   // trace everything to a 512 byte buf
-              _g_tx_trace_idx = (_g_tx_trace_idx + 1) % UART_TRACE_BUF_SIZE; // auto-wrap trace index
+              _g_tx_trace_idx = (_g_tx_trace_idx + 1) & UART_TRACE_BUF_SIZE; // auto-wrap trace index
               pUartHdl->Instance->XMIT_REG = (uint32_t) tx_char;
               ioblock->io_tx_amt_sent++;
 tx_char_sent++;
@@ -1354,14 +1371,16 @@ tc_rupt_count++;
 ///    pUartHdl->Instance->XMIT_REG = 0xFF;  // per tech ref, clear TC flag by writing dummy byte to DR/TDR
       }
            //-------------------------------------------------------------
-           // handle any other RX errors, that can lead to an ORE lockup
+           // clear any RX error left without a char (e.g. a framing error
+           // on a break), that can lead to looping in this ISR
            //-------------------------------------------------------------
-    rupt_flag = pUartHdl->Instance->STATUS_REG & USART_SR_OTHER_RE_ERRS;
-    if (rupt_flag != 0)  //  &&  (pUartHdl->Instance->CR1 & USART_CR1_OREIE))  // verify rupt is enabled
+    rupt_flag = pUartHdl->Instance->STATUS_REG & (USART_SR_LINE_ERRS | USART_SR_ORE);
+    if (rupt_flag != 0  &&  (pUartHdl->Instance->STATUS_REG & USART_SR_RXNE) == 0)
        {
 other_rx_err_rupt_count++;
-         in_char = (uint8_t) pUartHdl->Instance->RCV_REG;   // discard what is in buffer
-         pUartHdl->Instance->ICR |= USART_ICR_CLEAR_FLAGS;  // and clear any RX error flags
+         in_char = (uint8_t) pUartHdl->Instance->RCV_REG;  // no char waiting: SR/DR
+                                                            // parts clear on this
+         UART_CLEAR_FLAGS (pUartHdl->Instance, USART_ICR_CLEAR_FLAGS | USART_ICR_CLEAR_ORE);
        }
 }                                 //   end   board_common_UART_IRQHandler()
 
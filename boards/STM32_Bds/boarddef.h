@@ -14,6 +14,10 @@
 //   xx/xx/xx - Created.
 //   12/14/14 - Renamed from board.h to boarddef.h, so we do not accidentally
 //              pick up some of the board.h defs that TI has in their projects.
+//   10/19/26 - Added the interrupt priority plan (IRQ_PRIO_xxx classes) and
+//              deferred bottom half APIs.
+//   10/19/26 - Added reset cause and RTC backup register APIs (warm boot).
+//   10/19/26 - Added UART RX buffer and RX stats APIs.
 //
 //
 // MCU Hardware supported:
@@ -103,6 +107,59 @@ extern const  GPIO_TypeDef *_g_gpio_base[];    // SEPARATE LIB ISSUE !!! ??? WVD
 #ifndef USES_I2C
 #define  USES_I2C        // ensure I2C turned on for MEMS Sensors
 #endif
+#endif
+
+              //****************************************************************
+              //                   Interrupt  Priority  Plan
+              //
+              // Every board ISR is set to one of these classes, instead of
+              // a hardcoded number. The NVIC is run with all priority bits
+              // as pre-emption bits (NVIC_PRIORITYGROUP_4, no sub-priority),
+              // so a class pre-empts every class below it, and ISRs within a
+              // class never pre-empt each other.
+              //
+              //   HARD_RT     motor control, ADC/DAC DMA, timers: work that
+              //               has a deadline every PWM / sample period
+              //   COMMS       SPI, I2C, UART, BLE, radio, network: have FIFOs
+              //               or DMA behind them, so they can wait a bit
+              //   HOUSEKEEP   SysTick / VTIMERs, RTC, fault flag pins
+              //   BOTTOM_HALF PendSV: callback work deferred out of the
+              //               ISRs above (board_bh_schedule), lowest of all
+              //
+              // Worst case entry latency of a HARD_RT ISR is then bounded by
+              // the longest HARD_RT ISR (max_run_cycles of IRQ_CLASS_HARD_RT)
+              // plus the longest interrupts-off critical section. Levels 0-1
+              // are left free for an App ISR that must beat even HARD_RT
+              // (e.g. an over-current trip). Override in project_config_parms.h
+              //****************************************************************
+#if defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+#ifndef IRQ_PRIO_HARD_RT                 // Cortex-M3/M4/M7: 16 levels (4 bits)
+#define  IRQ_PRIO_HARD_RT           2
+#define  IRQ_PRIO_COMMS             6
+#define  IRQ_PRIO_HOUSEKEEP        10
+#define  IRQ_PRIO_BOTTOM_HALF      15    /* must be the lowest */
+#endif
+#define  IRQ_CYCLE_COUNT()       (DWT->CYCCNT)
+#else
+#ifndef IRQ_PRIO_HARD_RT                 // Cortex-M0/M0+ (F0, L0): 4 levels
+#define  IRQ_PRIO_HARD_RT           0
+#define  IRQ_PRIO_COMMS             1
+#define  IRQ_PRIO_HOUSEKEEP         2
+#define  IRQ_PRIO_BOTTOM_HALF       3
+#endif
+#define  IRQ_CYCLE_COUNT()       0       /* no DWT: stats count runs only */
+#endif
+
+#define  IRQ_CLASS_HARD_RT          0    /* stats index per priority class */
+#define  IRQ_CLASS_COMMS            1
+#define  IRQ_CLASS_HOUSEKEEP        2
+#define  IRQ_CLASS_BOTTOM_HALF      3
+#define  IRQ_NUM_CLASSES            4
+
+#define  IRQ_LATENCY_UNKNOWN   0xFFFFFFFF  /* ISR can not tell when its event occurred */
+
+#ifndef BH_MAX_HANDLERS
+#define  BH_MAX_HANDLERS            8    /* bottom halves that can be registered (<= 32) */
 #endif
 
               //****************************************************************
@@ -149,6 +206,9 @@ int  board_adc_get_results (unsigned int adc_module_id, int sequencer,
                             uint16_t  channel_results[]);
 int  board_adc_get_resolution (unsigned int module_id);
 int  board_adc_set_callback (unsigned int adc_module_id, ADC_CB_EVENT_HANDLER callback_function, void *callback_parm);
+int  board_adc_set_callback_deferred (unsigned int adc_module_id, ADC_CB_EVENT_HANDLER callback_function, void *callback_parm);
+struct adc_dsp_stage_def;                        // see adc_dsp_filter.h
+int  board_adc_set_dsp_stage (unsigned int adc_module_id, struct adc_dsp_stage_def *dsp_stage);
 int  board_adc_set_resolution (unsigned int module_id, int bit_resolution);
 int  board_adc_user_trigger_start (unsigned int adc_module_id, int sequencer);
 
@@ -256,6 +316,9 @@ int  board_spi_write_read (unsigned int spi_module_id, uint8_t *transmit_buffer,
                            int flags);
 void  board_spi_dma_init (void);
 void  board_spi_IRQ_Handler (int spi_interrupt_number);
+struct spi_bus_def;                               // see spi_bus.h
+int   board_spibus_init (struct spi_bus_def *bus, unsigned int spi_module_id,
+                         int flags, SPI_HandleTypeDef *caller_hspi);
 
 
 
@@ -265,7 +328,16 @@ void  board_spi_IRQ_Handler (int spi_interrupt_number);
 int  board_timerpwm_init (unsigned int module_id, int counter_type, long period_value,
                           int timer_clock_source, int flags,
                           TIM_HandleTypeDef *ptr_Caller_TimHdl);  // extended support
+struct icap_engine_def;                          // see input_capture.h
+int  board_timerpwm_capture_start (unsigned int module_id, int channel_id,
+                                   struct icap_engine_def *icap, void *ring, int ring_size,
+                                   int flags, DMA_HandleTypeDef *caller_hdma);
+int  board_timerpwm_capture_update (unsigned int module_id);
+int  board_timerpwm_capture_stop (unsigned int module_id);
+void board_timerpwm_capture_dma_isr (unsigned int module_id);
 int  board_timerpwm_check_completed (unsigned int module_id, int check_mask, int reset_flags);
+int  board_timerpwm_encoder_init (unsigned int module_id, int filter, int flags);
+uint32_t board_timerpwm_encoder_get_count (unsigned int module_id);
 int  board_timerpwm_config_channel (unsigned int module_id, int channel_id, long initial_duty, int mode, int flags);
 int  board_timerpwm_config_channel_pair (unsigned int module_id, int channelA_id, int channelB_id, int flags);
 int  board_timerpwm_config_trigger_mode (unsigned int module_id, int adc_dac_module_id,
@@ -282,12 +354,20 @@ long board_timerpwm_get_period (unsigned int module_id);
 TIM_HandleTypeDef * board_timerpwm_get_handle (unsigned int module_id);
 int  board_timerpwm_reset_CCR_output (unsigned int module_id, int chan_id, int flags);
 int  board_timerpwm_set_callback (unsigned int module_id, TMR_CB_EVENT_HANDLER callback_function, void *callback_parm);
+int  board_timerpwm_set_callback_deferred (unsigned int module_id, TMR_CB_EVENT_HANDLER callback_function, void *callback_parm);
 int  board_timerpwm_set_channel_output (unsigned int module_id, int channel_id, int output_mode, int flags);
 int  board_timerpwm_set_dead_time (unsigned int module_id, int rising_edge, int falling_edge);
 int  board_timerpwm_set_duty_cycle (unsigned int modgen_id, int chan_num, long duty_cycle, int flags);
+int  board_timerpwm_set_duty_cycles (unsigned int module_id, const uint32_t *ccr_values,
+                                     int num_channels, int flags);
 int  board_timerpwm_set_period (unsigned int module_id, long new_period_value, int flags);
 int  board_timerpwm_set_phase (unsigned int module_id, int channel_id, long phase_offset);
 int  board_timerpwm_set_prescalar (unsigned int module_id, long prescalar_val, int flags);
+int  board_timerpwm_stream_start (unsigned int module_id, const void *duty_seq,
+                                  int num_channels, int num_steps, int flags,
+                                  DMA_HandleTypeDef *caller_hdma);
+int  board_timerpwm_stream_status (unsigned int module_id);
+int  board_timerpwm_stream_stop (unsigned int module_id);
 
                   //------------------
                   //  Sysclocks  APIs
@@ -299,6 +379,56 @@ long  board_sys_IO_clock_get_frequency (void);
 void  board_systick_timer_config (void);
 unsigned long  board_systick_timer_get_value (void);
 
+                  //-------------------------------------------------
+                  //  Interrupt Plan / Bottom Half APIs
+                  //     board_irq_plan_init() is in board.c, the rest
+                  //     in board_STM32_irq.c (USES_IRQ_BOTTOM_HALF,
+                  //     USES_IRQ_STATS)
+                  //-------------------------------------------------
+void  board_irq_plan_init (void);
+void  board_irq_stats_record (int irq_class, uint32_t latency_cycles, uint32_t run_cycles);
+int   board_irq_get_stats (int irq_class, IRQ_CLASS_STATS *stats, int reset_flag);
+int   board_bh_register (BH_EVENT_HANDLER handler, void *parm);
+int   board_bh_schedule (int bh_id, uint32_t events);      // ISR safe
+void  board_bh_dispatch (void);                            // PendSV_Handler
+int   board_bh_get_stats (int bh_id, BH_STATS *stats, int reset_flag);
+
+                  //------------------------------------------
+                  //  64-bit Timestamp APIs  (USES_TIMESTAMP)
+                  //------------------------------------------
+int       board_timestamp_init (void);
+uint64_t  board_timestamp_get_ticks (void);
+uint64_t  board_timestamp_get_usec (void);
+uint64_t  board_timestamp_get_wall_usec (void);
+uint64_t  board_timestamp_ticks_to_usec (uint64_t ticks);
+int       board_timestamp_discipline (uint64_t ref_usec);
+int       board_timestamp_discipline_rtc (void);
+int       board_rtc_get_usec_of_day (uint64_t *usec_of_day, uint64_t *ticks);
+int       board_adc_get_frame_timestamp (unsigned int module_id, uint64_t *frame_usec);
+int       board_adc_get_frame_ticks (unsigned int module_id, uint64_t *frame_ticks);
+int       board_uart_get_rx_timestamp (unsigned int module_id, uint64_t *first_usec,
+                                       uint64_t *last_usec);
+
+                  //----------------------------------------------
+                  //  Tickless Low Power APIs  (USES_TICKLESS_IDLE)
+                  //----------------------------------------------
+int   board_lowpower_idle (uint32_t max_idle_ms, int flags);
+void  board_lowpower_set_stop_handler (LPM_ENTRY_HANDLER stop_handler);
+void  board_lowpower_get_stats (LOWPOWER_STATS *stats, int reset_flag);
+void  board_systick_advance (uint32_t elapsed_ms);
+int   board_rtc_get_subsec_count (uint32_t *subsec_count, uint32_t *subsec_per_sec,
+                                  int resync);
+int   board_rtc_init (int rtc_clock_type);
+int   board_rtc_wakeup_start (uint32_t wakeup_ms);
+int   board_rtc_wakeup_stop (void);
+
+                  //-----------------------------------------------
+                  //  Reset Cause and RTC Backup Register APIs
+                  //-----------------------------------------------
+uint32_t  board_get_reset_cause (void);
+int   board_rtc_backup_read (int reg_num, uint32_t *value);
+int   board_rtc_backup_write (int reg_num, uint32_t value);
+
 
                   //-----------------
                   //  UART  APIs
@@ -308,6 +438,7 @@ int  board_uart_init (unsigned int module_id, int tx_gpio_pin_id,
                       int rx_gpio_pin_id, long baud_rate, int flags);
 int  board_uart_ALTFUNC_lookup (unsigned int module_id, int tx_gpio_pin, uint32_t *tx_AltFuncId,
                                 int rx_gpio_pin, uint32_t *rx_AltFuncId);
+int  board_uart_check_io_completed (unsigned int mod_id, int flags);
 int  board_uart_console_read_fdx (unsigned int module_id, uint8_t *user_buf, int max_buf_len,
                                   int pause_time, int max_wait_time, int flags);
 int  board_uart_get_char (unsigned int mod_id, int flags, int max_wait_time);  // 0 = no wait
@@ -320,17 +451,48 @@ int  board_uart_set_callback (unsigned int module_id,
                               void *callback_parm);
 ////int  board_uart_set_echoplex (int module_id, int on_off_flag);
 int  board_uart_set_max_timeout (unsigned int module_id, uint32_t max_timeout);
+int  board_uart_set_rx_buffer (unsigned int module_id, uint8_t *rx_buf, int size);
+int  board_uart_get_rx_stats (unsigned int module_id, UART_RX_STATS *stats, int reset_flag);
 int  board_uart_write_char (unsigned int mod_id,  char outchar, int flags);
 int  board_uart_write_bytes (unsigned int mod_id, uint8_t *bytebuf, int buf_len, int flags);
 int  board_uart_write_string (unsigned int mod_id, char *outstr, int flags);
 
 
+                  //-------------------------
+                  //  BLDC  FOC  APIs
+                  //-------------------------
+struct foc_ctl_def;                              // see foc_engine.h
+int  board_bldc_init (unsigned int module_id, long pwm_hz, int deadtime_ns,
+                      int adc_chan_a, int adc_chan_b, struct foc_ctl_def *foc);
+int  board_bldc_set_angle_callback (BLDC_ANGLE_HANDLER callback_function,
+                                    void *callback_parm);
+int  board_bldc_set_open_loop_step (int angle_step);
+int  board_bldc_calibrate (int num_samples);
+int  board_bldc_start (void);
+int  board_bldc_stop (void);
+int  board_bldc_get_stats (uint32_t *isr_count, uint32_t *last_cycles,
+                           uint32_t *max_cycles);
+
+
+                  //-------------------------
+                  //  BDC  motor  APIs
+                  //-------------------------
+struct bdc_motor_def;                            // see bdc_motor.h
+int  board_bdc_attach (struct bdc_motor_def *motor, unsigned int pwm_module,
+                       int chan_fwd, int chan_rev, unsigned int enc_module);
+int  board_bdc_start (unsigned int pwm_module, int loop_div);
+int  board_bdc_stop (unsigned int pwm_module);
+int  board_bdc_get_stats (unsigned int pwm_module, BDC_STATS *stats);
+
+
                   //-------------------------
                   //  UNIQUE-ID / CRC  APIs
                   //-------------------------
 void  board_unique_crcid_init (unsigned long seed, int flags);
 unsigned long  board_unique_crcid_compute (void *in_buf, int in_buf_length,
                                            int flags_32_8);
+int   board_crc_hw_update (int algo, uint32_t *crc, const uint8_t *buf,
+                           int length);          // USES_CRC_HW: # bytes done
 
                   //-------------------------------
                   //  VTIMER (Virtual Timer)  APIs
@@ -340,6 +502,7 @@ int  board_vtimer_start (unsigned int vtimer_id, uint32_t timer_duration_millis,
 int  board_vtimer_completed (unsigned int vtimer_id);
 int  board_vtimer_reset (unsigned int vtimer_id);
 void board_vtimer_check_expiration (uint32_t gsystick_millisecs);
+uint32_t board_vtimer_next_expiration (uint32_t gsystick_millisecs);
 
 
 
@@ -77,8 +77,63 @@ typedef  void (*ADC_CB_EVENT_HANDLER)(void *pCbParm, uint16_t *channel_results,
 typedef  void (*I2C_CB_EVENT_HANDLER)(void *pCbParm, int rupt_id, int status);
 typedef  void (*SPI_CB_EVENT_HANDLER)(void *pCbParm, int rupt_id, int status);
 typedef  void (*TMR_CB_EVENT_HANDLER)(void *pCbParm, int rupt_id);
+typedef  uint16_t (*BLDC_ANGLE_HANDLER)(void *pCbParm);  // rotor electrical angle, 65536 = 360 deg
 typedef  void (*UART_CB_EVENT_HANDLER)(void *pCbParm, int rupt_id, int status);
 typedef  void (*IO_CB_EVENT_HANDLER)(void *pCbParm, int rupt_id, int status);
+typedef  void (*LPM_ENTRY_HANDLER)(void);
+typedef  void (*BH_EVENT_HANDLER)(void *pCbParm, uint32_t events);  // bottom half
+
+typedef struct lowpower_stats_def       /* Tickless idle instrumentation */
+   {
+       uint32_t   total_ms;             // time covered by these stats
+       uint32_t   run_ms;               // time running
+       uint32_t   sleep_ms;             // time in SLEEP (WFI, SysTick running)
+       uint32_t   stop_ms;              // time in tickless STOP
+       uint32_t   wakeups;              // # wakeups from SLEEP or STOP
+       uint32_t   timer_wakeups;        // # of those that were RTC wakeup timer
+       uint32_t   wakeups_per_hour;     // wakeups averaged over total_ms
+   } LOWPOWER_STATS;
+
+typedef struct bdc_stats_def            /* BDC motor control tick instrumentation */
+   {
+       uint32_t   ticks;                // # control ticks run
+       uint32_t   last_cycles;          // CPU cycles used by the last tick
+       uint32_t   max_cycles;           //   "   worst case
+       uint32_t   min_period_cycles;    // shortest time between ticks (jitter)
+       uint32_t   max_period_cycles;    // longest  time between ticks
+   } BDC_STATS;
+
+typedef struct irq_class_stats_def      /* per interrupt priority class (IRQ_CLASS_xxx) */
+   {
+       uint32_t   count;                // # ISR runs recorded
+       uint32_t   latency_samples;      // # of those that knew their entry latency
+       uint32_t   min_latency_cycles;   // event to ISR entry, CPU cycles
+       uint32_t   max_latency_cycles;   //   "   worst case
+       uint32_t   last_run_cycles;      // CPU cycles used by the last ISR run
+       uint32_t   max_run_cycles;       //   "   worst case = blocking time it
+   } IRQ_CLASS_STATS;                   //   imposes on the rest of its class
+
+typedef struct bh_stats_def             /* per bottom half (board_bh_register) */
+   {
+       uint32_t   runs;                 // # times the handler was run
+       uint32_t   coalesced;            // # schedules merged into a pending run
+       uint32_t   last_latency_cycles;  // schedule (in the ISR) to handler start
+       uint32_t   max_latency_cycles;   //   "   worst case
+       uint32_t   max_run_cycles;       // CPU cycles used by the handler, worst
+   } BH_STATS;
+
+typedef struct uart_rx_stats_def        /* per UART port receive side */
+   {
+       uint32_t   rcvd;                 // # chars queued by the RX ISR
+       uint32_t   drops;                // # chars dropped: RX buffer was full
+       uint32_t   overruns;             // # USART overruns: char(s) lost in HW
+       uint32_t   errors;               // # framing / noise / parity errors
+       uint32_t   truncated;            // # text lines cut short to fit the buf
+       uint16_t   queued;               // # chars waiting now
+       uint16_t   max_queued;           // high water mark: size the buf from it
+       uint16_t   buf_size;             // RX buffer size
+       uint16_t   flags;                // UART_RX_xxx flags seen since last reset
+   } UART_RX_STATS;
 
 
 #include "boarddef.h"     // pull in defs for the MCU board being used
@@ -127,6 +182,50 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  sys_Enable_Interrupts()         board_enable_global_interrupts()
 #define  frequency_to_period_ticks(freq) board_frequency_to_period_ticks (freq)
 
+                         // 64-bit monotonic timestamps (USES_TIMESTAMP)
+#define  sys_Timestamp_Init()            board_timestamp_init()
+#define  sys_Get_Timestamp_Ticks()       board_timestamp_get_ticks()
+#define  sys_Get_Timestamp_Usec()        board_timestamp_get_usec()
+#define  sys_Get_Wall_Clock_Usec()       board_timestamp_get_wall_usec()
+#define  sys_Timestamp_To_Usec(ticks)    board_timestamp_ticks_to_usec(ticks)
+#define  sys_Timestamp_Discipline(ref_usec) board_timestamp_discipline(ref_usec)
+#define  sys_Timestamp_Discipline_RTC()  board_timestamp_discipline_rtc()
+
+                         // Tickless low power idle (USES_TICKLESS_IDLE)
+#define  sys_Idle(max_idle_ms,flags)     board_lowpower_idle(max_idle_ms,flags)
+#define  sys_Set_Stop_Handler(stop_func) board_lowpower_set_stop_handler(stop_func)
+#define  sys_Get_Power_Stats(stats,reset_flag) board_lowpower_get_stats(stats,reset_flag)
+
+            // Valid values for max_idle_ms and flags on sys_Idle()
+#define  LPM_IDLE_FOREVER       0xFFFFFFFF  /* no App deadline: VTIMERs/rupts only */
+#define  LPM_SLEEP_ONLY         0x0001   /* no STOP: DMA/UART/SPI I/O is active */
+            // Return values from sys_Idle()
+#define  LPM_MODE_RUN           0        /* a VTIMER was already due           */
+#define  LPM_MODE_SLEEP         1        /* WFI sleep, SysTick kept running    */
+#define  LPM_MODE_STOP          2        /* tickless STOP, RTC wakeup          */
+
+                         // Interrupt plan: deferred bottom halves (USES_IRQ_BOTTOM_HALF)
+                         // and per priority class ISR timing (USES_IRQ_STATS)
+#define  sys_BH_Register(handler,parm)   board_bh_register(handler,parm)
+#define  sys_BH_Schedule(bh_id,events)   board_bh_schedule(bh_id,events)
+#define  sys_Get_BH_Stats(bh_id,stats,reset_flag) board_bh_get_stats(bh_id,stats,reset_flag)
+#define  sys_Get_IRQ_Stats(irq_class,stats,reset_flag) board_irq_get_stats(irq_class,stats,reset_flag)
+
+                         // Reset cause, and RTC backup registers that survive
+                         // standby (warm boot state, see boot_seq.h)
+#define  sys_Get_Reset_Cause()           board_get_reset_cause()
+#define  sys_Backup_Read(reg_num,pvalue) board_rtc_backup_read(reg_num,pvalue)
+#define  sys_Backup_Write(reg_num,value) board_rtc_backup_write(reg_num,value)
+
+            // sys_Get_Reset_Cause() flags. Read (and cleared in the RCC/PWR)
+            // on the first call, so every later call sees the same value.
+#define  RESET_CAUSE_POWER_ON   0x0001   /* power on / brown out reset         */
+#define  RESET_CAUSE_PIN        0x0002   /* NRST pin                           */
+#define  RESET_CAUSE_SOFTWARE   0x0004   /* NVIC_SystemReset()                 */
+#define  RESET_CAUSE_WATCHDOG   0x0008   /* IWDG or WWDG                       */
+#define  RESET_CAUSE_LOW_POWER  0x0010   /* illegal low power mode entry       */
+#define  RESET_CAUSE_STANDBY    0x0020   /* woke up from standby               */
+
 
 
  //*****************************************************************************
@@ -229,7 +328,12 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  CONSOLE_CHECK_FOR_INPUT()              board_uart_rx_data_check(UART_MD)
 #endif
 
-#if ! defined(USES_DEBUG_LOG) && ! defined(USES_CONSOLE)
+#if defined(USES_BINLOG)
+             // route DEBUG_LOG to the Binary Log (common/binlog.h): only the
+             // string's address is logged, so it must be a string literal.
+int  binlog_write (const char *fmt, int nargs, const uint32_t *args);
+#define  DEBUG_LOG(output_string)          binlog_write(output_string,0,0L)
+#elif ! defined(USES_DEBUG_LOG) && ! defined(USES_CONSOLE)
              // discard all calls to DEBUG_LOG if it is not enabled
 #define  DEBUG_LOG(output_string)
 #else
@@ -283,6 +387,11 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
                                                board_adc_get_results(module_id,ADC_AUTO_SEQUENCE,channel_results)
 #define  adc_Set_Callback(module_id,callback_rtn,callback_parm) \
                                               board_adc_set_callback(module_id,callback_rtn,callback_parm)
+#define  adc_Set_Callback_Deferred(module_id,callback_rtn,callback_parm) \
+                                              board_adc_set_callback_deferred(module_id,callback_rtn,callback_parm)
+#define  adc_Set_DSP_Stage(module_id,dsp_stage) board_adc_set_dsp_stage(module_id,dsp_stage)
+#define  adc_Get_Frame_Timestamp(module_id,frame_usec) board_adc_get_frame_timestamp(module_id,frame_usec)
+#define  adc_Get_Frame_Ticks(module_id,frame_ticks) board_adc_get_frame_ticks(module_id,frame_ticks)
 #define  adc_SetResolution(module_id,bit_resolution)  board_adc_set_resolutionn(module_id,bit_resolution)
 #define  adc_User_Trigger_Start(module_id)    board_adc_user_trigger_start(module_id,ADC_AUTO_SEQUENCE)
 
@@ -818,6 +927,10 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
              board_spi_write(spi_mod_id,transmit_buffer,buf_length,flags)
 #define  spi_Write_Read(spi_mod_id,transmit_buffer,receive_buffer,buf_length,flags) \
              board_spi_write_read(spi_mod_id,transmit_buffer,receive_buffer,buf_length,flags)
+                         // Shared SPI bus manager (USES_SPI_BUS).  See spi_bus.h
+#define  spi_Bus_Init(bus,spi_mod_id,flags)   board_spibus_init(bus,spi_mod_id,flags,0L)
+#define  spi_Bus_Init_Extended(bus,spi_mod_id,flags,ptr_SpiHdl) \
+             board_spibus_init(bus,spi_mod_id,flags,ptr_SpiHdl)
 
                          //------------------------------------------------------------------
                          //           SPI Module Id and associated Pin Configurations
@@ -970,6 +1083,9 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
                // valid flag values for spi_Check_All_Completed
 #define  SPI_WAIT_FOR_COMPLETE  0x8000   // Do not return until I/O is complete
 
+                         // valid  values for flags on spi_Bus_Init()
+#define  SPIBUS_USE_INTERRUPTS  0x0001   // do not use the default DMA streams
+
 
 
 
@@ -995,6 +1111,14 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  pwm_Get_Period(module_id)          board_timerpwm_get_period(module_id)
 #define  pwm_Set_Period(module_id,period,flags)  board_timerpwm_set_period(module_id,period,flags)
 #define  pwm_Set_Duty_Cycle(module_id,chan,duty,flags) board_timerpwm_set_duty_cycle(module_id,chan,duty,flags)
+                  // set CCR1..CCRn together, at the same PWM period boundary
+#define  pwm_Set_Duty_Cycles(module_id,ccr_values,num_chans,flags) \
+             board_timerpwm_set_duty_cycles(module_id,ccr_values,num_chans,flags)
+                  // DMA burst streaming of a duty cycle sequence (USES_PWM_STREAM)
+#define  pwm_Stream_Start(module_id,duty_seq,num_chans,num_steps,flags) \
+             board_timerpwm_stream_start(module_id,duty_seq,num_chans,num_steps,flags,0L)
+#define  pwm_Stream_Status(module_id)       board_timerpwm_stream_status(module_id)
+#define  pwm_Stream_Stop(module_id)         board_timerpwm_stream_stop(module_id)
 #define  pwm_Set_Dead_Time(module_id,deadtime)   board_timerpwm_set_dead_time(module_id,deadtime,deadtime)
 #define  pwm_Set_Phase(chanX,phase_offset)       board_timerpwm_set_phase(chanX, phase_offset)
 #define  pwm_Set_Channel_Output(module_id,chan,duty)  board_timerpwm_set_channel_output(module_id,chan,output_mode,0)
@@ -1008,6 +1132,9 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  PWM_CHANNEL_3   3
 #define  PWM_CHANNEL_4   4
 
+               // valid  values for flags on pwm_Stream_Start()
+#define  PWM_STREAM_CIRCULAR   0x0001   /* replay the sequence until pwm_Stream_Stop() */
+
                // allowed values for flags in pwm_Config_Channel() calls
 #define  PWM_NO_FLAGS               0
 #define  PWM_COMPLEMENTARY_OUTPUTS  1
@@ -1018,6 +1145,48 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 
 
 
+ //*****************************************************************************
+ //*****************************************************************************
+ //
+ //                       BLDC  Field Oriented Control   APIs
+ //
+ //   Center-aligned TIM1/TIM8 PWM + ADC1 injected current sampling, running
+ //   the FOC engine (common/foc_engine.h) in the ADC ISR.  USES_BLDC_FOC
+ //*****************************************************************************
+ //*****************************************************************************
+#define  bldc_Init(module_id,pwm_hz,deadtime_ns,adc_chan_a,adc_chan_b,foc) \
+             board_bldc_init(module_id,pwm_hz,deadtime_ns,adc_chan_a,adc_chan_b,foc)
+#define  bldc_Set_Angle_Callback(callback_function,callback_parm) \
+             board_bldc_set_angle_callback(callback_function,callback_parm)
+#define  bldc_Set_Open_Loop_Step(angle_step)  board_bldc_set_open_loop_step(angle_step)
+#define  bldc_Calibrate(num_samples)          board_bldc_calibrate(num_samples)
+#define  bldc_Start()                         board_bldc_start()
+#define  bldc_Stop()                          board_bldc_stop()
+#define  bldc_Set_Current_Ref(foc,id_ref,iq_ref)  foc_set_current_ref(foc,id_ref,iq_ref)
+#define  bldc_Get_Stats(isr_count,last_cycles,max_cycles) \
+             board_bldc_get_stats(isr_count,last_cycles,max_cycles)
+
+
+
+
+ //*****************************************************************************
+ //*****************************************************************************
+ //
+ //                    Brushed DC motor (closed loop)   APIs
+ //
+ //   Encoder timer + IN1/IN2 PWM channel pair per motor, cascaded loops
+ //   (common/bdc_motor.h) run from the PWM timer's update rupt.  USES_BDC_MOTOR
+ //*****************************************************************************
+ //*****************************************************************************
+#define  bdc_Attach(motor,pwm_module,chan_fwd,chan_rev,enc_module) \
+             board_bdc_attach(motor,pwm_module,chan_fwd,chan_rev,enc_module)
+#define  bdc_Start(pwm_module,loop_div)       board_bdc_start(pwm_module,loop_div)
+#define  bdc_Stop(pwm_module)                 board_bdc_stop(pwm_module)
+#define  bdc_Get_Stats(pwm_module,stats)      board_bdc_get_stats(pwm_module,stats)
+
+
+
+
  //*****************************************************************************
  //*****************************************************************************
  //
@@ -1061,6 +1230,15 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  timer_DAC_Trigger_Config(tmrmod_id,dac_chan_id,trig_type,dac_frequency,num_steps,flags) \
                               board_timerpwm_config_trigger_mode(tmrmod_id,dac_chan_id,trig_type,(flags|TIMER_DAC_TRIGGER_MODE));
 
+                         // DMA Input Capture (USES_INPUT_CAPTURE).  See input_capture.h
+#define  timer_Capture_Start(module_id,channel_id,icap,ring,ring_size,flags) \
+                              board_timerpwm_capture_start(module_id,channel_id,icap,ring,ring_size,flags,0L)
+#define  timer_Capture_Update(module_id)                 board_timerpwm_capture_update(module_id)
+#define  timer_Capture_Get_Stats(icap,stats)             icap_get_stats(icap,stats)
+#define  timer_Capture_Stop(module_id)                   board_timerpwm_capture_stop(module_id)
+                         // Quadrature encoder mode (CH1/CH2 = encoder A/B)
+#define  timer_Encoder_Init(module_id,filter,flags)      board_timerpwm_encoder_init(module_id,filter,flags)
+#define  timer_Encoder_Get_Count(module_id)              board_timerpwm_encoder_get_count(module_id)
 #define  timer_Check_Completed(module_id,check_mask,reset_flags) \
                               board_timerpwm_check_completed(module_id,check_mask,reset_flags)
 #define  timer_Disable(module_id) \
@@ -1077,6 +1255,8 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  timer_Set_CCR_Duty(module_id,CCR_Num,CCR_duty_compare_value,flags) \
                               board_timerpwm_set_duty_cycle(module_id,CCR_Num,CCR_duty_compare_value,flags)
 #define  timer_Set_Callback(mod_id,callback_rtn,callback_parm)  board_timerpwm_set_callback(mod_id,callback_rtn,callback_parm);
+#define  timer_Set_Callback_Deferred(mod_id,callback_rtn,callback_parm) \
+                              board_timerpwm_set_callback_deferred(mod_id,callback_rtn,callback_parm)
 #define  timer_Set_Period(module_id,new_period_value,flags) board_timerpwm_set_period(module_id,new_period_value,flags)
 #define  timer_Set_Prescalar(module_id,prescalar_val,flags)  board_timerpwm_set_prescalar (module_id,prescalar_val,flags)
 
@@ -1156,6 +1336,9 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 //#define  TIMER_ENABLE_CCR_INTERRUPTS   0x0800   /* raise an interrupt when CCR value is reached  */
 #define  TIMER_CCR_INTERRUPT_ENABLED   0x0800   /* raise an interrupt when CCR value is reached  */
 
+               // valid  values for flags on timer_Encoder_Init()
+#define  TIMER_ENCODER_INVERT          0x0001   /* count down when A leads B */
+
 
                // valid  values for rupt_flags on timer_Enable()
 //#define  TIMER_ENABLE_ROLLOVER_INTERRUPTS  0x0001
@@ -1252,9 +1435,12 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  uart_Get_Char(mod_id,flags,max_wait)        board_uart_get_char(mod_id,flags,max_wait)
 #define  uart_Read_Line(mod_id,string,maxlen,flags)  board_uart_read_text_line(mod_id,string,maxlen,flags)
 #define  uart_Read_Binary(mod_id,bytebuf,len,flags)  board_uart_read_bytes(mod_id,bytebuf,len,flags)
+#define  uart_Get_RX_Timestamp(mod_id,first_usec,last_usec) board_uart_get_rx_timestamp(mod_id,first_usec,last_usec)
 #define  uart_Set_Callback(mod_id,callback_func,callback_parm) board_uart_set_callback(mod_id,callback_func,callback_parm)
 ////#define  uart_Set_Echoplex(module_id,on_off_flag)    board_uart_set_echoplex(module_id,on_off_flag)
 #define  uart_Set_Max_Timeout(mod_id,max_timeout)    board_uart_set_max_timeout(mod_id,max_timeout)
+#define  uart_Set_RX_Buffer(mod_id,rx_buf,size)      board_uart_set_rx_buffer(mod_id,rx_buf,size)
+#define  uart_Get_RX_Stats(mod_id,stats,reset_flag)  board_uart_get_rx_stats(mod_id,stats,reset_flag)
 #define  uart_Write_String(mod_id,string,flags)      board_uart_write_string(mod_id,string,flags)
 #define  uart_Write_Binary(mod_id,bytebuf,len,flags) board_uart_write_bytes(mod_id,bytebuf,len,flags)
 #define  uart_Write_Char(mod_id,outchar,flags)       board_uart_write_char(mod_id,outchar,flags)
@@ -1283,7 +1469,16 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 
             // status flags passed back on UART callback
 #define  UART_TX_COMPLETE           1
-#define  UART_RX_COMPLETE           2
+#define  UART_RX_COMPLETE           2     /* text line assembled. From the
+                                             read call, at thread level    */
+#define  UART_RX_DATA_READY         3     /* rcvd a \r or \n, or end of a burst
+                                             (receiver timeout). From the ISR */
+
+            // flags in UART_RX_STATS: set when data is lost or cut short
+#define  UART_RX_BUF_FULL        0x01     /* char(s) dropped: RX buffer full */
+#define  UART_RX_OVERRUN         0x02     /* USART overrun (ORE)             */
+#define  UART_RX_LINE_ERROR      0x04     /* framing / noise / parity error  */
+#define  UART_RX_LINE_TRUNCATED  0x08     /* text line longer than the buf   */
 
 
 
@@ -1359,6 +1554,9 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  ERR_ADC_CHANNEL_INITIALIZATION_ERROR -229 /* Call to initialze ADC channel failed. */
 #define  ERR_ADC_ENABLE_ERROR               -230   /* Call to enable the ADC module failed. */
 #define  ERR_ADC_START_CONVERSION_ERROR     -231   /* Call to adc_user_trigger_start()_failed. */
+#define  ERR_ADC_DSP_CHANNEL_OUT_OF_RANGE   -232   /* DSP stage chan_index/num_channels not valid */
+#define  ERR_ADC_DSP_INVALID_MODE           -233   /* dsp_mode not valid for this call */
+#define  ERR_ADC_DSP_INVALID_PARM           -234   /* DSP mode_parm or scaling out of range */
 
 #define  ERR_DAC_INITIALIZIATION_ERROR      -240   /* HAL_DAC_Init() failed to initialize the hardware   */
 #define  ERR_DAC_NOT_SUPPORTED_ON_THIS_MCU  -241   /* No native DAC is supported on this  STM32 MCU */
@@ -1395,6 +1593,8 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
                                                    ** from the "primary channel" (1-4) instead.   */
 #define  ERR_PWM_CHANNEL_START_FAILED       -281
 #define  ERR_PWM_INVALID_TIMER_MODE         -282   /* bad mode parameter value on board_timerrpwm_config_channel() */
+#define  ERR_PWM_INVALID_DEADTIME           -283   /* dead time ticks must be >= 0 */
+#define  ERR_PWM_STREAM_NO_DMA              -284   /* no DMA mapping for that timer's Update request, pass a DMA handle */
 
 #define  ERR_TIMER_NUM_OUT_OF_RANGE         -285   /* Timer Module Number is ouside the valid range of 0 to 22   */
 #define  ERR_TIMER_NUM_NOT_SUPPORTED        -286   /* That Timer Module Number is not supported on this platform */
@@ -1409,6 +1609,10 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  ERR_TIMER_TRIGGER_MISMATCH         -293   // The trigger type specified on the trigger_ADC/DAC_Start() call
                                                    // does not match what was issued on the init_ADC() or init_DAC()
 #define  ERR_TIMER_INVALID_TRIGGER_TYPE     -294   // The trigger type specified on trigger_ADC/DAC_Start() call was invalid
+#define  ERR_TIMER_CAPTURE_INVALID_PARM     -295   /* bad ring/window/flags on timer_Capture_Start() */
+#define  ERR_TIMER_CAPTURE_NO_DMA           -296   /* no DMA mapping for that timer/channel, pass a DMA handle */
+#define  ERR_TIMER_CAPTURE_START_FAILED     -297   /* HAL failed to setup the input capture channel or DMA */
+#define  ERR_TIMER_ENCODER_INIT_FAILED      -298   /* bad filter, or HAL failed to setup encoder mode */
 
 #define  ERR_UART_MODULE_NUM_OUT_OF_RANGE   -300   /* Module Number is ouside the valid range of 0 to 6    */
 #define  ERR_UART_MODULE_NOT_SUPPORTED      -301   /* That Module Number is not supported on this platform */
@@ -1418,6 +1622,29 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  ERR_VTIMER_ID_OUT_OF_RANGE         -320   /* VTIMER id ranges is 0 to 9. Is outside that range */
 #define  ERR_VTIMER_IN_USE                  -321   /* requested VTIMER has already been started and is in use */
 #define  ERR_VTIMER_MILLISEC_EXCEED_LIMIT   -322   /* max limit for timer_duration_millis is 1000000000 */
+#define  ERR_TIMESTAMP_INVALID_PARM         -325   /* timestamp counter must run faster than 1 MHz */
+#define  ERR_TIMESTAMP_NO_REFERENCE         -326   /* RTC not initialized, or not ticking */
+#define  ERR_BINLOG_INVALID_PARM            -327   /* ring must be a power of 2 words, at least 16 */
+#define  ERR_BINLOG_RING_FULL               -328   /* BLOG record dropped: ring is full, or not initialized */
+#define  ERR_CRC_INVALID_ALGO               -329   /* algo is not one of the CRC_xxx values in crc_engine.h */
+#define  ERR_CRC_HW_UNAVAILABLE             -330   /* CRC unit can not do that algo, or is busy: use software */
+#define  ERR_CRC_SELF_TEST_FAILED           -331   /* crc_self_test() got a wrong check value */
+#define  ERR_BLDC_INVALID_PARM              -332   /* bad timer/ADC channel/PWM rate on bldc_Init() */
+#define  ERR_BLDC_NOT_SUPPORTED             -333   /* FOC engine needs an F4/F7 advanced timer + injected ADC */
+#define  ERR_BLDC_INIT_FAILED               -334   /* HAL failed to setup the PWM timer or the injected ADC */
+#define  ERR_BDC_INVALID_PARM               -335   /* bad motor/channel/loop_div, or no motors on that PWM timer */
+#define  ERR_BDC_TOO_MANY_MOTORS            -336   /* BDC_MAX_MOTORS / BDC_MAX_PWM_TIMERS exceeded */
+#define  ERR_SPIBUS_INVALID_PARM            -337   /* bad device/mode/clock/segments on a spibus_xxx() call */
+#define  ERR_SPIBUS_XFER_BUSY               -338   /* transaction is already queued, or is on the wire */
+#define  ERR_SPIBUS_XFER_FAILED             -339   /* SPI/DMA error, or the SPI could not be reconfigured */
+#define  ERR_SPIBUS_CANCELLED               -340   /* transaction was removed by spibus_cancel() */
+#define  ERR_SPIBUS_NOT_INITIALIZED         -341   /* SPI module must be spi_Init()'ed before board_spibus_init() */
+#define  ERR_TCODEC_OVERFLOW               -342   /* encode: output buffer is full (see telemetry_codec.h) */
+#define  ERR_TCODEC_SYNTAX                 -343   /* decode: malformed CBOR / JSON payload */
+#define  ERR_TCODEC_TYPE                   -344   /* decode: payload value does not match the field's type */
+#define  ERR_TCODEC_RANGE                  -345   /* decode: number does not fit in the field */
+#define  ERR_TCODEC_UNSUPPORTED            -346   /* indefinite length CBOR, float, or nesting too deep */
+#define  ERR_TCODEC_INVALID_PARM           -347   /* bad buffer/format/field table on a tcodec_xxx() call */
 
 #define  ERR_WIFI_MODULE_NUM_OUT_OF_RANGE   -350   /* Module Number is ouside the valid range of 0 to 6 */
 #define  ERR_WIFI_SPI_WRITE_FAILED          -352   /* Arduino WiFi Shield error codes. Write to Shield failed */
@@ -1427,6 +1654,32 @@ int   OS_WAIT (uint32_t timeout_value);        // is NOP unless using Interrupts
 #define  ERR_WIFI_MSG_MAX_PARMS_EXCEEDED    -356   /* Number of parms in MSG from Ardu Wifi processor > max allowed */
 #define  ERR_WIFI_MSG_HDR_INVALID_END       -357   /* Invalid MSG_HDR END_CMD   */
 
+#define  ERR_MQBROKER_INVALID_PARM          -360   /* bad ops/topic/filter/QoS on a MQTTBroker_xxx() call */
+#define  ERR_MQBROKER_TABLE_FULL            -361   /* MQBROKER_MAX_BRIDGES filters already defined */
+#define  ERR_MQBROKER_POOL_EMPTY            -362   /* no free message pool slot, or message > MQBROKER_MSG_SIZE */
+#define  ERR_MQBROKER_PROTOCOL              -363   /* malformed / unsupported packet from a client: client dropped */
+
+#define  ERR_MQSNGW_INVALID_PARM            -364   /* bad link/topic/callback on a MQTTSNGateway_xxx() call */
+#define  ERR_MQSNGW_TABLE_FULL              -365   /* MQSNGW_MAX_TOPICS/_NODES/_SUBS entries all in use */
+#define  ERR_MQSNGW_BAD_FRAME               -366   /* malformed MQTT-SN frame from a node: frame ignored */
+#define  ERR_MQSNGW_UPSTREAM                -367   /* upstream write failed: the batched publishes were lost */
+
+#define  ERR_PKTBUF_NO_BUFFERS              -368   /* packet buffer pool is empty (see pkt_buf.h) */
+#define  ERR_PKTBUF_INVALID_PARM            -369   /* bad buffer/length on a pktbuf_xxx() call */
+
+#define  ERR_LAT_TRACE_INVALID_PARM         -370   /* bad stage/histogram, or counter < 1 MHz (see lat_trace.h) */
+
+#define  ERR_IRQ_INVALID_PARM               -371   /* bad class/bottom half id/handler on a board_irq/bh_xxx() call */
+#define  ERR_IRQ_BH_TABLE_FULL              -372   /* BH_MAX_HANDLERS bottom halves already registered */
+
+#define  ERR_BOOT_INVALID_PARM              -373   /* bad task table/id/step on a boot_seq/boot_prof_xxx() call */
+#define  ERR_BOOT_TABLE_FULL                -374   /* BOOT_PROF_MAX_STEPS steps already recorded */
+#define  ERR_BOOT_TIMEOUT                   -375   /* boot_seq_run/_require: tasks still not up at the timeout */
+#define  ERR_BOOT_DEP_FAILED                -376   /* a task this one depends on failed */
+#define  ERR_BOOT_NO_STATE                  -377   /* cold boot, or no state was saved for this task */
+#define  ERR_RTC_BKP_INVALID_REG            -378   /* backup register # is past the last one on this MCU */
+#define  ERR_UART_RX_BUF_INVALID            -379   /* read buffer 0L or < 2 bytes, or uart_Set_RX_Buffer() size not a power of 2 */
+
 
 
 
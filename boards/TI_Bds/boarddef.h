@@ -133,6 +133,18 @@ int  board_adc_set_callback (int adc_module_id, ADC_CB_EVENT_HANDLER callback_fu
 int  board_adc_get_results (int adc_module_id, int sequencer,
                             uint16_t  channel_results[]);
 int  board_adc_user_trigger_start (int adc_module_id, int sequencer);
+int  board_adc_stream_start (int adc_module_id, int sequencer,
+                             uint16_t *ping_buf, uint16_t *pong_buf,
+                             int buf_samples, int flags);
+int  board_adc_stream_stop (int adc_module_id, int sequencer);
+struct ring_buf_def;                                // see common/ring_buf.h
+int  board_adc_stream_set_ring (int adc_module_id, int sequencer,
+                                struct ring_buf_def *ring);
+struct fram_ring_def;                               // see common/fram_ring.h
+int  board_adc_fram_log_start (int adc_module_id, struct fram_ring_def *ring,
+                               int flags);
+int  board_adc_fram_log_stop (int adc_module_id);
+int  board_adc_fram_log_busy (int adc_module_id);
 
                   //-----------------
                   //  DAC APIs
@@ -236,6 +248,8 @@ void  board_uart_write_string (char *outstr);
 void  board_unique_crcid_init (unsigned long seed, int flags);
 unsigned long  board_unique_crcid_compute (void *in_buf, int in_buf_length,
                                            int flags_32_8);
+int   board_crc_hw_update (int algo, uint32_t *crc, const uint8_t *buf,
+                           int length);          // USES_CRC_HW: # bytes done
 
                   //-------------------------------
                   //  VTIMER (Virtual Timer) APIs
@@ -33,6 +33,7 @@
 //   04/17/15 - Added UART support for several different MCLK frequencies. Duqu
 //   04/27/15 - Added ADC12 sequence of channels support to optimize ADC. Duqu
 //   05/02/15 - Added PWM sequencing of multiple channels support. Duqu
+//   10/19/26 - Added CRC16 unit support for the unified CRC engine.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -2177,6 +2178,77 @@ unsigned long  board_unique_crcid_compute (void *in_buf, int in_buf_length,
 #endif                         // USES_UNIQUEID  ||  USES_MQTT
 
 
+#if defined(USES_CRC_HW)
+#include "crc_engine.h"
+
+    static volatile uint8_t  _g_crc_hw_busy = 0;
+
+//******************************************************************************
+//  board_crc_hw_update
+//
+//             Run a chunk of data through the CRC16 unit for the unified CRC
+//             engine (common/crc_engine.c), starting from and updating the
+//             running CRC *crc.
+//
+//             The MSP430 CRC16 unit only does the CCITT polynomial (0x1021).
+//             Bytes written to CRCDIRB are processed MSB first, which is
+//             CRC-16/CCITT. CRCINIRES is loaded with the running CRC.
+//             CRC_USES_DMA feeds large buffers with a software triggered
+//             DMA2 block transfer (the CPU is held until it completes, but
+//             it moves a byte per 2 MCLKs, vs ~8+ for a CPU loop).
+//
+//             Returns the # bytes processed, or ERR_CRC_HW_UNAVAILABLE if
+//             not CCITT, or the unit is busy (an ISR CRC interrupted).
+//******************************************************************************
+int  board_crc_hw_update (int algo, uint32_t *crc, const uint8_t *buf,
+                          int length)
+{
+    unsigned short  int_state;
+    int             i;
+
+    if (algo != CRC_16_CCITT)
+       return (ERR_CRC_HW_UNAVAILABLE);          // poly 0x1021 only
+
+    int_state = __get_interrupt_state();
+    __disable_interrupt();                       // claim the unit
+    if (_g_crc_hw_busy)
+       { __set_interrupt_state (int_state);
+         return (ERR_CRC_HW_UNAVAILABLE);        // an interrupted CRC is using it
+       }
+    _g_crc_hw_busy = 1;
+    __set_interrupt_state (int_state);
+
+    CRCINIRES = (unsigned int) *crc;             // load the running CRC
+
+#if defined(CRC_USES_DMA)
+    if (length >= CRC_DMA_MIN_LENGTH)
+       {
+         DMA2CTL = 0;
+         DMACTL1 = (DMACTL1 & ~(DMA2TSEL_31)) | DMA2TSEL_0;   // DMAREQ (sw)
+         __data16_write_addr ((unsigned short) &DMA2SA, (unsigned long) buf);
+         __data16_write_addr ((unsigned short) &DMA2DA, (unsigned long) &CRCDIRB_L);
+         DMA2SZ  = length;
+         DMA2CTL = DMADT_1 | DMASRCINCR_3 | DMADSTINCR_0 | DMASBDB | DMAEN;
+         DMA2CTL |= DMAREQ;                      // block xfer: CPU resumes when done
+         DMA2CTL = 0;
+         i = length;
+       }
+      else
+#endif
+       {
+         for (i = 0;  i < length;  i++)
+            CRCDIRB_L = buf[i];                  // MSB first
+       }
+
+    *crc = CRCINIRES;
+
+    _g_crc_hw_busy = 0;                          // release the unit
+
+    return (i);
+}
+#endif                         // USES_CRC_HW
+
+
 
 #if defined(USES_VTIMER)
 
@@ -59,6 +59,8 @@
 //
 // History:
 //   05/26/15 - Board arrived. Created, based on its cousin FR5969.  Duqu 
+//   10/19/26 - Added DMA logging of repeat ADC12 sequences into a FRAM ring.
+//   10/19/26 - Added CRC16 unit support for the unified CRC engine.
 // -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 //
 // The MIT License (MIT)
@@ -1119,6 +1121,233 @@ void  DMA2_Stream0_IRQHandler (void)
 }
 #endif
 
+
+#if defined(USES_ADC_FRAM_LOG)
+//*****************************************************************************
+//*****************************************************************************
+//                          ADC  FRAM  Logging  Routines
+//
+// Runs the configured channels as a repeat-sequence-of-channels (CONSEQ_3),
+// and has DMA channel 0 move each completed sequence out of ADC12MEMx
+// straight into the current block of a FRAM ring (common/fram_ring.c).
+//
+// ADC12_B only raises its DMA trigger at the end of a whole sequence, so the
+// channel list is replicated across as many of the 32 ADC12MEMx registers as
+// will fit, e.g. 4 channels => 8 frames => 1 DMA trigger per 32 samples.
+// The DMA ISR just re-aims DMA0DA, and only commits a ring header once a
+// whole block is full. The ADC is already converting the next sequence while
+// the ISR runs, so the ISR has a full sequence time to re-arm the DMA.
+//
+// The CPU can sit in LPM3 between DMA interrupts: the ADC runs off MODOSC,
+// and the DMA requests MCLK on its own. On a STOP_WHEN_FULL ring, the ISR
+// wakes main() out of LPM3 once the ring fills.
+//
+// The App must place the ring region in FRAM (#pragma PERSISTENT, or the
+// .persistent section) and leave MPU write access enabled for it.
+//*****************************************************************************
+//*****************************************************************************
+
+#include "fram_ring.h"
+
+    FRAM_RING          *_g_fram_log_ring     = 0L;
+    uint16_t           *_g_fram_log_dst      = 0L; // block the DMA is filling
+    uint16_t           _g_fram_log_offset    = 0;  // # samples DMA'ed into it
+    uint16_t           _g_fram_log_seq_len   = 0;  // # ADC12MEMx per sequence
+    uint16_t           _g_fram_log_overruns  = 0;  // # ADC12MEMx overflows seen
+    char               _g_fram_log_active    = 0;
+
+    uint16_t           _g_fram_log_save_ctl0 = 0;  // normal ADC config, put
+    uint16_t           _g_fram_log_save_ctl1 = 0;  //   back by Log_Stop()
+    uint16_t           _g_fram_log_save_mctl [32];
+
+
+//*****************************************************************************
+//  board_adc_fram_log_start
+//
+//         Start logging the channels configured via adc_Config_Channel()
+//         into a FRAM ring, that was set up by fram_ring_open().
+//
+//         flags selects the sample trigger:
+//           ADC_FRAM_LOG_FREE_RUN       back to back conversions, at the
+//                                       full ADC12 rate (~166 kSPS total,
+//                                       16 cycle S&H off 5 MHz MODOSC).
+//           ADC_FRAM_LOG_TRIGGER_SHSx   one conversion per timer edge on
+//                                       ADC12SHS_x (see datasheet). Channels
+//                                       are converted round robin.
+//*****************************************************************************
+int  board_adc_fram_log_start (int adc_module_id, struct fram_ring_def *ring,
+                               int flags)
+{
+    volatile uint16_t  *mctl;
+    uint16_t           shs;
+    int                nch;
+    int                frames;
+    int                i;
+
+    nch = _g_active_channels;
+    if (_g_adc_configured == 0  ||  nch == 0)
+       return (ERR_FRAM_LOG_NOT_CONFIGURED);
+
+    if (ring == 0L || ring->blocks == 0L || ring->channels != nch
+       || ring->full || _g_fram_log_active)
+       return (ERR_FRAM_RING_INVALID_PARM);
+
+    ADC12CTL0 &= ~(ADC12ENC);           // must be off to change the config
+    DMA0CTL    = 0;
+
+          //----------------------------------------------------------------
+          // pick the most frames per sequence that fit in the 32 ADC12MEMx
+          // regs, and still divide evenly into a ring block
+          //----------------------------------------------------------------
+    frames = 32 / nch;
+    while (ring->block_samples % (frames * nch))
+       frames--;
+    _g_fram_log_seq_len = (uint16_t) (frames * nch);
+
+          //----------------------------------------------------------------
+          // save the normal sequence, then replicate its channel steps
+          // (ADC12MCTL0 -> n-1) across the whole logging sequence
+          //----------------------------------------------------------------
+    _g_fram_log_save_ctl0 = ADC12CTL0;
+    _g_fram_log_save_ctl1 = ADC12CTL1;
+    mctl = &ADC12MCTL0;
+    for (i = 0;  i < 32;  i++)
+       _g_fram_log_save_mctl[i] = mctl[i];
+    for (i = 0;  i < _g_fram_log_seq_len;  i++)
+       mctl[i] = _g_fram_log_save_mctl[i % nch] & ~(ADC12EOS);
+    mctl[_g_fram_log_seq_len - 1] |= ADC12EOS;
+
+    ADC12IER0   = 0;                    // DMA handles the results, not ADC ISR
+    ADC12IFGR2 &= ~(ADC12OVIFG);
+
+    shs = (uint16_t) ((flags & ADC_FRAM_LOG_TRIGGER_MASK) >> 4);
+    if (shs == 0)
+       ADC12CTL0 = ADC12ON + ADC12SHT0_2 + ADC12SHT1_2 + ADC12MSC;
+       else ADC12CTL0 = ADC12ON + ADC12SHT0_2 + ADC12SHT1_2;
+    ADC12CTL1 = ADC12SHP + ADC12CONSEQ_3 + (shs << 10);  // ADC12SHSx = bits 10-12
+
+          //----------------------------------------------------------------
+          // DMA 0: one block (= 1 sequence) of words per ADC12 trigger,
+          //        ADC12MEM0 -> MEMn  into  the ring block
+          //----------------------------------------------------------------
+    _g_fram_log_ring     = ring;
+    _g_fram_log_dst      = fram_ring_dma_addr (ring, 0);
+    _g_fram_log_offset   = 0;
+    _g_fram_log_overruns = 0;
+
+    DMACTL0 = (DMACTL0 & ~(DMA0TSEL_31)) | DMA0TSEL__ADC12IFG;
+    __data16_write_addr ((unsigned short) &DMA0SA, (unsigned long) &ADC12MEM0);
+    __data16_write_addr ((unsigned short) &DMA0DA, (unsigned long) _g_fram_log_dst);
+    DMA0SZ  = _g_fram_log_seq_len;
+    DMA0CTL = DMADT_1 + DMASRCINCR_3 + DMADSTINCR_3 + DMAIE + DMAEN;
+
+    _g_fram_log_active = 1;
+    ADC12CTL0 |= ADC12ENC;
+    if (shs == 0)
+       ADC12CTL0 |= ADC12SC;            // free run: kick off first sequence
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  board_adc_fram_log_stop
+//
+//         Stop logging, and put back the normal ADC sequence config.
+//         A partially filled block is discarded (it was never committed).
+//*****************************************************************************
+int  board_adc_fram_log_stop (int adc_module_id)
+{
+    volatile uint16_t  *mctl;
+    int                i;
+
+    if (_g_fram_log_ring == 0L)
+       return (0);                      // was never started
+
+    ADC12CTL0 &= ~(ADC12ENC);           // repeat seq ends after current seq
+    while (ADC12CTL1 & ADC12BUSY)
+       ;
+    DMA0CTL = 0;
+    _g_fram_log_active = 0;
+
+    mctl = &ADC12MCTL0;
+    for (i = 0;  i < 32;  i++)
+       mctl[i] = _g_fram_log_save_mctl[i];
+    ADC12CTL0 = _g_fram_log_save_ctl0 & ~(ADC12ENC);
+    ADC12CTL1 = _g_fram_log_save_ctl1;
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  board_adc_fram_log_busy
+//
+//         Returns 1 while logging, 0 once stopped (or a STOP_WHEN_FULL ring
+//         has filled up).
+//*****************************************************************************
+int  board_adc_fram_log_busy (int adc_module_id)
+{
+    return (_g_fram_log_active);
+}
+
+
+//*****************************************************************************
+//  board_adc_fram_log_dma_isr
+//
+//         A sequence was DMA'ed into the ring. Step to the next slot in the
+//         block, committing the block to the ring once it is full.
+//
+//         Returns 1 if the ring filled up and logging was stopped.
+//*****************************************************************************
+static int  board_adc_fram_log_dma_isr (void)
+{
+    uint16_t  *next;
+
+    if (ADC12IFGR2 & ADC12OVIFG)
+       { ADC12IFGR2 &= ~(ADC12OVIFG);   // DMA fell behind: samples were lost
+         _g_fram_log_overruns++;
+       }
+
+    _g_fram_log_offset += _g_fram_log_seq_len;
+    if (_g_fram_log_offset >= _g_fram_log_ring->block_samples)
+       { next = fram_ring_commit (_g_fram_log_ring,
+                                  board_systick_timer_get_value());
+         if (next == 0L)
+            {    // STOP_WHEN_FULL ring is full. App calls Log_Stop()
+                 // to restore the normal ADC config.
+              ADC12CTL0 &= ~(ADC12ENC);
+              _g_fram_log_active = 0;
+              return (1);
+            }
+         _g_fram_log_dst    = next;
+         _g_fram_log_offset = 0;
+       }
+
+    __data16_write_addr ((unsigned short) &DMA0DA,
+                         (unsigned long) (_g_fram_log_dst + _g_fram_log_offset));
+    DMA0CTL |= DMAEN;                   // re-arm for the next sequence
+
+    return (0);
+}
+
+
+// DMA interrupt service routine
+#pragma vector=DMA_VECTOR
+__interrupt void  DMA_ISR (void)
+{
+    switch (__even_in_range(DMAIV, DMAIV_DMA2IFG))
+      {
+        case DMAIV_DMA0IFG:                     // Vector 2:  DMA channel 0
+            if (board_adc_fram_log_dma_isr())
+               __bic_SR_register_on_exit (LPM3_bits);  // wake up main()
+            break;
+
+        default: break;
+      }
+}
+#endif                        // USES_ADC_FRAM_LOG
+
 #endif                        // USES_ADC
 
 
@@ -3323,6 +3552,77 @@ unsigned long  board_unique_crcid_compute (void *in_buf, int in_buf_length,
 #endif              // defined(USES_MQTT) || defined(USES_UNIQUEID)
 
 
+#if defined(USES_CRC_HW)
+#include "crc_engine.h"
+
+    static volatile uint8_t  _g_crc_hw_busy = 0;
+
+//******************************************************************************
+//  board_crc_hw_update
+//
+//             Run a chunk of data through the CRC16 unit for the unified CRC
+//             engine (common/crc_engine.c), starting from and updating the
+//             running CRC *crc.
+//
+//             The MSP430 CRC16 unit only does the CCITT polynomial (0x1021).
+//             Bytes written to CRCDIRB are processed MSB first, which is
+//             CRC-16/CCITT. CRCINIRES is loaded with the running CRC.
+//             CRC_USES_DMA feeds large buffers with a software triggered
+//             DMA2 block transfer (the CPU is held until it completes, but
+//             it moves a byte per 2 MCLKs, vs ~8+ for a CPU loop).
+//
+//             Returns the # bytes processed, or ERR_CRC_HW_UNAVAILABLE if
+//             not CCITT, or the unit is busy (an ISR CRC interrupted).
+//******************************************************************************
+int  board_crc_hw_update (int algo, uint32_t *crc, const uint8_t *buf,
+                          int length)
+{
+    unsigned short  int_state;
+    int             i;
+
+    if (algo != CRC_16_CCITT)
+       return (ERR_CRC_HW_UNAVAILABLE);          // poly 0x1021 only
+
+    int_state = __get_interrupt_state();
+    __disable_interrupt();                       // claim the unit
+    if (_g_crc_hw_busy)
+       { __set_interrupt_state (int_state);
+         return (ERR_CRC_HW_UNAVAILABLE);        // an interrupted CRC is using it
+       }
+    _g_crc_hw_busy = 1;
+    __set_interrupt_state (int_state);
+
+    CRCINIRES = (unsigned int) *crc;             // load the running CRC
+
+#if defined(CRC_USES_DMA)
+    if (length >= CRC_DMA_MIN_LENGTH)
+       {
+         DMA2CTL = 0;
+         DMACTL1 = (DMACTL1 & ~(DMA2TSEL_31)) | DMA2TSEL_0;   // DMAREQ (sw)
+         __data16_write_addr ((unsigned short) &DMA2SA, (unsigned long) buf);
+         __data16_write_addr ((unsigned short) &DMA2DA, (unsigned long) &CRCDIRB_L);
+         DMA2SZ  = length;
+         DMA2CTL = DMADT_1 | DMASRCINCR_3 | DMADSTINCR_0 | DMASBDB | DMAEN;
+         DMA2CTL |= DMAREQ;                      // block xfer: CPU resumes when done
+         DMA2CTL = 0;
+         i = length;
+       }
+      else
+#endif
+       {
+         for (i = 0;  i < length;  i++)
+            CRCDIRB_L = buf[i];                  // MSB first
+       }
+
+    *crc = CRCINIRES;
+
+    _g_crc_hw_busy = 0;                          // release the unit
+
+    return (i);
+}
+#endif                         // USES_CRC_HW
+
+
 
 #if defined(USES_VTIMER)
 
@@ -33,6 +33,7 @@
 #include "inc/hw_types.h"
 #include "inc/hw_memmap.h"
 #include "inc/hw_gpio.h"
+#include "inc/hw_adc.h"
 //#include "inc/hw_ints.h"
 #include "inc/hw_pwm.h"
 #include "inc/hw_ssi.h"
@@ -6,6 +6,9 @@
 * History:
 *   12/10/14 - Significantly revised for IoT/PLC project. Duquaine
 *   04/08/15 - Added a simple string edit for board_uart_read_string() support.
+*   10/19/26 - Add uDMA ping-pong ADC streaming (adc_Stream_Start).
+*   10/19/26 - ADC streams can also queue their samples into a RING_BUF.
+*   10/19/26 - Add board_crc_hw_update() stub: the 123G has no CRC unit.
 *
 * -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -   -
 *
@@ -34,6 +37,7 @@
 
 #include "boarddef.h"
 #include "user_api.h"
+#include "ring_buf.h"
 
 #include "tiva/DRV8711_Spin_Routines.h"   // need for BASE_PWM_FREQUENCY def
 static  void  board_vtimer_check_expiration (uint32_t curr_value);
@@ -254,6 +258,7 @@ long  board_frequency_to_period_ticks (long frequency)
     char           _g_adc_clocks_on   = 0;
     unsigned char  _g_active_channels = 0;
     unsigned char  _g_adc_sequencer_map [12] = { 0 }; // indexed by channel num
+    unsigned char  _g_adc_seq_steps [4] = { 0 };      // # steps in each sequencer
     int            _g_sequencer       = 0;
     int            _g_step_num        = 0;
 
@@ -484,6 +489,7 @@ int  board_adc_config_channel (int adc_module_id, int channel_num,
 
           // track how many channels have been configured for use
     _g_active_channels++;
+    _g_adc_seq_steps [sequencer]++;   // and how many steps per sequencer
 
     _g_step_num++;          // inc to next step slot in the sequencer
 
@@ -712,6 +718,372 @@ int  board_adc_user_trigger_start (int adc_module_id, int sequencer)
     return (0);                 // denote success
 }
 
+
+//*****************************************************************************
+//*****************************************************************************
+//                       ADC   uDMA  Ping-Pong  Streaming
+//
+//  Each sequencer's FIFO is DMA'ed by the uDMA in ping-pong mode, as packed
+//  16-bit samples, into 2 alternating user buffers. When a buffer fills, the
+//  uDMA completion interrupt re-arms that half and passes the full buffer to
+//  the adc_Set_Callback() handler, the same as the STM32 ADC DMA callback:
+//
+//      callback (parm, filled_buf, num_samples, flags)
+//
+//         num_samples = # 16-bit samples in the buffer (frames * steps)
+//         flags       = module id (low 4 bits) | sequencer << 4 |
+//                       ADC_STREAM_PING or ADC_STREAM_PONG |
+//                       ADC_STREAM_OVERRUN  (both halves filled before we
+//                                            got control: samples were lost)
+//
+//  The App has one buffer's worth of time to consume a buffer before the
+//  uDMA starts overwriting it again. There is no CPU work per sample.
+//
+//  Or, with adc_Stream_Set_Ring(), each filled buffer is also bulk copied
+//  into a ring_buf.h RING_BUF (as whole buffers of 16-bit samples), which
+//  the App reads from at its own pace, so it is not held to that deadline.
+//
+//  The uDMA ISRs are hooked via ADCIntRegister(), so the vector table is
+//  moved to SRAM on the first adc_Stream_Start() call.
+//*****************************************************************************
+//*****************************************************************************
+
+                  // On the 123G, uDMA done is reported through the sequencer's
+                  // normal interrupt. The ISR checks the uDMA channel modes, so
+                  // any sequence-complete interrupts in between just get cleared.
+#define  ADC_STREAM_INT_ENABLE(base,seq)   MAP_ADCIntEnable (base, seq)
+#define  ADC_STREAM_INT_DISABLE(base,seq)  MAP_ADCIntDisable (base, seq)
+#define  ADC_STREAM_INT_CLEAR(base,seq)    MAP_ADCIntClear (base, seq)
+
+typedef struct adc_stream_def          /* one uDMA ping-pong stream */
+    {
+        uint16_t  *stream_buf [2];     /* [0] = ping (primary), [1] = pong (alt) */
+        uint16_t  stream_samples;      /* # 16-bit samples per buffer            */
+        uint8_t   stream_active;       /* 1 = stream is running                  */
+        uint8_t   stream_next;         /* which half is expected to finish next  */
+        uint32_t  stream_dma_chan;     /* uDMA channel number for this sequencer */
+        uint32_t  stream_overruns;     /* # times both halves were full          */
+        RING_BUF  *stream_ring;        /* optional ring that buffers are queued in */
+        uint32_t  stream_ring_drops;   /* # buffers lost: ring was full          */
+    } ADC_STREAM_BLK;
+
+    ADC_STREAM_BLK        _g_adc_stream [2][4];         // [module][sequencer]
+    ADC_CB_EVENT_HANDLER  _g_adc_callback [2]      = { 0L, 0L };
+    void                  *_g_adc_callback_parm [2] = { 0L, 0L };
+    char                  _g_udma_enabled = 0;
+
+                  // uDMA channel control table must be 1024 byte aligned
+#if defined(ewarm)
+#pragma data_alignment=1024
+    uint8_t   _g_udma_control_table [1024];
+#elif defined(ccs)
+#pragma DATA_ALIGN(_g_udma_control_table, 1024)
+    uint8_t   _g_udma_control_table [1024];
+#else
+    uint8_t   _g_udma_control_table [1024] __attribute__ ((aligned(1024)));
+#endif
+
+const uint32_t  _g_adc_stream_trigger [] =
+        { ADC_TRIGGER_TIMER,         // ADC_STREAM_TRIGGER_TIMER
+          ADC_TRIGGER_PWM0,          // ADC_STREAM_TRIGGER_PWM0
+          ADC_TRIGGER_PWM1,          // ADC_STREAM_TRIGGER_PWM1
+          ADC_TRIGGER_PWM2,          // ADC_STREAM_TRIGGER_PWM2
+          ADC_TRIGGER_PWM3,          // ADC_STREAM_TRIGGER_PWM3
+          ADC_TRIGGER_ALWAYS         // ADC_STREAM_TRIGGER_ALWAYS
+        };
+
+static void  board_adc_stream_isr (int mod_idx, int sequencer);
+static void  board_adc_stream_arm (ADC_STREAM_BLK *strm, uint32_t adc_module,
+                                   int sequencer, int half);
+
+                  // one tiny ISR per module/sequencer, hooked by ADCIntRegister
+static void  adc0_ss0_stream_isr (void) { board_adc_stream_isr (0, 0); }
+static void  adc0_ss1_stream_isr (void) { board_adc_stream_isr (0, 1); }
+static void  adc0_ss2_stream_isr (void) { board_adc_stream_isr (0, 2); }
+static void  adc0_ss3_stream_isr (void) { board_adc_stream_isr (0, 3); }
+static void  adc1_ss0_stream_isr (void) { board_adc_stream_isr (1, 0); }
+static void  adc1_ss1_stream_isr (void) { board_adc_stream_isr (1, 1); }
+static void  adc1_ss2_stream_isr (void) { board_adc_stream_isr (1, 2); }
+static void  adc1_ss3_stream_isr (void) { board_adc_stream_isr (1, 3); }
+
+static void (* const _g_adc_stream_isrs [2][4]) (void) =
+        { { adc0_ss0_stream_isr, adc0_ss1_stream_isr, adc0_ss2_stream_isr, adc0_ss3_stream_isr },
+          { adc1_ss0_stream_isr, adc1_ss1_stream_isr, adc1_ss2_stream_isr, adc1_ss3_stream_isr }
+        };
+
+
+//*****************************************************************************
+//  board_adc_set_callback
+//
+//          Set the callback routine invoked when a stream buffer fills.
+//*****************************************************************************
+int  board_adc_set_callback (int adc_module_id, ADC_CB_EVENT_HANDLER callback_function,
+                             void *callback_parm)
+{
+    if (adc_module_id < 0  ||  adc_module_id > ADC_AUTO_MODULE)
+       return (ERR_ADC_MODULE_ID_OUT_OF_RANGE);
+
+    if (adc_module_id == ADC_AUTO_MODULE)
+       adc_module_id = 0;                 // ANY defaults to ADC0
+
+    _g_adc_callback_parm [adc_module_id] = callback_parm;
+    _g_adc_callback [adc_module_id]      = callback_function;
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  board_adc_stream_start
+//
+//          Start uDMA ping-pong streaming on a sequencer, using the steps
+//          (channels) already setup by adc_Config_Channel_Seq() calls.
+//
+//          ping_buf and pong_buf each hold buf_samples 16-bit samples.
+//          buf_samples must be a multiple of the # steps in the sequencer,
+//          and no more than 1024 (max uDMA transfer).
+//
+//          flags selects the trigger:  ADC_STREAM_TRIGGER_TIMER  (the App
+//          must also enable the timer's ADC trigger output),
+//          ADC_STREAM_TRIGGER_PWM0-3  (the App must enable the generator's
+//          ADC trigger), or ADC_STREAM_TRIGGER_ALWAYS  (free run at the full
+//          ADC rate).
+//
+//          ADC_AUTO_SEQUENCE uses the current auto-managed sequencer. It is
+//          not supported when > 8 channels were auto-spliced across 2
+//          sequencers - use 2 explicit streams instead.
+//*****************************************************************************
+int  board_adc_stream_start (int adc_module_id, int sequencer,
+                             uint16_t *ping_buf, uint16_t *pong_buf,
+                             int buf_samples, int flags)
+{
+    ADC_STREAM_BLK  *strm;
+    uint32_t        adc_module;
+    int             mod_idx;
+    int             trig_idx;
+
+    if (adc_module_id < 0  ||  adc_module_id > ADC_AUTO_MODULE)
+       return (ERR_ADC_MODULE_ID_OUT_OF_RANGE);
+
+    if (sequencer < 0 || sequencer > ADC_AUTO_SEQUENCE)
+       return (ERR_ADC_SEQUENCER_ID_OUT_OF_RANGE);
+
+    if ( ! _g_adc_clocks_on)
+       return (ERR_ADC_MODULE_NOT_INITIALIZED);
+
+    if (sequencer == ADC_AUTO_SEQUENCE)
+       { if (_g_active_channels > 8)
+            return (ERR_ADC_STREAM_INVALID_PARM);  // spliced: needs 2 streams
+         sequencer = _g_sequencer;     // use current auto-managed sequencer
+       }
+
+    trig_idx = (flags & ADC_STREAM_TRIGGER_MASK) >> 4;
+    if (ping_buf == 0L || pong_buf == 0L || buf_samples < 1 || buf_samples > 1024
+       || _g_adc_seq_steps [sequencer] == 0
+       || (buf_samples % _g_adc_seq_steps [sequencer]) != 0
+       || trig_idx >= (int) (sizeof(_g_adc_stream_trigger) / sizeof(uint32_t)))
+       return (ERR_ADC_STREAM_INVALID_PARM);
+
+    mod_idx    = (adc_module_id == ADC_AUTO_MODULE) ? 0 : adc_module_id;
+    adc_module = (&_g_adc_modules[adc_module_id])->adc_base; //Get ADC Module Addr
+    strm       = &_g_adc_stream [mod_idx][sequencer];
+
+    if ( ! _g_udma_enabled)
+       {    // turn on the uDMA controller and point it at its control table
+         MAP_SysCtlPeripheralEnable (SYSCTL_PERIPH_UDMA);
+         MAP_uDMAEnable();
+         MAP_uDMAControlBaseSet (_g_udma_control_table);
+         _g_udma_enabled = 1;
+       }
+
+    MAP_ADCSequenceDisable (adc_module, sequencer);  // must be off to reconfig
+
+    strm->stream_buf [0]  = ping_buf;
+    strm->stream_buf [1]  = pong_buf;
+    strm->stream_samples  = (uint16_t) buf_samples;
+    strm->stream_next     = 0;
+    strm->stream_overruns = 0;
+          // ADC0 SS0-3 = uDMA channels 14-17,  ADC1 SS0-3 = channels 24-27
+    strm->stream_dma_chan = ((mod_idx == 0) ? 14 : 24) + sequencer;
+
+          //--------------------------------------------------------------
+          // setup the uDMA channel: 16-bit FIFO reads into an
+          // incrementing 16-bit buffer, in ping-pong mode.
+          //--------------------------------------------------------------
+    MAP_uDMAChannelAssign (strm->stream_dma_chan);   // encoding 0 = ADC
+    MAP_uDMAChannelAttributeDisable (strm->stream_dma_chan,
+                                     UDMA_ATTR_ALTSELECT | UDMA_ATTR_HIGH_PRIORITY
+                                     | UDMA_ATTR_REQMASK);
+    MAP_uDMAChannelAttributeEnable (strm->stream_dma_chan, UDMA_ATTR_USEBURST);
+    MAP_uDMAChannelControlSet (strm->stream_dma_chan | UDMA_PRI_SELECT,
+                               UDMA_SIZE_16 | UDMA_SRC_INC_NONE | UDMA_DST_INC_16
+                               | UDMA_ARB_1);
+    MAP_uDMAChannelControlSet (strm->stream_dma_chan | UDMA_ALT_SELECT,
+                               UDMA_SIZE_16 | UDMA_SRC_INC_NONE | UDMA_DST_INC_16
+                               | UDMA_ARB_1);
+    board_adc_stream_arm (strm, adc_module, sequencer, 0);
+    board_adc_stream_arm (strm, adc_module, sequencer, 1);
+    MAP_uDMAChannelEnable (strm->stream_dma_chan);
+
+          //--------------------------------------------------------------
+          // re-point the sequencer at the stream trigger, hand its FIFO
+          // to the uDMA, and only take the uDMA completion interrupt.
+          //--------------------------------------------------------------
+    MAP_ADCSequenceConfigure (adc_module, sequencer,
+                              _g_adc_stream_trigger [trig_idx], sequencer);
+    ADCIntRegister (adc_module, sequencer, _g_adc_stream_isrs [mod_idx][sequencer]);
+    MAP_ADCSequenceDMAEnable (adc_module, sequencer);
+    ADC_STREAM_INT_ENABLE (adc_module, sequencer);
+    strm->stream_active = 1;
+    MAP_ADCSequenceEnable (adc_module, sequencer);
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  board_adc_stream_set_ring
+//
+//          Also queue each filled stream buffer into ring (0L = stop doing
+//          so). The ISR is the ring's producer. A buffer that does not fit
+//          is dropped whole, so the ring always holds complete frames, and
+//          the callback sees ADC_STREAM_OVERRUN for it.
+//*****************************************************************************
+int  board_adc_stream_set_ring (int adc_module_id, int sequencer, RING_BUF *ring)
+{
+    int   mod_idx;
+
+    if (adc_module_id < 0  ||  adc_module_id > ADC_AUTO_MODULE)
+       return (ERR_ADC_MODULE_ID_OUT_OF_RANGE);
+
+    if (sequencer < 0 || sequencer > ADC_AUTO_SEQUENCE)
+       return (ERR_ADC_SEQUENCER_ID_OUT_OF_RANGE);
+
+    if (sequencer == ADC_AUTO_SEQUENCE)
+       sequencer = _g_sequencer;         // use current auto-managed sequencer
+
+    mod_idx = (adc_module_id == ADC_AUTO_MODULE) ? 0 : adc_module_id;
+    _g_adc_stream [mod_idx][sequencer].stream_ring = ring;
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  board_adc_stream_stop
+//
+//          Stop uDMA streaming on a sequencer.
+//*****************************************************************************
+int  board_adc_stream_stop (int adc_module_id, int sequencer)
+{
+    ADC_STREAM_BLK  *strm;
+    uint32_t        adc_module;
+    int             mod_idx;
+
+    if (adc_module_id < 0  ||  adc_module_id > ADC_AUTO_MODULE)
+       return (ERR_ADC_MODULE_ID_OUT_OF_RANGE);
+
+    if (sequencer < 0 || sequencer > ADC_AUTO_SEQUENCE)
+       return (ERR_ADC_SEQUENCER_ID_OUT_OF_RANGE);
+
+    if (sequencer == ADC_AUTO_SEQUENCE)
+       sequencer = _g_sequencer;         // use current auto-managed sequencer
+
+    mod_idx    = (adc_module_id == ADC_AUTO_MODULE) ? 0 : adc_module_id;
+    adc_module = (&_g_adc_modules[adc_module_id])->adc_base; //Get ADC Module Addr
+    strm       = &_g_adc_stream [mod_idx][sequencer];
+
+    if ( ! strm->stream_active)
+       return (0);                       // nothing to do
+
+    MAP_ADCSequenceDisable (adc_module, sequencer);
+    ADC_STREAM_INT_DISABLE (adc_module, sequencer);
+    MAP_ADCSequenceDMADisable (adc_module, sequencer);
+    MAP_uDMAChannelDisable (strm->stream_dma_chan);
+    strm->stream_active = 0;
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  board_adc_stream_arm
+//
+//          (Re)load one half of the ping-pong pair.
+//*****************************************************************************
+static void  board_adc_stream_arm (ADC_STREAM_BLK *strm, uint32_t adc_module,
+                                   int sequencer, int half)
+{
+    MAP_uDMAChannelTransferSet (strm->stream_dma_chan
+                                   | (half ? UDMA_ALT_SELECT : UDMA_PRI_SELECT),
+                                UDMA_MODE_PINGPONG,
+                                (void*) (adc_module + ADC_O_SSFIFO0
+                                         + (sequencer * (ADC_O_SSFIFO1 - ADC_O_SSFIFO0))),
+                                strm->stream_buf [half], strm->stream_samples);
+}
+
+
+//*****************************************************************************
+//  board_adc_stream_isr
+//
+//          uDMA completion for a sequencer. Re-arm whichever half(s) the
+//          uDMA finished, then hand them to the user callback, oldest first.
+//*****************************************************************************
+static void  board_adc_stream_isr (int mod_idx, int sequencer)
+{
+    ADC_STREAM_BLK  *strm;
+    uint32_t        adc_module;
+    int             half;
+    int             pass;
+    int             cb_flags;
+    int             overrun;
+    int             lost;
+
+    strm       = &_g_adc_stream [mod_idx][sequencer];
+    adc_module = _g_adc_modules[mod_idx].adc_base;
+
+    ADC_STREAM_INT_CLEAR (adc_module, sequencer);
+
+    overrun = (MAP_uDMAChannelModeGet(strm->stream_dma_chan | UDMA_PRI_SELECT) == UDMA_MODE_STOP
+            && MAP_uDMAChannelModeGet(strm->stream_dma_chan | UDMA_ALT_SELECT) == UDMA_MODE_STOP);
+    if (overrun)
+       strm->stream_overruns++;
+
+    for (pass = 0;  pass < 2;  pass++)
+      { half = strm->stream_next;
+        if (MAP_uDMAChannelModeGet(strm->stream_dma_chan
+                                   | (half ? UDMA_ALT_SELECT : UDMA_PRI_SELECT))
+            != UDMA_MODE_STOP)
+           break;                         // this half is still filling
+
+        board_adc_stream_arm (strm, adc_module, sequencer, half);
+        strm->stream_next = half ^ 1;
+
+        if (overrun)                      // both halves stopped the uDMA
+           MAP_uDMAChannelEnable (strm->stream_dma_chan);
+
+        lost = 0;
+        if (strm->stream_ring != 0L)
+           {     // queue the whole buffer, or none of it
+             if (ring_buf_space (strm->stream_ring) >= strm->stream_samples * 2)
+                ring_buf_write (strm->stream_ring, strm->stream_buf [half],
+                                strm->stream_samples * 2);
+                else { strm->stream_ring_drops++;
+                       lost = 1;
+                     }
+           }
+
+        if (_g_adc_callback [mod_idx] != 0L)
+           { cb_flags = mod_idx | (sequencer << 4)
+                      | (half ? ADC_STREAM_PONG : ADC_STREAM_PING)
+                      | ((overrun || lost) ? ADC_STREAM_OVERRUN : 0);
+             (_g_adc_callback [mod_idx]) (_g_adc_callback_parm [mod_idx],
+                                          strm->stream_buf [half],
+                                          strm->stream_samples, cb_flags);
+           }
+      }
+}
+
 #endif                          // defined(USES_ADC)
 
 
@@ -2174,6 +2546,21 @@ unsigned long  board_unique_crcid_compute (void *in_buf, int in_buf_length,
 #endif                        // USES_UNIQUEID  ||  USES_MQTT
 
 
+#if defined(USES_CRC_HW)
+//******************************************************************************
+//  board_crc_hw_update
+//
+//             The TM4C123G has no CRC unit (CCM0 is on the 129x only), so
+//             the unified CRC engine always does its CRCs in software.
+//******************************************************************************
+int  board_crc_hw_update (int algo, uint32_t *crc, const uint8_t *buf,
+                          int length)
+{
+    return (ERR_CRC_HW_UNAVAILABLE);
+}
+#endif                        // USES_CRC_HW
+
+
 #if defined(USES_VTIMER)
 //*****************************************************************************
 //*****************************************************************************
@@ -244,6 +244,46 @@ inline void  inline_pins_Toggle (int gpio_port_num,  unsigned long pins_mask);
                                               board_adc_set_callback(module_id,callback_rtn,callback_parm)
 #define  adc_User_Trigger_Start(module_id)    board_adc_user_trigger_start(module_id,ADC_AUTO_SEQUENCE)
 
+                  // DMA ping-pong streaming: buffers of packed 16-bit samples
+                  // are passed to the adc_Set_Callback() handler as they fill
+#define  adc_Stream_Start(module_id,ping_buf,pong_buf,buf_samples,flags) \
+                          board_adc_stream_start(module_id,ADC_AUTO_SEQUENCE,ping_buf,pong_buf,buf_samples,flags)
+#define  adc_Stream_Start_Seq(module_id,seq_id,ping_buf,pong_buf,buf_samples,flags) \
+                          board_adc_stream_start(module_id,seq_id,ping_buf,pong_buf,buf_samples,flags)
+#define  adc_Stream_Stop(module_id)           board_adc_stream_stop(module_id,ADC_AUTO_SEQUENCE)
+#define  adc_Stream_Stop_Seq(module_id,seq_id) board_adc_stream_stop(module_id,seq_id)
+                  // also queue filled buffers into a ring_buf.h RING_BUF (0L = off)
+#define  adc_Stream_Set_Ring(module_id,ring)  board_adc_stream_set_ring(module_id,ADC_AUTO_SEQUENCE,ring)
+#define  adc_Stream_Set_Ring_Seq(module_id,seq_id,ring) \
+                          board_adc_stream_set_ring(module_id,seq_id,ring)
+
+            // Valid values for adc_Stream_Start() flags  (trigger source)
+#define  ADC_STREAM_TRIGGER_TIMER  0x0000 /* timer ADC trigger output (App enables it) */
+#define  ADC_STREAM_TRIGGER_PWM0   0x0010 /* PWM generator 0 ADC trigger (App enables) */
+#define  ADC_STREAM_TRIGGER_PWM1   0x0020 /* PWM generator 1 ADC trigger               */
+#define  ADC_STREAM_TRIGGER_PWM2   0x0030 /* PWM generator 2 ADC trigger               */
+#define  ADC_STREAM_TRIGGER_PWM3   0x0040 /* PWM generator 3 ADC trigger               */
+#define  ADC_STREAM_TRIGGER_ALWAYS 0x0050 /* free run at the full ADC sample rate      */
+#define  ADC_STREAM_TRIGGER_MASK   0x00F0
+            // Stream status bits passed in the callback's flags parm
+#define  ADC_STREAM_PING           0x0100 /* buffer is ping_buf                        */
+#define  ADC_STREAM_PONG           0x0200 /* buffer is pong_buf                        */
+#define  ADC_STREAM_OVERRUN        0x0400 /* DMA stalled: both buffers were full       */
+
+                  // MSP430 FRxxxx: repeat sequence-of-channels, DMA'ed straight
+                  // into a crash-safe FRAM ring  (see common/fram_ring.h)
+#define  adc_FRAM_Log_Start(module_id,fram_ring,flags) \
+                          board_adc_fram_log_start(module_id,fram_ring,flags)
+#define  adc_FRAM_Log_Stop(module_id)         board_adc_fram_log_stop(module_id)
+#define  adc_FRAM_Log_Busy(module_id)         board_adc_fram_log_busy(module_id)
+
+            // Valid values for adc_FRAM_Log_Start() flags  (sample trigger)
+#define  ADC_FRAM_LOG_FREE_RUN     0x0000 /* back to back conversions, max ADC rate    */
+#define  ADC_FRAM_LOG_TRIGGER_SHS1 0x0010 /* 1 conversion per ADC12SHS_1 timer edge    */
+#define  ADC_FRAM_LOG_TRIGGER_SHS2 0x0020 /* 1 conversion per ADC12SHS_2 timer edge    */
+#define  ADC_FRAM_LOG_TRIGGER_SHS3 0x0030 /* 1 conversion per ADC12SHS_3 timer edge    */
+#define  ADC_FRAM_LOG_TRIGGER_MASK 0x0070
+
                   // the following is to allow for platform specific ADC options
 #define  adc_Set_Option(module_id,option_type,opt_flags1,opt_flags2)  \
                                               board_adc_set_option(module_id,option_type,opt_flags1,opt_flags2)
@@ -590,6 +630,10 @@ inline void  inline_pins_Toggle (int gpio_port_num,  unsigned long pins_mask);
 #define  ERR_ADC_STEP_NUM_OUT_OF_RANGE      -113   /* Valid range is 0 to 4 (ANY)  */
 #define  ERR_ADC_MODULE_NOT_INITIALIZED     -114   /* need to call adc_init first */
 #define  ERR_ADC_UNSUPPORTED_TRIGGER_TYPE   -115   /* trigger_type not supported/valid */
+#define  ERR_ADC_DSP_CHANNEL_OUT_OF_RANGE   -116   /* DSP stage chan_index/num_channels not valid */
+#define  ERR_ADC_DSP_INVALID_MODE           -117   /* dsp_mode not valid for this call */
+#define  ERR_ADC_DSP_INVALID_PARM           -118   /* DSP mode_parm or scaling out of range */
+#define  ERR_ADC_STREAM_INVALID_PARM        -119   /* bad buffers/size/trigger on adc_Stream_Start */
 
 #define  ERR_I2C_MODULE_ID_OUT_OF_RANGE     -120   /* i2c_module is not within valid range 1..n */
 #define  ERR_I2C_INVALID_I2C_MS_MODE        -121   /* i2c_ms_mode is not I2C_MASTER/I2C_SLAVE   */
@@ -630,10 +674,27 @@ inline void  inline_pins_Toggle (int gpio_port_num,  unsigned long pins_mask);
                                                    // does not match what was issued on the init_ADC() or init_DAC()
 #define  ERR_TIMER_INVALID_TRIGGER_TYPE     -160   // The trigger type specified on trigger_ADC/DAC_Start() call was invalid
 #define  ERR_TIMER_MOD_BAD_TRIGGER_TYPE     -161   // The trigger type does not matches the Timer module used on
+#define  ERR_TIMER_CAPTURE_INVALID_PARM     -162   /* bad ring/window/flags on input capture engine call */
 
 #define  ERR_VTIMER_ID_OUT_OF_RANGE         -170   /* VTIMER id ranges is 0 to 9. Is outside that range */
 #define  ERR_VTIMER_IN_USE                  -171   /* requested VTIMER has already been started and is in use */
 #define  ERR_VTIMER_MILLISEC_EXCEED_LIMIT   -172   /* max limit for timer_duration_millis is 1000000000 */
+#define  ERR_TIMESTAMP_INVALID_PARM         -175   /* timestamp counter must run faster than 1 MHz */
+#define  ERR_FRAM_RING_INVALID_PARM         -176   /* bad region/block size/channels on fram_ring_open */
+#define  ERR_FRAM_RING_NO_DATA              -177   /* fram_ring_read index is past newest block */
+#define  ERR_FRAM_LOG_NOT_CONFIGURED        -178   /* adc_FRAM_Log_Start: no ADC channels configured */
+#define  ERR_CRC_INVALID_ALGO               -179   /* algo is not one of the CRC_xxx values in crc_engine.h */
+#define  ERR_CRC_HW_UNAVAILABLE             -180   /* CRC unit can not do that algo, or is busy: use software */
+#define  ERR_CRC_SELF_TEST_FAILED           -181   /* crc_self_test() got a wrong check value */
+#define  ERR_TCODEC_OVERFLOW               -182   /* encode: output buffer is full (see telemetry_codec.h) */
+#define  ERR_TCODEC_SYNTAX                 -183   /* decode: malformed CBOR / JSON payload */
+#define  ERR_TCODEC_TYPE                   -184   /* decode: payload value does not match the field's type */
+#define  ERR_TCODEC_RANGE                  -185   /* decode: number does not fit in the field */
+#define  ERR_TCODEC_UNSUPPORTED            -186   /* indefinite length CBOR, float, or nesting too deep */
+#define  ERR_TCODEC_INVALID_PARM           -187   /* bad buffer/format/field table on a tcodec_xxx() call */
+#define  ERR_PKTBUF_NO_BUFFERS             -188   /* packet buffer pool is empty (see pkt_buf.h) */
+#define  ERR_PKTBUF_INVALID_PARM           -189   /* bad buffer/length on a pktbuf_xxx() call */
+#define  ERR_LAT_TRACE_INVALID_PARM        -190   /* bad stage/histogram, or counter < 1 MHz (see lat_trace.h) */
 
 
 
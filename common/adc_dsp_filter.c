@@ -0,0 +1,669 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              adc_dsp_filter.c
+//
+//
+//  ADC DSP filter stage: oversample/decimate (boxcar or CIC), IIR low-pass,
+//  and min/max/RMS windows, with scaling into fixed-point engineering units.
+//
+//  On STM32 the stage is attached to an ADC module via adc_Set_DSP_Stage(),
+//  and is then run directly from the ADC's DMA completion ISR. On platforms
+//  that poll for ADC results (TI), the App calls adc_dsp_process_frame()
+//  with the results from adc_Read().
+//
+//  The code is pure integer math, and is kept free of any HAL calls, so the
+//  same module builds for ARM, MSP430, or a host PC.
+//
+//  SIMD notes (Cortex-M4/M7):
+//    - Boxcar:  two channels are summed in packed 16-bit lanes (__UADD16).
+//               12-bit samples allow 16 adds before a lane could overflow, so
+//               the packed sums are spilled to 32-bit accumulators every 16
+//               samples, and at the end of each decimation window.
+//    - IIR:     y = (x*alpha + y*beta) >> 15 is done as a single dual
+//               multiply-accumulate (__SMLAD) per channel.
+//    - Window:  min/max for both channels via __USUB16 + __SEL, and the
+//               sums of squares via __SMLABB / __SMLATT.
+//    - CIC:     integrators rely on full 32-bit modulo arithmetic, so CIC
+//               channels always use the scalar code.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "adc_dsp_filter.h"
+
+
+#define  BOXCAR_PACKED_SPILL    16    // max # 12-bit adds in a 16-bit lane
+#define  WINDOW_MAX_SAMPLES    128    // keeps 12-bit sum of squares < 2^31
+#define  CIC_MAX_BIT_GROWTH     20    // 12 bit input + 20 = 32 bit registers
+
+            // a few instruction critical section, usable from any level
+#if defined(__CORTEX_M)
+#define  ADC_DSP_LOCK()     uint32_t int_state = __get_PRIMASK();  __disable_irq()
+#define  ADC_DSP_UNLOCK()   __set_PRIMASK (int_state)
+#elif defined(__MSP430__)
+#define  ADC_DSP_LOCK()     unsigned short int_state = __get_interrupt_state(); \
+                            __disable_interrupt()
+#define  ADC_DSP_UNLOCK()   __set_interrupt_state (int_state)
+#else
+#define  ADC_DSP_LOCK()
+#define  ADC_DSP_UNLOCK()
+#endif
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static int       adc_dsp_chan_scalar (ADC_DSP_STAGE *dsp, int chan_index, uint16_t sample);
+static void      adc_dsp_chan_output (ADC_DSP_STAGE *dsp, int chan_index, uint32_t q4_value);
+static void      adc_dsp_window_finish (ADC_DSP_CHANNEL_BLK *chp);
+static int16_t   adc_dsp_scale_q4 (ADC_DSP_CHANNEL_BLK *chp, uint16_t q4_value);
+static uint16_t  adc_dsp_isqrt (uint32_t value);
+static void      adc_dsp_update_simd_pairs (ADC_DSP_STAGE *dsp);
+#if (ADC_DSP_USE_SIMD)
+static int       adc_dsp_pair_simd (ADC_DSP_STAGE *dsp, int chan_index, uint16_t *samples);
+#endif
+
+
+//*****************************************************************************
+//  adc_dsp_init
+//
+//          Initialize a DSP stage for num_channels ADC channels.
+//          All channels default to PASSTHRU, with ADC full scale reported
+//          as 32767.
+//          Use adc_dsp_config_channel() and adc_dsp_set_scaling() to set up
+//          each channel.
+//*****************************************************************************
+int  adc_dsp_init (ADC_DSP_STAGE *dsp, int num_channels,
+                   ADC_DSP_CB_EVENT_HANDLER callback_function, void *callback_parm)
+{
+    int   i;
+
+    if (num_channels < 1 || num_channels > ADC_DSP_MAX_CHANNELS)
+       return (ERR_ADC_DSP_CHANNEL_OUT_OF_RANGE);
+
+    memset (dsp, 0, sizeof(ADC_DSP_STAGE));
+
+    dsp->num_channels         = num_channels;
+    dsp->dsp_callback_handler = callback_function;
+    dsp->dsp_callback_parm    = callback_parm;
+
+    for (i = 0;  i < num_channels;  i++)
+      { dsp->chan[i].dsp_mode   = ADC_DSP_MODE_PASSTHRU;
+        dsp->chan[i].window_len = 1;
+        dsp->chan[i].out_shift  = -4;          // raw counts -> Q4
+        dsp->chan[i].eng_span   = 32767;       // full scale = 32767 units
+      }
+
+    adc_dsp_reset (dsp);
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  adc_dsp_config_channel
+//
+//          Select the filter to run on a channel. chan_index is the position
+//          of the channel in the ADC's results buffer (i.e. the order the
+//          channels were configured with adc_Config_Channel()), not the
+//          physical ADC channel number.
+//
+//          See adc_dsp_filter.h for the meaning of mode_parm for each mode.
+//*****************************************************************************
+int  adc_dsp_config_channel (ADC_DSP_STAGE *dsp, int chan_index, int dsp_mode,
+                             long mode_parm, int flags)
+{
+    ADC_DSP_CHANNEL_BLK  *chp;
+    int                  order;
+
+    if (chan_index < 0 || chan_index >= dsp->num_channels)
+       return (ERR_ADC_DSP_CHANNEL_OUT_OF_RANGE);
+
+    chp = &dsp->chan [chan_index];
+
+    switch (dsp_mode)
+      { case ADC_DSP_MODE_PASSTHRU:
+            chp->window_len  = 1;
+            chp->out_shift   = -4;
+            break;
+
+        case ADC_DSP_MODE_BOXCAR:
+            if (mode_parm < 0 || mode_parm > 8)
+               return (ERR_ADC_DSP_INVALID_PARM);
+            chp->decim_shift = (uint8_t) mode_parm;
+            chp->window_len  = (uint16_t) (1 << mode_parm);
+            chp->out_shift   = (int8_t) (mode_parm - 4);  // sum of 2^k -> Q4
+            break;
+
+        case ADC_DSP_MODE_CIC:
+            order = (flags & 0x0003);
+            if (order == 0)
+               order = 1;
+            if (mode_parm < 1 || mode_parm > 6
+               || (order * mode_parm) > CIC_MAX_BIT_GROWTH)
+               return (ERR_ADC_DSP_INVALID_PARM);
+            chp->decim_shift = (uint8_t) mode_parm;
+            chp->cic_order   = (uint8_t) order;
+            chp->window_len  = (uint16_t) (1 << mode_parm);
+                 // CIC gain is R^N, so normalize away N*k bits, less 4 for Q4
+            chp->out_shift   = (int8_t) ((order * mode_parm) - 4);
+            break;
+
+        case ADC_DSP_MODE_IIR_LOWPASS:
+            if (mode_parm < 1 || mode_parm > 32767)
+               return (ERR_ADC_DSP_INVALID_PARM);
+            chp->iir_alpha   = (int16_t) mode_parm;
+            chp->iir_beta    = (int16_t) (32768L - mode_parm);
+            chp->window_len  = 1;
+            chp->out_shift   = -1;                       // Q3 state -> Q4
+            break;
+
+        case ADC_DSP_MODE_WINDOW_STATS:
+            if (mode_parm < 2 || mode_parm > WINDOW_MAX_SAMPLES)
+               return (ERR_ADC_DSP_INVALID_PARM);
+            chp->window_len  = (uint16_t) mode_parm;
+            chp->out_shift   = -4;
+            break;
+
+        default:
+            return (ERR_ADC_DSP_INVALID_MODE);
+      }
+
+    chp->dsp_mode = (uint8_t) dsp_mode;
+
+    adc_dsp_reset (dsp);               // restart all windows with new settings
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  adc_dsp_set_scaling
+//
+//          Set the engineering unit conversion for a channel, as the value
+//          to report at 0 counts and at ADC full scale. For example, a 3.3V
+//          reference reported in millivolts would use (0, 3300).
+//
+//          Both values, and the span between them, must fit in 16 bits, so
+//          choose the units accordingly (e.g. 0.1 C rather than 0.01 C).
+//*****************************************************************************
+int  adc_dsp_set_scaling (ADC_DSP_STAGE *dsp, int chan_index,
+                          int eng_at_zero, int eng_at_full_scale)
+{
+    long   span;
+
+    if (chan_index < 0 || chan_index >= dsp->num_channels)
+       return (ERR_ADC_DSP_CHANNEL_OUT_OF_RANGE);
+
+    span = (long) eng_at_full_scale - (long) eng_at_zero;
+    if (eng_at_zero < -32768 || eng_at_zero > 32767
+       || span < -32768 || span > 32767)
+       return (ERR_ADC_DSP_INVALID_PARM);
+
+    dsp->chan[chan_index].eng_zero = (int16_t) eng_at_zero;
+    dsp->chan[chan_index].eng_span = (int16_t) span;
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  adc_dsp_reset
+//
+//          Clear all filter state and partial windows. Configuration and
+//          scaling are left alone.
+//*****************************************************************************
+void  adc_dsp_reset (ADC_DSP_STAGE *dsp)
+{
+    ADC_DSP_CHANNEL_BLK  *chp;
+    int                  i;
+
+    for (i = 0;  i < dsp->num_channels;  i++)
+      { chp = &dsp->chan [i];
+        chp->sample_count = 0;
+        chp->accum        = 0;
+        chp->iir_state    = 0;
+        chp->win_min      = 0xFFFF;
+        chp->win_max      = 0;
+        memset (chp->cic_integ, 0, sizeof(chp->cic_integ));
+        memset (chp->cic_comb,  0, sizeof(chp->cic_comb));
+      }
+
+    for (i = 0;  i < (ADC_DSP_MAX_CHANNELS/2);  i++)
+      { dsp->packed_accum[i] = 0;
+        dsp->packed_min[i]   = 0xFFFFFFFF;
+        dsp->packed_max[i]   = 0;
+      }
+
+    dsp->ready_mask = 0;
+
+    adc_dsp_update_simd_pairs (dsp);
+}
+
+
+//*****************************************************************************
+//  adc_dsp_process_frame
+//
+//          Run one frame of ADC results (one sample per channel, in the same
+//          order as the DMA results buffer) through the DSP stage.
+//
+//          If any channel produced a new output, and a DSP callback was
+//          configured, the callback is invoked with the updated values.
+//
+//          Return code:  bit mask of channels that produced a new output
+//
+//      CAUTION:  this is TIME CRITICAL CODE that is called from the ADC DMA ISR
+//*****************************************************************************
+int  adc_dsp_process_frame (ADC_DSP_STAGE *dsp, uint16_t *samples, int num_samples)
+{
+    int   i;
+    int   updated;
+
+    if (num_samples > dsp->num_channels)
+       num_samples = dsp->num_channels;   // ignore any extra channels
+
+    updated = 0;
+    i = 0;
+
+#if (ADC_DSP_USE_SIMD)
+    for ( ;  (i + 1) < num_samples;  i += 2)
+      {
+        if (dsp->simd_pair_mask & (1 << (i >> 1)))
+           updated |= adc_dsp_pair_simd (dsp, i, samples);
+           else { updated |= adc_dsp_chan_scalar (dsp, i,   samples[i]);
+                  updated |= adc_dsp_chan_scalar (dsp, i+1, samples[i+1]);
+                }
+      }
+#endif
+
+    for ( ;  i < num_samples;  i++)
+      updated |= adc_dsp_chan_scalar (dsp, i, samples[i]);
+
+    dsp->frames_processed++;
+
+    if (updated)
+       {
+         dsp->ready_mask |= updated;
+            //-------------------------------------------------------------
+            // If a DSP completion callback has been configured, invoke it
+            //-------------------------------------------------------------
+         if (dsp->dsp_callback_handler != 0L)
+            {
+              (dsp->dsp_callback_handler) (dsp->dsp_callback_parm,
+                                           dsp->eng_results,
+                                           dsp->num_channels,
+                                           updated);     // invoke user handler
+            }
+       }
+
+    return (updated);
+}
+
+
+//*****************************************************************************
+//  adc_dsp_get_results
+//
+//          Copy out the latest engineering unit value for every channel.
+//
+//          Return code:  bit mask of channels that produced a new output
+//                        since the last call (0 = nothing new)
+//
+//          The DMA ISR updates eng_results / ready_mask, so the copy and the
+//          clear are done with interrupts off: a channel that becomes ready
+//          in between is not lost, and the values match the mask.
+//*****************************************************************************
+int  adc_dsp_get_results (ADC_DSP_STAGE *dsp, int16_t *eng_results)
+{
+    int   i;
+    int   ready;
+    ADC_DSP_LOCK();
+
+    for (i = 0;  i < dsp->num_channels;  i++)
+      eng_results[i] = dsp->eng_results[i];
+
+    ready = dsp->ready_mask;
+    dsp->ready_mask = 0;
+
+    ADC_DSP_UNLOCK();
+    return (ready);
+}
+
+
+//*****************************************************************************
+//  adc_dsp_get_window_stats
+//
+//          Return the min / max / RMS of the last completed window for a
+//          WINDOW_STATS channel, in engineering units. Any of the output
+//          pointers can be 0L if that value is not wanted.
+//*****************************************************************************
+int  adc_dsp_get_window_stats (ADC_DSP_STAGE *dsp, int chan_index,
+                               int16_t *eng_min, int16_t *eng_max, int16_t *eng_rms)
+{
+    ADC_DSP_CHANNEL_BLK  *chp;
+
+    if (chan_index < 0 || chan_index >= dsp->num_channels)
+       return (ERR_ADC_DSP_CHANNEL_OUT_OF_RANGE);
+
+    chp = &dsp->chan [chan_index];
+    if (chp->dsp_mode != ADC_DSP_MODE_WINDOW_STATS)
+       return (ERR_ADC_DSP_INVALID_MODE);
+
+    if (eng_min != 0L)
+       *eng_min = adc_dsp_scale_q4 (chp, chp->out_min_q4);
+    if (eng_max != 0L)
+       *eng_max = adc_dsp_scale_q4 (chp, chp->out_max_q4);
+    if (eng_rms != 0L)
+       *eng_rms = adc_dsp_scale_q4 (chp, chp->out_q4);
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+//                         INTERNAL   Routines
+//*****************************************************************************
+//*****************************************************************************
+
+//*****************************************************************************
+//  adc_dsp_chan_scalar
+//
+//          Portable filter step for one sample on one channel.
+//          Returns the channel's bit if it produced a new output.
+//*****************************************************************************
+static int  adc_dsp_chan_scalar (ADC_DSP_STAGE *dsp, int chan_index, uint16_t sample)
+{
+    ADC_DSP_CHANNEL_BLK  *chp;
+    int32_t              acc;
+    int                  i;
+
+    chp = &dsp->chan [chan_index];
+
+    switch (chp->dsp_mode)
+      { case ADC_DSP_MODE_BOXCAR:
+            chp->accum += sample;
+            if (++chp->sample_count < chp->window_len)
+               return (0);                            // window not full yet
+            adc_dsp_chan_output (dsp, chan_index, (uint32_t) chp->accum);
+            chp->accum        = 0;
+            chp->sample_count = 0;
+            break;
+
+        case ADC_DSP_MODE_CIC:
+                 // integrators run at the input rate, wrapping mod 2^32
+            acc = sample;
+            for (i = 0;  i < chp->cic_order;  i++)
+              { chp->cic_integ[i] = (int32_t) ((uint32_t) chp->cic_integ[i] + (uint32_t) acc);
+                acc = chp->cic_integ[i];
+              }
+            if (++chp->sample_count < chp->window_len)
+               return (0);                            // not time to decimate
+            chp->sample_count = 0;
+                 // combs run at the decimated output rate
+            for (i = 0;  i < chp->cic_order;  i++)
+              { int32_t  prev = chp->cic_comb[i];
+                chp->cic_comb[i] = acc;
+                acc = (int32_t) ((uint32_t) acc - (uint32_t) prev);
+              }
+            adc_dsp_chan_output (dsp, chan_index, (uint32_t) acc);
+            break;
+
+        case ADC_DSP_MODE_IIR_LOWPASS:
+            acc = ((int32_t) (sample << 3) * chp->iir_alpha)
+                + ((int32_t) chp->iir_state * chp->iir_beta) + (1L << 14);
+            chp->iir_state = (int16_t) (acc >> 15);
+            adc_dsp_chan_output (dsp, chan_index, (uint32_t) chp->iir_state);
+            break;
+
+        case ADC_DSP_MODE_WINDOW_STATS:
+            if (sample < chp->win_min)
+               chp->win_min = sample;
+            if (sample > chp->win_max)
+               chp->win_max = sample;
+            chp->accum += (int32_t) sample * (int32_t) sample;
+            if (++chp->sample_count < chp->window_len)
+               return (0);                            // window not full yet
+            adc_dsp_window_finish (chp);
+            dsp->eng_results [chan_index] = adc_dsp_scale_q4 (chp, chp->out_q4);
+            break;
+
+        default:                                      // PASSTHRU
+            adc_dsp_chan_output (dsp, chan_index, sample);
+            break;
+      }
+
+    return (1 << chan_index);
+}
+
+
+#if (ADC_DSP_USE_SIMD)
+//*****************************************************************************
+//  adc_dsp_pair_simd
+//
+//          Cortex-M4/M7 filter step for channels chan_index and chan_index+1,
+//          which are known to have identical mode and window settings.
+//          Must produce exactly the same results as adc_dsp_chan_scalar().
+//*****************************************************************************
+static int  adc_dsp_pair_simd (ADC_DSP_STAGE *dsp, int chan_index, uint16_t *samples)
+{
+    ADC_DSP_CHANNEL_BLK  *ch0;
+    ADC_DSP_CHANNEL_BLK  *ch1;
+    uint32_t             pair;
+    uint32_t             coeffs;
+    int32_t              acc;
+    int                  pair_id;
+
+    ch0     = &dsp->chan [chan_index];
+    ch1     = &dsp->chan [chan_index + 1];
+    pair_id = chan_index >> 1;
+    pair    = __PKHBT (samples[chan_index], samples[chan_index+1], 16);
+
+    switch (ch0->dsp_mode)
+      { case ADC_DSP_MODE_BOXCAR:
+            dsp->packed_accum[pair_id] = __UADD16 (dsp->packed_accum[pair_id], pair);
+            ch0->sample_count++;
+            if ((ch0->sample_count & (BOXCAR_PACKED_SPILL - 1)) == 0
+               || ch0->sample_count >= ch0->window_len)
+               {     // spill the packed 16-bit sums into the 32-bit totals
+                 ch0->accum += (int32_t) (dsp->packed_accum[pair_id] & 0xFFFF);
+                 ch1->accum += (int32_t) (dsp->packed_accum[pair_id] >> 16);
+                 dsp->packed_accum[pair_id] = 0;
+               }
+            if (ch0->sample_count < ch0->window_len)
+               return (0);                            // window not full yet
+            adc_dsp_chan_output (dsp, chan_index,   (uint32_t) ch0->accum);
+            adc_dsp_chan_output (dsp, chan_index+1, (uint32_t) ch1->accum);
+            ch0->accum = ch1->accum = 0;
+            ch0->sample_count = 0;
+            break;
+
+        case ADC_DSP_MODE_IIR_LOWPASS:
+                 // samples are <= 12 bits, so shifting the packed pair left 3
+                 // cannot carry from the low lane into the high lane
+            pair   = pair << 3;
+            coeffs = __PKHBT ((uint16_t) ch0->iir_alpha, (uint16_t) ch0->iir_beta, 16);
+            acc = (int32_t) __SMLAD (__PKHBT (pair, (uint16_t) ch0->iir_state, 16),
+                                     coeffs, (1UL << 14));
+            ch0->iir_state = (int16_t) (acc >> 15);
+            acc = (int32_t) __SMLAD (__PKHTB ((uint32_t) ch1->iir_state << 16, pair, 16),
+                                     coeffs, (1UL << 14));
+            ch1->iir_state = (int16_t) (acc >> 15);
+            adc_dsp_chan_output (dsp, chan_index,   (uint32_t) ch0->iir_state);
+            adc_dsp_chan_output (dsp, chan_index+1, (uint32_t) ch1->iir_state);
+            break;
+
+        case ADC_DSP_MODE_WINDOW_STATS:
+            __USUB16 (pair, dsp->packed_max[pair_id]);     // GE = pair >= max
+            dsp->packed_max[pair_id] = __SEL (pair, dsp->packed_max[pair_id]);
+            __USUB16 (dsp->packed_min[pair_id], pair);     // GE = min >= pair
+            dsp->packed_min[pair_id] = __SEL (pair, dsp->packed_min[pair_id]);
+            ch0->accum = (int32_t) __SMLABB (pair, pair, ch0->accum);
+            ch1->accum = (int32_t) __SMLATT (pair, pair, ch1->accum);
+            ch0->sample_count++;
+            if (ch0->sample_count < ch0->window_len)
+               return (0);                            // window not full yet
+            ch0->win_min = (uint16_t) (dsp->packed_min[pair_id] & 0xFFFF);
+            ch1->win_min = (uint16_t) (dsp->packed_min[pair_id] >> 16);
+            ch0->win_max = (uint16_t) (dsp->packed_max[pair_id] & 0xFFFF);
+            ch1->win_max = (uint16_t) (dsp->packed_max[pair_id] >> 16);
+            ch1->sample_count = ch0->sample_count;
+            adc_dsp_window_finish (ch0);
+            adc_dsp_window_finish (ch1);
+            dsp->packed_min[pair_id] = 0xFFFFFFFF;
+            dsp->packed_max[pair_id] = 0;
+            dsp->eng_results [chan_index]   = adc_dsp_scale_q4 (ch0, ch0->out_q4);
+            dsp->eng_results [chan_index+1] = adc_dsp_scale_q4 (ch1, ch1->out_q4);
+            break;
+      }
+
+    return (3 << chan_index);
+}
+#endif                                        // (ADC_DSP_USE_SIMD)
+
+
+//*****************************************************************************
+//  adc_dsp_chan_output
+//
+//          Normalize a raw filter result to Q4 counts, and scale it to
+//          engineering units.
+//*****************************************************************************
+static void  adc_dsp_chan_output (ADC_DSP_STAGE *dsp, int chan_index, uint32_t raw_value)
+{
+    ADC_DSP_CHANNEL_BLK  *chp;
+    uint32_t             q4;
+
+    chp = &dsp->chan [chan_index];
+
+    if (chp->out_shift >= 0)
+       q4 = raw_value >> chp->out_shift;
+       else q4 = raw_value << (-chp->out_shift);
+    if (q4 > 0xFFFF)
+       q4 = 0xFFFF;                           // clip to 16 bit Q4 range
+
+    chp->out_q4 = (uint16_t) q4;
+    dsp->eng_results [chan_index] = adc_dsp_scale_q4 (chp, chp->out_q4);
+}
+
+
+//*****************************************************************************
+//  adc_dsp_window_finish
+//
+//          Close out a min/max/RMS window, and start a new one.
+//*****************************************************************************
+static void  adc_dsp_window_finish (ADC_DSP_CHANNEL_BLK *chp)
+{
+    uint32_t   mean_sq;
+
+    chp->out_min_q4 = (uint16_t) (chp->win_min << 4);
+    chp->out_max_q4 = (uint16_t) (chp->win_max << 4);
+
+         // 12-bit mean square < 2^24, so * 256 (Q4 squared) still fits 32 bits
+    mean_sq = (uint32_t) chp->accum / chp->sample_count;
+    chp->out_q4 = adc_dsp_isqrt (mean_sq << 8);
+
+    chp->accum        = 0;
+    chp->sample_count = 0;
+    chp->win_min      = 0xFFFF;
+    chp->win_max      = 0;
+}
+
+
+//*****************************************************************************
+//  adc_dsp_scale_q4
+//
+//          eng = zero + (q4 * span) / 65536,  saturated to 16 bits.
+//          q4 < 2^16 and |span| <= 2^15, so the product always fits 32 bits.
+//*****************************************************************************
+static int16_t  adc_dsp_scale_q4 (ADC_DSP_CHANNEL_BLK *chp, uint16_t q4_value)
+{
+    int32_t   eng;
+
+    eng = chp->eng_zero + (((int32_t) q4_value * chp->eng_span) >> 16);
+    if (eng > 32767)
+       eng = 32767;
+    if (eng < -32768)
+       eng = -32768;
+
+    return ((int16_t) eng);
+}
+
+
+//*****************************************************************************
+//  adc_dsp_isqrt
+//
+//          Integer square root (bit by bit, no divides), used for RMS.
+//*****************************************************************************
+static uint16_t  adc_dsp_isqrt (uint32_t value)
+{
+    uint32_t   root;
+    uint32_t   bit;
+
+    root = 0;
+    bit  = 1UL << 30;
+    while (bit > value)
+      bit >>= 2;
+
+    while (bit != 0)
+      { if (value >= root + bit)
+           { value -= root + bit;
+             root = (root >> 1) + bit;
+           }
+           else root >>= 1;
+        bit >>= 2;
+      }
+
+    return ((uint16_t) root);
+}
+
+
+//*****************************************************************************
+//  adc_dsp_update_simd_pairs
+//
+//          Flag which even/odd channel pairs can be run through the SIMD
+//          code: both channels must use the same (non-CIC) mode and window.
+//*****************************************************************************
+static void  adc_dsp_update_simd_pairs (ADC_DSP_STAGE *dsp)
+{
+    ADC_DSP_CHANNEL_BLK  *ch0;
+    ADC_DSP_CHANNEL_BLK  *ch1;
+    int                  i;
+
+    dsp->simd_pair_mask = 0;
+
+    for (i = 0;  (i + 1) < dsp->num_channels;  i += 2)
+      { ch0 = &dsp->chan [i];
+        ch1 = &dsp->chan [i + 1];
+        if (ch0->dsp_mode != ch1->dsp_mode || ch0->window_len != ch1->window_len)
+           continue;
+        if (ch0->dsp_mode == ADC_DSP_MODE_BOXCAR
+           || ch0->dsp_mode == ADC_DSP_MODE_WINDOW_STATS
+           || (ch0->dsp_mode == ADC_DSP_MODE_IIR_LOWPASS
+               && ch0->iir_alpha == ch1->iir_alpha))
+           dsp->simd_pair_mask |= (1 << (i >> 1));
+      }
+}
+
+//*****************************************************************************
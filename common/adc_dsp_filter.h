@@ -0,0 +1,167 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              adc_dsp_filter.h
+//
+//
+//  Definitions for the ADC DSP filter stage.
+//
+//  The DSP stage sits between an ADC module's DMA results buffer and the
+//  User App. Each channel can be run through one of:
+//      - oversample and decimate  (boxcar average, or a 1 to 3 stage CIC)
+//      - single pole IIR low-pass
+//      - min / max / RMS statistics over a window of samples
+//  The filtered value is then scaled into fixed-point engineering units
+//  (mV, 0.1 degree C, ...) before being handed to the App's DSP callback.
+//
+//  On Cortex-M4/M7 MCUs (F3/F4/F7/L4), adjacent channel pairs that use the
+//  same filter settings are processed two at a time, using the M4 SIMD
+//  (packed 16-bit) instructions. Cortex-M0 (F0/L0) and MSP430 use the portable
+//  scalar code. Both paths produce bit-identical results.
+//
+//  Samples are assumed to be right aligned, 12-bit or less (the default on
+//  all our platforms).
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __ADC_DSP_FILTER_H__
+#define __ADC_DSP_FILTER_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+              //--------------------------------------------------------------
+              // Use the packed 16-bit SIMD instructions when the CMSIS core
+              // header says we are on a Cortex-M4 or M7 (which always have
+              // the DSP extension). Everything else uses the scalar code.
+              // ADC_DSP_FORCE_SCALAR can be used to compare the two paths.
+              //--------------------------------------------------------------
+#if defined(__CORTEX_M) && (__CORTEX_M >= 0x04) && ! defined(ADC_DSP_FORCE_SCALAR)
+#define  ADC_DSP_USE_SIMD        1
+#else
+#define  ADC_DSP_USE_SIMD        0
+#endif
+
+#define  ADC_DSP_MAX_CHANNELS    16    /* max channels handled by a DSP stage */
+
+            // Valid values for dsp_mode on adc_dsp_config_channel()
+#define  ADC_DSP_MODE_PASSTHRU      0  /* no filtering, just scale raw sample     */
+#define  ADC_DSP_MODE_BOXCAR        1  /* oversample + decimate, boxcar average   */
+#define  ADC_DSP_MODE_CIC           2  /* oversample + decimate, CIC filter       */
+#define  ADC_DSP_MODE_IIR_LOWPASS   3  /* single pole IIR low-pass, every sample  */
+#define  ADC_DSP_MODE_WINDOW_STATS  4  /* min / max / RMS over a window           */
+
+            // mode_parm on adc_dsp_config_channel() is:
+            //   BOXCAR:  log2 of decimation ratio  0 - 8   (1 to 256 samples)
+            //   CIC:     log2 of decimation ratio  1 - 6   (2 to 64 samples)
+            //   IIR:     Q15 alpha (weight of new sample)  1 - 32767
+            //   WINDOW:  number of samples per window      2 - 128
+#define  ADC_DSP_IIR_ALPHA_SHIFT(n)   (32768 >> (n))  /* alpha = 1/2^n, n = 1-15 */
+
+            // Valid values for flags on adc_dsp_config_channel()  (CIC only)
+#define  ADC_DSP_CIC_ORDER_1     0x0001  /* 1 integrator/comb stage  */
+#define  ADC_DSP_CIC_ORDER_2     0x0002  /* 2 stages                 */
+#define  ADC_DSP_CIC_ORDER_3     0x0003  /* 3 stages                 */
+
+            // Internally, filtered values are kept as ADC counts in Q4
+            // (counts * 16), so oversampling can add up to 4 bits of
+            // resolution before scaling to engineering units.
+#define  ADC_DSP_Q4_FULL_SCALE   65536L
+
+
+                         //*****************************************************
+                         // DSP callback.
+                         //
+                         // eng_results holds the latest engineering unit value
+                         // of every channel. ready_mask has bit n set for each
+                         // channel that produced a new value on this pass.
+                         //*****************************************************
+typedef  void (*ADC_DSP_CB_EVENT_HANDLER)(void *pCbParm, int16_t *eng_results,
+                int num_channels, int ready_mask);
+
+
+typedef struct adc_dsp_chan_def         /* DSP state for one ADC channel */
+   {
+       uint8_t    dsp_mode;             // ADC_DSP_MODE_xxx
+       uint8_t    decim_shift;          // BOXCAR/CIC: log2 of decimation ratio
+       uint8_t    cic_order;            // CIC: number of integrator/comb stages
+       int8_t     out_shift;            // right shift to normalize result to Q4
+       uint16_t   window_len;           // # samples per output (1 for IIR)
+       uint16_t   sample_count;         // # samples taken in current window
+       int16_t    iir_alpha;            // IIR: Q15 weight of the new sample
+       int16_t    iir_beta;             // IIR: Q15 weight of prev output (32768 - alpha)
+       int16_t    iir_state;            // IIR: previous output, counts in Q3
+       uint16_t   win_min;              // WINDOW: smallest sample in window
+       uint16_t   win_max;              // WINDOW: largest  sample in window
+       int32_t    accum;                // BOXCAR sum  or  WINDOW sum of squares
+       int32_t    cic_integ [3];        // CIC integrator stages
+       int32_t    cic_comb  [3];        // CIC comb delay elements
+       int16_t    eng_zero;             // engineering value at 0 counts
+       int16_t    eng_span;             // engineering span across full scale
+       uint16_t   out_q4;               // latest filtered output (RMS for WINDOW)
+       uint16_t   out_min_q4;           // WINDOW: latest window minimum
+       uint16_t   out_max_q4;           // WINDOW: latest window maximum
+   } ADC_DSP_CHANNEL_BLK;
+
+
+typedef struct adc_dsp_stage_def        /* DSP stage for one ADC module */
+   {
+       ADC_DSP_CHANNEL_BLK  chan [ADC_DSP_MAX_CHANNELS];
+
+       uint8_t    num_channels;         // # channels handled by the stage
+       uint8_t    simd_pair_mask;       // bit n = chans 2n/2n+1 run as SIMD pair
+       uint16_t   ready_mask;           // chans with new output not yet read
+
+       uint32_t   packed_accum [ADC_DSP_MAX_CHANNELS/2]; // SIMD: BOXCAR pre-sums
+       uint32_t   packed_min   [ADC_DSP_MAX_CHANNELS/2]; // SIMD: WINDOW minimums
+       uint32_t   packed_max   [ADC_DSP_MAX_CHANNELS/2]; // SIMD: WINDOW maximums
+
+       int16_t    eng_results [ADC_DSP_MAX_CHANNELS];    // latest scaled values
+
+       ADC_DSP_CB_EVENT_HANDLER  dsp_callback_handler;   // optional callback
+       void       *dsp_callback_parm;                    // user callback parm
+
+       uint32_t   frames_processed;     // total # sample frames run through
+   } ADC_DSP_STAGE;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int  adc_dsp_init (ADC_DSP_STAGE *dsp, int num_channels,
+                   ADC_DSP_CB_EVENT_HANDLER callback_function, void *callback_parm);
+int  adc_dsp_config_channel (ADC_DSP_STAGE *dsp, int chan_index, int dsp_mode,
+                             long mode_parm, int flags);
+int  adc_dsp_set_scaling (ADC_DSP_STAGE *dsp, int chan_index,
+                          int eng_at_zero, int eng_at_full_scale);
+int  adc_dsp_process_frame (ADC_DSP_STAGE *dsp, uint16_t *samples, int num_samples);
+int  adc_dsp_get_results (ADC_DSP_STAGE *dsp, int16_t *eng_results);
+int  adc_dsp_get_window_stats (ADC_DSP_STAGE *dsp, int chan_index,
+                               int16_t *eng_min, int16_t *eng_max, int16_t *eng_rms);
+void adc_dsp_reset (ADC_DSP_STAGE *dsp);
+
+#endif                          //  __ADC_DSP_FILTER_H__
+
+//*****************************************************************************
@@ -0,0 +1,277 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              bdc_motor.c
+//
+//
+//  Closed loop brushed DC motor controller: cascaded position / velocity /
+//  current loops in fixed point.  See bdc_motor.h
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "bdc_motor.h"
+
+#define  BDC_NO_MODE_CHANGE      0xFF
+
+
+//*****************************************************************************
+//  bdc_motor_init
+//
+//          Setup a motor's control block. Gains are all 0 (set them with
+//          bdc_motor_set_gains()), and the mode is BDC_MODE_OFF.
+//
+//          enc_bits     encoder timer width: 16, or 32 for TIM2/TIM5
+//          vel_div      # ticks per velocity loop period (1 - 255)
+//          pos_div      # velocity periods per position loop period
+//          has_current  1 = the App writes m->current every tick
+//*****************************************************************************
+void  bdc_motor_init (BDC_MOTOR *m, int enc_bits, int vel_div, int pos_div,
+                      int has_current)
+{
+    memset (m, 0, sizeof(BDC_MOTOR));
+
+    m->enc_shift   = (uint8_t) (32 - ((enc_bits > 0 && enc_bits <= 32) ? enc_bits : 16));
+    m->vel_div     = (uint8_t) ((vel_div  > 0 && vel_div  < 256) ? vel_div : 1);
+    m->pos_div     = (uint8_t) ((pos_div  > 0 && pos_div  < 256) ? pos_div : 1);
+    m->has_current = (has_current != 0);
+    m->duty_max    = BDC_DUTY_MAX;
+    m->mode        = BDC_MODE_OFF;
+    m->new_mode    = BDC_NO_MODE_CHANGE;
+}
+
+
+//*****************************************************************************
+//  bdc_motor_set_gains
+//
+//          Set one loop's gains (Q12) and output limit.
+//*****************************************************************************
+void  bdc_motor_set_gains (BDC_PID *pid, int32_t kp, int32_t ki, int32_t kd,
+                           int32_t kff, int32_t out_max)
+{
+    pid->kp      = kp;
+    pid->ki      = ki;
+    pid->kd      = kd;
+    pid->kff     = kff;
+    pid->out_max = out_max;
+}
+
+
+//*****************************************************************************
+//  bdc_motor_set_mode
+//
+//          Request a new control mode. Applied (and the integrators reset)
+//          at the start of the next bdc_motor_step().
+//*****************************************************************************
+void  bdc_motor_set_mode (BDC_MOTOR *m, int mode)
+{
+    if (mode == BDC_MODE_CURRENT && ! m->has_current)
+       mode = BDC_MODE_DUTY;               // no current sensing: nearest thing
+    m->new_mode = (uint8_t) mode;
+}
+
+
+//*****************************************************************************
+//  bdc_motor_set_xxx
+//
+//          Set the reference for a mode. Single 32-bit stores, so they can be
+//          called at thread level while the loops are running.
+//*****************************************************************************
+void  bdc_motor_set_position (BDC_MOTOR *m, int32_t pos_ref, int32_t vel_ff)
+{
+    m->vel_ff  = vel_ff;
+    m->pos_ref = pos_ref;
+}
+
+void  bdc_motor_set_velocity (BDC_MOTOR *m, int32_t vel_ref)
+{
+    m->vel_ref = vel_ref;
+}
+
+void  bdc_motor_set_current (BDC_MOTOR *m, int32_t cur_ref)
+{
+    m->cur_ref = cur_ref;
+}
+
+void  bdc_motor_set_duty (BDC_MOTOR *m, int32_t duty_ref)
+{
+    m->duty_ref = duty_ref;
+}
+
+
+//*****************************************************************************
+//  bdc_motor_zero
+//
+//          Make the current encoder count position 0 (e.g. after homing).
+//*****************************************************************************
+void  bdc_motor_zero (BDC_MOTOR *m, uint32_t enc_count)
+{
+    m->enc_last = enc_count;
+    m->position = 0;
+    m->pos_ref  = 0;
+    m->vel_acc  = 0;
+}
+
+
+//*****************************************************************************
+//  bdc_motor_step
+//
+//          One control tick. Called from the timer ISR at a fixed rate,
+//          with the encoder timer's raw counter value.
+//          Returns the new duty: Q15, signed (negative = reverse).
+//*****************************************************************************
+int16_t  bdc_motor_step (BDC_MOTOR *m, uint32_t enc_count)
+{
+    int32_t    delta;
+    int32_t    vel_raw;
+    int32_t    duty;
+    int        mode;
+
+    m->steps++;
+
+       //------------------------------------------------------------
+       // extend the encoder count:  sign extend the n-bit difference
+       //------------------------------------------------------------
+    delta = (int32_t) ((enc_count - m->enc_last) << m->enc_shift) >> m->enc_shift;
+    m->enc_last  = enc_count;
+    m->position += delta;
+    m->vel_acc  += delta;
+
+    if (m->new_mode != BDC_NO_MODE_CHANGE)
+       { m->mode     = m->new_mode;
+         m->new_mode = BDC_NO_MODE_CHANGE;
+         bdc_pid_reset (&m->pos_pid, m->position);
+         bdc_pid_reset (&m->vel_pid, m->velocity);
+         bdc_pid_reset (&m->cur_pid, m->current);
+         m->vel_cmd  = m->velocity;        // start the outer loops where we are
+         m->cur_cmd  = 0;
+         m->vel_tick = 0;
+         m->pos_tick = 0;
+       }
+    mode = m->mode;
+
+       //------------------------------------------------------------
+       //           velocity (and position) loops
+       //------------------------------------------------------------
+    if (++m->vel_tick >= m->vel_div)
+       { m->vel_tick = 0;
+         vel_raw     = m->vel_acc * (1 << BDC_VEL_SHIFT);
+         m->vel_acc  = 0;
+         m->velocity += (vel_raw - m->velocity) >> BDC_VEL_FILTER_SHIFT;
+
+         if (mode == BDC_MODE_POSITION)
+            { if (++m->pos_tick >= m->pos_div)
+                 { m->pos_tick = 0;
+                   m->vel_cmd  = bdc_pid_run (&m->pos_pid, m->pos_ref,
+                                              m->position, m->vel_ff);
+                 }
+            }
+            else m->vel_cmd = m->vel_ref;
+
+         if (mode >= BDC_MODE_VELOCITY)
+            { if (m->has_current)
+                 m->cur_cmd = bdc_pid_run (&m->vel_pid, m->vel_cmd, m->velocity, m->vel_cmd);
+                 else m->duty_ref = bdc_pid_run (&m->vel_pid, m->vel_cmd, m->velocity,
+                                                 m->vel_cmd);  // kff = back-EMF term
+            }
+       }
+
+       //------------------------------------------------------------
+       //                  current loop  /  duty
+       //------------------------------------------------------------
+    if (mode == BDC_MODE_OFF)
+       duty = 0;
+       else if (m->has_current && mode >= BDC_MODE_CURRENT)
+               duty = bdc_pid_run (&m->cur_pid,
+                                   (mode == BDC_MODE_CURRENT) ? m->cur_ref : m->cur_cmd,
+                                   m->current, m->velocity);
+       else duty = m->duty_ref;
+
+    if (duty > m->duty_max)
+       duty = m->duty_max;
+       else if (duty < -m->duty_max)
+               duty = -m->duty_max;
+    m->duty = (int16_t) duty;
+
+    return (m->duty);
+}
+
+
+//*****************************************************************************
+//  bdc_pid_run
+//
+//          One PID step:  out = kp*e + I + kd*d(-meas) + kff*ff,  limited
+//          to +/- out_max.  Conditional integration anti-windup.
+//*****************************************************************************
+int32_t  bdc_pid_run (BDC_PID *pid, int32_t ref, int32_t meas, int32_t ff)
+{
+    int64_t    acc;
+    int64_t    integ;
+    int64_t    limit;
+    int32_t    error;
+    int32_t    out;
+
+    error = ref - meas;
+    limit = (int64_t) pid->out_max << 12;
+
+    integ = pid->integ + (int64_t) pid->ki * error;
+    if (integ > limit)
+       integ = limit;
+       else if (integ < -limit)
+               integ = -limit;
+
+    acc = (int64_t) pid->kp * error
+        - (int64_t) pid->kd * (meas - pid->prev_meas)
+        + (int64_t) pid->kff * ff;
+    pid->prev_meas = meas;
+
+       // only keep the new integrator value if it does not push an already
+       // saturated output further into saturation
+    if ( ! ((acc + integ > limit && error > 0) || (acc + integ < -limit && error < 0)))
+       pid->integ = integ;
+    acc += pid->integ;
+
+    if (acc > limit)
+       out = pid->out_max;
+       else if (acc < -limit)
+               out = -pid->out_max;
+       else out = (int32_t) (acc >> 12);
+
+    return (out);
+}
+
+
+//*****************************************************************************
+//  bdc_pid_reset
+//
+//          Clear the integrator, and seed the D term's previous measurement.
+//*****************************************************************************
+void  bdc_pid_reset (BDC_PID *pid, int32_t meas)
+{
+    pid->integ     = 0;
+    pid->prev_meas = meas;
+}
+
+//*****************************************************************************
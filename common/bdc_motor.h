@@ -0,0 +1,153 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              bdc_motor.h
+//
+//
+//  Definitions for the closed loop brushed DC (BDC) motor controller.
+//
+//  Three cascaded fixed point loops, run from a timer interrupt at a fixed
+//  rate (the "tick"), by bdc_motor_step():
+//
+//    position  --PID-->  velocity  --PI+FF-->  current  --PI+FF-->  duty
+//    (counts)            (counts/period, Q8)   (Q15)                (Q15)
+//
+//    - current loop   every tick, if the motor has current sensing
+//                     (has_current), else the velocity loop drives the duty
+//    - velocity loop  every vel_div ticks. Velocity = encoder counts moved
+//                     in that period (Q8), through a 1st order filter.
+//    - position loop  every pos_div velocity periods
+//
+//  Each loop's reference can be set directly by selecting the mode, e.g.
+//  BDC_MODE_VELOCITY runs only the velocity and current loops. A mode
+//  change is picked up by the next bdc_motor_step() (in the ISR), which
+//  resets the loops' integrators, so it is safe to call at thread level.
+//
+//  The PIDs use Q12 gains and 64-bit accumulators. Anti-windup is
+//  conditional integration: the integrator is frozen while the output is
+//  saturated in the direction the error would push it, and is clamped to
+//  the output range. The D term acts on the measurement, so reference
+//  steps do not kick the output. The feed-forward input (kff) adds a
+//  term that does not wait for an error to build up:  the position
+//  loop's velocity feed-forward (from a trajectory), the velocity as a
+//  back-EMF term in the voltage (duty) producing loop.
+//
+//  The encoder count is the raw timer counter (16 or 32 bits, set by
+//  enc_bits), extended to a 32-bit position internally.
+//
+//  Pure integer math, no HAL: the board layer (board_STM32_bdc.c) reads the
+//  encoder timer and writes the PWM CCRs, and a host build can run it
+//  against a simulated motor.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __BDC_MOTOR_H__
+#define __BDC_MOTOR_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+            // control modes: each one runs its loop and all the inner ones
+#define  BDC_MODE_OFF               0    /* duty forced to 0 (coast/brake)    */
+#define  BDC_MODE_DUTY              1    /* open loop duty                    */
+#define  BDC_MODE_CURRENT           2    /* torque control (has_current only) */
+#define  BDC_MODE_VELOCITY          3
+#define  BDC_MODE_POSITION          4
+
+#define  BDC_DUTY_MAX           32767    /* Q15 full duty                     */
+#define  BDC_VEL_SHIFT              8    /* velocity is Q8 counts / period    */
+
+#ifndef BDC_VEL_FILTER_SHIFT
+#define  BDC_VEL_FILTER_SHIFT       1    /* velocity IIR: new = old + (x-old)/2 */
+#endif
+
+
+typedef struct bdc_pid_def               /* one PID loop */
+   {
+       int32_t    kp;                    // gains, Q12 (4096 = 1.0)
+       int32_t    ki;                    //   ki is per loop period
+       int32_t    kd;
+       int32_t    kff;                   // feed-forward gain, Q12
+       int32_t    out_max;               // output limited to +/- out_max
+       int64_t    integ;                 // integrator, Q12 output units
+       int32_t    prev_meas;             // for D on measurement
+   } BDC_PID;
+
+
+typedef struct bdc_motor_def             /* one motor's control block */
+   {
+       BDC_PID    pos_pid;               // position -> velocity command
+       BDC_PID    vel_pid;               // velocity -> current (or duty) command
+       BDC_PID    cur_pid;               // current -> duty
+       uint8_t    mode;                  // BDC_MODE_xxx
+       uint8_t    has_current;           // 1 = app supplies current, run current loop
+       uint8_t    vel_div;               // velocity loop every vel_div ticks
+       uint8_t    pos_div;               // position loop every pos_div vel periods
+       uint8_t    vel_tick;
+       uint8_t    pos_tick;
+       uint8_t    enc_shift;             // 32 - encoder counter bits
+       volatile uint8_t new_mode;        // mode change, applied by the next step
+
+                                         // ---- references (set by the App) ----
+       int32_t    pos_ref;               // counts
+       int32_t    vel_ref;               // Q8 counts / vel period (VELOCITY mode)
+       int32_t    vel_ff;                // velocity feed-forward (POSITION mode)
+       int32_t    cur_ref;               // Q15 (CURRENT mode)
+       int32_t    duty_ref;              // Q15 (DUTY mode)
+       int32_t    duty_max;              // Q15 duty limit
+
+                                         // ---- measurements / loop state ----
+       uint32_t   enc_last;              // last raw encoder count
+       int32_t    position;              // extended position, counts
+       int32_t    vel_acc;               // counts moved this vel period
+       int32_t    velocity;              // filtered, Q8 counts / vel period
+       int16_t    current;               // Q15, written by the App (ADC)
+       int16_t    duty;                  // last output, Q15 signed
+       int32_t    vel_cmd;               // position loop output
+       int32_t    cur_cmd;               // velocity loop output (has_current)
+       uint32_t   steps;
+   } BDC_MOTOR;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+void     bdc_motor_init (BDC_MOTOR *m, int enc_bits, int vel_div, int pos_div,
+                         int has_current);
+void     bdc_motor_set_gains (BDC_PID *pid, int32_t kp, int32_t ki, int32_t kd,
+                              int32_t kff, int32_t out_max);
+void     bdc_motor_set_mode (BDC_MOTOR *m, int mode);
+void     bdc_motor_set_position (BDC_MOTOR *m, int32_t pos_ref, int32_t vel_ff);
+void     bdc_motor_set_velocity (BDC_MOTOR *m, int32_t vel_ref);
+void     bdc_motor_set_current (BDC_MOTOR *m, int32_t cur_ref);
+void     bdc_motor_set_duty (BDC_MOTOR *m, int32_t duty_ref);
+void     bdc_motor_zero (BDC_MOTOR *m, uint32_t enc_count);
+int16_t  bdc_motor_step (BDC_MOTOR *m, uint32_t enc_count);
+int32_t  bdc_pid_run (BDC_PID *pid, int32_t ref, int32_t meas, int32_t ff);
+void     bdc_pid_reset (BDC_PID *pid, int32_t meas);
+
+#endif                          //  __BDC_MOTOR_H__
+
+//*****************************************************************************
@@ -0,0 +1,350 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              binlog.c
+//
+//
+//  Deferred-formatting Binary Log.
+//
+//  Producers (BLOG() calls, from thread or ISR level) reserve space in the
+//  ring with a single atomic add on the ring head, fill in their record, and
+//  then commit it by writing the header word. Reservation is
+//  ring_atomic_reserve() (ring_buf.h): lock-free on Cortex-M3/M4/M7
+//  (LDREX/STREX). On Cortex-M0 and MSP430, which do not have exclusive
+//  access instructions, it is a few instruction critical section that saves
+//  and restores the caller's interrupt state, so it is still safe from any
+//  interrupt level.
+//
+//  If the ring is full, the record is dropped and counted. The consumer
+//  later puts out a "N records dropped" record, so gaps are visible on the
+//  host side.
+//
+//  The consumer (binlog_service) keeps 4 running word indexes:
+//
+//      tail  <=  sent  <=  scan  <=  head
+//
+//      tail:  oldest word still owned by the log (being sent by the UART)
+//      sent:  words up to here have been handed to the UART
+//      scan:  end of the last fully committed record
+//      head:  next free word (reserved by producers)
+//
+//  When the UART finishes a send, the sent words are zeroed (so they read as
+//  "not committed" when producers wrap around onto them again), and tail is
+//  advanced, which frees the space up for new records.
+//
+//  Because the UART TX in this tree is interrupt driven (TXE ISR), each send
+//  is limited to the contiguous run of words up to the end of the ring. A
+//  record that straddles the end of the ring just goes out in 2 sends.
+//
+//  History:
+//    10/19/26 - Created.
+//    10/19/26 - Use the shared ring_buf.h reserve / atomic count primitives.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "binlog.h"
+#include "ring_buf.h"
+#include <string.h>
+
+
+typedef struct binlog_ctl_def           /* Binary Log control block */
+   {
+       volatile uint32_t  *ring;        // ring buffer of 32-bit words
+       uint32_t   ring_mask;            // ring_words - 1
+       uint16_t   ring_words;           // # words in the ring (power of 2)
+       uint8_t    uart_module;          // UART the log is drained to
+       uint8_t    hdr_flags;            // BINLOG_TS_USEC or 0
+
+       volatile uint32_t  head;         // next free word   (producers)
+       volatile uint32_t  tail;         // oldest owned word (consumer)
+       uint32_t   sent;                 // end of words handed to UART
+       uint32_t   scan;                 // end of last committed record
+       uint8_t    sending;              // 1 = a UART send is in progress
+
+       volatile uint32_t  dropped;      // # records dropped (producers)
+       uint32_t   dropped_reported;     // # drops already logged as a record
+       BINLOG_STATS  stats;
+   } BINLOG_CTL;
+
+    BINLOG_CTL   _g_binlog;             // there is only one Binary Log
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static int   binlog_commit (uint32_t fmt_addr, int nargs, const uint32_t *args);
+static void  binlog_count_drop (void);
+
+
+//*****************************************************************************
+//  binlog_init
+//
+//          Setup the Binary Log over a caller supplied ring buffer, and
+//          select the UART it will be drained to.
+//
+//          ring_words must be a power of 2, between 16 and 32768.
+//
+//          Flags:  BINLOG_USEC_TIMESTAMPS - stamp records with the 64-bit
+//                  timestamp service's usec clock (USES_TIMESTAMP), instead
+//                  of the 1 ms SysTick count.
+//*****************************************************************************
+int  binlog_init (uint32_t *ring, int ring_words, unsigned int uart_module, int flags)
+{
+    int   i;
+
+    if (ring == 0L || ring_words < 16 || ring_words > 32768
+       || (ring_words & (ring_words - 1)) != 0)
+       return (ERR_BINLOG_INVALID_PARM);
+
+    memset (&_g_binlog, 0, sizeof(_g_binlog));
+
+    for (i = 0;  i < ring_words;  i++)
+      ring[i] = 0;                      // every slot starts out uncommitted
+
+    _g_binlog.ring_mask   = (uint32_t) ring_words - 1;
+    _g_binlog.ring_words  = (uint16_t) ring_words;
+    _g_binlog.uart_module = (uint8_t) uart_module;
+    _g_binlog.stats.ring_words = (uint16_t) ring_words;
+#if defined(USES_TIMESTAMP)
+    if (flags & BINLOG_USEC_TIMESTAMPS)
+       _g_binlog.hdr_flags = BINLOG_TS_USEC;
+#else
+    (void) flags;                       // only usec timestamps use flags
+#endif
+    _g_binlog.ring = ring;              // set last: BLOG()s now get logged
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  binlog_write                                            aka  BLOG()
+//
+//          Log a format string address, plus nargs raw 32-bit arguments.
+//          Safe to call from any interrupt level. Never blocks.
+//
+//          Returns:  0 if logged, or ERR_BINLOG_RING_FULL if it was dropped.
+//*****************************************************************************
+int  binlog_write (const char *fmt, int nargs, const uint32_t *args)
+{
+    if (fmt == 0L || nargs < 0 || nargs > BINLOG_MAX_ARGS)
+       return (ERR_BINLOG_RING_FULL);   // treat junk as a dropped record
+
+    return (binlog_commit((uint32_t) (uintptr_t) fmt, nargs, args));
+}
+
+
+//*****************************************************************************
+//  binlog_commit
+//
+//          Reserve space for one record, fill it in, then commit it by
+//          writing the header word last.
+//*****************************************************************************
+static int  binlog_commit (uint32_t fmt_addr, int nargs, const uint32_t *args)
+{
+    volatile uint32_t  *ring;
+    uint32_t           start;
+    uint32_t           nwords;
+    uint32_t           mask;
+    uint32_t           tstamp;
+    int                i;
+
+    ring = _g_binlog.ring;
+    if (ring == 0L)
+       return (ERR_BINLOG_RING_FULL);   // binlog_init() not called yet
+
+    nwords = BINLOG_HDR_WORDS + nargs;
+
+#if defined(USES_TIMESTAMP)
+    if (_g_binlog.hdr_flags & BINLOG_TS_USEC)
+       tstamp = (uint32_t) sys_Get_Timestamp_Usec();
+       else tstamp = (uint32_t) board_systick_timer_get_value();
+#else
+    tstamp = (uint32_t) board_systick_timer_get_value();
+#endif
+
+         //--------------------------------------------------------------
+         // reserve nwords at the ring head.  The tail only ever moves
+         // forward, so a stale tail just makes the ring look fuller.
+         //--------------------------------------------------------------
+    start = ring_atomic_reserve (&_g_binlog.head, &_g_binlog.tail,
+                                 _g_binlog.ring_words, nwords);
+    if (start == RING_RESERVE_FULL)
+       { binlog_count_drop();           // full: drop it
+         return (ERR_BINLOG_RING_FULL);
+       }
+
+         //--------------------------------------------------------------
+         // fill in the body, then commit it with the header word
+         //--------------------------------------------------------------
+    mask = _g_binlog.ring_mask;
+    ring [(start + 1) & mask] = fmt_addr;
+    ring [(start + 2) & mask] = tstamp;
+    for (i = 0;  i < nargs;  i++)
+      ring [(start + BINLOG_HDR_WORDS + i) & mask] = args[i];
+
+    RING_BARRIER();                     // body must be visible before header
+    ring [start & mask] = BINLOG_SYNC | ((uint32_t) nargs << 8)
+                        | ((uint32_t) _g_binlog.hdr_flags << 11)
+                        | ((start & 0xFFFF) << 16);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  binlog_count_drop
+//
+//          Bump the dropped records count. Producers at different interrupt
+//          levels can hit this at the same time, so it is an atomic add.
+//*****************************************************************************
+static void  binlog_count_drop (void)
+{
+    ring_atomic_inc (&_g_binlog.dropped);
+}
+
+
+//*****************************************************************************
+//  binlog_service
+//
+//          Drain the ring to the UART. Call this from the main loop, or from
+//          a VTIMER callback. It never waits on the UART:
+//            - if the previous send is still going, it just returns.
+//            - otherwise it frees the words that were sent, and starts a
+//              non-blocking send of the next run of committed records.
+//
+//          Returns:  # bytes started sending (0 = nothing to do, or UART
+//                    still busy), or a negative UART error code.
+//*****************************************************************************
+int  binlog_service (void)
+{
+    volatile uint32_t  *ring;
+    uint32_t           hdr;
+    uint32_t           head;
+    uint32_t           in_use;
+    uint32_t           words;
+    uint32_t           to_end;
+    uint32_t           dropped;
+    uint32_t           mask;
+    int                rc;
+
+    ring = _g_binlog.ring;
+    if (ring == 0L)
+       return (0);                      // binlog_init() not called yet
+    mask = _g_binlog.ring_mask;
+
+         //--------------------------------------------------------------
+         // if the last send is done, zero out what it sent and free it
+         //--------------------------------------------------------------
+    if (_g_binlog.sending)
+       { rc = uart_Check_IO_Completed (_g_binlog.uart_module, 0);
+         if (rc == 0)
+            return (0);                 // UART still busy sending
+         while (_g_binlog.tail != _g_binlog.sent)
+           { ring [_g_binlog.tail & mask] = 0;
+             _g_binlog.tail++;
+           }
+         _g_binlog.sending = 0;
+       }
+
+         //--------------------------------------------------------------
+         // report any drops.  If the ring is still full, try next time.
+         //--------------------------------------------------------------
+    dropped = _g_binlog.dropped;
+    if (dropped != _g_binlog.dropped_reported)
+       { hdr = dropped - _g_binlog.dropped_reported;
+         if (binlog_commit(0, 1, &hdr) == 0)
+            { _g_binlog.dropped_reported  = dropped;
+              _g_binlog.stats.records_dropped += hdr;
+            }
+       }
+
+         //--------------------------------------------------------------
+         // walk forward over any newly committed records
+         //--------------------------------------------------------------
+    head = _g_binlog.head;
+    in_use = head - _g_binlog.tail;
+    if (in_use > _g_binlog.stats.ring_high_water)
+       _g_binlog.stats.ring_high_water = (uint16_t) in_use;
+
+    while (_g_binlog.scan != head)
+      { hdr = ring [_g_binlog.scan & mask];
+        if ((hdr & 0xFF) != BINLOG_SYNC)
+           break;                       // reserved, but not yet committed
+        _g_binlog.scan += BINLOG_HDR_WORDS + ((hdr >> 8) & 0x07);
+        _g_binlog.stats.records_logged++;
+      }
+
+    if (_g_binlog.sent == _g_binlog.scan)
+       return (0);                      // nothing new to send
+
+         //--------------------------------------------------------------
+         // send the contiguous run, up to the end of the ring
+         //--------------------------------------------------------------
+    words  = _g_binlog.scan - _g_binlog.sent;
+    to_end = _g_binlog.ring_words - (_g_binlog.sent & mask);
+    if (words > to_end)
+       words = to_end;
+
+    rc = uart_Write_Binary (_g_binlog.uart_module,
+                            (uint8_t*) &ring [_g_binlog.sent & mask],
+                            (int) (words * 4), UART_IO_NON_BLOCKING);
+    if (rc == ERR_IO_ALREADY_IN_PROGRESS)
+       return (0);                      // UART is in use by someone else
+    if (rc < 0)
+       return (rc);
+
+    _g_binlog.sent    += words;
+    _g_binlog.sending  = 1;
+    _g_binlog.stats.bytes_sent += words * 4;
+
+    return ((int) (words * 4));         // denote # bytes started
+}
+
+
+//*****************************************************************************
+//  binlog_get_stats
+//
+//          Return a copy of the Binary Log statistics, and optionally reset
+//          the counts.
+//*****************************************************************************
+int  binlog_get_stats (BINLOG_STATS *stats, int reset_flag)
+{
+    if (stats == 0L)
+       return (ERR_BINLOG_INVALID_PARM);
+
+    *stats = _g_binlog.stats;
+    stats->records_dropped += (_g_binlog.dropped - _g_binlog.dropped_reported);
+
+    if (reset_flag)
+       { _g_binlog.stats.records_logged  = 0;
+         _g_binlog.stats.records_dropped = 0;
+         _g_binlog.stats.bytes_sent      = 0;
+         _g_binlog.stats.ring_high_water = 0;
+       }
+
+    return (0);                         // denote success
+}
+
+//*****************************************************************************
@@ -0,0 +1,135 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              binlog.h
+//
+//
+//  Definitions for the deferred-formatting Binary Log.
+//
+//  Instead of sprintf()'ing a line and then waiting on the UART, a BLOG()
+//  call only records the address of its format string, a timestamp, and up
+//  to 6 raw 32-bit arguments into a RAM ring. No formatting is done on the
+//  MCU. This costs a few dozen cycles, never blocks, and is safe to call
+//  from any interrupt level.
+//
+//  The ring is drained in the background by binlog_service() (called from
+//  the main loop or a VTIMER callback), which hands the committed records to
+//  the UART as non-blocking binary sends. The host side tool
+//  tools/binlog_decode.py looks the format strings up in the firmware's .elf
+//  file and renders the original text.
+//
+//  Record layout (all fields are 32-bit words, little endian on the wire):
+//
+//      word 0    header:  0xA5 sync | nargs << 8 | flags << 11 | seq << 16
+//      word 1    address of the format string  (0 = "records dropped")
+//      word 2    timestamp  (ms, or usec if BINLOG_TS_USEC is set in header)
+//      word 3..  nargs raw arguments
+//
+//  The header word is written LAST, and is what commits the record. Slots
+//  whose header is still 0 have been reserved, but not yet filled in.
+//
+//  Argument conventions (what the decoder expects):
+//    - %d %u %x %c     plain integers.  Pass them as is.
+//    - %f %e %g        float bits.      Wrap float args with BLOG_F(x).
+//    - %s              string address.  Only strings that live in the
+//                      firmware image (const/flash) can be decoded. Strings
+//                      built at run-time in RAM will show as <ptr 0x...>.
+//
+//  Limitations:
+//    - format strings MUST be string literals (or other const data in the
+//      image), since only their address is logged.
+//    - the ring size must be a power of 2 words.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __BINLOG_H__
+#define __BINLOG_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+#define  BINLOG_SYNC             0xA5    /* low byte of every record header    */
+#define  BINLOG_MAX_ARGS            6    /* max # args on a single BLOG() call */
+#define  BINLOG_HDR_WORDS           3    /* header + format addr + timestamp   */
+#define  BINLOG_TS_USEC          0x01    /* header flag: timestamp is in usec  */
+
+#ifndef BINLOG_RING_WORDS
+#define  BINLOG_RING_WORDS        256    /* default ring = 1 KB. Power of 2    */
+#endif
+
+            // Valid values for flags on binlog_init()
+#define  BINLOG_USEC_TIMESTAMPS  0x0001  /* use sys_Get_Timestamp_Usec(), not ms */
+
+
+typedef struct binlog_stats_def         /* Binary Log statistics */
+   {
+       uint32_t   records_logged;       // # records committed to the ring
+       uint32_t   records_dropped;      // # records lost because ring was full
+       uint32_t   bytes_sent;           // # bytes handed to the UART
+       uint16_t   ring_words;           // size of the ring, in 32-bit words
+       uint16_t   ring_high_water;      // max # words ever in use
+   } BINLOG_STATS;
+
+
+     //--------------------------------------------------------------
+     // BLOG (format, ...)   log a format string and 0 to 6 args.
+     //
+     // The arg count is worked out at compile time, and the args are
+     // passed as a small array, so there is no va_list overhead.
+     //--------------------------------------------------------------
+#define  BLOG(...)  BLOG_SEL_(__VA_ARGS__, BLOG_6_, BLOG_5_, BLOG_4_, BLOG_3_, \
+                              BLOG_2_, BLOG_1_, BLOG_0_, 0)(__VA_ARGS__)
+#define  BLOG_SEL_(f,a,b,c,d,e,g,name,...)  name
+
+#define  BLOG_0_(f)   binlog_write (f, 0, 0L)
+#define  BLOG_1_(f,a) binlog_write (f, 1, (const uint32_t[]) {(uint32_t)(a)})
+#define  BLOG_2_(f,a,b) binlog_write (f, 2, (const uint32_t[]) \
+                            {(uint32_t)(a),(uint32_t)(b)})
+#define  BLOG_3_(f,a,b,c) binlog_write (f, 3, (const uint32_t[]) \
+                            {(uint32_t)(a),(uint32_t)(b),(uint32_t)(c)})
+#define  BLOG_4_(f,a,b,c,d) binlog_write (f, 4, (const uint32_t[]) \
+                            {(uint32_t)(a),(uint32_t)(b),(uint32_t)(c),(uint32_t)(d)})
+#define  BLOG_5_(f,a,b,c,d,e) binlog_write (f, 5, (const uint32_t[]) \
+                            {(uint32_t)(a),(uint32_t)(b),(uint32_t)(c),(uint32_t)(d), \
+                             (uint32_t)(e)})
+#define  BLOG_6_(f,a,b,c,d,e,g) binlog_write (f, 6, (const uint32_t[]) \
+                            {(uint32_t)(a),(uint32_t)(b),(uint32_t)(c),(uint32_t)(d), \
+                             (uint32_t)(e),(uint32_t)(g)})
+
+                  // pass a float's raw bits, for %f / %e / %g
+#define  BLOG_F(x)  (((union { float f; uint32_t u; }) { .f = (float) (x) }).u)
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int  binlog_init (uint32_t *ring, int ring_words, unsigned int uart_module, int flags);
+int  binlog_write (const char *fmt, int nargs, const uint32_t *args);
+int  binlog_service (void);
+int  binlog_get_stats (BINLOG_STATS *stats, int reset_flag);
+
+#endif                          //  __BINLOG_H__
+
+//*****************************************************************************
@@ -0,0 +1,276 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              boot_prof.c
+//
+//
+//  Boot time profiler. See boot_prof.h
+//
+//  The usec clock is kept as a (base_usec, base_cycles) pair that is moved
+//  forward on every read, so the 32-bit cycle counter may wrap any number
+//  of times during boot, as long as it is read at least once per wrap
+//  (~19 secs at 216 MHz). A clock change rebases the pair at the old rate,
+//  then switches to the new one.
+//
+//  Thread level only: board_init() and the App's init code.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "boot_prof.h"
+#include <string.h>
+
+
+typedef struct boot_prof_state_def       /* profiler state */
+   {
+       uint32_t   base_usec;             // usec at base_cycles
+#if defined(BOOT_PROF_CYCLES)
+       uint32_t   base_cycles;
+       uint32_t   cycles_per_usec;       // 0 = boot_prof_init() not done
+#else
+       uint32_t   base_millis;
+#endif
+       uint32_t   ttfs_usec;             // time to first sample, 0 = none yet
+       uint16_t   num_steps;
+       uint16_t   dropped;               // begins past BOOT_PROF_MAX_STEPS
+       uint8_t    warm;                  // 1 = woke from standby (boot_seq)
+       BOOT_STEP  steps [BOOT_PROF_MAX_STEPS];
+   } BOOT_PROF_STATE;
+
+static BOOT_PROF_STATE   _g_bp;
+
+
+//*****************************************************************************
+//  boot_prof_init
+//
+//          Start the boot clock at 0 usec, and clear the step table. Called
+//          first thing in board_init() (USES_BOOT_PROFILE).
+//*****************************************************************************
+void  boot_prof_init (void)
+{
+    memset (&_g_bp, 0, sizeof(_g_bp));
+
+#if defined(BOOT_PROF_CYCLES)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;  // turn on the DWT
+#if defined(STM32F746xx) || defined(STM32F746NGHx)
+    DWT->LAR = 0xC5ACCE55;                       // M7: unlock DWT for writes
+#endif
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    _g_bp.base_cycles = BOOT_PROF_CYCLES();
+    boot_prof_clock_changed();                   // sets cycles_per_usec
+#else
+    _g_bp.base_millis = BOOT_PROF_MILLIS();
+#endif
+}
+
+
+//*****************************************************************************
+//  boot_prof_clock_changed
+//
+//          Call right after the CPU clock is changed (SystemCoreClock has
+//          been updated), so later reads convert at the new rate.
+//*****************************************************************************
+void  boot_prof_clock_changed (void)
+{
+#if defined(BOOT_PROF_CYCLES)
+    uint32_t  mhz;
+
+    boot_prof_now_usec();                // bring the base up to now, old rate
+    mhz = BOOT_PROF_CLOCK_HZ / 1000000UL;
+    _g_bp.cycles_per_usec = (mhz != 0) ? mhz : 1;
+#endif
+}
+
+
+//*****************************************************************************
+//  boot_prof_now_usec
+//
+//          usec since boot_prof_init().
+//*****************************************************************************
+uint32_t  boot_prof_now_usec (void)
+{
+#if defined(BOOT_PROF_CYCLES)
+    uint32_t  usec;
+
+    if (_g_bp.cycles_per_usec == 0)
+       return (0);                       // boot_prof_init() not done
+    usec = (BOOT_PROF_CYCLES() - _g_bp.base_cycles) / _g_bp.cycles_per_usec;
+    _g_bp.base_cycles += usec * _g_bp.cycles_per_usec;  // keep the remainder
+    _g_bp.base_usec   += usec;
+    return (_g_bp.base_usec);
+#else
+    return ((BOOT_PROF_MILLIS() - _g_bp.base_millis) * 1000UL);
+#endif
+}
+
+
+//*****************************************************************************
+//  boot_prof_begin
+//
+//          Start timing a step. Returns its id, for boot_prof_end(), or
+//          ERR_BOOT_TABLE_FULL (which boot_prof_end() ignores, so callers
+//          need not check).
+//*****************************************************************************
+int  boot_prof_begin (const char *name)
+{
+    BOOT_STEP  *sp;
+
+    if (_g_bp.num_steps >= BOOT_PROF_MAX_STEPS)
+       { _g_bp.dropped++;
+         return (ERR_BOOT_TABLE_FULL);
+       }
+    sp = &_g_bp.steps [_g_bp.num_steps];
+    sp->name       = (name != 0L) ? name : "?";
+    sp->start_usec = boot_prof_now_usec();
+    sp->dur_usec   = 0;
+    sp->rc         = 0;
+    sp->done       = 0;
+    return (_g_bp.num_steps++);
+}
+
+
+//*****************************************************************************
+//  boot_prof_end
+//
+//          The step is done. rc is its outcome (0, or an ERR_xxx code).
+//*****************************************************************************
+void  boot_prof_end (int step_id, int rc)
+{
+    BOOT_STEP  *sp;
+
+    if (step_id < 0 || step_id >= _g_bp.num_steps)
+       return;
+    sp = &_g_bp.steps [step_id];
+    if (sp->done)
+       return;
+    sp->dur_usec = boot_prof_now_usec() - sp->start_usec;
+    sp->rc       = (int16_t) rc;
+    sp->done     = 1;
+}
+
+
+//*****************************************************************************
+//  boot_prof_set_warm
+//
+//          Note that this boot was a warm one (restored from standby).
+//*****************************************************************************
+void  boot_prof_set_warm (int warm_boot)
+{
+    _g_bp.warm = (warm_boot != 0);
+}
+
+
+//*****************************************************************************
+//  boot_prof_first_sample
+//
+//          Call when the first sample has been read. Only the first call
+//          counts.
+//*****************************************************************************
+void  boot_prof_first_sample (void)
+{
+    uint32_t  now;
+
+    if (_g_bp.ttfs_usec != 0)
+       return;
+    now = boot_prof_now_usec();
+    _g_bp.ttfs_usec = (now != 0) ? now : 1;
+}
+
+
+//*****************************************************************************
+//  boot_prof_get_ttfs
+//
+//          Time to first sample, in usec, or 0 if there has not been one.
+//*****************************************************************************
+uint32_t  boot_prof_get_ttfs (void)
+{
+    return (_g_bp.ttfs_usec);
+}
+
+
+//*****************************************************************************
+//  boot_prof_get_step
+//*****************************************************************************
+int  boot_prof_get_step (int step_id, BOOT_STEP *step)
+{
+    if (step_id < 0 || step_id >= _g_bp.num_steps || step == 0L)
+       return (ERR_BOOT_INVALID_PARM);
+    *step = _g_bp.steps [step_id];
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  boot_prof_num_steps
+//*****************************************************************************
+int  boot_prof_num_steps (void)
+{
+    return (_g_bp.num_steps);
+}
+
+
+//*****************************************************************************
+//  boot_prof_encode
+//
+//          Encode the profile as one telemetry codec map (usec):
+//
+//            {"warm":0|1, "ttfs":usec, "drop":n,
+//             "steps":[["name",start,dur,rc], ...]}
+//
+//          A step that has not ended has a null dur. The caller does the
+//          tcodec_enc_init() / tcodec_enc_finish().
+//*****************************************************************************
+void  boot_prof_encode (TCODEC_ENC *enc)
+{
+    BOOT_STEP  *sp;
+    int        i;
+
+    tcodec_enc_map_begin (enc, 4);
+    tcodec_enc_key  (enc, "warm");
+    tcodec_enc_uint (enc, _g_bp.warm);
+    tcodec_enc_key  (enc, "ttfs");
+    tcodec_enc_uint (enc, _g_bp.ttfs_usec);
+    tcodec_enc_key  (enc, "drop");
+    tcodec_enc_uint (enc, _g_bp.dropped);
+
+    tcodec_enc_key  (enc, "steps");
+    tcodec_enc_array_begin (enc, _g_bp.num_steps);
+    for (i = 0;  i < _g_bp.num_steps;  i++)
+      { sp = &_g_bp.steps [i];
+        tcodec_enc_array_begin (enc, 4);
+        tcodec_enc_str  (enc, sp->name, -1);
+        tcodec_enc_uint (enc, sp->start_usec);
+        if (sp->done)
+           tcodec_enc_uint (enc, sp->dur_usec);
+           else tcodec_enc_null (enc);
+        tcodec_enc_int  (enc, sp->rc);
+        tcodec_enc_array_end (enc);
+      }
+    tcodec_enc_array_end (enc);
+    tcodec_enc_map_end (enc);
+}
+
+//*****************************************************************************
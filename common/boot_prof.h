@@ -0,0 +1,115 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              boot_prof.h
+//
+//
+//  Definitions for the boot time profiler.
+//
+//  Each init step (clock config, a sensor's init, the BLE reset, ...) is
+//  bracketed with boot_prof_begin() / boot_prof_end(), which record its
+//  start time and duration in usec since board_init() started. Steps may
+//  overlap (see boot_seq.h, which runs independent devices' init steps
+//  concurrently), so the table shows what ran in parallel, not just a sum.
+//
+//      board_init():   boot_prof_init();                 time 0
+//                      id = boot_prof_begin ("clk");
+//                      board_system_clock_config (...);
+//                      boot_prof_clock_changed();         rebase to new MHz
+//                      boot_prof_end (id, 0);
+//      App:            ... init devices ...
+//                      read the first sample
+//                      boot_prof_first_sample();          time-to-first-sample
+//
+//  boot_prof_encode() writes the table through the telemetry codec: JSON for
+//  the console, or JSON / CBOR for an MQTT diagnostics topic.
+//
+//  The time base is the DWT cycle counter on Cortex-M3/M4/M7, converted at
+//  the current SystemCoreClock, so it works before SysTick and the 64-bit
+//  timestamp service are up. Cortex-M0 (no DWT) falls back to the 1 ms
+//  SysTick count.
+//
+//  Limitations:
+//    - Time from reset to board_init() (startup code, .data/.bss init) is
+//      not included.
+//    - The step that changes the CPU clock is timed at the old clock rate,
+//      up to the boot_prof_clock_changed() call.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __BOOT_PROF_H__
+#define __BOOT_PROF_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+#include "telemetry_codec.h"        // the profile is exported as CBOR / JSON
+
+                        // sizing - override in project_config_parms.h
+#if !defined(BOOT_PROF_MAX_STEPS)
+#define  BOOT_PROF_MAX_STEPS       24
+#endif
+
+                        // the counter that is read, and its rate
+#if !defined(BOOT_PROF_CYCLES) && defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+#define  BOOT_PROF_CYCLES()        (DWT->CYCCNT)
+#endif
+#if !defined(BOOT_PROF_CLOCK_HZ)
+#define  BOOT_PROF_CLOCK_HZ        SystemCoreClock
+#endif
+#if !defined(BOOT_PROF_CYCLES) && !defined(BOOT_PROF_MILLIS)
+#define  BOOT_PROF_MILLIS()        sys_Get_Time()   /* M0: 1 ms resolution */
+#endif
+
+            // error codes are ERR_BOOT_xxx in user_api.h
+
+
+typedef struct boot_step_def             /* one init step */
+   {
+       const char  *name;                // short: it is a JSON key / CBOR string
+       uint32_t    start_usec;           // from boot_prof_init()
+       uint32_t    dur_usec;             // valid once done = 1
+       int16_t     rc;                   // as passed to boot_prof_end()
+       uint8_t     done;
+   } BOOT_STEP;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+void     boot_prof_init (void);
+void     boot_prof_clock_changed (void);
+uint32_t boot_prof_now_usec (void);
+int      boot_prof_begin (const char *name);
+void     boot_prof_end (int step_id, int rc);
+void     boot_prof_set_warm (int warm_boot);
+void     boot_prof_first_sample (void);
+uint32_t boot_prof_get_ttfs (void);          // 0 = no sample yet
+int      boot_prof_get_step (int step_id, BOOT_STEP *step);
+int      boot_prof_num_steps (void);
+void     boot_prof_encode (TCODEC_ENC *enc);
+
+#endif                          //  __BOOT_PROF_H__
+
+//*****************************************************************************
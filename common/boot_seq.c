@@ -0,0 +1,376 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              boot_seq.c
+//
+//
+//  Boot sequencer: cooperative, concurrent device init. See boot_seq.h
+//
+//  Each pass walks the tasks in id order. A task is called when the tasks
+//  it depends on are up and its wait has run out. Since a task can only
+//  depend on tasks ahead of it, one pass both finishes a task and starts
+//  the ones waiting on it, and a dependency cycle can not be built. When
+//  a pass calls no step at all, every task is waiting, so the CPU idles
+//  until the next SysTick.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "boot_seq.h"
+#include <string.h>
+
+#if defined(USES_BOOT_PROFILE)
+#include "boot_prof.h"              // each task is a profiled step
+#endif
+
+
+//*****************************************************************************
+//  boot_seq_with_deps
+//
+//          Add every task that the tasks in mask depend on, directly or not.
+//          Dependencies point to lower ids, so one pass from the top down
+//          picks up the whole chain.
+//*****************************************************************************
+static uint16_t  boot_seq_with_deps (BOOT_SEQ *seq, uint16_t mask)
+{
+    int   i;
+
+    for (i = seq->num_tasks - 1;  i >= 0;  i--)
+      if (mask & BOOT_TASK_BIT(i))
+         mask |= seq->tasks[i].depends;
+    return (mask);
+}
+
+
+//*****************************************************************************
+//  boot_seq_finish
+//
+//          A task is up (rc = 0) or has failed.
+//*****************************************************************************
+static void  boot_seq_finish (BOOT_SEQ *seq, int task_id, int rc)
+{
+    BOOT_TASK  *tp = &seq->tasks [task_id];
+
+    tp->rc = rc;
+    if (rc == 0)
+       { tp->state    = BOOT_STATE_UP;
+         seq->up_mask |= BOOT_TASK_BIT(task_id);
+       }
+      else
+       { tp->state        = BOOT_STATE_FAILED;
+         seq->failed_mask |= BOOT_TASK_BIT(task_id);
+       }
+#if defined(USES_BOOT_PROFILE)
+    boot_prof_end (tp->prof_id, rc);
+#endif
+}
+
+
+//*****************************************************************************
+//  boot_seq_pass
+//
+//          One pass over the tasks in mask. Returns the # of them that are
+//          not up or failed yet. *called = 1 if any step function was run.
+//*****************************************************************************
+static int  boot_seq_pass (BOOT_SEQ *seq, uint16_t mask, int *called)
+{
+    BOOT_TASK       *tp;
+    BOOT_STEP_FUNC  step;
+    uint32_t        now;
+    int             i, rc, pending;
+
+    *called = 0;
+    pending = 0;
+    for (i = 0;  i < seq->num_tasks;  i++)
+      {
+        tp = &seq->tasks [i];
+        if ((mask & BOOT_TASK_BIT(i)) == 0
+          || tp->state == BOOT_STATE_UP || tp->state == BOOT_STATE_FAILED)
+           continue;
+
+        if (tp->depends & seq->failed_mask)
+           { if (tp->state == BOOT_STATE_IDLE)
+                {
+#if defined(USES_BOOT_PROFILE)
+                  tp->prof_id = boot_prof_begin (tp->name);
+#endif
+                }
+             boot_seq_finish (seq, i, ERR_BOOT_DEP_FAILED);
+             continue;
+           }
+        pending++;
+        if (tp->depends & ~seq->up_mask)
+           continue;                    // still waiting on another task
+
+        now = BOOT_SEQ_NOW_MS();
+        if (tp->state == BOOT_STATE_IDLE)
+           { tp->state   = BOOT_STATE_RUNNING;
+             tp->phase   = 0;
+             tp->wake_ms = now;
+#if defined(USES_BOOT_PROFILE)
+             tp->prof_id = boot_prof_begin (tp->name);
+#endif
+           }
+        if ((int32_t) (now - tp->wake_ms) < 0)
+           continue;                    // still in its wait
+
+        step = tp->cold_step;           // warm only if it was up at commit
+        if (seq->warm && tp->warm_step != 0L && (seq->saved_mask & BOOT_TASK_BIT(i)))
+           step = tp->warm_step;
+        rc   = (step) (seq, tp);
+        *called = 1;
+
+        if (rc < 0 || rc == BOOT_DONE)
+           { boot_seq_finish (seq, i, rc);
+             pending--;
+           }
+          else if (rc == BOOT_YIELD)
+                  tp->wake_ms = BOOT_SEQ_NOW_MS();
+          else tp->wake_ms = BOOT_SEQ_NOW_MS() + (uint32_t) rc;
+      }
+
+    return (pending);
+}
+
+
+//*****************************************************************************
+//  boot_seq_wait
+//
+//          Run passes until every task in mask is up or failed, or the
+//          timeout. On a timeout, the tasks still going are left as they
+//          are: a later boot_seq_poll() / _require() carries on with them.
+//*****************************************************************************
+static int  boot_seq_wait (BOOT_SEQ *seq, uint16_t mask, uint32_t timeout_ms)
+{
+    uint32_t  start_ms;
+    int       called;
+
+    start_ms = BOOT_SEQ_NOW_MS();
+    while (boot_seq_pass (seq, mask, &called) > 0)
+      {
+        if ((BOOT_SEQ_NOW_MS() - start_ms) >= timeout_ms)
+           return (ERR_BOOT_TIMEOUT);
+        if ( ! called)
+           BOOT_SEQ_IDLE();             // everyone is waiting
+      }
+    return (0);
+}
+
+
+//*****************************************************************************
+//  boot_seq_init
+//
+//          Set up a sequencer over a task table. Tasks are listed in
+//          dependency order: a task may only depend on tasks ahead of it.
+//
+//          Reads the reset cause and the backup registers, to decide if
+//          this is a warm boot (woke from standby, after a boot_seq_commit()).
+//          The saved header is cleared either way, so a warm boot needs a
+//          fresh commit before the next standby.
+//*****************************************************************************
+int  boot_seq_init (BOOT_SEQ *seq, BOOT_TASK *tasks, int num_tasks)
+{
+    BOOT_TASK  *tp;
+    uint32_t   hdr;
+    int        i;
+
+    if (seq == 0L || tasks == 0L || num_tasks < 1 || num_tasks > BOOT_SEQ_MAX_TASKS)
+       return (ERR_BOOT_INVALID_PARM);
+    for (i = 0;  i < num_tasks;  i++)
+      if (tasks[i].cold_step == 0L
+        || (tasks[i].depends & (uint16_t) ~(BOOT_TASK_BIT(i) - 1)) != 0)
+         return (ERR_BOOT_INVALID_PARM);   // no step, or depends on a later task
+
+    memset (seq, 0, sizeof(BOOT_SEQ));
+    seq->tasks     = tasks;
+    seq->num_tasks = (uint8_t) num_tasks;
+    for (i = 0;  i < num_tasks;  i++)
+      { tp = &tasks [i];
+        tp->state   = BOOT_STATE_IDLE;
+        tp->phase   = 0;
+        tp->rc      = 0;
+        tp->wake_ms = 0;
+        tp->prof_id = -1;
+      }
+
+    seq->reset_cause = sys_Get_Reset_Cause();
+    if (sys_Backup_Read (BOOT_SEQ_BKP_FIRST, &hdr) == 0
+      && (hdr & 0xFF000000UL) == BOOT_SEQ_BKP_MAGIC)
+       { if ((seq->reset_cause & RESET_CAUSE_STANDBY)
+           && ((hdr >> 16) & 0xFF) == (uint32_t) num_tasks)
+            { seq->warm       = 1;
+              seq->saved_mask = (uint16_t) hdr;
+            }
+         sys_Backup_Write (BOOT_SEQ_BKP_FIRST, 0);   // used up
+       }
+#if defined(USES_BOOT_PROFILE)
+    boot_prof_set_warm (seq->warm);
+#endif
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  boot_seq_run
+//
+//          Bring up every task that is not BOOT_TASK_LAZY, concurrently.
+//          Returns 0 when they are all up, else the failure code of the
+//          first one that failed (BOOT_TASK_OPTIONAL ones aside), or
+//          ERR_BOOT_TIMEOUT.
+//*****************************************************************************
+int  boot_seq_run (BOOT_SEQ *seq, uint32_t timeout_ms)
+{
+    uint16_t  mask;
+    int       i, rc;
+
+    if (seq == 0L || seq->tasks == 0L)
+       return (ERR_BOOT_INVALID_PARM);
+
+    for (mask = 0, i = 0;  i < seq->num_tasks;  i++)
+      if ((seq->tasks[i].flags & BOOT_TASK_LAZY) == 0)
+         mask |= BOOT_TASK_BIT(i);
+    mask = boot_seq_with_deps (seq, mask);
+
+    rc = boot_seq_wait (seq, mask, timeout_ms);
+    if (rc != 0)
+       return (rc);
+
+    for (i = 0;  i < seq->num_tasks;  i++)
+      if ((seq->failed_mask & mask & BOOT_TASK_BIT(i))
+        && (seq->tasks[i].flags & BOOT_TASK_OPTIONAL) == 0)
+         return (seq->tasks[i].rc);
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  boot_seq_require
+//
+//          Make sure one task is up (e.g. a lazy one, on its first use),
+//          running it and the tasks it depends on. Other tasks that are
+//          part way through keep going too. Returns 0 if it is up, else
+//          its failure code, or ERR_BOOT_TIMEOUT.
+//*****************************************************************************
+int  boot_seq_require (BOOT_SEQ *seq, int task_id, uint32_t timeout_ms)
+{
+    BOOT_TASK  *tp;
+    uint16_t   mask;
+    int        i, rc;
+
+    if (seq == 0L || task_id < 0 || task_id >= seq->num_tasks)
+       return (ERR_BOOT_INVALID_PARM);
+    tp = &seq->tasks [task_id];
+    if (tp->state == BOOT_STATE_UP)
+       return (0);                      // the usual case: already up
+
+    mask = boot_seq_with_deps (seq, BOOT_TASK_BIT(task_id));
+    for (i = 0;  i < seq->num_tasks;  i++)
+      if (seq->tasks[i].state == BOOT_STATE_RUNNING)
+         mask |= BOOT_TASK_BIT(i);      // don't stall anything in progress
+
+    rc = boot_seq_wait (seq, mask, timeout_ms);
+    if (tp->state == BOOT_STATE_UP)
+       return (0);
+    return ((tp->state == BOOT_STATE_FAILED) ? tp->rc : rc);
+}
+
+
+//*****************************************************************************
+//  boot_seq_poll
+//
+//          One non-blocking pass over the tasks in task_mask (and the tasks
+//          they depend on). For the main loop, to bring up lazy tasks in
+//          the background. Returns the # of them that are not done yet.
+//*****************************************************************************
+int  boot_seq_poll (BOOT_SEQ *seq, uint16_t task_mask)
+{
+    int   called;
+
+    if (seq == 0L || seq->tasks == 0L)
+       return (ERR_BOOT_INVALID_PARM);
+    return (boot_seq_pass (seq, boot_seq_with_deps(seq, task_mask), &called));
+}
+
+
+//*****************************************************************************
+//  boot_seq_is_up
+//*****************************************************************************
+int  boot_seq_is_up (BOOT_SEQ *seq, int task_id)
+{
+    if (seq == 0L || task_id < 0 || task_id >= seq->num_tasks)
+       return (0);
+    return ((seq->up_mask & BOOT_TASK_BIT(task_id)) != 0);
+}
+
+
+//*****************************************************************************
+//  boot_seq_save_state
+//
+//          Save one word of a task's device state, for its warm_step to
+//          restore after standby. Takes effect with the next boot_seq_commit().
+//*****************************************************************************
+int  boot_seq_save_state (BOOT_SEQ *seq, int task_id, uint32_t state)
+{
+    if (seq == 0L || task_id < 0 || task_id >= seq->num_tasks)
+       return (ERR_BOOT_INVALID_PARM);
+    return (sys_Backup_Write (BOOT_SEQ_BKP_FIRST + 1 + task_id, state));
+}
+
+
+//*****************************************************************************
+//  boot_seq_get_state
+//
+//          Warm boot only: get the word the task saved before standby.
+//          Returns ERR_BOOT_NO_STATE on a cold boot, or if the task was not
+//          up when boot_seq_commit() was called.
+//*****************************************************************************
+int  boot_seq_get_state (BOOT_SEQ *seq, int task_id, uint32_t *state)
+{
+    if (seq == 0L || task_id < 0 || task_id >= seq->num_tasks || state == 0L)
+       return (ERR_BOOT_INVALID_PARM);
+    if ( ! seq->warm || (seq->saved_mask & BOOT_TASK_BIT(task_id)) == 0)
+       return (ERR_BOOT_NO_STATE);
+    return (sys_Backup_Read (BOOT_SEQ_BKP_FIRST + 1 + task_id, state));
+}
+
+
+//*****************************************************************************
+//  boot_seq_commit
+//
+//          Call just before going into standby: marks the saved state valid,
+//          for the tasks that are up now, so the wakeup is a warm boot.
+//*****************************************************************************
+int  boot_seq_commit (BOOT_SEQ *seq)
+{
+    if (seq == 0L || seq->tasks == 0L)
+       return (ERR_BOOT_INVALID_PARM);
+    return (sys_Backup_Write (BOOT_SEQ_BKP_FIRST,
+                              BOOT_SEQ_BKP_MAGIC
+                              | ((uint32_t) seq->num_tasks << 16)
+                              | seq->up_mask));
+}
+
+//*****************************************************************************
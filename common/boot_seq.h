@@ -0,0 +1,187 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              boot_seq.h
+//
+//
+//  Definitions for the boot sequencer: runs the init of independent devices
+//  concurrently, with no RTOS.
+//
+//  Most device init time is spent waiting: a sensor's power-up / first
+//  conversion time, a radio's reset pulse. Instead of one blocking init
+//  call per device, in turn, each device is a BOOT_TASK whose step function
+//  does a short piece of its init and returns how long to wait before the
+//  next piece. The sequencer interleaves the tasks, so one device's waits
+//  overlap the others' work and waits:
+//
+//      static int  baro_init (BOOT_SEQ *seq, BOOT_TASK *task)
+//      {
+//          switch (task->phase++)
+//            { case 0:  if (BSP_PRESSURE_Init() != 0)
+//                          return (ERR_xxx);          task failed
+//                       return (BOOT_WAIT_MS(40));    first conversion
+//              default: return (BOOT_DONE);
+//            }
+//      }
+//
+//      BOOT_TASK  tasks[] = { { "baro", baro_init, 0L, 0L, 0, 0 },
+//                             { "imu",  imu_init,  0L, 0L, 0, BOOT_TASK_LAZY },
+//                             ... };
+//      boot_seq_init (&seq, tasks, 2);
+//      rc = boot_seq_run (&seq, 500);               all non-lazy tasks
+//      ...
+//      rc = boot_seq_require (&seq, IMU_TASK, 100); lazy: on first use
+//
+//  A task can depend on tasks listed ahead of it (depends = bit mask of
+//  task ids): it is not started until they are up, and fails if one fails.
+//
+//  Warm boot: when the board wakes from standby, and the App had called
+//  boot_seq_commit() before it went down, each task that was up at the
+//  commit runs its warm_step (if it has one) instead of its cold_step.
+//  Tasks that were not up then (e.g. a lazy one not used yet) get a cold
+//  init, as their device was never set up. A warm step can skip waits
+//  for devices that stayed powered, and restore its device state from a
+//  word saved in an RTC backup register (boot_seq_save_state() /
+//  boot_seq_get_state()).
+//
+//  Backup register layout (from BOOT_SEQ_BKP_FIRST):
+//      reg + 0         BOOT_SEQ_BKP_MAGIC | num_tasks << 16 | up task mask
+//      reg + 1 + n     task n's saved state word
+//
+//  With USES_BOOT_PROFILE, each task is a boot_prof step, from its first
+//  step call to when it is up, so the profile shows the overlap.
+//
+//  Limitations:
+//    - Up to BOOT_SEQ_MAX_TASKS (16) tasks.
+//    - Cooperative: a step that blocks (e.g. a BLE HCI command that waits
+//      for its reply) holds up the other tasks for that long.
+//    - Thread level only.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __BOOT_SEQ_H__
+#define __BOOT_SEQ_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+#define  BOOT_SEQ_MAX_TASKS        16
+
+                        // backup registers used - override in
+                        // project_config_parms.h if the App uses reg 0
+#if !defined(BOOT_SEQ_BKP_FIRST)
+#define  BOOT_SEQ_BKP_FIRST         0
+#endif
+#define  BOOT_SEQ_BKP_MAGIC        0xB0000000UL  /* top byte of reg + 0 */
+
+                        // the 1 ms clock used for waits, and how the CPU
+                        // idles when every task is waiting
+#if !defined(BOOT_SEQ_NOW_MS)
+#define  BOOT_SEQ_NOW_MS()         sys_Get_Time()
+#endif
+#if !defined(BOOT_SEQ_IDLE)
+#if defined(__CORTEX_M)
+#define  BOOT_SEQ_IDLE()           __WFI()       /* SysTick wakes us each ms */
+#else
+#define  BOOT_SEQ_IDLE()           do { } while (0)
+#endif
+#endif
+
+            // step function return values (negative = an ERR_xxx code: the
+            // task failed)
+#define  BOOT_DONE                  0            /* device is up             */
+#define  BOOT_WAIT_MS(ms)         (ms)           /* call again in ms (>= 1)  */
+#define  BOOT_YIELD        0x7FFFFFFF            /* call again, after the
+                                                    other tasks have a turn  */
+
+            // BOOT_TASK flags
+#define  BOOT_TASK_LAZY          0x01  /* not run by boot_seq_run(): started
+                                          by boot_seq_require()/_poll()   */
+#define  BOOT_TASK_OPTIONAL      0x02  /* a failure does not fail
+                                          boot_seq_run() (dependents do)  */
+
+            // task id -> mask bit, for depends and boot_seq_poll()
+#define  BOOT_TASK_BIT(id)        ((uint16_t) (1U << (id)))
+
+            // BOOT_TASK state
+#define  BOOT_STATE_IDLE            0
+#define  BOOT_STATE_RUNNING         1
+#define  BOOT_STATE_UP              2
+#define  BOOT_STATE_FAILED          3
+
+            // error codes are ERR_BOOT_xxx in user_api.h
+
+struct boot_seq_def;
+struct boot_task_def;
+
+typedef  int  (*BOOT_STEP_FUNC) (struct boot_seq_def *seq, struct boot_task_def *task);
+
+
+typedef struct boot_task_def             /* one device's init */
+   {
+       const char      *name;            // boot profile step name
+       BOOT_STEP_FUNC  cold_step;        // init from power on / reset
+       BOOT_STEP_FUNC  warm_step;        // init after standby, 0L = cold_step
+       void            *parm;            // free for the step function's use
+       uint16_t        depends;          // bit n = task n must be up first
+       uint8_t         flags;            // BOOT_TASK_xxx
+
+                                         // set by the sequencer
+       uint8_t         state;            // BOOT_STATE_xxx
+       uint8_t         phase;            // the step function's own state,
+                                         //   starts at 0: ++ it per piece
+       int             rc;               // failure code
+       uint32_t        wake_ms;          // don't call the step before this
+       int             prof_id;          // boot_prof step id
+   } BOOT_TASK;
+
+
+typedef struct boot_seq_def              /* sequencer state */
+   {
+       BOOT_TASK   *tasks;
+       uint8_t     num_tasks;
+       uint8_t     warm;                 // 1 = woke from standby, state valid
+       uint16_t    up_mask;              // bit n = task n is up
+       uint16_t    failed_mask;
+       uint16_t    saved_mask;           // warm: tasks with a saved state word
+       uint32_t    reset_cause;          // RESET_CAUSE_xxx flags
+   } BOOT_SEQ;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int   boot_seq_init (BOOT_SEQ *seq, BOOT_TASK *tasks, int num_tasks);
+int   boot_seq_run (BOOT_SEQ *seq, uint32_t timeout_ms);
+int   boot_seq_require (BOOT_SEQ *seq, int task_id, uint32_t timeout_ms);
+int   boot_seq_poll (BOOT_SEQ *seq, uint16_t task_mask);
+int   boot_seq_is_up (BOOT_SEQ *seq, int task_id);
+int   boot_seq_save_state (BOOT_SEQ *seq, int task_id, uint32_t state);
+int   boot_seq_get_state (BOOT_SEQ *seq, int task_id, uint32_t *state);
+int   boot_seq_commit (BOOT_SEQ *seq);
+
+#endif                          //  __BOOT_SEQ_H__
+
+//*****************************************************************************
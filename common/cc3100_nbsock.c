@@ -0,0 +1,337 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              cc3100_nbsock.c
+//
+//
+//  Non-blocking CC3100 (SimpleLink) socket layer.  See cc3100_nbsock.h
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "cc3100_nbsock.h"
+#include <string.h>
+
+    NBSOCK     _g_nbsock [NBSOCK_MAX_SOCKETS];
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static void  nbsock_set_timeval (SlTimeval_t *tv, int timeout_ms);
+
+
+//*****************************************************************************
+//  nbsock_open
+//
+//          Register a connected (or listening) socket, and switch it into
+//          SimpleLink non-blocking mode.
+//
+//          Returns 0 on success, or -1 with errno set.
+//*****************************************************************************
+int  nbsock_open (int sd)
+{
+    SlSockNonblocking_t  nb;
+    NBSOCK     *sock;
+    int        i;
+
+    if (sd < 0)
+       { errno = EBADF;
+         return (-1);
+       }
+
+    sock = nbsock_get (sd);             // re-open of same sd is harmless
+    for (i = 0;  sock == 0L && i < NBSOCK_MAX_SOCKETS;  i++)
+       if ( ! _g_nbsock[i].in_use)
+          sock = &_g_nbsock[i];
+    if (sock == 0L)
+       { errno = ENFILE;
+         return (-1);
+       }
+
+    nb.NonblockingEnabled = 1;
+    if (sl_SetSockOpt(sd, SL_SOL_SOCKET, SL_SO_NONBLOCKING, &nb, sizeof(nb)) < 0)
+       { errno = EINVAL;
+         return (-1);
+       }
+
+    memset (sock, 0, sizeof(NBSOCK));
+    sock->sd     = (int16_t) sd;
+    sock->in_use = 1;
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  nbsock_close
+//
+//          Close the socket, and drop it from the poll set.
+//*****************************************************************************
+int  nbsock_close (int sd)
+{
+    NBSOCK     *sock;
+
+    sock = nbsock_get (sd);
+    if (sock != 0L)
+       sock->in_use = 0;
+
+    return (sl_Close(sd) < 0 ? -1 : 0);
+}
+
+
+//*****************************************************************************
+//  nbsock_get
+//
+//          Find the table entry of a registered socket.  0L if not found.
+//*****************************************************************************
+NBSOCK  *nbsock_get (int sd)
+{
+    int        i;
+
+    for (i = 0;  i < NBSOCK_MAX_SOCKETS;  i++)
+       if (_g_nbsock[i].in_use  &&  _g_nbsock[i].sd == sd)
+          return (&_g_nbsock[i]);
+
+    return (0L);
+}
+
+
+//*****************************************************************************
+//  nbsock_poll
+//
+//          Issue a single sl_Select() across all registered sockets, and
+//          record which ones are ready. Called once per main loop pass.
+//          timeout_ms = 0 just samples the current state.
+//
+//          Returns the # of sockets ready, 0 if none, or -1 on error.
+//*****************************************************************************
+int  nbsock_poll (int timeout_ms)
+{
+    SlFdSet_t    rdset;
+    SlFdSet_t    wrset;
+    SlTimeval_t  tv;
+    NBSOCK       *sock;
+    int          max_sd;
+    int          rc;
+    int          i;
+
+    SL_FD_ZERO (&rdset);
+    SL_FD_ZERO (&wrset);
+    max_sd = -1;
+    for (i = 0;  i < NBSOCK_MAX_SOCKETS;  i++)
+      {
+        sock = &_g_nbsock[i];
+        if ( ! sock->in_use)
+           continue;
+        sock->ready &= NBSOCK_WANT_WRITE | NBSOCK_CLOSED;   // sticky flags
+        SL_FD_SET (sock->sd, &rdset);
+        if (sock->ready & NBSOCK_WANT_WRITE)
+           SL_FD_SET (sock->sd, &wrset);
+        if (sock->sd > max_sd)
+           max_sd = sock->sd;
+      }
+    if (max_sd < 0)
+       return (0);                      // nothing registered
+
+    nbsock_set_timeval (&tv, timeout_ms);
+    rc = sl_Select (max_sd + 1, &rdset, &wrset, 0L, &tv);
+    if (rc <= 0)
+       return (rc < 0 ? -1 : 0);
+
+    rc = 0;
+    for (i = 0;  i < NBSOCK_MAX_SOCKETS;  i++)
+      {
+        sock = &_g_nbsock[i];
+        if ( ! sock->in_use)
+           continue;
+        if (SL_FD_ISSET(sock->sd, &rdset))
+           sock->ready |= NBSOCK_READABLE;
+        if (SL_FD_ISSET(sock->sd, &wrset))
+           { sock->ready |= NBSOCK_WRITABLE;
+             sock->ready &= ~NBSOCK_WANT_WRITE;
+           }
+        if (sock->ready & (NBSOCK_READABLE | NBSOCK_WRITABLE))
+           rc++;
+      }
+
+    return (rc);
+}
+
+
+//*****************************************************************************
+//  nbsock_ready
+//
+//          Return the NBSOCK_xxx ready flags for a socket, as of the last
+//          nbsock_poll() (or recv/send on it since then).
+//*****************************************************************************
+int  nbsock_ready (int sd)
+{
+    NBSOCK     *sock;
+
+    sock = nbsock_get (sd);
+    if (sock == 0L)
+       return (NBSOCK_CLOSED);
+
+    return (sock->ready & (NBSOCK_READABLE | NBSOCK_WRITABLE | NBSOCK_CLOSED));
+}
+
+
+//*****************************************************************************
+//  nbsock_wait
+//
+//          Wait up to timeout_ms for ONE socket to become readable and/or
+//          writable (flags).  For callers such as the MQTT client that work
+//          with a bounded timeout.  Other sockets are not serviced meanwhile,
+//          so keep the timeout short.
+//
+//          Returns 1 if ready, 0 on timeout, or -1 on error.
+//*****************************************************************************
+int  nbsock_wait (int sd, int flags, int timeout_ms)
+{
+    SlFdSet_t    rdset;
+    SlFdSet_t    wrset;
+    SlTimeval_t  tv;
+    int          rc;
+
+    SL_FD_ZERO (&rdset);
+    SL_FD_ZERO (&wrset);
+    if (flags & NBSOCK_READABLE)
+       SL_FD_SET (sd, &rdset);
+    if (flags & NBSOCK_WRITABLE)
+       SL_FD_SET (sd, &wrset);
+
+    nbsock_set_timeval (&tv, timeout_ms);
+    rc = sl_Select (sd + 1, &rdset, &wrset, 0L, &tv);
+
+    return (rc < 0 ? -1 : (rc > 0));
+}
+
+
+//*****************************************************************************
+//  nbsock_recv
+//
+//          Read whatever data is waiting, up to max_length.  Never waits.
+//
+//          Returns # bytes read, 0 if the peer closed the connection, or
+//          -1 with errno = EAGAIN if no data is waiting, or another errno
+//          on a socket error.
+//*****************************************************************************
+int  nbsock_recv (int sd, unsigned char *buf, int max_length)
+{
+    NBSOCK     *sock;
+    int        rc;
+
+    sock = nbsock_get (sd);
+    if (sock == 0L || buf == 0L || max_length <= 0)
+       { errno = EBADF;
+         return (-1);
+       }
+
+    rc = sl_Recv (sd, buf, max_length, 0);
+    if (rc > 0)
+       { sock->rx_bytes += rc;
+         return (rc);
+       }
+
+    sock->ready &= ~NBSOCK_READABLE;
+    if (rc == SL_EAGAIN)
+       { sock->eagains++;
+         errno = EAGAIN;
+         return (-1);
+       }
+
+    sock->ready |= NBSOCK_CLOSED;
+    if (rc == 0)
+       return (0);                      // peer closed the connection
+
+    sock->last_error = (int16_t) rc;
+    errno = ECONNRESET;
+    return (-1);
+}
+
+
+//*****************************************************************************
+//  nbsock_send
+//
+//          Send as much of buf as the CC3100 has TX buffers for.  Never waits.
+//
+//          Returns # bytes sent (may be less than length), or -1 with
+//          errno = EAGAIN if nothing could be sent right now, or another
+//          errno on a socket error.  After a short/EAGAIN send, wait for
+//          NBSOCK_WRITABLE before sending the rest.
+//*****************************************************************************
+int  nbsock_send (int sd, unsigned char *buf, int length)
+{
+    NBSOCK     *sock;
+    int        rc;
+
+    sock = nbsock_get (sd);
+    if (sock == 0L || buf == 0L || length <= 0)
+       { errno = EBADF;
+         return (-1);
+       }
+
+    rc = sl_Send (sd, buf, length, 0);
+    if (rc > 0)
+       { sock->tx_bytes += rc;
+         if (rc < length)
+            { sock->ready &= ~NBSOCK_WRITABLE;
+              sock->ready |= NBSOCK_WANT_WRITE;
+            }
+         return (rc);
+       }
+
+    if (rc == SL_EAGAIN || rc == 0)
+       { sock->eagains++;
+         sock->ready &= ~NBSOCK_WRITABLE;
+         sock->ready |= NBSOCK_WANT_WRITE;
+         errno = EAGAIN;
+         return (-1);
+       }
+
+    sock->ready |= NBSOCK_CLOSED;
+    sock->last_error = (int16_t) rc;
+    errno = ECONNRESET;
+    return (-1);
+}
+
+
+//*****************************************************************************
+//  nbsock_set_timeval
+//
+//          Convert a ms timeout to a select timeval (tv_usec must stay
+//          below 1 second).
+//*****************************************************************************
+static void  nbsock_set_timeval (SlTimeval_t *tv, int timeout_ms)
+{
+    if (timeout_ms < 0)
+       timeout_ms = 0;
+    tv->tv_sec  = timeout_ms / 1000;
+    tv->tv_usec = (timeout_ms % 1000) * 1000;
+}
+
+//*****************************************************************************
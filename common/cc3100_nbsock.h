@@ -0,0 +1,108 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              cc3100_nbsock.h
+//
+//
+//  Definitions for the non-blocking CC3100 (SimpleLink) socket layer.
+//
+//  Every open TCP socket (MQTT, Modbus/TCP, a config channel, ...) is put
+//  into SimpleLink non-blocking mode and registered here. The main loop then
+//  issues ONE nbsock_poll() per pass, which does a single sl_Select() over
+//  all of them, and each protocol only touches the sockets that are ready.
+//  A stalled peer can no longer freeze the device:  reads and writes move
+//  whatever the CC3100 has room/data for, and report EAGAIN for the rest.
+//
+//  Typical main loop:
+//
+//      nbsock_poll (0);                            one sl_Select() per pass
+//      if (nbsock_ready(mqtt_sd) & NBSOCK_READABLE)
+//         ... MQTT processing
+//      if (nbsock_ready(modbus_sd) & NBSOCK_READABLE)
+//         ... Modbus processing
+//
+//  Return conventions  (same as POSIX / the mnet API):
+//      nbsock_recv():  > 0 = # bytes read,  0 = peer closed the connection,
+//                       -1 = errno set:  EAGAIN = no data right now.
+//      nbsock_send():  > 0 = # bytes sent (may be less than asked for),
+//                       -1 = errno set:  EAGAIN = no TX buffers right now.
+//
+//  Sockets that had a short or EAGAIN send are added to the sl_Select()
+//  write set, so NBSOCK_WRITABLE tells when to resume sending.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __CC3100_NBSOCK_H__
+#define __CC3100_NBSOCK_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+#include "simplelink.h"
+#include "socket.h"
+#include <errno.h>
+
+#ifndef NBSOCK_MAX_SOCKETS
+#define  NBSOCK_MAX_SOCKETS         8    /* CC3100 supports 8 open sockets    */
+#endif
+
+#ifndef SL_EAGAIN
+#define  SL_EAGAIN               (-11)   /* SimpleLink "try again" status     */
+#endif
+
+            // nbsock_ready() / nbsock_wait() flags
+#define  NBSOCK_READABLE         0x01    /* data (or a close) is waiting      */
+#define  NBSOCK_WRITABLE         0x02    /* TX buffers freed up               */
+#define  NBSOCK_CLOSED           0x04    /* peer closed, or socket error      */
+#define  NBSOCK_WANT_WRITE       0x08    /* internal: send was short/EAGAIN   */
+
+
+typedef struct nbsock_def                /* one registered socket */
+   {
+       int16_t    sd;                    // SimpleLink socket descriptor
+       uint8_t    in_use;
+       uint8_t    ready;                 // NBSOCK_xxx flags, from last poll
+       int16_t    last_error;            // last SimpleLink error status
+       uint32_t   rx_bytes;
+       uint32_t   tx_bytes;
+       uint32_t   eagains;               // # recv/send that had to wait
+   } NBSOCK;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int   nbsock_open (int sd);
+int   nbsock_close (int sd);
+int   nbsock_poll (int timeout_ms);
+int   nbsock_ready (int sd);
+int   nbsock_wait (int sd, int flags, int timeout_ms);
+int   nbsock_recv (int sd, unsigned char *buf, int max_length);
+int   nbsock_send (int sd, unsigned char *buf, int length);
+NBSOCK *nbsock_get (int sd);
+
+#endif                          //  __CC3100_NBSOCK_H__
+
+//*****************************************************************************
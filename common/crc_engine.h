@@ -0,0 +1,112 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              crc_engine.h
+//
+//
+//  Definitions for the unified CRC engine.
+//
+//  One API for the CRCs that the rest of the tree needs:
+//
+//      CRC_16_MODBUS   Modbus RTU frames    poly 0x8005 reflected, init 0xFFFF
+//      CRC_16_CCITT    radio frames, logs   poly 0x1021, init 0xFFFF (-FALSE)
+//      CRC_32          IDs, file images     poly 0x04C11DB7 reflected (zlib)
+//
+//  A CRC can be built up incrementally, across any number of non-contiguous
+//  chunks (e.g. a frame header, then a payload that lives somewhere else):
+//
+//      CRC_CTX  ctx;
+//      crc_init   (&ctx, CRC_16_MODBUS);
+//      crc_update (&ctx, hdr, 2);
+//      crc_update (&ctx, payload, payload_len);
+//      crc = crc_final (&ctx);
+//
+//  or in one shot:  crc = crc_compute (CRC_32, buf, length);
+//
+//  Where the MCU has a CRC unit (STM32, Tiva 129, MSP430), and the project
+//  defines USES_CRC_HW, crc_update() hands chunks of CRC_HW_MIN_LENGTH bytes
+//  or more to board_crc_hw_update(). The board layer seeds the unit with the
+//  context's running CRC, so any number of contexts can be interleaved, and
+//  (CRC_USES_DMA) feeds buffers of CRC_DMA_MIN_LENGTH or more to it by DMA.
+//  It returns how many bytes it did. Anything it did not do - an algorithm
+//  the unit does not support, the unit busy (an ISR CRC interrupted a thread
+//  level one), trailing bytes of a word fed unit - is done in software.
+//  Both give identical results.
+//
+//  Software CRCs use 256 entry byte tables (in flash). Defining
+//  CRC_SLICE_BY_8 switches to slice-by-8 (8 bytes per step), which is 3-5x
+//  faster, but builds an extra 7 tables per algorithm in RAM on first use:
+//  7 KB for CRC_32, 3.5 KB for each CRC-16. Use it on the larger MCUs only.
+//
+//  crc_self_test() runs the standard "123456789" check values through both
+//  the software and the hardware paths, in whole and split chunks.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __CRC_ENGINE_H__
+#define __CRC_ENGINE_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+            // CRC algorithms
+#define  CRC_16_MODBUS              0
+#define  CRC_16_CCITT               1
+#define  CRC_32                     2
+#define  CRC_NUM_ALGOS              3
+
+            // "123456789" check values, used by crc_self_test()
+#define  CRC_16_MODBUS_CHECK   0x4B37
+#define  CRC_16_CCITT_CHECK    0x29B1
+#define  CRC_32_CHECK          0xCBF43926UL
+
+#ifndef CRC_HW_MIN_LENGTH
+#define  CRC_HW_MIN_LENGTH         16    /* shorter chunks are faster in SW   */
+#endif
+#ifndef CRC_DMA_MIN_LENGTH
+#define  CRC_DMA_MIN_LENGTH       256    /* below this, CPU feed is faster    */
+#endif
+
+
+typedef struct crc_ctx_def               /* one CRC being built up */
+   {
+       uint32_t   crc;                   // running CRC register (not xor'ed out)
+       uint8_t    algo;                  // CRC_xxx
+       uint8_t    reflected;             // 1 = LSB first algorithm
+   } CRC_CTX;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int       crc_init (CRC_CTX *ctx, int algo);
+int       crc_update (CRC_CTX *ctx, const void *buf, int length);
+uint32_t  crc_final (CRC_CTX *ctx);
+uint32_t  crc_compute (int algo, const void *buf, int length);
+int       crc_self_test (void);
+
+#endif                          //  __CRC_ENGINE_H__
+
+//*****************************************************************************
@@ -0,0 +1,339 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              foc_engine.c
+//
+//
+//  Fixed point (Q15) Field Oriented Control engine.  See foc_engine.h
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "foc_engine.h"
+
+#define  Q15_INV_SQRT3        18919      /* 1/sqrt(3)   */
+#define  Q15_SQRT3_DIV2       28378      /* sqrt(3)/2   */
+
+                // sin() over one full turn, 256 steps + 1 wrap entry, Q15
+static const int16_t  foc_sin_tab [257] =
+   {
+          0,    804,   1608,   2410,   3212,   4011,   4808,   5602,   6393,   7179,
+       7962,   8739,   9512,  10278,  11039,  11793,  12539,  13279,  14010,  14732,
+      15446,  16151,  16846,  17530,  18204,  18868,  19519,  20159,  20787,  21403,
+      22005,  22594,  23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+      27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,  30273,  30571,
+      30852,  31113,  31356,  31580,  31785,  31971,  32137,  32285,  32412,  32521,
+      32609,  32678,  32728,  32757,  32767,  32757,  32728,  32678,  32609,  32521,
+      32412,  32285,  32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+      30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,  27245,  26790,
+      26319,  25832,  25329,  24811,  24279,  23731,  23170,  22594,  22005,  21403,
+      20787,  20159,  19519,  18868,  18204,  17530,  16846,  16151,  15446,  14732,
+      14010,  13279,  12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+       6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,      0,   -804,
+      -1608,  -2410,  -3212,  -4011,  -4808,  -5602,  -6393,  -7179,  -7962,  -8739,
+      -9512, -10278, -11039, -11793, -12539, -13279, -14010, -14732, -15446, -16151,
+     -16846, -17530, -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+     -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790, -27245, -27683,
+     -28105, -28510, -28898, -29268, -29621, -29956, -30273, -30571, -30852, -31113,
+     -31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678,
+     -32728, -32757, -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+     -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571, -30273, -29956,
+     -29621, -29268, -28898, -28510, -28105, -27683, -27245, -26790, -26319, -25832,
+     -25329, -24811, -24279, -23731, -23170, -22594, -22005, -21403, -20787, -20159,
+     -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+     -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,  -6393,  -5602,
+      -4808,  -4011,  -3212,  -2410,  -1608,   -804,      0
+   };
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static int16_t   foc_sat16 (int32_t value);
+static uint32_t  foc_isqrt (uint32_t value);
+
+
+//*****************************************************************************
+//  foc_init
+//
+//          Setup the control block. Both current loops use the same gains
+//          (the d and q axis inductances are the same for a surface magnet
+//          motor).  Starts with zero current references.
+//*****************************************************************************
+void  foc_init (FOC_CTL *foc, int16_t kp, int16_t ki, int16_t vmax)
+{
+    memset (foc, 0, sizeof(FOC_CTL));
+
+    foc->pi_d.kp = kp;
+    foc->pi_d.ki = ki;
+    foc->pi_q.kp = kp;
+    foc->pi_q.ki = ki;
+    foc->vmax    = (vmax > FOC_VMAX_LINEAR || vmax <= 0) ? FOC_VMAX_LINEAR : vmax;
+}
+
+
+//*****************************************************************************
+//  foc_set_current_ref
+//
+//          Set the d/q current references. Called from thread level (speed
+//          loop, App) - each is a single 16-bit store, so the ISR never sees
+//          a torn value.
+//*****************************************************************************
+void  foc_set_current_ref (FOC_CTL *foc, int16_t id_ref, int16_t iq_ref)
+{
+    foc->id_ref = id_ref;
+    foc->iq_ref = iq_ref;
+}
+
+
+//*****************************************************************************
+//  foc_reset
+//
+//          Clear the PI integrators, e.g. before re-enabling the PWM outputs
+//          after a stop or a fault.
+//*****************************************************************************
+void  foc_reset (FOC_CTL *foc)
+{
+    foc->pi_d.integ = 0;
+    foc->pi_q.integ = 0;
+    foc->vd         = 0;
+    foc->vq         = 0;
+}
+
+
+//*****************************************************************************
+//  foc_run
+//
+//          One FOC step. Called from the ADC (current sample) ISR, once per
+//          PWM period.  Leaves the new phase duty cycles in foc->duty[].
+//
+//          The d axis gets first call on the voltage:  vq is limited to
+//          whatever is left of the vmax circle, so field control is kept
+//          when the motor runs out of voltage at high speed.
+//*****************************************************************************
+void  foc_run (FOC_CTL *foc, int16_t ia, int16_t ib, uint16_t angle)
+{
+    int16_t    sin_val,  cos_val;
+    int16_t    vq_max;
+    int32_t    vd_sq;
+
+    foc_sin_cos (angle, &sin_val, &cos_val);
+    foc_clarke (ia, ib, &foc->i_alpha, &foc->i_beta);
+    foc_park (foc->i_alpha, foc->i_beta, sin_val, cos_val, &foc->id, &foc->iq);
+
+    foc->vd = foc_pi_run (&foc->pi_d, foc_sat16((int32_t) foc->id_ref - foc->id),
+                          foc->vmax);
+
+    vd_sq  = (int32_t) foc->vmax * foc->vmax - (int32_t) foc->vd * foc->vd;
+    vq_max = (int16_t) foc_isqrt ((uint32_t) vd_sq);
+    foc->vq = foc_pi_run (&foc->pi_q, foc_sat16((int32_t) foc->iq_ref - foc->iq),
+                          vq_max);
+    if (foc->vq == vq_max || foc->vq == -vq_max)
+       foc->v_limited++;
+
+    foc_inv_park (foc->vd, foc->vq, sin_val, cos_val,
+                  &foc->v_alpha, &foc->v_beta);
+    foc_svpwm (foc->v_alpha, foc->v_beta, foc->duty);
+
+    foc->steps++;
+}
+
+
+//*****************************************************************************
+//  foc_sin_cos
+//
+//          sin and cos of an electrical angle, from a 256 step table with
+//          linear interpolation (error < 0.0002).
+//*****************************************************************************
+void  foc_sin_cos (uint16_t angle, int16_t *sin_val, int16_t *cos_val)
+{
+    uint16_t   idx,  frac;
+    int16_t    a,  b;
+
+    idx  = angle >> 8;
+    frac = angle & 0xFF;
+    a    = foc_sin_tab [idx];
+    b    = foc_sin_tab [idx + 1];
+    *sin_val = a + (int16_t) (((int32_t) (b - a) * frac) >> 8);
+
+    angle += 16384;                     // cos(x) = sin(x + 90 degrees)
+    idx  = angle >> 8;
+    a    = foc_sin_tab [idx];
+    b    = foc_sin_tab [idx + 1];
+    *cos_val = a + (int16_t) (((int32_t) (b - a) * frac) >> 8);
+}
+
+
+//*****************************************************************************
+//  foc_clarke
+//
+//          Phase currents to the stationary alpha/beta frame. Only 2 phases
+//          are measured: ic = -(ia + ib) for a balanced (star) motor.
+//              alpha = ia
+//              beta  = (ia + 2*ib) / sqrt(3)
+//*****************************************************************************
+void  foc_clarke (int16_t ia, int16_t ib, int16_t *alpha, int16_t *beta)
+{
+    *alpha = ia;
+    *beta  = foc_sat16 ((((int32_t) ia + 2 * (int32_t) ib) * Q15_INV_SQRT3) >> 15);
+}
+
+
+//*****************************************************************************
+//  foc_park
+//
+//          alpha/beta to the rotor d/q frame.
+//              d =  alpha*cos + beta*sin
+//              q = -alpha*sin + beta*cos
+//*****************************************************************************
+void  foc_park (int16_t alpha, int16_t beta, int16_t sin_val, int16_t cos_val,
+                int16_t *d, int16_t *q)
+{
+    *d = foc_sat16 (((int32_t) alpha * cos_val + (int32_t) beta * sin_val) >> 15);
+    *q = foc_sat16 (((int32_t) beta * cos_val - (int32_t) alpha * sin_val) >> 15);
+}
+
+
+//*****************************************************************************
+//  foc_inv_park
+//
+//          d/q voltages back to the alpha/beta frame.
+//              alpha = d*cos - q*sin
+//              beta  = d*sin + q*cos
+//*****************************************************************************
+void  foc_inv_park (int16_t d, int16_t q, int16_t sin_val, int16_t cos_val,
+                    int16_t *alpha, int16_t *beta)
+{
+    *alpha = foc_sat16 (((int32_t) d * cos_val - (int32_t) q * sin_val) >> 15);
+    *beta  = foc_sat16 (((int32_t) d * sin_val + (int32_t) q * cos_val) >> 15);
+}
+
+
+//*****************************************************************************
+//  foc_svpwm
+//
+//          Space vector PWM, done as min/max (common mode) injection:
+//          the 3 phase voltages from an inverse Clarke are shifted so that
+//          the highest and lowest are centered on 50 % duty. That gives the
+//          same switching pattern as sector based SVPWM, with 15 % more
+//          linear voltage range than plain sine PWM, and needs no sector
+//          lookup or divides.
+//*****************************************************************************
+void  foc_svpwm (int16_t v_alpha, int16_t v_beta, uint16_t *duty)
+{
+    int32_t    va,  vb,  vc;
+    int32_t    vmax,  vmin,  offset;
+    int32_t    d;
+    int        i;
+    int32_t    v [3];
+
+    va = v_alpha;                                     // inverse Clarke
+    vb = (-(int32_t) v_alpha >> 1) + (((int32_t) v_beta * Q15_SQRT3_DIV2) >> 15);
+    vc = (-(int32_t) v_alpha >> 1) - (((int32_t) v_beta * Q15_SQRT3_DIV2) >> 15);
+
+    vmax = va > vb ? va : vb;
+    vmax = vmax > vc ? vmax : vc;
+    vmin = va < vb ? va : vb;
+    vmin = vmin < vc ? vmin : vc;
+    offset = FOC_DUTY_HALF - ((vmax + vmin) >> 1);    // center between rails
+
+    v[0] = va;   v[1] = vb;   v[2] = vc;
+    for (i = 0;  i < 3;  i++)
+      { d = v[i] + offset;
+        duty[i] = (uint16_t) (d < 0 ? 0 : (d > FOC_Q15_ONE ? FOC_Q15_ONE : d));
+      }
+}
+
+
+//*****************************************************************************
+//  foc_pi_run
+//
+//          One PI step, output limited to +/- limit. Anti-windup by
+//          clamping: the integrator is held within the limit, so it does
+//          not have to unwind after a saturation.
+//*****************************************************************************
+int16_t  foc_pi_run (FOC_PI *pi, int16_t error, int16_t limit)
+{
+    int32_t    out;
+    int32_t    integ_max;
+
+    integ_max  = (int32_t) limit << 12;               // limit, as Q27
+    pi->integ += (int32_t) pi->ki * error;
+    if (pi->integ > integ_max)
+       pi->integ = integ_max;
+       else if (pi->integ < -integ_max)
+               pi->integ = -integ_max;
+
+    out = (((int32_t) pi->kp * error) + pi->integ) >> 12;
+    if (out > limit)
+       out = limit;
+       else if (out < -limit)
+               out = -limit;
+
+    return ((int16_t) out);
+}
+
+
+//*****************************************************************************
+//  foc_sat16
+//
+//          Saturate to the int16_t (Q15) range.
+//*****************************************************************************
+static int16_t  foc_sat16 (int32_t value)
+{
+    if (value > 32767)
+       return (32767);
+    if (value < -32768)
+       return (-32768);
+    return ((int16_t) value);
+}
+
+
+//*****************************************************************************
+//  foc_isqrt
+//
+//          Integer square root (bit by bit, 16 steps, no divides).
+//*****************************************************************************
+static uint32_t  foc_isqrt (uint32_t value)
+{
+    uint32_t   root,  bit,  trial;
+
+    root = 0;
+    for (bit = 1UL << 30;  bit > value;  bit >>= 2)
+       ;
+    for ( ;  bit != 0;  bit >>= 2)
+      { trial = root + bit;
+        root >>= 1;
+        if (value >= trial)
+           { value -= trial;
+             root  += bit;
+           }
+      }
+
+    return (root);
+}
+
+//*****************************************************************************
@@ -0,0 +1,120 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              foc_engine.h
+//
+//
+//  Definitions for the fixed point (Q15) Field Oriented Control engine,
+//  used to run BLDC / PMSM motors from the PWM rate ADC interrupt.
+//
+//  Each PWM period, foc_run() takes 2 phase currents and the rotor's
+//  electrical angle, and produces the 3 PWM duty cycles:
+//
+//      ia,ib --> Clarke --> Park --> PI (d,q) --> inverse Park --> SVPWM
+//                                     ^ id_ref, iq_ref                |
+//                                                          duty[0..2] v
+//
+//  Units (all Q15, i.e. 32767 = 1.0):
+//      currents    1.0 = ADC full scale current (the shunt amp's +/- range)
+//      voltages    1.0 = Vbus.  Linear SVPWM range is |v| <= 1/sqrt(3),
+//                  so vmax is limited to FOC_VMAX_LINEAR.
+//      duty        0 = low side on all period, 32767 = high side on
+//      angle       uint16_t, 65536 = 360 electrical degrees
+//
+//  PI gains are Q12 (4096 = 1.0), in per unit volts per per unit amp:
+//      kp = Kp[V/A] * I_fullscale / Vbus
+//      ki = Ki[V/(A*s)] * Tpwm * I_fullscale / Vbus
+//  e.g. for a current loop bandwidth of wc rad/sec:  Kp = L*wc,  Ki = R*wc.
+//
+//  The engine is pure integer math with no HAL dependencies, so it runs as
+//  is in a host simulation. The board layer (board_STM32_bldc.c) supplies
+//  the timer/ADC plumbing, and calls foc_run() from the ADC ISR.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __FOC_ENGINE_H__
+#define __FOC_ENGINE_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+#define  FOC_Q15_ONE            32767
+#define  FOC_Q12_ONE             4096
+#define  FOC_VMAX_LINEAR        18918    /* 1/sqrt(3): max linear SVPWM |v|   */
+#define  FOC_DUTY_HALF          16384    /* 50 % duty = zero phase voltage    */
+
+
+typedef struct foc_pi_def                /* one PI current controller */
+   {
+       int16_t    kp;                    // proportional gain, Q12
+       int16_t    ki;                    // integral gain per step, Q12
+       int32_t    integ;                 // integrator, Q27 (Q15 * Q12)
+   } FOC_PI;
+
+
+typedef struct foc_ctl_def               /* FOC control block, one per motor */
+   {
+       FOC_PI     pi_d;                  // flux (d axis) current loop
+       FOC_PI     pi_q;                  // torque (q axis) current loop
+       int16_t    id_ref;                // d axis current reference (0 = no field weakening)
+       int16_t    iq_ref;                // q axis (torque) current reference
+       int16_t    vmax;                  // max |(vd,vq)|, <= FOC_VMAX_LINEAR
+
+                                         // ---- results of the last foc_run() ----
+       int16_t    i_alpha;
+       int16_t    i_beta;
+       int16_t    id;
+       int16_t    iq;
+       int16_t    vd;
+       int16_t    vq;
+       int16_t    v_alpha;
+       int16_t    v_beta;
+       uint16_t   duty [3];              // phase A/B/C duty cycles, Q15
+       uint32_t   steps;                 // # foc_run() calls
+       uint32_t   v_limited;             // # steps the voltage vector was clamped
+   } FOC_CTL;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+void     foc_init (FOC_CTL *foc, int16_t kp, int16_t ki, int16_t vmax);
+void     foc_set_current_ref (FOC_CTL *foc, int16_t id_ref, int16_t iq_ref);
+void     foc_reset (FOC_CTL *foc);
+void     foc_run (FOC_CTL *foc, int16_t ia, int16_t ib, uint16_t angle);
+
+                     // building blocks, also used standalone (e.g. open loop V/f)
+void     foc_sin_cos (uint16_t angle, int16_t *sin_val, int16_t *cos_val);
+void     foc_clarke (int16_t ia, int16_t ib, int16_t *alpha, int16_t *beta);
+void     foc_park (int16_t alpha, int16_t beta, int16_t sin_val, int16_t cos_val,
+                   int16_t *d, int16_t *q);
+void     foc_inv_park (int16_t d, int16_t q, int16_t sin_val, int16_t cos_val,
+                       int16_t *alpha, int16_t *beta);
+void     foc_svpwm (int16_t v_alpha, int16_t v_beta, uint16_t *duty);
+int16_t  foc_pi_run (FOC_PI *pi, int16_t error, int16_t limit);
+
+#endif                          //  __FOC_ENGINE_H__
+
+//*****************************************************************************
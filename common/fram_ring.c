@@ -0,0 +1,301 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              fram_ring.c
+//
+//
+//  Crash-safe FRAM sample Ring.   See fram_ring.h for the layout, and the
+//  header commit rules.
+//
+//  Typical DMA usage (see board_adc_fram_log_start() on MSP430 FRxxxx):
+//
+//      fram_ring_open (...);
+//      DMA dest = fram_ring_dma_addr (ring, 0);    block to fill first
+//
+//      DMA ISR, once ring->block_samples have been moved into the block:
+//          next = fram_ring_commit (ring, stamp);
+//          if (next == 0L)  stop the DMA          (STOP_WHEN_FULL ring)
+//             else point the DMA dest at next
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "fram_ring.h"
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static int   fram_ring_slot_valid (FRAM_RING *ring, volatile FRAM_RING_HDR *slot);
+static void  fram_ring_write_hdr (FRAM_RING *ring);
+
+
+//*****************************************************************************
+//  fram_ring_open
+//
+//          Attach to a FRAM region. If it holds a valid ring with the same
+//          geometry, its contents are recovered, and logging will resume
+//          right after the last committed block. Otherwise the ring is
+//          formatted empty.
+//
+//          block_samples must be a multiple of channels. The region must
+//          hold at least FRAM_RING_MIN_BLOCKS blocks, plus the 2 headers.
+//
+//          Returns:  FRAM_RING_RECOVERED, FRAM_RING_FORMATTED, or
+//                    ERR_FRAM_RING_INVALID_PARM
+//*****************************************************************************
+int  fram_ring_open (FRAM_RING *ring, void *region, uint32_t region_bytes,
+                     int block_samples, int channels, int flags)
+{
+    volatile FRAM_RING_HDR  *slot;
+    uint32_t   num_blocks;
+    int        valid0;
+    int        valid1;
+
+    if (ring == 0L || region == 0L || channels < 1 || channels > 32
+       || block_samples < channels || (block_samples % channels) != 0
+       || region_bytes < 2 * sizeof(FRAM_RING_HDR))
+       return (ERR_FRAM_RING_INVALID_PARM);
+
+    num_blocks = (region_bytes - 2 * sizeof(FRAM_RING_HDR))
+               / ((uint32_t) block_samples * sizeof(uint16_t));
+    if (num_blocks < FRAM_RING_MIN_BLOCKS)
+       return (ERR_FRAM_RING_INVALID_PARM);
+    if (num_blocks > 0xFFFF)
+       num_blocks = 0xFFFF;
+
+    ring->hdr           = (volatile FRAM_RING_HDR*) region;
+    ring->blocks        = (uint16_t*) ((FRAM_RING_HDR*) region + 2);
+    ring->block_samples = (uint16_t) block_samples;
+    ring->num_blocks    = (uint16_t) num_blocks;
+    ring->channels      = (uint8_t) channels;
+    ring->flags         = (uint8_t) (flags & FRAM_RING_STOP_WHEN_FULL);
+    ring->full          = 0;
+
+         //--------------------------------------------------------------
+         // pick the newest valid header slot, if any
+         //--------------------------------------------------------------
+    valid0 = fram_ring_slot_valid (ring, &ring->hdr[0]);
+    valid1 = fram_ring_slot_valid (ring, &ring->hdr[1]);
+    slot   = 0L;
+    if (valid0 && valid1)
+       slot = ((int32_t) (ring->hdr[1].seq - ring->hdr[0].seq) > 0)
+            ? &ring->hdr[1] : &ring->hdr[0];
+       else if (valid0)
+               slot = &ring->hdr[0];
+       else if (valid1)
+               slot = &ring->hdr[1];
+
+    if (slot != 0L && (flags & FRAM_RING_FORCE_FORMAT) == 0)
+       { ring->head       = slot->head;
+         ring->count      = slot->count;
+         ring->wraps      = slot->wraps;
+         ring->last_stamp = slot->last_stamp;
+         ring->seq        = slot->seq;
+         if ((ring->flags & FRAM_RING_STOP_WHEN_FULL)
+            && ring->count >= ring->num_blocks - FRAM_RING_DMA_BLOCKS)
+            ring->full = 1;
+         return (FRAM_RING_RECOVERED);
+       }
+
+         //--------------------------------------------------------------
+         // format.  If a header survives with a different geometry, keep
+         // its sequence going, but start the ring over at block 0.
+         //--------------------------------------------------------------
+    if (slot == 0L)
+       {     // geometry checks failed: look for any completely written slot
+         if (ring->hdr[0].magic == FRAM_RING_MAGIC
+            && ring->hdr[0].seq_chk == ~ring->hdr[0].seq)
+            slot = &ring->hdr[0];
+         if (ring->hdr[1].magic == FRAM_RING_MAGIC
+            && ring->hdr[1].seq_chk == ~ring->hdr[1].seq
+            && (slot == 0L || (int32_t) (ring->hdr[1].seq - slot->seq) > 0))
+            slot = &ring->hdr[1];
+       }
+    ring->head       = 0;
+    ring->count      = 0;
+    ring->wraps      = 0;
+    ring->last_stamp = 0;
+    ring->seq        = (slot != 0L) ? slot->seq : 0;
+    fram_ring_write_hdr (ring);
+    fram_ring_write_hdr (ring);         // both slots now agree
+
+    return (FRAM_RING_FORMATTED);
+}
+
+
+//*****************************************************************************
+//  fram_ring_clear
+//
+//          Discard all logged blocks.  The write position is left where it
+//          is (wear levelling), only the valid block count is reset.
+//          The DMA must not be running.
+//*****************************************************************************
+int  fram_ring_clear (FRAM_RING *ring)
+{
+    if (ring == 0L || ring->hdr == 0L)
+       return (ERR_FRAM_RING_INVALID_PARM);
+
+    ring->count = 0;
+    ring->full  = 0;
+    fram_ring_write_hdr (ring);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  fram_ring_dma_addr
+//
+//          Return the address of the block blocks_ahead past the head.
+//          0 = the block the DMA is to fill (the head).
+//*****************************************************************************
+uint16_t  *fram_ring_dma_addr (FRAM_RING *ring, int blocks_ahead)
+{
+    uint32_t   blk;
+
+    blk = ((uint32_t) ring->head + (uint32_t) blocks_ahead) % ring->num_blocks;
+
+    return (ring->blocks + blk * ring->block_samples);
+}
+
+
+//*****************************************************************************
+//  fram_ring_commit
+//
+//          The head block has been completely filled by the DMA. Add it to
+//          the ring and make it crash-safe. Called from the DMA ISR.
+//
+//          Returns the address of the block the DMA should fill next, or 0L
+//          if a STOP_WHEN_FULL ring just became full and the DMA should be
+//          stopped.
+//*****************************************************************************
+uint16_t  *fram_ring_commit (FRAM_RING *ring, uint32_t stamp)
+{
+    uint16_t   max_count;
+
+    if (ring->full)
+       return (0L);
+
+    max_count = ring->num_blocks - FRAM_RING_DMA_BLOCKS;
+    if (ring->count < max_count)
+       ring->count++;                   // else oldest block was overwritten
+
+    ring->head++;
+    if (ring->head >= ring->num_blocks)
+       { ring->head = 0;
+         ring->wraps++;
+       }
+    ring->last_stamp = stamp;
+
+    fram_ring_write_hdr (ring);
+
+    if ((ring->flags & FRAM_RING_STOP_WHEN_FULL) && ring->count >= max_count)
+       { ring->full = 1;
+         return (0L);
+       }
+
+    return (fram_ring_dma_addr(ring, 0));
+}
+
+
+//*****************************************************************************
+//  fram_ring_read
+//
+//          Get a committed block. index 0 is the oldest block in the ring,
+//          count-1 the newest.
+//
+//          Returns:  # samples in the block, or ERR_FRAM_RING_NO_DATA if
+//                    index is past the newest committed block.
+//*****************************************************************************
+int  fram_ring_read (FRAM_RING *ring, int index, uint16_t **block)
+{
+    uint32_t   blk;
+
+    if (ring == 0L || block == 0L || index < 0)
+       return (ERR_FRAM_RING_INVALID_PARM);
+
+    if (index >= ring->count)
+       return (ERR_FRAM_RING_NO_DATA);
+
+    blk = ((uint32_t) ring->head + ring->num_blocks - ring->count + index)
+        % ring->num_blocks;
+    *block = ring->blocks + blk * ring->block_samples;
+
+    return (ring->block_samples);
+}
+
+
+//*****************************************************************************
+//  fram_ring_slot_valid
+//
+//          A slot is usable if it was completely written (seq_chk == ~seq),
+//          and describes the same ring geometry we are opening with.
+//*****************************************************************************
+static int  fram_ring_slot_valid (FRAM_RING *ring, volatile FRAM_RING_HDR *slot)
+{
+    if (slot->magic != FRAM_RING_MAGIC  ||  slot->seq_chk != ~slot->seq)
+       return (0);
+
+    if (slot->block_samples != ring->block_samples
+       || slot->num_blocks != ring->num_blocks
+       || slot->channels != ring->channels
+       || slot->head >= ring->num_blocks
+       || slot->count > ring->num_blocks - FRAM_RING_DMA_BLOCKS)
+       return (0);
+
+    return (1);
+}
+
+
+//*****************************************************************************
+//  fram_ring_write_hdr
+//
+//          Write the current state into the older header slot:  invalidate
+//          it, fill in the fields, then seq, and finally ~seq.
+//*****************************************************************************
+static void  fram_ring_write_hdr (FRAM_RING *ring)
+{
+    volatile FRAM_RING_HDR  *slot;
+
+    ring->seq++;
+    slot = &ring->hdr [ring->seq & 1];
+
+    slot->seq_chk       = slot->seq;    // never == ~seq:  slot is now invalid
+    slot->magic         = FRAM_RING_MAGIC;
+    slot->block_samples = ring->block_samples;
+    slot->num_blocks    = ring->num_blocks;
+    slot->channels      = ring->channels;
+    slot->flags         = ring->flags;
+    slot->head          = ring->head;
+    slot->count         = ring->count;
+    slot->wraps         = ring->wraps;
+    slot->last_stamp    = ring->last_stamp;
+    slot->seq           = ring->seq;
+    slot->seq_chk       = ~ring->seq;   // commit
+}
+
+//*****************************************************************************
@@ -0,0 +1,125 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              fram_ring.h
+//
+//
+//  Definitions for the crash-safe FRAM sample Ring.
+//
+//  A region of non-volatile FRAM is split into 2 header slots, followed by
+//  a ring of fixed size sample blocks. The DMA streams ADC results directly
+//  into the ring blocks. Each time a block fills, the DMA ISR calls
+//  fram_ring_commit(), which advances the ring and writes a new header.
+//
+//  Crash safety:
+//    - headers are written to the 2 slots alternately. A header is first
+//      invalidated, then its fields are written, and then it is made valid
+//      again by writing seq followed by ~seq. If power is lost part way
+//      through, that slot simply fails validation, and recovery falls back
+//      to the other slot, which still describes the previous block.
+//    - a block only becomes part of the ring when its header commit has
+//      completed, so a partially DMA'ed block is never reported.
+//    - the block the DMA is filling is never counted as valid data, so the
+//      ring can wrap over its oldest block without ever reporting a half
+//      overwritten one.
+//
+//  Wear:
+//    FRAM endurance is very high, but the header is the hot spot, so it is
+//    spread over 2 slots. Re-opening (or clearing) a ring never rewinds the
+//    write position back to block 0 - logging always resumes at the head -
+//    so every block sees the same number of writes.
+//
+//  The ring logic (fram_ring.c) is pure C, with no HAL dependencies, so it
+//  can be built on a host against a RAM array standing in for FRAM.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __FRAM_RING_H__
+#define __FRAM_RING_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+#define  FRAM_RING_MAGIC        0xFA1E   /* marks an initialized header slot   */
+#define  FRAM_RING_DMA_BLOCKS        1   /* block owned by the DMA (filling)   */
+#define  FRAM_RING_MIN_BLOCKS        2
+
+            // Valid values for flags on fram_ring_open()
+#define  FRAM_RING_OVERWRITE    0x0000   /* wrap over oldest blocks (default)  */
+#define  FRAM_RING_STOP_WHEN_FULL 0x0001 /* one-shot burst: stop once full     */
+#define  FRAM_RING_FORCE_FORMAT 0x0002   /* discard any existing ring contents */
+
+            // Return codes from fram_ring_open()
+#define  FRAM_RING_FORMATTED         0   /* no valid header: started empty     */
+#define  FRAM_RING_RECOVERED         1   /* existing ring contents recovered   */
+
+
+typedef struct fram_ring_hdr_def        /* one header slot, lives in FRAM */
+   {
+       uint16_t   magic;                // FRAM_RING_MAGIC
+       uint16_t   block_samples;        // # 16-bit samples per block
+       uint16_t   num_blocks;           // # blocks in the ring
+       uint8_t    channels;             // # ADC channels interleaved per frame
+       uint8_t    flags;                // FRAM_RING_xxx flags at format time
+       uint16_t   head;                 // block the DMA is filling
+       uint16_t   count;                // # committed, valid blocks before head
+       uint32_t   wraps;                // # times head wrapped back to block 0
+       uint32_t   last_stamp;           // App timestamp of last committed block
+       uint32_t   seq;                  // commit sequence number
+       uint32_t   seq_chk;              // ~seq: written last, validates slot
+   } FRAM_RING_HDR;
+
+
+typedef struct fram_ring_def            /* Ring control block, lives in RAM */
+   {
+       volatile FRAM_RING_HDR  *hdr;    // the 2 header slots, in FRAM
+       uint16_t   *blocks;              // start of block area, in FRAM
+       uint16_t   block_samples;        // # 16-bit samples per block
+       uint16_t   num_blocks;           // # blocks in the ring
+       uint8_t    channels;             // # ADC channels per frame
+       uint8_t    flags;                // FRAM_RING_xxx
+       uint8_t    full;                 // 1 = STOP_WHEN_FULL ring is full
+
+       uint16_t   head;                 // current copy of committed state
+       uint16_t   count;
+       uint32_t   wraps;
+       uint32_t   last_stamp;
+       uint32_t   seq;
+   } FRAM_RING;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int       fram_ring_open (FRAM_RING *ring, void *region, uint32_t region_bytes,
+                          int block_samples, int channels, int flags);
+int       fram_ring_clear (FRAM_RING *ring);
+uint16_t *fram_ring_dma_addr (FRAM_RING *ring, int blocks_ahead);
+uint16_t *fram_ring_commit (FRAM_RING *ring, uint32_t stamp);
+int       fram_ring_read (FRAM_RING *ring, int index, uint16_t **block);
+
+#endif                          //  __FRAM_RING_H__
+
+//*****************************************************************************
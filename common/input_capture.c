@@ -0,0 +1,396 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              input_capture.c
+//
+//
+//  DMA based Input Capture engine: frequency, period, and pulse width (duty)
+//  measurement from a ring buffer of DMA'ed timer capture values.
+//
+//  The board layer (e.g. board_timerpwm_capture_update() on STM32) passes in
+//  the total number of entries the DMA has written so far, plus the current
+//  raw counter value. Everything else is done here:
+//
+//    - counter extension:  the 16/32 bit counter and each capture value are
+//                          extended to 64 bits, by accumulating the modulo
+//                          difference from the previous value.
+//    - lost edges:         if the DMA got more than a full ring ahead, the
+//                          oldest entries are skipped and counted as lost.
+//    - edge polarity:      in BOTH_EDGES mode, the polarity of an entry is
+//                          given by the parity of its absolute ring index,
+//                          so it survives lost edges.
+//    - window stats:       min/max/avg period, frequency and duty, published
+//                          each N periods and/or each N microseconds.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "input_capture.h"
+
+
+#define  ICAP_DEFAULT_WINDOW_DIV   10   // default window = 1/10 second
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static void  icap_process_edge (ICAP_ENGINE *icap, uint64_t edge_ts, int rising);
+static void  icap_publish_window (ICAP_ENGINE *icap, uint64_t end_ts);
+static void  icap_clear_window (ICAP_ENGINE *icap);
+
+
+//*****************************************************************************
+//  icap_init
+//
+//          Setup an Input Capture engine over a DMA ring buffer.
+//
+//          ring must be uint16_t [ring_size], or uint32_t [ring_size] if
+//          ICAP_32_BIT_COUNTER is set. tick_hz is the rate the timer counter
+//          runs at (after its prescaler).
+//
+//          The default window is 1/10 second. Use icap_set_window() to change.
+//*****************************************************************************
+int  icap_init (ICAP_ENGINE *icap, void *ring, int ring_size,
+                uint32_t tick_hz, int flags)
+{
+    if (ring == 0L || ring_size < 2 || ring_size > 32768 || tick_hz == 0)
+       return (ERR_TIMER_CAPTURE_INVALID_PARM);
+    if ((flags & ICAP_BOTH_EDGES) && (flags & ICAP_EVENT_DIV_MASK))
+       return (ERR_TIMER_CAPTURE_INVALID_PARM);   // h/w prescaler loses polarity
+
+    memset (icap, 0, sizeof(ICAP_ENGINE));
+
+    icap->ring      = ring;
+    icap->ring_size = (uint16_t) ring_size;
+    icap->flags     = (uint16_t) flags;
+    icap->tick_hz   = tick_hz;
+    icap->event_div = (uint8_t) (1 << ((flags & ICAP_EVENT_DIV_MASK) >> 4));
+
+    if (flags & ICAP_32_BIT_COUNTER)
+       icap->counter_mask = 0xFFFFFFFF;
+       else icap->counter_mask = 0x0000FFFF;
+
+    icap_set_window (icap, 0, 1000000L / ICAP_DEFAULT_WINDOW_DIV);
+
+    icap_reset (icap);
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  icap_set_window
+//
+//          Set when a stats window is closed and published: after num_periods
+//          periods, or after window_usec microseconds of periods, whichever
+//          comes first. Either can be 0 to disable it (but not both).
+//
+//          The window length also sets the stall timeout: if no edges arrive
+//          for two windows (or a full counter rollover, if shorter), the
+//          signal is declared stalled and a zero frequency is published.
+//*****************************************************************************
+int  icap_set_window (ICAP_ENGINE *icap, int num_periods, uint32_t window_usec)
+{
+    uint64_t   ticks;
+
+    if (num_periods < 0 || num_periods > 65535
+       || (num_periods == 0 && window_usec == 0))
+       return (ERR_TIMER_CAPTURE_INVALID_PARM);
+
+    ticks = ((uint64_t) icap->tick_hz * window_usec) / 1000000L;
+    if (ticks > 0xFFFFFFFF || (window_usec != 0 && ticks == 0))
+       return (ERR_TIMER_CAPTURE_INVALID_PARM);
+
+    icap->window_periods = (uint16_t) num_periods;
+    icap->window_ticks   = (uint32_t) ticks;
+
+    icap->stall_ticks = icap->counter_mask;
+    if (ticks != 0 && (ticks * 2) < icap->stall_ticks)
+       icap->stall_ticks = (uint32_t) (ticks * 2);
+
+    icap_clear_window (icap);
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  icap_reset
+//
+//          Discard all partial measurements and published stats. The ring
+//          position is kept, so the engine stays in step with the DMA.
+//*****************************************************************************
+void  icap_reset (ICAP_ENGINE *icap)
+{
+    icap->chain_valid  = 0;
+    icap->period_valid = 0;
+    icap->high_valid   = 0;
+    icap->stats_ready  = 0;
+    memset (&icap->stats, 0, sizeof(ICAP_STATS));
+
+    icap_clear_window (icap);
+}
+
+
+//*****************************************************************************
+//  icap_update
+//
+//          Process all capture values the DMA has written since the last call.
+//
+//          produced_total is the total # of entries the DMA has written into
+//          the ring since it was started (it is allowed to wrap at 2^32).
+//          counter_now is the timer's current raw CNT value.
+//
+//          Returns the # of new edges processed.
+//*****************************************************************************
+int  icap_update (ICAP_ENGINE *icap, uint32_t produced_total, uint32_t counter_now)
+{
+    uint32_t   new_entries;
+    uint32_t   capture;
+    uint32_t   index;
+    uint64_t   edge_ts;
+    int        rising;
+    int        count;
+
+       //-------------------------------------------------------------------
+       // Extend the raw counter to 64 bits. This requires that we are
+       // called at least once per counter rollover.
+       //-------------------------------------------------------------------
+    icap->now_ts    += (counter_now - icap->last_count) & icap->counter_mask;
+    icap->last_count = counter_now;
+
+    new_entries = produced_total - icap->consumed;
+    if (new_entries > icap->ring_size)
+       {     // DMA lapped us. Skip the overwritten entries, and restart the
+             // timestamp chain at the oldest entry still in the ring.
+         icap->edges_lost  += (new_entries - icap->ring_size);
+         icap->consumed    += (new_entries - icap->ring_size);
+         icap->ring_index   = (uint16_t) ((icap->ring_index
+                                + (new_entries - icap->ring_size)) % icap->ring_size);
+         new_entries        = icap->ring_size;
+         icap->chain_valid  = 0;
+         icap->period_valid = 0;
+         icap->high_valid   = 0;
+       }
+
+    for (count = 0;  count < (int) new_entries;  count++)
+      {
+        index = icap->ring_index;
+        if (icap->flags & ICAP_32_BIT_COUNTER)
+           capture = ((uint32_t*) icap->ring) [index];
+           else capture = ((uint16_t*) icap->ring) [index];
+
+        if (icap->chain_valid)
+           {   // forward from the previous edge (edges < 1 rollover apart)
+             edge_ts = icap->last_edge_ts
+                     + ((capture - icap->last_capture) & icap->counter_mask);
+           }
+          else
+           {   // no previous edge: anchor backwards from "now"
+             edge_ts = icap->now_ts
+                     - ((counter_now - capture) & icap->counter_mask);
+           }
+
+        rising = 1;
+        if (icap->flags & ICAP_BOTH_EDGES)
+           {      // even entries are the first polarity, odd the other
+             rising = ((icap->consumed & 1) == 0);
+             if (icap->flags & ICAP_FIRST_EDGE_FALLING)
+                rising = ! rising;
+           }
+
+        icap_process_edge (icap, edge_ts, rising);
+
+        icap->last_capture = capture;
+        icap->last_edge_ts = edge_ts;
+        icap->chain_valid  = 1;
+        icap->consumed++;
+        icap->edges_total++;
+        if (++icap->ring_index >= icap->ring_size)
+           icap->ring_index = 0;
+      }
+
+       //-------------------------------------------------------------------
+       // If the signal has gone quiet for longer than the stall time,
+       // publish a zero frequency, and start a fresh chain on the next edge.
+       //-------------------------------------------------------------------
+    if (icap->chain_valid && (icap->now_ts - icap->last_edge_ts) > icap->stall_ticks)
+       {
+         icap->stalls++;
+         icap->chain_valid  = 0;
+         icap->period_valid = 0;
+         icap->high_valid   = 0;
+         icap_clear_window (icap);                 // discard partial window
+         icap_publish_window (icap, icap->now_ts); // publishes freq = 0
+       }
+
+    return (count);
+}
+
+
+//*****************************************************************************
+//  icap_get_stats
+//
+//          Copy out the stats of the last completed window.
+//
+//          Return code:  1 = new stats since the last call,  0 = no change
+//*****************************************************************************
+int  icap_get_stats (ICAP_ENGINE *icap, ICAP_STATS *stats)
+{
+    int   ready;
+
+    memcpy (stats, &icap->stats, sizeof(ICAP_STATS));
+    ready = icap->stats_ready;
+    icap->stats_ready = 0;
+
+    return (ready);
+}
+
+
+//*****************************************************************************
+//  icap_get_last_edge
+//
+//          Return the 64-bit timestamp (in timer ticks) of the latest edge.
+//*****************************************************************************
+uint64_t  icap_get_last_edge (ICAP_ENGINE *icap)
+{
+    return (icap->last_edge_ts);
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+//                         INTERNAL   Routines
+//*****************************************************************************
+//*****************************************************************************
+
+//*****************************************************************************
+//  icap_process_edge
+//
+//          Fold one timestamped edge into the current window.
+//          Periods are measured between rising edges (or between every
+//          captured edge when only one polarity is captured).
+//*****************************************************************************
+static void  icap_process_edge (ICAP_ENGINE *icap, uint64_t edge_ts, int rising)
+{
+    uint64_t   delta;
+    uint32_t   period;
+
+    if ( ! rising)
+       {     // falling edge: high time = time since the period started
+         if (icap->period_valid)
+            { delta = edge_ts - icap->last_period_ts;
+              icap->high_ticks = (delta > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) delta;
+              icap->high_valid = 1;
+            }
+         return;
+       }
+
+    if (icap->period_valid)
+       {
+         delta  = edge_ts - icap->last_period_ts;
+         period = (delta > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) delta;
+         if (icap->w_periods == 0)
+            icap->w_start_ts = icap->last_period_ts;
+         icap->w_periods++;
+         icap->w_ticks += period;
+         period = period / icap->event_div;       // per input edge, not capture
+         if (period < icap->w_min)
+            icap->w_min = period;
+         if (period > icap->w_max)
+            icap->w_max = period;
+         if (icap->high_valid)
+            { icap->w_high_ticks        += icap->high_ticks;
+              icap->w_high_period_ticks += delta;
+            }
+       }
+
+    icap->last_period_ts = edge_ts;
+    icap->period_valid   = 1;
+    icap->high_valid     = 0;
+
+    if ((icap->window_periods != 0 && icap->w_periods >= icap->window_periods)
+       || (icap->window_ticks != 0 && icap->w_ticks >= icap->window_ticks))
+       icap_publish_window (icap, edge_ts);
+}
+
+
+//*****************************************************************************
+//  icap_publish_window
+//
+//          Compute the stats for the current window, make them available to
+//          icap_get_stats(), and start a new window. An empty window yields
+//          all zeros (stalled).
+//*****************************************************************************
+static void  icap_publish_window (ICAP_ENGINE *icap, uint64_t end_ts)
+{
+    ICAP_STATS   *stp;
+    uint64_t     edges;
+    uint64_t     work;
+
+    stp = &icap->stats;
+    memset (stp, 0, sizeof(ICAP_STATS));
+    stp->window_end_ts = end_ts;
+
+    if (icap->w_periods != 0 && icap->w_ticks != 0)
+       {
+         edges = (uint64_t) icap->w_periods * icap->event_div;
+         stp->period_count     = (uint32_t) edges;
+         stp->period_avg_ticks = (uint32_t) (icap->w_ticks / edges);
+         stp->period_min_ticks = icap->w_min;
+         stp->period_max_ticks = icap->w_max;
+
+         work = (edges * icap->tick_hz * 1000) / icap->w_ticks;
+         stp->freq_millihz = (work > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) work;
+
+         if (icap->w_high_period_ticks != 0)
+            stp->duty_centi_pct = (uint16_t) ((icap->w_high_ticks * 10000)
+                                              / icap->w_high_period_ticks);
+
+         work = ((end_ts - icap->w_start_ts) * 1000) / icap->tick_hz;
+         stp->window_ms = (work > 0xFFFF) ? 0xFFFF : (uint16_t) work;
+       }
+
+    icap->stats_ready = 1;
+
+    icap_clear_window (icap);
+}
+
+
+//*****************************************************************************
+//  icap_clear_window
+//*****************************************************************************
+static void  icap_clear_window (ICAP_ENGINE *icap)
+{
+    icap->w_periods           = 0;
+    icap->w_ticks             = 0;
+    icap->w_min               = 0xFFFFFFFF;
+    icap->w_max               = 0;
+    icap->w_high_ticks        = 0;
+    icap->w_high_period_ticks = 0;
+}
+
+//*****************************************************************************
@@ -0,0 +1,139 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              input_capture.h
+//
+//
+//  Definitions for the DMA based Input Capture engine.
+//
+//  The timer's capture register (CCRx) is DMA'ed, in circular mode, into a
+//  ring buffer on every captured edge. No CPU work is done per edge. The App
+//  (or a periodic vtimer callback) calls timer_Capture_Update(), which walks
+//  the new ring entries, extends the 16/32 bit captures to 64-bit timestamps,
+//  and accumulates period / frequency / duty statistics over a window of
+//  N periods and/or a fixed time span.
+//
+//  The engine itself (input_capture.c) is pure integer math and has no HAL
+//  dependencies; the board layer just supplies the DMA write position and
+//  the current counter value on each update.
+//
+//  Limitations:
+//    - timer_Capture_Update() must be called at least once per counter
+//      rollover (65536 ticks for 16-bit timers, ~50 secs for 32-bit TIM2/TIM5
+//      at 84 MHz), and at least once per ring buffer's worth of edges. Edges
+//      the DMA overwrites before they are processed are counted in
+//      edges_lost, and the period chain restarts after them.
+//    - edges further apart than one counter rollover are treated as a stall
+//      (i.e. signal is below the lowest measurable frequency).
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __INPUT_CAPTURE_H__
+#define __INPUT_CAPTURE_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+            // Valid values for flags on icap_init() / timer_Capture_Start()
+#define  ICAP_RISING_EDGE        0x0000  /* capture rising edges only (default)*/
+#define  ICAP_FALLING_EDGE       0x0001  /* capture falling edges only         */
+#define  ICAP_BOTH_EDGES         0x0002  /* capture both edges: enables duty   */
+#define  ICAP_FIRST_EDGE_FALLING 0x0004  /* BOTH_EDGES: 1st DMA'ed edge is a fall */
+#define  ICAP_EVENT_DIV_2        0x0010  /* h/w input prescaler: every 2nd edge */
+#define  ICAP_EVENT_DIV_4        0x0020  /* h/w input prescaler: every 4th edge */
+#define  ICAP_EVENT_DIV_8        0x0030  /* h/w input prescaler: every 8th edge */
+#define  ICAP_EVENT_DIV_MASK     0x0030
+#define  ICAP_32_BIT_COUNTER     0x0100  /* CCR is 32 bits (TIM2/TIM5)         */
+
+
+typedef struct icap_stats_def           /* Stats for one completed window */
+   {
+       uint32_t   period_count;         // # full periods seen in the window
+       uint32_t   period_avg_ticks;     // average period, in timer ticks
+       uint32_t   period_min_ticks;     // shortest period in window
+       uint32_t   period_max_ticks;     // longest  period in window
+       uint32_t   freq_millihz;         // frequency, in 0.001 Hz  (0 = stalled)
+       uint16_t   duty_centi_pct;       // BOTH_EDGES: high time, 0.01 % units
+       uint16_t   window_ms;            // actual length of the window
+       uint64_t   window_end_ts;        // 64-bit timestamp of last edge in window
+   } ICAP_STATS;
+
+
+typedef struct icap_engine_def          /* Input Capture engine state */
+   {
+       void       *ring;                // DMA ring buffer  (uint16_t or uint32_t)
+       uint16_t   ring_size;            // # entries in the ring buffer
+       uint16_t   flags;                // ICAP_xxx flags
+       uint8_t    event_div;            // edges per capture  (1, 2, 4, 8)
+       uint8_t    chain_valid;          // 1 = last_edge_ts is a valid start point
+       uint8_t    period_valid;         // 1 = last_period_ts is valid
+       uint8_t    stats_ready;          // 1 = new stats not yet read by App
+       uint32_t   counter_mask;         // 0xFFFF or 0xFFFFFFFF
+       uint32_t   tick_hz;              // timer counter tick rate, after PSC
+
+       uint32_t   consumed;             // total # ring entries processed
+       uint16_t   ring_index;           // ring index of next entry to process
+       uint32_t   last_count;           // raw counter value at last update
+       uint64_t   now_ts;               // 64-bit counter value at last update
+       uint32_t   last_capture;         // raw capture value of last edge
+       uint64_t   last_edge_ts;         // 64-bit timestamp of last edge
+       uint64_t   last_period_ts;       // timestamp that started last period
+       uint32_t   high_ticks;           // BOTH_EDGES: high time of current period
+       uint8_t    high_valid;           // BOTH_EDGES: high_ticks is valid
+
+       uint16_t   window_periods;       // close window after N periods (0=off)
+       uint32_t   window_ticks;         // close window after N ticks   (0=off)
+       uint32_t   stall_ticks;          // no edges for this long = stalled
+
+       uint32_t   w_periods;            // current window: # periods
+       uint64_t   w_ticks;              // current window: sum of periods
+       uint32_t   w_min;                // current window: min period
+       uint32_t   w_max;                // current window: max period
+       uint64_t   w_high_ticks;         // current window: sum of high times
+       uint64_t   w_high_period_ticks;  // current window: periods with a high time
+       uint64_t   w_start_ts;           // current window: start timestamp
+
+       ICAP_STATS stats;                // last completed window
+
+       uint32_t   edges_total;          // total # edges processed
+       uint32_t   edges_lost;           // # edges overwritten before processing
+       uint32_t   stalls;               // # times signal was declared stalled
+   } ICAP_ENGINE;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int  icap_init (ICAP_ENGINE *icap, void *ring, int ring_size,
+                uint32_t tick_hz, int flags);
+int  icap_set_window (ICAP_ENGINE *icap, int num_periods, uint32_t window_usec);
+int  icap_update (ICAP_ENGINE *icap, uint32_t produced_total, uint32_t counter_now);
+int  icap_get_stats (ICAP_ENGINE *icap, ICAP_STATS *stats);
+uint64_t icap_get_last_edge (ICAP_ENGINE *icap);
+void icap_reset (ICAP_ENGINE *icap);
+
+#endif                          //  __INPUT_CAPTURE_H__
+
+//*****************************************************************************
@@ -0,0 +1,391 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              lat_trace.c
+//
+//
+//  End-to-end latency tracing: per-stage stamps, and on-device histograms
+//  with percentiles. See lat_trace.h
+//
+//  Stamps are raw counter ticks. They are only turned into usec (a Q32
+//  multiply, like timestamp.c) when a finished sample is added into the
+//  histograms, so a stamp costs one counter read.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "lat_trace.h"
+#include <string.h>
+
+#if !defined(LAT_TRACE_NOW)
+#error "LAT_TRACE_NOW() must be defined: this board has no timestamp service (USES_TIMESTAMP)"
+#endif
+
+#if LAT_HIST_SUB_BITS < 0 || LAT_HIST_SUB_BITS > 4 || LAT_HIST_MAX_LOG2 > 31 || LAT_HIST_MAX_LOG2 <= LAT_HIST_SUB_BITS
+#error "LAT_HIST_SUB_BITS must be 0-4, and LAT_HIST_MAX_LOG2 in (LAT_HIST_SUB_BITS, 31]"
+#endif
+
+#define  LAT_SUB_COUNT    (1UL << LAT_HIST_SUB_BITS)
+
+
+typedef struct lat_hist_def              /* one latency histogram */
+   {
+       uint32_t   count;
+       uint32_t   min_usec;
+       uint32_t   max_usec;
+       uint64_t   sum_usec;
+       uint32_t   buckets [LAT_HIST_BUCKETS];
+   } LAT_HIST;
+
+
+typedef struct lat_trace_state_def       /* tracing state */
+   {
+       uint32_t   usec_per_tick_q32;     // 0 = lat_trace_init() not done
+       uint16_t   next_seq;
+       uint32_t   incomplete;            // closed with no stage past SAMPLE
+       LAT_TRACE  *current;              // stamped by lat_trace_stamp_current
+       LAT_TRACE  worst;                 // slowest end-to-end sample
+       LAT_HIST   hist [LAT_NUM_STAGES];
+   } LAT_TRACE_STATE;
+
+static LAT_TRACE_STATE   _g_lat;
+
+                        // key used for each histogram by lat_trace_encode()
+static const char  * const _g_lat_names [LAT_NUM_STAGES] =
+                                   { "e2e", "proc", "enc", "pub", "xmit" };
+
+
+//*****************************************************************************
+//  lat_hist_index
+//
+//          Bucket for a latency. Values below 2^SUB_BITS get a bucket each;
+//          above that, each power of 2 is split into 2^SUB_BITS buckets,
+//          using the SUB_BITS bits below the leading 1.
+//*****************************************************************************
+static int  lat_hist_index (uint32_t usec)
+{
+    int   msb;
+
+    if (usec < LAT_SUB_COUNT)
+       return ((int) usec);
+    if (usec >= (1UL << LAT_HIST_MAX_LOG2))
+       return (LAT_HIST_BUCKETS - 1);          // clamp into the top bucket
+
+    for (msb = LAT_HIST_SUB_BITS;  (usec >> (msb + 1)) != 0;  msb++)
+      ;
+    return ((int) (((msb - LAT_HIST_SUB_BITS + 1) << LAT_HIST_SUB_BITS)
+                 + ((usec >> (msb - LAT_HIST_SUB_BITS)) & (LAT_SUB_COUNT - 1))));
+}
+
+
+//*****************************************************************************
+//  lat_hist_upper
+//
+//          Largest latency that falls in a bucket.
+//*****************************************************************************
+static uint32_t  lat_hist_upper (int idx)
+{
+    int       shift;
+    uint32_t  sub;
+
+    if (idx < (int) LAT_SUB_COUNT)
+       return ((uint32_t) idx);
+    shift = (idx >> LAT_HIST_SUB_BITS) - 1;
+    sub   = LAT_SUB_COUNT + (idx & (LAT_SUB_COUNT - 1));
+    return (((sub + 1) << shift) - 1);
+}
+
+
+//*****************************************************************************
+//  lat_hist_add
+//*****************************************************************************
+static void  lat_hist_add (LAT_HIST *hp, uint32_t ticks)
+{
+    uint32_t  usec;
+
+    usec = (uint32_t) (((uint64_t) ticks * _g_lat.usec_per_tick_q32 + 0x80000000UL) >> 32);
+
+    if (hp->count == 0 || usec < hp->min_usec)
+       hp->min_usec = usec;
+    if (usec > hp->max_usec)
+       hp->max_usec = usec;
+    hp->count++;
+    hp->sum_usec += usec;
+    hp->buckets [lat_hist_index(usec)]++;
+}
+
+
+//*****************************************************************************
+//  lat_trace_init
+//
+//          tick_hz is the rate of the counter LAT_TRACE_NOW() reads
+//          (LAT_TRACE_TICK_HZ). It must be at least 1 MHz.
+//*****************************************************************************
+int  lat_trace_init (uint32_t tick_hz)
+{
+    if (tick_hz < 1000000UL)
+       return (ERR_LAT_TRACE_INVALID_PARM);
+
+    memset (&_g_lat, 0, sizeof(_g_lat));
+    _g_lat.usec_per_tick_q32 = (uint32_t) ((1000000ULL << 32) / tick_hz);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  lat_trace_reset
+//
+//          Clear the histograms (e.g. after each report).
+//*****************************************************************************
+void  lat_trace_reset (void)
+{
+    memset (_g_lat.hist, 0, sizeof(_g_lat.hist));
+    memset (&_g_lat.worst, 0, sizeof(_g_lat.worst));
+    _g_lat.incomplete = 0;
+}
+
+
+//*****************************************************************************
+//  lat_trace_begin
+//
+//          Start a sample's record. origin_ticks is the SAMPLE stamp: the
+//          low 32 bits of the tick count an ISR took when the data was
+//          captured (e.g. adc_Get_Frame_Ticks()), or LAT_TRACE_NOW().
+//*****************************************************************************
+void  lat_trace_begin (LAT_TRACE *trc, uint32_t origin_ticks)
+{
+    memset (trc, 0, sizeof(LAT_TRACE));
+    trc->seq     = _g_lat.next_seq++;
+    trc->stamp [LAT_STAGE_SAMPLE] = origin_ticks;
+    trc->stamped = (1 << LAT_STAGE_SAMPLE);
+}
+
+
+//*****************************************************************************
+//  lat_trace_stamp
+//
+//          Stamp a stage with the current count. The first stamp of a stage
+//          is the one that counts, so a layer that runs more than once for a
+//          sample (e.g. a retried write) does not move it.
+//*****************************************************************************
+void  lat_trace_stamp (LAT_TRACE *trc, int stage)
+{
+    if (trc == 0L || stage < 0 || stage >= LAT_NUM_STAGES
+         || (trc->stamped & (1 << stage)))
+       return;
+
+    trc->stamp [stage] = LAT_TRACE_NOW();
+    trc->stamped      |= (1 << stage);
+}
+
+
+//*****************************************************************************
+//  lat_trace_set_current / lat_trace_stamp_current
+//
+//          Stages deep in the MQTT layer stamp whatever sample the App said
+//          it is sending. 0L = none (those stamps are ignored).
+//*****************************************************************************
+void  lat_trace_set_current (LAT_TRACE *trc)
+{
+    _g_lat.current = trc;
+}
+
+void  lat_trace_stamp_current (int stage)
+{
+    lat_trace_stamp (_g_lat.current, stage);
+}
+
+
+//*****************************************************************************
+//  lat_trace_close
+//
+//          The sample is done: add each stamped stage's latency, from the
+//          stage stamped before it, and the end-to-end latency, into the
+//          histograms. Stages that were not stamped are skipped.
+//*****************************************************************************
+void  lat_trace_close (LAT_TRACE *trc)
+{
+    uint32_t  e2e;
+    int       stage, prev;
+
+    if (_g_lat.current == trc)
+       _g_lat.current = 0L;
+    if (trc == 0L || _g_lat.usec_per_tick_q32 == 0)
+       return;
+    if ((trc->stamped & (1 << LAT_STAGE_SAMPLE)) == 0)
+       { _g_lat.incomplete++;
+         return;
+       }
+
+    prev = LAT_STAGE_SAMPLE;
+    for (stage = LAT_STAGE_SAMPLE + 1;  stage < LAT_NUM_STAGES;  stage++)
+      { if ((trc->stamped & (1 << stage)) == 0)
+           continue;
+        lat_hist_add (&_g_lat.hist[stage], trc->stamp[stage] - trc->stamp[prev]);
+        prev = stage;
+      }
+    if (prev == LAT_STAGE_SAMPLE)
+       { _g_lat.incomplete++;           // nothing past the origin
+         return;
+       }
+
+    e2e = trc->stamp[prev] - trc->stamp[LAT_STAGE_SAMPLE];
+    lat_hist_add (&_g_lat.hist[LAT_HIST_END_TO_END], e2e);
+    if (_g_lat.worst.stamped == 0
+        || e2e > _g_lat.worst.stamp[_g_lat.worst.flags] - _g_lat.worst.stamp[LAT_STAGE_SAMPLE])
+       { _g_lat.worst       = *trc;
+         _g_lat.worst.flags = (uint8_t) prev;   // remember its last stage
+       }
+}
+
+
+//*****************************************************************************
+//  lat_trace_get_percentile
+//
+//          Latency (usec) that per_mille / 1000 of the samples were at or
+//          under (500 = median, 990 = p99). It is the top of the bucket the
+//          sample falls in, limited to the max seen. 0 if no samples.
+//*****************************************************************************
+uint32_t  lat_trace_get_percentile (int hist, int per_mille)
+{
+    LAT_HIST  *hp;
+    uint32_t  rank, seen, upper;
+    int       i;
+
+    if (hist < 0 || hist >= LAT_NUM_STAGES || per_mille < 0 || per_mille > 1000)
+       return (0);
+    hp = &_g_lat.hist[hist];
+    if (hp->count == 0)
+       return (0);
+
+    rank = (uint32_t) (((uint64_t) hp->count * per_mille + 999) / 1000);
+    if (rank == 0)
+       rank = 1;
+    for (seen = 0, i = 0;  i < LAT_HIST_BUCKETS;  i++)
+      { seen += hp->buckets[i];
+        if (seen >= rank)
+           break;
+      }
+
+    upper = lat_hist_upper (i);
+    if (upper > hp->max_usec)
+       upper = hp->max_usec;
+    if (upper < hp->min_usec)
+       upper = hp->min_usec;
+    return (upper);
+}
+
+
+//*****************************************************************************
+//  lat_trace_get_stats
+//
+//          Summary of a histogram: LAT_HIST_END_TO_END, or a LAT_STAGE_xxx.
+//*****************************************************************************
+int  lat_trace_get_stats (int hist, LAT_STATS *stats)
+{
+    LAT_HIST  *hp;
+
+    if (hist < 0 || hist >= LAT_NUM_STAGES || stats == 0L)
+       return (ERR_LAT_TRACE_INVALID_PARM);
+
+    hp = &_g_lat.hist[hist];
+    stats->count     = hp->count;
+    stats->min_usec  = hp->min_usec;
+    stats->max_usec  = hp->max_usec;
+    stats->mean_usec = (hp->count == 0) ? 0 : (uint32_t) (hp->sum_usec / hp->count);
+    stats->p50_usec  = lat_trace_get_percentile (hist, 500);
+    stats->p90_usec  = lat_trace_get_percentile (hist, 900);
+    stats->p99_usec  = lat_trace_get_percentile (hist, 990);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  lat_trace_get_worst
+//
+//          Copy out the record of the slowest end-to-end sample since the
+//          last reset, with all its stage stamps. Returns 0, or 1 if there
+//          has not been one.
+//*****************************************************************************
+int  lat_trace_get_worst (LAT_TRACE *trc)
+{
+    if (trc == 0L)
+       return (ERR_LAT_TRACE_INVALID_PARM);
+    if (_g_lat.worst.stamped == 0)
+       return (1);
+
+    *trc       = _g_lat.worst;
+    trc->flags = 0;
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  lat_trace_encode
+//
+//          Encode the stats as one telemetry codec map (usec):
+//
+//            {"n":samples, "inc":incomplete,
+//             "e2e":[count,min,p50,p90,p99,max], "proc":[...], "enc":[...],
+//             "pub":[...], "xmit":[...]}
+//
+//          Histograms with no samples are left out. The caller does the
+//          tcodec_enc_init() / tcodec_enc_finish().
+//*****************************************************************************
+void  lat_trace_encode (TCODEC_ENC *enc)
+{
+    LAT_STATS  st;
+    int        hist, pairs;
+
+    for (pairs = 2, hist = 0;  hist < LAT_NUM_STAGES;  hist++)
+      if (_g_lat.hist[hist].count != 0)
+         pairs++;
+
+    tcodec_enc_map_begin (enc, pairs);
+    tcodec_enc_key  (enc, "n");
+    tcodec_enc_uint (enc, _g_lat.next_seq);
+    tcodec_enc_key  (enc, "inc");
+    tcodec_enc_uint (enc, _g_lat.incomplete);
+
+    for (hist = 0;  hist < LAT_NUM_STAGES;  hist++)
+      { lat_trace_get_stats (hist, &st);
+        if (st.count == 0)
+           continue;
+        tcodec_enc_key (enc, _g_lat_names[hist]);
+        tcodec_enc_array_begin (enc, 6);
+        tcodec_enc_uint (enc, st.count);
+        tcodec_enc_uint (enc, st.min_usec);
+        tcodec_enc_uint (enc, st.p50_usec);
+        tcodec_enc_uint (enc, st.p90_usec);
+        tcodec_enc_uint (enc, st.p99_usec);
+        tcodec_enc_uint (enc, st.max_usec);
+        tcodec_enc_array_end (enc);
+      }
+    tcodec_enc_map_end (enc);
+}
+
+//*****************************************************************************
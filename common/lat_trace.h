@@ -0,0 +1,157 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              lat_trace.h
+//
+//
+//  Definitions for end-to-end (sensor to broker) latency tracing.
+//
+//  Each sample carries a small LAT_TRACE record. As the sample moves down
+//  the pipeline, each stage stamps the record with the timestamp counter
+//  (DWT CYCCNT on Cortex-M3/M4/M7, see timestamp.h):
+//
+//      LAT_STAGE_SAMPLE    ADC DMA frame done  (DMA ISR frame timestamp)
+//      LAT_STAGE_PROCESS   process image updated  (sensor_read_process)
+//      LAT_STAGE_ENCODE    payload serialized  (tcodec_enc_finish)
+//      LAT_STAGE_PUBLISH   MQTT PUBLISH packet built  (in MQTTPublish)
+//      LAT_STAGE_XMIT      transport write done  (w5200_write/cc3100_write
+//                          returned, in MQTTPublish)
+//
+//  When the sample is done, lat_trace_close() adds each stage's latency
+//  (from the previous stamped stage), and the end-to-end latency (from
+//  SAMPLE to the last stamped stage), into on-device histograms:
+//
+//      lat_trace_begin (&trc, adc_frame_ticks);      origin = the DMA ISR stamp
+//      ... update process image ...
+//      lat_trace_stamp (&trc, LAT_STAGE_PROCESS);
+//      len = encode_payload ();
+//      lat_trace_stamp (&trc, LAT_STAGE_ENCODE);
+//      lat_trace_set_current (&trc);                 MQTTPublish stamps the rest
+//      rc = MQTTPublish (&client, topic, &msg);
+//      lat_trace_close (&trc);
+//
+//  The MQTT layer has no idea what sample it is sending, so it stamps the
+//  "current" record, set with lat_trace_set_current(). lat_trace_close()
+//  clears it.
+//
+//  Histograms are log-linear (HDR style): 2^LAT_HIST_SUB_BITS buckets per
+//  power of 2 usec, so a percentile is within 1/2^LAT_HIST_SUB_BITS (25%
+//  by default) of the true value, at any scale, from 1 usec to ~16 secs,
+//  with no division or floating point on the record path.
+//
+//  lat_trace_encode() writes count / min / p50 / p90 / p99 / max of every
+//  stage through the telemetry codec: JSON for the console, or JSON / CBOR
+//  for an MQTT diagnostics topic.
+//
+//  Limitations:
+//    - Stamps are the low 32 bits of the timestamp counter: no one sample
+//      may take longer than 2^32 ticks (~19 secs at 216 MHz).
+//    - Thread level only (the main loop). The ISR's part is the SAMPLE
+//      stamp it already takes, which is passed in to lat_trace_begin().
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __LAT_TRACE_H__
+#define __LAT_TRACE_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+#include "telemetry_codec.h"        // stats are exported as CBOR / JSON
+
+                        // sizing - override in project_config_parms.h
+#if !defined(LAT_HIST_SUB_BITS)
+#define  LAT_HIST_SUB_BITS          2    /* 4 buckets per power of 2: +/- 25% */
+#endif
+#if !defined(LAT_HIST_MAX_LOG2)
+#if defined(__MSP430__)
+#define  LAT_HIST_MAX_LOG2         20    /* top bucket starts at ~1 sec       */
+#else
+#define  LAT_HIST_MAX_LOG2         24    /* top bucket starts at ~16 secs     */
+#endif
+#endif
+#define  LAT_HIST_BUCKETS  ((LAT_HIST_MAX_LOG2 - LAT_HIST_SUB_BITS + 1) << LAT_HIST_SUB_BITS)
+
+                        // the counter that is stamped, and its rate
+#if !defined(LAT_TRACE_NOW) && defined(sys_Get_Timestamp_Ticks)
+#define  LAT_TRACE_NOW()        ((uint32_t) sys_Get_Timestamp_Ticks())
+#endif
+#if !defined(LAT_TRACE_TICK_HZ) && defined(sys_Get_Timestamp_Ticks)
+#define  LAT_TRACE_TICK_HZ      SystemCoreClock
+#endif
+
+                        // pipeline stages, in the order a sample passes them
+#define  LAT_STAGE_SAMPLE           0    /* ADC conversion done (the origin)  */
+#define  LAT_STAGE_PROCESS          1    /* process image updated             */
+#define  LAT_STAGE_ENCODE           2    /* payload serialized                */
+#define  LAT_STAGE_PUBLISH          3    /* MQTT packet built                 */
+#define  LAT_STAGE_XMIT             4    /* transport write completed         */
+#define  LAT_NUM_STAGES             5
+
+            // histogram LAT_STAGE_SAMPLE holds the end-to-end latency, the
+            // others the latency of that stage (from the stage before it)
+#define  LAT_HIST_END_TO_END        LAT_STAGE_SAMPLE
+
+            // error codes are ERR_LAT_TRACE_xxx in user_api.h
+
+
+typedef struct lat_trace_def             /* carried along with one sample */
+   {
+       uint32_t   stamp [LAT_NUM_STAGES];  // low 32 bits of the counter
+       uint16_t   seq;                   // sample sequence #
+       uint8_t    stamped;               // bit n = stage n has been stamped
+       uint8_t    flags;                 // free for the App's use
+   } LAT_TRACE;
+
+
+typedef struct lat_stats_def             /* one histogram's summary, in usec */
+   {
+       uint32_t   count;
+       uint32_t   min_usec;
+       uint32_t   p50_usec;
+       uint32_t   p90_usec;
+       uint32_t   p99_usec;
+       uint32_t   max_usec;
+       uint32_t   mean_usec;
+   } LAT_STATS;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int      lat_trace_init (uint32_t tick_hz);
+void     lat_trace_reset (void);
+void     lat_trace_begin (LAT_TRACE *trc, uint32_t origin_ticks);
+void     lat_trace_stamp (LAT_TRACE *trc, int stage);
+void     lat_trace_set_current (LAT_TRACE *trc);
+void     lat_trace_stamp_current (int stage);   // for layers that don't see trc
+void     lat_trace_close (LAT_TRACE *trc);
+int      lat_trace_get_stats (int hist, LAT_STATS *stats);
+uint32_t lat_trace_get_percentile (int hist, int per_mille);
+int      lat_trace_get_worst (LAT_TRACE *trc);  // slowest end-to-end sample
+void     lat_trace_encode (TCODEC_ENC *enc);
+
+#endif                          //  __LAT_TRACE_H__
+
+//*****************************************************************************
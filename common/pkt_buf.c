@@ -0,0 +1,375 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              pkt_buf.c
+//
+//
+//  Reference counted, fixed block packet buffer pool. See pkt_buf.h
+//
+//  The free blocks are a singly linked list through PKT_BUF.next, so an
+//  alloc is a pop and a free is a push. Both run inside a short critical
+//  section (interrupts off for a few instructions), which is what makes them
+//  safe to call from any interrupt level.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "pkt_buf.h"
+#include <string.h>
+
+#if PKTBUF_NUM_BLOCKS > 255 || PKTBUF_BLOCK_SIZE > 65535 || PKTBUF_HEADROOM >= PKTBUF_BLOCK_SIZE
+#error "PKTBUF_NUM_BLOCKS must be < 256, and PKTBUF_HEADROOM < PKTBUF_BLOCK_SIZE"
+#endif
+
+            // a few instruction critical section, usable from any level
+#if defined(__CORTEX_M)
+#define  PKTBUF_LOCK()     uint32_t int_state = __get_PRIMASK();  __disable_irq()
+#define  PKTBUF_UNLOCK()   __set_PRIMASK (int_state)
+#elif defined(__MSP430__)
+#define  PKTBUF_LOCK()     unsigned short int_state = __get_interrupt_state(); \
+                           __disable_interrupt()
+#define  PKTBUF_UNLOCK()   __set_interrupt_state (int_state)
+#else
+#define  PKTBUF_LOCK()
+#define  PKTBUF_UNLOCK()
+#endif
+
+
+typedef struct pktbuf_pool_def           /* pool control block */
+   {
+       PKT_BUF    *free_list;
+       uint16_t   in_use;
+       uint16_t   high_water;
+       uint32_t   allocs;
+       uint32_t   alloc_fails;
+       PKT_BUF    blocks [PKTBUF_NUM_BLOCKS];
+   } PKTBUF_POOL;
+
+static PKTBUF_POOL   _g_pktbuf_pool;
+
+
+//*****************************************************************************
+//  pktbuf_init
+//
+//          Put every block on the free list. Call once at startup, before
+//          any radio / BLE / network interrupts are enabled.
+//*****************************************************************************
+void  pktbuf_init (void)
+{
+    int   i;
+
+    memset (&_g_pktbuf_pool, 0, sizeof(_g_pktbuf_pool));
+    for (i = PKTBUF_NUM_BLOCKS - 1;  i >= 0;  i--)
+      { _g_pktbuf_pool.blocks[i].next = _g_pktbuf_pool.free_list;
+        _g_pktbuf_pool.free_list      = &_g_pktbuf_pool.blocks[i];
+      }
+}
+
+
+//*****************************************************************************
+//  pktbuf_alloc
+//
+//          Get a block with an owner count of 1, and no data. headroom is
+//          where the data starts, leaving room for headers to be pushed in
+//          front of it later. Returns 0L if the pool is empty (counted in
+//          alloc_fails).
+//*****************************************************************************
+PKT_BUF  *pktbuf_alloc (int headroom)
+{
+    PKT_BUF  *pb;
+
+    if (headroom < 0 || headroom > PKTBUF_BLOCK_SIZE)
+       return (0L);
+    {
+      PKTBUF_LOCK();
+      pb = _g_pktbuf_pool.free_list;
+      if (pb != 0L)
+         { _g_pktbuf_pool.free_list = pb->next;
+           _g_pktbuf_pool.allocs++;
+           if (++_g_pktbuf_pool.in_use > _g_pktbuf_pool.high_water)
+              _g_pktbuf_pool.high_water = _g_pktbuf_pool.in_use;
+         }
+         else _g_pktbuf_pool.alloc_fails++;
+      PKTBUF_UNLOCK();
+    }
+    if (pb == 0L)
+       return (0L);
+
+    pb->next  = 0L;
+    pb->refs  = 1;
+    pb->flags = 0;
+    pb->off   = (uint16_t) headroom;
+    pb->len   = 0;
+    return (pb);
+}
+
+
+//*****************************************************************************
+//  pktbuf_ref
+//
+//          Add an owner: the buffer will not go back to the pool until this
+//          owner also calls pktbuf_free().
+//*****************************************************************************
+void  pktbuf_ref (PKT_BUF *pb)
+{
+    if (pb == 0L)
+       return;
+    {
+      PKTBUF_LOCK();
+      pb->refs++;
+      PKTBUF_UNLOCK();
+    }
+}
+
+
+//*****************************************************************************
+//  pktbuf_free
+//
+//          Drop an owner. A block whose count reaches 0 goes back to the
+//          pool, and so does the rest of its chain, up to the first block
+//          that still has another owner.
+//*****************************************************************************
+void  pktbuf_free (PKT_BUF *pb)
+{
+    PKT_BUF  *next;
+    int      freed;
+
+    while (pb != 0L)
+      {
+        {
+          PKTBUF_LOCK();
+          next  = pb->next;
+          freed = (pb->refs > 0 && --pb->refs == 0);
+          if (freed)
+             { pb->next = _g_pktbuf_pool.free_list;
+               _g_pktbuf_pool.free_list = pb;
+               _g_pktbuf_pool.in_use--;
+             }
+          PKTBUF_UNLOCK();
+        }
+        if ( ! freed)
+           break;                       // still in use: so is the rest
+        pb = next;
+      }
+}
+
+
+//*****************************************************************************
+//  pktbuf_push
+//
+//          Prepend len bytes (a header) in the headroom. Returns the new
+//          start of the data, for the caller to fill in, or 0L if there is
+//          not enough headroom.
+//*****************************************************************************
+uint8_t  *pktbuf_push (PKT_BUF *pb, int len)
+{
+    if (pb == 0L || len < 0 || len > pb->off)
+       return (0L);
+    pb->off -= len;
+    pb->len += len;
+    return (&pb->data[pb->off]);
+}
+
+
+//*****************************************************************************
+//  pktbuf_pull
+//
+//          Strip len bytes (a header) off the front. Returns the new start
+//          of the data, or 0L if the block holds fewer than len bytes.
+//*****************************************************************************
+uint8_t  *pktbuf_pull (PKT_BUF *pb, int len)
+{
+    if (pb == 0L || len < 0 || len > pb->len)
+       return (0L);
+    pb->off += len;
+    pb->len -= len;
+    return (&pb->data[pb->off]);
+}
+
+
+//*****************************************************************************
+//  pktbuf_put
+//
+//          Grow the data by len bytes at the tail. Returns where the new
+//          bytes go (e.g. the target of a FIFO read), or 0L if there is not
+//          enough tailroom.
+//*****************************************************************************
+uint8_t  *pktbuf_put (PKT_BUF *pb, int len)
+{
+    uint8_t  *tail;
+
+    if (pb == 0L || len < 0 || len > pktbuf_tailroom(pb))
+       return (0L);
+    tail = &pb->data[pb->off + pb->len];
+    pb->len += len;
+    return (tail);
+}
+
+
+//*****************************************************************************
+//  pktbuf_trim
+//
+//          Cut this block's data down to len bytes (e.g. after a receive
+//          into a pktbuf_put() area that came up short).
+//*****************************************************************************
+void  pktbuf_trim (PKT_BUF *pb, int len)
+{
+    if (pb != 0L && len >= 0 && len < pb->len)
+       pb->len = (uint16_t) len;
+}
+
+
+//*****************************************************************************
+//  pktbuf_chain
+//
+//          Append tail (and its chain) to the end of head's chain. The
+//          ownership of tail passes to the chain.
+//*****************************************************************************
+void  pktbuf_chain (PKT_BUF *head, PKT_BUF *tail)
+{
+    if (head == 0L || tail == 0L)
+       return;
+    while (head->next != 0L)
+      head = head->next;
+    head->next = tail;
+}
+
+
+//*****************************************************************************
+//  pktbuf_total_len
+//
+//          # data bytes in the whole chain.
+//*****************************************************************************
+int  pktbuf_total_len (PKT_BUF *pb)
+{
+    int  len;
+
+    for (len = 0;  pb != 0L;  pb = pb->next)
+      len += pb->len;
+    return (len);
+}
+
+
+//*****************************************************************************
+//  pktbuf_append
+//
+//          Copy len bytes onto the end of the packet, filling the last
+//          block's tailroom, then chaining on new blocks (no headroom) as
+//          needed. For data that arrives in pieces (e.g. a TCP stream).
+//          Returns 0, or ERR_PKTBUF_NO_BUFFERS (what fit was appended).
+//*****************************************************************************
+int  pktbuf_append (PKT_BUF *pb, const void *src, int len)
+{
+    const uint8_t  *sp = (const uint8_t*) src;
+    PKT_BUF        *nb;
+    int            n;
+
+    if (pb == 0L || len < 0 || (src == 0L && len > 0))
+       return (ERR_PKTBUF_INVALID_PARM);
+    while (pb->next != 0L)
+      pb = pb->next;
+
+    while (len > 0)
+      { n = pktbuf_tailroom (pb);
+        if (n == 0)
+           { nb = pktbuf_alloc (0);
+             if (nb == 0L)
+                return (ERR_PKTBUF_NO_BUFFERS);
+             pb->next = nb;
+             pb       = nb;
+             continue;
+           }
+        if (n > len)
+           n = len;
+        memcpy (&pb->data[pb->off + pb->len], sp, n);
+        pb->len += n;
+        sp      += n;
+        len     -= n;
+      }
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  pktbuf_copy_out
+//
+//          Copy len bytes, starting offset bytes into the packet, out to a
+//          flat buffer. Returns the # bytes copied (less than len if the
+//          packet is shorter).
+//*****************************************************************************
+int  pktbuf_copy_out (PKT_BUF *pb, int offset, void *dst, int len)
+{
+    uint8_t  *dp = (uint8_t*) dst;
+    int      n, copied;
+
+    if (dst == 0L || offset < 0 || len < 0)
+       return (ERR_PKTBUF_INVALID_PARM);
+
+    while (pb != 0L && offset >= pb->len)
+      { offset -= pb->len;              // skip whole blocks
+        pb      = pb->next;
+      }
+    copied = 0;
+    while (pb != 0L && copied < len)
+      { n = pb->len - offset;
+        if (n > len - copied)
+           n = len - copied;
+        memcpy (&dp[copied], &pb->data[pb->off + offset], n);
+        copied += n;
+        offset  = 0;
+        pb      = pb->next;
+      }
+    return (copied);
+}
+
+
+//*****************************************************************************
+//  pktbuf_get_stats
+//
+//          Return the pool statistics. reset_flag = 1 clears the counts and
+//          restarts the high water mark from the blocks in use now.
+//*****************************************************************************
+int  pktbuf_get_stats (PKTBUF_STATS *stats, int reset_flag)
+{
+    if (stats == 0L)
+       return (ERR_PKTBUF_INVALID_PARM);
+    {
+      PKTBUF_LOCK();
+      stats->allocs      = _g_pktbuf_pool.allocs;
+      stats->alloc_fails = _g_pktbuf_pool.alloc_fails;
+      stats->num_blocks  = PKTBUF_NUM_BLOCKS;
+      stats->in_use      = _g_pktbuf_pool.in_use;
+      stats->high_water  = _g_pktbuf_pool.high_water;
+      if (reset_flag)
+         { _g_pktbuf_pool.allocs      = 0;
+           _g_pktbuf_pool.alloc_fails = 0;
+           _g_pktbuf_pool.high_water  = _g_pktbuf_pool.in_use;
+         }
+      PKTBUF_UNLOCK();
+    }
+    return (0);                         // denote success
+}
+
+//*****************************************************************************
@@ -0,0 +1,127 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              pkt_buf.h
+//
+//
+//  Definitions for the reference counted packet buffer pool, shared by the
+//  radio (SPIRIT1), BLE, network and MQTT layers.
+//
+//  Instead of each layer copying a packet into its own buffer, a packet is
+//  received once into a PKT_BUF, and the buffer handle is passed along.
+//  Each layer strips its header off the front (pktbuf_pull), or adds its
+//  header in the headroom in front of the data (pktbuf_push), in place:
+//
+//      pb = pktbuf_alloc (PKTBUF_HEADROOM);         radio ISR / rx task
+//      radio FIFO  --> pktbuf_put (pb, len)         the one copy
+//      pktbuf_pull (pb, 5);                         drop the AppliFrame header
+//      MQTTPublish_PktBuf (&client, topic, QOS0, pb);   pushes the MQTT
+//                                                   header, one socket send
+//      pktbuf_free (pb);
+//
+//  Buffers are fixed size blocks from a static pool: allocation and free
+//  are O(1) (a free list), and are safe from ISR level (a few instruction
+//  critical section). Larger packets are a chain of blocks (next), but the
+//  common case - a radio frame, a BLE event, an MQTT publish - fits in one
+//  block, so it stays contiguous and can be handed to a driver as is.
+//
+//  Reference counts:  a layer that keeps a buffer past the call that gave
+//  it the buffer (a retry queue, a fan out to several links) calls
+//  pktbuf_ref(). Every owner calls pktbuf_free() when done. When a block's
+//  count goes to 0 it goes back to the pool, and so does the rest of its
+//  chain (stopping at a block that is still referenced elsewhere).
+//  A buffer's data must not be changed while it has more than one owner.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __PKT_BUF_H__
+#define __PKT_BUF_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+                        // sizing - override in project_config_parms.h
+#if !defined(PKTBUF_NUM_BLOCKS)
+#define  PKTBUF_NUM_BLOCKS         24    /* blocks in the pool  (< 256)        */
+#endif
+#if !defined(PKTBUF_BLOCK_SIZE)
+#define  PKTBUF_BLOCK_SIZE        160    /* data bytes per block, incl headroom */
+#endif
+#if !defined(PKTBUF_HEADROOM)
+#define  PKTBUF_HEADROOM           64    /* room for the headers pushed in front
+                                            on the way out (MQTT fixed header +
+                                            topic + packet id)                 */
+#endif
+
+            // error codes are ERR_PKTBUF_xxx in user_api.h
+
+
+typedef struct pkt_buf_def               /* one packet buffer block */
+   {
+       struct pkt_buf_def  *next;        // next block of the packet (chain)
+       volatile uint8_t    refs;         // # owners, 0 = in the pool
+       uint8_t    flags;                 // free for the owning layer's use
+       uint16_t   off;                   // start of the data in data[]
+       uint16_t   len;                   // # data bytes in this block
+       uint8_t    data [PKTBUF_BLOCK_SIZE];
+   } PKT_BUF;
+
+
+typedef struct pktbuf_stats_def          /* pool statistics */
+   {
+       uint32_t   allocs;                // # successful pktbuf_alloc()s
+       uint32_t   alloc_fails;           // # times the pool was empty
+       uint16_t   num_blocks;            // size of the pool
+       uint16_t   in_use;                // blocks allocated now
+       uint16_t   high_water;            // max blocks ever in use at once
+   } PKTBUF_STATS;
+
+
+            // where the data starts, and how much room is left around it
+#define  pktbuf_data(pb)       (&(pb)->data[(pb)->off])
+#define  pktbuf_headroom(pb)   ((int) (pb)->off)
+#define  pktbuf_tailroom(pb)   ((int) (PKTBUF_BLOCK_SIZE - (pb)->off - (pb)->len))
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+void     pktbuf_init (void);
+PKT_BUF  *pktbuf_alloc (int headroom);                 // ISR safe
+void     pktbuf_ref (PKT_BUF *pb);                     // ISR safe
+void     pktbuf_free (PKT_BUF *pb);                    // ISR safe
+uint8_t  *pktbuf_push (PKT_BUF *pb, int len);  // add header in front: new start
+uint8_t  *pktbuf_pull (PKT_BUF *pb, int len);  // strip header: new start
+uint8_t  *pktbuf_put (PKT_BUF *pb, int len);   // add at the tail: where to fill
+void     pktbuf_trim (PKT_BUF *pb, int len);   // cut this block to len bytes
+void     pktbuf_chain (PKT_BUF *head, PKT_BUF *tail);
+int      pktbuf_total_len (PKT_BUF *pb);
+int      pktbuf_append (PKT_BUF *pb, const void *src, int len);
+int      pktbuf_copy_out (PKT_BUF *pb, int offset, void *dst, int len);
+int      pktbuf_get_stats (PKTBUF_STATS *stats, int reset_flag);
+
+#endif                          //  __PKT_BUF_H__
+
+//*****************************************************************************
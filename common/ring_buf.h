@@ -0,0 +1,685 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              ring_buf.h
+//
+//
+//  Header only ring buffer library, shared by the UART, ADC streaming,
+//  BLE stream and logging paths.
+//
+//  All rings are a power of 2 in size, and use free running head / tail
+//  indexes that are masked on each access, so there is no modulo per byte,
+//  and all size slots are usable (count = head - tail).
+//
+//  RING_BUF  - single producer / single consumer byte ring. The producer
+//              only writes head, the consumer only writes tail, so neither
+//              side needs a lock. Typical use: an ISR on one side, the main
+//              loop on the other.
+//
+//                  RING_BUF_DEFINE (uart_rx_ring, 128);      // file scope
+//
+//                  ring_buf_put (&uart_rx_ring, in_char);    // RX ISR
+//                  n = ring_buf_read (&uart_rx_ring, buf, sizeof(buf));
+//
+//              Besides single bytes and bulk (memcpy) copies, each side can
+//              get a pointer to its contiguous span, for a DMA or a direct
+//              FIFO read, and then commit what it used:
+//
+//                  p = ring_buf_write_span (&ring, &len);    // <= len bytes
+//                  ... DMA / memcpy into p ...
+//                  ring_buf_write_commit (&ring, n);
+//
+//  RING_MPSC - multi producer / single consumer queue of fixed size
+//              elements (records). Producers at any interrupt level can
+//              push at the same time. Each slot has a sequence #, so a
+//              producer that gets interrupted part way through filling its
+//              slot never blocks the others: the consumer just sees the
+//              queue as ending at that slot until it is filled in.
+//              Lock-free on Cortex-M3/M4/M7 (LDREX/STREX) and on the host.
+//              On Cortex-M0 and MSP430, which have no exclusive access
+//              instructions, the slot claim is a few instruction critical
+//              section, so it is still safe from any interrupt level.
+//
+//  The memory barriers (ring_load_acquire / ring_store_release) make sure
+//  the data is visible before the index that publishes it, for DMA masters
+//  on Cortex-M, and for other cores when built on a host.
+//
+//  Ring indexes are 16 bits on the MSP430 (so that reading one is a single,
+//  atomic instruction), which limits rings to 16384 bytes / slots there.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __RING_BUF_H__
+#define __RING_BUF_H__
+
+#include <stdint.h>                 // include after user_api.h, so that the
+#include <string.h>                 // CMSIS __DMB / __LDREXW defs are seen
+
+#if defined(__MSP430__)
+typedef  uint16_t   ring_idx_t;           // native word: atomic loads
+typedef  int16_t    ring_sidx_t;
+#else
+typedef  uint32_t   ring_idx_t;
+typedef  int32_t    ring_sidx_t;
+#endif
+
+#if defined(__CORTEX_M) && (__CORTEX_M >= 0x03)
+#define  RING_USES_LDREX      1           // M3/M4/M7: lock-free claims
+#elif !defined(__CORTEX_M) && !defined(__MSP430__) && defined(__GNUC__)
+#define  RING_USES_GCC_ATOMICS 1          // host builds (Linux / PC tools)
+#endif
+
+            // compiler + memory barrier
+#if defined(__CORTEX_M)
+#define  RING_BARRIER()       __DMB()
+#elif defined(RING_USES_GCC_ATOMICS)
+#define  RING_BARRIER()       __atomic_thread_fence (__ATOMIC_SEQ_CST)
+#elif defined(__GNUC__)
+#define  RING_BARRIER()       __asm__ __volatile__ ("" ::: "memory")
+#else
+#define  RING_BARRIER()                   // single core: volatile keeps order
+#endif
+
+            // compile time check that a ring size is a power of 2 (>= 2).
+            // Use at file scope.
+#define  RING_SIZE_CHECK(name,size)                                        \
+            typedef char name##_size_must_be_a_power_of_2                 \
+                         [((size) >= 2 && ((size) & ((size) - 1)) == 0) ? 1 : -1]
+
+
+typedef struct ring_buf_def              /* SPSC byte ring */
+   {
+       volatile ring_idx_t  head;        // free running: next byte to fill  (producer)
+       volatile ring_idx_t  tail;        // free running: next byte to take  (consumer)
+       ring_idx_t  mask;                 // size - 1
+       uint8_t     *buf;
+   } RING_BUF;
+
+            // define (and statically initialize) a ring and its storage,
+            // at file scope. The size is checked at compile time.
+#define  RING_BUF_DEFINE(name,size)                                        \
+            RING_SIZE_CHECK(name,size);                                   \
+            uint8_t   name##_storage [size];                              \
+            RING_BUF  name = { 0, 0, (size) - 1, name##_storage }
+
+
+typedef struct ring_mpsc_def             /* MPSC queue of fixed size elements */
+   {
+       volatile ring_idx_t  head;        // next slot to claim  (producers)
+       volatile ring_idx_t  tail;        // next slot to take   (consumer)
+       ring_idx_t  mask;                 // slots - 1
+       uint16_t    elem_size;            // bytes per element
+       volatile ring_idx_t  *seq;        // per slot sequence #s  [slots]
+       uint8_t     *data;                // elements  [slots * elem_size]
+   } RING_MPSC;
+
+            // define a queue of slots elements of elem_type. Still needs a
+            // RING_MPSC_INIT(name) call at startup, to number the slots.
+#define  RING_MPSC_DEFINE(name,elem_type,slots)                            \
+            RING_SIZE_CHECK(name,slots);                                  \
+            ring_idx_t  name##_seq [slots];                               \
+            elem_type   name##_data [slots];                              \
+            RING_MPSC   name = { 0, 0, (slots) - 1, sizeof(elem_type),    \
+                                 name##_seq, (uint8_t*) name##_data }
+#define  RING_MPSC_INIT(name)                                              \
+            ring_mpsc_init (&name, name##_seq, name##_data,               \
+                            (int) sizeof(name##_data[0]),                 \
+                            (int) (sizeof(name##_seq) / sizeof(ring_idx_t)))
+
+            // ring_atomic_reserve() return code when the ring is full
+#define  RING_RESERVE_FULL    0xFFFFFFFF
+
+
+//*****************************************************************************
+//*****************************************************************************
+//                          Index  Access  Primitives
+//*****************************************************************************
+//*****************************************************************************
+
+//*****************************************************************************
+//  ring_load_acquire / ring_store_release
+//
+//          Read the other side's index before touching the data it covers,
+//          and finish with the data before publishing our own index.
+//*****************************************************************************
+static inline ring_idx_t  ring_load_acquire (volatile ring_idx_t *idx)
+{
+#if defined(RING_USES_GCC_ATOMICS)
+    return (__atomic_load_n (idx, __ATOMIC_ACQUIRE));
+#else
+    ring_idx_t  value = *idx;
+    RING_BARRIER();
+    return (value);
+#endif
+}
+
+static inline void  ring_store_release (volatile ring_idx_t *idx, ring_idx_t value)
+{
+#if defined(RING_USES_GCC_ATOMICS)
+    __atomic_store_n (idx, value, __ATOMIC_RELEASE);
+#else
+    RING_BARRIER();
+    *idx = value;
+#endif
+}
+
+
+//*****************************************************************************
+//  ring_compare_and_set
+//
+//          *idx = new_value, if it still is old_value. Returns 1 if it was
+//          set, 0 if another producer got there first.
+//*****************************************************************************
+static inline int  ring_compare_and_set (volatile ring_idx_t *idx,
+                                         ring_idx_t old_value, ring_idx_t new_value)
+{
+#if defined(RING_USES_LDREX)
+    if (__LDREXW ((uint32_t*) idx) != old_value)
+       { __CLREX();
+         return (0);
+       }
+    return (__STREXW (new_value, (uint32_t*) idx) == 0);
+#elif defined(RING_USES_GCC_ATOMICS)
+    return (__atomic_compare_exchange_n (idx, &old_value, new_value, 0,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+#else
+    int  set;
+#if defined(__CORTEX_M)
+    uint32_t  int_state = __get_PRIMASK();
+    __disable_irq();
+#elif defined(__MSP430__)
+    unsigned short  int_state = __get_interrupt_state();
+    __disable_interrupt();
+#endif
+    set = (*idx == old_value);
+    if (set)
+       *idx = new_value;
+#if defined(__CORTEX_M)
+    __set_PRIMASK (int_state);
+#elif defined(__MSP430__)
+    __set_interrupt_state (int_state);
+#endif
+    return (set);
+#endif
+}
+
+
+//*****************************************************************************
+//  ring_atomic_reserve
+//
+//          Multi-producer claim of n units at *head, for rings that do
+//          their own commit marking (e.g. the binary log's header words).
+//          size is the ring size, tail the consumer's index. The tail only
+//          ever moves forward, so a stale tail just makes the ring look
+//          fuller. Returns the start of the claimed run, or
+//          RING_RESERVE_FULL.
+//*****************************************************************************
+static inline uint32_t  ring_atomic_reserve (volatile uint32_t *head,
+                                             volatile uint32_t *tail,
+                                             uint32_t size, uint32_t n)
+{
+    uint32_t  start;
+
+#if defined(RING_USES_LDREX)
+    do {
+         start = __LDREXW ((uint32_t*) head);
+         if ((start + n - *tail) > size)
+            { __CLREX();
+              return (RING_RESERVE_FULL);
+            }
+       } while (__STREXW (start + n, (uint32_t*) head) != 0);
+#elif defined(RING_USES_GCC_ATOMICS)
+    start = __atomic_load_n (head, __ATOMIC_RELAXED);
+    do {
+         if ((start + n - __atomic_load_n (tail, __ATOMIC_ACQUIRE)) > size)
+            return (RING_RESERVE_FULL);
+       } while ( ! __atomic_compare_exchange_n (head, &start, start + n, 1,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+#else
+    {
+#if defined(__CORTEX_M)
+      uint32_t  int_state = __get_PRIMASK();
+      __disable_irq();
+#elif defined(__MSP430__)
+      unsigned short  int_state = __get_interrupt_state();
+      __disable_interrupt();
+#endif
+      start = *head;
+      if ((start + n - *tail) > size)
+         start = RING_RESERVE_FULL;
+         else *head = start + n;
+#if defined(__CORTEX_M)
+      __set_PRIMASK (int_state);
+#elif defined(__MSP430__)
+      __set_interrupt_state (int_state);
+#endif
+    }
+#endif
+    return (start);
+}
+
+
+//*****************************************************************************
+//  ring_atomic_inc
+//
+//          Bump a counter that producers at several interrupt levels share
+//          (e.g. a dropped records count).
+//*****************************************************************************
+static inline void  ring_atomic_inc (volatile uint32_t *count)
+{
+#if defined(RING_USES_LDREX)
+    uint32_t  value;
+
+    do {
+         value = __LDREXW ((uint32_t*) count);
+       } while (__STREXW (value + 1, (uint32_t*) count) != 0);
+#elif defined(RING_USES_GCC_ATOMICS)
+    __atomic_fetch_add (count, 1, __ATOMIC_RELAXED);
+#elif defined(__CORTEX_M)
+    uint32_t  int_state = __get_PRIMASK();
+
+    __disable_irq();
+    (*count)++;
+    __set_PRIMASK (int_state);
+#elif defined(__MSP430__)
+    unsigned short  int_state = __get_interrupt_state();
+
+    __disable_interrupt();
+    (*count)++;
+    __set_interrupt_state (int_state);
+#else
+    (*count)++;
+#endif
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+//                     RING_BUF    SPSC  Byte  Ring
+//
+//  Producer side:  put, write, poke, write_span / write_commit, unput
+//  Consumer side:  get, read, peek, read_span / read_commit (skip)
+//  Either side:    count, space, reset (only when both sides are idle)
+//*****************************************************************************
+//*****************************************************************************
+
+//*****************************************************************************
+//  ring_buf_init
+//
+//          Setup a ring over caller supplied storage. size must be a power
+//          of 2. Returns 0, or -1 if size is not valid.
+//*****************************************************************************
+static inline int  ring_buf_init (RING_BUF *ring, uint8_t *storage, int size)
+{
+    if (ring == 0L || storage == 0L || size < 2 || (size & (size - 1)) != 0
+       || (unsigned int) size > (((ring_idx_t) ~0) >> 1))
+       return (-1);
+    ring->head = 0;
+    ring->tail = 0;
+    ring->mask = (ring_idx_t) (size - 1);
+    ring->buf  = storage;
+    return (0);                         // denote success
+}
+
+static inline void  ring_buf_reset (RING_BUF *ring)
+{
+    ring->head = ring->tail = 0;        // discard everything queued
+}
+
+static inline int  ring_buf_size (RING_BUF *ring)
+{
+    return ((int) ring->mask + 1);
+}
+
+
+//*****************************************************************************
+//  ring_buf_count / ring_buf_space
+//
+//          # bytes queued, and # free bytes. Exact for the calling side, a
+//          lower bound while the other side is active.
+//*****************************************************************************
+static inline int  ring_buf_count (RING_BUF *ring)
+{
+    return ((int) (ring_idx_t) (ring_load_acquire (&ring->head)
+                                - ring_load_acquire (&ring->tail)));
+}
+
+static inline int  ring_buf_space (RING_BUF *ring)
+{
+    return ((int) ring->mask + 1 - ring_buf_count (ring));
+}
+
+static inline int  ring_buf_is_empty (RING_BUF *ring)
+{
+    return (ring->head == ring->tail);
+}
+
+
+//*****************************************************************************
+//  ring_buf_put                                               producer
+//
+//          Queue one byte. Returns 1, or 0 if the ring is full.
+//*****************************************************************************
+static inline int  ring_buf_put (RING_BUF *ring, uint8_t value)
+{
+    ring_idx_t  head = ring->head;
+
+    if ((ring_idx_t) (head - ring_load_acquire (&ring->tail)) > ring->mask)
+       return (0);                      // full
+    ring->buf [head & ring->mask] = value;
+    ring_store_release (&ring->head, head + 1);
+    return (1);
+}
+
+
+//*****************************************************************************
+//  ring_buf_get                                               consumer
+//
+//          Take one byte. Returns 1, or 0 if the ring is empty.
+//*****************************************************************************
+static inline int  ring_buf_get (RING_BUF *ring, uint8_t *value)
+{
+    ring_idx_t  tail = ring->tail;
+
+    if (ring_load_acquire (&ring->head) == tail)
+       return (0);                      // empty
+    *value = ring->buf [tail & ring->mask];
+    ring_store_release (&ring->tail, tail + 1);
+    return (1);
+}
+
+
+//*****************************************************************************
+//  ring_buf_unput                                             producer
+//
+//          Take back the most recently queued byte (e.g. a backspace on a
+//          text line). Returns 1, or 0 if the ring is empty. Only safe when
+//          the consumer cannot be part way through taking that same byte,
+//          i.e. when it runs with the producer's interrupt masked.
+//*****************************************************************************
+static inline int  ring_buf_unput (RING_BUF *ring)
+{
+    ring_idx_t  head = ring->head;
+
+    if (head == ring_load_acquire (&ring->tail))
+       return (0);                      // nothing to take back
+    ring->head = head - 1;
+    return (1);
+}
+
+
+//*****************************************************************************
+//  ring_buf_poke                                              producer
+//
+//          Copy len bytes in at offset bytes past the head, without
+//          publishing them (e.g. re-assembling a packet from segments).
+//          ring_buf_write_commit() then publishes them. Returns len, or 0
+//          if there is not that much room.
+//*****************************************************************************
+static inline int  ring_buf_poke (RING_BUF *ring, int offset, const void *src,
+                                  int len)
+{
+    ring_idx_t  pos;
+    int         first;
+
+    if (offset < 0 || len < 0 || offset + len > ring_buf_space (ring))
+       return (0);
+    pos   = (ring_idx_t) (ring->head + offset) & ring->mask;
+    first = (int) (ring->mask + 1 - pos);
+    if (first > len)
+       first = len;
+    memcpy (&ring->buf [pos], src, first);
+    memcpy (&ring->buf [0], (const uint8_t*) src + first, len - first);
+    return (len);
+}
+
+
+//*****************************************************************************
+//  ring_buf_write_span                                        producer
+//
+//          Returns where the next bytes go, and in *span_len how many
+//          contiguous bytes can go there (up to the end of the storage).
+//          0 = the ring is full. Follow with ring_buf_write_commit().
+//*****************************************************************************
+static inline uint8_t  *ring_buf_write_span (RING_BUF *ring, int *span_len)
+{
+    ring_idx_t  pos  = ring->head & ring->mask;
+    int         room = ring_buf_space (ring);
+
+    if (room > (int) (ring->mask + 1 - pos))
+       room = (int) (ring->mask + 1 - pos);
+    *span_len = room;
+    return (&ring->buf [pos]);
+}
+
+
+//*****************************************************************************
+//  ring_buf_write_commit                                      producer
+//
+//          Publish len bytes that were filled in past the head (by a span,
+//          a DMA, or ring_buf_poke).
+//*****************************************************************************
+static inline void  ring_buf_write_commit (RING_BUF *ring, int len)
+{
+    ring_store_release (&ring->head, (ring_idx_t) (ring->head + len));
+}
+
+
+//*****************************************************************************
+//  ring_buf_write                                             producer
+//
+//          Bulk copy up to len bytes in (at most 2 memcpys). Returns the #
+//          bytes queued (< len if the ring filled up).
+//*****************************************************************************
+static inline int  ring_buf_write (RING_BUF *ring, const void *src, int len)
+{
+    int   room = ring_buf_space (ring);
+
+    if (len > room)
+       len = room;
+    if (len <= 0)
+       return (0);
+    ring_buf_poke (ring, 0, src, len);
+    ring_buf_write_commit (ring, len);
+    return (len);
+}
+
+
+//*****************************************************************************
+//  ring_buf_peek                                              consumer
+//
+//          Copy len bytes out, starting offset bytes past the tail, without
+//          taking them. Returns the # bytes copied (< len if fewer queued).
+//*****************************************************************************
+static inline int  ring_buf_peek (RING_BUF *ring, int offset, void *dst, int len)
+{
+    ring_idx_t  pos;
+    int         avail;
+    int         first;
+
+    avail = (int) (ring_idx_t) (ring_load_acquire (&ring->head) - ring->tail) - offset;
+    if (offset < 0 || avail <= 0 || len <= 0)
+       return (0);
+    if (len > avail)
+       len = avail;
+    pos   = (ring_idx_t) (ring->tail + offset) & ring->mask;
+    first = (int) (ring->mask + 1 - pos);
+    if (first > len)
+       first = len;
+    memcpy (dst, &ring->buf [pos], first);
+    memcpy ((uint8_t*) dst + first, &ring->buf [0], len - first);
+    return (len);
+}
+
+
+//*****************************************************************************
+//  ring_buf_read_span                                         consumer
+//
+//          Returns where the oldest queued bytes are, and in *span_len how
+//          many of them are contiguous there. 0 = the ring is empty.
+//          Follow with ring_buf_read_commit().
+//*****************************************************************************
+static inline uint8_t  *ring_buf_read_span (RING_BUF *ring, int *span_len)
+{
+    ring_idx_t  pos   = ring->tail & ring->mask;
+    int         avail = (int) (ring_idx_t) (ring_load_acquire (&ring->head) - ring->tail);
+
+    if (avail > (int) (ring->mask + 1 - pos))
+       avail = (int) (ring->mask + 1 - pos);
+    *span_len = avail;
+    return (&ring->buf [pos]);
+}
+
+
+//*****************************************************************************
+//  ring_buf_read_commit                                       consumer
+//
+//          Free up len bytes that were used (from a span or a peek), or
+//          just skip them.
+//*****************************************************************************
+static inline void  ring_buf_read_commit (RING_BUF *ring, int len)
+{
+    ring_store_release (&ring->tail, (ring_idx_t) (ring->tail + len));
+}
+
+
+//*****************************************************************************
+//  ring_buf_read                                              consumer
+//
+//          Bulk copy up to len bytes out (at most 2 memcpys). Returns the #
+//          bytes taken.
+//*****************************************************************************
+static inline int  ring_buf_read (RING_BUF *ring, void *dst, int len)
+{
+    len = ring_buf_peek (ring, 0, dst, len);
+    if (len > 0)
+       ring_buf_read_commit (ring, len);
+    return (len);
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+//                   RING_MPSC    Multi-Producer  Element  Queue
+//
+//  Slot (pos & mask) is free for the producer claiming pos when its
+//  sequence # == pos, and holds a finished element for the consumer at pos
+//  when its sequence # == pos + 1. The consumer hands it back for the next
+//  lap by setting it to pos + slots.
+//*****************************************************************************
+//*****************************************************************************
+
+//*****************************************************************************
+//  ring_mpsc_init
+//
+//          Setup a queue of slots elements of elem_size bytes, over caller
+//          supplied storage. slots must be a power of 2. Returns 0, or -1 if
+//          a parm is not valid.
+//*****************************************************************************
+static inline int  ring_mpsc_init (RING_MPSC *ring, ring_idx_t *seq, void *data,
+                                   int elem_size, int slots)
+{
+    int   i;
+
+    if (ring == 0L || seq == 0L || data == 0L || elem_size < 1 || elem_size > 65535
+       || slots < 2 || (slots & (slots - 1)) != 0
+       || (unsigned int) slots > (((ring_idx_t) ~0) >> 1))
+       return (-1);
+    for (i = 0;  i < slots;  i++)
+      seq[i] = (ring_idx_t) i;
+    ring->head      = 0;
+    ring->tail      = 0;
+    ring->mask      = (ring_idx_t) (slots - 1);
+    ring->elem_size = (uint16_t) elem_size;
+    ring->seq       = seq;
+    ring->data      = (uint8_t*) data;
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  ring_mpsc_push                                  any producer, any level
+//
+//          Queue a copy of one element. Returns 1, or 0 if the queue is
+//          full.
+//*****************************************************************************
+static inline int  ring_mpsc_push (RING_MPSC *ring, const void *elem)
+{
+    ring_idx_t   pos;
+    ring_sidx_t  diff;
+
+    for ( ; ; )
+      { pos  = ring_load_acquire (&ring->head);
+        diff = (ring_sidx_t) (ring_load_acquire (&ring->seq [pos & ring->mask]) - pos);
+        if (diff == 0)
+           { if (ring_compare_and_set (&ring->head, pos, pos + 1))
+                break;                  // slot is ours
+           }
+          else if (diff < 0)
+                  return (0);           // full: consumer has not freed it yet
+            // else another producer claimed it first: try the next one
+      }
+
+    memcpy (&ring->data [(pos & ring->mask) * ring->elem_size], elem, ring->elem_size);
+    ring_store_release (&ring->seq [pos & ring->mask], pos + 1);
+    return (1);
+}
+
+
+//*****************************************************************************
+//  ring_mpsc_pop                                              consumer
+//
+//          Take the oldest element. Returns 1, or 0 if the queue is empty
+//          (or its oldest slot is still being filled in).
+//*****************************************************************************
+static inline int  ring_mpsc_pop (RING_MPSC *ring, void *elem)
+{
+    ring_idx_t  pos = ring->tail;
+
+    if (ring_load_acquire (&ring->seq [pos & ring->mask]) != (ring_idx_t) (pos + 1))
+       return (0);
+    memcpy (elem, &ring->data [(pos & ring->mask) * ring->elem_size], ring->elem_size);
+    ring_store_release (&ring->seq [pos & ring->mask], pos + ring->mask + 1);
+    ring->tail = pos + 1;
+    return (1);
+}
+
+
+//*****************************************************************************
+//  ring_mpsc_count
+//
+//          # elements claimed and not yet taken (some may still be being
+//          filled in).
+//*****************************************************************************
+static inline int  ring_mpsc_count (RING_MPSC *ring)
+{
+    return ((int) (ring_idx_t) (ring_load_acquire (&ring->head)
+                                - ring_load_acquire (&ring->tail)));
+}
+
+#endif                          //  __RING_BUF_H__
+
+//*****************************************************************************
@@ -0,0 +1,408 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                                spi_bus.c
+//
+//
+//  Shared SPI bus manager: per-device descriptors, a priority queue of
+//  transactions, automatic chip select and reconfiguration between devices.
+//  See spi_bus.h
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "spi_bus.h"
+
+static void      spibus_run (SPI_BUS *bus);
+static void      spibus_start_segment (SPI_BUS *bus, SPI_BUS_XFER *xfer, int seg);
+static void      spibus_finish (SPI_BUS *bus, SPI_BUS_XFER *xfer, int status);
+static uint32_t  spibus_lock (void);
+static void      spibus_unlock (uint32_t int_state);
+
+
+//*****************************************************************************
+//  spibus_init
+//
+//          Setup a bus control block. ops/hw are the board's bus operations
+//          and the handle that is passed back to them.
+//*****************************************************************************
+void  spibus_init (SPI_BUS *bus, const SPI_BUS_OPS *ops, void *hw)
+{
+    memset (bus, 0, sizeof(SPI_BUS));
+    bus->ops = ops;
+    bus->hw  = hw;
+}
+
+
+//*****************************************************************************
+//  spibus_add_device
+//
+//          Register a device on the bus.
+//
+//          mode       SPI mode 0..3
+//          clock_hz   max SCLK rate the device supports. The board picks the
+//                     fastest rate that does not exceed it.
+//          cs_pin     pin_id of the device's CS, or -1 if it has none
+//          priority   0..255, higher runs first
+//          flags      SPIBUS_CS_ACTIVE_HIGH
+//
+//          The CS pin must already be configured as an output. It is driven
+//          to its inactive level here.
+//*****************************************************************************
+int  spibus_add_device (SPI_BUS *bus, SPI_BUS_DEV *dev, int mode,
+                        uint32_t clock_hz, int cs_pin, int priority, int flags)
+{
+    if (bus == 0L || bus->ops == 0L || dev == 0L || mode < 0 || mode > 3
+       || clock_hz == 0 || priority < 0 || priority > 255)
+       return (ERR_SPIBUS_INVALID_PARM);
+
+    memset (dev, 0, sizeof(SPI_BUS_DEV));
+    dev->bus      = bus;
+    dev->clock_hz = clock_hz;
+    dev->cs_pin   = (int16_t) cs_pin;
+    dev->mode     = (uint8_t) mode;
+    dev->priority = (uint8_t) priority;
+    dev->flags    = (uint16_t) flags;
+
+    if (cs_pin >= 0)
+       bus->ops->set_cs (bus->hw, cs_pin, (flags & SPIBUS_CS_ACTIVE_HIGH) ? 0 : 1);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  spibus_xfer_init
+//
+//          Setup a transaction. CS stays asserted across all of its segments,
+//          e.g. a command write followed by a reply read. segs[] and the
+//          buffers it points to must stay valid until the transaction is done.
+//*****************************************************************************
+void  spibus_xfer_init (SPI_BUS_XFER *xfer, const SPI_BUS_SEG *segs, int num_segs,
+                        SPI_BUS_DONE_HANDLER callback, void *cb_parm)
+{
+    memset (xfer, 0, sizeof(SPI_BUS_XFER));
+    xfer->segs     = segs;
+    xfer->num_segs = (uint8_t) num_segs;
+    xfer->callback = callback;
+    xfer->cb_parm  = cb_parm;
+    xfer->state    = SPIBUS_XFER_IDLE;
+}
+
+
+//*****************************************************************************
+//  spibus_submit
+//
+//          Queue a transaction for a device, and start it right away if the
+//          bus is idle. Returns without waiting: completion is reported via
+//          the callback, or polled with spibus_is_done().
+//
+//          Can be called from an ISR, or from a completion callback.
+//*****************************************************************************
+int  spibus_submit (SPI_BUS_DEV *dev, SPI_BUS_XFER *xfer)
+{
+    SPI_BUS       *bus;
+    SPI_BUS_XFER  **link;
+    uint32_t      int_state;
+
+    if (dev == 0L || dev->bus == 0L || xfer == 0L || xfer->segs == 0L
+       || xfer->num_segs == 0)
+       return (ERR_SPIBUS_INVALID_PARM);
+    bus = dev->bus;
+
+    int_state = spibus_lock();
+    if (xfer->state == SPIBUS_XFER_QUEUED || xfer->state == SPIBUS_XFER_ACTIVE)
+       { spibus_unlock (int_state);
+         return (ERR_SPIBUS_XFER_BUSY);  // already in the bus's hands
+       }
+    xfer->dev     = dev;
+    xfer->cur_seg = 0;
+    xfer->status  = 0;
+    xfer->state   = SPIBUS_XFER_QUEUED;
+
+        // insert behind everything of the same or higher priority
+    link = &bus->queue;
+    while (*link != 0L  &&  (*link)->dev->priority >= dev->priority)
+       link = &(*link)->next;
+    xfer->next = *link;
+    *link      = xfer;
+    if (++bus->queue_depth > bus->max_queue_depth)
+       bus->max_queue_depth = bus->queue_depth;
+    spibus_unlock (int_state);
+
+    spibus_run (bus);                   // start it if the bus is idle
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  spibus_cancel
+//
+//          Remove a transaction that is still waiting for the bus. Its
+//          callback is not called. A transaction that is already on the
+//          wire can not be cancelled (ERR_SPIBUS_XFER_BUSY).
+//*****************************************************************************
+int  spibus_cancel (SPI_BUS_XFER *xfer)
+{
+    SPI_BUS       *bus;
+    SPI_BUS_XFER  **link;
+    uint32_t      int_state;
+
+    if (xfer == 0L || xfer->dev == 0L)
+       return (ERR_SPIBUS_INVALID_PARM);
+    bus = xfer->dev->bus;
+
+    int_state = spibus_lock();
+    if (xfer->state != SPIBUS_XFER_QUEUED)
+       { spibus_unlock (int_state);
+         return ((xfer->state == SPIBUS_XFER_ACTIVE) ? ERR_SPIBUS_XFER_BUSY : 0);
+       }
+    for (link = &bus->queue;  *link != 0L;  link = &(*link)->next)
+      if (*link == xfer)
+         { *link = xfer->next;
+           bus->queue_depth--;
+           break;
+         }
+    xfer->next   = 0L;
+    xfer->status = ERR_SPIBUS_CANCELLED;
+    xfer->state  = SPIBUS_XFER_DONE;
+    spibus_unlock (int_state);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  spibus_is_done
+//
+//          Returns 1 when the transaction has completed (see xfer->status),
+//          else 0.
+//*****************************************************************************
+int  spibus_is_done (SPI_BUS_XFER *xfer)
+{
+    return (xfer->state == SPIBUS_XFER_DONE);
+}
+
+
+//*****************************************************************************
+//  spibus_segment_done
+//
+//          Called by the board layer (normally from the SPI/DMA ISR) when the
+//          segment it was given by ops->start() has completed.
+//          status:  0 = OK, < 0 = failed (the transaction is ended).
+//*****************************************************************************
+void  spibus_segment_done (SPI_BUS *bus, int status)
+{
+    bus->seg_status   = status;
+    bus->seg_complete = 1;
+    spibus_run (bus);
+}
+
+
+//*****************************************************************************
+//  spibus_run
+//
+//          The bus state machine: handle a completed segment, start the next
+//          segment, or finish the transaction and start the next one.
+//
+//          Only one instance runs at a time. If a segment completes, or a
+//          transaction is submitted, while it is running (from an ISR, a
+//          callback, or a board that completes segments synchronously), that
+//          call just returns and the running instance picks up the work.
+//          So there is no recursion, however the board completes segments.
+//*****************************************************************************
+static void  spibus_run (SPI_BUS *bus)
+{
+    SPI_BUS_XFER  *xfer;
+    SPI_BUS_DEV   *dev;
+    uint32_t      int_state;
+
+    int_state = spibus_lock();
+    if (bus->in_run)
+       { spibus_unlock (int_state);     // running instance will handle it
+         return;
+       }
+    bus->in_run = 1;
+    spibus_unlock (int_state);
+
+    for ( ; ; )
+      {
+        xfer = bus->active;
+        if (xfer != 0L)
+           {     //-------------------------------------------------
+                 // a transaction is on the wire: wait for its segment
+                 //-------------------------------------------------
+             int_state = spibus_lock();
+             if (bus->seg_complete == 0)
+                { bus->in_run = 0;      // nothing to do until the ISR
+                  spibus_unlock (int_state);
+                  return;
+                }
+             bus->seg_complete = 0;
+             spibus_unlock (int_state);
+
+             if (bus->seg_status < 0)
+                spibus_finish (bus, xfer, ERR_SPIBUS_XFER_FAILED);
+                else spibus_start_segment (bus, xfer, xfer->cur_seg + 1);
+             continue;
+           }
+
+             //-------------------------------------------------
+             // bus is idle: take the highest priority transaction
+             //-------------------------------------------------
+        int_state = spibus_lock();
+        xfer = bus->queue;
+        if (xfer == 0L)
+           { bus->in_run = 0;           // queue is empty
+             spibus_unlock (int_state);
+             return;
+           }
+        bus->queue = xfer->next;
+        bus->queue_depth--;
+        xfer->next  = 0L;
+        xfer->state = SPIBUS_XFER_ACTIVE;
+        bus->active = xfer;
+        bus->seg_complete = 0;
+        spibus_unlock (int_state);
+
+        dev = xfer->dev;
+        if (bus->cur_dev == 0L  ||  bus->cur_dev->mode != dev->mode
+           ||  bus->cur_dev->clock_hz != dev->clock_hz)
+           {      // different SPI settings than the last device
+             bus->cur_dev = 0L;
+             if (bus->ops->configure (bus->hw, dev->mode, dev->clock_hz) < 0)
+                { spibus_finish (bus, xfer, ERR_SPIBUS_XFER_FAILED);
+                  continue;
+                }
+             bus->reconfigs++;
+           }
+        bus->cur_dev = dev;
+
+        if (dev->cs_pin >= 0)
+           bus->ops->set_cs (bus->hw, dev->cs_pin,
+                             (dev->flags & SPIBUS_CS_ACTIVE_HIGH) ? 1 : 0);
+        spibus_start_segment (bus, xfer, 0);
+      }
+}
+
+
+//*****************************************************************************
+//  spibus_start_segment
+//
+//          Start segment seg (skipping empty ones), or finish the transaction
+//          if there are no segments left.
+//*****************************************************************************
+static void  spibus_start_segment (SPI_BUS *bus, SPI_BUS_XFER *xfer, int seg)
+{
+    const SPI_BUS_SEG  *segp;
+
+    while (seg < xfer->num_segs  &&  xfer->segs[seg].length == 0)
+      seg++;
+    if (seg >= xfer->num_segs)
+       { spibus_finish (bus, xfer, 0);  // all segments done
+         return;
+       }
+
+    xfer->cur_seg = (uint8_t) seg;
+    segp = &xfer->segs [seg];
+    if (bus->ops->start (bus->hw, segp->tx, segp->rx, segp->length) < 0)
+       spibus_finish (bus, xfer, ERR_SPIBUS_XFER_FAILED);
+}
+
+
+//*****************************************************************************
+//  spibus_finish
+//
+//          End the active transaction: release CS, post its status, and
+//          call its completion callback.
+//*****************************************************************************
+static void  spibus_finish (SPI_BUS *bus, SPI_BUS_XFER *xfer, int status)
+{
+    SPI_BUS_DEV   *dev;
+    uint32_t      int_state;
+
+    dev = xfer->dev;
+    if (dev->cs_pin >= 0)
+       bus->ops->set_cs (bus->hw, dev->cs_pin,
+                         (dev->flags & SPIBUS_CS_ACTIVE_HIGH) ? 0 : 1);
+
+    if (status < 0)
+       { dev->errors++;
+         bus->errors++;
+       }
+      else
+       { dev->xfers++;
+         bus->xfers++;
+       }
+
+    int_state = spibus_lock();
+    bus->active       = 0L;
+    bus->seg_complete = 0;
+    xfer->status      = status;
+    xfer->state       = SPIBUS_XFER_DONE;
+    spibus_unlock (int_state);
+
+    if (xfer->callback != 0L)
+       (xfer->callback) (xfer, status);   // may submit more work
+}
+
+
+//*****************************************************************************
+//  spibus_lock / spibus_unlock
+//
+//          Short critical sections around the queue and the active
+//          transaction, which are shared with the SPI/DMA ISR.
+//*****************************************************************************
+static uint32_t  spibus_lock (void)
+{
+#if defined(__CORTEX_M)
+    uint32_t  int_state = __get_PRIMASK();
+
+    __disable_irq();
+    return (int_state);
+#elif defined(__MSP430__)
+    unsigned short  int_state = __get_interrupt_state();
+
+    __disable_interrupt();
+    return (int_state);
+#else
+    return (0);
+#endif
+}
+
+
+static void  spibus_unlock (uint32_t int_state)
+{
+#if defined(__CORTEX_M)
+    __set_PRIMASK (int_state);
+#elif defined(__MSP430__)
+    __set_interrupt_state ((unsigned short) int_state);
+#else
+    (void) int_state;
+#endif
+}
+
+//*****************************************************************************
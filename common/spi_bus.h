@@ -0,0 +1,176 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                                spi_bus.h
+//
+//
+//  Definitions for the shared SPI bus manager.
+//
+//  Several devices hang off one SPI module (e.g. BlueNRG, W5200, SPIRIT1,
+//  L6474s), each with its own SPI mode, clock rate and chip select. Instead
+//  of every driver toggling its own CS and calling spi_Write_Read() (and
+//  getting ERR_IO_ALREADY_IN_PROGRESS when another driver is mid transfer),
+//  each device is registered once with the bus, and its drivers queue
+//  transactions:
+//
+//      spibus_add_device (&bus, &w5200_dev, 0, 20000000, W5200_CS_PIN,  2, 0);
+//      spibus_add_device (&bus, &l6474_dev, 3,  5000000, L6474_CS_PIN,  1, 0);
+//
+//      SPI_BUS_SEG  segs[2] = { { cmd, 0L, 4 },          write the command
+//                               { 0L, reply, 16 } };     then read the reply
+//      spibus_xfer_init (&xfer, segs, 2, w5200_done, &ctx);
+//      spibus_submit (&w5200_dev, &xfer);                returns immediately
+//
+//  Pending transactions are kept in priority order (FIFO within the same
+//  priority), and run back to back: the bus reconfigures the SPI module
+//  (mode, clock) only when the next device differs from the last one,
+//  asserts that device's CS, runs each segment (DMA on STM32), deasserts
+//  CS, and calls the transaction's completion callback. A running
+//  transaction is never pre-empted; priority only picks the next one.
+//
+//  Completion callbacks are called from the SPI/DMA interrupt, so keep them
+//  short. They may submit the next transaction (including re-submitting the
+//  one that just completed).
+//
+//  The engine has no HAL dependencies. The board layer supplies the 3 bus
+//  operations (configure / start a segment / drive a CS pin), and calls
+//  spibus_segment_done() when a segment completes. On STM32 that is
+//  board_spibus_init() in board_STM32_spi.c. A host build can plug in
+//  simulated slaves instead.
+//
+//  SPI modes use the standard numbering: CPOL = mode >> 1, CPHA = mode & 1.
+//
+//  Once a SPI module is handed to a bus, every device on it must go through
+//  the bus: a driver that still drives its own CS could select its device
+//  in the middle of another device's transaction.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __SPI_BUS_H__
+#define __SPI_BUS_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+            // valid values for flags on spibus_add_device()
+#define  SPIBUS_CS_ACTIVE_HIGH   0x0001  /* CS is asserted high (default low)   */
+
+            // transaction states
+#define  SPIBUS_XFER_IDLE           0    /* never submitted                   */
+#define  SPIBUS_XFER_QUEUED         1    /* waiting for the bus               */
+#define  SPIBUS_XFER_ACTIVE         2    /* CS asserted, segments running     */
+#define  SPIBUS_XFER_DONE           3    /* completed (see xfer->status)      */
+
+
+struct spi_bus_def;
+struct spi_bus_xfer_def;
+
+typedef void (*SPI_BUS_DONE_HANDLER)(struct spi_bus_xfer_def *xfer, int status);
+
+
+typedef struct spi_bus_ops_def           /* board supplied bus operations */
+   {
+         // set SPI mode and clock rate. Only called between transactions.
+       int   (*configure) (void *hw, int mode, uint32_t clock_hz);
+         // start one segment. Returns 0 if started, else < 0. When it is
+         // done, the board calls spibus_segment_done(). tx == 0L: clock out
+         // rx[] as is (preset it if the device cares). rx == 0L: discard.
+       int   (*start) (void *hw, const uint8_t *tx, uint8_t *rx, uint16_t length);
+         // drive a chip select pin to the given level (0 / 1)
+       void  (*set_cs) (void *hw, int cs_pin, int level);
+   } SPI_BUS_OPS;
+
+
+typedef struct spi_bus_seg_def           /* one piece of a transaction */
+   {
+       const uint8_t  *tx;               // data to send, or 0L
+       uint8_t        *rx;               // where to put received data, or 0L
+       uint16_t       length;            // # bytes
+   } SPI_BUS_SEG;
+
+
+typedef struct spi_bus_dev_def           /* one device on the bus */
+   {
+       struct spi_bus_def  *bus;
+       uint32_t   clock_hz;              // max SCLK rate for this device
+       int16_t    cs_pin;                // pin_id of CS, -1 = none
+       uint8_t    mode;                  // SPI mode 0..3
+       uint8_t    priority;              // higher runs first
+       uint16_t   flags;                 // SPIBUS_CS_ACTIVE_HIGH
+       uint32_t   xfers;                 // # completed transactions
+       uint32_t   errors;                // # transactions that failed
+   } SPI_BUS_DEV;
+
+
+typedef struct spi_bus_xfer_def          /* one transaction: CS held for all segs */
+   {
+       struct spi_bus_xfer_def  *next;   // queue link (owned by the bus)
+       SPI_BUS_DEV   *dev;
+       const SPI_BUS_SEG *segs;          // caller's segments, must stay valid
+       uint8_t       num_segs;           //   until the callback
+       uint8_t       cur_seg;            // segment being run
+       volatile uint8_t state;           // SPIBUS_XFER_xxx
+       int           status;             // 0 = OK, else ERR_SPIBUS_xxx
+       SPI_BUS_DONE_HANDLER callback;    // optional completion callback
+       void          *cb_parm;           // for the callback's use
+   } SPI_BUS_XFER;
+
+
+typedef struct spi_bus_def               /* SPI bus control block */
+   {
+       const SPI_BUS_OPS *ops;
+       void          *hw;                // board's handle, passed to the ops
+       SPI_BUS_XFER  *queue;             // pending transactions, by priority
+       SPI_BUS_XFER  *active;            // transaction on the wire, or 0L
+       SPI_BUS_DEV   *cur_dev;           // device the SPI is configured for
+       volatile uint8_t seg_complete;    // board signalled a segment is done
+       volatile uint8_t in_run;          // spibus_run() is active
+       int           seg_status;         // status of that segment
+       uint32_t      xfers;              // # completed transactions
+       uint32_t      reconfigs;          // # mode/clock changes
+       uint32_t      errors;             // # failed transactions
+       uint16_t      queue_depth;        // # pending now
+       uint16_t      max_queue_depth;    // high water mark
+   } SPI_BUS;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+void  spibus_init (SPI_BUS *bus, const SPI_BUS_OPS *ops, void *hw);
+int   spibus_add_device (SPI_BUS *bus, SPI_BUS_DEV *dev, int mode,
+                         uint32_t clock_hz, int cs_pin, int priority, int flags);
+void  spibus_xfer_init (SPI_BUS_XFER *xfer, const SPI_BUS_SEG *segs, int num_segs,
+                        SPI_BUS_DONE_HANDLER callback, void *cb_parm);
+int   spibus_submit (SPI_BUS_DEV *dev, SPI_BUS_XFER *xfer);
+int   spibus_cancel (SPI_BUS_XFER *xfer);
+int   spibus_is_done (SPI_BUS_XFER *xfer);
+
+                   // called by the board layer (ISR level) when a segment ends
+void  spibus_segment_done (SPI_BUS *bus, int status);
+
+#endif                          //  __SPI_BUS_H__
+
+//*****************************************************************************
@@ -0,0 +1,1278 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                            telemetry_codec.c
+//
+//
+//  Allocation free CBOR / compact JSON encoder and in place decoder for
+//  MQTT telemetry and command payloads.  See telemetry_codec.h
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "telemetry_codec.h"
+
+#if defined(TCODEC_USES_FLOAT)
+#include <math.h>
+#endif
+
+            // CBOR major types  (RFC 8949)
+#define  CBOR_UINT         0
+#define  CBOR_NEGINT       1
+#define  CBOR_BYTES        2
+#define  CBOR_TEXT         3
+#define  CBOR_ARRAY        4
+#define  CBOR_MAP          5
+#define  CBOR_TAG          6
+#define  CBOR_SIMPLE       7
+
+#define  CBOR_FALSE     0xF4
+#define  CBOR_TRUE      0xF5
+#define  CBOR_NULL      0xF6
+#define  CBOR_TAG_DECIMAL  4             /* decimal fraction [exponent, mantissa] */
+
+            // decoded numbers are kept within this, so that the * 10 in
+            // tc_scale() can never overflow an int64_t
+#define  TC_NUM_LIMIT   1000000000000000LL
+
+#define  TC_DEPTH_BIT(d)   ((uint16_t) (1U << (d)))
+
+
+typedef struct tc_dec_def                /* decoder state (internal) */
+   {
+       const uint8_t  *p;                // next byte to parse
+       const uint8_t  *end;              // 1 past the end of the payload
+   } TC_DEC;
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static void  tc_put (TCODEC_ENC *enc, const void *data, int length);
+static void  tc_put_byte (TCODEC_ENC *enc, uint8_t b);
+static void  tc_cbor_head (TCODEC_ENC *enc, int major, uint32_t value);
+static void  tc_json_sep (TCODEC_ENC *enc);
+static void  tc_json_number (TCODEC_ENC *enc, int negative, uint32_t magnitude,
+                             int decimals);
+static void  tc_json_string (TCODEC_ENC *enc, const char *str, int len);
+
+static int   tc_scale (int64_t mant, int exp10, int64_t *result, int *inexact);
+static int   tc_store (const TCODEC_FIELD *fld, void *record, int64_t mant,
+                       int exp10);
+static int   tc_json_ws (TC_DEC *dec);
+static int   tc_json_string_span (TC_DEC *dec, const char **str, uint16_t *len);
+static int   tc_json_value (TC_DEC *dec, const TCODEC_FIELD *fld, void *record);
+static int   tc_json_skip (TC_DEC *dec, int depth);
+static int   tc_json_record (TC_DEC *dec, const TCODEC_FIELD *fields,
+                             int num_fields, void *record, uint32_t *mask);
+static int   tc_cbor_get_head (TC_DEC *dec, int *major, int *info, uint64_t *value);
+static int   tc_cbor_int (TC_DEC *dec, int64_t *result);
+static int   tc_cbor_value (TC_DEC *dec, const TCODEC_FIELD *fld, void *record);
+static int   tc_cbor_skip (TC_DEC *dec, int depth);
+static int   tc_cbor_record (TC_DEC *dec, const TCODEC_FIELD *fields,
+                             int num_fields, void *record, uint32_t *mask);
+static const TCODEC_FIELD *tc_find_field (const TCODEC_FIELD *fields,
+                             int num_fields, const char *key, uint16_t key_len,
+                             int *index);
+
+
+//*****************************************************************************
+//  tcodec_enc_init
+//
+//          Start encoding a payload into the caller's buffer (normally the
+//          buffer handed to MQTTPublish() as the message payload).
+//*****************************************************************************
+void  tcodec_enc_init (TCODEC_ENC *enc, void *buf, int size, int format)
+{
+    enc->buf        = (uint8_t*) buf;
+    enc->size       = (size > 0) ? (uint16_t) size : 0;
+    enc->len        = 0;
+    enc->error      = 0;
+    enc->format     = (uint8_t) format;
+    enc->depth      = 0;
+    enc->after_key  = 0;
+    enc->first_mask = TC_DEPTH_BIT(0);
+    if (buf == 0L || (format != TCODEC_CBOR && format != TCODEC_JSON))
+       enc->error = ERR_TCODEC_INVALID_PARM;
+}
+
+
+//*****************************************************************************
+//  tcodec_enc_map_begin / tcodec_enc_array_begin
+//
+//          Open a map (JSON object) or array. CBOR maps/arrays are definite
+//          length, so the number of key/value pairs or items must be given
+//          up front. JSON ignores it.
+//*****************************************************************************
+void  tcodec_enc_map_begin (TCODEC_ENC *enc, int num_pairs)
+{
+    if (enc->format == TCODEC_CBOR)
+       { tc_cbor_head (enc, CBOR_MAP, (uint32_t) num_pairs);
+         return;
+       }
+    tc_json_sep (enc);
+    tc_put_byte (enc, '{');
+    if (enc->depth >= TCODEC_MAX_DEPTH - 1)
+       { if (enc->error == 0)
+            enc->error = ERR_TCODEC_UNSUPPORTED;
+         return;
+       }
+    enc->depth++;
+    enc->first_mask |= TC_DEPTH_BIT(enc->depth);
+}
+
+void  tcodec_enc_array_begin (TCODEC_ENC *enc, int num_items)
+{
+    if (enc->format == TCODEC_CBOR)
+       { tc_cbor_head (enc, CBOR_ARRAY, (uint32_t) num_items);
+         return;
+       }
+    tc_json_sep (enc);
+    tc_put_byte (enc, '[');
+    if (enc->depth >= TCODEC_MAX_DEPTH - 1)
+       { if (enc->error == 0)
+            enc->error = ERR_TCODEC_UNSUPPORTED;
+         return;
+       }
+    enc->depth++;
+    enc->first_mask |= TC_DEPTH_BIT(enc->depth);
+}
+
+
+//*****************************************************************************
+//  tcodec_enc_map_end / tcodec_enc_array_end
+//
+//          Close a map / array. Nothing is written for CBOR.
+//*****************************************************************************
+void  tcodec_enc_map_end (TCODEC_ENC *enc)
+{
+    if (enc->format == TCODEC_CBOR)
+       return;
+    if (enc->depth == 0)
+       { if (enc->error == 0)
+            enc->error = ERR_TCODEC_INVALID_PARM;   // more ends than begins
+         return;
+       }
+    tc_put_byte (enc, '}');
+    enc->depth--;
+}
+
+void  tcodec_enc_array_end (TCODEC_ENC *enc)
+{
+    if (enc->format == TCODEC_CBOR)
+       return;
+    if (enc->depth == 0)
+       { if (enc->error == 0)
+            enc->error = ERR_TCODEC_INVALID_PARM;
+         return;
+       }
+    tc_put_byte (enc, ']');
+    enc->depth--;
+}
+
+
+//*****************************************************************************
+//  tcodec_enc_key
+//
+//          Write the key of the next map entry. Must be followed by exactly
+//          one value (or map / array).
+//*****************************************************************************
+void  tcodec_enc_key (TCODEC_ENC *enc, const char *key)
+{
+    int   len;
+
+    len = strlen (key);
+    if (enc->format == TCODEC_CBOR)
+       { tc_cbor_head (enc, CBOR_TEXT, (uint32_t) len);
+         tc_put (enc, key, len);
+         return;
+       }
+    tc_json_sep (enc);
+    tc_json_string (enc, key, len);
+    tc_put_byte (enc, ':');
+    enc->after_key = 1;                  // no ',' before the value
+}
+
+
+//*****************************************************************************
+//  tcodec_enc_int / tcodec_enc_uint
+//
+//          Write an integer. CBOR picks the shortest head (1, 2, 3 or 5
+//          bytes).
+//*****************************************************************************
+void  tcodec_enc_int (TCODEC_ENC *enc, int32_t value)
+{
+    if (value >= 0)
+       { tcodec_enc_uint (enc, (uint32_t) value);
+         return;
+       }
+    if (enc->format == TCODEC_CBOR)
+       tc_cbor_head (enc, CBOR_NEGINT, (uint32_t) (-(value + 1)));  // -1 - n
+       else { tc_json_sep (enc);
+              tc_json_number (enc, 1, 0U - (uint32_t) value, 0);
+            }
+}
+
+void  tcodec_enc_uint (TCODEC_ENC *enc, uint32_t value)
+{
+    if (enc->format == TCODEC_CBOR)
+       tc_cbor_head (enc, CBOR_UINT, value);
+       else { tc_json_sep (enc);
+              tc_json_number (enc, 0, value, 0);
+            }
+}
+
+
+//*****************************************************************************
+//  tcodec_enc_fixed
+//
+//          Write a fixed point value: value / 10^decimals.
+//
+//          JSON:  tcodec_enc_fixed (enc, -2345, 2)  ->  -23.45
+//          CBOR:  decimal fraction  4([-2, -2345])  (decimals == 0 is
+//                 written as a plain integer).
+//*****************************************************************************
+void  tcodec_enc_fixed (TCODEC_ENC *enc, int32_t value, int decimals)
+{
+    if (decimals <= 0)
+       { tcodec_enc_int (enc, value);
+         return;
+       }
+    if (enc->format == TCODEC_CBOR)
+       { tc_cbor_head (enc, CBOR_TAG, CBOR_TAG_DECIMAL);
+         tc_cbor_head (enc, CBOR_ARRAY, 2);
+         tc_cbor_head (enc, CBOR_NEGINT, (uint32_t) (decimals - 1)); // exp = -decimals
+         tcodec_enc_int (enc, value);
+         return;
+       }
+    tc_json_sep (enc);
+    if (value < 0)
+       tc_json_number (enc, 1, 0U - (uint32_t) value, decimals);
+       else tc_json_number (enc, 0, (uint32_t) value, decimals);
+}
+
+
+//*****************************************************************************
+//  tcodec_enc_bool / tcodec_enc_null
+//*****************************************************************************
+void  tcodec_enc_bool (TCODEC_ENC *enc, int value)
+{
+    if (enc->format == TCODEC_CBOR)
+       tc_put_byte (enc, value ? CBOR_TRUE : CBOR_FALSE);
+       else { tc_json_sep (enc);
+              if (value)
+                 tc_put (enc, "true", 4);
+                 else tc_put (enc, "false", 5);
+            }
+}
+
+void  tcodec_enc_null (TCODEC_ENC *enc)
+{
+    if (enc->format == TCODEC_CBOR)
+       tc_put_byte (enc, CBOR_NULL);
+       else { tc_json_sep (enc);
+              tc_put (enc, "null", 4);
+            }
+}
+
+
+//*****************************************************************************
+//  tcodec_enc_str
+//
+//          Write a text string. len < 0 means str is \0 terminated.
+//          JSON escapes " \ and control characters.
+//*****************************************************************************
+void  tcodec_enc_str (TCODEC_ENC *enc, const char *str, int len)
+{
+    if (str == 0L)
+       { tcodec_enc_null (enc);
+         return;
+       }
+    if (len < 0)
+       len = strlen (str);
+    if (enc->format == TCODEC_CBOR)
+       { tc_cbor_head (enc, CBOR_TEXT, (uint32_t) len);
+         tc_put (enc, str, len);
+         return;
+       }
+    tc_json_sep (enc);
+    tc_json_string (enc, str, len);
+}
+
+
+//*****************************************************************************
+//  tcodec_enc_record
+//
+//          Write a record as one map, using its field table: one entry per
+//          field, keyed by the field's name.
+//*****************************************************************************
+void  tcodec_enc_record (TCODEC_ENC *enc, const TCODEC_FIELD *fields,
+                         int num_fields, const void *record)
+{
+    const uint8_t     *rec;
+    const TCODEC_STR  *s;
+    int               i;
+
+    if (fields == 0L || record == 0L || num_fields < 0)
+       { if (enc->error == 0)
+            enc->error = ERR_TCODEC_INVALID_PARM;
+         return;
+       }
+    rec = (const uint8_t*) record;
+
+    tcodec_enc_map_begin (enc, num_fields);
+    for (i = 0;  i < num_fields;  i++, fields++)
+      {
+        tcodec_enc_key (enc, fields->name);
+        switch (fields->type)
+          {
+            case TCODEC_T_INT32:
+                    tcodec_enc_int (enc, *(const int32_t*) (rec + fields->offset));
+                    break;
+            case TCODEC_T_UINT32:
+                    tcodec_enc_uint (enc, *(const uint32_t*) (rec + fields->offset));
+                    break;
+            case TCODEC_T_INT16:
+                    tcodec_enc_int (enc, *(const int16_t*) (rec + fields->offset));
+                    break;
+            case TCODEC_T_UINT16:
+                    tcodec_enc_uint (enc, *(const uint16_t*) (rec + fields->offset));
+                    break;
+            case TCODEC_T_UINT8:
+                    tcodec_enc_uint (enc, *(const uint8_t*) (rec + fields->offset));
+                    break;
+            case TCODEC_T_BOOL:
+                    tcodec_enc_bool (enc, *(const uint8_t*) (rec + fields->offset));
+                    break;
+            case TCODEC_T_FIXED32:
+                    tcodec_enc_fixed (enc, *(const int32_t*) (rec + fields->offset),
+                                      fields->decimals);
+                    break;
+            case TCODEC_T_FIXED16:
+                    tcodec_enc_fixed (enc, *(const int16_t*) (rec + fields->offset),
+                                      fields->decimals);
+                    break;
+            case TCODEC_T_STR:
+                    s = (const TCODEC_STR*) (rec + fields->offset);
+                    tcodec_enc_str (enc, s->ptr, s->len);
+                    break;
+            default:
+                    tcodec_enc_null (enc);      // keep CBOR pair count right
+                    if (enc->error == 0)
+                       enc->error = ERR_TCODEC_INVALID_PARM;
+                    break;
+          }
+      }
+    tcodec_enc_map_end (enc);
+}
+
+
+//*****************************************************************************
+//  tcodec_enc_finish
+//
+//          Returns the payload length, or the first error hit while encoding
+//          (ERR_TCODEC_OVERFLOW if the buffer was too small).
+//
+//          A JSON payload is also \0 terminated when there is room for it
+//          (not counted in the length), so it can be printed as is.
+//*****************************************************************************
+int  tcodec_enc_finish (TCODEC_ENC *enc)
+{
+    if (enc->error != 0)
+       return (enc->error);
+    if (enc->format == TCODEC_JSON)
+       { if (enc->depth != 0)
+            return (ERR_TCODEC_INVALID_PARM);     // unclosed map / array
+         if (enc->len < enc->size)
+            enc->buf [enc->len] = '\0';
+       }
+    return (enc->len);
+}
+
+
+//*****************************************************************************
+//  tcodec_dec_record
+//
+//          Decode a map payload into a record, in place: numbers are
+//          converted straight into the record's members, strings
+//          (TCODEC_T_STR) point into the payload, so the payload must stay
+//          intact for as long as they are used.
+//
+//          Keys that are not in the field table are skipped (including any
+//          nested maps / arrays under them). Fields that are absent, or
+//          null, are left as they were.
+//
+//          found_mask (optional) gets bit n set for each fields[n] that was
+//          stored (the first 32 fields).
+//
+//          Returns the number of fields stored, or ERR_TCODEC_xxx. On an
+//          error, fields stored before it keep their new values.
+//*****************************************************************************
+int  tcodec_dec_record (const void *payload, int len, int format,
+                        const TCODEC_FIELD *fields, int num_fields,
+                        void *record, uint32_t *found_mask)
+{
+    TC_DEC    dec;
+    uint32_t  mask;
+    int       rc;
+
+    if (found_mask != 0L)
+       *found_mask = 0;
+    if (payload == 0L || len <= 0 || fields == 0L || record == 0L
+       || num_fields < 0)
+       return (ERR_TCODEC_INVALID_PARM);
+
+    dec.p   = (const uint8_t*) payload;
+    dec.end = dec.p + len;
+
+    if (format == TCODEC_AUTO)
+       {       // a JSON object starts with '{'. 0x7B in CBOR would be a text
+               // string with an 8 byte length: never a valid top level map.
+         format = TCODEC_CBOR;
+         while (dec.p < dec.end && (*dec.p == ' ' || *dec.p == '\t'
+                                    || *dec.p == '\r' || *dec.p == '\n'))
+           dec.p++;
+         if (dec.p < dec.end && *dec.p == '{')
+            format = TCODEC_JSON;
+         dec.p = (const uint8_t*) payload;
+       }
+
+    mask = 0;
+    if (format == TCODEC_JSON)
+       rc = tc_json_record (&dec, fields, num_fields, record, &mask);
+       else if (format == TCODEC_CBOR)
+               rc = tc_cbor_record (&dec, fields, num_fields, record, &mask);
+               else return (ERR_TCODEC_INVALID_PARM);
+
+    if (found_mask != 0L)
+       *found_mask = mask;
+    return (rc);
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+//                           Encoder internals
+//*****************************************************************************
+//*****************************************************************************
+
+//*****************************************************************************
+//  tc_put / tc_put_byte
+//
+//          Append bytes to the output. Once the buffer is full, nothing more
+//          is written and the encoder stays in error.
+//*****************************************************************************
+static void  tc_put (TCODEC_ENC *enc, const void *data, int length)
+{
+    if (enc->error != 0)
+       return;
+    if (length > (int) (enc->size - enc->len))
+       { enc->error = ERR_TCODEC_OVERFLOW;
+         return;
+       }
+    memcpy (enc->buf + enc->len, data, length);
+    enc->len += length;
+}
+
+static void  tc_put_byte (TCODEC_ENC *enc, uint8_t b)
+{
+    if (enc->error != 0)
+       return;
+    if (enc->len >= enc->size)
+       { enc->error = ERR_TCODEC_OVERFLOW;
+         return;
+       }
+    enc->buf [enc->len++] = b;
+}
+
+
+//*****************************************************************************
+//  tc_cbor_head
+//
+//          Write a CBOR initial byte + argument, shortest form.
+//*****************************************************************************
+static void  tc_cbor_head (TCODEC_ENC *enc, int major, uint32_t value)
+{
+    uint8_t   hd [5];
+    int       n;
+
+    major <<= 5;
+    if (value < 24)
+       { hd[0] = (uint8_t) (major | value);
+         n = 1;
+       }
+    else if (value <= 0xFF)
+       { hd[0] = (uint8_t) (major | 24);
+         hd[1] = (uint8_t) value;
+         n = 2;
+       }
+    else if (value <= 0xFFFF)
+       { hd[0] = (uint8_t) (major | 25);
+         hd[1] = (uint8_t) (value >> 8);
+         hd[2] = (uint8_t) value;
+         n = 3;
+       }
+    else
+       { hd[0] = (uint8_t) (major | 26);
+         hd[1] = (uint8_t) (value >> 24);
+         hd[2] = (uint8_t) (value >> 16);
+         hd[3] = (uint8_t) (value >> 8);
+         hd[4] = (uint8_t) value;
+         n = 5;
+       }
+    tc_put (enc, hd, n);
+}
+
+
+//*****************************************************************************
+//  tc_json_sep
+//
+//          Write the ',' needed before a key, or before an array item.
+//          Not needed for the value that follows a key.
+//*****************************************************************************
+static void  tc_json_sep (TCODEC_ENC *enc)
+{
+    if (enc->after_key)
+       { enc->after_key = 0;
+         return;
+       }
+    if (enc->first_mask & TC_DEPTH_BIT(enc->depth))
+       enc->first_mask &= ~TC_DEPTH_BIT(enc->depth);
+       else tc_put_byte (enc, ',');
+}
+
+
+//*****************************************************************************
+//  tc_json_number
+//
+//          Write [-]magnitude, with a '.' inserted "decimals" digits from
+//          the right (zero padded:  5, 2 -> 0.05).
+//*****************************************************************************
+static void  tc_json_number (TCODEC_ENC *enc, int negative, uint32_t magnitude,
+                             int decimals)
+{
+    char   digits [24];
+    int    n;
+
+    n = sizeof(digits);
+    do {                                 // built right to left
+         digits [--n] = (char) ('0' + (magnitude % 10));
+         magnitude /= 10;
+         if (--decimals == 0)
+            digits [--n] = '.';
+       } while ((magnitude != 0 || decimals >= 0) && n > 2);
+    if (negative)
+       digits [--n] = '-';
+    tc_put (enc, &digits[n], sizeof(digits) - n);
+}
+
+
+//*****************************************************************************
+//  tc_json_string
+//
+//          Write a quoted JSON string. Runs of plain characters are copied
+//          in one go.
+//*****************************************************************************
+static void  tc_json_string (TCODEC_ENC *enc, const char *str, int len)
+{
+    static const char  hex [] = "0123456789abcdef";
+    char   esc [6];
+    int    i, run;
+    uint8_t c;
+
+    tc_put_byte (enc, '"');
+    for (i = 0, run = 0;  i < len;  i++)
+      {
+        c = (uint8_t) str[i];
+        if (c >= 0x20 && c != '"' && c != '\\')
+           continue;
+        tc_put (enc, str + run, i - run);         // plain chars so far
+        run = i + 1;
+        esc[0] = '\\';
+        if (c == '"' || c == '\\')
+           { esc[1] = (char) c;
+             tc_put (enc, esc, 2);
+           }
+        else if (c == '\n')
+           { esc[1] = 'n';
+             tc_put (enc, esc, 2);
+           }
+        else
+           { esc[1] = 'u';  esc[2] = '0';  esc[3] = '0';
+             esc[4] = hex [c >> 4];
+             esc[5] = hex [c & 0x0F];
+             tc_put (enc, esc, 6);
+           }
+      }
+    tc_put (enc, str + run, len - run);
+    tc_put_byte (enc, '"');
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+//                           Decoder internals
+//*****************************************************************************
+//*****************************************************************************
+
+//*****************************************************************************
+//  tc_scale
+//
+//          result = mant * 10^exp10, rounded half away from zero.
+//          inexact is set if non zero digits were dropped.
+//*****************************************************************************
+static int  tc_scale (int64_t mant, int exp10, int64_t *result, int *inexact)
+{
+    int64_t  rem;
+
+    *inexact = 0;
+    for ( ;  exp10 > 0;  exp10--)
+      { if (mant >= TC_NUM_LIMIT || mant <= -TC_NUM_LIMIT)
+           return (ERR_TCODEC_RANGE);
+        mant *= 10;
+      }
+    for ( ;  exp10 < 0;  exp10++)
+      { rem   = mant % 10;
+        mant /= 10;
+        if (rem != 0)
+           *inexact = 1;
+        if (exp10 == -1)                 // last digit dropped: round on it
+           { if (rem >= 5)
+                mant++;
+             else if (rem <= -5)
+                mant--;
+           }
+      }
+    *result = mant;
+    return (0);
+}
+
+
+//*****************************************************************************
+//  tc_store
+//
+//          Store the number mant * 10^exp10 into a record field, checking
+//          that it fits. FIXED fields are scaled by their decimals. Integer
+//          fields do not take fractions (1.5 -> ERR_TCODEC_TYPE, 2.0 is ok).
+//*****************************************************************************
+static int  tc_store (const TCODEC_FIELD *fld, void *record, int64_t mant,
+                      int exp10)
+{
+    uint8_t  *dst;
+    int64_t  v;
+    int      inexact, rc;
+
+    if (fld->type == TCODEC_T_FIXED32 || fld->type == TCODEC_T_FIXED16)
+       exp10 += fld->decimals;
+       else if (fld->type == TCODEC_T_STR)
+               return (ERR_TCODEC_TYPE);
+
+    rc = tc_scale (mant, exp10, &v, &inexact);
+    if (rc < 0)
+       return (rc);
+    if (inexact && fld->type != TCODEC_T_FIXED32 && fld->type != TCODEC_T_FIXED16)
+       return (ERR_TCODEC_TYPE);
+
+    dst = (uint8_t*) record + fld->offset;
+    switch (fld->type)
+      {
+        case TCODEC_T_INT32:
+        case TCODEC_T_FIXED32:
+                if (v < INT32_MIN || v > INT32_MAX)
+                   return (ERR_TCODEC_RANGE);
+                *(int32_t*) dst = (int32_t) v;
+                break;
+        case TCODEC_T_UINT32:
+                if (v < 0 || v > UINT32_MAX)
+                   return (ERR_TCODEC_RANGE);
+                *(uint32_t*) dst = (uint32_t) v;
+                break;
+        case TCODEC_T_INT16:
+        case TCODEC_T_FIXED16:
+                if (v < INT16_MIN || v > INT16_MAX)
+                   return (ERR_TCODEC_RANGE);
+                *(int16_t*) dst = (int16_t) v;
+                break;
+        case TCODEC_T_UINT16:
+                if (v < 0 || v > UINT16_MAX)
+                   return (ERR_TCODEC_RANGE);
+                *(uint16_t*) dst = (uint16_t) v;
+                break;
+        case TCODEC_T_UINT8:
+                if (v < 0 || v > UINT8_MAX)
+                   return (ERR_TCODEC_RANGE);
+                *(uint8_t*) dst = (uint8_t) v;
+                break;
+        case TCODEC_T_BOOL:
+                if (v < 0 || v > 1)
+                   return (ERR_TCODEC_RANGE);
+                *(uint8_t*) dst = (uint8_t) v;
+                break;
+        default:
+                return (ERR_TCODEC_INVALID_PARM);
+      }
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  tc_find_field
+//
+//          Look up a (not \0 terminated) key in the field table.
+//*****************************************************************************
+static const TCODEC_FIELD *tc_find_field (const TCODEC_FIELD *fields,
+                             int num_fields, const char *key, uint16_t key_len,
+                             int *index)
+{
+    int   i;
+
+    for (i = 0;  i < num_fields;  i++)
+      if (strlen (fields[i].name) == key_len
+         && memcmp (fields[i].name, key, key_len) == 0)
+         { *index = i;
+           return (&fields[i]);
+         }
+    return (0L);                         // not one of ours
+}
+
+
+//*****************************************************************************
+//  tc_json_ws
+//
+//          Skip white space. Returns the next char, or -1 at end of payload.
+//*****************************************************************************
+static int  tc_json_ws (TC_DEC *dec)
+{
+    while (dec->p < dec->end)
+      { if (*dec->p != ' ' && *dec->p != '\t' && *dec->p != '\r' && *dec->p != '\n')
+           return (*dec->p);
+        dec->p++;
+      }
+    return (-1);
+}
+
+
+//*****************************************************************************
+//  tc_json_string_span
+//
+//          Parse a quoted string in place: str/len get the raw characters
+//          between the quotes (escapes are left as is).
+//*****************************************************************************
+static int  tc_json_string_span (TC_DEC *dec, const char **str, uint16_t *len)
+{
+    const uint8_t  *start;
+
+    if (dec->p >= dec->end || *dec->p != '"')
+       return (ERR_TCODEC_SYNTAX);
+    start = ++dec->p;
+    while (dec->p < dec->end && *dec->p != '"')
+      { if (*dec->p == '\\')
+           dec->p++;                     // skip the escaped char
+        dec->p++;
+      }
+    if (dec->p >= dec->end)
+       return (ERR_TCODEC_SYNTAX);       // no closing quote
+    *str = (const char*) start;
+    *len = (uint16_t) (dec->p - start);
+    dec->p++;                            // step past closing "
+    return (0);
+}
+
+
+//*****************************************************************************
+//  tc_json_value
+//
+//          Parse the value for a known field and store it.
+//          Returns 1 if stored, 0 if null, else ERR_TCODEC_xxx.
+//*****************************************************************************
+static int  tc_json_value (TC_DEC *dec, const TCODEC_FIELD *fld, void *record)
+{
+    TCODEC_STR  *s;
+    const char  *str;
+    uint16_t    len;
+    int64_t     mant;
+    int         c, neg, exp10, rc, digits;
+
+    c = tc_json_ws (dec);
+    if (c == '"')
+       { if (fld->type != TCODEC_T_STR)
+            return (ERR_TCODEC_TYPE);
+         rc = tc_json_string_span (dec, &str, &len);
+         if (rc < 0)
+            return (rc);
+         s = (TCODEC_STR*) ((uint8_t*) record + fld->offset);
+         s->ptr = str;
+         s->len = len;
+         return (1);
+       }
+    if (c == 't' || c == 'f' || c == 'n')
+       {       // true / false / null
+         if (dec->end - dec->p >= 4 && memcmp (dec->p, "true", 4) == 0)
+            { dec->p += 4;
+              mant = 1;
+            }
+         else if (dec->end - dec->p >= 5 && memcmp (dec->p, "false", 5) == 0)
+            { dec->p += 5;
+              mant = 0;
+            }
+         else if (dec->end - dec->p >= 4 && memcmp (dec->p, "null", 4) == 0)
+            { dec->p += 4;
+              return (0);                // leave the field as is
+            }
+         else return (ERR_TCODEC_SYNTAX);
+         if (fld->type != TCODEC_T_BOOL)
+            return (ERR_TCODEC_TYPE);
+         rc = tc_store (fld, record, mant, 0);
+         return ((rc < 0) ? rc : 1);
+       }
+
+       //  number:  -?digits(.digits)?   Exponents are not supported.
+    neg = 0;
+    if (c == '-')
+       { neg = 1;
+         dec->p++;
+       }
+    mant   = 0;
+    exp10  = 0;
+    digits = 0;
+    while (dec->p < dec->end && *dec->p >= '0' && *dec->p <= '9')
+      { if (mant >= TC_NUM_LIMIT)
+           return (ERR_TCODEC_RANGE);
+        mant = mant * 10 + (*dec->p++ - '0');
+        digits++;
+      }
+    if (dec->p < dec->end && *dec->p == '.')
+       { dec->p++;
+         while (dec->p < dec->end && *dec->p >= '0' && *dec->p <= '9')
+           { if (mant < TC_NUM_LIMIT)
+                { mant = mant * 10 + (*dec->p - '0');
+                  exp10--;
+                }                        // else: digits past int64 are ignored
+             dec->p++;
+             digits++;
+           }
+       }
+    if (digits == 0)
+       return (ERR_TCODEC_SYNTAX);
+    if (dec->p < dec->end && (*dec->p == 'e' || *dec->p == 'E'))
+       return (ERR_TCODEC_UNSUPPORTED);
+    if (fld->type == TCODEC_T_STR)
+       return (ERR_TCODEC_TYPE);
+    rc = tc_store (fld, record, neg ? -mant : mant, exp10);
+    return ((rc < 0) ? rc : 1);
+}
+
+
+//*****************************************************************************
+//  tc_json_skip
+//
+//          Skip over one value of any type (for keys we do not know).
+//*****************************************************************************
+static int  tc_json_skip (TC_DEC *dec, int depth)
+{
+    const char  *str;
+    uint16_t    len;
+    int         c, rc, close;
+
+    c = tc_json_ws (dec);
+    if (c == '"')
+       return (tc_json_string_span (dec, &str, &len));
+    if (c == '{' || c == '[')
+       { if (depth >= TCODEC_MAX_DEPTH)
+            return (ERR_TCODEC_UNSUPPORTED);
+         close = (c == '{') ? '}' : ']';
+         dec->p++;
+         if (tc_json_ws (dec) == close)
+            { dec->p++;
+              return (0);                // empty
+            }
+         for ( ; ; )
+           { if (close == '}')
+                { tc_json_ws (dec);
+                  rc = tc_json_string_span (dec, &str, &len);   // key
+                  if (rc < 0)
+                     return (rc);
+                  if (tc_json_ws (dec) != ':')
+                     return (ERR_TCODEC_SYNTAX);
+                  dec->p++;
+                }
+             rc = tc_json_skip (dec, depth + 1);
+             if (rc < 0)
+                return (rc);
+             c = tc_json_ws (dec);
+             dec->p++;
+             if (c == close)
+                return (0);
+             if (c != ',')
+                return (ERR_TCODEC_SYNTAX);
+           }
+       }
+       // number / true / false / null: runs to the next delimiter
+    if (c < 0)
+       return (ERR_TCODEC_SYNTAX);
+    while (dec->p < dec->end && *dec->p != ',' && *dec->p != '}'
+           && *dec->p != ']' && *dec->p != ' ' && *dec->p != '\t'
+           && *dec->p != '\r' && *dec->p != '\n')
+      dec->p++;
+    return (0);
+}
+
+
+//*****************************************************************************
+//  tc_json_record
+//
+//          Parse a top level JSON object into a record.
+//*****************************************************************************
+static int  tc_json_record (TC_DEC *dec, const TCODEC_FIELD *fields,
+                            int num_fields, void *record, uint32_t *mask)
+{
+    const TCODEC_FIELD  *fld;
+    const char  *key;
+    uint16_t    key_len;
+    int         c, rc, index, stored;
+
+    if (tc_json_ws (dec) != '{')
+       return (ERR_TCODEC_SYNTAX);
+    dec->p++;
+    if (tc_json_ws (dec) == '}')
+       return (0);                       // {}
+
+    stored = 0;
+    for ( ; ; )
+      { tc_json_ws (dec);
+        rc = tc_json_string_span (dec, &key, &key_len);
+        if (rc < 0)
+           return (rc);
+        if (tc_json_ws (dec) != ':')
+           return (ERR_TCODEC_SYNTAX);
+        dec->p++;
+        fld = tc_find_field (fields, num_fields, key, key_len, &index);
+        if (fld != 0L)
+           { rc = tc_json_value (dec, fld, record);
+             if (rc > 0)
+                { stored++;
+                  if (index < 32)
+                     *mask |= (1UL << index);
+                }
+           }
+           else rc = tc_json_skip (dec, 1);
+        if (rc < 0)
+           return (rc);
+        c = tc_json_ws (dec);
+        dec->p++;
+        if (c == '}')
+           return (stored);
+        if (c != ',')
+           return (ERR_TCODEC_SYNTAX);
+      }
+}
+
+
+//*****************************************************************************
+//  tc_cbor_get_head
+//
+//          Parse a CBOR initial byte + argument.
+//*****************************************************************************
+static int  tc_cbor_get_head (TC_DEC *dec, int *major, int *info, uint64_t *value)
+{
+    int   n;
+
+    if (dec->p >= dec->end)
+       return (ERR_TCODEC_SYNTAX);
+    *major = *dec->p >> 5;
+    *info  = *dec->p & 0x1F;
+    dec->p++;
+    if (*info < 24)
+       { *value = (uint64_t) *info;
+         return (0);
+       }
+    if (*info == 31)
+       return (ERR_TCODEC_UNSUPPORTED);  // indefinite length
+    if (*info > 27)
+       return (ERR_TCODEC_SYNTAX);       // reserved
+    n = 1 << (*info - 24);               // 1, 2, 4 or 8 bytes follow
+    if (dec->end - dec->p < n)
+       return (ERR_TCODEC_SYNTAX);
+    *value = 0;
+    while (n-- > 0)
+      *value = (*value << 8) | *dec->p++;
+    return (0);
+}
+
+
+//*****************************************************************************
+//  tc_cbor_int
+//
+//          Parse an integer (major type 0 or 1).
+//*****************************************************************************
+static int  tc_cbor_int (TC_DEC *dec, int64_t *result)
+{
+    uint64_t  val;
+    int       major, info, rc;
+
+    rc = tc_cbor_get_head (dec, &major, &info, &val);
+    if (rc < 0)
+       return (rc);
+    if (major != CBOR_UINT && major != CBOR_NEGINT)
+       return (ERR_TCODEC_TYPE);
+    if (val >= (uint64_t) TC_NUM_LIMIT)
+       return (ERR_TCODEC_RANGE);
+    *result = (major == CBOR_UINT) ? (int64_t) val : -1 - (int64_t) val;
+    return (0);
+}
+
+
+#if defined(TCODEC_USES_FLOAT)
+//*****************************************************************************
+//  tc_cbor_float
+//
+//          Convert a CBOR half / single / double to mant * 10^-decimals.
+//*****************************************************************************
+static int  tc_cbor_float (int info, uint64_t bits, int decimals, int64_t *mant)
+{
+    double    d;
+    float     f;
+    uint32_t  f32;
+    int       e, m;
+
+    if (info == 25)
+       { e = (int) ((bits >> 10) & 0x1F);     // IEEE 754 half
+         m = (int) (bits & 0x3FF);
+         if (e == 31)
+            return (ERR_TCODEC_RANGE);        // inf / NaN
+         d = (e == 0) ? ldexp (m, -24) : ldexp (m + 1024, e - 25);
+         if (bits & 0x8000)
+            d = -d;
+       }
+    else if (info == 26)
+       { f32 = (uint32_t) bits;
+         memcpy (&f, &f32, 4);
+         d = f;
+       }
+    else memcpy (&d, &bits, 8);
+    if (d != d)
+       return (ERR_TCODEC_RANGE);             // NaN
+    while (decimals-- > 0)
+      d *= 10.0;
+    if (d >= (double) TC_NUM_LIMIT || d <= -(double) TC_NUM_LIMIT)
+       return (ERR_TCODEC_RANGE);
+    *mant = (int64_t) ((d < 0) ? d - 0.5 : d + 0.5);
+    return (0);
+}
+#endif
+
+
+//*****************************************************************************
+//  tc_cbor_value
+//
+//          Parse the value for a known field and store it.
+//          Returns 1 if stored, 0 if null / undefined, else ERR_TCODEC_xxx.
+//*****************************************************************************
+static int  tc_cbor_value (TC_DEC *dec, const TCODEC_FIELD *fld, void *record)
+{
+    TCODEC_STR  *s;
+    uint64_t    val;
+    int64_t     mant, exp10;
+    int         major, info, rc;
+
+    rc = tc_cbor_get_head (dec, &major, &info, &val);
+    if (rc < 0)
+       return (rc);
+    switch (major)
+      {
+        case CBOR_UINT:
+        case CBOR_NEGINT:
+                if (val >= (uint64_t) TC_NUM_LIMIT)
+                   return (ERR_TCODEC_RANGE);
+                mant = (major == CBOR_UINT) ? (int64_t) val : -1 - (int64_t) val;
+                rc   = tc_store (fld, record, mant, 0);
+                break;
+
+        case CBOR_BYTES:
+        case CBOR_TEXT:
+                if (val > (uint64_t) (dec->end - dec->p))
+                   return (ERR_TCODEC_SYNTAX);
+                if (fld->type != TCODEC_T_STR)
+                   return (ERR_TCODEC_TYPE);
+                s = (TCODEC_STR*) ((uint8_t*) record + fld->offset);
+                s->ptr  = (const char*) dec->p;
+                s->len  = (uint16_t) val;
+                dec->p += (int) val;
+                return (1);
+
+        case CBOR_TAG:
+                if (val != CBOR_TAG_DECIMAL)
+                   return (ERR_TCODEC_TYPE);
+                rc = tc_cbor_get_head (dec, &major, &info, &val);
+                if (rc < 0)
+                   return (rc);
+                if (major != CBOR_ARRAY || val != 2)
+                   return (ERR_TCODEC_SYNTAX);
+                rc = tc_cbor_int (dec, &exp10);
+                if (rc == 0)
+                   rc = tc_cbor_int (dec, &mant);
+                if (rc < 0)
+                   return (rc);
+                if (exp10 < -20 || exp10 > 20)
+                   return (ERR_TCODEC_RANGE);
+                rc = tc_store (fld, record, mant, (int) exp10);
+                break;
+
+        case CBOR_SIMPLE:
+                if (info == 20 || info == 21)            // false / true
+                   { if (fld->type != TCODEC_T_BOOL)
+                        return (ERR_TCODEC_TYPE);
+                     rc = tc_store (fld, record, info - 20, 0);
+                     break;
+                   }
+                if (info == 22 || info == 23)            // null / undefined
+                   return (0);
+#if defined(TCODEC_USES_FLOAT)
+                if (info >= 25 && info <= 27)
+                   { if (fld->type == TCODEC_T_STR || fld->type == TCODEC_T_BOOL)
+                        return (ERR_TCODEC_TYPE);
+                     rc = tc_cbor_float (info, val, (fld->type == TCODEC_T_FIXED32
+                                         || fld->type == TCODEC_T_FIXED16)
+                                         ? fld->decimals : 0, &mant);
+                     if (rc == 0)
+                        rc = tc_store (fld, record, mant,
+                                       (fld->type == TCODEC_T_FIXED32
+                                        || fld->type == TCODEC_T_FIXED16)
+                                       ? -fld->decimals : 0);
+                     break;
+                   }
+#endif
+                return ((info >= 25 && info <= 27) ? ERR_TCODEC_UNSUPPORTED
+                                                   : ERR_TCODEC_TYPE);
+
+        default:                         // array / map: not a field value
+                return (ERR_TCODEC_TYPE);
+      }
+    return ((rc < 0) ? rc : 1);
+}
+
+
+//*****************************************************************************
+//  tc_cbor_skip
+//
+//          Skip over one item of any type, including everything nested in it.
+//*****************************************************************************
+static int  tc_cbor_skip (TC_DEC *dec, int depth)
+{
+    uint64_t  val, i;
+    int       major, info, rc;
+
+    if (depth > TCODEC_MAX_DEPTH)
+       return (ERR_TCODEC_UNSUPPORTED);
+    rc = tc_cbor_get_head (dec, &major, &info, &val);
+    if (rc < 0)
+       return (rc);
+    switch (major)
+      {
+        case CBOR_BYTES:
+        case CBOR_TEXT:
+                if (val > (uint64_t) (dec->end - dec->p))
+                   return (ERR_TCODEC_SYNTAX);
+                dec->p += (int) val;
+                break;
+        case CBOR_MAP:
+                if (val > (uint64_t) (dec->end - dec->p))
+                   return (ERR_TCODEC_SYNTAX);   // each item is >= 1 byte
+                val *= 2;
+                            // fall through
+        case CBOR_ARRAY:
+                if (val > (uint64_t) (dec->end - dec->p))
+                   return (ERR_TCODEC_SYNTAX);
+                for (i = 0;  i < val;  i++)
+                  { rc = tc_cbor_skip (dec, depth + 1);
+                    if (rc < 0)
+                       return (rc);
+                  }
+                break;
+        case CBOR_TAG:
+                return (tc_cbor_skip (dec, depth + 1));   // the tagged item
+        default:                         // ints, simple, floats: head only
+                break;
+      }
+    return (0);
+}
+
+
+//*****************************************************************************
+//  tc_cbor_record
+//
+//          Parse a top level CBOR map into a record. Keys that are not text
+//          strings are skipped, along with their values.
+//*****************************************************************************
+static int  tc_cbor_record (TC_DEC *dec, const TCODEC_FIELD *fields,
+                            int num_fields, void *record, uint32_t *mask)
+{
+    const TCODEC_FIELD  *fld;
+    uint64_t    num_pairs, i, key_len;
+    const uint8_t *save;
+    int         major, info, rc, index, stored;
+
+    rc = tc_cbor_get_head (dec, &major, &info, &num_pairs);
+    if (rc < 0)
+       return (rc);
+    if (major != CBOR_MAP)
+       return (ERR_TCODEC_SYNTAX);
+
+    stored = 0;
+    for (i = 0;  i < num_pairs;  i++)
+      { save = dec->p;
+        rc = tc_cbor_get_head (dec, &major, &info, &key_len);
+        if (rc < 0)
+           return (rc);
+        fld = 0L;
+        if (major == CBOR_TEXT)
+           { if (key_len > (uint64_t) (dec->end - dec->p))
+                return (ERR_TCODEC_SYNTAX);
+             fld = tc_find_field (fields, num_fields, (const char*) dec->p,
+                                  (uint16_t) key_len, &index);
+             dec->p += (int) key_len;
+           }
+           else { dec->p = save;         // not a text key: skip the key
+                  rc = tc_cbor_skip (dec, 1);
+                  if (rc < 0)
+                     return (rc);
+                }
+        if (fld != 0L)
+           { rc = tc_cbor_value (dec, fld, record);
+             if (rc > 0)
+                { stored++;
+                  if (index < 32)
+                     *mask |= (1UL << index);
+                }
+           }
+           else rc = tc_cbor_skip (dec, 1);
+        if (rc < 0)
+           return (rc);
+      }
+    return (stored);
+}
+
+//*****************************************************************************
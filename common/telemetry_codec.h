@@ -0,0 +1,155 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                             telemetry_codec.h
+//
+//
+//  Definitions for the allocation free CBOR / compact JSON telemetry codec,
+//  used for MQTT payloads.
+//
+//  Encoding streams straight into the caller's transmit buffer: no heap,
+//  no sprintf, no intermediate strings. Decoding parses a received payload
+//  in place: numbers are converted directly into the caller's record, and
+//  strings are returned as (pointer, length) into the payload itself.
+//
+//  A record (a C struct of process image points, or of command parms) is
+//  described by a field table, built at compile time from the struct:
+//
+//      typedef struct { int16_t temp;  uint16_t hum;  uint32_t count; } ENV_REC;
+//
+//      const TCODEC_FIELD  env_fields[] =
+//         { TCODEC_FIELD_NAMED ("t",  ENV_REC, temp,  TCODEC_T_FIXED16,  1),
+//           TCODEC_FIELD_NAMED ("h",  ENV_REC, hum,   TCODEC_T_UINT16,   0),
+//           TCODEC_FIELD       (ENV_REC, count,       TCODEC_T_UINT32,   0) };
+//
+//      tcodec_enc_init (&enc, payload_buf, sizeof(payload_buf), TCODEC_JSON);
+//      tcodec_enc_record (&enc, env_fields, TCODEC_NUM_FIELDS(env_fields), &env);
+//      len = tcodec_enc_finish (&enc);       {"t":23.4,"h":41,"count":17}
+//
+//      n = tcodec_dec_record (payload, payloadlen, TCODEC_AUTO,
+//                             cmd_fields, TCODEC_NUM_FIELDS(cmd_fields),
+//                             &cmd, &found_mask);
+//
+//  Fixed point fields hold value * 10^decimals (temp 234 = 23.4 above).
+//  They are sent as decimal numbers in JSON, and as CBOR decimal fractions
+//  (tag 4, RFC 8949), so no floating point is needed on either side.
+//
+//  JSON subset: objects, arrays, strings, integers and decimals (no
+//  exponents), true/false/null. Decoded strings are returned raw: escape
+//  sequences are not expanded. CBOR: definite length items only. CBOR
+//  floats are only accepted if TCODEC_USES_FLOAT is defined.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __TELEMETRY_CODEC_H__
+#define __TELEMETRY_CODEC_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+#include <stddef.h>                 // offsetof
+
+            // payload formats
+#define  TCODEC_CBOR                0
+#define  TCODEC_JSON                1
+#define  TCODEC_AUTO                2    /* decode only: '{' = JSON, else CBOR */
+
+#define  TCODEC_MAX_DEPTH          16    /* max nesting of maps/arrays         */
+
+            // field types  (C type of the record member)
+#define  TCODEC_T_INT32             1    /* int32_t                            */
+#define  TCODEC_T_UINT32            2    /* uint32_t                           */
+#define  TCODEC_T_INT16             3    /* int16_t                            */
+#define  TCODEC_T_UINT16            4    /* uint16_t                           */
+#define  TCODEC_T_UINT8             5    /* uint8_t                            */
+#define  TCODEC_T_BOOL              6    /* uint8_t, 0 or 1                    */
+#define  TCODEC_T_FIXED32           7    /* int32_t, value * 10^decimals       */
+#define  TCODEC_T_FIXED16           8    /* int16_t, value * 10^decimals       */
+#define  TCODEC_T_STR               9    /* TCODEC_STR                         */
+
+            // error codes are ERR_TCODEC_xxx in user_api.h
+
+
+typedef struct tcodec_str_def            /* a string in a record              */
+   {
+       const char  *ptr;                 // not \0 terminated.  On decode it
+       uint16_t    len;                  //   points into the payload.
+   } TCODEC_STR;
+
+
+typedef struct tcodec_field_def          /* one entry of a record's field table */
+   {
+       const char  *name;                // key used in the payload
+       uint8_t     type;                 // TCODEC_T_xxx
+       uint8_t     decimals;             // for FIXED types: # decimal places
+       uint16_t    offset;               // offsetof() the member in the record
+   } TCODEC_FIELD;
+
+#define  TCODEC_FIELD(rec_type,member,type,decimals) \
+             { #member, type, decimals, (uint16_t) offsetof(rec_type,member) }
+#define  TCODEC_FIELD_NAMED(name,rec_type,member,type,decimals) \
+             { name, type, decimals, (uint16_t) offsetof(rec_type,member) }
+#define  TCODEC_NUM_FIELDS(table)   ((int) (sizeof(table) / sizeof(table[0])))
+
+
+typedef struct tcodec_enc_def            /* encoder state */
+   {
+       uint8_t    *buf;                  // caller's output buffer
+       uint16_t   size;                  // size of buf
+       uint16_t   len;                   // # bytes written so far
+       int16_t    error;                 // first error, 0 = none (sticky)
+       uint8_t    format;                // TCODEC_CBOR / TCODEC_JSON
+       uint8_t    depth;                 // JSON: current nesting level
+       uint8_t    after_key;             // JSON: a key was just written
+       uint16_t   first_mask;            // JSON: bit n = no item yet at depth n
+   } TCODEC_ENC;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+void  tcodec_enc_init (TCODEC_ENC *enc, void *buf, int size, int format);
+void  tcodec_enc_map_begin (TCODEC_ENC *enc, int num_pairs);  // num_pairs: CBOR only
+void  tcodec_enc_map_end (TCODEC_ENC *enc);
+void  tcodec_enc_array_begin (TCODEC_ENC *enc, int num_items); // num_items: CBOR only
+void  tcodec_enc_array_end (TCODEC_ENC *enc);
+void  tcodec_enc_key (TCODEC_ENC *enc, const char *key);
+void  tcodec_enc_int (TCODEC_ENC *enc, int32_t value);
+void  tcodec_enc_uint (TCODEC_ENC *enc, uint32_t value);
+void  tcodec_enc_fixed (TCODEC_ENC *enc, int32_t value, int decimals);
+void  tcodec_enc_bool (TCODEC_ENC *enc, int value);
+void  tcodec_enc_null (TCODEC_ENC *enc);
+void  tcodec_enc_str (TCODEC_ENC *enc, const char *str, int len);  // len < 0: strlen
+void  tcodec_enc_record (TCODEC_ENC *enc, const TCODEC_FIELD *fields,
+                         int num_fields, const void *record);
+int   tcodec_enc_finish (TCODEC_ENC *enc);
+
+int   tcodec_dec_record (const void *payload, int len, int format,
+                         const TCODEC_FIELD *fields, int num_fields,
+                         void *record, uint32_t *found_mask);
+
+#endif                          //  __TELEMETRY_CODEC_H__
+
+//*****************************************************************************
@@ -0,0 +1,335 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              timestamp.c
+//
+//
+//  64-bit monotonic Timestamp service: wrap-free tick counts, tick to
+//  microsecond conversion, and rate discipline against a reference clock.
+//
+//  Extension to 64 bits:
+//    half_periods counts how many times bit 31 of the raw counter has
+//    toggled. The SysTick ISR bumps it whenever its parity no longer
+//    matches bit 31. A reader samples half_periods FIRST, then the raw
+//    counter. The raw counter can then be at most one half period ahead,
+//    which shows up as a parity mismatch, so the reader just adds 1.
+//    No locks, no disabling of interrupts, and no retry loop.
+//
+//  Conversion to usec:
+//    usec = base_usec + (ticks - base_ticks) * usec_per_tick_q32 >> 32
+//    The conversion parms are double buffered with a generation count,
+//    so the (single) writer never blocks an ISR level reader.
+//
+//  Discipline:
+//    Each reference sample is compared against the monotonic clock over
+//    the interval since the previous sample. Half of the observed rate
+//    error is corrected (clamped to +/- TSTAMP_MAX_SLEW_PPM), and the
+//    conversion is rebased at "now", so the monotonic clock bends but
+//    never jumps. Wall clock time = monotonic + an offset that is stepped
+//    to the reference on every sample.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "timestamp.h"
+
+
+#define  TSTAMP_MAX_SLEW_PPB   (TSTAMP_MAX_SLEW_PPM * 1000L)
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static uint64_t  tstamp_convert (TSTAMP_CLOCK *clk, uint64_t ticks, int64_t *wall_offset);
+static uint64_t  tstamp_mul_q32 (uint64_t ticks, uint32_t mult_q32);
+static void      tstamp_publish (TSTAMP_CLOCK *clk, uint64_t ticks, uint32_t new_q32,
+                                 int64_t wall_offset, uint64_t step_usec);
+
+
+//*****************************************************************************
+//  tstamp_init
+//
+//          Setup a Timestamp clock over a free running counter that runs at
+//          tick_hz. ticks_now is the counter's current value (a raw 32-bit
+//          counter value is fine), which becomes monotonic time 0.
+//
+//          tick_hz must be above 1 MHz, so that usec per tick fits in Q32.
+//*****************************************************************************
+int  tstamp_init (TSTAMP_CLOCK *clk, uint32_t tick_hz, uint64_t ticks_now)
+{
+    if (clk == 0L || tick_hz <= 1000000L)
+       return (ERR_TIMESTAMP_INVALID_PARM);
+
+    memset (clk, 0, sizeof(TSTAMP_CLOCK));
+
+    clk->tick_hz      = tick_hz;
+    clk->nominal_q32  = (uint32_t) ((1000000ULL << 32) / tick_hz);
+    clk->half_periods = (uint32_t) (ticks_now >> 31); // sync parity to bit 31
+
+    clk->conv[0].base_ticks        = ticks_now;
+    clk->conv[0].base_usec         = 0;
+    clk->conv[0].usec_per_tick_q32 = clk->nominal_q32;
+    clk->conv_gen = 0;
+
+    return (0);                           // denote success
+}
+
+
+//*****************************************************************************
+//  tstamp_tick
+//
+//          Called from the SysTick ISR (or any periodic ISR that runs at
+//          least once per half counter period) with the raw counter value.
+//          Records a new half period, whenever bit 31 has toggled.
+//*****************************************************************************
+void  tstamp_tick (TSTAMP_CLOCK *clk, uint32_t raw_now)
+{
+    if ((clk->half_periods ^ (raw_now >> 31)) & 1)
+       clk->half_periods++;
+}
+
+
+//*****************************************************************************
+//  tstamp_extend
+//
+//          Extend a raw 32-bit counter value to 64 bits.
+//
+//          half_periods MUST have been sampled from the clock BEFORE raw_now
+//          was read from the counter. Callable from any ISR or thread level.
+//*****************************************************************************
+uint64_t  tstamp_extend (uint32_t half_periods, uint32_t raw_now)
+{
+    if ((half_periods ^ (raw_now >> 31)) & 1)
+       half_periods++;                    // counter crossed a half since tick
+
+    return (((uint64_t) (half_periods >> 1) << 32) | raw_now);
+}
+
+
+//*****************************************************************************
+//  tstamp_ticks_to_usec
+//
+//          Convert a 64-bit tick count into monotonic microseconds.
+//          Callable from any ISR or thread level.
+//*****************************************************************************
+uint64_t  tstamp_ticks_to_usec (TSTAMP_CLOCK *clk, uint64_t ticks)
+{
+    int64_t   wall_offset;
+
+    return (tstamp_convert (clk, ticks, &wall_offset));
+}
+
+
+//*****************************************************************************
+//  tstamp_discipline
+//
+//          Steer the clock towards a reference time. ticks is the 64-bit
+//          tick count at which ref_usec was sampled.
+//
+//          ref_usec can be in any epoch (RTC usec-of-day, SNTP usec since
+//          1970, ...), as long as successive calls use the same one. If the
+//          reference goes backwards or jumps by more than
+//          TSTAMP_MAX_REF_ERROR_PCT of the interval (midnight rollover,
+//          RTC set, first network sync), the rate is left alone and the
+//          reference is just re-baselined.
+//
+//          There must be only one caller of tstamp_discipline() at a time.
+//
+//          Returns TSTAMP_DISCIPLINE_xxx.
+//*****************************************************************************
+int  tstamp_discipline (TSTAMP_CLOCK *clk, uint64_t ticks, uint64_t ref_usec)
+{
+    uint64_t   mono_usec;
+    int64_t    d_ref;
+    int64_t    d_mono;
+    int64_t    err_usec;
+    int64_t    err_ppb;
+    int64_t    adj_ppb;
+    int64_t    new_q32;
+
+    mono_usec = tstamp_ticks_to_usec (clk, ticks);
+
+    d_ref  = (int64_t) (ref_usec  - clk->last_ref_usec);
+    d_mono = (int64_t) (mono_usec - clk->last_mono_usec);
+    err_usec = d_mono - d_ref;              // + = we are running fast
+
+    if (clk->ref_valid != 0  &&  d_ref > 0  &&  d_ref < TSTAMP_MIN_DISCIPLINE_USEC)
+       return (TSTAMP_DISCIPLINE_TOO_SOON); // too short to measure, keep interval
+
+    if (clk->ref_valid == 0  ||  d_ref <= 0
+       || (err_usec < 0 ? -err_usec : err_usec) > (d_ref / 100) * TSTAMP_MAX_REF_ERROR_PCT)
+       {        // first sample, or reference stepped: start a new interval
+         clk->last_ref_usec  = ref_usec;
+         clk->last_mono_usec = mono_usec;
+         clk->ref_valid = 1;
+         clk->rebaselines++;
+         tstamp_publish (clk, ticks, clk->conv[clk->conv_gen & 1].usec_per_tick_q32,
+                         (int64_t) (ref_usec - mono_usec), 0);
+         return (TSTAMP_DISCIPLINE_BASELINE);
+       }
+
+        //-------------------------------------------------------------------
+        // Rate error in parts per billion. The reference is quantized
+        // (e.g. 1/256 sec for the RTC), so correct only half the error each
+        // time, and clamp the total correction.
+        //-------------------------------------------------------------------
+    err_ppb = (err_usec * 1000000L) / (d_ref / 1000);
+    adj_ppb = (int64_t) clk->rate_adj_ppb - (err_ppb / 2);
+    if (adj_ppb > TSTAMP_MAX_SLEW_PPB)
+       adj_ppb = TSTAMP_MAX_SLEW_PPB;
+       else if (adj_ppb < -TSTAMP_MAX_SLEW_PPB)
+               adj_ppb = -TSTAMP_MAX_SLEW_PPB;
+    clk->rate_adj_ppb = (int32_t) adj_ppb;
+
+    new_q32 = (int64_t) clk->nominal_q32
+            + ((int64_t) clk->nominal_q32 * adj_ppb) / 1000000000L;
+    tstamp_publish (clk, ticks, (uint32_t) new_q32, (int64_t) (ref_usec - mono_usec), 0);
+
+    clk->last_ref_usec  = ref_usec;
+    clk->last_mono_usec = mono_usec;
+    clk->disciplines++;
+
+    return (TSTAMP_DISCIPLINE_SLEWED);
+}
+
+
+//*****************************************************************************
+//  tstamp_get_wall_usec
+//
+//          Convert a 64-bit tick count into wall clock microseconds, in the
+//          epoch of the last reference passed to tstamp_discipline().
+//          Unlike monotonic time, this steps when the reference does.
+//*****************************************************************************
+uint64_t  tstamp_get_wall_usec (TSTAMP_CLOCK *clk, uint64_t ticks)
+{
+    uint64_t  mono_usec;
+    int64_t   wall_offset;
+
+    mono_usec = tstamp_convert (clk, ticks, &wall_offset);
+
+    return (mono_usec + (uint64_t) wall_offset);
+}
+
+
+//*****************************************************************************
+//  tstamp_advance
+//
+//          Move monotonic (and wall clock) time forward by elapsed_usec at
+//          "ticks", for time the counter did not see, e.g. a DWT CYCCNT
+//          that was stopped along with the core clock in STOP mode.
+//          The rate is kept. Time before "ticks" is unchanged.
+//
+//          Same single caller rule as tstamp_discipline().
+//*****************************************************************************
+void  tstamp_advance (TSTAMP_CLOCK *clk, uint64_t ticks, uint64_t elapsed_usec)
+{
+    volatile TSTAMP_CONV  *active;
+
+    active = &clk->conv [clk->conv_gen & 1];
+    tstamp_publish (clk, ticks, active->usec_per_tick_q32,
+                    active->wall_offset_usec, elapsed_usec);
+}
+
+
+//*****************************************************************************
+//  tstamp_convert
+//
+//          Take a consistent copy of the active conversion parms, and
+//          convert ticks to monotonic usec. Also hands back the wall offset
+//          that goes with them.
+//*****************************************************************************
+static uint64_t  tstamp_convert (TSTAMP_CLOCK *clk, uint64_t ticks, int64_t *wall_offset)
+{
+    uint32_t   gen;
+    uint64_t   base_ticks;
+    uint64_t   base_usec;
+    uint32_t   mult;
+
+    do {                 // re-copy if the writer flipped buffers under us
+         gen          = clk->conv_gen;
+         base_ticks   = clk->conv[gen & 1].base_ticks;
+         base_usec    = clk->conv[gen & 1].base_usec;
+         mult         = clk->conv[gen & 1].usec_per_tick_q32;
+         *wall_offset = clk->conv[gen & 1].wall_offset_usec;
+       } while (gen != clk->conv_gen);
+
+    if (ticks >= base_ticks)
+       return (base_usec + tstamp_mul_q32 (ticks - base_ticks, mult));
+
+        // timestamp was taken just before the last rebase (a preempted reader)
+    return (base_usec - tstamp_mul_q32 (base_ticks - ticks, mult));
+}
+
+
+//*****************************************************************************
+//  tstamp_mul_q32
+//
+//          ticks * mult_q32 >> 32, exact, for a 64-bit ticks without needing
+//          a 128-bit product. Split ticks into hi/lo 32-bit halves:
+//              (hi * 2^32 + lo) * m >> 32  =  hi * m  +  (lo * m >> 32)
+//*****************************************************************************
+static uint64_t  tstamp_mul_q32 (uint64_t ticks, uint32_t mult_q32)
+{
+    uint32_t   hi;
+    uint32_t   lo;
+
+    hi = (uint32_t) (ticks >> 32);
+    lo = (uint32_t) ticks;
+
+    return (((uint64_t) hi * mult_q32) + (((uint64_t) lo * mult_q32) >> 32));
+}
+
+
+//*****************************************************************************
+//  tstamp_publish
+//
+//          Rebase the conversion at "ticks", with a new rate and wall offset,
+//          and step_usec added to monotonic time from there on.
+//          The idle copy of the parms is filled in, then the generation is
+//          bumped to publish it. An ISR that interrupts us keeps using the
+//          old (still consistent) copy. All of conv[] is volatile, so the
+//          compiler keeps the stores in order.
+//*****************************************************************************
+static void  tstamp_publish (TSTAMP_CLOCK *clk, uint64_t ticks, uint32_t new_q32,
+                             int64_t wall_offset, uint64_t step_usec)
+{
+    volatile TSTAMP_CONV  *idle;
+    uint64_t     usec_now;
+    uint32_t     gen;
+
+    usec_now = tstamp_ticks_to_usec (clk, ticks);
+
+    gen  = clk->conv_gen;
+    idle = &clk->conv [(gen + 1) & 1];
+    idle->base_ticks        = ticks;
+    idle->base_usec         = usec_now + step_usec;
+    idle->usec_per_tick_q32 = new_q32;
+    idle->wall_offset_usec  = wall_offset;
+
+    clk->conv_gen = gen + 1;
+}
+
+//*****************************************************************************
@@ -0,0 +1,114 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              timestamp.h
+//
+//
+//  Definitions for the 64-bit monotonic Timestamp service.
+//
+//  A free running 32-bit hardware counter (DWT CYCCNT on Cortex-M3/M4/M7, or
+//  a free running timer) is extended to a wrap-free 64-bit count, and then
+//  converted to microseconds using a Q32 "usec per tick" multiplier.
+//
+//  The 64-bit extension is lock-free: the 1 ms SysTick ISR calls
+//  tstamp_tick(), which tracks the number of half counter periods that have
+//  elapsed. A reader (ISR or thread level) only needs one extra load plus a
+//  parity compare to get the upper 32 bits, so it is safe to call from any
+//  interrupt priority, and never blocks.
+//
+//  Periodically, the App (or a vtimer callback) disciplines the clock against
+//  a reference (the RTC, or network time when available). Discipline only
+//  slews the rate of the monotonic microsecond clock (it never steps it back,
+//  or forward), and keeps a separate offset to provide "wall clock" time.
+//
+//  The engine itself (timestamp.c) is pure integer math and has no HAL
+//  dependencies; the board layer supplies the raw counter reads.
+//
+//  Limitations:
+//    - tstamp_tick() must be called at least once per half counter period
+//      (~10 secs at 216 MHz). The 1 ms SysTick easily covers this.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __TIMESTAMP_H__
+#define __TIMESTAMP_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+#define  TSTAMP_MAX_SLEW_PPM       500   /* max rate correction from nominal  */
+#define  TSTAMP_MIN_DISCIPLINE_USEC  1000000L /* ignore refs closer than 1 sec */
+#define  TSTAMP_MAX_REF_ERROR_PCT   10   /* bigger ref jumps = re-baseline    */
+
+            // Return codes from tstamp_discipline()
+#define  TSTAMP_DISCIPLINE_SLEWED    0   /* rate was adjusted                 */
+#define  TSTAMP_DISCIPLINE_BASELINE  1   /* first ref, or ref stepped: rebased */
+#define  TSTAMP_DISCIPLINE_TOO_SOON  2   /* ref too close to last one: ignored */
+
+
+typedef struct tstamp_conv_def          /* tick to usec conversion parms */
+   {
+       uint64_t   base_ticks;           // 64-bit tick count at last rebase
+       uint64_t   base_usec;            // monotonic usec at base_ticks
+       uint32_t   usec_per_tick_q32;    // usec per tick, Q32 (current rate)
+       int64_t    wall_offset_usec;     // wall clock = monotonic + offset
+   } TSTAMP_CONV;
+
+
+typedef struct tstamp_clock_def         /* Timestamp clock state */
+   {
+       volatile uint32_t  half_periods; // # half counter periods elapsed
+       uint32_t   tick_hz;              // rate the raw counter runs at
+       uint32_t   nominal_q32;          // usec per tick, Q32, uncorrected
+
+                                        // conversion parms are double
+                                        // buffered: writer fills the idle
+                                        // copy, then bumps the generation
+       volatile TSTAMP_CONV  conv [2];
+       volatile uint32_t  conv_gen;     // conv[conv_gen & 1] is active
+
+       uint64_t   last_ref_usec;        // reference at last discipline
+       uint64_t   last_mono_usec;       // monotonic  at last discipline
+       uint8_t    ref_valid;            // 1 = last_ref_usec is valid
+       int32_t    rate_adj_ppb;         // current correction vs nominal
+       uint32_t   disciplines;          // # times rate was slewed
+       uint32_t   rebaselines;          // # times reference stepped
+   } TSTAMP_CLOCK;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int      tstamp_init (TSTAMP_CLOCK *clk, uint32_t tick_hz, uint64_t ticks_now);
+void     tstamp_tick (TSTAMP_CLOCK *clk, uint32_t raw_now);
+uint64_t tstamp_extend (uint32_t half_periods, uint32_t raw_now);
+uint64_t tstamp_ticks_to_usec (TSTAMP_CLOCK *clk, uint64_t ticks);
+int      tstamp_discipline (TSTAMP_CLOCK *clk, uint64_t ticks, uint64_t ref_usec);
+uint64_t tstamp_get_wall_usec (TSTAMP_CLOCK *clk, uint64_t ticks);
+void     tstamp_advance (TSTAMP_CLOCK *clk, uint64_t ticks, uint64_t elapsed_usec);
+
+#endif                          //  __TIMESTAMP_H__
+
+//*****************************************************************************
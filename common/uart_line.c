@@ -0,0 +1,154 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              uart_line.c
+//
+//
+//  Text line assembly from a UART RX ring. See uart_line.h
+//
+//  History:
+//    10/19/26 - Created, from board_uart_line_assemble().
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "uart_line.h"
+
+
+//*****************************************************************************
+//  uart_line_begin
+//
+//             Start assembling a new text line into line_buf.
+//             The \r\n state is kept, so a \n left over from the previous
+//             line's \r\n is still dropped.
+//*****************************************************************************
+void  uart_line_begin (UART_LINE *ln, uint8_t *line_buf, int buf_max_length)
+{
+    if (buf_max_length > 0xFFFF)
+       buf_max_length = 0xFFFF;
+    ln->buf        = line_buf;
+    ln->max_length = (uint16_t) buf_max_length;
+    ln->len        = 0;
+    ln->truncated  = 0;
+    *line_buf = '\0';
+}
+
+
+//*****************************************************************************
+//  uart_line_reset
+//
+//             Drop any partial line, and the \r\n state (e.g. after the RX
+//             ring has been flushed).
+//*****************************************************************************
+void  uart_line_reset (UART_LINE *ln)
+{
+    ln->buf       = 0L;
+    ln->len       = 0;
+    ln->last_char = 0;
+}
+
+
+//*****************************************************************************
+//  uart_line_assemble
+//
+//             Perform CP-V style "activation character" processing for
+//             received string/char data:  i.e. if we get a \r or \n, then
+//             treat it as an end of string, and hand the current data up to
+//             the calling user application.
+//             For backspaces, delete the current character in the buffer
+//             and back up 1, in the input string.
+//
+//             This style of processing takes a major burden of the User App
+//             programmer, since he will see a "string_data\r\n" as a
+//             single record, and does not need to parse the data to find
+//             ending \r\n indicators. The app can wait for a complete
+//             "record" or string, rather than having to do byte-at-a-time
+//             (read_char) processing.
+//
+//             Pulls whatever is queued in rx_q into the line started by
+//             uart_line_begin(), and passes each char to echo_fn (if any).
+//
+//             The trailing \r or \n is replaced with \0, UNLESS the line is
+//             empty. In that case we put in \n\0 so that the App can
+//             determine that it is a "null" line (no string, just a
+//             carriage return/line feed was hit at the console).
+//             The \n of a \r\n pair is dropped, even when it arrives on a
+//             later call. A line that fills the buffer is handed up as is,
+//             with ln->truncated set.
+//
+//       Returns:  1 = the line is complete (ln->buf is cleared),
+//                 0 = rx_q is empty, more chars are needed (the partial
+//                     line is kept in ln).
+//*****************************************************************************
+int  uart_line_assemble (UART_LINE *ln, RING_BUF *rx_q,
+                         UART_LINE_ECHO echo_fn, void *echo_parm)
+{
+    uint8_t   in_char;
+    uint8_t   *line;
+    int       len;
+    int       complete;
+
+    line     = ln->buf;
+    len      = ln->len;
+    complete = 0;
+    while ( ! complete  &&  ring_buf_get (rx_q, &in_char))
+      {
+        if (echo_fn != 0L)                 // echo-plex the char back
+           (echo_fn) (echo_parm, in_char);
+
+        if (in_char == '\n'  &&  ln->last_char == '\r')
+           { ln->last_char = 0;             // 2nd half of a \r\n: the \r already
+             continue;                      // ended the line. Discard the \n
+           }
+        ln->last_char = in_char;           // save char, for \r\n sequence check
+
+        if (in_char == '\b' || in_char == 0x7F)
+           {     // handle BACKSPACE character - erase previous char by stepping back one.
+             if (len > 0)
+                line [--len] = '\0';
+             continue;
+           }
+
+        if (in_char == '\r' || in_char == '\n')
+           {     // end of line. see if this is a standalone \n (NL only or CR only)
+             if (len == 0)
+                line [len++] = '\n';       // pass thru the standalone \n
+             complete = 1;
+           }
+          else
+           { line [len++] = in_char;       // add a normal char to the line
+             if (len >= ln->max_length - 1)
+                {    // we've filled the buffer. Return the line as is.
+                  ln->truncated = 1;
+                  complete = 1;
+                }
+           }
+      }
+
+    line [len] = '\0';                     // ensure null terminator \0 is appended
+    ln->len = (uint16_t) len;
+    if (complete)
+       ln->buf = 0L;                       // no line in progress now
+    return (complete);
+}
+
+//*****************************************************************************
@@ -0,0 +1,77 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              uart_line.h
+//
+//
+//  Text line assembly for UART console / AT command input, done at thread
+//  level on the bytes an RX ISR has queued in a RING_BUF.
+//
+//  CP-V style "activation character" processing: a \r or \n ends the line,
+//  a backspace (\b or DEL) erases the previous char, and the \n of a \r\n
+//  pair is dropped, even when it arrives on a later call. A line can be
+//  built up over several calls, as the bytes trickle in:
+//
+//      uart_line_begin (&ln, line_buf, sizeof(line_buf));
+//      while (uart_line_assemble (&ln, &rx_ring, echo_fn, echo_parm) == 0)
+//         ... wait for more input ...
+//      ... line_buf has the line, \0 terminated ...
+//
+//  Used by the STM32 UART read calls (board_STM32_uart.c).
+//
+//  History:
+//    10/19/26 - Created, from board_uart_line_assemble().
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __UART_LINE_H__
+#define __UART_LINE_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+#include "ring_buf.h"
+
+            // optional echo-plex of each received char, back to the sender
+typedef void (*UART_LINE_ECHO) (void *echo_parm, uint8_t out_char);
+
+
+typedef struct uart_line_def             /* a text line being assembled */
+   {
+       uint8_t    *buf;                  // line buffer, 0L = no line in progress
+       uint16_t   max_length;            // its size, incl the \0
+       uint16_t   len;                   // # chars in it so far
+       uint8_t    last_char;             // last char seen, for the \r\n check
+       uint8_t    truncated;             // 1 = the completed line was cut short
+   } UART_LINE;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+void  uart_line_begin (UART_LINE *ln, uint8_t *line_buf, int buf_max_length);
+int   uart_line_assemble (UART_LINE *ln, RING_BUF *rx_q,
+                          UART_LINE_ECHO echo_fn, void *echo_parm);
+void  uart_line_reset (UART_LINE *ln);
+
+#endif                          //  __UART_LINE_H__
+
+//*****************************************************************************
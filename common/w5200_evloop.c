@@ -0,0 +1,746 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              w5200_evloop.c
+//
+//
+//  W5200 multi-socket event loop, with burst SPI buffer access.
+//  See w5200_evloop.h
+//
+//  W5200 SPI frame:   addr hi, addr lo, R/W bit | len hi (7 bits), len lo,
+//                     then len data bytes, all in one CS assertion.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "w5200_evloop.h"
+#include <string.h>
+
+#define  W5200_CMD_POLLS        100      // max reads of Sn_CR, waiting for 0
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static int  w5200_xfer (W5200_EV *ev, uint16_t addr, uint8_t *data, int length,
+                        int is_write);
+static int  w5200_write8 (W5200_EV *ev, uint16_t addr, uint8_t value);
+static int  w5200_read8 (W5200_EV *ev, uint16_t addr);
+static int  w5200_write16 (W5200_EV *ev, uint16_t addr, uint16_t value);
+static int  w5200_read_ptrs (W5200_EV *ev, uint16_t addr, int num_regs,
+                             uint16_t *regs);
+static int  w5200_cmd (W5200_EV *ev, int sock, uint8_t cmd);
+static int  w5200_buf_xfer (W5200_EV *ev, uint16_t base, uint16_t mask,
+                            uint16_t ptr, uint8_t *buf, int length, int is_write);
+static W5200_SOCK  *w5200_get_sock (W5200_EV *ev, int sock);
+
+
+//*****************************************************************************
+//  w5200ev_init
+//
+//          Setup the event loop over a W5200.  The chip's network config
+//          (MAC, IP, gateway, ...) must already have been done.
+//
+//          buf_kb gives each socket's TX and RX buffer size in KB (0, 1, 2,
+//          4, 8 or 16, totalling no more than 16).  If buf_kb is 0L, the
+//          sizes already programmed into the chip are used (e.g. when the
+//          W5200 library/mnet driver set the chip up).
+//*****************************************************************************
+int  w5200ev_init (W5200_EV *ev, W5200_SPI_FRAME_FN spi_frame, void *bus_parm,
+                   uint8_t *buf_kb)
+{
+    uint16_t   tx_base;
+    uint16_t   rx_base;
+    int        total;
+    int        kb;
+    int        rc;
+    int        s;
+
+    if (ev == 0L || spi_frame == 0L)
+       return (ERR_W5200_INVALID_PARM);
+
+    memset (ev, 0, sizeof(W5200_EV));
+    ev->spi_frame = spi_frame;
+    ev->bus_parm  = bus_parm;
+
+    if (buf_kb != 0L)
+       { total = 0;
+         for (s = 0;  s < W5200_MAX_SOCKETS;  s++)
+           { kb = buf_kb[s];
+             if (kb > W5200_BUF_MEM_KB || (kb & (kb - 1)) != 0)
+                return (ERR_W5200_INVALID_PARM);  // not 0 or a power of 2
+             total += kb;
+           }
+         if (total > W5200_BUF_MEM_KB)
+            return (ERR_W5200_INVALID_PARM);
+       }
+
+    tx_base = W5200_TX_MEM_BASE;
+    rx_base = W5200_RX_MEM_BASE;
+    for (s = 0;  s < W5200_MAX_SOCKETS;  s++)
+      {
+        if (buf_kb != 0L)
+           { kb = buf_kb[s];
+             rc  = w5200_write8 (ev, W5200_SOCK_REG(s,W5200_Sn_RXMEM_SIZE), kb);
+             rc |= w5200_write8 (ev, W5200_SOCK_REG(s,W5200_Sn_TXMEM_SIZE), kb);
+             if (rc < 0)
+                return (ERR_W5200_SPI);
+           }
+          else {
+                 kb = w5200_read8 (ev, W5200_SOCK_REG(s,W5200_Sn_TXMEM_SIZE));
+                 if (kb < 0)
+                    return (ERR_W5200_SPI);
+               }
+        ev->sock[s].tx_base = tx_base;
+        ev->sock[s].rx_base = rx_base;
+        ev->sock[s].tx_mask = (uint16_t) (kb * 1024 - 1);   // 0 KB: unusable
+        ev->sock[s].rx_mask = (uint16_t) (kb * 1024 - 1);
+        tx_base += kb * 1024;
+        rx_base += kb * 1024;
+      }
+
+    if (w5200_write8(ev, W5200_IMR, 0) < 0)   // no socket rupts till opened
+       return (ERR_W5200_SPI);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  w5200ev_socket
+//
+//          Open a hardware socket as TCP or UDP on a local port, and attach
+//          its event handler.  TCP sockets then need w5200ev_connect() or
+//          w5200ev_listen().
+//*****************************************************************************
+int  w5200ev_socket (W5200_EV *ev, int sock, int mode, uint16_t port,
+                     W5200_SOCK_HANDLER handler, void *parm)
+{
+    W5200_SOCK  *sk;
+    uint8_t     port_be [2];
+    int         state;
+
+    sk = w5200_get_sock (ev, sock);
+    if (sk == 0L || sk->rx_mask == 0xFFFF)
+       return (ERR_W5200_INVALID_SOCKET);     // bad # or has 0 KB of buffer
+    if (mode != W5200_MODE_TCP  &&  mode != W5200_MODE_UDP)
+       return (ERR_W5200_INVALID_PARM);
+
+    w5200_cmd (ev, sock, W5200_CMD_CLOSE);    // in case it was left open
+    w5200_write8 (ev, W5200_SOCK_REG(sock,W5200_Sn_IR), 0xFF);  // clear events
+
+    port_be[0] = (uint8_t) (port >> 8);
+    port_be[1] = (uint8_t) port;
+    w5200_write8 (ev, W5200_SOCK_REG(sock,W5200_Sn_MR), (uint8_t) mode);
+    w5200_xfer (ev, W5200_SOCK_REG(sock,W5200_Sn_PORT), port_be, 2, 1);
+    if (w5200_cmd(ev, sock, W5200_CMD_OPEN) < 0)
+       return (ERR_W5200_CMD_TIMEOUT);
+
+    state = w5200_read8 (ev, W5200_SOCK_REG(sock,W5200_Sn_SR));
+    if (state != (mode == W5200_MODE_TCP ? W5200_SOCK_INIT : W5200_SOCK_UDP))
+       return (ERR_W5200_SOCK_STATE);
+
+    sk->handler   = handler;
+    sk->parm      = parm;
+    sk->mode      = (uint8_t) mode;
+    sk->in_use    = 1;
+    sk->send_busy = 0;
+
+    w5200_write8 (ev, W5200_SOCK_REG(sock,W5200_Sn_IMR),
+                  W5200_EV_CON | W5200_EV_DISCON | W5200_EV_RECV
+                  | W5200_EV_TIMEOUT | W5200_EV_SEND_OK);
+    ev->imr |= (1 << sock);
+    w5200_write8 (ev, W5200_IMR, ev->imr);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  w5200ev_attach
+//
+//          Take over a socket that was opened elsewhere (e.g. by the mnet
+//          W5200 driver's mnet_connect_server()), so it can use the burst
+//          recv/send calls and be dispatched by w5200ev_poll().
+//*****************************************************************************
+int  w5200ev_attach (W5200_EV *ev, int sock, W5200_SOCK_HANDLER handler,
+                     void *parm)
+{
+    W5200_SOCK  *sk;
+    int         mode;
+
+    sk = w5200_get_sock (ev, sock);
+    if (sk == 0L || sk->rx_mask == 0xFFFF)
+       return (ERR_W5200_INVALID_SOCKET);
+
+    mode = w5200_read8 (ev, W5200_SOCK_REG(sock,W5200_Sn_MR));
+    if (mode < 0)
+       return (ERR_W5200_SPI);
+
+    sk->handler   = handler;
+    sk->parm      = parm;
+    sk->mode      = (uint8_t) (mode & 0x0F);
+    sk->in_use    = 1;
+    sk->send_busy = 0;
+
+    w5200_write8 (ev, W5200_SOCK_REG(sock,W5200_Sn_IMR),
+                  W5200_EV_CON | W5200_EV_DISCON | W5200_EV_RECV
+                  | W5200_EV_TIMEOUT | W5200_EV_SEND_OK);
+    ev->imr |= (1 << sock);
+    w5200_write8 (ev, W5200_IMR, ev->imr);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  w5200ev_connect
+//
+//          Start a TCP connect.  Does not wait: the handler gets W5200_EV_CON
+//          when it is up, or W5200_EV_TIMEOUT if it failed.
+//*****************************************************************************
+int  w5200ev_connect (W5200_EV *ev, int sock, uint8_t *ip_addr, uint16_t port)
+{
+    uint8_t    dest [6];                // DIPR and DPORT are adjacent regs
+
+    if (w5200ev_status(ev, sock) != W5200_SOCK_INIT || ip_addr == 0L)
+       return (ERR_W5200_SOCK_STATE);
+
+    memcpy (dest, ip_addr, 4);
+    dest[4] = (uint8_t) (port >> 8);
+    dest[5] = (uint8_t) port;
+    if (w5200_xfer(ev, W5200_SOCK_REG(sock,W5200_Sn_DIPR), dest, 6, 1) < 0)
+       return (ERR_W5200_SPI);
+
+    return (w5200_cmd(ev, sock, W5200_CMD_CONNECT));
+}
+
+
+//*****************************************************************************
+//  w5200ev_listen
+//
+//          Wait for a TCP client. The handler gets W5200_EV_CON when one
+//          connects.
+//*****************************************************************************
+int  w5200ev_listen (W5200_EV *ev, int sock)
+{
+    if (w5200ev_status(ev, sock) != W5200_SOCK_INIT)
+       return (ERR_W5200_SOCK_STATE);
+
+    return (w5200_cmd(ev, sock, W5200_CMD_LISTEN));
+}
+
+
+//*****************************************************************************
+//  w5200ev_disconnect
+//
+//          Send a TCP FIN.  The handler gets W5200_EV_DISCON when done.
+//*****************************************************************************
+int  w5200ev_disconnect (W5200_EV *ev, int sock)
+{
+    if (w5200_get_sock(ev, sock) == 0L)
+       return (ERR_W5200_INVALID_SOCKET);
+
+    return (w5200_cmd(ev, sock, W5200_CMD_DISCON));
+}
+
+
+//*****************************************************************************
+//  w5200ev_close
+//
+//          Close the socket immediately, and detach its handler.
+//*****************************************************************************
+int  w5200ev_close (W5200_EV *ev, int sock)
+{
+    W5200_SOCK  *sk;
+    int         rc;
+
+    sk = w5200_get_sock (ev, sock);
+    if (sk == 0L)
+       return (ERR_W5200_INVALID_SOCKET);
+
+    rc = w5200_cmd (ev, sock, W5200_CMD_CLOSE);
+    w5200_write8 (ev, W5200_SOCK_REG(sock,W5200_Sn_IR), 0xFF);
+    ev->imr &= ~(1 << sock);
+    w5200_write8 (ev, W5200_IMR, ev->imr);
+    sk->in_use    = 0;
+    sk->send_busy = 0;
+
+    return (rc);
+}
+
+
+//*****************************************************************************
+//  w5200ev_status
+//
+//          Return the socket's Sn_SR state:  W5200_SOCK_xxx
+//*****************************************************************************
+int  w5200ev_status (W5200_EV *ev, int sock)
+{
+    if (w5200_get_sock(ev, sock) == 0L)
+       return (ERR_W5200_INVALID_SOCKET);
+
+    return (w5200_read8(ev, W5200_SOCK_REG(sock,W5200_Sn_SR)));
+}
+
+
+//*****************************************************************************
+//  w5200ev_poll
+//
+//          Read the socket interrupt register once, and dispatch each socket
+//          that has events to its handler. Sockets with nothing pending cost
+//          no SPI traffic.  Called once per main loop pass (or when the
+//          W5200 INT pin goes low).
+//
+//          Returns the # sockets dispatched, or ERR_W5200_SPI.
+//*****************************************************************************
+int  w5200ev_poll (W5200_EV *ev)
+{
+    W5200_SOCK  *sk;
+    int         ir2;
+    int         ir;
+    int         count;
+    int         s;
+
+    ev->polls++;
+    ir2 = w5200_read8 (ev, W5200_IR2);
+    if (ir2 < 0)
+       return (ERR_W5200_SPI);
+    ir2 &= ev->imr;
+
+    count = 0;
+    for (s = 0;  ir2 != 0;  s++, ir2 >>= 1)
+      {
+        if ((ir2 & 0x01) == 0)
+           continue;
+        ir = w5200_read8 (ev, W5200_SOCK_REG(s,W5200_Sn_IR));
+        if (ir <= 0)
+           continue;
+        w5200_write8 (ev, W5200_SOCK_REG(s,W5200_Sn_IR), (uint8_t) ir);  // ack
+        sk = &ev->sock[s];
+        if (ir & W5200_EV_SEND_OK)
+           sk->send_busy = 0;
+        if (sk->handler != 0L)
+           { sk->handler (sk->parm, s, ir);
+             ev->dispatches++;
+           }
+        count++;
+      }
+
+    return (count);
+}
+
+
+//*****************************************************************************
+//  w5200ev_recv
+//
+//          Read up to max_length bytes of TCP data, straight out of the
+//          socket's RX buffer in the chip into buf.
+//
+//          Returns # bytes read, 0 if none are waiting, or ERR_W5200_xxx.
+//*****************************************************************************
+int  w5200ev_recv (W5200_EV *ev, int sock, uint8_t *buf, int max_length)
+{
+    W5200_SOCK  *sk;
+    uint16_t    regs [2];               // RX_RSR, RX_RD
+    int         length;
+
+    sk = w5200_get_sock (ev, sock);
+    if (sk == 0L || ! sk->in_use)
+       return (ERR_W5200_INVALID_SOCKET);
+    if (buf == 0L || max_length <= 0)
+       return (ERR_W5200_INVALID_PARM);
+
+    if (w5200_read_ptrs(ev, W5200_SOCK_REG(sock,W5200_Sn_RX_RSR), 2, regs) < 0)
+       return (ERR_W5200_SPI);
+    if (regs[0] == 0)
+       return (0);                      // nothing waiting
+
+    length = (regs[0] < max_length) ? regs[0] : max_length;
+    if (w5200_buf_xfer(ev, sk->rx_base, sk->rx_mask, regs[1], buf, length, 0) < 0
+       || w5200_write16(ev, W5200_SOCK_REG(sock,W5200_Sn_RX_RD),
+                        (uint16_t) (regs[1] + length)) < 0)
+       return (ERR_W5200_SPI);
+    w5200_cmd (ev, sock, W5200_CMD_RECV);
+
+    sk->rx_bytes += length;
+    return (length);
+}
+
+
+//*****************************************************************************
+//  w5200ev_send
+//
+//          Write as much of buf as fits, straight into the socket's TX
+//          buffer in the chip, and start sending it.  Only one SEND is in
+//          flight per socket:  while the previous one is still going, 0 is
+//          returned.
+//
+//          Returns # bytes queued, 0 if none could be right now, or
+//          ERR_W5200_xxx.
+//*****************************************************************************
+int  w5200ev_send (W5200_EV *ev, int sock, uint8_t *buf, int length)
+{
+    W5200_SOCK  *sk;
+    uint16_t    regs [3];               // TX_FSR, TX_RD, TX_WR
+    int         ir;
+    int         state;
+
+    sk = w5200_get_sock (ev, sock);
+    if (sk == 0L || ! sk->in_use)
+       return (ERR_W5200_INVALID_SOCKET);
+    if (buf == 0L || length <= 0)
+       return (ERR_W5200_INVALID_PARM);
+
+    state = w5200ev_status (ev, sock);
+    if (state != W5200_SOCK_ESTABLISHED  &&  state != W5200_SOCK_CLOSE_WAIT)
+       return (ERR_W5200_SOCK_STATE);
+
+    if (sk->send_busy)
+       {    // see if it finished since the last poll
+         ir = w5200_read8 (ev, W5200_SOCK_REG(sock,W5200_Sn_IR));
+         if (ir < 0 || (ir & W5200_EV_SEND_OK) == 0)
+            return (0);
+         w5200_write8 (ev, W5200_SOCK_REG(sock,W5200_Sn_IR), W5200_EV_SEND_OK);
+         sk->send_busy = 0;
+       }
+
+    if (w5200_read_ptrs(ev, W5200_SOCK_REG(sock,W5200_Sn_TX_FSR), 3, regs) < 0)
+       return (ERR_W5200_SPI);
+    if (regs[0] == 0)
+       return (0);                      // TX buffer full
+    if (length > regs[0])
+       length = regs[0];
+
+    if (w5200_buf_xfer(ev, sk->tx_base, sk->tx_mask, regs[2], buf, length, 1) < 0
+       || w5200_write16(ev, W5200_SOCK_REG(sock,W5200_Sn_TX_WR),
+                        (uint16_t) (regs[2] + length)) < 0)
+       return (ERR_W5200_SPI);
+    if (w5200_cmd(ev, sock, W5200_CMD_SEND) < 0)
+       return (ERR_W5200_CMD_TIMEOUT);
+    sk->send_busy = 1;
+
+    sk->tx_bytes += length;
+    return (length);
+}
+
+
+//*****************************************************************************
+//  w5200ev_recvfrom
+//
+//          Read the next UDP datagram into buf.  A datagram bigger than
+//          max_length is truncated (the rest is discarded).  ip_addr (4
+//          bytes) and port return the sender, if not 0L.
+//
+//          Returns # bytes read, 0 if no datagram is waiting, or
+//          ERR_W5200_xxx.
+//*****************************************************************************
+int  w5200ev_recvfrom (W5200_EV *ev, int sock, uint8_t *buf, int max_length,
+                       uint8_t *ip_addr, uint16_t *port)
+{
+    W5200_SOCK  *sk;
+    uint16_t    regs [2];               // RX_RSR, RX_RD
+    uint8_t     hdr [W5200_UDP_HDR_LEN];
+    int         dgram_len;
+    int         length;
+
+    sk = w5200_get_sock (ev, sock);
+    if (sk == 0L || ! sk->in_use || sk->mode != W5200_MODE_UDP)
+       return (ERR_W5200_INVALID_SOCKET);
+    if (buf == 0L || max_length <= 0)
+       return (ERR_W5200_INVALID_PARM);
+
+    if (w5200_read_ptrs(ev, W5200_SOCK_REG(sock,W5200_Sn_RX_RSR), 2, regs) < 0)
+       return (ERR_W5200_SPI);
+    if (regs[0] < W5200_UDP_HDR_LEN)
+       return (0);                      // nothing waiting
+
+    if (w5200_buf_xfer(ev, sk->rx_base, sk->rx_mask, regs[1], hdr,
+                       W5200_UDP_HDR_LEN, 0) < 0)
+       return (ERR_W5200_SPI);
+    dgram_len = (hdr[6] << 8) | hdr[7];
+    length    = (dgram_len < max_length) ? dgram_len : max_length;
+
+    if (length > 0
+       && w5200_buf_xfer(ev, sk->rx_base, sk->rx_mask,
+                         (uint16_t) (regs[1] + W5200_UDP_HDR_LEN),
+                         buf, length, 0) < 0)
+       return (ERR_W5200_SPI);
+    if (w5200_write16(ev, W5200_SOCK_REG(sock,W5200_Sn_RX_RD),
+                      (uint16_t) (regs[1] + W5200_UDP_HDR_LEN + dgram_len)) < 0)
+       return (ERR_W5200_SPI);
+    w5200_cmd (ev, sock, W5200_CMD_RECV);
+
+    if (ip_addr != 0L)
+       memcpy (ip_addr, hdr, 4);
+    if (port != 0L)
+       *port = (uint16_t) ((hdr[4] << 8) | hdr[5]);
+
+    sk->rx_bytes += length;
+    return (length);
+}
+
+
+//*****************************************************************************
+//  w5200ev_sendto
+//
+//          Send one UDP datagram.  It goes whole or not at all:  0 is
+//          returned if there is no TX room for it right now.
+//*****************************************************************************
+int  w5200ev_sendto (W5200_EV *ev, int sock, uint8_t *buf, int length,
+                     uint8_t *ip_addr, uint16_t port)
+{
+    W5200_SOCK  *sk;
+    uint16_t    regs [3];               // TX_FSR, TX_RD, TX_WR
+    uint8_t     dest [6];
+    int         ir;
+
+    sk = w5200_get_sock (ev, sock);
+    if (sk == 0L || ! sk->in_use || sk->mode != W5200_MODE_UDP)
+       return (ERR_W5200_INVALID_SOCKET);
+    if (buf == 0L || length <= 0 || length > sk->tx_mask + 1 || ip_addr == 0L)
+       return (ERR_W5200_INVALID_PARM);
+
+    if (sk->send_busy)
+       { ir = w5200_read8 (ev, W5200_SOCK_REG(sock,W5200_Sn_IR));
+         if (ir < 0 || (ir & (W5200_EV_SEND_OK | W5200_EV_TIMEOUT)) == 0)
+            return (0);
+         w5200_write8 (ev, W5200_SOCK_REG(sock,W5200_Sn_IR),
+                       (uint8_t) (ir & (W5200_EV_SEND_OK | W5200_EV_TIMEOUT)));
+         sk->send_busy = 0;
+       }
+
+    if (w5200_read_ptrs(ev, W5200_SOCK_REG(sock,W5200_Sn_TX_FSR), 3, regs) < 0)
+       return (ERR_W5200_SPI);
+    if (regs[0] < length)
+       return (0);                      // not enough room for whole datagram
+
+    memcpy (dest, ip_addr, 4);
+    dest[4] = (uint8_t) (port >> 8);
+    dest[5] = (uint8_t) port;
+    if (w5200_xfer(ev, W5200_SOCK_REG(sock,W5200_Sn_DIPR), dest, 6, 1) < 0
+       || w5200_buf_xfer(ev, sk->tx_base, sk->tx_mask, regs[2], buf, length, 1) < 0
+       || w5200_write16(ev, W5200_SOCK_REG(sock,W5200_Sn_TX_WR),
+                        (uint16_t) (regs[2] + length)) < 0)
+       return (ERR_W5200_SPI);
+    if (w5200_cmd(ev, sock, W5200_CMD_SEND) < 0)
+       return (ERR_W5200_CMD_TIMEOUT);
+    sk->send_busy = 1;
+
+    sk->tx_bytes += length;
+    return (length);
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+//                            Internal  Routines
+//*****************************************************************************
+//*****************************************************************************
+
+static W5200_SOCK  *w5200_get_sock (W5200_EV *ev, int sock)
+{
+    if (ev == 0L || sock < 0 || sock >= W5200_MAX_SOCKETS)
+       return (0L);
+
+    return (&ev->sock[sock]);
+}
+
+
+//*****************************************************************************
+//  w5200_xfer
+//
+//          Issue one W5200 SPI frame:  4 byte header, then the data.
+//*****************************************************************************
+static int  w5200_xfer (W5200_EV *ev, uint16_t addr, uint8_t *data, int length,
+                        int is_write)
+{
+    uint8_t    hdr [4];
+
+    hdr[0] = (uint8_t) (addr >> 8);
+    hdr[1] = (uint8_t) addr;
+    hdr[2] = (uint8_t) ((is_write ? 0x80 : 0x00) | ((length >> 8) & 0x7F));
+    hdr[3] = (uint8_t) length;
+    ev->spi_frames++;
+
+    return (ev->spi_frame(ev->bus_parm, hdr, data, length, is_write));
+}
+
+
+static int  w5200_write8 (W5200_EV *ev, uint16_t addr, uint8_t value)
+{
+    return (w5200_xfer(ev, addr, &value, 1, 1));
+}
+
+
+static int  w5200_read8 (W5200_EV *ev, uint16_t addr)
+{
+    uint8_t    value;
+
+    if (w5200_xfer(ev, addr, &value, 1, 0) < 0)
+       return (ERR_W5200_SPI);
+
+    return (value);
+}
+
+
+static int  w5200_write16 (W5200_EV *ev, uint16_t addr, uint16_t value)
+{
+    uint8_t    be [2];
+
+    be[0] = (uint8_t) (value >> 8);
+    be[1] = (uint8_t) value;
+
+    return (w5200_xfer(ev, addr, be, 2, 1));
+}
+
+
+//*****************************************************************************
+//  w5200_read_ptrs
+//
+//          Read num_regs adjacent 16 bit socket registers in one frame. The
+//          first one (Sn_TX_FSR or Sn_RX_RSR) can change while it is being
+//          read, so the frame is repeated until it reads the same twice, as
+//          the datasheet requires.
+//*****************************************************************************
+static int  w5200_read_ptrs (W5200_EV *ev, uint16_t addr, int num_regs,
+                             uint16_t *regs)
+{
+    uint8_t    raw [6];
+    uint16_t   first;
+    int        tries;
+    int        i;
+
+    first = 0xFFFF;
+    for (tries = 0;  tries < 4;  tries++)
+      {
+        if (w5200_xfer(ev, addr, raw, num_regs * 2, 0) < 0)
+           return (ERR_W5200_SPI);
+        for (i = 0;  i < num_regs;  i++)
+           regs[i] = (uint16_t) ((raw[2*i] << 8) | raw[2*i + 1]);
+        if (regs[0] == first)
+           return (0);
+        first = regs[0];
+      }
+
+    return (0);                         // still moving: use latest reading
+}
+
+
+//*****************************************************************************
+//  w5200_cmd
+//
+//          Issue a socket command, and wait for the chip to accept it
+//          (Sn_CR reads back 0).
+//*****************************************************************************
+static int  w5200_cmd (W5200_EV *ev, int sock, uint8_t cmd)
+{
+    int        polls;
+
+    if (w5200_write8(ev, W5200_SOCK_REG(sock,W5200_Sn_CR), cmd) < 0)
+       return (ERR_W5200_SPI);
+
+    for (polls = 0;  polls < W5200_CMD_POLLS;  polls++)
+       if (w5200_read8(ev, W5200_SOCK_REG(sock,W5200_Sn_CR)) == 0)
+          return (0);                   // denote success
+
+    return (ERR_W5200_CMD_TIMEOUT);
+}
+
+
+//*****************************************************************************
+//  w5200_buf_xfer
+//
+//          Burst move length bytes between buf and a socket's ring buffer in
+//          the chip, starting at ring pointer ptr. Takes 2 frames when the
+//          data wraps past the end of the ring.
+//*****************************************************************************
+static int  w5200_buf_xfer (W5200_EV *ev, uint16_t base, uint16_t mask,
+                            uint16_t ptr, uint8_t *buf, int length, int is_write)
+{
+    uint16_t   offset;
+    int        first;
+
+    offset = ptr & mask;
+    first  = (mask + 1) - offset;
+    if (first > length)
+       first = length;
+
+    if (w5200_xfer(ev, base + offset, buf, first, is_write) < 0)
+       return (ERR_W5200_SPI);
+    if (length > first
+       && w5200_xfer(ev, base, buf + first, length - first, is_write) < 0)
+       return (ERR_W5200_SPI);
+
+    return (0);
+}
+
+
+#if defined(USES_W5200) && defined(STM32_MCU)
+
+#include "boarddef.h"
+
+#define  W5200_SPI_TIMEOUT_MS      10
+
+//*****************************************************************************
+//  w5200ev_spi_frame
+//
+//          STM32 SPI frame routine for the W5200 (Seeed shield wiring, see
+//          board_STM32.h). The 4 byte header goes out polled, the data phase
+//          uses DMA when the SPI handle has DMA streams linked to it
+//          (board_spi_dma_init()) and the frame is big enough to be worth it.
+//*****************************************************************************
+int  w5200ev_spi_frame (void *bus_parm, uint8_t *hdr, uint8_t *data,
+                        int length, int is_write)
+{
+    SPI_HandleTypeDef  *hspi;
+    HAL_StatusTypeDef  rc;
+
+    hspi = board_spi_get_handle (W5200_SPI_PORT_ID);
+    if (hspi == 0L)
+       return (ERR_W5200_SPI);
+
+    ASSERT_CS_W5200_NORMAL();
+    rc = HAL_SPI_Transmit (hspi, hdr, 4, W5200_SPI_TIMEOUT_MS);
+    if (rc == HAL_OK)
+       {
+         if (length >= W5200_DMA_THRESHOLD  &&  hspi->hdmatx != 0L
+            && hspi->hdmarx != 0L)
+            { rc = is_write ? HAL_SPI_Transmit_DMA (hspi, data, length)
+                            : HAL_SPI_Receive_DMA (hspi, data, length);
+              while (rc == HAL_OK && HAL_SPI_GetState(hspi) != HAL_SPI_STATE_READY)
+                ;                       // wait for the burst to finish
+            }
+           else rc = is_write ? HAL_SPI_Transmit (hspi, data, length, W5200_SPI_TIMEOUT_MS)
+                              : HAL_SPI_Receive (hspi, data, length, W5200_SPI_TIMEOUT_MS);
+       }
+    DEASSERT_CS_W5200_NORMAL();
+
+    return (rc == HAL_OK ? 0 : ERR_W5200_SPI);
+}
+#endif                                  // USES_W5200 && STM32_MCU
+
+//*****************************************************************************
@@ -0,0 +1,209 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              w5200_evloop.h
+//
+//
+//  Definitions for the W5200 multi-socket event loop.
+//
+//  The W5200 has 8 hardware sockets, each with its own TX and RX buffer in
+//  the chip's 32 KB of buffer memory. This module runs all of them at once:
+//
+//    - w5200ev_poll() reads the chip's socket interrupt register (IR2) in a
+//      single SPI frame, and only then touches the sockets that have events
+//      (connected, data received, send done, disconnected, timeout). Each
+//      ready socket's handler is called with its Sn_IR event bits.
+//
+//    - w5200ev_recv()/w5200ev_send() move data with burst SPI frames (one
+//      frame, or 2 if the chip's ring buffer wraps) directly between the
+//      socket's buffer in the chip and the caller's buffer, such as the MQTT
+//      readbuf. There are no intermediate copies.
+//
+//  All the chip access goes through one driver supplied routine that does
+//  a single SPI frame (4 byte W5200 header + data). On STM32 the supplied
+//  w5200ev_spi_frame() uses DMA for the data phase of large frames. A host
+//  build can plug in a register level simulator instead.
+//
+//  Typical main loop:
+//
+//      w5200ev_socket (&ev, 0, W5200_MODE_TCP, 0,    mqtt_handler,   &mqtt);
+//      w5200ev_socket (&ev, 1, W5200_MODE_TCP, 502,  modbus_handler, &mb);
+//      w5200ev_listen (&ev, 1);
+//      w5200ev_socket (&ev, 2, W5200_MODE_UDP, 5000, udp_handler,    0L);
+//      while (1)
+//         w5200ev_poll (&ev);            handlers do the recv()/send() calls
+//
+//  Return conventions:  recv/send return the # bytes moved, 0 if nothing
+//  could be moved right now (no data / no TX room), or a negative
+//  ERR_W5200_xxx code.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __W5200_EVLOOP_H__
+#define __W5200_EVLOOP_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+
+#define  W5200_MAX_SOCKETS          8
+#define  W5200_BUF_MEM_KB          16    /* 16 KB TX + 16 KB RX, shared by all */
+
+            //------------------------------------------
+            //  W5200 registers  (W5200 datasheet v1.3)
+            //------------------------------------------
+#define  W5200_MR              0x0000    /* common: mode                      */
+#define  W5200_IR2             0x0034    /* common: socket interrupts (1 bit/socket) */
+#define  W5200_IMR             0x0036    /* common: socket interrupt mask     */
+
+#define  W5200_SOCK_REG(s,r)   (0x4000 + ((s) << 8) + (r))
+#define  W5200_Sn_MR             0x00
+#define  W5200_Sn_CR             0x01
+#define  W5200_Sn_IR             0x02
+#define  W5200_Sn_SR             0x03
+#define  W5200_Sn_PORT           0x04
+#define  W5200_Sn_DIPR           0x0C
+#define  W5200_Sn_DPORT          0x10
+#define  W5200_Sn_RXMEM_SIZE     0x1E
+#define  W5200_Sn_TXMEM_SIZE     0x1F
+#define  W5200_Sn_TX_FSR         0x20
+#define  W5200_Sn_TX_RD          0x22
+#define  W5200_Sn_TX_WR          0x24
+#define  W5200_Sn_RX_RSR         0x26
+#define  W5200_Sn_RX_RD          0x28
+#define  W5200_Sn_IMR            0x2C
+
+#define  W5200_TX_MEM_BASE     0x8000
+#define  W5200_RX_MEM_BASE     0xC000
+
+            // Sn_MR socket modes
+#define  W5200_MODE_TCP          0x01
+#define  W5200_MODE_UDP          0x02
+
+            // Sn_CR commands
+#define  W5200_CMD_OPEN          0x01
+#define  W5200_CMD_LISTEN        0x02
+#define  W5200_CMD_CONNECT       0x04
+#define  W5200_CMD_DISCON        0x08
+#define  W5200_CMD_CLOSE         0x10
+#define  W5200_CMD_SEND          0x20
+#define  W5200_CMD_RECV          0x40
+
+            // Sn_SR socket states
+#define  W5200_SOCK_CLOSED       0x00
+#define  W5200_SOCK_INIT         0x13
+#define  W5200_SOCK_LISTEN       0x14
+#define  W5200_SOCK_ESTABLISHED  0x17
+#define  W5200_SOCK_CLOSE_WAIT   0x1C
+#define  W5200_SOCK_UDP          0x22
+
+            // Sn_IR event bits, as passed to the socket handlers
+#define  W5200_EV_CON            0x01    /* TCP connection established        */
+#define  W5200_EV_DISCON         0x02    /* peer sent FIN, or connection lost */
+#define  W5200_EV_RECV           0x04    /* data received                     */
+#define  W5200_EV_TIMEOUT        0x08    /* ARP or TCP timeout                */
+#define  W5200_EV_SEND_OK        0x10    /* previous SEND has completed       */
+
+#define  W5200_UDP_HDR_LEN          8    /* RX header: ip(4), port(2), len(2) */
+
+#ifndef W5200_DMA_THRESHOLD
+#define  W5200_DMA_THRESHOLD       16    /* smaller frames use polled SPI     */
+#endif
+
+            // Error codes
+#define  ERR_W5200_INVALID_SOCKET  -1
+#define  ERR_W5200_INVALID_PARM    -2
+#define  ERR_W5200_SOCK_STATE      -3    /* wrong state for this operation    */
+#define  ERR_W5200_CMD_TIMEOUT     -4    /* chip did not accept Sn_CR command */
+#define  ERR_W5200_SPI             -5    /* SPI frame failed                  */
+
+
+        // Driver supplied routine that does one W5200 SPI frame:  the 4 byte
+        // header, then length bytes of data written from / read into data.
+        // Returns 0 on success, < 0 on error.
+typedef int  (*W5200_SPI_FRAME_FN) (void *bus_parm, uint8_t *hdr,
+                                    uint8_t *data, int length, int is_write);
+
+        // Socket event handler. events = Sn_IR bits: W5200_EV_xxx
+typedef void (*W5200_SOCK_HANDLER) (void *parm, int sock, int events);
+
+
+typedef struct w5200_sock_def            /* one hardware socket */
+   {
+       W5200_SOCK_HANDLER  handler;
+       void       *parm;
+       uint16_t   tx_base;               // chip address of TX buffer
+       uint16_t   rx_base;               // chip address of RX buffer
+       uint16_t   tx_mask;               // TX buffer size - 1
+       uint16_t   rx_mask;               // RX buffer size - 1
+       uint8_t    mode;                  // W5200_MODE_xxx
+       uint8_t    in_use;
+       uint8_t    send_busy;             // SEND issued, SEND_OK not seen yet
+       uint32_t   rx_bytes;
+       uint32_t   tx_bytes;
+   } W5200_SOCK;
+
+
+typedef struct w5200_ev_def              /* W5200 event loop control block */
+   {
+       W5200_SPI_FRAME_FN  spi_frame;
+       void       *bus_parm;
+       uint8_t    imr;                   // socket interrupt mask (IMR shadow)
+       uint32_t   polls;
+       uint32_t   dispatches;
+       uint32_t   spi_frames;
+       W5200_SOCK sock [W5200_MAX_SOCKETS];
+   } W5200_EV;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int   w5200ev_init (W5200_EV *ev, W5200_SPI_FRAME_FN spi_frame, void *bus_parm,
+                    uint8_t *buf_kb);
+int   w5200ev_socket (W5200_EV *ev, int sock, int mode, uint16_t port,
+                      W5200_SOCK_HANDLER handler, void *parm);
+int   w5200ev_attach (W5200_EV *ev, int sock, W5200_SOCK_HANDLER handler,
+                      void *parm);
+int   w5200ev_connect (W5200_EV *ev, int sock, uint8_t *ip_addr, uint16_t port);
+int   w5200ev_listen (W5200_EV *ev, int sock);
+int   w5200ev_disconnect (W5200_EV *ev, int sock);
+int   w5200ev_close (W5200_EV *ev, int sock);
+int   w5200ev_status (W5200_EV *ev, int sock);
+int   w5200ev_poll (W5200_EV *ev);
+int   w5200ev_recv (W5200_EV *ev, int sock, uint8_t *buf, int max_length);
+int   w5200ev_send (W5200_EV *ev, int sock, uint8_t *buf, int length);
+int   w5200ev_recvfrom (W5200_EV *ev, int sock, uint8_t *buf, int max_length,
+                        uint8_t *ip_addr, uint16_t *port);
+int   w5200ev_sendto (W5200_EV *ev, int sock, uint8_t *buf, int length,
+                      uint8_t *ip_addr, uint16_t port);
+
+#if defined(USES_W5200) && defined(STM32_MCU)
+int   w5200ev_spi_frame (void *bus_parm, uint8_t *hdr, uint8_t *data,
+                         int length, int is_write);
+#endif
+
+#endif                          //  __W5200_EVLOOP_H__
+
+//*****************************************************************************
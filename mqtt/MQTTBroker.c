@@ -0,0 +1,989 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                               MQTTBroker.c
+//
+//
+//  Embedded MQTT broker for gateway boards: local clients, subscription
+//  index, zero copy fan out from a shared message pool, upstream bridging.
+//  See MQTTBroker.h
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "MQTTBroker.h"
+
+#include <string.h>
+#include <errno.h>
+
+#if !defined(MQBROKER_NO_MNET)
+#include "mnet_call_api.h"              // pull in defs for common COMM TCP API
+#endif
+
+            // MQBROKER_TXQ state
+#define  MQBROKER_TX_QUEUED        0     /* not sent yet                       */
+#define  MQBROKER_TX_SENT          1     /* QoS1: sent, waiting for PUBACK     */
+#define  MQBROKER_TX_DONE          2     /* sent (QoS0) or acked (QoS1)        */
+
+#define  MQBROKER_WILD_HASH   0xFFFF     /* filter's 1st level is + or #       */
+#define  MQBROKER_MAX_FILTERS      8     /* topic filters in one (UN)SUBSCRIBE */
+#define  MQBROKER_CONNECT_MS   10000     /* time allowed for the CONNECT       */
+#define  MQBROKER_CLOSE            1     /* packet handler: client said DISCONNECT */
+
+#define  TXQ_MASK      (MQBROKER_TXQ_DEPTH - 1)
+
+#if (MQBROKER_TXQ_DEPTH & TXQ_MASK) != 0 || MQBROKER_TXQ_DEPTH > 128
+#error "MQBROKER_TXQ_DEPTH must be a power of 2, no more than 128"
+#endif
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static int       mqbrk_client_rx (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt);
+static int       mqbrk_client_tx (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt);
+static int       mqbrk_packet (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt,
+                               unsigned char *buf, int len);
+static int       mqbrk_connect (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt,
+                                unsigned char *buf, int len);
+static int       mqbrk_subscribe (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt,
+                                  unsigned char *buf, int len, int subscribe);
+static int       mqbrk_fanout (MQTT_BROKER *broker, MQTTString *topic,
+                               unsigned char *payload, int payloadlen,
+                               int qos, int flags);
+static void      mqbrk_ctl_put (MQBROKER_CLIENT *clnt, unsigned char *data, int len);
+static void      mqbrk_drop_client (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt,
+                                    int error);
+static void      mqbrk_msg_release (MQTT_BROKER *broker, int slot);
+static void      mqbrk_txq_advance (MQBROKER_CLIENT *clnt);
+static uint16_t  mqbrk_level1_hash (const char *topic, int len);
+static int       mqbrk_filter_valid (const char *filter, int len);
+static int       mqbrk_match (const char *filter, const char *topic, int topic_len);
+
+
+//*****************************************************************************
+//  MQTTBroker_Init
+//
+//          Setup the broker. listen_sock is the server socket local clients
+//          connect to (e.g. from mnet_server_listen() on port 1883).
+//*****************************************************************************
+int  MQTTBroker_Init (MQTT_BROKER *broker, const MQBROKER_NET_OPS *ops,
+                      int listen_sock)
+{
+    int   i;
+
+    if (broker == 0L || ops == 0L || ops->accept == 0L || ops->recv == 0L
+       || ops->send == 0L || ops->close == 0L)
+       return (ERR_MQBROKER_INVALID_PARM);
+
+    memset (broker, 0, sizeof(MQTT_BROKER));
+    broker->ops         = ops;
+    broker->listen_sock = listen_sock;
+    for (i = 0;  i < MQBROKER_MAX_CLIENTS;  i++)
+      broker->clients[i].sock = -1;
+    for (i = 0;  i < MQBROKER_MAX_SUBS;  i++)
+      broker->subs[i].client = -1;
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  MQTTBroker_Yield
+//
+//          Service the broker: accept new clients, process what they sent,
+//          push queued deliveries out, re-send unacked QoS1 messages, and
+//          drop clients whose keep alive has run out.
+//
+//          Call it from the main loop as often as possible. now_ms is a
+//          free running millisecond tick (HAL_GetTick(), MilliTimer).
+//*****************************************************************************
+int  MQTTBroker_Yield (MQTT_BROKER *broker, uint32_t now_ms)
+{
+    MQBROKER_CLIENT  *clnt;
+    uint32_t  limit;
+    int       i, sock, rc;
+
+    broker->now_ms = now_ms;
+
+       //--------------------------------------------------------------
+       //  Accept any new clients
+       //--------------------------------------------------------------
+    for ( ; ; )
+      { sock = broker->ops->accept (broker->listen_sock);
+        if (sock < 0)
+           break;                        // no more waiting
+        for (i = 0;  i < MQBROKER_MAX_CLIENTS;  i++)
+          if (broker->clients[i].sock < 0)
+             break;
+        if (i >= MQBROKER_MAX_CLIENTS)
+           { broker->ops->close (sock);  // full: turn it away
+             broker->clients_dropped++;
+             continue;
+           }
+        clnt = &broker->clients[i];
+        memset (clnt, 0, sizeof(MQBROKER_CLIENT));
+        clnt->sock          = sock;
+        clnt->last_rx_ms    = now_ms;
+        clnt->next_packetid = 1;
+      }
+
+       //--------------------------------------------------------------
+       //  Receive and process, then transmit, for each client
+       //--------------------------------------------------------------
+    for (i = 0;  i < MQBROKER_MAX_CLIENTS;  i++)
+      { clnt = &broker->clients[i];
+        if (clnt->sock < 0)
+           continue;
+        rc = mqbrk_client_rx (broker, clnt);
+        if (rc != 0)
+           { mqbrk_drop_client (broker, clnt, (rc != MQBROKER_CLOSE));
+             continue;
+           }
+           // keep alive: the spec allows 1.5 x the client's interval
+        if (clnt->connected)
+           limit = (clnt->keepalive_secs == 0) ? 0
+                                               : clnt->keepalive_secs * 1500UL;
+           else limit = MQBROKER_CONNECT_MS;
+        if (limit != 0 && (now_ms - clnt->last_rx_ms) > limit)
+           mqbrk_drop_client (broker, clnt, 1);
+      }
+    for (i = 0;  i < MQBROKER_MAX_CLIENTS;  i++)
+      { clnt = &broker->clients[i];
+        if (clnt->sock < 0)
+           continue;
+        if (mqbrk_client_tx (broker, clnt) < 0)
+           mqbrk_drop_client (broker, clnt, 1);
+      }
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  MQTTBroker_Publish
+//
+//          Publish a message from the gateway itself (sensor readings, or
+//          messages received from the upstream broker) to the local
+//          subscribers.
+//
+//          Use MQBROKER_FROM_BRIDGE for upstream messages, so they are not
+//          bridged straight back up.
+//
+//          Returns the # of subscribers it was queued for, or < 0.
+//*****************************************************************************
+int  MQTTBroker_Publish (MQTT_BROKER *broker, const char *topic,
+                         const void *payload, int payloadlen, int qos, int flags)
+{
+    MQTTString  topic_str = MQTTString_initializer;
+
+    if (broker == 0L || topic == 0L || topic[0] == '\0' || payloadlen < 0
+       || (payload == 0L && payloadlen > 0) || qos < 0 || qos > 1)
+       return (ERR_MQBROKER_INVALID_PARM);
+    if (strchr (topic, '+') != 0L || strchr (topic, '#') != 0L)
+       return (ERR_MQBROKER_INVALID_PARM);       // no wildcards in a topic
+
+    topic_str.lenstring.data = (char*) topic;
+    topic_str.lenstring.len  = strlen (topic);
+    return (mqbrk_fanout (broker, &topic_str, (unsigned char*) payload,
+                          payloadlen, qos, flags));
+}
+
+
+//*****************************************************************************
+//  MQTTBroker_Bridge_Topic
+//
+//          Forward PUBLISHes from local clients that match filter to
+//          handler, which normally MQTTPublish()es them to the upstream
+//          broker. The filter may use + and # wildcards.
+//*****************************************************************************
+int  MQTTBroker_Bridge_Topic (MQTT_BROKER *broker, const char *filter,
+                              MQBROKER_BRIDGE_HANDLER handler, void *parm)
+{
+    MQBROKER_BRIDGE  *brg;
+    int   i, len;
+
+    if (broker == 0L || filter == 0L || handler == 0L)
+       return (ERR_MQBROKER_INVALID_PARM);
+    len = strlen (filter);
+    if (len >= MQBROKER_TOPIC_SIZE || ! mqbrk_filter_valid (filter, len))
+       return (ERR_MQBROKER_INVALID_PARM);
+
+    for (i = 0;  i < MQBROKER_MAX_BRIDGES;  i++)
+      { brg = &broker->bridges[i];
+        if (brg->handler == 0L)
+           { memcpy (brg->filter, filter, len + 1);
+             brg->parm    = parm;
+             brg->handler = handler;
+             return (0);                // denote success
+           }
+      }
+    return (ERR_MQBROKER_TABLE_FULL);
+}
+
+
+//*****************************************************************************
+//  MQTTBroker_Topic_Matches
+//
+//          Returns 1 if topic (topic_len chars, not \0 terminated) matches
+//          the subscription filter, else 0.
+//*****************************************************************************
+int  MQTTBroker_Topic_Matches (const char *filter, const char *topic,
+                               int topic_len)
+{
+    return (mqbrk_match (filter, topic, topic_len));
+}
+
+
+//*****************************************************************************
+//  MQTTBroker_Close
+//
+//          Disconnect every local client.
+//*****************************************************************************
+void  MQTTBroker_Close (MQTT_BROKER *broker)
+{
+    int   i;
+
+    for (i = 0;  i < MQBROKER_MAX_CLIENTS;  i++)
+      if (broker->clients[i].sock >= 0)
+         mqbrk_drop_client (broker, &broker->clients[i], 0);
+}
+
+
+//*****************************************************************************
+//  mqbrk_client_rx
+//
+//          Read what the client sent, and process every complete packet in
+//          its receive buffer.
+//
+//          A packet is only processed when its responses are sure to fit in
+//          the client's ctl buffer. Otherwise it waits in rx_buf until
+//          mqbrk_client_tx() has drained ctl (so a client that never reads
+//          ends up stalled by TCP flow control, not by lost acks).
+//
+//          Returns 0, MQBROKER_CLOSE, or < 0 to drop the client.
+//*****************************************************************************
+static int  mqbrk_client_rx (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt)
+{
+    unsigned char  *p;
+    int    n, pass, rem_len, hdr_len, pkt_len, rc, mult;
+
+    for (pass = 0;  pass < 4;  pass++)
+      {
+        if (clnt->rx_len < MQBROKER_RX_BUF_SIZE)
+           { n = broker->ops->recv (clnt->sock, clnt->rx_buf + clnt->rx_len,
+                                    MQBROKER_RX_BUF_SIZE - clnt->rx_len);
+             if (n < 0)
+                return (n);              // connection is gone
+             if (n > 0)
+                { clnt->rx_len    += n;
+                  clnt->last_rx_ms = broker->now_ms;
+                }
+           }
+           else n = 0;
+
+           // process each complete packet: header byte, 1-4 byte remaining
+           // length, then the rest
+        p = clnt->rx_buf;
+        for ( ; ; )
+          { if (p + 2 > clnt->rx_buf + clnt->rx_len)
+               break;
+            rem_len = 0;
+            mult    = 1;
+            for (hdr_len = 1;  hdr_len <= 4;  hdr_len++)
+              { if (p + hdr_len >= clnt->rx_buf + clnt->rx_len)
+                   { hdr_len = 0;        // rest of the length not here yet
+                     break;
+                   }
+                rem_len += (p[hdr_len] & 0x7F) * mult;
+                mult    *= 128;
+                if ((p[hdr_len] & 0x80) == 0)
+                   break;
+              }
+            if (hdr_len == 0)
+               break;
+            if (hdr_len > 4)
+               return (ERR_MQBROKER_PROTOCOL);   // bad remaining length
+            pkt_len = 1 + hdr_len + rem_len;
+            if (pkt_len > MQBROKER_RX_BUF_SIZE)
+               return (ERR_MQBROKER_PROTOCOL);   // can never fit
+            if (p + pkt_len > clnt->rx_buf + clnt->rx_len)
+               break;                            // rest not here yet
+            if (clnt->ctl_len + 4 + MQBROKER_MAX_FILTERS > MQBROKER_CTL_SIZE)
+               break;                            // wait for acks to drain
+
+            rc = mqbrk_packet (broker, clnt, p, pkt_len);
+            if (rc != 0)
+               return (rc);
+            p += pkt_len;
+          }
+        if (p != clnt->rx_buf)
+           { clnt->rx_len -= (p - clnt->rx_buf);      // keep any partial
+             memmove (clnt->rx_buf, p, clnt->rx_len);
+           }
+        if (n == 0)
+           break;                        // nothing more came in
+      }
+    return (0);
+}
+
+
+//*****************************************************************************
+//  mqbrk_packet
+//
+//          Process one complete packet from a client.
+//*****************************************************************************
+static int  mqbrk_packet (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt,
+                          unsigned char *buf, int len)
+{
+    MQBROKER_TXQ   *txe;
+    MQTTString     topic = MQTTString_initializer;
+    unsigned char  dup, retained, type, *payload;
+    unsigned short packetid;
+    unsigned char  ack [4];
+    int            qos, rc;
+    int            payloadlen = -1;
+    uint8_t        i;
+
+    type = buf[0] >> 4;
+    if ( ! clnt->connected && type != CONNECT)
+       return (ERR_MQBROKER_PROTOCOL);    // CONNECT must come first
+
+    switch (type)
+      {
+        case CONNECT:
+                if (clnt->connected)
+                   return (ERR_MQBROKER_PROTOCOL);  // only one per session
+                return (mqbrk_connect (broker, clnt, buf, len));
+
+        case PUBLISH:
+                rc = MQTTDeserialize_publish (&dup, &qos, &retained, &packetid,
+                                              &topic, &payload, &payloadlen,
+                                              buf, len);
+                   // (a truncated topic can still return 1: check the parts)
+                if (rc != 1 || qos > 1 || topic.lenstring.data == 0L
+                   || topic.lenstring.len == 0 || payloadlen < 0)
+                   return (ERR_MQBROKER_PROTOCOL);  // QoS2 is not supported
+                if (memchr (topic.lenstring.data, '+', topic.lenstring.len) != 0L
+                   || memchr (topic.lenstring.data, '#', topic.lenstring.len) != 0L)
+                   return (ERR_MQBROKER_PROTOCOL);
+                if (qos == 1)
+                   { rc = MQTTSerialize_puback (ack, sizeof(ack), packetid);
+                     mqbrk_ctl_put (clnt, ack, rc);
+                   }
+                mqbrk_fanout (broker, &topic, payload, payloadlen, qos, 0);
+                return (0);
+
+        case PUBACK:
+                if (MQTTDeserialize_ack (&type, &dup, &packetid, buf, len) != 1)
+                   return (ERR_MQBROKER_PROTOCOL);
+                for (i = clnt->txq_head;  i != clnt->txq_send;  i++)
+                  { txe = &clnt->txq [i & TXQ_MASK];
+                    if (txe->state == MQBROKER_TX_SENT && txe->packetid == packetid)
+                       { txe->state = MQBROKER_TX_DONE;
+                         mqbrk_msg_release (broker, txe->msg);
+                         break;
+                       }
+                  }
+                mqbrk_txq_advance (clnt);
+                return (0);              // unknown ids are ignored
+
+        case SUBSCRIBE:
+                return (mqbrk_subscribe (broker, clnt, buf, len, 1));
+
+        case UNSUBSCRIBE:
+                return (mqbrk_subscribe (broker, clnt, buf, len, 0));
+
+        case PINGREQ:
+                ack[0] = PINGRESP << 4;
+                ack[1] = 0;
+                mqbrk_ctl_put (clnt, ack, 2);
+                return (0);
+
+        case DISCONNECT:
+                return (MQBROKER_CLOSE);
+
+        default:                         // QoS2 flows, or server->client types
+                return (ERR_MQBROKER_PROTOCOL);
+      }
+}
+
+
+//*****************************************************************************
+//  mqbrk_connect
+//
+//          Accept a CONNECT.  An empty client id gets one assigned. A client
+//          id that is already connected takes over: the old one is dropped.
+//*****************************************************************************
+static int  mqbrk_connect (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt,
+                           unsigned char *buf, int len)
+{
+    MQTTPacket_connectData  data = MQTTPacket_connectData_initializer;
+    unsigned char  connack [4];
+    int   i, id_len, rc;
+
+    if (MQTTDeserialize_connect (&data, buf, len) != 1)
+       return (ERR_MQBROKER_PROTOCOL);   // malformed, or unknown version
+
+    id_len = data.clientID.lenstring.len;
+    if (id_len >= MQBROKER_CLIENT_ID_SIZE
+       || (id_len == 0 && data.cleansession == 0))
+       {       // 2 = identifier rejected
+         rc = MQTTSerialize_connack (connack, sizeof(connack), 2, 0);
+         broker->ops->send (clnt->sock, connack, rc);
+         return (ERR_MQBROKER_PROTOCOL);
+       }
+    if (id_len == 0)
+       { strcpy (clnt->client_id, "gw-0");
+         clnt->client_id[3] = (char) ('0' + (clnt - broker->clients));
+       }
+       else { memcpy (clnt->client_id, data.clientID.lenstring.data, id_len);
+              clnt->client_id [id_len] = '\0';
+            }
+
+    for (i = 0;  i < MQBROKER_MAX_CLIENTS;  i++)
+      if (&broker->clients[i] != clnt && broker->clients[i].connected
+         && strcmp (broker->clients[i].client_id, clnt->client_id) == 0)
+         mqbrk_drop_client (broker, &broker->clients[i], 0);    // take over
+
+    clnt->keepalive_secs = data.keepAliveInterval;
+    clnt->connected      = 1;
+    rc = MQTTSerialize_connack (connack, sizeof(connack), 0, 0);  // accepted
+    mqbrk_ctl_put (clnt, connack, rc);
+    return (0);
+}
+
+
+//*****************************************************************************
+//  mqbrk_subscribe
+//
+//          Process a SUBSCRIBE (subscribe = 1) or UNSUBSCRIBE (0).
+//          Re-subscribing to the same filter just updates its QoS.
+//*****************************************************************************
+static int  mqbrk_subscribe (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt,
+                             unsigned char *buf, int len, int subscribe)
+{
+    MQTTString      filters [MQBROKER_MAX_FILTERS];
+    int             qoss [MQBROKER_MAX_FILTERS];
+    MQBROKER_SUB    *sub, *free_sub;
+    unsigned char   dup, resp [4 + MQBROKER_MAX_FILTERS];
+    unsigned short  packetid;
+    char            *flt;
+    int             count, i, j, flen, cidx, rc;
+
+    cidx = clnt - broker->clients;
+    if (subscribe)
+       rc = MQTTDeserialize_subscribe (&dup, &packetid, MQBROKER_MAX_FILTERS,
+                                       &count, filters, qoss, buf, len);
+       else rc = MQTTDeserialize_unsubscribe (&dup, &packetid,
+                                       MQBROKER_MAX_FILTERS, &count, filters,
+                                       buf, len);
+    if (rc != 1 || count <= 0)
+       return (ERR_MQBROKER_PROTOCOL);
+
+    for (i = 0;  i < count;  i++)
+      { flt  = filters[i].lenstring.data;
+        flen = filters[i].lenstring.len;
+        free_sub = 0L;
+        for (j = 0;  j < MQBROKER_MAX_SUBS;  j++)
+          { sub = &broker->subs[j];
+            if (sub->client < 0)
+               { if (free_sub == 0L)
+                    free_sub = sub;
+                 continue;
+               }
+            if (sub->client == cidx && flen < MQBROKER_TOPIC_SIZE
+               && strncmp (sub->filter, flt, flen) == 0
+               && sub->filter[flen] == '\0')
+               break;                    // client already has this filter
+          }
+        if (j >= MQBROKER_MAX_SUBS)
+           sub = 0L;
+
+        if ( ! subscribe)
+           { if (sub != 0L)
+                sub->client = -1;        // remove it
+             continue;
+           }
+        if (flen >= MQBROKER_TOPIC_SIZE || ! mqbrk_filter_valid (flt, flen))
+           { qoss[i] = 0x80;             // failure
+             continue;
+           }
+        if (sub == 0L)
+           { if (free_sub == 0L)
+                { qoss[i] = 0x80;        // index is full
+                  continue;
+                }
+             sub = free_sub;
+             memcpy (sub->filter, flt, flen);
+             sub->filter [flen] = '\0';
+             sub->level1_hash   = mqbrk_level1_hash (flt, flen);
+             sub->client        = (int8_t) cidx;
+           }
+        if (qoss[i] > 1)
+           qoss[i] = 1;                  // grant at most QoS1
+        sub->qos = (uint8_t) qoss[i];
+      }
+
+    if (subscribe)
+       rc = MQTTSerialize_suback (resp, sizeof(resp), packetid, count, qoss);
+       else rc = MQTTSerialize_unsuback (resp, sizeof(resp), packetid);
+    if (rc <= 0)
+       return (ERR_MQBROKER_PROTOCOL);
+    mqbrk_ctl_put (clnt, resp, rc);
+    return (0);
+}
+
+
+//*****************************************************************************
+//  mqbrk_fanout
+//
+//          Hand a PUBLISH to the bridges, then queue it once for every
+//          client with a matching subscription.
+//
+//          The message is serialized (as a QoS0 PUBLISH) into one pool slot,
+//          and each client's queue only gets a reference to that slot.
+//*****************************************************************************
+static int  mqbrk_fanout (MQTT_BROKER *broker, MQTTString *topic,
+                          unsigned char *payload, int payloadlen,
+                          int qos, int flags)
+{
+    MQBROKER_CLIENT  *clnt;
+    MQBROKER_SUB     *sub;
+    MQBROKER_MSG     *msg;
+    MQBROKER_TXQ     *txe;
+    int8_t    best [MQBROKER_MAX_CLIENTS];
+    uint16_t  hash;
+    int       i, slot, num_subs, tlen, len, queued;
+
+    broker->msgs_in++;
+    tlen = topic->lenstring.len;
+
+       //--------------------------------------------------------------
+       //  Upstream bridges
+       //--------------------------------------------------------------
+    if ((flags & MQBROKER_FROM_BRIDGE) == 0)
+       { for (i = 0;  i < MQBROKER_MAX_BRIDGES;  i++)
+           if (broker->bridges[i].handler != 0L
+              && mqbrk_match (broker->bridges[i].filter, topic->lenstring.data, tlen))
+              { broker->bridges[i].handler (broker->bridges[i].parm, topic,
+                                            payload, payloadlen, qos);
+                broker->msgs_bridged++;
+              }
+       }
+
+       //--------------------------------------------------------------
+       //  Find the subscribers: highest matching QoS per client
+       //--------------------------------------------------------------
+    memset (best, -1, sizeof(best));
+    hash     = mqbrk_level1_hash (topic->lenstring.data, tlen);
+    num_subs = 0;
+    for (i = 0;  i < MQBROKER_MAX_SUBS;  i++)
+      { sub = &broker->subs[i];
+        if (sub->client < 0)
+           continue;
+        if (sub->level1_hash != hash && sub->level1_hash != MQBROKER_WILD_HASH)
+           continue;                     // index: 1st level can not match
+        if ( ! mqbrk_match (sub->filter, topic->lenstring.data, tlen))
+           continue;
+        if (best [sub->client] < 0)
+           num_subs++;
+        if ((int) sub->qos > best [sub->client])
+           best [sub->client] = (int8_t) sub->qos;
+      }
+    if (num_subs == 0)
+       return (0);                       // nobody local wants it
+
+       //--------------------------------------------------------------
+       //  Store it once in the pool
+       //--------------------------------------------------------------
+    for (slot = 0;  slot < MQBROKER_POOL_MSGS;  slot++)
+      if (broker->pool[slot].refs == 0)
+         break;
+    if (slot >= MQBROKER_POOL_MSGS)
+       { broker->drops += num_subs;
+         return (ERR_MQBROKER_POOL_EMPTY);
+       }
+    msg = &broker->pool[slot];
+    len = MQTTSerialize_publish (msg->pkt, MQBROKER_MSG_SIZE, 0, 0, 0, 0,
+                                 *topic, payload, payloadlen);
+    if (len <= 0)
+       { broker->drops += num_subs;      // bigger than MQBROKER_MSG_SIZE
+         return (ERR_MQBROKER_POOL_EMPTY);
+       }
+    msg->len         = (uint16_t) len;
+    msg->qos         = (uint8_t) qos;
+    msg->payload_off = (uint16_t) (len - payloadlen);
+    msg->topic_off   = (uint16_t) (msg->payload_off - 2 - tlen);
+
+       //--------------------------------------------------------------
+       //  Queue a reference to it for each subscriber
+       //--------------------------------------------------------------
+    queued = 0;
+    for (i = 0;  i < MQBROKER_MAX_CLIENTS;  i++)
+      { clnt = &broker->clients[i];
+        if (best[i] < 0 || ! clnt->connected)
+           continue;
+        if ((uint8_t) (clnt->txq_tail - clnt->txq_head) >= MQBROKER_TXQ_DEPTH)
+           { broker->drops++;            // slow consumer
+             continue;
+           }
+        txe = &clnt->txq [clnt->txq_tail & TXQ_MASK];
+        txe->msg   = (uint8_t) slot;
+        txe->qos   = (qos < best[i]) ? (uint8_t) qos : (uint8_t) best[i];
+        txe->state = MQBROKER_TX_QUEUED;
+        if (txe->qos == 1 && tlen + 2 > MQBROKER_TOPIC_SIZE)
+           txe->qos = 0;                 // topic too long for the QoS1 header
+        if (txe->qos == 1)
+           { txe->packetid = clnt->next_packetid++;
+             if (clnt->next_packetid == 0)
+                clnt->next_packetid = 1;
+           }
+        clnt->txq_tail++;
+        msg->refs++;
+        queued++;
+      }
+    if (queued > 0)
+       { broker->pool_in_use++;
+         if (broker->pool_in_use > broker->pool_max_in_use)
+            broker->pool_max_in_use = broker->pool_in_use;
+       }
+    return (queued);
+}
+
+
+//*****************************************************************************
+//  mqbrk_client_tx
+//
+//          Send what is waiting for a client: first any acks / responses in
+//          ctl, then the queued deliveries. Sends may be partial: tx_off
+//          tracks how much of the current delivery is out, and nothing else
+//          is sent until it is complete.
+//
+//          QoS1 deliveries that have not been acked after MQBROKER_RETRY_MS
+//          are re-sent, with DUP set.
+//*****************************************************************************
+static int  mqbrk_client_tx (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt)
+{
+    MQBROKER_TXQ   *txe;
+    MQBROKER_MSG   *msg;
+    unsigned char  *part;
+    int            n, total, part_len, first_len;
+    uint8_t        i;
+
+    if (clnt->tx_off == 0)
+       {
+            // acks / responses
+         if (clnt->ctl_len > 0)
+            { n = broker->ops->send (clnt->sock, clnt->ctl, clnt->ctl_len);
+              if (n < 0)
+                 return (n);
+              clnt->ctl_len -= n;
+              if (clnt->ctl_len > 0)
+                 { memmove (clnt->ctl, clnt->ctl + n, clnt->ctl_len);
+                   return (0);           // rest next time
+                 }
+            }
+            // re-send from the oldest QoS1 delivery whose ack is overdue
+         for (i = clnt->txq_head;  i != clnt->txq_send;  i++)
+           { txe = &clnt->txq [i & TXQ_MASK];
+             if (txe->state == MQBROKER_TX_SENT
+                && (broker->now_ms - txe->sent_ms) >= MQBROKER_RETRY_MS)
+                { clnt->txq_send = i;
+                  break;
+                }
+           }
+       }
+
+    while (clnt->txq_send != clnt->txq_tail)
+      {
+        txe = &clnt->txq [clnt->txq_send & TXQ_MASK];
+        if (txe->state == MQBROKER_TX_DONE)
+           { clnt->txq_send++;           // acked while waiting for re-send
+             continue;
+           }
+        msg = &broker->pool [txe->msg];
+
+           // build the QoS1 header: fixed header + topic + packet id
+        if (txe->qos == 1 && clnt->tx_off == 0)
+           { part    = clnt->hdr;
+             *part++ = (PUBLISH << 4) | 0x02
+                       | ((txe->state == MQBROKER_TX_SENT) ? 0x08 : 0); // DUP
+             part   += MQTTPacket_encode (part, msg->len - msg->topic_off + 2);
+             memcpy (part, msg->pkt + msg->topic_off,
+                     msg->payload_off - msg->topic_off);
+             part   += msg->payload_off - msg->topic_off;
+             *part++ = (unsigned char) (txe->packetid >> 8);
+             *part++ = (unsigned char) txe->packetid;
+             clnt->hdr_len = (uint16_t) (part - clnt->hdr);
+           }
+        if (txe->qos == 1)
+           { first_len = clnt->hdr_len;  // header, then the stored payload
+             total     = first_len + msg->len - msg->payload_off;
+           }
+           else { first_len = msg->len;  // stored packet as is
+                  total     = msg->len;
+                }
+
+        if (clnt->tx_off < first_len)
+           { part     = (txe->qos == 1) ? clnt->hdr : msg->pkt;
+             part    += clnt->tx_off;
+             part_len = first_len - clnt->tx_off;
+           }
+           else { part     = msg->pkt + msg->payload_off + (clnt->tx_off - first_len);
+                  part_len = total - clnt->tx_off;
+                }
+        n = broker->ops->send (clnt->sock, part, part_len);
+        if (n < 0)
+           return (n);
+        if (n == 0)
+           return (0);                   // socket full: try next time
+        clnt->tx_off += n;
+        if (clnt->tx_off < total)
+           continue;
+
+        clnt->tx_off = 0;                // this delivery is out
+        broker->msgs_out++;
+        clnt->txq_send++;
+        if (txe->qos == 1)
+           { txe->state   = MQBROKER_TX_SENT;
+             txe->sent_ms = broker->now_ms;
+           }
+           else { txe->state = MQBROKER_TX_DONE;
+                  mqbrk_msg_release (broker, txe->msg);
+                }
+        mqbrk_txq_advance (clnt);
+      }
+    return (0);
+}
+
+
+//*****************************************************************************
+//  mqbrk_ctl_put
+//
+//          Queue an ack / response. mqbrk_client_rx() only processes a
+//          packet when there is room for its responses.
+//*****************************************************************************
+static void  mqbrk_ctl_put (MQBROKER_CLIENT *clnt, unsigned char *data, int len)
+{
+    if (len <= 0 || clnt->ctl_len + len > MQBROKER_CTL_SIZE)
+       return;
+    memcpy (clnt->ctl + clnt->ctl_len, data, len);
+    clnt->ctl_len += len;
+}
+
+
+//*****************************************************************************
+//  mqbrk_drop_client
+//
+//          Close a client's connection, release everything still queued for
+//          it, and remove its subscriptions (clean session).
+//*****************************************************************************
+static void  mqbrk_drop_client (MQTT_BROKER *broker, MQBROKER_CLIENT *clnt,
+                                int error)
+{
+    MQBROKER_TXQ  *txe;
+    int       i, cidx;
+    uint8_t   q;
+
+    broker->ops->close (clnt->sock);
+    if (error)
+       broker->clients_dropped++;
+
+    for (q = clnt->txq_head;  q != clnt->txq_tail;  q++)
+      { txe = &clnt->txq [q & TXQ_MASK];
+        if (txe->state != MQBROKER_TX_DONE)
+           mqbrk_msg_release (broker, txe->msg);
+      }
+    cidx = clnt - broker->clients;
+    for (i = 0;  i < MQBROKER_MAX_SUBS;  i++)
+      if (broker->subs[i].client == cidx)
+         broker->subs[i].client = -1;
+
+    memset (clnt, 0, sizeof(MQBROKER_CLIENT));
+    clnt->sock = -1;
+}
+
+
+//*****************************************************************************
+//  mqbrk_msg_release
+//
+//          Drop one reference to a pool slot. Frees it on the last one.
+//*****************************************************************************
+static void  mqbrk_msg_release (MQTT_BROKER *broker, int slot)
+{
+    MQBROKER_MSG  *msg;
+
+    msg = &broker->pool[slot];
+    if (msg->refs == 0)
+       return;
+    if (--msg->refs == 0)
+       broker->pool_in_use--;
+}
+
+
+//*****************************************************************************
+//  mqbrk_txq_advance
+//
+//          Retire finished deliveries from the front of a client's queue.
+//*****************************************************************************
+static void  mqbrk_txq_advance (MQBROKER_CLIENT *clnt)
+{
+    while (clnt->txq_head != clnt->txq_send
+          && clnt->txq [clnt->txq_head & TXQ_MASK].state == MQBROKER_TX_DONE)
+      clnt->txq_head++;
+}
+
+
+//*****************************************************************************
+//  mqbrk_level1_hash
+//
+//          Subscription index key: hash of the topic's first level.
+//          A filter whose first level is a wildcard gets MQBROKER_WILD_HASH,
+//          which is never produced for a literal level.
+//*****************************************************************************
+static uint16_t  mqbrk_level1_hash (const char *topic, int len)
+{
+    uint16_t  hash;
+    int       i;
+
+    if (len > 0 && (topic[0] == '+' || topic[0] == '#'))
+       return (MQBROKER_WILD_HASH);
+    hash = 5381;
+    for (i = 0;  i < len && topic[i] != '/';  i++)
+      hash = (uint16_t) ((hash << 5) + hash + (uint8_t) topic[i]);
+    if (hash == MQBROKER_WILD_HASH)
+       hash--;
+    return (hash);
+}
+
+
+//*****************************************************************************
+//  mqbrk_filter_valid
+//
+//          '+' must be a whole level, '#' must be the whole last level.
+//*****************************************************************************
+static int  mqbrk_filter_valid (const char *filter, int len)
+{
+    int   i;
+
+    if (len == 0)
+       return (0);
+    for (i = 0;  i < len;  i++)
+      { if (filter[i] == '\0')
+           return (0);
+        if (filter[i] == '+' || filter[i] == '#')
+           { if (i > 0 && filter[i-1] != '/')
+                return (0);
+             if (filter[i] == '#' && i != len - 1)
+                return (0);
+             if (filter[i] == '+' && i < len - 1 && filter[i+1] != '/')
+                return (0);
+           }
+      }
+    return (1);
+}
+
+
+//*****************************************************************************
+//  mqbrk_match
+//
+//          Match a topic against a \0 terminated filter. Wildcards at the
+//          first level do not match topics starting with '$' ($SYS etc).
+//*****************************************************************************
+static int  mqbrk_match (const char *filter, const char *topic, int topic_len)
+{
+    const char  *end;
+
+    end = topic + topic_len;
+    if (topic_len > 0 && topic[0] == '$' && (*filter == '+' || *filter == '#'))
+       return (0);
+
+    while (*filter != '\0')
+      {
+        if (*filter == '#')
+           return (1);                   // matches the rest, incl. parent
+        if (*filter == '+')
+           { while (topic < end && *topic != '/')
+               topic++;                  // skip one whole level
+             filter++;
+           }
+        else
+           { if (topic >= end || *topic != *filter)
+                return (0);
+             topic++;
+             filter++;
+           }
+        if (*filter == '/' && topic >= end)
+           return (filter[1] == '#' && filter[2] == '\0');   // "a/#" matches "a"
+      }
+    return (topic == end);
+}
+
+
+#if !defined(MQBROKER_NO_MNET)
+//*****************************************************************************
+//  MQTTBroker_mnet_ops
+//
+//          Network ops over the mnet_xxx() TCP sockets. mnet returns EAGAIN
+//          when a non-blocking call could not do anything.
+//*****************************************************************************
+static int  mqbrk_mnet_accept (int listen_sock)
+{
+    int  sock;
+
+    sock = mnet_server_accept (listen_sock, 0);
+    return ((sock == EAGAIN) ? -1 : sock);
+}
+
+static int  mqbrk_mnet_recv (int sock, unsigned char *buf, int len)
+{
+    int  rc;
+
+    if (mnet_check_for_recv_data (sock, 0) <= 0)
+       return (0);                       // nothing waiting
+    rc = mnet_recv (sock, buf, len, 0);
+    return ((rc == EAGAIN) ? 0 : rc);
+}
+
+static int  mqbrk_mnet_send (int sock, const unsigned char *buf, int len)
+{
+    int  rc;
+
+    rc = mnet_send (sock, (unsigned char*) buf, len, 0);
+    return ((rc == EAGAIN) ? 0 : rc);
+}
+
+static void  mqbrk_mnet_close (int sock)
+{
+    mnet_close_connection (sock);
+}
+
+const MQBROKER_NET_OPS  MQTTBroker_mnet_ops =
+   { mqbrk_mnet_accept, mqbrk_mnet_recv, mqbrk_mnet_send, mqbrk_mnet_close };
+#endif
+
+//*****************************************************************************
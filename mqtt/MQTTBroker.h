@@ -0,0 +1,232 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                               MQTTBroker.h
+//
+//
+//  Definitions for the embedded MQTT broker, for gateway boards (F4/F7).
+//
+//  Local BLE / sub-GHz / TCP nodes publish to, and subscribe on, the gateway
+//  itself, so local consumers get their data without a WAN round trip to a
+//  remote broker. Selected topics are bridged upstream.
+//
+//      MQTTBroker_Init (&broker, &MQTTBroker_mnet_ops, srv_sock_id);
+//      MQTTBroker_Bridge_Topic (&broker, "plant/+/alarm", bridge_up, &upstream);
+//      while (1)
+//        { MQTTBroker_Yield (&broker, HAL_GetTick());
+//          MQTTYield (&upstream, 10);                  remote broker session
+//        }
+//
+//  Built on the server side packet code in this directory
+//  (MQTTDeserialize_connect/_subscribe/_unsubscribe, MQTTSerialize_connack/
+//  _suback/_unsuback) plus the common publish/ack code.
+//
+//  Fan out:  each received PUBLISH is stored once, serialized as a QoS0
+//  PUBLISH packet, in a slot of a shared message pool. Every matching
+//  subscriber's queue gets a reference to that slot (the slot's ref count
+//  is bumped), not a copy. QoS0 deliveries send the stored packet as is.
+//  QoS1 deliveries send a small per-client header (fixed header + topic +
+//  packet id) and then the stored payload. A slot is freed when the last
+//  subscriber has sent it (QoS0) or acked it (QoS1).
+//
+//  Subscription index:  each subscription keeps a hash of its first topic
+//  level (or a wildcard mark), so most non-matching filters are rejected
+//  with one compare before the full '+' / '#' match. A client with several
+//  overlapping subscriptions gets one copy, at the highest matching QoS.
+//
+//  Limits (deliberate, to stay small):  clean sessions only (nothing is kept
+//  when a client disconnects), QoS 0 and 1 (SUBACK grants at most 1; a
+//  QoS2 PUBLISH drops the client), no retained messages, no wills, no
+//  authentication. Packets larger than MQBROKER_RX_BUF_SIZE drop the client.
+//
+//  The broker is a single threaded poll loop: call MQTTBroker_Yield() from
+//  the main loop, never from an ISR. Network I/O goes through a small ops
+//  table, so it can run over the mnet_xxx() sockets (MQTTBroker_mnet_ops),
+//  or over loopback clients in a host build.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __MQTT_BROKER_H__
+#define __MQTT_BROKER_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+#include "MQTTPacket.h"
+
+                        // sizing - override in project_config_parms.h
+#if !defined(MQBROKER_MAX_CLIENTS)
+#define  MQBROKER_MAX_CLIENTS       4    /* local TCP clients at the same time */
+#endif
+#if !defined(MQBROKER_MAX_SUBS)
+#define  MQBROKER_MAX_SUBS         16    /* subscriptions, all clients         */
+#endif
+#if !defined(MQBROKER_MAX_BRIDGES)
+#define  MQBROKER_MAX_BRIDGES       4    /* upstream bridge topic filters      */
+#endif
+#if !defined(MQBROKER_POOL_MSGS)
+#define  MQBROKER_POOL_MSGS        16    /* shared message pool slots          */
+#endif
+#if !defined(MQBROKER_MSG_SIZE)
+#define  MQBROKER_MSG_SIZE        256    /* max stored PUBLISH packet          */
+#endif
+#if !defined(MQBROKER_RX_BUF_SIZE)
+#define  MQBROKER_RX_BUF_SIZE     280    /* per client receive buffer          */
+#endif
+#if !defined(MQBROKER_TXQ_DEPTH)
+#define  MQBROKER_TXQ_DEPTH         8    /* per client queued deliveries (2^n) */
+#endif
+#if !defined(MQBROKER_RETRY_MS)
+#define  MQBROKER_RETRY_MS       5000    /* QoS1 re-send if no PUBACK by then  */
+#endif
+
+#define  MQBROKER_TOPIC_SIZE       48    /* max subscription filter + \0       */
+#define  MQBROKER_CTL_SIZE         32    /* per client CONNACK/SUBACK/PUBACK.. */
+#define  MQBROKER_CLIENT_ID_SIZE   24    /* max client id + \0                 */
+
+            // flags on MQTTBroker_Publish()
+#define  MQBROKER_FROM_BRIDGE  0x0001    /* came from upstream: do not bridge it back */
+
+
+typedef struct mqbroker_net_ops_def      /* network I/O used by the broker */
+   {
+         // returns a new client socket, or < 0 if no client is waiting
+       int   (*accept) (int listen_sock);
+         // both return # bytes, 0 if nothing could be done right now, or
+         // < 0 if the connection is gone. send may be partial.
+       int   (*recv) (int sock, unsigned char *buf, int len);
+       int   (*send) (int sock, const unsigned char *buf, int len);
+       void  (*close) (int sock);
+   } MQBROKER_NET_OPS;
+
+
+                 // called for each PUBLISH that matches a bridge filter.
+                 // payload is only valid during the call.
+typedef void (*MQBROKER_BRIDGE_HANDLER)(void *parm, MQTTString *topic,
+                                        unsigned char *payload, int payloadlen,
+                                        int qos);
+
+
+typedef struct mqbroker_msg_def          /* one shared message pool slot */
+   {
+       uint8_t    refs;                  // # queue entries using it, 0 = free
+       uint8_t    qos;                   // QoS it was published with
+       uint16_t   len;                   // stored PUBLISH packet length
+       uint16_t   topic_off;             // offset of topic's 2 byte length
+       uint16_t   payload_off;           // offset of the payload
+       unsigned char  pkt [MQBROKER_MSG_SIZE];  // QoS0 PUBLISH packet
+   } MQBROKER_MSG;
+
+
+typedef struct mqbroker_txq_def          /* one queued delivery to a client */
+   {
+       uint8_t    msg;                   // pool slot
+       uint8_t    qos;                   // delivery QoS: min(pub, sub)
+       uint8_t    state;                 // MQBROKER_TX_xxx (in MQTTBroker.c)
+       uint16_t   packetid;              // QoS1
+       uint32_t   sent_ms;               // QoS1: for re-send
+   } MQBROKER_TXQ;
+
+
+typedef struct mqbroker_client_def       /* one connected local client */
+   {
+       int        sock;                  // -1 = slot free
+       uint8_t    connected;             // CONNECT was accepted
+       uint16_t   keepalive_secs;
+       uint32_t   last_rx_ms;            // for keep alive checks
+       uint16_t   next_packetid;
+       uint16_t   rx_len;                // bytes in rx_buf
+       uint16_t   tx_off;                // bytes sent of delivery txq_send
+       uint8_t    txq_head;              // oldest un-finished delivery
+       uint8_t    txq_send;              // next delivery to send
+       uint8_t    txq_tail;              // next free entry
+       char       client_id [MQBROKER_CLIENT_ID_SIZE];
+       MQBROKER_TXQ   txq [MQBROKER_TXQ_DEPTH];
+       unsigned char  hdr [8 + MQBROKER_TOPIC_SIZE];   // QoS1 PUBLISH header
+       uint16_t   hdr_len;
+       uint16_t   ctl_len;               // bytes waiting in ctl
+       unsigned char  ctl [MQBROKER_CTL_SIZE];         // acks / responses
+       unsigned char  rx_buf [MQBROKER_RX_BUF_SIZE];
+   } MQBROKER_CLIENT;
+
+
+typedef struct mqbroker_sub_def          /* one subscription */
+   {
+       int8_t     client;                // client slot, -1 = free
+       uint8_t    qos;                   // granted QoS
+       uint16_t   level1_hash;           // index: hash of 1st level, or
+                                         //   MQBROKER_WILD_HASH
+       char       filter [MQBROKER_TOPIC_SIZE];
+   } MQBROKER_SUB;
+
+
+typedef struct mqbroker_bridge_def       /* one upstream bridged filter */
+   {
+       MQBROKER_BRIDGE_HANDLER handler;  // 0L = free
+       void       *parm;
+       char       filter [MQBROKER_TOPIC_SIZE];
+   } MQBROKER_BRIDGE;
+
+
+typedef struct mqtt_broker_def           /* broker control block */
+   {
+       const MQBROKER_NET_OPS *ops;
+       int              listen_sock;
+       uint32_t         now_ms;          // time of the current Yield
+       MQBROKER_CLIENT  clients [MQBROKER_MAX_CLIENTS];
+       MQBROKER_SUB     subs [MQBROKER_MAX_SUBS];
+       MQBROKER_BRIDGE  bridges [MQBROKER_MAX_BRIDGES];
+       MQBROKER_MSG     pool [MQBROKER_POOL_MSGS];
+                                         //---- statistics ----
+       uint32_t         msgs_in;         // PUBLISHes received
+       uint32_t         msgs_out;        // deliveries sent (incl. re-sends)
+       uint32_t         msgs_bridged;    // handed to a bridge handler
+       uint32_t         drops;           // deliveries lost: queue full, no pool slot
+       uint32_t         clients_dropped; // protocol errors / keep alive timeouts
+       uint16_t         pool_in_use;     // slots in use now
+       uint16_t         pool_max_in_use; // high water mark
+   } MQTT_BROKER;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int   MQTTBroker_Init (MQTT_BROKER *broker, const MQBROKER_NET_OPS *ops,
+                       int listen_sock);
+int   MQTTBroker_Yield (MQTT_BROKER *broker, uint32_t now_ms);
+int   MQTTBroker_Publish (MQTT_BROKER *broker, const char *topic,
+                          const void *payload, int payloadlen, int qos, int flags);
+int   MQTTBroker_Bridge_Topic (MQTT_BROKER *broker, const char *filter,
+                               MQBROKER_BRIDGE_HANDLER handler, void *parm);
+int   MQTTBroker_Topic_Matches (const char *filter, const char *topic,
+                                int topic_len);
+void  MQTTBroker_Close (MQTT_BROKER *broker);
+
+#if !defined(MQBROKER_NO_MNET)
+extern const MQBROKER_NET_OPS  MQTTBroker_mnet_ops;   // mnet_xxx() sockets
+#endif
+
+#endif                          //  __MQTT_BROKER_H__
+
+//*****************************************************************************
@@ -21,6 +21,10 @@
  *           Since there are already about 3 different flavors of the MQTT TCP
  *           start up  APIs floating around, I do NOT feel too guilt ridden
  *           about defining this new (IMHO) better set.
+ *    10/19/26 - cc3100_read()/cc3100_write() now run over the non-blocking
+ *           socket layer (common/cc3100_nbsock.c). They honor their timeout,
+ *           return partial counts, and report socket errors, instead of
+ *           spinning forever on a stalled peer.
  *******************************************************************************/
 
 #include "MQTTCC3100.h"
@@ -154,6 +158,12 @@ int32_t  Connect_Server (Network *n, char *srvr_name, int port)
          return retVal;           // bail
        }
 
+    if (nbsock_open(n->my_socket) < 0)  // switch it to non-blocking I/O
+       {
+         sl_Close (n->my_socket);
+         return -1;
+       }
+
 #if defined(USES_MSPWARE)
         // Initialize the MSP432 ??? SysTick Timer and its interrupt
     SysTick_registerInterrupt (SysTickIntHandler);
@@ -246,6 +256,12 @@ int  TLS_Connect_Server (Network *n, char *srvr_name, int port,
             }
        }
 
+    if (nbsock_open(n->my_socket) < 0)  // switch it to non-blocking I/O
+       {
+         sl_Close (n->my_socket);
+         return -1;
+       }
+
 #if defined(USES_MSPWARE)
         // Initialize the MSP432 ??? SysTick Timer and its interrupt
     SysTick_registerInterrupt (SysTickIntHandler);
@@ -266,55 +282,76 @@ int  TLS_Connect_Server (Network *n, char *srvr_name, int port,
 }
 
 
+//*****************************************************************************
+//  cc3100_read
+//
+//          Read len bytes, waiting no longer than timeout_ms.
+//
+//          Returns # bytes read (less than len if the timeout expired), or
+//          -1 if the connection was closed or got an error.
+//*****************************************************************************
 int  cc3100_read (Network* n, unsigned char *buffer, int len, int timeout_ms)
 {
-    SlTimeval_t  timeVal;
-    SlFdSet_t    fdset;
-    int          rc = 0;
+    Timer        timer;
+    int          rc;
     int          recvLen = 0;
-    int          sel_rc;
-
-    SL_FD_ZERO (&fdset);
-    SL_FD_SET (n->my_socket, &fdset);
-
-    timeVal.tv_sec  = 0;
-    timeVal.tv_usec = timeout_ms * 1000;
-    sel_rc = sl_Select (n->my_socket + 1, &fdset, NULL, NULL, &timeVal);
-    if (sel_rc == 1)
-      {               // we got some rcv traffic. try to read in a packet
-         do {
-                rc = sl_Recv (n->my_socket, buffer + recvLen, len - recvLen, 0);
-                recvLen += rc;
-            } while (recvLen < len);
+
+    InitTimer (&timer);
+    countdown_ms (&timer, timeout_ms);
+    while (recvLen < len)
+      {
+        rc = nbsock_recv (n->my_socket, buffer + recvLen, len - recvLen);
+        if (rc > 0)
+           { recvLen += rc;
+             continue;
+           }
+        if (rc == 0  ||  errno != EAGAIN)
+           return (-1);                 // peer closed, or socket error
+        if (expired(&timer))
+           break;                       // partial (or no) data: caller decides
+        nbsock_wait (n->my_socket, NBSOCK_READABLE, left_ms(&timer));
       }
     return recvLen;
 }
 
 
+//*****************************************************************************
+//  cc3100_write
+//
+//          Send len bytes, waiting no longer than timeout_ms for the CC3100
+//          to free up TX buffers.
+//
+//          Returns # bytes sent (less than len if the timeout expired), or
+//          -1 if the connection got an error.
+//*****************************************************************************
 int  cc3100_write (Network *n, unsigned char *buffer, int len, int timeout_ms)
 {
-    SlTimeval_t  timeVal;
-    SlFdSet_t    fdset;
-    int          rc = 0;
-    int          readySock;
-
-    SL_FD_ZERO (&fdset);
-    SL_FD_SET (n->my_socket, &fdset);
-
-    timeVal.tv_sec = 0;
-    timeVal.tv_usec = timeout_ms * 1000;
-    do {
-           readySock = sl_Select (n->my_socket + 1, NULL, &fdset, NULL, &timeVal);
-       } while (readySock != 1);
-
-    rc = sl_Send (n->my_socket, buffer, len, 0);
-    return rc;
+    Timer        timer;
+    int          rc;
+    int          sentLen = 0;
+
+    InitTimer (&timer);
+    countdown_ms (&timer, timeout_ms);
+    while (sentLen < len)
+      {
+        rc = nbsock_send (n->my_socket, buffer + sentLen, len - sentLen);
+        if (rc > 0)
+           { sentLen += rc;
+             continue;
+           }
+        if (errno != EAGAIN)
+           return (-1);                 // socket error
+        if (expired(&timer))
+           break;
+        nbsock_wait (n->my_socket, NBSOCK_WRITABLE, left_ms(&timer));
+      }
+    return sentLen;
 }
 
 
 void cc3100_disconnect (Network* n)
 {
-    sl_Close (n->my_socket);
+    nbsock_close (n->my_socket);
 }
 
 //int publish(Network* n, char* topic, uint8_t* payload, unsigned int plength, bool retained) {
@@ -23,6 +23,7 @@
 #include "simplelink.h"
 #include "netapp.h"
 #include "socket.h"
+#include "cc3100_nbsock.h"          // non-blocking socket layer
 #if defined(USES_MSPWARE)
 #include "systick.h"
 #endif
@@ -12,6 +12,8 @@
  *
  * Contributors:
  *    Allan Stockdill-Mander/Ian Craggs - initial API and implementation and/or initial documentation
+ *    10/19/26 - MQTTPublish_PktBuf(): publish straight from a packet buffer.
+ *    10/19/26 - Stamp the PUBLISH and XMIT latency trace stages (USES_LAT_TRACE).
  *******************************************************************************/
 
 #if defined(USES_MQTT) || (USES_MQTT_CLIENT)
@@ -19,6 +21,10 @@
 #include "user_api.h"
 #include "MQTTClient.h"
 
+#if defined(USES_LAT_TRACE)
+#include "lat_trace.h"                          // per-stage latency stamps
+#endif
+
                                                 // local function prototpypes
 int  cycle (Client *c, Timer *timer);
 int  decodePacket (Client *c, int *value, int timeout);
@@ -169,8 +175,14 @@ int  MQTTPublish (Client *c, const char *topicName, MQTTMessage *message)
                                  message->payloadlen);
     if (len <= 0)
         goto exit;
+#if defined(USES_LAT_TRACE)
+    lat_trace_stamp_current (LAT_STAGE_PUBLISH);   // packet is built
+#endif
     if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the subscribe packet
         goto exit;           // there was a problem
+#if defined(USES_LAT_TRACE)
+    lat_trace_stamp_current (LAT_STAGE_XMIT);      // transport has it all
+#endif
 
     if (message->qos == QOS1)
       {
@@ -200,6 +212,103 @@ exit:
 }
 
 
+#if defined(USES_PKTBUF)
+//**********************************************************************************
+// MQTTPublish_PktBuf
+//
+//          Publish the data in a packet buffer (chain), without copying it
+//          into c->buf. The PUBLISH header (fixed header, topic, packet id)
+//          is pushed into the buffer's headroom, and the blocks are written
+//          to the socket as they are. The header is pulled back off before
+//          returning, so the caller still owns an unchanged buffer.
+//          The first block needs headroom for the header: 5 + 2 + topic
+//          length + 2 bytes at most (see PKTBUF_HEADROOM).
+//**********************************************************************************
+int  MQTTPublish_PktBuf (Client *c, const char *topicName, enum QoS qos,
+                         PKT_BUF *pb)
+{
+    int            rc = FAILURE;
+    int            rem_len, hdr_len, payloadlen, sent;
+    unsigned short packetid = 0;
+    unsigned char  *ptr;
+    PKT_BUF        *blk;
+    MQTTHeader     header = {0};
+    MQTTString     topic = MQTTString_initializer;
+    Timer          timer;
+
+    if (pb == NULL || topicName == NULL || qos == QOS2 || !c->isconnected)
+        return FAILURE;
+
+    InitTimer (&timer);
+    countdown_ms (&timer, c->command_timeout_ms);
+
+    topic.cstring = (char*) topicName;
+    if (qos == QOS1)
+        packetid = getNextPacketId(c);
+
+    payloadlen = pktbuf_total_len (pb);
+    rem_len    = 2 + strlen(topicName) + payloadlen + ((qos > 0) ? 2 : 0);
+    hdr_len    = MQTTPacket_len(rem_len) - payloadlen;
+    ptr        = pktbuf_push (pb, hdr_len);
+    if (ptr == NULL)
+        return BUFFER_OVERFLOW;        // not enough headroom for the header
+
+    header.bits.type = PUBLISH;
+    header.bits.qos  = qos;
+    writeChar (&ptr, header.byte);
+    ptr += MQTTPacket_encode (ptr, rem_len);
+    writeMQTTString (&ptr, topic);
+    if (qos > 0)
+        writeInt (&ptr, packetid);
+#if defined(USES_LAT_TRACE)
+    lat_trace_stamp_current (LAT_STAGE_PUBLISH);   // header is built
+#endif
+
+            //-------------------------------------------------------
+            //  issue the TCP sends straight from the buffer blocks
+            //-------------------------------------------------------
+    for (blk = pb;  blk != NULL;  blk = blk->next)
+      {
+        sent = 0;
+        while (sent < blk->len && !expired(&timer))
+          {
+            rc = c->ipstack->mqttwrite (c->ipstack, pktbuf_data(blk) + sent,
+                                        blk->len - sent, left_ms(&timer));
+            if (rc < 0)
+                break;
+            sent += rc;
+          }
+        if (sent != blk->len)
+          {
+            rc = FAILURE;
+            goto exit;
+          }
+      }
+    countdown (&c->ping_timer, c->keepAliveInterval);
+    rc = SUCCESS;
+#if defined(USES_LAT_TRACE)
+    lat_trace_stamp_current (LAT_STAGE_XMIT);      // every block written
+#endif
+
+    if (qos == QOS1)
+      {
+        if (waitfor(c, PUBACK, &timer) == PUBACK)
+          {
+            unsigned short mypacketid;
+            unsigned char  dup,  type;
+            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
+                rc = FAILURE;
+          }
+         else rc = FAILURE;       // timed out - no PUBACK received
+      }
+
+exit:
+    pktbuf_pull (pb, hdr_len);    // give the caller its buffer back as it was
+    return rc;
+}
+#endif
+
+
 int  MQTTSubscribe (Client *c, const char *topicFilter,  enum QoS qos,
                     messageHandler messageHandler)
 {
@@ -565,7 +674,7 @@ int  sendPacket (Client *c, int length, Timer* timer)
                  //  issue TCP send of the MQTT packet
                  //-------------------------------------
         rc = c->ipstack->mqttwrite (c->ipstack, &c->buf[sent],
-                                    length, left_ms(timer));
+                                    length - sent, left_ms(timer));
         if (rc < 0)     // there was an error writing the data
             break;
         sent += rc;
@@ -14,6 +14,7 @@
  *    Allan Stockdill-Mander/Ian Craggs - initial API and implementation and/or
  *                                        initial documentation.
  *    W Duquaine - extend this to support W5200 Ethernet shield. 04/04/15
+ *    10/19/26 - MQTTPublish_PktBuf(): publish straight from a packet buffer.
  *******************************************************************************/
 
 #ifndef __MQTT_CLIENT_C_
@@ -94,6 +95,10 @@ void MQTTClient (Client*, Network*, unsigned int, unsigned char*, size_t,
                  unsigned char*, size_t);
 int MQTTConnect (Client*, MQTTPacket_connectData*);
 int MQTTPublish (Client*, const char*, MQTTMessage*);
+#if defined(USES_PKTBUF)
+#include "pkt_buf.h"
+int MQTTPublish_PktBuf (Client*, const char*, enum QoS, PKT_BUF*);
+#endif
 int MQTTSubscribe (Client*, const char*, enum QoS, messageHandler);
 int MQTTUnsubscribe (Client*, const char*);
 int MQTTDisconnect (Client*);
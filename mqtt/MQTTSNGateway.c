@@ -0,0 +1,969 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              MQTTSNGateway.c
+//
+//
+//  MQTT-SN style gateway: topic id compression for SPIRIT1 / BLE nodes,
+//  QoS -1 publishes, sleeping node buffering, and batched (pipelined)
+//  upstream MQTT publishes.
+//  See MQTTSNGateway.h
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "MQTTSNGateway.h"
+
+#include <string.h>
+
+#if !defined(MQSNGW_NO_CLIENT)
+#include "MQTTClient.h"
+#endif
+
+            // MQTT-SN message types
+#define  MQSN_CONNECT            0x04
+#define  MQSN_CONNACK            0x05
+#define  MQSN_REGISTER           0x0A
+#define  MQSN_REGACK             0x0B
+#define  MQSN_PUBLISH            0x0C
+#define  MQSN_PUBACK             0x0D
+#define  MQSN_SUBSCRIBE          0x12
+#define  MQSN_SUBACK             0x13
+#define  MQSN_PINGREQ            0x16
+#define  MQSN_PINGRESP           0x17
+#define  MQSN_DISCONNECT         0x18
+
+            // Flags byte
+#define  MQSN_FLAG_DUP           0x80
+#define  MQSN_FLAG_QOS_MASK      0x60
+#define  MQSN_FLAG_QOS_1         0x20
+#define  MQSN_FLAG_QOS_M1        0x60    /* QoS -1 */
+#define  MQSN_FLAG_WILL          0x08
+#define  MQSN_FLAG_CLEAN         0x04
+#define  MQSN_FLAG_TOPIC_MASK    0x03
+
+            // return codes
+#define  MQSN_RC_ACCEPTED        0x00
+#define  MQSN_RC_CONGESTION      0x01
+#define  MQSN_RC_INVALID_TOPIC   0x02
+#define  MQSN_RC_NOT_SUPPORTED   0x03
+
+#define  MQSNGW_FIRST_TOPIC_ID 0x0100    /* REGISTER ids start here            */
+
+#if MQSNGW_MAX_NODES > 32
+#error "MQSNGW_MAX_NODES must be no more than 32"
+#endif
+
+
+     //----------------------------------------
+     //        Function Prototype refs
+     //           internal use only
+     //----------------------------------------
+static int       mqsngw_connect (MQTTSN_GATEWAY *gw, int link, uint8_t addr,
+                                 MQSNGW_NODE *node, const uint8_t *body, int len);
+static int       mqsngw_register (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node,
+                                  const uint8_t *body, int len);
+static int       mqsngw_publish (MQTTSN_GATEWAY *gw, int link, uint8_t addr,
+                                 MQSNGW_NODE *node, const uint8_t *body, int len);
+static int       mqsngw_subscribe (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node,
+                                   const uint8_t *body, int len);
+static int       mqsngw_up_publish (MQTTSN_GATEWAY *gw, const char *name,
+                                    int name_len, const uint8_t *data,
+                                    int datalen, int qos);
+static int       mqsngw_name_valid (const char *name, int name_len);
+static MQSNGW_TOPIC *mqsngw_topic_find (MQTTSN_GATEWAY *gw, uint16_t id,
+                                        const char *name, int name_len);
+static MQSNGW_TOPIC *mqsngw_topic_add (MQTTSN_GATEWAY *gw, uint16_t id,
+                                       const char *name, int name_len);
+static void      mqsngw_send (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node,
+                              const uint8_t *frame, int len);
+static void      mqsngw_send_ack (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node,
+                                  uint8_t type, uint16_t topic_id,
+                                  uint16_t msgid, uint8_t rc);
+static void      mqsngw_wake (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node);
+static void      mqsngw_node_free (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node);
+
+
+//*****************************************************************************
+//  MQTTSNGateway_Init
+//
+//          Setup the gateway. up_write is called with each batch of
+//          upstream PUBLISH packets (e.g. MQTTSNGateway_Client_Write, with
+//          up_parm = the connected Paho Client).
+//*****************************************************************************
+int  MQTTSNGateway_Init (MQTTSN_GATEWAY *gw, MQSNGW_UPSTREAM_WRITE up_write,
+                         void *up_parm)
+{
+    int   i;
+
+    if (gw == 0L || up_write == 0L)
+       return (ERR_MQSNGW_INVALID_PARM);
+
+    memset (gw, 0, sizeof(MQTTSN_GATEWAY));
+    gw->up_write      = up_write;
+    gw->up_parm       = up_parm;
+    gw->next_topic_id = MQSNGW_FIRST_TOPIC_ID;
+    gw->next_packetid = 1;
+    for (i = 0;  i < MQSNGW_MAX_SUBS;  i++)
+      gw->subs[i].node = -1;
+    for (i = 0;  i < MQSNGW_HELD_MSGS;  i++)
+      gw->held[i].node = -1;
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  MQTTSNGateway_Add_Link
+//
+//          Define a radio link. send() transmits one frame to a node
+//          (e.g. a wrapper around the SPIRIT1 AppliSendBuff(), or a BLE
+//          notification). mtu is the largest frame the link can carry.
+//*****************************************************************************
+int  MQTTSNGateway_Add_Link (MQTTSN_GATEWAY *gw, int link,
+                             MQSNGW_LINK_SEND send, void *parm, int mtu)
+{
+    if (gw == 0L || link < 0 || link >= MQSNGW_MAX_LINKS || send == 0L
+       || mtu < 8 || mtu > 255)
+       return (ERR_MQSNGW_INVALID_PARM);
+
+    gw->links[link].send = send;
+    gw->links[link].parm = parm;
+    gw->links[link].mtu  = (uint8_t) mtu;
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  MQTTSNGateway_Define_Topic
+//
+//          Define a pre-defined topic id. Nodes can publish to it (even
+//          with QoS -1, without connecting) and subscribe to it, without a
+//          REGISTER. Ids must be below MQSNGW_FIRST_TOPIC_ID (0x0100), which
+//          is where the ids handed out for REGISTER start.
+//*****************************************************************************
+int  MQTTSNGateway_Define_Topic (MQTTSN_GATEWAY *gw, uint16_t topic_id,
+                                 const char *name)
+{
+    MQSNGW_TOPIC  *tp;
+    int           len;
+
+    if (gw == 0L || name == 0L || topic_id == 0
+       || topic_id >= MQSNGW_FIRST_TOPIC_ID)
+       return (ERR_MQSNGW_INVALID_PARM);
+    len = strlen (name);
+    if (len == 0 || len >= MQSNGW_TOPIC_SIZE || strpbrk(name, "+#") != 0L
+       || mqsngw_topic_find(gw, topic_id, 0L, 0) != 0L)
+       return (ERR_MQSNGW_INVALID_PARM);
+
+    tp = mqsngw_topic_add (gw, topic_id, name, len);
+    if (tp == 0L)
+       return (ERR_MQSNGW_TABLE_FULL);
+
+    return (0);                         // denote success
+}
+
+
+//*****************************************************************************
+//  MQTTSNGateway_Input
+//
+//          Process one frame received from a node on a radio link.
+//          Returns 0, or ERR_MQSNGW_BAD_FRAME if the frame was ignored.
+//*****************************************************************************
+int  MQTTSNGateway_Input (MQTTSN_GATEWAY *gw, int link, uint8_t addr,
+                          const uint8_t *frame, int len)
+{
+    MQSNGW_NODE    *node;
+    const uint8_t  *body;
+    uint8_t        resp [4];
+    int            i, flen, hdr, type;
+
+    if (gw == 0L || frame == 0L || link < 0 || link >= MQSNGW_MAX_LINKS
+       || gw->links[link].send == 0L)
+       return (ERR_MQSNGW_INVALID_PARM);
+    gw->frames_in++;
+
+        // Length is 1 byte, or 0x01 + 2 bytes
+    if (len >= 2 && frame[0] == 0x01)
+       { if (len < 4)
+            goto bad_frame;
+         flen = (frame[1] << 8) | frame[2];
+         hdr  = 3;
+       }
+       else { flen = (len >= 2) ? frame[0] : 0;
+              hdr  = 1;
+            }
+    if (flen < hdr + 1 || flen > len)
+       goto bad_frame;
+    type = frame [hdr];
+    body = &frame [hdr + 1];
+    flen = flen - hdr - 1;              // now the length of body
+
+    node = 0L;
+    for (i = 0;  i < MQSNGW_MAX_NODES;  i++)
+      if (gw->nodes[i].state != MQSNGW_NODE_FREE && gw->nodes[i].link == link
+         && gw->nodes[i].addr == addr)
+         { node = &gw->nodes[i];
+           break;
+         }
+
+    if (type == MQSN_CONNECT)
+       return (mqsngw_connect (gw, link, addr, node, body, flen));
+    if (type == MQSN_PUBLISH)           // QoS -1 needs no connection
+       return (mqsngw_publish (gw, link, addr, node, body, flen));
+    if (node == 0L)
+       goto bad_frame;                  // not connected
+    node->last_rx_ms = gw->now_ms;
+
+    switch (type)
+      {
+        case MQSN_REGISTER:
+                return (mqsngw_register (gw, node, body, flen));
+
+        case MQSN_SUBSCRIBE:
+                return (mqsngw_subscribe (gw, node, body, flen));
+
+        case MQSN_PINGREQ:
+                if (node->state == MQSNGW_NODE_ASLEEP)
+                   mqsngw_wake (gw, node);  // awake: send what was held first
+                resp[0] = 2;
+                resp[1] = MQSN_PINGRESP;
+                mqsngw_send (gw, node, resp, 2);
+                return (0);
+
+        case MQSN_DISCONNECT:
+                resp[0] = 2;
+                resp[1] = MQSN_DISCONNECT;
+                mqsngw_send (gw, node, resp, 2);
+                if (flen >= 2 && ((body[0] << 8) | body[1]) != 0)
+                   { node->state         = MQSNGW_NODE_ASLEEP;   // going to sleep
+                     node->duration_secs = (body[0] << 8) | body[1];
+                   }
+                   else mqsngw_node_free (gw, node);
+                return (0);
+
+        case MQSN_PUBACK:               // downstream is QoS0: nothing to do
+                return (0);
+
+        default:
+                break;
+      }
+
+bad_frame:
+    gw->bad_frames++;
+    return (ERR_MQSNGW_BAD_FRAME);
+}
+
+
+//*****************************************************************************
+//  MQTTSNGateway_Yield
+//
+//          Service the gateway: write the upstream batch once it is
+//          MQSNGW_BATCH_MS old, and drop nodes whose keep alive or sleep
+//          duration has run out (1.5 x the node's value).
+//*****************************************************************************
+int  MQTTSNGateway_Yield (MQTTSN_GATEWAY *gw, uint32_t now_ms)
+{
+    MQSNGW_NODE  *node;
+    int          i, rc;
+
+    if (gw == 0L)
+       return (ERR_MQSNGW_INVALID_PARM);
+    gw->now_ms = now_ms;
+
+    rc = 0;
+    if (gw->batch_len > 0 && (now_ms - gw->batch_start_ms) >= MQSNGW_BATCH_MS)
+       rc = MQTTSNGateway_Flush (gw);
+
+    for (i = 0;  i < MQSNGW_MAX_NODES;  i++)
+      { node = &gw->nodes[i];
+        if (node->state != MQSNGW_NODE_FREE && node->duration_secs != 0
+           && (now_ms - node->last_rx_ms) > (uint32_t) node->duration_secs * 1500)
+           { gw->nodes_lost++;
+             mqsngw_node_free (gw, node);
+           }
+      }
+    return (rc);
+}
+
+
+//*****************************************************************************
+//  MQTTSNGateway_Flush
+//
+//          Write the upstream batch now.
+//*****************************************************************************
+int  MQTTSNGateway_Flush (MQTTSN_GATEWAY *gw)
+{
+    int   rc;
+
+    if (gw == 0L)
+       return (ERR_MQSNGW_INVALID_PARM);
+    if (gw->batch_len == 0)
+       return (0);
+
+    rc = gw->up_write (gw->up_parm, gw->batch, gw->batch_len);
+    if (rc == gw->batch_len)
+       { gw->batches_up++;
+         rc = 0;
+       }
+       else { gw->drops += gw->batch_msgs;     // session is gone, or timed out
+              rc = ERR_MQSNGW_UPSTREAM;
+            }
+    gw->batch_len  = 0;
+    gw->batch_msgs = 0;
+    return (rc);
+}
+
+
+//*****************************************************************************
+//  MQTTSNGateway_Deliver
+//
+//          Send an upstream / local message to the nodes subscribed to its
+//          topic. Same signature as a MQBROKER_BRIDGE_HANDLER, so it can be
+//          hooked straight to MQTTBroker_Bridge_Topic(); from a Paho
+//          messageHandler pass md->topicName and md->message's payload.
+//          Downstream frames are always QoS0.
+//*****************************************************************************
+void  MQTTSNGateway_Deliver (void *parm, MQTTString *topic,
+                             unsigned char *payload, int payloadlen, int qos)
+{
+    MQTTSN_GATEWAY *gw = (MQTTSN_GATEWAY*) parm;
+    MQSNGW_TOPIC   *tp;
+    MQSNGW_SUB     *sub;
+    MQSNGW_NODE    *node;
+    MQSNGW_HELD    *slot;
+    const char     *name;
+    uint8_t        frame [MQSNGW_FRAME_SIZE > 255 ? 255 : MQSNGW_FRAME_SIZE];
+    uint32_t       done_mask;
+    uint16_t       short_id;
+    int            name_len, flen, i, j;
+
+    (void) qos;
+    if (gw == 0L || topic == 0L || payloadlen < 0
+       || (payload == 0L && payloadlen > 0))
+       return;
+    if (topic->cstring != 0L)
+       { name     = topic->cstring;
+         name_len = strlen (name);
+       }
+       else { name     = topic->lenstring.data;
+              name_len = topic->lenstring.len;
+            }
+    if (name == 0L || name_len == 0)
+       return;
+
+    tp       = mqsngw_topic_find (gw, 0, name, name_len);
+    short_id = (name_len == 2) ? (uint16_t) ((name[0] << 8) | (uint8_t) name[1]) : 0;
+    flen     = 7 + payloadlen;
+
+    done_mask = 0;                      // one copy per node
+    for (i = 0;  i < MQSNGW_MAX_SUBS;  i++)
+      { sub = &gw->subs[i];
+        if (sub->node < 0 || (done_mask & (1UL << sub->node)))
+           continue;
+        if (sub->topic_type == MQSN_TOPIC_SHORT)
+           { if (short_id == 0 || sub->topic_id != short_id)
+                continue;
+           }
+           else if (tp == 0L || sub->topic_id != tp->id)
+                   continue;
+        done_mask |= (1UL << sub->node);
+        node = &gw->nodes [sub->node];
+
+        if (flen > (int) sizeof(frame) || flen > gw->links[node->link].mtu)
+           { gw->drops++;               // does not fit the radio frame
+             continue;
+           }
+        frame[0] = (uint8_t) flen;
+        frame[1] = MQSN_PUBLISH;
+        frame[2] = sub->topic_type;     // QoS0
+        frame[3] = (uint8_t) (sub->topic_id >> 8);
+        frame[4] = (uint8_t) sub->topic_id;
+        frame[5] = 0;                   // msgid: 0 for QoS0
+        frame[6] = 0;
+        memcpy (&frame[7], payload, payloadlen);
+
+        if (node->state == MQSNGW_NODE_ACTIVE)
+           { mqsngw_send (gw, node, frame, flen);
+             gw->msgs_down++;
+             continue;
+           }
+
+            // asleep: hold it until the node wakes up
+        slot = 0L;
+        for (j = 0;  j < MQSNGW_HELD_MSGS;  j++)
+          if (gw->held[j].node < 0)
+             { slot = &gw->held[j];
+               break;
+             }
+        if (slot == 0L)
+           { gw->drops++;
+             continue;
+           }
+        slot->node = sub->node;
+        slot->len  = (uint8_t) flen;
+        slot->seq  = gw->held_seq++;
+        memcpy (slot->frame, frame, flen);
+        gw->msgs_held++;
+      }
+}
+
+
+//*****************************************************************************
+//  MQTTSN_Serialize_publish
+//
+//          Node side: build a PUBLISH frame. qos is -1, 0 or 1. topic_type
+//          is MQSN_TOPIC_xxx. Returns the frame length, or < 0 if buf is
+//          too small.
+//*****************************************************************************
+int  MQTTSN_Serialize_publish (uint8_t *buf, int buflen, int qos,
+                               int topic_type, uint16_t topic_id,
+                               uint16_t msgid, const uint8_t *data, int datalen)
+{
+    int   flen;
+
+    flen = 7 + datalen;
+    if (buf == 0L || datalen < 0 || flen > 255 || flen > buflen
+       || qos < -1 || qos > 1)
+       return (ERR_MQSNGW_INVALID_PARM);
+
+    buf[0] = (uint8_t) flen;
+    buf[1] = MQSN_PUBLISH;
+    buf[2] = (uint8_t) (((qos < 0) ? MQSN_FLAG_QOS_M1 : (qos << 5))
+                        | (topic_type & MQSN_FLAG_TOPIC_MASK));
+    buf[3] = (uint8_t) (topic_id >> 8);
+    buf[4] = (uint8_t) topic_id;
+    buf[5] = (uint8_t) (msgid >> 8);
+    buf[6] = (uint8_t) msgid;
+    if (datalen > 0)
+       memcpy (&buf[7], data, datalen);
+    return (flen);
+}
+
+
+//*****************************************************************************
+//  mqsngw_connect
+//
+//          CONNECT:  Flags, ProtocolId, Duration(2), ClientId.
+//          A node that was asleep gets its held messages after the CONNACK.
+//*****************************************************************************
+static int  mqsngw_connect (MQTTSN_GATEWAY *gw, int link, uint8_t addr,
+                            MQSNGW_NODE *node, const uint8_t *body, int len)
+{
+    MQSNGW_NODE  tmp;
+    uint8_t      resp [3];
+    int          i, was_asleep;
+
+    if (len < 4)
+       { gw->bad_frames++;
+         return (ERR_MQSNGW_BAD_FRAME);
+       }
+    resp[0] = 3;
+    resp[1] = MQSN_CONNACK;
+    resp[2] = MQSN_RC_ACCEPTED;
+
+    if (node == 0L)
+       { for (i = 0;  i < MQSNGW_MAX_NODES;  i++)
+           if (gw->nodes[i].state == MQSNGW_NODE_FREE)
+              { node = &gw->nodes[i];
+                break;
+              }
+       }
+    if (node == 0L || (body[0] & MQSN_FLAG_WILL))
+       {    // reply without taking a node entry
+         memset (&tmp, 0, sizeof(tmp));
+         tmp.link = (uint8_t) link;
+         tmp.addr = addr;
+         resp[2]  = (node == 0L) ? MQSN_RC_CONGESTION : MQSN_RC_NOT_SUPPORTED;
+         mqsngw_send (gw, &tmp, resp, 3);
+         return (0);
+       }
+
+    was_asleep = (node->state == MQSNGW_NODE_ASLEEP);
+    if (body[0] & MQSN_FLAG_CLEAN)
+       { for (i = 0;  i < MQSNGW_MAX_SUBS;  i++)
+           if (gw->subs[i].node == (node - gw->nodes))
+              gw->subs[i].node = -1;
+       }
+    node->state         = MQSNGW_NODE_ACTIVE;
+    node->link          = (uint8_t) link;
+    node->addr          = addr;
+    node->duration_secs = (body[2] << 8) | body[3];
+    node->last_rx_ms    = gw->now_ms;
+    node->last_msgid    = 0;
+
+    mqsngw_send (gw, node, resp, 3);
+    if (was_asleep)
+       mqsngw_wake (gw, node);
+    return (0);
+}
+
+
+//*****************************************************************************
+//  mqsngw_register
+//
+//          REGISTER:  TopicId(2) (0 from a node), MsgId(2), TopicName.
+//          The same name always gets the same id.
+//*****************************************************************************
+static int  mqsngw_register (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node,
+                             const uint8_t *body, int len)
+{
+    MQSNGW_TOPIC  *tp;
+    uint16_t      msgid;
+    int           name_len;
+
+    if (len < 5)
+       { gw->bad_frames++;
+         return (ERR_MQSNGW_BAD_FRAME);
+       }
+    msgid    = (body[2] << 8) | body[3];
+    name_len = len - 4;
+
+    if ( ! mqsngw_name_valid ((const char*) &body[4], name_len))
+       { mqsngw_send_ack (gw, node, MQSN_REGACK, 0, msgid, MQSN_RC_NOT_SUPPORTED);
+         return (0);
+       }
+    tp = mqsngw_topic_find (gw, 0, (const char*) &body[4], name_len);
+    if (tp == 0L)
+       tp = mqsngw_topic_add (gw, 0, (const char*) &body[4], name_len);
+    if (tp == 0L)
+       mqsngw_send_ack (gw, node, MQSN_REGACK, 0, msgid, MQSN_RC_CONGESTION);
+       else mqsngw_send_ack (gw, node, MQSN_REGACK, tp->id, msgid,
+                             MQSN_RC_ACCEPTED);
+    return (0);
+}
+
+
+//*****************************************************************************
+//  mqsngw_publish
+//
+//          PUBLISH:  Flags, TopicId(2), MsgId(2), Data.
+//          Serialized into the upstream batch as a full MQTT PUBLISH.
+//          QoS -1 is accepted from any node, connected or not.
+//*****************************************************************************
+static int  mqsngw_publish (MQTTSN_GATEWAY *gw, int link, uint8_t addr,
+                            MQSNGW_NODE *node, const uint8_t *body, int len)
+{
+    MQSNGW_TOPIC  *tp;
+    const char    *name;
+    char          short_name [2];
+    uint16_t      topic_id, msgid;
+    int           qos, topic_type, name_len, rc;
+
+    (void) link;  (void) addr;
+    if (len < 5)
+       { gw->bad_frames++;
+         return (ERR_MQSNGW_BAD_FRAME);
+       }
+    topic_type = body[0] & MQSN_FLAG_TOPIC_MASK;
+    topic_id   = (body[1] << 8) | body[2];
+    msgid      = (body[3] << 8) | body[4];
+    switch (body[0] & MQSN_FLAG_QOS_MASK)
+      { case MQSN_FLAG_QOS_M1:  qos = -1;  break;
+        case 0:                 qos = 0;   break;
+        case MQSN_FLAG_QOS_1:   qos = 1;   break;
+        default:                qos = 2;   break;    // not supported
+      }
+
+    if (node == 0L && qos != -1)
+       { gw->bad_frames++;              // QoS 0/1 need a connection
+         return (ERR_MQSNGW_BAD_FRAME);
+       }
+    if (node != 0L)
+       node->last_rx_ms = gw->now_ms;
+    if (qos == 2)
+       { mqsngw_send_ack (gw, node, MQSN_PUBACK, topic_id, msgid,
+                          MQSN_RC_NOT_SUPPORTED);
+         return (0);
+       }
+
+        // resolve the topic id back to its full name
+    name = 0L;
+    name_len = 0;
+    if (topic_type == MQSN_TOPIC_SHORT)
+       { short_name[0] = (char) body[1];
+         short_name[1] = (char) body[2];
+         if (mqsngw_name_valid (short_name, 2))
+            { name     = short_name;
+              name_len = 2;
+            }
+       }
+       else if (topic_type != 3)
+       { tp = mqsngw_topic_find (gw, topic_id, 0L, 0);
+         if (tp != 0L && (topic_type == MQSN_TOPIC_PREDEFINED || qos >= 0))
+            { name     = tp->name;
+              name_len = strlen (tp->name);
+            }
+       }
+    if (name == 0L)
+       { if (qos == 1)
+            mqsngw_send_ack (gw, node, MQSN_PUBACK, topic_id, msgid,
+                             MQSN_RC_INVALID_TOPIC);
+         gw->bad_frames++;
+         return (ERR_MQSNGW_BAD_FRAME);
+       }
+
+    if (qos == 1 && (body[0] & MQSN_FLAG_DUP) && msgid == node->last_msgid)
+       {    // re-send of one already in the batch: just ack it again
+         mqsngw_send_ack (gw, node, MQSN_PUBACK, topic_id, msgid, MQSN_RC_ACCEPTED);
+         return (0);
+       }
+
+    rc = mqsngw_up_publish (gw, name, name_len, &body[5], len - 5,
+                            (qos == 1) ? 1 : 0);
+    if (qos == 1)
+       { node->last_msgid = msgid;
+         mqsngw_send_ack (gw, node, MQSN_PUBACK, topic_id, msgid,
+                          (rc == 0) ? MQSN_RC_ACCEPTED : MQSN_RC_CONGESTION);
+       }
+    return (rc);
+}
+
+
+//*****************************************************************************
+//  mqsngw_subscribe
+//
+//          SUBSCRIBE:  Flags, MsgId(2), TopicName or TopicId(2).
+//          A topic name is registered if it is new, and its id returned in
+//          the SUBACK. Granted QoS is always 0.
+//*****************************************************************************
+static int  mqsngw_subscribe (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node,
+                              const uint8_t *body, int len)
+{
+    MQSNGW_TOPIC  *tp;
+    MQSNGW_SUB    *sub, *free_sub;
+    uint16_t      msgid, topic_id;
+    uint8_t       resp [8];
+    int           topic_type, i, nidx;
+
+    if (len < 5)
+       { gw->bad_frames++;
+         return (ERR_MQSNGW_BAD_FRAME);
+       }
+    topic_type = body[0] & MQSN_FLAG_TOPIC_MASK;
+    msgid      = (body[1] << 8) | body[2];
+    nidx       = node - gw->nodes;
+
+    resp[0] = 8;
+    resp[1] = MQSN_SUBACK;
+    resp[2] = 0;                        // granted QoS0
+    resp[3] = 0;
+    resp[4] = 0;
+    resp[5] = (uint8_t) (msgid >> 8);
+    resp[6] = (uint8_t) msgid;
+    resp[7] = MQSN_RC_ACCEPTED;
+
+    topic_id = 0;
+    if (topic_type == MQSN_TOPIC_NORMAL)
+       { if ( ! mqsngw_name_valid ((const char*) &body[3], len - 3))
+            resp[7] = MQSN_RC_NOT_SUPPORTED;       // no wildcards
+            else { tp = mqsngw_topic_find (gw, 0, (const char*) &body[3], len - 3);
+                   if (tp == 0L)
+                      tp = mqsngw_topic_add (gw, 0, (const char*) &body[3], len - 3);
+                   if (tp == 0L)
+                      resp[7] = MQSN_RC_CONGESTION;
+                      else topic_id = tp->id;
+                 }
+       }
+       else if (topic_type == MQSN_TOPIC_PREDEFINED)
+       { topic_id = (body[3] << 8) | body[4];
+         if (mqsngw_topic_find(gw, topic_id, 0L, 0) == 0L)
+            resp[7] = MQSN_RC_INVALID_TOPIC;
+       }
+       else if (topic_type == MQSN_TOPIC_SHORT)
+       { topic_id = (body[3] << 8) | body[4];
+         if ( ! mqsngw_name_valid ((const char*) &body[3], 2))
+            resp[7] = MQSN_RC_NOT_SUPPORTED;
+       }
+       else resp[7] = MQSN_RC_NOT_SUPPORTED;
+
+    if (resp[7] == MQSN_RC_ACCEPTED)
+       { free_sub = 0L;
+         for (i = 0;  i < MQSNGW_MAX_SUBS;  i++)
+           { sub = &gw->subs[i];
+             if (sub->node == nidx && sub->topic_id == topic_id
+                && (sub->topic_type == MQSN_TOPIC_SHORT) == (topic_type == MQSN_TOPIC_SHORT))
+                break;                  // already subscribed
+             if (sub->node < 0 && free_sub == 0L)
+                free_sub = sub;
+           }
+         if (i == MQSNGW_MAX_SUBS)
+            { if (free_sub == 0L)
+                 resp[7] = MQSN_RC_CONGESTION;
+                 else { free_sub->node       = (int8_t) nidx;
+                        free_sub->topic_type = (uint8_t) topic_type;
+                        free_sub->topic_id   = topic_id;
+                      }
+            }
+       }
+    if (resp[7] == MQSN_RC_ACCEPTED && topic_type != MQSN_TOPIC_SHORT)
+       { resp[3] = (uint8_t) (topic_id >> 8);
+         resp[4] = (uint8_t) topic_id;
+       }
+    mqsngw_send (gw, node, resp, 8);
+    return (0);
+}
+
+
+//*****************************************************************************
+//  mqsngw_up_publish
+//
+//          Append one full MQTT PUBLISH to the upstream batch, writing the
+//          batch out first if there is no room for it.
+//*****************************************************************************
+static int  mqsngw_up_publish (MQTTSN_GATEWAY *gw, const char *name,
+                               int name_len, const uint8_t *data,
+                               int datalen, int qos)
+{
+    MQTTString  topic = MQTTString_initializer;
+    uint16_t    packetid;
+    int         rc, tries;
+
+    topic.lenstring.data = (char*) name;
+    topic.lenstring.len  = name_len;
+    packetid = 0;
+    if (qos == 1)
+       { packetid = gw->next_packetid++;
+         if (gw->next_packetid == 0)
+            gw->next_packetid = 1;
+       }
+
+    for (tries = 0;  tries < 2;  tries++)
+      { rc = MQTTSerialize_publish (&gw->batch[gw->batch_len],
+                                    MQSNGW_BATCH_SIZE - gw->batch_len,
+                                    0, qos, 0, packetid, topic,
+                                    (unsigned char*) data, datalen);
+        if (rc > 0)
+           { if (gw->batch_len == 0)
+                gw->batch_start_ms = gw->now_ms;
+             gw->batch_len += rc;
+             gw->batch_msgs++;
+             gw->msgs_up++;
+             return (0);
+           }
+        if (gw->batch_len == 0)
+           break;                       // can never fit
+        MQTTSNGateway_Flush (gw);       // make room, then try again
+      }
+    gw->drops++;
+    return (ERR_MQSNGW_TABLE_FULL);
+}
+
+
+//*****************************************************************************
+//  mqsngw_name_valid
+//
+//          A topic name from a node must fit the table, and can not hold
+//          wildcards or a \0 (the upstream broker would drop the session).
+//*****************************************************************************
+static int  mqsngw_name_valid (const char *name, int name_len)
+{
+    int   i;
+
+    if (name_len <= 0 || name_len >= MQSNGW_TOPIC_SIZE)
+       return (0);
+    for (i = 0;  i < name_len;  i++)
+      if (name[i] == '+' || name[i] == '#' || name[i] == '\0')
+         return (0);
+    return (1);
+}
+
+
+//*****************************************************************************
+//  mqsngw_topic_find
+//
+//          Look a topic up by id (id != 0), or else by name.
+//*****************************************************************************
+static MQSNGW_TOPIC *mqsngw_topic_find (MQTTSN_GATEWAY *gw, uint16_t id,
+                                        const char *name, int name_len)
+{
+    MQSNGW_TOPIC  *tp;
+    int           i;
+
+    for (i = 0;  i < MQSNGW_MAX_TOPICS;  i++)
+      { tp = &gw->topics[i];
+        if (tp->id == 0)
+           continue;
+        if (id != 0)
+           { if (tp->id == id)
+                return (tp);
+           }
+           else if (strncmp(tp->name, name, name_len) == 0
+                   && tp->name[name_len] == '\0')
+                   return (tp);
+      }
+    return (0L);
+}
+
+
+//*****************************************************************************
+//  mqsngw_topic_add
+//
+//          Add a topic name: a pre-defined one (id != 0), or a registered
+//          one, which gets the next REGISTER id.
+//*****************************************************************************
+static MQSNGW_TOPIC *mqsngw_topic_add (MQTTSN_GATEWAY *gw, uint16_t id,
+                                       const char *name, int name_len)
+{
+    MQSNGW_TOPIC  *tp;
+    int           i;
+
+    if (name_len <= 0 || name_len >= MQSNGW_TOPIC_SIZE
+       || (id == 0 && gw->next_topic_id == 0xFFFF))
+       return (0L);
+    for (i = 0;  i < MQSNGW_MAX_TOPICS;  i++)
+      { tp = &gw->topics[i];
+        if (tp->id == 0)
+           { tp->predefined = (id != 0);
+             tp->id         = (id != 0) ? id : gw->next_topic_id++;
+             memcpy (tp->name, name, name_len);
+             tp->name [name_len] = '\0';
+             return (tp);
+           }
+      }
+    return (0L);
+}
+
+
+//*****************************************************************************
+//  mqsngw_send / mqsngw_send_ack
+//
+//          Send a frame to a node.   _ack builds the 7 byte PUBACK / REGACK:
+//          TopicId(2), MsgId(2), ReturnCode.
+//*****************************************************************************
+static void  mqsngw_send (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node,
+                          const uint8_t *frame, int len)
+{
+    MQSNGW_LINK  *lk;
+
+    lk = &gw->links [node->link];
+    if (len <= lk->mtu)
+       lk->send (lk->parm, node->addr, frame, len);
+}
+
+static void  mqsngw_send_ack (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node,
+                              uint8_t type, uint16_t topic_id,
+                              uint16_t msgid, uint8_t rc)
+{
+    uint8_t  resp [7];
+
+    resp[0] = 7;
+    resp[1] = type;
+    resp[2] = (uint8_t) (topic_id >> 8);
+    resp[3] = (uint8_t) topic_id;
+    resp[4] = (uint8_t) (msgid >> 8);
+    resp[5] = (uint8_t) msgid;
+    resp[6] = rc;
+    mqsngw_send (gw, node, resp, 7);
+}
+
+
+//*****************************************************************************
+//  mqsngw_wake
+//
+//          A sleeping node is listening: send it its held messages, oldest
+//          first.
+//*****************************************************************************
+static void  mqsngw_wake (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node)
+{
+    MQSNGW_HELD  *oldest;
+    int          i, nidx;
+
+    nidx = node - gw->nodes;
+    for ( ; ; )
+      { oldest = 0L;
+        for (i = 0;  i < MQSNGW_HELD_MSGS;  i++)
+          if (gw->held[i].node == nidx
+             && (oldest == 0L || (int16_t) (gw->held[i].seq - oldest->seq) < 0))
+             oldest = &gw->held[i];
+        if (oldest == 0L)
+           break;
+        mqsngw_send (gw, node, oldest->frame, oldest->len);
+        gw->msgs_down++;
+        oldest->node = -1;
+      }
+}
+
+
+//*****************************************************************************
+//  mqsngw_node_free
+//
+//          Forget a node: its subscriptions and held messages go too.
+//*****************************************************************************
+static void  mqsngw_node_free (MQTTSN_GATEWAY *gw, MQSNGW_NODE *node)
+{
+    int   i, nidx;
+
+    nidx = node - gw->nodes;
+    for (i = 0;  i < MQSNGW_MAX_SUBS;  i++)
+      if (gw->subs[i].node == nidx)
+         gw->subs[i].node = -1;
+    for (i = 0;  i < MQSNGW_HELD_MSGS;  i++)
+      if (gw->held[i].node == nidx)
+         { gw->held[i].node = -1;
+           gw->drops++;
+         }
+    node->state = MQSNGW_NODE_FREE;
+}
+
+
+#if !defined(MQSNGW_NO_CLIENT)
+//*****************************************************************************
+//  MQTTSNGateway_Client_Write
+//
+//          MQSNGW_UPSTREAM_WRITE for a connected Paho Client: writes the
+//          batch on the Client's socket, within its command timeout.
+//          The PUBACKs for QoS1 publishes come back through MQTTYield(),
+//          which ignores them.
+//*****************************************************************************
+int  MQTTSNGateway_Client_Write (void *client, const unsigned char *buf,
+                                 int len)
+{
+    Client  *c = (Client*) client;
+    Timer   timer;
+    int     rc, sent;
+
+    if (c == 0L || ! c->isconnected)
+       return (-1);
+
+    InitTimer (&timer);
+    countdown_ms (&timer, c->command_timeout_ms);
+    sent = 0;
+    while (sent < len && ! expired(&timer))
+      { rc = c->ipstack->mqttwrite (c->ipstack, (unsigned char*) &buf[sent],
+                                    len - sent, left_ms(&timer));
+        if (rc < 0)
+           break;
+        sent += rc;
+      }
+    if (sent != len)
+       return (-1);
+    countdown (&c->ping_timer, c->keepAliveInterval);   // counts as traffic
+    return (len);
+}
+#endif
+
+//*****************************************************************************
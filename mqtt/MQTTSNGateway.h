@@ -0,0 +1,236 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              MQTTSNGateway.h
+//
+//
+//  Definitions for the MQTT-SN style gateway, which bridges SPIRIT1 sub-GHz
+//  and BLE nodes to MQTT.
+//
+//  Full topic strings do not fit well in a 25 byte SPIRIT1 payload or a 20
+//  byte BLE write, so nodes speak a subset of MQTT-SN v1.2 instead: topics
+//  are 2 byte topic ids, either pre-defined at the gateway, registered by
+//  the node at run time (REGISTER), or 2 character short names.
+//
+//      MQTTSNGateway_Init (&gw, MQTTSNGateway_Client_Write, &mqtt_client);
+//      MQTTSNGateway_Add_Link (&gw, MQSNGW_LINK_SPIRIT1, spirit_send, 0L, 96);
+//      MQTTSNGateway_Define_Topic (&gw, 0x0010, "plant/boiler/temp");
+//      while (1)
+//        { if (radio frame came in)
+//             MQTTSNGateway_Input (&gw, MQSNGW_LINK_SPIRIT1, src_addr, frame, len);
+//          MQTTSNGateway_Yield (&gw, HAL_GetTick());
+//          MQTTYield (&mqtt_client, 10);
+//        }
+//
+//  Supported from nodes:  CONNECT / CONNACK, REGISTER / REGACK,
+//  PUBLISH QoS -1, 0, 1 / PUBACK, SUBSCRIBE / SUBACK, PINGREQ / PINGRESP,
+//  DISCONNECT (with a duration = going to sleep).
+//
+//    - QoS -1:  a node can PUBLISH to a pre-defined or short topic without
+//      ever connecting. Nothing is sent back.
+//    - Upstream:  each node PUBLISH is serialized as a full MQTT PUBLISH
+//      into a batch buffer. The batch is written upstream in one go when it
+//      is full, or MQSNGW_BATCH_MS after its first message, so a burst of
+//      node messages becomes one pipelined TCP write instead of one write
+//      (and one PUBACK wait) per message. QoS1 node publishes are acked to
+//      the node once they are in the batch.
+//    - Downstream:  MQTTSNGateway_Deliver() (same signature as a broker
+//      bridge handler) sends matching messages to the subscribed nodes.
+//      Messages for a sleeping node are held in a shared buffer, and sent
+//      when the node wakes up (PINGREQ) or re-connects.
+//
+//  Limits:  no wildcard subscriptions (exact topic names / ids only),
+//  downstream messages are sent at QoS0, no wills, no gateway discovery
+//  (SEARCHGW / ADVERTISE), frames up to 255 bytes. Nodes are identified by
+//  (link, radio address).
+//
+//  Single threaded: call the MQTTSNGateway_xxx() routines from the main
+//  loop, never from a radio ISR.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __MQTTSN_GATEWAY_H__
+#define __MQTTSN_GATEWAY_H__
+
+#include "user_api.h"               // pull in defs for User API calls
+#include "MQTTPacket.h"
+
+                        // sizing - override in project_config_parms.h
+#if !defined(MQSNGW_MAX_LINKS)
+#define  MQSNGW_MAX_LINKS           2    /* radio links (SPIRIT1, BLE)         */
+#endif
+#if !defined(MQSNGW_MAX_NODES)
+#define  MQSNGW_MAX_NODES          16    /* connected / sleeping nodes (<= 32) */
+#endif
+#if !defined(MQSNGW_MAX_TOPICS)
+#define  MQSNGW_MAX_TOPICS         32    /* pre-defined + registered topic ids */
+#endif
+#if !defined(MQSNGW_MAX_SUBS)
+#define  MQSNGW_MAX_SUBS           16    /* node subscriptions, all nodes      */
+#endif
+#if !defined(MQSNGW_HELD_MSGS)
+#define  MQSNGW_HELD_MSGS          16    /* messages held for sleeping nodes   */
+#endif
+#if !defined(MQSNGW_FRAME_SIZE)
+#define  MQSNGW_FRAME_SIZE         64    /* max downstream frame to a node     */
+#endif
+#if !defined(MQSNGW_BATCH_SIZE)
+#define  MQSNGW_BATCH_SIZE        512    /* upstream PUBLISH batch buffer      */
+#endif
+#if !defined(MQSNGW_BATCH_MS)
+#define  MQSNGW_BATCH_MS           20    /* max time a publish waits in batch  */
+#endif
+
+#define  MQSNGW_TOPIC_SIZE         48    /* max topic name + \0                */
+
+            // suggested link ids
+#define  MQSNGW_LINK_SPIRIT1        0
+#define  MQSNGW_LINK_BLE            1
+
+            // MQTT-SN topic id types  (low 2 bits of the Flags byte)
+#define  MQSN_TOPIC_NORMAL          0    /* id from REGISTER / SUBSCRIBE       */
+#define  MQSN_TOPIC_PREDEFINED      1    /* id set with MQTTSNGateway_Define_Topic */
+#define  MQSN_TOPIC_SHORT           2    /* 2 character topic name             */
+
+            // node states
+#define  MQSNGW_NODE_FREE           0
+#define  MQSNGW_NODE_ACTIVE         1
+#define  MQSNGW_NODE_ASLEEP         2
+
+
+                 // sends one frame to a node. returns 0, or < 0 if it failed.
+typedef int (*MQSNGW_LINK_SEND)(void *parm, uint8_t addr,
+                                const uint8_t *frame, int len);
+
+                 // writes a batch of serialized MQTT packets upstream.
+                 // returns # bytes written (all of them), or < 0 if it failed.
+typedef int (*MQSNGW_UPSTREAM_WRITE)(void *parm, const unsigned char *buf,
+                                     int len);
+
+
+typedef struct mqsngw_link_def           /* one radio link */
+   {
+       MQSNGW_LINK_SEND  send;           // 0L = not used
+       void       *parm;
+       uint8_t    mtu;                   // max frame the link can carry
+   } MQSNGW_LINK;
+
+
+typedef struct mqsngw_topic_def          /* one topic id */
+   {
+       uint16_t   id;                    // 0 = entry free
+       uint8_t    predefined;
+       char       name [MQSNGW_TOPIC_SIZE];
+   } MQSNGW_TOPIC;
+
+
+typedef struct mqsngw_node_def           /* one connected / sleeping node */
+   {
+       uint8_t    state;                 // MQSNGW_NODE_xxx
+       uint8_t    link;
+       uint8_t    addr;                  // radio address
+       uint16_t   duration_secs;         // keep alive, or sleep duration
+       uint32_t   last_rx_ms;
+       uint16_t   last_msgid;            // last QoS1 PUBLISH: DUP detection
+   } MQSNGW_NODE;
+
+
+typedef struct mqsngw_sub_def            /* one node subscription */
+   {
+       int8_t     node;                  // -1 = entry free
+       uint8_t    topic_type;            // MQSN_TOPIC_xxx
+       uint16_t   topic_id;              // short topic: the 2 characters
+   } MQSNGW_SUB;
+
+
+typedef struct mqsngw_held_def           /* downstream frame for a sleeping node */
+   {
+       int8_t     node;                  // -1 = entry free
+       uint8_t    len;
+       uint16_t   seq;                   // keeps them in arrival order
+       uint8_t    frame [MQSNGW_FRAME_SIZE];
+   } MQSNGW_HELD;
+
+
+typedef struct mqttsn_gateway_def        /* gateway control block */
+   {
+       MQSNGW_UPSTREAM_WRITE  up_write;
+       void             *up_parm;
+       uint32_t         now_ms;          // time of the latest Yield
+       uint16_t         next_topic_id;   // for REGISTER
+       uint16_t         next_packetid;   // upstream QoS1
+       uint16_t         held_seq;
+       uint16_t         batch_len;       // bytes in batch
+       uint16_t         batch_msgs;      // PUBLISHes in batch
+       uint32_t         batch_start_ms;  // when the first one went in
+       MQSNGW_LINK      links [MQSNGW_MAX_LINKS];
+       MQSNGW_NODE      nodes [MQSNGW_MAX_NODES];
+       MQSNGW_TOPIC     topics [MQSNGW_MAX_TOPICS];
+       MQSNGW_SUB       subs [MQSNGW_MAX_SUBS];
+       MQSNGW_HELD      held [MQSNGW_HELD_MSGS];
+       unsigned char    batch [MQSNGW_BATCH_SIZE];
+                                         //---- statistics ----
+       uint32_t         frames_in;       // frames from nodes
+       uint32_t         bad_frames;      // malformed / unexpected frames
+       uint32_t         msgs_up;         // PUBLISHes put in a batch
+       uint32_t         batches_up;      // upstream writes
+       uint32_t         msgs_down;       // frames sent to subscribed nodes
+       uint32_t         msgs_held;       // ... of which held while asleep
+       uint32_t         drops;           // messages lost: no room, write failed
+       uint32_t         nodes_lost;      // keep alive / sleep timeouts
+   } MQTTSN_GATEWAY;
+
+
+     //----------------------------------------
+     //        Function Prototypes
+     //----------------------------------------
+int   MQTTSNGateway_Init (MQTTSN_GATEWAY *gw, MQSNGW_UPSTREAM_WRITE up_write,
+                          void *up_parm);
+int   MQTTSNGateway_Add_Link (MQTTSN_GATEWAY *gw, int link,
+                              MQSNGW_LINK_SEND send, void *parm, int mtu);
+int   MQTTSNGateway_Define_Topic (MQTTSN_GATEWAY *gw, uint16_t topic_id,
+                                  const char *name);
+int   MQTTSNGateway_Input (MQTTSN_GATEWAY *gw, int link, uint8_t addr,
+                           const uint8_t *frame, int len);
+int   MQTTSNGateway_Yield (MQTTSN_GATEWAY *gw, uint32_t now_ms);
+int   MQTTSNGateway_Flush (MQTTSN_GATEWAY *gw);
+void  MQTTSNGateway_Deliver (void *gw, MQTTString *topic,
+                             unsigned char *payload, int payloadlen, int qos);
+
+            // node side: build a PUBLISH frame. qos is -1, 0 or 1.
+int   MQTTSN_Serialize_publish (uint8_t *buf, int buflen, int qos,
+                                int topic_type, uint16_t topic_id,
+                                uint16_t msgid, const uint8_t *data, int datalen);
+
+#if !defined(MQSNGW_NO_CLIENT)
+            // MQSNGW_UPSTREAM_WRITE for a connected Paho Client (parm = Client *)
+int   MQTTSNGateway_Client_Write (void *client, const unsigned char *buf,
+                                  int len);
+#endif
+
+#endif                          //  __MQTTSN_GATEWAY_H__
+
+//*****************************************************************************
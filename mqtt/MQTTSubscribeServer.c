@@ -12,6 +12,7 @@
  *
  * Contributors:
  *    Ian Craggs - initial API and implementation and/or initial documentation
+ *    10/19/26 - honor maxcount, and do not return 1 for a truncated packet.
  *******************************************************************************/
 
 #include "MQTTPacket.h"
@@ -49,12 +50,15 @@ int MQTTDeserialize_subscribe(unsigned char* dup, unsigned short* packetid, int
 
 	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
 	enddata = curdata + mylen;
+	rc = -1;   /* a truncated packet must not return the length byte count */
 
 	*packetid = readInt(&curdata);
 
 	*count = 0;
 	while (curdata < enddata)
 	{
+		if (*count >= maxcount)   /* more filters than the caller has room for */
+			goto exit;
 		if (!readMQTTLenString(&topicFilters[*count], &curdata, enddata))
 			goto exit;
 		if (curdata >= enddata) /* do we have enough data to read the req_qos version byte? */
@@ -12,6 +12,7 @@
  *
  * Contributors:
  *    Ian Craggs - initial API and implementation and/or initial documentation
+ *    10/19/26 - honor maxcount, and do not return 1 for a truncated packet.
  *******************************************************************************/
 
 #include "MQTTPacket.h"
@@ -48,12 +49,15 @@ int MQTTDeserialize_unsubscribe(unsigned char* dup, unsigned short* packetid, in
 
 	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
 	enddata = curdata + mylen;
+	rc = 0;   /* a truncated packet must not return the length byte count */
 
 	*packetid = readInt(&curdata);
 
 	*count = 0;
 	while (curdata < enddata)
 	{
+		if (*count >= maxcount)   /* more filters than the caller has room for */
+			goto exit;
 		if (!readMQTTLenString(&topicFilters[*count], &curdata, enddata))
 			goto exit;
 		(*count)++;
@@ -22,6 +22,9 @@
  *           Since there are already about 3 different flavors of the MQTT TCP
  *           start up  APIs floating around, I do NOT feel too guilt ridden
  *           about defining this new (IMHO) better set.
+ *    10/19/26 - With USES_W5200_EVLOOP, w5200_read()/w5200_write() burst the
+ *           data straight between the W5200 socket buffers and the MQTT
+ *           buffers (common/w5200_evloop.c), and honor their timeouts.
  *******************************************************************************/
 
 #include "user_api.h"
@@ -32,6 +35,12 @@
 #include "mnet_call_api.h"              // pull in defs for common COMM TCP API
 #define  NETWORK_TYPE         NET_TYPE_WIRED_TCP
 
+#if defined(USES_W5200_EVLOOP)
+#include "w5200_evloop.h"               // multi-socket W5200 event loop
+
+    W5200_EV         _g_w5200_ev;       // shared with any other W5200 sockets
+#endif
+
 unsigned long    MilliTimer;
 //extern uint32_t  uwTick;
 
@@ -138,6 +147,11 @@ int  Network_Init (Network *netcb, int net_addr_type,
        {
           return (netcb->net_id);    // error - could not connect to WiFi AP
        }
+#if defined(USES_W5200_EVLOOP)
+        // use the socket buffer sizes the mnet driver programmed into chip
+    if (w5200ev_init(&_g_w5200_ev, w5200ev_spi_frame, 0L, 0L) < 0)
+       return (-1);
+#endif
     return (netcb->net_id);          // is positive - so everything went OK
 }
 
@@ -163,6 +177,9 @@ int32_t  Connect_Server (Network *netcb, char *srvr_name, int port)
     if (netcb->my_socket < 0)
        return (netcb->my_socket);   // we had error on Connect
 
+#if defined(USES_W5200_EVLOOP)
+    w5200ev_attach (&_g_w5200_ev, netcb->my_socket, 0L, 0L);
+#endif
     return (0);                     // connect to server succeeded
 
 #if TIVA_CC3100_LOGIC
@@ -308,6 +325,77 @@ int  TLS_Connect_Server (Network *netcb, char *srvr_name, int port,
 }
 
 
+#if defined(USES_W5200_EVLOOP)
+//*****************************************************************************
+//  w5200_read
+//
+//          Read len bytes directly into the caller's (MQTT readbuf) buffer,
+//          waiting no longer than timeout_ms.
+//
+//          Returns # bytes read (less than len if the timeout expired), or
+//          -1 if the connection was lost.
+//*****************************************************************************
+int  w5200_read (Network* netcb, unsigned char *buffer, int len, int timeout_ms)
+{
+    Timer        timer;
+    int          rc;
+    int          state;
+    int          recvLen = 0;
+
+    InitTimer (&timer);
+    countdown_ms (&timer, timeout_ms);
+    while (recvLen < len)
+      {
+        rc = w5200ev_recv (&_g_w5200_ev, netcb->my_socket,
+                           buffer + recvLen, len - recvLen);
+        if (rc < 0)
+           return (-1);
+        recvLen += rc;
+        if (rc == 0)
+           { state = w5200ev_status (&_g_w5200_ev, netcb->my_socket);
+             if (state != W5200_SOCK_ESTABLISHED)
+                return (-1);            // peer closed, and all data consumed
+             if (expired(&timer))
+                break;
+           }
+      }
+
+    return (recvLen);
+}
+
+
+//*****************************************************************************
+//  w5200_write
+//
+//          Send len bytes directly from the caller's buffer, waiting no
+//          longer than timeout_ms for TX buffer room.
+//
+//          Returns # bytes sent, or -1 if the connection was lost.
+//*****************************************************************************
+int  w5200_write (Network *netcb, unsigned char *buffer, int len, int timeout_ms)
+{
+    Timer        timer;
+    int          rc;
+    int          sentLen = 0;
+
+    InitTimer (&timer);
+    countdown_ms (&timer, timeout_ms);
+    while (sentLen < len)
+      {
+        rc = w5200ev_send (&_g_w5200_ev, netcb->my_socket,
+                           buffer + sentLen, len - sentLen);
+        if (rc < 0)
+           return (-1);
+        sentLen += rc;
+        if (rc == 0  &&  expired(&timer))
+           break;
+      }
+
+    return (sentLen);
+}
+
+#else
+
 int  w5200_read (Network* netcb, unsigned char *buffer, int len, int timeout_ms)
 {
     struct timeval timeVal;
@@ -338,6 +426,8 @@ int  w5200_write (Network *netcb, unsigned char *buffer, int len, int timeout_ms
     return (rc);
 }
 
+#endif                                  // USES_W5200_EVLOOP
+
 
 void w5200_disconnect (Network *netcb)
 {
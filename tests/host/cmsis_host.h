@@ -0,0 +1,171 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/host/cmsis_host.h
+//
+//
+//  C versions of the CMSIS core intrinsics and registers used by the
+//  portable modules, so their Cortex-M code paths (SIMD, PRIMASK critical
+//  sections, DWT cycle counter, PendSV) can be built and checked on the
+//  host.
+//
+//  Only active when the test is built with HOST_CORTEX_M=n (n = 3, 4, 7),
+//  which also sets __CORTEX_M the way the CMSIS core header would.
+//  Otherwise the modules take their generic (non MCU) code paths.
+//
+//  The SIMD versions follow the ARMv7E-M definitions, including the GE
+//  flags that __USUB16 sets and __SEL uses.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __CMSIS_HOST_H__
+#define __CMSIS_HOST_H__
+
+#include <stdint.h>
+
+            // simulated core state (host_board.c). Always declared, so one
+            // host_support library serves tests built either way.
+extern uint32_t  host_primask;           // 1 = interrupts masked
+extern uint32_t  host_apsr_ge;           // APSR.GE[1:0], one bit per half word
+extern uint32_t  SystemCoreClock;
+
+typedef struct
+   {
+       volatile uint32_t  CTRL;
+       volatile uint32_t  CYCCNT;
+       volatile uint32_t  LAR;
+   } HOST_DWT_Type;
+
+typedef struct
+   {
+       volatile uint32_t  DEMCR;
+   } HOST_CoreDebug_Type;
+
+typedef struct
+   {
+       volatile uint32_t  ICSR;          // PENDSVSET: the test runs "PendSV"
+   } HOST_SCB_Type;
+
+extern HOST_DWT_Type        host_dwt;
+extern HOST_CoreDebug_Type  host_core_debug;
+extern HOST_SCB_Type        host_scb;
+
+void  host_wfi (void);                   // sleep till the next SysTick (1 ms)
+
+
+#if defined(HOST_CORTEX_M)
+
+#define  __CORTEX_M            (HOST_CORTEX_M)
+
+#define  DWT                           (&host_dwt)
+#define  CoreDebug                     (&host_core_debug)
+#define  SCB                           (&host_scb)
+#define  SCB_ICSR_PENDSVSET_Msk        (1UL << 28)
+#define  DWT_CTRL_CYCCNTENA_Msk        (1UL << 0)
+#define  CoreDebug_DEMCR_TRCENA_Msk    (1UL << 24)
+
+
+     //----------------------------------------
+     //        Core / interrupt mask
+     //----------------------------------------
+static inline uint32_t  __get_PRIMASK (void)         { return (host_primask); }
+static inline void      __set_PRIMASK (uint32_t pm)  { host_primask = pm; }
+static inline void      __disable_irq (void)         { host_primask = 1; }
+static inline void      __enable_irq (void)          { host_primask = 0; }
+static inline void      __DMB (void)                 { __sync_synchronize(); }
+static inline void      __DSB (void)                 { __sync_synchronize(); }
+static inline void      __ISB (void)                 { __sync_synchronize(); }
+static inline void      __WFI (void)                 { host_wfi(); }
+static inline uint32_t  __CLZ (uint32_t v)           { return (v ? (uint32_t) __builtin_clz (v) : 32); }
+
+static inline uint32_t  __RBIT (uint32_t v)
+{
+    uint32_t  r;
+    int       i;
+
+    for (r = 0, i = 0;  i < 32;  i++, v >>= 1)
+      r = (r << 1) | (v & 1);
+    return (r);
+}
+
+
+     //----------------------------------------
+     //     ARMv7E-M packed 16-bit SIMD
+     //----------------------------------------
+static inline uint32_t  __PKHBT (uint32_t a, uint32_t b, int shift)
+{
+    return ((a & 0x0000FFFFUL) | ((b << shift) & 0xFFFF0000UL));
+}
+
+static inline uint32_t  __PKHTB (uint32_t a, uint32_t b, int shift)
+{
+    return ((a & 0xFFFF0000UL) | ((b >> shift) & 0x0000FFFFUL));
+}
+
+static inline uint32_t  __UADD16 (uint32_t a, uint32_t b)
+{
+    return (((a + b) & 0x0000FFFFUL) | (((a >> 16) + (b >> 16)) << 16));
+}
+
+static inline uint32_t  __USUB16 (uint32_t a, uint32_t b)
+{
+    uint32_t  lo = (a & 0xFFFF) - (b & 0xFFFF);
+    uint32_t  hi = (a >> 16)    - (b >> 16);
+
+    host_apsr_ge = ((a & 0xFFFF) >= (b & 0xFFFF) ? 1 : 0)   // no borrow
+                 | ((a >> 16)    >= (b >> 16)    ? 2 : 0);
+    return ((lo & 0x0000FFFFUL) | (hi << 16));
+}
+
+static inline uint32_t  __SEL (uint32_t a, uint32_t b)
+{
+    return (((host_apsr_ge & 1) ? a : b) & 0x0000FFFFUL)
+         | (((host_apsr_ge & 2) ? a : b) & 0xFFFF0000UL);
+}
+
+static inline uint32_t  __SMLAD (uint32_t a, uint32_t b, uint32_t acc)
+{
+    return ((uint32_t) ((int32_t) (int16_t) a * (int16_t) b
+                      + (int32_t) (int16_t) (a >> 16) * (int16_t) (b >> 16)
+                      + (int32_t) acc));
+}
+
+static inline uint32_t  __SMLABB (uint32_t a, uint32_t b, uint32_t acc)
+{
+    return ((uint32_t) ((int32_t) (int16_t) a * (int16_t) b + (int32_t) acc));
+}
+
+static inline uint32_t  __SMLATT (uint32_t a, uint32_t b, uint32_t acc)
+{
+    return ((uint32_t) ((int32_t) (int16_t) (a >> 16) * (int16_t) (b >> 16)
+                      + (int32_t) acc));
+}
+
+#endif                          //  HOST_CORTEX_M
+
+#endif                          //  __CMSIS_HOST_H__
+
+//*****************************************************************************
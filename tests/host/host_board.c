@@ -0,0 +1,85 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/host/host_board.c
+//
+//
+//  Host stand-ins for the board calls declared in tests/host/user_api.h,
+//  and the simulated core state used by cmsis_host.h.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "user_api.h"
+
+
+uint32_t  host_ms = 0;                   // simulated SysTick ms count
+uint32_t  host_reset_cause = RESET_CAUSE_POWER_ON;
+uint32_t  host_backup [HOST_BKP_NUM_REGS];  // simulated RTC backup registers
+
+                                         // core state, see cmsis_host.h
+uint32_t             host_primask    = 0;
+uint32_t             host_apsr_ge    = 0;
+uint32_t             SystemCoreClock = 84000000;
+HOST_DWT_Type        host_dwt;
+HOST_CoreDebug_Type  host_core_debug;
+HOST_SCB_Type        host_scb;
+
+
+//*****************************************************************************
+//  host_wfi
+//
+//          __WFI(): the CPU sleeps until the next SysTick, so 1 ms passes,
+//          on the ms clock and the DWT cycle counter.
+//*****************************************************************************
+void  host_wfi (void)
+{
+    host_ms++;
+    host_dwt.CYCCNT += SystemCoreClock / 1000;
+}
+
+
+//*****************************************************************************
+//  host_backup_read / host_backup_write
+//
+//          sys_Backup_Read() / _Write(): as board_rtc_backup_read() / _write().
+//*****************************************************************************
+int  host_backup_read (int reg_num, uint32_t *value)
+{
+    if (reg_num < 0 || reg_num >= HOST_BKP_NUM_REGS || value == 0L)
+       return (ERR_RTC_BKP_INVALID_REG);
+    *value = host_backup [reg_num];
+    return (0);
+}
+
+int  host_backup_write (int reg_num, uint32_t value)
+{
+    if (reg_num < 0 || reg_num >= HOST_BKP_NUM_REGS)
+       return (ERR_RTC_BKP_INVALID_REG);
+    host_backup [reg_num] = value;
+    return (0);
+}
+
+//*****************************************************************************
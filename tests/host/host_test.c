@@ -0,0 +1,99 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/host/host_test.c
+//
+//
+//  Check and timing helpers shared by the host tests. See host_test.h
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "host_test.h"
+#include <time.h>
+
+static int   _g_checks   = 0;
+static int   _g_failures = 0;
+
+
+//*****************************************************************************
+//  host_check
+//
+//          Record one check. Prints the failing expression and where it is.
+//*****************************************************************************
+int  host_check (int ok, const char *text, const char *file, int line)
+{
+    _g_checks++;
+    if ( ! ok)
+       { _g_failures++;
+         printf ("FAIL  %s:%d:  %s\n", file, line, text);
+       }
+    return (ok);
+}
+
+
+//*****************************************************************************
+//  host_check_eq
+//
+//          Record one equality check, printing both values if it fails.
+//*****************************************************************************
+int  host_check_eq (long long actual, long long expected, const char *text,
+                    const char *file, int line)
+{
+    _g_checks++;
+    if (actual != expected)
+       { _g_failures++;
+         printf ("FAIL  %s:%d:  %s = %lld, expected %lld\n",
+                 file, line, text, actual, expected);
+         return (0);
+       }
+    return (1);
+}
+
+
+//*****************************************************************************
+//  host_test_done
+//
+//          Print the summary. Returns the exit code for main().
+//*****************************************************************************
+int  host_test_done (const char *test_name)
+{
+    printf ("%s: %d checks, %d failed\n", test_name, _g_checks, _g_failures);
+    return (_g_failures == 0 ? 0 : 1);
+}
+
+
+//*****************************************************************************
+//  host_nsec
+//*****************************************************************************
+uint64_t  host_nsec (void)
+{
+    struct timespec  ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec);
+}
+
+//*****************************************************************************
@@ -0,0 +1,60 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/host/host_test.h
+//
+//
+//  Check and timing helpers shared by the host tests.
+//
+//  A test runs its CHECK()s, then returns host_test_done() from main(),
+//  which prints a summary and gives ctest a non-zero exit code if any
+//  check failed.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define  CHECK(cond)                                                         \
+           host_check ((cond) != 0, #cond, __FILE__, __LINE__)
+
+#define  CHECK_EQ(actual,expected)                                           \
+           host_check_eq ((long long) (actual), (long long) (expected),      \
+                          #actual, __FILE__, __LINE__)
+
+int       host_check (int ok, const char *text, const char *file, int line);
+int       host_check_eq (long long actual, long long expected, const char *text,
+                         const char *file, int line);
+int       host_test_done (const char *test_name);
+
+uint64_t  host_nsec (void);             // monotonic wall clock, nsec
+
+#endif                          //  __HOST_TEST_H__
+
+//*****************************************************************************
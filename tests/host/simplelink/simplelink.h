@@ -0,0 +1,75 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                         tests/host/simplelink/simplelink.h
+//
+//
+//  Host stand-in for the TI SimpleLink (CC3100) host driver, over host BSD
+//  sockets, so common/cc3100_nbsock.c can be tested against socketpairs.
+//
+//  Only the calls, types and SL_xxx defs the nbsock layer uses are here.
+//  sl_Recv() / sl_Send() return SimpleLink style status codes (SL_EAGAIN,
+//  negative errors), not -1/errno, and the test can inject an error status
+//  on the next call (host_sl_inject_error).
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __SIMPLELINK_H__
+#define __SIMPLELINK_H__
+
+#include <stdint.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+typedef fd_set          SlFdSet_t;
+typedef struct timeval  SlTimeval_t;
+
+typedef struct
+   {
+       uint32_t   NonblockingEnabled;
+   } SlSockNonblocking_t;
+
+#define  SL_FD_ZERO            FD_ZERO
+#define  SL_FD_SET             FD_SET
+#define  SL_FD_ISSET           FD_ISSET
+
+#define  SL_SOL_SOCKET              1
+#define  SL_SO_NONBLOCKING       0x24
+#define  SL_EAGAIN               (-11)
+#define  SL_ECONNRESET          (-104)
+
+extern int  host_sl_inject_error;        // != 0: next sl_Recv/sl_Send returns it
+
+int   sl_SetSockOpt (int sd, int level, int optname, void *optval, int optlen);
+int   sl_Select (int nfds, SlFdSet_t *readsds, SlFdSet_t *writesds,
+                 SlFdSet_t *exceptsds, SlTimeval_t *timeout);
+int   sl_Recv (int sd, void *buf, int len, int flags);
+int   sl_Send (int sd, const void *buf, int len, int flags);
+int   sl_Close (int sd);
+
+#endif                          //  __SIMPLELINK_H__
+
+//*****************************************************************************
@@ -0,0 +1,104 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                         tests/host/simplelink/simplelink_host.c
+//
+//
+//  SimpleLink socket calls (see simplelink.h) over host BSD sockets.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "simplelink.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+int  host_sl_inject_error = 0;
+
+
+int  sl_SetSockOpt (int sd, int level, int optname, void *optval, int optlen)
+{
+    int  fl;
+
+    if (level != SL_SOL_SOCKET || optname != SL_SO_NONBLOCKING
+       || optlen != (int) sizeof(SlSockNonblocking_t))
+       return (-1);
+    fl = fcntl (sd, F_GETFL);
+    if (fl < 0)
+       return (-1);
+    if (((SlSockNonblocking_t*) optval)->NonblockingEnabled)
+       fl |= O_NONBLOCK;
+       else fl &= ~O_NONBLOCK;
+    return (fcntl(sd, F_SETFL, fl) < 0 ? -1 : 0);
+}
+
+
+int  sl_Select (int nfds, SlFdSet_t *readsds, SlFdSet_t *writesds,
+                SlFdSet_t *exceptsds, SlTimeval_t *timeout)
+{
+    return (select(nfds, readsds, writesds, exceptsds, timeout));
+}
+
+
+int  sl_Recv (int sd, void *buf, int len, int flags)
+{
+    ssize_t  rc;
+
+    if (host_sl_inject_error != 0)
+       { rc = host_sl_inject_error;
+         host_sl_inject_error = 0;
+         return ((int) rc);
+       }
+    rc = recv (sd, buf, (size_t) len, flags);
+    if (rc < 0)
+       return ((errno == EAGAIN || errno == EWOULDBLOCK) ? SL_EAGAIN : SL_ECONNRESET);
+    return ((int) rc);
+}
+
+
+int  sl_Send (int sd, const void *buf, int len, int flags)
+{
+    ssize_t  rc;
+
+    if (host_sl_inject_error != 0)
+       { rc = host_sl_inject_error;
+         host_sl_inject_error = 0;
+         return ((int) rc);
+       }
+    rc = send (sd, buf, (size_t) len, flags | MSG_NOSIGNAL);
+    if (rc < 0)
+       return ((errno == EAGAIN || errno == EWOULDBLOCK) ? SL_EAGAIN : SL_ECONNRESET);
+    return ((int) rc);
+}
+
+
+int  sl_Close (int sd)
+{
+    return (close(sd) < 0 ? -1 : 0);
+}
+
+//*****************************************************************************
@@ -0,0 +1,146 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/host/user_api.h
+//
+//
+//  Host (PC) stand-in for the board's user_api.h, used to build the portable
+//  modules for the host tests.
+//
+//  Only the User API calls and defs the portable modules use are here. The
+//  calls are implemented in host_board.c against simulated hardware state
+//  (ms clock, interrupt mask, RTC backup registers, ...), which the tests
+//  set and check directly. The ERR_xxx codes are the boards' own, pulled
+//  out of their user_api.h files by tests/CMakeLists.txt.
+//
+//  Build with HOST_CORTEX_M=n to have the modules take their Cortex-M code
+//  paths (see cmsis_host.h).
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#ifndef __USER_API_H__
+#define __USER_API_H__
+
+#include <stdint.h>          // contains uint32_t / uint16_t  etc  defs
+#include <stdbool.h>
+#include <string.h>          // strcpy/strlen  memcpy/memset  etc
+#include <errno.h>
+
+#include "cmsis_host.h"      // Cortex-M intrinsics, when HOST_CORTEX_M is set
+#include "host_err_codes.h"  // ERR_xxx codes, generated from the boards' files
+
+
+     //----------------------------------------
+     //  Simulated board state (host_board.c)
+     //----------------------------------------
+extern uint32_t  host_ms;                // sys_Get_Time() / SysTick ms count
+extern uint32_t  host_reset_cause;       // sys_Get_Reset_Cause() value
+
+#define  HOST_BKP_NUM_REGS         20    // RTC backup registers (as an F4)
+extern uint32_t  host_backup [HOST_BKP_NUM_REGS];
+
+int   host_backup_read (int reg_num, uint32_t *value);
+int   host_backup_write (int reg_num, uint32_t value);
+
+
+     //----------------------------------------
+     //  Clock, reset cause and RTC backup registers, as the STM32 ones
+     //----------------------------------------
+#define  sys_Get_Time()                  (host_ms)
+#define  sys_Get_Reset_Cause()           (host_reset_cause)
+#define  sys_Backup_Read(reg_num,pvalue) host_backup_read(reg_num,pvalue)
+#define  sys_Backup_Write(reg_num,value) host_backup_write(reg_num,value)
+
+#define  RESET_CAUSE_POWER_ON   0x0001   /* power on / brown out reset         */
+#define  RESET_CAUSE_PIN        0x0002   /* NRST pin                           */
+#define  RESET_CAUSE_SOFTWARE   0x0004   /* NVIC_SystemReset()                 */
+#define  RESET_CAUSE_WATCHDOG   0x0008   /* IWDG or WWDG                       */
+#define  RESET_CAUSE_LOW_POWER  0x0010   /* illegal low power mode entry       */
+#define  RESET_CAUSE_STANDBY    0x0020   /* woke up from standby               */
+
+
+     //----------------------------------------
+     //  Board calls made by modules built with a USES_xxx flag. The test
+     //  that sets the flag supplies a model of the hardware.
+     //----------------------------------------
+int   board_crc_hw_update (int algo, uint32_t *crc, const uint8_t *buf,
+                           int length);          // USES_CRC_HW: # bytes done
+
+
+     //----------------------------------------
+     //  Interrupt plan: bottom halves and ISR timing per priority class
+     //  (boards/STM32_Bds/board_STM32_irq.c), defs as in the STM32
+     //  boarddef.h / user_api.h. Cycles are the simulated DWT CYCCNT.
+     //----------------------------------------
+#define  IRQ_CLASS_HARD_RT          0
+#define  IRQ_CLASS_COMMS            1
+#define  IRQ_CLASS_HOUSEKEEP        2
+#define  IRQ_CLASS_BOTTOM_HALF      3
+#define  IRQ_NUM_CLASSES            4
+#define  IRQ_LATENCY_UNKNOWN   0xFFFFFFFF
+#ifndef BH_MAX_HANDLERS
+#define  BH_MAX_HANDLERS            8
+#endif
+#define  IRQ_CYCLE_COUNT()       (host_dwt.CYCCNT)
+
+typedef  void (*BH_EVENT_HANDLER)(void *pCbParm, uint32_t events);
+
+typedef struct irq_class_stats_def
+   {
+       uint32_t   count;
+       uint32_t   latency_samples;
+       uint32_t   min_latency_cycles;
+       uint32_t   max_latency_cycles;
+       uint32_t   last_run_cycles;
+       uint32_t   max_run_cycles;
+   } IRQ_CLASS_STATS;
+
+typedef struct bh_stats_def
+   {
+       uint32_t   runs;
+       uint32_t   coalesced;
+       uint32_t   last_latency_cycles;
+       uint32_t   max_latency_cycles;
+       uint32_t   max_run_cycles;
+   } BH_STATS;
+
+void  board_irq_stats_record (int irq_class, uint32_t latency_cycles, uint32_t run_cycles);
+int   board_irq_get_stats (int irq_class, IRQ_CLASS_STATS *stats, int reset_flag);
+int   board_bh_register (BH_EVENT_HANDLER handler, void *parm);
+int   board_bh_schedule (int bh_id, uint32_t events);
+void  board_bh_dispatch (void);
+int   board_bh_get_stats (int bh_id, BH_STATS *stats, int reset_flag);
+
+#if defined(USES_TIMESTAMP)
+                         // timestamp counter = the simulated DWT CYCCNT,
+                         // at SystemCoreClock, stepped by the test
+#define  sys_Get_Timestamp_Ticks()       ((uint64_t) host_dwt.CYCCNT)
+#endif
+
+
+#endif                          //  __USER_API_H__
+
+//*****************************************************************************
@@ -0,0 +1,501 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_MQTTBroker.c
+//
+//
+//  Loopback host test and fan-out benchmark for mqtt/MQTTBroker.c.
+//
+//  The broker runs over simulated sockets (MQBROKER_NET_OPS): each client
+//  is a pair of byte queues. The test plays the clients, building and
+//  parsing their packets with the Paho MQTTPacket calls.
+//
+//    - topic filter matching (+, #, $SYS)
+//    - CONNECT / SUBSCRIBE / PUBLISH QoS 0 and 1 / PUBACK / UNSUBSCRIBE,
+//      overlapping subscriptions, QoS downgrade to the subscription's
+//    - QoS1 re-send with DUP after MQBROKER_RETRY_MS, pool slots freed
+//    - bridge handler, and no loop back of bridged messages
+//    - partial sends, slow consumer drops, keep alive timeout, client id
+//      takeover, DISCONNECT
+//    - random traffic and junk bytes: no crash, pool empty at the end
+//    - benchmark: ns per publish / per delivery, 1 publisher to 3 QoS 0
+//      subscribers
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "MQTTBroker.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define  NUM_SOCKS     8
+
+typedef struct
+   {
+       unsigned char  b [1 << 16];
+       int            len;
+   } SIM_QUEUE;
+
+typedef struct                          /* a packet a client received */
+   {
+       int    type;
+       int    qos;
+       int    dup;
+       int    id;
+       int    plen;
+       char   topic [64];
+       char   pl [300];
+   } SIM_PKT;
+
+static SIM_QUEUE    to_broker [NUM_SOCKS];
+static SIM_QUEUE    from_broker [NUM_SOCKS];
+static int          sock_open [NUM_SOCKS];
+static int          accept_q [NUM_SOCKS];
+static int          num_accept;
+static int          send_limit = 1 << 30;
+static MQTT_BROKER  broker;
+static uint32_t     now_ms;
+static int          bridged;
+
+
+     //----------------------------------------
+     //  Simulated network
+     //----------------------------------------
+static int  net_accept (int listen_sock)
+{
+    (void) listen_sock;
+    if (num_accept == 0)
+       return (-1);
+    sock_open[accept_q[--num_accept]] = 1;
+    return (accept_q[num_accept]);
+}
+
+static int  net_recv (int sock, unsigned char *buf, int len)
+{
+    SIM_QUEUE  *q = &to_broker[sock];
+    int        n;
+
+    n = (q->len < len) ? q->len : len;
+    memcpy (buf, q->b, n);
+    memmove (q->b, q->b + n, q->len - n);
+    q->len -= n;
+    return (n);
+}
+
+static int  net_send (int sock, const unsigned char *buf, int len)
+{
+    SIM_QUEUE  *q = &from_broker[sock];
+    int        n;
+
+    n = (len < send_limit) ? len : send_limit;
+    if (q->len + n > (int) sizeof(q->b))
+       n = sizeof(q->b) - q->len;
+    memcpy (q->b + q->len, buf, n);
+    q->len += n;
+    return (n);
+}
+
+static void  net_close (int sock)
+{
+    sock_open[sock] = 0;
+}
+
+static const MQBROKER_NET_OPS  sim_ops = { net_accept, net_recv, net_send, net_close };
+
+
+     //----------------------------------------
+     //  Simulated clients
+     //----------------------------------------
+static void  cl_put (int s, const void *pkt, int len)
+{
+    memcpy (to_broker[s].b + to_broker[s].len, pkt, len);
+    to_broker[s].len += len;
+}
+
+static void  cl_connect (int s, const char *id, int keepalive)
+{
+    MQTTPacket_connectData  data = MQTTPacket_connectData_initializer;
+    unsigned char           b [128];
+
+    data.clientID.cstring   = (char*) id;
+    data.keepAliveInterval  = keepalive;
+    accept_q[num_accept++]  = s;
+    cl_put (s, b, MQTTSerialize_connect (b, sizeof(b), &data));
+}
+
+static void  cl_sub (int s, const char *filter, int qos)
+{
+    MQTTString     t = MQTTString_initializer;
+    unsigned char  b [128];
+
+    t.cstring = (char*) filter;
+    cl_put (s, b, MQTTSerialize_subscribe (b, sizeof(b), 0, 1, 1, &t, &qos));
+}
+
+static void  cl_unsub (int s, const char *filter)
+{
+    MQTTString     t = MQTTString_initializer;
+    unsigned char  b [128];
+
+    t.cstring = (char*) filter;
+    cl_put (s, b, MQTTSerialize_unsubscribe (b, sizeof(b), 0, 2, 1, &t));
+}
+
+static void  cl_pub (int s, const char *topic, const char *pl, int plen, int qos, int id)
+{
+    MQTTString     t = MQTTString_initializer;
+    unsigned char  b [600];
+
+    t.cstring = (char*) topic;
+    cl_put (s, b, MQTTSerialize_publish (b, sizeof(b), 0, qos, 0, id, t,
+                                         (unsigned char*) pl, plen));
+}
+
+static void  cl_puback (int s, int id)
+{
+    unsigned char  b [4];
+
+    cl_put (s, b, MQTTSerialize_puback (b, sizeof(b), id));
+}
+
+static int  cl_read (int s, SIM_PKT *pk)    // 1 = got a packet
+{
+    SIM_QUEUE      *q = &from_broker[s];
+    unsigned char  dup,  retained,  *payload;
+    unsigned short id;
+    MQTTString     topic;
+    int            rem,  mult,  h,  total,  qos;
+
+    if (q->len < 2)
+       return (0);
+    rem = 0;
+    mult = h = 1;
+    do { rem += (q->b[h] & 127) * mult;
+         mult *= 128;
+       } while (q->b[h++] & 128);
+    total = h + rem;
+    if (q->len < total)
+       return (0);
+    memset (pk, 0, sizeof(*pk));
+    pk->type = q->b[0] >> 4;
+    pk->qos  = (q->b[0] >> 1) & 3;
+    pk->dup  = (q->b[0] >> 3) & 1;
+    if (pk->type == PUBLISH)
+       { CHECK_EQ (MQTTDeserialize_publish (&dup, &qos, &retained, &id, &topic,
+                                            &payload, &pk->plen, q->b, total), 1);
+         pk->id = id;
+         memcpy (pk->topic, topic.lenstring.data, topic.lenstring.len);
+         memcpy (pk->pl, payload, pk->plen);
+       }
+      else if (pk->type == PUBACK || pk->type == SUBACK || pk->type == UNSUBACK)
+              pk->id = (q->b[h] << 8) | q->b[h + 1];
+    memmove (q->b, q->b + total, q->len - total);
+    q->len -= total;
+    return (1);
+}
+
+static void  cl_drain (int s)
+{
+    SIM_PKT  pk;
+
+    while (cl_read (s, &pk))
+      ;
+}
+
+static void  yield (void)
+{
+    CHECK_EQ (MQTTBroker_Yield (&broker, now_ms), 0);
+}
+
+static void  bridge_up (void *parm, MQTTString *topic, unsigned char *payload,
+                        int len, int qos)
+{
+    (void) parm;  (void) topic;  (void) payload;  (void) len;  (void) qos;
+    bridged++;
+}
+
+static void  sim_reset (void)
+{
+    memset (to_broker, 0, sizeof(to_broker));
+    memset (from_broker, 0, sizeof(from_broker));
+    memset (sock_open, 0, sizeof(sock_open));
+    num_accept = 0;
+    CHECK_EQ (MQTTBroker_Init (&broker, &sim_ops, 99), 0);
+}
+
+
+//*****************************************************************************
+//  test_topic_match
+//*****************************************************************************
+static void  test_topic_match (void)
+{
+    CHECK (MQTTBroker_Topic_Matches ("a/+/c", "a/b/c", 5));
+    CHECK ( ! MQTTBroker_Topic_Matches ("a/+/c", "a/b/d", 5));
+    CHECK (MQTTBroker_Topic_Matches ("a/#", "a", 1));
+    CHECK (MQTTBroker_Topic_Matches ("a/#", "a/b/c", 5));
+    CHECK (MQTTBroker_Topic_Matches ("#", "x/y", 3));
+    CHECK ( ! MQTTBroker_Topic_Matches ("#", "$SYS/x", 6));
+    CHECK (MQTTBroker_Topic_Matches ("$SYS/#", "$SYS/x", 6));
+    CHECK ( ! MQTTBroker_Topic_Matches ("a/b", "a/bc", 4));
+    CHECK (MQTTBroker_Topic_Matches ("+/+", "a/", 2));
+    CHECK ( ! MQTTBroker_Topic_Matches ("a", "a/b", 3));
+}
+
+
+//*****************************************************************************
+//  test_loopback
+//*****************************************************************************
+static void  test_loopback (void)
+{
+    SIM_PKT   pk;
+    uint32_t  drops;
+    int       bid;
+    int       got;
+    int       i;
+    int       k;
+
+    sim_reset ();
+    cl_connect (0, "A", 10);
+    cl_connect (1, "B", 10);
+    cl_connect (2, "C", 0);
+    yield ();
+    for (i = 0;  i < 3;  i++)
+      CHECK (cl_read (i, &pk)  &&  pk.type == CONNACK);
+
+    cl_sub (0, "plant/+/temp", 0);
+    cl_sub (1, "plant/#", 1);
+    cl_sub (1, "plant/1/temp", 0);          // overlaps: one delivery, max QoS
+    cl_sub (2, "other/x", 1);
+    yield ();
+    for (i = 0;  i < 3;  i++)
+      CHECK (cl_read (i, &pk)  &&  pk.type == SUBACK);
+    CHECK (cl_read (1, &pk)  &&  pk.type == SUBACK);
+    CHECK_EQ (MQTTBroker_Bridge_Topic (&broker, "plant/+/alarm", bridge_up, 0L), 0);
+
+       // QoS1 publish: PUBACK to the publisher, QoS0 to A, QoS1 to B
+    cl_pub (0, "plant/1/temp", "23.5", 4, 1, 77);
+    yield ();
+    CHECK (cl_read (0, &pk)  &&  pk.type == PUBACK  &&  pk.id == 77);
+    CHECK (cl_read (0, &pk)  &&  pk.type == PUBLISH  &&  pk.qos == 0);
+    CHECK (strcmp (pk.topic, "plant/1/temp") == 0  &&  pk.plen == 4);
+    CHECK (cl_read (1, &pk)  &&  pk.type == PUBLISH  &&  pk.qos == 1);
+    CHECK (memcmp (pk.pl, "23.5", 4) == 0);
+    bid = pk.id;
+    CHECK ( ! cl_read (1, &pk));
+    CHECK ( ! cl_read (2, &pk));
+    CHECK_EQ (broker.pool_in_use, 1);
+
+       // no PUBACK from B: re-sent with DUP after the retry time
+    now_ms += MQBROKER_RETRY_MS + 1000;
+    cl_put (0, "\xC0\x00", 2);              // PINGREQs keep A and B alive
+    cl_put (1, "\xC0\x00", 2);
+    yield ();
+    CHECK (cl_read (1, &pk)  &&  pk.type == PINGRESP);
+    CHECK (cl_read (1, &pk)  &&  pk.type == PUBLISH  &&  pk.dup == 1  &&  pk.id == bid);
+    cl_drain (0);
+    cl_puback (1, bid);
+    yield ();
+    CHECK_EQ (broker.pool_in_use, 0);
+
+       // bridged out, and not bridged back when it came from upstream
+    cl_pub (2, "plant/9/alarm", "x", 1, 0, 0);
+    yield ();
+    CHECK_EQ (bridged, 1);
+    CHECK (cl_read (1, &pk)  &&  pk.type == PUBLISH);
+    cl_puback (1, pk.id);
+    CHECK_EQ (MQTTBroker_Publish (&broker, "plant/8/alarm", "y", 1, 0,
+                                  MQBROKER_FROM_BRIDGE), 1);   // B only
+    yield ();
+    CHECK_EQ (bridged, 1);
+    while (cl_read (1, &pk))
+      if (pk.type == PUBLISH  &&  pk.qos == 1)
+         cl_puback (1, pk.id);
+    yield ();
+
+       // sends that only take 3 bytes at a time
+    send_limit = 3;
+    for (i = 0;  i < 5;  i++)
+      cl_pub (2, "plant/2/temp", "abcdefghij", 10, 0, 0);
+    for (k = 0;  k < 100;  k++)
+      yield ();
+    send_limit = 1 << 30;
+    for (got = 0;  cl_read (0, &pk);  got++)
+      CHECK (pk.type == PUBLISH  &&  pk.plen == 10  &&  memcmp (pk.pl, "abcdefghij", 10) == 0);
+    CHECK_EQ (got, 5);
+    for (got = 0;  cl_read (1, &pk);  )
+      if (pk.type == PUBLISH)
+         { got++;
+           cl_puback (1, pk.id);
+         }
+    CHECK_EQ (got, 5);
+    yield ();
+    CHECK_EQ (broker.pool_in_use, 0);
+
+       // slow consumer: B never acks or reads, its queue fills, drops counted
+    drops = broker.drops;
+    for (i = 0;  i < 20;  i++)
+      { cl_pub (2, "plant/3/temp", "z", 1, 1, 5);
+        yield ();
+      }
+    CHECK (broker.drops > drops);
+    cl_drain (0);
+    cl_drain (2);
+    cl_unsub (1, "plant/#");
+    cl_unsub (1, "plant/1/temp");
+    yield ();
+    cl_drain (1);
+
+       // keep alive: A and B (10 secs) time out, C (no keep alive) stays
+    now_ms += 16000;
+    cl_put (2, "\xC0\x00", 2);
+    yield ();
+    CHECK ( ! sock_open[0]  &&  ! sock_open[1]  &&  sock_open[2]);
+    CHECK_EQ (broker.pool_in_use, 0);
+
+       // same client id takes over, DISCONNECT closes
+    cl_connect (3, "C", 0);
+    yield ();
+    CHECK ( ! sock_open[2]  &&  sock_open[3]);
+    cl_drain (3);
+    cl_put (3, "\xE0\x00", 2);
+    yield ();
+    CHECK ( ! sock_open[3]);
+    MQTTBroker_Close (&broker);
+}
+
+
+//*****************************************************************************
+//  test_random_traffic
+//*****************************************************************************
+static void  test_random_traffic (void)
+{
+    unsigned char  junk [40];
+    char           id [8];
+    long           it;
+    int            s;
+    int            len;
+    int            i;
+
+    sim_reset ();
+    srand (3);
+    for (it = 0;  it < 20000;  it++)
+      { s = 4 + (it % 4);
+        if ( ! sock_open[s]  &&  num_accept == 0)
+           { to_broker[s].len = from_broker[s].len = 0;
+             sprintf (id, "f%d", s);
+             cl_connect (s, id, 0);
+             if (rand () % 2)
+                cl_sub (s, "#", rand () % 2);
+           }
+        if (rand () % 3 == 0)
+           cl_pub (s, "f/x", "hello", 5, rand () % 2, 1);
+           else if (rand () % 50 == 0)
+                   { len = rand () % 40;
+                     for (i = 0;  i < len;  i++)
+                       junk[i] = (unsigned char) rand ();
+                     cl_put (s, junk, len);
+                   }
+        now_ms += 10;
+        yield ();
+        if (rand () % 4 == 0)
+           cl_drain (s);
+      }
+    CHECK (broker.clients_dropped > 0);     // the junk got clients dropped
+    MQTTBroker_Close (&broker);
+    CHECK_EQ (broker.pool_in_use, 0);
+}
+
+
+//*****************************************************************************
+//  bench
+//
+//          1 publisher, 3 QoS 0 subscribers (plus unrelated filters, so the
+//          match has to search), 64 byte payloads, Yield every 8 publishes.
+//*****************************************************************************
+static void  bench (void)
+{
+    char      pl [64];
+    char      f [16];
+    char      id [4];
+    uint64_t  t0;
+    uint64_t  t_broker;
+    long      delivered;
+    long      k;
+    int       i;
+    const long  N = 200000;
+
+    sim_reset ();
+    for (i = 0;  i < 4;  i++)
+      { sprintf (id, "b%d", i);
+        cl_connect (i, id, 0);
+      }
+    yield ();
+    for (i = 1;  i < 4;  i++)
+      cl_sub (i, "s/+/v", 0);
+    cl_sub (1, "z/#", 0);
+    for (i = 0;  i < 8;  i++)
+      { sprintf (f, "other/%d", i);
+        cl_sub (2, f, 0);
+      }
+    yield ();
+    for (i = 0;  i < 4;  i++)
+      cl_drain (i);
+
+    memset (pl, 'q', sizeof(pl));
+    t_broker  = 0;
+    delivered = 0;
+    for (k = 0;  k < N;  k++)
+      { cl_pub (0, "s/7/v", pl, sizeof(pl), 0, 0);
+        if ((k & 7) == 7)
+           { t0 = host_nsec ();
+             yield ();
+             t_broker += host_nsec () - t0;
+             for (i = 1;  i < 4;  i++)
+               { delivered += from_broker[i].len / (2 + 2 + 5 + 64);
+                 from_broker[i].len = 0;
+               }
+           }
+      }
+    CHECK_EQ (delivered, 3 * N);
+    CHECK_EQ (broker.drops, 0);
+    printf ("benchmark: fan-out 1 -> 3 QoS 0: %.0f ns per publish, %.0f ns per delivery "
+            "(%.1f M deliveries/s), pool high water %u\n",
+            (double) t_broker / N, (double) t_broker / delivered,
+            delivered / ((double) t_broker / 1e9) / 1e6, broker.pool_max_in_use);
+    MQTTBroker_Close (&broker);
+}
+
+
+int  main (void)
+{
+    test_topic_match ();
+    test_loopback ();
+    test_random_traffic ();
+    bench ();
+    return (host_test_done ("test_MQTTBroker"));
+}
+
+//*****************************************************************************
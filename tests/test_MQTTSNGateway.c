@@ -0,0 +1,498 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_MQTTSNGateway.c
+//
+//
+//  Host simulation of mqtt/MQTTSNGateway.c with virtual SPIRIT1 and BLE
+//  nodes, publishing end to end through mqtt/MQTTBroker.c to a subscriber
+//  app.
+//
+//  The gateway's upstream session and the app are both clients of a
+//  broker running over simulated sockets (socket 0 = gateway, 1 = app).
+//  The nodes are byte frames in and out of MQTTSNGateway_Input() and the
+//  links' send calls.
+//
+//    - QoS -1 publish on a pre-defined topic, rejected unknown ids / no
+//      CONNECT
+//    - CONNECT, REGISTER (same name gets the same id), QoS 1 publish with
+//      PUBACK, DUP re-send not published twice, short topics
+//    - SUBSCRIBE and downstream PUBLISH, frame too big for the BLE MTU
+//    - sleeping node: messages held, released on PINGREQ, node lost after
+//      1.5 x the sleep duration
+//    - random frames: no crash
+//    - benchmark: 64 nodes, QoS -1, end to end messages per second and
+//      messages per upstream write (batching)
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "MQTTBroker.h"
+#include "MQTTSNGateway.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define  SOCK_GW       0
+#define  SOCK_APP      1
+#define  NUM_SOCKS     2
+
+typedef struct
+   {
+       unsigned char  b [1 << 20];
+       int            len;
+   } SIM_QUEUE;
+
+typedef struct                          /* frames the gateway sent to one node */
+   {
+       uint8_t  f [16][MQSNGW_FRAME_SIZE];
+       int      len [16];
+       int      n;
+   } NODE_QUEUE;
+
+static SIM_QUEUE       to_broker [NUM_SOCKS];
+static SIM_QUEUE       from_broker [NUM_SOCKS];
+static int             sock_open [NUM_SOCKS];
+static int             accept_q [NUM_SOCKS];
+static int             num_accept;
+static MQTT_BROKER     broker;
+static MQTTSN_GATEWAY  gw;
+static uint32_t        now_ms;
+static long            up_writes;
+static long            app_rx;
+static char            last_topic [64];
+static char            last_pl [64];
+static NODE_QUEUE      node_q [MQSNGW_MAX_LINKS][256];
+
+
+     //----------------------------------------
+     //  Broker sockets
+     //----------------------------------------
+static int  net_accept (int listen_sock)
+{
+    (void) listen_sock;
+    if (num_accept == 0)
+       return (-1);
+    sock_open[accept_q[--num_accept]] = 1;
+    return (accept_q[num_accept]);
+}
+
+static int  net_recv (int sock, unsigned char *buf, int len)
+{
+    SIM_QUEUE  *q = &to_broker[sock];
+    int        n;
+
+    n = (q->len < len) ? q->len : len;
+    memcpy (buf, q->b, n);
+    memmove (q->b, q->b + n, q->len - n);
+    q->len -= n;
+    return (n);
+}
+
+static int  net_send (int sock, const unsigned char *buf, int len)
+{
+    SIM_QUEUE  *q = &from_broker[sock];
+
+    if (q->len + len > (int) sizeof(q->b))
+       len = sizeof(q->b) - q->len;
+    memcpy (q->b + q->len, buf, len);
+    q->len += len;
+    return (len);
+}
+
+static void  net_close (int sock)
+{
+    sock_open[sock] = 0;
+}
+
+static const MQBROKER_NET_OPS  sim_ops = { net_accept, net_recv, net_send, net_close };
+
+
+     //----------------------------------------
+     //  Gateway upstream, app client
+     //----------------------------------------
+static int  up_write (void *parm, const unsigned char *buf, int len)
+{
+    SIM_QUEUE  *q = &to_broker[SOCK_GW];
+
+    (void) parm;
+    if (q->len + len > (int) sizeof(q->b))
+       return (-1);
+    memcpy (q->b + q->len, buf, len);
+    q->len += len;
+    up_writes++;
+    return (len);
+}
+
+static void  cl_connect (int s, const char *id)
+{
+    MQTTPacket_connectData  data = MQTTPacket_connectData_initializer;
+
+    data.clientID.cstring  = (char*) id;
+    data.keepAliveInterval = 0;         // the test jumps the clock by minutes
+    accept_q[num_accept++] = s;
+    to_broker[s].len += MQTTSerialize_connect (to_broker[s].b + to_broker[s].len,
+                                               128, &data);
+}
+
+static void  cl_sub (int s, const char *filter)
+{
+    MQTTString  t = MQTTString_initializer;
+    int         qos = 0;
+
+    t.cstring = (char*) filter;
+    to_broker[s].len += MQTTSerialize_subscribe (to_broker[s].b + to_broker[s].len,
+                                                 128, 0, 1, 1, &t, &qos);
+}
+
+static void  cl_pub (int s, const char *topic, const char *pl)
+{
+    MQTTString  t = MQTTString_initializer;
+
+    t.cstring = (char*) topic;
+    to_broker[s].len += MQTTSerialize_publish (to_broker[s].b + to_broker[s].len,
+                                               256, 0, 0, 0, 0, t,
+                                               (unsigned char*) pl, strlen (pl));
+}
+
+static void  app_read (void)            // count the PUBLISHes the app got
+{
+    SIM_QUEUE      *q = &from_broker[SOCK_APP];
+    unsigned char  dup,  retained,  *payload;
+    unsigned short id;
+    MQTTString     topic;
+    int            off,  rem,  mult,  h,  total,  qos,  plen;
+
+    off = 0;
+    while (q->len - off >= 2)
+      { rem = 0;
+        mult = h = 1;
+        do { rem += (q->b[off + h] & 127) * mult;
+             mult *= 128;
+           } while (q->b[off + h++] & 128);
+        total = h + rem;
+        if (q->len - off < total)
+           break;
+        if ((q->b[off] >> 4) == PUBLISH)
+           { CHECK_EQ (MQTTDeserialize_publish (&dup, &qos, &retained, &id, &topic,
+                                                &payload, &plen, q->b + off, total), 1);
+             memcpy (last_topic, topic.lenstring.data, topic.lenstring.len);
+             last_topic[topic.lenstring.len] = '\0';
+             memcpy (last_pl, payload, plen);
+             last_pl[plen] = '\0';
+             app_rx++;
+           }
+        off += total;
+      }
+    memmove (q->b, q->b + off, q->len - off);
+    q->len -= off;
+}
+
+
+     //----------------------------------------
+     //  Virtual nodes
+     //----------------------------------------
+static int  link_send (void *parm, uint8_t addr, const uint8_t *frame, int len)
+{
+    NODE_QUEUE  *q = &node_q[(intptr_t) parm][addr];
+
+    CHECK (len <= MQSNGW_FRAME_SIZE);
+    if (q->n < 16)
+       { memcpy (q->f[q->n], frame, len);
+         q->len[q->n++] = len;
+       }
+    return (0);
+}
+
+static int  node_rx (int link, int addr, uint8_t *out)   // next frame, or 0
+{
+    NODE_QUEUE  *q = &node_q[link][addr];
+    int         len;
+
+    if (q->n == 0)
+       return (0);
+    len = q->len[0];
+    memcpy (out, q->f[0], len);
+    memmove (q->f, q->f + 1, sizeof(q->f[0]) * 15);
+    memmove (q->len, q->len + 1, sizeof(int) * 15);
+    q->n--;
+    return (len);
+}
+
+static void  run (void)                 // gateway, then broker until idle
+{
+    MQTTSNGateway_Yield (&gw, now_ms);
+    do { CHECK_EQ (MQTTBroker_Yield (&broker, now_ms), 0);
+         from_broker[SOCK_GW].len = 0;  // acks to the gateway session
+         app_read ();
+       } while (to_broker[SOCK_GW].len > 0);
+}
+
+static int  frame_named (uint8_t *f, int type, int hdr_len, const char *name)
+{
+    int  len;
+
+    len = hdr_len + strlen (name);
+    f[0] = (uint8_t) len;
+    f[1] = (uint8_t) type;
+    memcpy (f + hdr_len, name, strlen (name));
+    return (len);
+}
+
+
+//*****************************************************************************
+//  test_gateway
+//*****************************************************************************
+static void  test_gateway (void)
+{
+    static const uint8_t  conn [] = { 8, 0x04, 0x04, 0x01, 0, 10, 'n', '3' };
+    static const uint8_t  disc [] = { 4, 0x18, 0, 60 };
+    static const uint8_t  ping [] = { 4, 0x16, 'n', '3' };
+    uint8_t   f [64];
+    uint8_t   r [64];
+    uint32_t  drops;
+    int       n;
+    int       tid;
+    int       i;
+
+    CHECK_EQ (MQTTBroker_Init (&broker, &sim_ops, 9), 0);
+    cl_connect (SOCK_GW, "gw");
+    cl_connect (SOCK_APP, "app");
+    run ();
+    cl_sub (SOCK_APP, "plant/#");
+    run ();
+    from_broker[SOCK_APP].len = 0;
+
+    CHECK_EQ (MQTTSNGateway_Init (&gw, up_write, 0L), 0);
+    CHECK_EQ (MQTTSNGateway_Add_Link (&gw, MQSNGW_LINK_SPIRIT1, link_send, (void*) 0, 96), 0);
+    CHECK_EQ (MQTTSNGateway_Add_Link (&gw, MQSNGW_LINK_BLE, link_send, (void*) 1, 20), 0);
+    CHECK_EQ (MQTTSNGateway_Define_Topic (&gw, 0x10, "plant/boiler/temp"), 0);
+    CHECK (MQTTSNGateway_Define_Topic (&gw, 0x10, "x") != 0);      // in use
+    CHECK (MQTTSNGateway_Define_Topic (&gw, 0x200, "x") != 0);     // REGISTER range
+    CHECK_EQ (MQTTBroker_Bridge_Topic (&broker, "cmd/#", MQTTSNGateway_Deliver, &gw), 0);
+
+       // QoS -1 on a pre-defined id: no CONNECT needed, no reply
+    n = MQTTSN_Serialize_publish (f, sizeof(f), -1, MQSN_TOPIC_PREDEFINED, 0x10, 0,
+                                  (const uint8_t*) "21.5", 4);
+    CHECK_EQ (MQTTSNGateway_Input (&gw, 0, 7, f, n), 0);
+    CHECK_EQ (node_q[0][7].n, 0);
+    now_ms += MQSNGW_BATCH_MS;
+    run ();
+    CHECK_EQ (app_rx, 1);
+    CHECK (strcmp (last_topic, "plant/boiler/temp") == 0  &&  strcmp (last_pl, "21.5") == 0);
+
+    n = MQTTSN_Serialize_publish (f, sizeof(f), -1, MQSN_TOPIC_PREDEFINED, 0x11, 0,
+                                  (const uint8_t*) "x", 1);
+    CHECK_EQ (MQTTSNGateway_Input (&gw, 0, 7, f, n), ERR_MQSNGW_BAD_FRAME);
+    n = MQTTSN_Serialize_publish (f, sizeof(f), 0, MQSN_TOPIC_PREDEFINED, 0x10, 0,
+                                  (const uint8_t*) "x", 1);
+    CHECK_EQ (MQTTSNGateway_Input (&gw, 0, 7, f, n), ERR_MQSNGW_BAD_FRAME);
+
+       // CONNECT BLE node 3, keep alive 10 secs
+    MQTTSNGateway_Input (&gw, 1, 3, conn, sizeof(conn));
+    CHECK (node_rx (1, 3, r) == 3  &&  r[1] == 0x05  &&  r[2] == 0);
+
+       // REGISTER: first id 0x100, same name again gets the same id
+    f[2] = f[3] = 0;
+    f[4] = 0;
+    f[5] = 9;
+    n = frame_named (f, 0x0A, 6, "plant/pump/rpm");
+    MQTTSNGateway_Input (&gw, 1, 3, f, n);
+    CHECK (node_rx (1, 3, r) == 7  &&  r[1] == 0x0B  &&  r[5] == 9  &&  r[6] == 0);
+    tid = (r[2] << 8) | r[3];
+    CHECK_EQ (tid, 0x100);
+    MQTTSNGateway_Input (&gw, 1, 3, f, n);
+    CHECK (node_rx (1, 3, r) == 7  &&  ((r[2] << 8) | r[3]) == tid);
+
+       // QoS 1: PUBACK; a DUP re-send is acked but not published again
+    n = MQTTSN_Serialize_publish (f, sizeof(f), 1, MQSN_TOPIC_NORMAL, tid, 42,
+                                  (const uint8_t*) "1500", 4);
+    MQTTSNGateway_Input (&gw, 1, 3, f, n);
+    CHECK (node_rx (1, 3, r) == 7  &&  r[1] == 0x0D  &&  r[5] == 42  &&  r[6] == 0);
+    f[2] |= 0x80;
+    MQTTSNGateway_Input (&gw, 1, 3, f, n);
+    CHECK (node_rx (1, 3, r) == 7  &&  r[6] == 0);
+    now_ms += MQSNGW_BATCH_MS;
+    run ();
+    CHECK_EQ (app_rx, 2);
+    CHECK (strcmp (last_topic, "plant/pump/rpm") == 0);
+
+       // short topic "px": published, but not under plant/#
+    n = MQTTSN_Serialize_publish (f, sizeof(f), 0, MQSN_TOPIC_SHORT, ('p' << 8) | 'x', 0,
+                                  (const uint8_t*) "s", 1);
+    CHECK_EQ (MQTTSNGateway_Input (&gw, 1, 3, f, n), 0);
+    now_ms += MQSNGW_BATCH_MS;
+    run ();
+    CHECK_EQ (app_rx, 2);
+
+       // SUBSCRIBE by name, then a downstream PUBLISH
+    f[2] = 0;
+    f[3] = 0;
+    f[4] = 5;
+    n = frame_named (f, 0x12, 5, "cmd/n3/led");
+    MQTTSNGateway_Input (&gw, 1, 3, f, n);
+    CHECK (node_rx (1, 3, r) == 8  &&  r[1] == 0x13  &&  r[7] == 0);
+    tid = (r[3] << 8) | r[4];
+    CHECK_EQ (tid, 0x101);
+    cl_pub (SOCK_APP, "cmd/n3/led", "on");
+    run ();
+    CHECK (node_rx (1, 3, r) == 9  &&  r[1] == 0x0C  &&  ((r[3] << 8) | r[4]) == tid);
+    CHECK (memcmp (r + 7, "on", 2) == 0);
+
+       // too big for the BLE link's 20 byte MTU: dropped, counted
+    drops = gw.drops;
+    cl_pub (SOCK_APP, "cmd/n3/led", "0123456789abcdefghij");
+    run ();
+    CHECK_EQ (node_q[1][3].n, 0);
+    CHECK_EQ (gw.drops, drops + 1);
+
+       // asleep for 60 secs: held, then released by PINGREQ
+    MQTTSNGateway_Input (&gw, 1, 3, disc, sizeof(disc));
+    CHECK (node_rx (1, 3, r) == 2  &&  r[1] == 0x18);
+    cl_pub (SOCK_APP, "cmd/n3/led", "A");
+    cl_pub (SOCK_APP, "cmd/n3/led", "B");
+    run ();
+    CHECK_EQ (node_q[1][3].n, 0);
+    CHECK_EQ (gw.msgs_held, 2);
+    now_ms += 30000;
+    run ();
+    MQTTSNGateway_Input (&gw, 1, 3, ping, sizeof(ping));
+    CHECK (node_rx (1, 3, r) == 8  &&  r[7] == 'A');
+    CHECK (node_rx (1, 3, r) == 8  &&  r[7] == 'B');
+    CHECK (node_rx (1, 3, r) == 2  &&  r[1] == 0x17);       // PINGRESP last
+
+       // no wake up within 1.5 x 60 secs: node lost, held messages freed
+    cl_pub (SOCK_APP, "cmd/n3/led", "C");
+    run ();
+    now_ms += 91000;
+    run ();
+    CHECK_EQ (gw.nodes_lost, 1);
+    for (i = 0;  i < MQSNGW_HELD_MSGS;  i++)
+      CHECK (gw.held[i].node < 0);
+}
+
+
+//*****************************************************************************
+//  test_random_frames
+//*****************************************************************************
+static void  test_random_frames (void)
+{
+    static const uint8_t  types [] = { 0x04, 0x0A, 0x0C, 0x12, 0x16, 0x18 };
+    uint8_t   z [64];
+    uint32_t  bad;
+    long      it;
+    int       len;
+    int       k;
+    int       a;
+
+    bad = gw.bad_frames;
+    srand (1);
+    for (it = 0;  it < 200000;  it++)
+      { len = rand () % 64;
+        for (k = 0;  k < len;  k++)
+          z[k] = (uint8_t) rand ();
+        if (len > 0)
+           z[0] = (uint8_t) (rand () % (len + 1));
+        if (len > 1  &&  rand () % 4 == 0)
+           z[1] = types[rand () % sizeof(types)];
+        MQTTSNGateway_Input (&gw, rand () % 2, rand () % 4, z, len);
+        if (it % 100 == 0)
+           { now_ms += rand () % 2000;
+             run ();
+           }
+        for (a = 0;  a < 4;  a++)
+          node_q[0][a].n = node_q[1][a].n = 0;
+      }
+    run ();
+    CHECK (gw.bad_frames > bad);
+}
+
+
+//*****************************************************************************
+//  bench
+//
+//          64 virtual nodes on both links, QoS -1 on a pre-defined topic,
+//          8 byte payloads, Yields every 32 frames. Every node message must
+//          reach the broker. With the default broker sizing the app does not
+//          get them all: one Yield takes in several batches (up to 4 x
+//          MQBROKER_RX_BUF_SIZE bytes) but a client queues only
+//          MQBROKER_TXQ_DEPTH deliveries, so the rest count as broker drops.
+//*****************************************************************************
+static void  bench (void)
+{
+    uint8_t   f [64];
+    uint64_t  t0;
+    double    secs;
+    uint32_t  in0;
+    uint32_t  gw_drops0;
+    uint32_t  br_drops0;
+    long      rx0;
+    long      w0;
+    long      got;
+    long      k;
+    int       n;
+    const long  N = 1000000;
+
+    now_ms += 100000;
+    run ();
+    rx0       = app_rx;
+    w0        = up_writes;
+    in0       = broker.msgs_in;
+    gw_drops0 = gw.drops;
+    br_drops0 = broker.drops;
+    t0 = host_nsec ();
+    for (k = 0;  k < N;  k++)
+      { n = MQTTSN_Serialize_publish (f, sizeof(f), -1, MQSN_TOPIC_PREDEFINED, 0x10, 0,
+                                      (const uint8_t*) &k, 8);
+        MQTTSNGateway_Input (&gw, k & 1, (uint8_t) (k & 63), f, n);
+        if ((k & 31) == 31)
+           { now_ms++;
+             run ();
+           }
+      }
+    now_ms += MQSNGW_BATCH_MS;
+    run ();
+    secs = (host_nsec () - t0) / 1e9;
+    got  = app_rx - rx0;
+    CHECK_EQ (gw.drops, gw_drops0);
+    CHECK_EQ ((long) (broker.msgs_in - in0), N);
+    CHECK_EQ (got + (long) (broker.drops - br_drops0), N);
+    printf ("benchmark: %ld node messages into the broker in %.2f s = %.0f msgs/s, "
+            "%.1f msgs per upstream write\n",
+            N, secs, N / secs, (double) N / (up_writes - w0));
+    printf ("           app got %ld, broker dropped %u (client queue %d deep)\n",
+            got, broker.drops - br_drops0, MQBROKER_TXQ_DEPTH);
+}
+
+
+int  main (void)
+{
+    test_gateway ();
+    test_random_frames ();
+    bench ();
+    return (host_test_done ("test_MQTTSNGateway"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,358 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_adc_dsp_filter.c
+//
+//
+//  Host test for common/adc_dsp_filter.c
+//
+//    - known answers for each mode (passthru, boxcar, CIC, IIR, window)
+//    - bit exactness: the Cortex-M4 SIMD path and the scalar path are fed
+//      the same random frames, in every mode and mix of channel pairs, and
+//      must give identical outputs, ready masks and window stats every frame
+//    - parameter checks
+//    - benchmark: host nsec per frame for each path and mode
+//
+//  The module is built twice (see CMakeLists.txt): simd_xxx() has the
+//  packed intrinsics (emulated in C by host/cmsis_host.h), scalar_xxx() is
+//  forced to the scalar code.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "adc_dsp_filter.h"
+#include "host_test.h"
+#include <stdlib.h>
+
+     //----------------------------------------
+     //  The two builds of the module
+     //----------------------------------------
+int  simd_adc_dsp_init (ADC_DSP_STAGE *dsp, int num_channels,
+                        ADC_DSP_CB_EVENT_HANDLER callback_function, void *callback_parm);
+int  simd_adc_dsp_config_channel (ADC_DSP_STAGE *dsp, int chan_index, int dsp_mode,
+                                  long mode_parm, int flags);
+int  simd_adc_dsp_set_scaling (ADC_DSP_STAGE *dsp, int chan_index,
+                               int eng_at_zero, int eng_at_full_scale);
+int  simd_adc_dsp_process_frame (ADC_DSP_STAGE *dsp, uint16_t *samples, int num_samples);
+int  simd_adc_dsp_get_results (ADC_DSP_STAGE *dsp, int16_t *eng_results);
+int  simd_adc_dsp_get_window_stats (ADC_DSP_STAGE *dsp, int chan_index,
+                                    int16_t *eng_min, int16_t *eng_max, int16_t *eng_rms);
+
+int  scalar_adc_dsp_init (ADC_DSP_STAGE *dsp, int num_channels,
+                          ADC_DSP_CB_EVENT_HANDLER callback_function, void *callback_parm);
+int  scalar_adc_dsp_config_channel (ADC_DSP_STAGE *dsp, int chan_index, int dsp_mode,
+                                    long mode_parm, int flags);
+int  scalar_adc_dsp_set_scaling (ADC_DSP_STAGE *dsp, int chan_index,
+                                 int eng_at_zero, int eng_at_full_scale);
+int  scalar_adc_dsp_process_frame (ADC_DSP_STAGE *dsp, uint16_t *samples, int num_samples);
+int  scalar_adc_dsp_get_results (ADC_DSP_STAGE *dsp, int16_t *eng_results);
+int  scalar_adc_dsp_get_window_stats (ADC_DSP_STAGE *dsp, int chan_index,
+                                      int16_t *eng_min, int16_t *eng_max, int16_t *eng_rms);
+
+typedef struct
+   {
+       const char  *name;
+       int  (*init) (ADC_DSP_STAGE*, int, ADC_DSP_CB_EVENT_HANDLER, void*);
+       int  (*config) (ADC_DSP_STAGE*, int, int, long, int);
+       int  (*scaling) (ADC_DSP_STAGE*, int, int, int);
+       int  (*process) (ADC_DSP_STAGE*, uint16_t*, int);
+       int  (*results) (ADC_DSP_STAGE*, int16_t*);
+       int  (*window) (ADC_DSP_STAGE*, int, int16_t*, int16_t*, int16_t*);
+   } DSP_PATH;
+
+static const DSP_PATH  simd_path =
+   { "simd",   simd_adc_dsp_init,   simd_adc_dsp_config_channel,
+     simd_adc_dsp_set_scaling,   simd_adc_dsp_process_frame,
+     simd_adc_dsp_get_results,   simd_adc_dsp_get_window_stats };
+
+static const DSP_PATH  scalar_path =
+   { "scalar", scalar_adc_dsp_init, scalar_adc_dsp_config_channel,
+     scalar_adc_dsp_set_scaling, scalar_adc_dsp_process_frame,
+     scalar_adc_dsp_get_results, scalar_adc_dsp_get_window_stats };
+
+            // a channel setup: mode + parm + flags, per channel
+typedef struct
+   {
+       int   mode;
+       long  parm;
+       int   flags;
+   } CHAN_CFG;
+
+#define  SCALE_COUNTS    4096          /* eng units = ADC counts (Q4 / 16) */
+
+
+//*****************************************************************************
+//  setup
+//
+//          Configure a stage from a channel table. Scaling is 0 .. 4096, so
+//          results are in ADC counts.
+//*****************************************************************************
+static void  setup (const DSP_PATH *p, ADC_DSP_STAGE *dsp,
+                    const CHAN_CFG *cfg, int num_channels)
+{
+    int   i;
+
+    CHECK_EQ (p->init (dsp, num_channels, 0L, 0L), 0);
+    for (i = 0;  i < num_channels;  i++)
+      { CHECK_EQ (p->config (dsp, i, cfg[i].mode, cfg[i].parm, cfg[i].flags), 0);
+        CHECK_EQ (p->scaling (dsp, i, 0, SCALE_COUNTS), 0);
+      }
+}
+
+
+//*****************************************************************************
+//  test_known_answers
+//*****************************************************************************
+static void  test_known_answers (const DSP_PATH *p)
+{
+    ADC_DSP_STAGE  dsp;
+    CHAN_CFG       cfg [2];
+    uint16_t       s [2];
+    int16_t        out [2];
+    int16_t        mn, mx, rms;
+    int            i, mask;
+
+    printf ("known answers, %s path\n", p->name);
+
+         // passthru, 0 .. 3300 mV
+    CHECK_EQ (p->init (&dsp, 1, 0L, 0L), 0);
+    CHECK_EQ (p->scaling (&dsp, 0, 0, 3300), 0);
+    s[0] = 4095;
+    CHECK_EQ (p->process (&dsp, s, 1), 1);
+    CHECK_EQ (p->results (&dsp, out), 1);
+    CHECK_EQ (out[0], 3299);
+    CHECK_EQ (p->results (&dsp, out), 0);       // mask is cleared by the read
+    s[0] = 2048;
+    p->process (&dsp, s, 1);
+    p->results (&dsp, out);
+    CHECK_EQ (out[0], 1650);
+
+         // boxcar x16 on a pair: one output per 16 frames, of the average
+    cfg[0].mode = cfg[1].mode = ADC_DSP_MODE_BOXCAR;
+    cfg[0].parm = cfg[1].parm = 4;
+    cfg[0].flags = cfg[1].flags = 0;
+    setup (p, &dsp, cfg, 2);
+    for (i = 0;  i < 16;  i++)
+      { s[0] = (uint16_t) (1000 + (i & 1));       // average 1000.5
+        s[1] = (uint16_t) (3000 - i);             // average 2992.5
+        mask = p->process (&dsp, s, 2);
+        CHECK_EQ (mask, (i == 15) ? 3 : 0);
+      }
+    p->results (&dsp, out);
+    CHECK_EQ (out[0], 1000);                      // Q4 1000.5 -> counts, truncated
+    CHECK_EQ (out[1], 2992);
+
+         // CIC order 3, R = 8: unity DC gain once the filter has settled
+    cfg[0].mode = cfg[1].mode = ADC_DSP_MODE_CIC;
+    cfg[0].parm = cfg[1].parm = 3;
+    cfg[0].flags = cfg[1].flags = ADC_DSP_CIC_ORDER_3;
+    setup (p, &dsp, cfg, 2);
+    s[0] = 1234;  s[1] = 77;
+    for (i = 0;  i < 8 * 4;  i++)
+      mask = p->process (&dsp, s, 2);
+    CHECK_EQ (mask, 3);
+    p->results (&dsp, out);
+    CHECK_EQ (out[0], 1234);
+    CHECK_EQ (out[1], 77);
+
+         // IIR alpha = 1/8: a step settles to the input
+    cfg[0].mode = cfg[1].mode = ADC_DSP_MODE_IIR_LOWPASS;
+    cfg[0].parm = cfg[1].parm = ADC_DSP_IIR_ALPHA_SHIFT(3);
+    cfg[0].flags = cfg[1].flags = 0;
+    setup (p, &dsp, cfg, 2);
+    s[0] = 2000;  s[1] = 4095;
+    CHECK_EQ (p->process (&dsp, s, 2), 3);        // output every sample
+    p->results (&dsp, out);
+    CHECK_EQ (out[0], 250);                       // first step: x / 8
+    for (i = 0;  i < 200;  i++)
+      p->process (&dsp, s, 2);
+    p->results (&dsp, out);
+    CHECK (out[0] >= 1999 && out[0] <= 2000);
+    CHECK (out[1] >= 4094 && out[1] <= 4095);
+
+         // window of 4: min / max / RMS
+    cfg[0].mode = cfg[1].mode = ADC_DSP_MODE_WINDOW_STATS;
+    cfg[0].parm = cfg[1].parm = 4;
+    setup (p, &dsp, cfg, 2);
+    for (i = 1;  i <= 4;  i++)
+      { s[0] = (uint16_t) (i * 100);              // 100 200 300 400
+        s[1] = (uint16_t) (4095 - i);
+        mask = p->process (&dsp, s, 2);
+      }
+    CHECK_EQ (mask, 3);
+    CHECK_EQ (p->window (&dsp, 0, &mn, &mx, &rms), 0);
+    CHECK_EQ (mn, 100);
+    CHECK_EQ (mx, 400);
+    CHECK_EQ (rms, 273);                          // sqrt(75000) = 273.86
+    CHECK_EQ (p->window (&dsp, 1, &mn, &mx, 0L), 0);
+    CHECK_EQ (mn, 4091);
+    CHECK_EQ (mx, 4094);
+}
+
+
+//*****************************************************************************
+//  test_bad_parms
+//*****************************************************************************
+static void  test_bad_parms (const DSP_PATH *p)
+{
+    ADC_DSP_STAGE  dsp;
+
+    CHECK_EQ (p->init (&dsp, 0, 0L, 0L), ERR_ADC_DSP_CHANNEL_OUT_OF_RANGE);
+    CHECK_EQ (p->init (&dsp, ADC_DSP_MAX_CHANNELS + 1, 0L, 0L),
+              ERR_ADC_DSP_CHANNEL_OUT_OF_RANGE);
+    CHECK_EQ (p->init (&dsp, 4, 0L, 0L), 0);
+    CHECK_EQ (p->config (&dsp, 4, ADC_DSP_MODE_BOXCAR, 2, 0),
+              ERR_ADC_DSP_CHANNEL_OUT_OF_RANGE);
+    CHECK_EQ (p->config (&dsp, 0, ADC_DSP_MODE_BOXCAR, 9, 0), ERR_ADC_DSP_INVALID_PARM);
+    CHECK_EQ (p->config (&dsp, 0, ADC_DSP_MODE_CIC, 7, 1), ERR_ADC_DSP_INVALID_PARM);
+    CHECK_EQ (p->config (&dsp, 0, ADC_DSP_MODE_IIR_LOWPASS, 0, 0),
+              ERR_ADC_DSP_INVALID_PARM);
+    CHECK_EQ (p->config (&dsp, 0, ADC_DSP_MODE_WINDOW_STATS, 129, 0),
+              ERR_ADC_DSP_INVALID_PARM);
+    CHECK_EQ (p->config (&dsp, 0, 9, 0, 0), ERR_ADC_DSP_INVALID_MODE);
+    CHECK_EQ (p->scaling (&dsp, 0, -30000, 30000), ERR_ADC_DSP_INVALID_PARM);
+    CHECK_EQ (p->window (&dsp, 0, 0L, 0L, 0L), ERR_ADC_DSP_INVALID_MODE);
+}
+
+
+//*****************************************************************************
+//  test_bit_exact
+//
+//          Run the same random 12-bit frames through both paths, and compare
+//          everything, every frame.
+//*****************************************************************************
+static const CHAN_CFG  mixes [][7] =
+   {     // all pairs SIMD eligible (last channel is odd one out)
+     { {1,4,0}, {1,4,0}, {3,1000,0}, {3,1000,0}, {4,100,0}, {4,100,0}, {1,4,0} },
+     { {1,8,0}, {1,8,0}, {1,0,0},    {1,0,0},    {4,128,0}, {4,128,0}, {3,1,0} },
+     { {3,32767,0}, {3,32767,0}, {4,2,0}, {4,2,0}, {1,5,0}, {1,5,0}, {4,3,0} },
+         // pairs that must fall back to scalar: mode or parm differ, CIC
+     { {1,4,0}, {1,3,0}, {3,1000,0}, {3,999,0}, {2,3,3}, {2,3,3}, {0,0,0} },
+     { {4,100,0}, {1,4,0}, {2,6,3}, {2,1,1}, {0,0,0}, {0,0,0}, {2,2,2} },
+   };
+
+static void  test_bit_exact (void)
+{
+    ADC_DSP_STAGE  a;
+    ADC_DSP_STAGE  b;
+    uint16_t       s [7];
+    int16_t        ra [7], rb [7];
+    int16_t        amin, amax, arms, bmin, bmax, brms;
+    int            m, f, c, ma, mb, diffs;
+
+    printf ("bit exactness, simd vs scalar\n");
+    srand (7);
+    for (m = 0;  m < (int) (sizeof(mixes) / sizeof(mixes[0]));  m++)
+      { setup (&simd_path,   &a, mixes[m], 7);
+        setup (&scalar_path, &b, mixes[m], 7);
+        if (m < 3)
+           CHECK_EQ (a.simd_pair_mask, 0x07);     // 3 SIMD pairs in use
+           else CHECK (a.simd_pair_mask != 0x07);
+        diffs = 0;
+        for (f = 0;  f < 20000;  f++)
+          { for (c = 0;  c < 7;  c++)
+              s[c] = (f & 0x400) ? (uint16_t) (rand() & 0x0FFF)     // noise
+                                 : (uint16_t) ((f & 0x40) ? 4095 : 0); // square
+            ma = simd_path.process (&a, s, 7);
+            mb = scalar_path.process (&b, s, 7);
+            if (ma != mb)
+               diffs++;
+            simd_path.results (&a, ra);
+            scalar_path.results (&b, rb);
+            if (memcmp (ra, rb, sizeof(ra)) != 0)
+               diffs++;
+            for (c = 0;  c < 7;  c++)
+              if (mixes[m][c].mode == ADC_DSP_MODE_WINDOW_STATS)
+                 { simd_path.window (&a, c, &amin, &amax, &arms);
+                   scalar_path.window (&b, c, &bmin, &bmax, &brms);
+                   if (amin != bmin || amax != bmax || arms != brms)
+                      diffs++;
+                 }
+          }
+        CHECK_EQ (diffs, 0);
+        CHECK_EQ (a.frames_processed, 20000);
+      }
+}
+
+
+//*****************************************************************************
+//  bench
+//
+//          nsec per 8 channel frame, per mode, for each path. On the host the
+//          SIMD intrinsics are C functions, so this compares the two code
+//          paths' work, not Cortex-M4 cycles.
+//*****************************************************************************
+static void  bench (void)
+{
+    static const char  *mode_names [] = { "passthru", "boxcar x16", "cic3 x8",
+                                          "iir", "window 64" };
+    static const long  mode_parms [] = { 0, 4, 3, 4096, 64 };
+    static uint16_t    frames [1024][8];
+    ADC_DSP_STAGE      dsp;
+    CHAN_CFG           cfg [8];
+    const DSP_PATH     *paths [2] = { &simd_path, &scalar_path };
+    uint64_t           t0, t1;
+    int                mode, p, c, f, rounds;
+    volatile int       sink = 0;
+
+    for (f = 0;  f < 1024;  f++)
+      for (c = 0;  c < 8;  c++)
+        frames[f][c] = (uint16_t) (rand() & 0x0FFF);
+
+    printf ("benchmark (host nsec per 8 channel frame)\n");
+    for (mode = 0;  mode <= ADC_DSP_MODE_WINDOW_STATS;  mode++)
+      { printf ("  %-12s", mode_names[mode]);
+        for (p = 0;  p < 2;  p++)
+          { for (c = 0;  c < 8;  c++)
+              { cfg[c].mode  = mode;
+                cfg[c].parm  = mode_parms[mode];
+                cfg[c].flags = (mode == ADC_DSP_MODE_CIC) ? ADC_DSP_CIC_ORDER_3 : 0;
+              }
+            setup (paths[p], &dsp, cfg, 8);
+            t0 = host_nsec();
+            for (rounds = 0;  rounds < 200;  rounds++)
+              for (f = 0;  f < 1024;  f++)
+                sink += paths[p]->process (&dsp, frames[f], 8);
+            t1 = host_nsec();
+            printf ("  %s %6.1f", paths[p]->name,
+                    (double) (t1 - t0) / (200.0 * 1024.0));
+          }
+        printf ("\n");
+      }
+    (void) sink;
+}
+
+
+int  main (void)
+{
+    test_known_answers (&simd_path);
+    test_known_answers (&scalar_path);
+    test_bad_parms (&simd_path);
+    test_bit_exact ();
+    bench ();
+    return (host_test_done ("test_adc_dsp_filter"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,336 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_bdc_motor.c
+//
+//
+//  Host test for common/bdc_motor.c, closing the loops around a simulated
+//  brushed DC motor, H bridge and quadrature encoder.
+//
+//  The plant: R = 2 ohm, L = 1 mH, Kt = Ke = 0.02, J = 1e-5 kg m^2, 12 V
+//  bus, 2000 counts / rev on a 16 bit encoder counter, +/-5 A current
+//  sense on a 12 bit ADC. The loops tick at 10 kHz, velocity every 10
+//  ticks.
+//
+//    - velocity step, without and with the cascaded current loop
+//    - position step of 1 rev, without and with the current loop, and
+//      with a constant load torque (integrator removes the offset)
+//    - many revs: the 16 bit encoder wraps, position stays exact
+//    - modes: OFF, DUTY with duty_max, CURRENT without current sensing,
+//      mode change applied by the next step
+//    - PID anti-windup
+//    - benchmark: bdc_motor_step() ns per call, all 3 loops
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "bdc_motor.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define  PLANT_R       2.0              // ohm
+#define  PLANT_L       1e-3             // H
+#define  PLANT_KT      0.02             // Nm / A
+#define  PLANT_KE      0.02             // V / (rad/s)
+#define  PLANT_J       1e-5             // kg m^2
+#define  PLANT_B       1e-6             // viscous friction
+#define  VBUS          12.0
+#define  ENC_CPR       2000.0           // counts / rev
+#define  I_FULL_SCALE  5.0              // A at ADC full scale
+#define  TS            (1.0 / 10000)    // loop tick
+#define  SUB_STEPS     20
+
+typedef struct                          /* simulated motor */
+   {
+       double   i;                      // A
+       double   w;                      // rad/s
+       double   th;                     // rad
+       double   load;                   // Nm
+   } PLANT;
+
+typedef struct                          /* step response */
+   {
+       double   rise_ms;                // to 90 %
+       double   overshoot;              // % of ref
+       double   settle_ms;              // to within 2 %, and stays
+       double   ss_err;                 // mean |error|, last 100 msec
+   } STEP_RESULT;
+
+
+static void  plant_run (PLANT *p, int16_t duty)
+{
+    double  v;
+    double  h;
+    int     k;
+
+    v = duty / 32767.0 * VBUS;
+    h = TS / SUB_STEPS;
+    for (k = 0;  k < SUB_STEPS;  k++)
+      { p->i  += (v - PLANT_R * p->i - PLANT_KE * p->w) / PLANT_L * h;
+        p->w  += (PLANT_KT * p->i - PLANT_B * p->w - p->load) / PLANT_J * h;
+        p->th += p->w * h;
+      }
+}
+
+static uint32_t  plant_encoder (PLANT *p)
+{
+    return ((uint32_t) (int32_t) floor (p->th / (2 * M_PI) * ENC_CPR) & 0xFFFF);
+}
+
+static int16_t  plant_current (PLANT *p)
+{
+    long  code;
+
+    code = lround (p->i / I_FULL_SCALE * 2048);
+    if (code > 2047)
+       code = 2047;
+    if (code < -2048)
+       code = -2048;
+    return ((int16_t) (code << 4));
+}
+
+static void  motor_setup (BDC_MOTOR *m, int has_current)
+{
+    bdc_motor_init (m, 16, 10, 1, has_current);
+    bdc_motor_set_gains (&m->pos_pid, 65536, 0, 0, 4096, 25600);
+    if (has_current)
+       { bdc_motor_set_gains (&m->vel_pid, 4096 * 6, 4096 / 5, 0, 0, 32767);
+         bdc_motor_set_gains (&m->cur_pid, 4096 * 2 / 3, 4096 / 12, 0, 276, 32767);
+       }
+       else bdc_motor_set_gains (&m->vel_pid, 4096 * 4, 328, 0, 2760, 32767);
+}
+
+static void  run_step (int has_current, int mode, int32_t ref, double load,
+                       STEP_RESULT *res)
+{
+    BDC_MOTOR  m;
+    PLANT      p;
+    double     y;
+    double     peak;
+    double     err;
+    int        k;
+
+    memset (&p, 0, sizeof(p));
+    p.load = load;
+    motor_setup (&m, has_current);
+    bdc_motor_zero (&m, plant_encoder (&p));
+    bdc_motor_set_mode (&m, mode);
+    if (mode == BDC_MODE_POSITION)
+       bdc_motor_set_position (&m, ref, 0);
+       else bdc_motor_set_velocity (&m, ref);
+
+    peak = 0;
+    err  = 0;
+    res->rise_ms = res->settle_ms = -1;
+    for (k = 0;  k < 10000;  k++)
+      { if (has_current)
+           m.current = plant_current (&p);
+        plant_run (&p, bdc_motor_step (&m, plant_encoder (&p)));
+        y = (mode == BDC_MODE_POSITION) ? m.position : m.velocity;
+        if (y > peak)
+           peak = y;
+        if (res->rise_ms < 0  &&  y >= 0.9 * ref)
+           res->rise_ms = k * TS * 1e3;
+        if (fabs (y - ref) > 0.02 * ref)
+           res->settle_ms = -1;
+           else if (res->settle_ms < 0)
+                   res->settle_ms = k * TS * 1e3;
+        if (k >= 9000)
+           err += fabs (y - ref);
+      }
+    res->overshoot = (peak - ref) / ref * 100;
+    res->ss_err    = err / 1000;
+}
+
+
+//*****************************************************************************
+//  test_step_responses
+//
+//          velocity ref 12800 = 50 counts / msec (1500 rpm)
+//*****************************************************************************
+static void  test_step_responses (void)
+{
+    static const struct
+       {
+           const char  *name;
+           int         has_current;
+           int         mode;
+           int32_t     ref;
+           double      load;
+           double      max_settle_ms;
+           double      max_ss_err;
+       } cases [] =
+       {
+         { "velocity step",                0, BDC_MODE_VELOCITY, 12800, 0,    100, 128 },
+         { "velocity step (current loop)", 1, BDC_MODE_VELOCITY, 12800, 0,    100, 128 },
+         { "position 1 rev",               0, BDC_MODE_POSITION, 2000,  0,    200, 0.5 },
+         { "position 1 rev (current loop)",1, BDC_MODE_POSITION, 2000,  0,    200, 0.5 },
+         { "position 1 rev + load torque", 0, BDC_MODE_POSITION, 2000,  0.01, 200, 0.5 },
+       };
+    STEP_RESULT  res;
+    int          c;
+
+    for (c = 0;  c < (int) (sizeof(cases) / sizeof(cases[0]));  c++)
+      { run_step (cases[c].has_current, cases[c].mode, cases[c].ref, cases[c].load, &res);
+        printf ("%-30s rise %5.1f ms  overshoot %4.1f %%  settle %6.1f ms  |ss err| %.2f\n",
+                cases[c].name, res.rise_ms, res.overshoot, res.settle_ms, res.ss_err);
+        CHECK (res.rise_ms > 0  &&  res.rise_ms < 60);
+        CHECK (res.overshoot < 10);
+        CHECK (res.settle_ms > 0  &&  res.settle_ms < cases[c].max_settle_ms);
+        CHECK (res.ss_err <= cases[c].max_ss_err);
+      }
+}
+
+
+//*****************************************************************************
+//  test_encoder_wrap
+//
+//          4 seconds at -100 counts / msec: about 6 wraps of the 16 bit
+//          counter. The extended position must track the plant exactly
+//          (to within the one tick the encoder is read ahead of the plant).
+//*****************************************************************************
+static void  test_encoder_wrap (void)
+{
+    BDC_MOTOR  m;
+    PLANT      p;
+    double     plant_pos;
+    int        k;
+
+    memset (&p, 0, sizeof(p));
+    motor_setup (&m, 0);
+    bdc_motor_zero (&m, plant_encoder (&p));
+    bdc_motor_set_mode (&m, BDC_MODE_VELOCITY);
+    bdc_motor_set_velocity (&m, -25600);
+    for (k = 0;  k < 40000;  k++)
+      plant_run (&p, bdc_motor_step (&m, plant_encoder (&p)));
+    plant_pos = floor (p.th / (2 * M_PI) * ENC_CPR);
+    printf ("encoder wrap: position %ld, plant %.0f counts\n", (long) m.position, plant_pos);
+    CHECK (m.position < -5 * 65536);
+    CHECK (fabs (m.position - plant_pos) <= 15);
+    bdc_motor_step (&m, plant_encoder (&p));    // catch up to the plant
+    CHECK_EQ (m.position, (long) plant_pos);
+}
+
+
+//*****************************************************************************
+//  test_modes
+//*****************************************************************************
+static void  test_modes (void)
+{
+    BDC_MOTOR  m;
+
+    motor_setup (&m, 0);
+    bdc_motor_zero (&m, 100);
+    CHECK_EQ (m.mode, BDC_MODE_OFF);
+    bdc_motor_set_duty (&m, 20000);
+    CHECK_EQ (bdc_motor_step (&m, 100), 0);     // OFF: no output
+
+    bdc_motor_set_mode (&m, BDC_MODE_DUTY);
+    CHECK_EQ (m.mode, BDC_MODE_OFF);            // not until the next step
+    CHECK_EQ (bdc_motor_step (&m, 100), 20000);
+    CHECK_EQ (m.mode, BDC_MODE_DUTY);
+    m.duty_max = 16000;
+    CHECK_EQ (bdc_motor_step (&m, 100), 16000);
+    bdc_motor_set_duty (&m, -30000);
+    CHECK_EQ (bdc_motor_step (&m, 100), -16000);
+
+       // no current sensing: CURRENT falls back to DUTY
+    bdc_motor_set_mode (&m, BDC_MODE_CURRENT);
+    bdc_motor_step (&m, 100);
+    CHECK_EQ (m.mode, BDC_MODE_DUTY);
+
+       // small encoder moves in both directions across 0 / 0xFFFF
+    bdc_motor_zero (&m, 2);
+    bdc_motor_step (&m, 0xFFFE);
+    CHECK_EQ (m.position, -4);
+    bdc_motor_step (&m, 5);
+    CHECK_EQ (m.position, 3);
+    CHECK_EQ (m.steps, 7);
+}
+
+
+//*****************************************************************************
+//  test_pid_windup
+//*****************************************************************************
+static void  test_pid_windup (void)
+{
+    BDC_PID  pid;
+    int32_t  out;
+    int      k;
+
+    memset (&pid, 0, sizeof(pid));
+    bdc_motor_set_gains (&pid, 4096, 410, 0, 0, 1000);
+    bdc_pid_reset (&pid, 0);
+    for (k = 0;  k < 10000;  k++)
+      out = bdc_pid_run (&pid, 5000, 0, 0);     // far into saturation
+    CHECK_EQ (out, 1000);
+    CHECK (pid.integ <= (1000LL << 12));
+    out = bdc_pid_run (&pid, 0, 0, 0);          // error gone: output drops at once
+    CHECK (out < 1000);
+    out = bdc_pid_run (&pid, -5000, 0, 0);
+    CHECK_EQ (out, -1000);
+}
+
+
+//*****************************************************************************
+//  bench
+//*****************************************************************************
+static void  bench (void)
+{
+    BDC_MOTOR  m;
+    uint64_t   t0;
+    uint32_t   sum;
+    double     ns;
+    long       k;
+
+    motor_setup (&m, 1);
+    bdc_motor_set_mode (&m, BDC_MODE_POSITION);
+    bdc_motor_set_position (&m, 100000, 0);
+    sum = 0;
+    t0 = host_nsec ();
+    for (k = 0;  k < 20000000;  k++)
+      { m.vel_tick = 9;                         // outer loops every call
+        m.current  = (int16_t) k;
+        sum += (uint16_t) bdc_motor_step (&m, (uint32_t) (k * 3));
+      }
+    ns = (host_nsec () - t0) / 2e7;
+    printf ("benchmark: bdc_motor_step (all 3 loops) %.1f ns per call on the host"
+            " (checksum %u)\n", ns, (unsigned) sum);
+    CHECK_EQ (m.steps, 20000000);
+}
+
+
+int  main (void)
+{
+    test_step_responses ();
+    test_encoder_wrap ();
+    test_modes ();
+    test_pid_windup ();
+    bench ();
+    return (host_test_done ("test_bdc_motor"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,400 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_ble_beacon.c
+//
+//
+//  Host test for ble_drivers/STM32_BlueNRG/ble_beacon.c (advertising data
+//  encode/decode, and the observer's node table).
+//
+//    - encode / decode round trip, paged readings, with and without the
+//      Flags AD structure, and the 31 byte advertising data limit
+//    - malformed, truncated and foreign advertising data
+//    - 500 nodes into a 512 entry table: repeats counted as duplicates,
+//      seq # gaps counted as missed pages, node restart
+//    - a full table evicts the node silent the longest
+//    - benchmark: advertisements per second, decode + table update
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "ble_beacon.h"
+#include "host_test.h"
+#include <stdlib.h>
+
+#define  NUM_NODES     500
+#define  TABLE_SIZE    512
+
+static BEACON_NODE  nodes [TABLE_SIZE];
+
+
+//*****************************************************************************
+//  test_round_trip
+//*****************************************************************************
+static void  test_round_trip (void)
+{
+    BEACON_READING  rdg [14];
+    BEACON_TX       tx;
+    BEACON_MSG      msg;
+    BEACON_MSG      out;
+    uint8_t         adv [BEACON_ADV_MAX_LEN];
+    int             i;
+    int             k;
+    int             len;
+
+    for (i = 0;  i < 14;  i++)
+      { rdg[i].id    = (uint8_t) i;
+        rdg[i].value = (uint16_t) (1000 + i);
+      }
+    CHECK_EQ (beacon_tx_init (&tx, 0x1234, rdg, 14), 0);
+    tx.digital_bits = 0xA5;
+
+       // 14 readings go out as pages of 6, 6, 2, then start over
+    for (k = 0;  k < 6;  k++)
+      { len = beacon_tx_next (&tx, adv, sizeof(adv), BEACON_ADD_FLAGS_AD);
+        CHECK (len > 0  &&  len <= BEACON_ADV_MAX_LEN);
+        CHECK_EQ (adv[0], 2);                   // Flags AD first
+        CHECK_EQ (adv[1], AD_TYPE_FLAGS_VALUE);
+        CHECK_EQ (beacon_decode (adv, len, &msg), 0);
+        CHECK_EQ (msg.node_id, 0x1234);
+        CHECK_EQ (msg.seq, k);
+        CHECK_EQ (msg.page, k % 3);
+        CHECK_EQ (msg.digital_bits, 0xA5);
+        CHECK_EQ (msg.num_readings, (k % 3 == 2) ? 2 : 6);
+        for (i = 0;  i < msg.num_readings;  i++)
+          { CHECK_EQ (msg.readings[i].id, 6 * (k % 3) + i);
+            CHECK_EQ (msg.readings[i].value, 1000 + 6 * (k % 3) + i);
+          }
+      }
+
+       // a full page without the Flags AD is 9 + 6*3 = 27 bytes
+    CHECK_EQ (beacon_tx_init (&tx, 1, rdg, 6), 0);
+    CHECK_EQ (beacon_tx_next (&tx, adv, 27, 0), 27);
+    CHECK_EQ (beacon_tx_next (&tx, adv, 26, 0), BEACON_ERR_BAD_LENGTH);
+    CHECK_EQ (beacon_tx_next (&tx, adv, 29, BEACON_ADD_FLAGS_AD), BEACON_ERR_BAD_LENGTH);
+
+       // no readings: digital bits only
+    CHECK_EQ (beacon_tx_init (&tx, 7, 0L, 0), 0);
+    len = beacon_tx_next (&tx, adv, sizeof(adv), 0);
+    CHECK_EQ (len, BEACON_HDR_LEN);
+    CHECK_EQ (beacon_decode (adv, len, &msg), 0);
+    CHECK_EQ (msg.num_readings, 0);
+
+       // encode extremes: page 15, 0xFFFF values
+    memset (&msg, 0, sizeof(msg));
+    msg.node_id      = 0xFFFE;
+    msg.page         = BEACON_MAX_PAGES - 1;
+    msg.seq          = 255;
+    msg.num_readings = BEACON_MAX_READINGS;
+    for (i = 0;  i < BEACON_MAX_READINGS;  i++)
+      { msg.readings[i].id    = (uint8_t) (BEACON_MAX_IDS - 1 - i);
+        msg.readings[i].value = 0xFFFF;
+      }
+    len = beacon_encode (&msg, adv, sizeof(adv), BEACON_ADD_FLAGS_AD);
+    CHECK_EQ (len, 3 + BEACON_HDR_LEN + 3 * BEACON_MAX_READINGS);
+    CHECK_EQ (beacon_decode (adv, len, &out), 0);
+    CHECK (memcmp (&out.readings, &msg.readings, sizeof(msg.readings)) == 0);
+    CHECK_EQ (out.page, BEACON_MAX_PAGES - 1);
+    CHECK_EQ (out.seq, 255);
+
+       // parameter checks
+    msg.page = BEACON_MAX_PAGES;
+    CHECK_EQ (beacon_encode (&msg, adv, sizeof(adv), 0), BEACON_ERR_INVALID_PARM);
+    msg.page = 0;
+    msg.num_readings = BEACON_MAX_READINGS + 1;
+    CHECK_EQ (beacon_encode (&msg, adv, sizeof(adv), 0), BEACON_ERR_INVALID_PARM);
+    CHECK_EQ (beacon_tx_init (&tx, 1, rdg, -1), BEACON_ERR_INVALID_PARM);
+    CHECK_EQ (beacon_tx_init (&tx, 1, 0L, 3), BEACON_ERR_INVALID_PARM);
+    CHECK_EQ (beacon_tx_init (&tx, 1, rdg,
+                              BEACON_MAX_READINGS * BEACON_MAX_PAGES + 1),
+              BEACON_ERR_INVALID_PARM);
+    CHECK_EQ (beacon_decode (0L, 10, &msg), BEACON_ERR_INVALID_PARM);
+}
+
+
+//*****************************************************************************
+//  test_malformed
+//*****************************************************************************
+static void  test_malformed (void)
+{
+    static uint8_t  overrun [] = { 2, 1, 6,  20, 0xFF, 0xFF, 0xFF };
+    static uint8_t  foreign [] = { 2, 1, 6,  5, 0xFF, 0x4C, 0x00, 1, 2 };
+    static uint8_t  odd_len [] = { 9, 0xFF, 0xFF, 0xFF, 0x10, 1, 0, 0, 0, 7 };
+    static uint8_t  short_mfr [] = { 4, 0xFF, 0xFF, 0xFF, 0x10 };
+    static uint8_t  old_ver [] = { 8, 0xFF, 0xFF, 0xFF, 0x20, 1, 0, 0, 0 };
+    static uint8_t  padded [] = { 8, 0xFF, 0xFF, 0xFF, 0x13, 0x34, 0x12, 9, 1,
+                                  0, 0, 0 };
+    static uint8_t  after_zero [] = { 2, 1, 6,  0,  8, 0xFF, 0xFF, 0xFF, 0x10,
+                                      1, 0, 0, 0 };
+    BEACON_MSG      msg;
+    uint8_t         adv [BEACON_ADV_MAX_LEN];
+    int             len;
+    int             cut;
+    int             rc;
+    int             bad;
+
+    CHECK_EQ (beacon_decode (overrun, sizeof(overrun), &msg), BEACON_ERR_BAD_LENGTH);
+    CHECK_EQ (beacon_decode (foreign, sizeof(foreign), &msg), BEACON_ERR_NOT_BEACON);
+    CHECK_EQ (beacon_decode (odd_len, sizeof(odd_len), &msg), BEACON_ERR_BAD_LENGTH);
+    CHECK_EQ (beacon_decode (short_mfr, sizeof(short_mfr), &msg), BEACON_ERR_NOT_BEACON);
+    CHECK_EQ (beacon_decode (old_ver, sizeof(old_ver), &msg), BEACON_ERR_NOT_BEACON);
+    CHECK_EQ (beacon_decode (after_zero, sizeof(after_zero), &msg), BEACON_ERR_NOT_BEACON);
+    CHECK_EQ (beacon_decode (adv, 0, &msg), BEACON_ERR_NOT_BEACON);
+
+       // zero padding after the AD structures is ignored
+    CHECK_EQ (beacon_decode (padded, sizeof(padded), &msg), 0);
+    CHECK_EQ (msg.node_id, 0x1234);
+    CHECK_EQ (msg.page, 3);
+    CHECK_EQ (msg.seq, 9);
+
+       // every truncation of a valid advertisement is rejected, never read past
+    memset (&msg, 0, sizeof(msg));
+    msg.node_id = 42;
+    msg.num_readings = 4;
+    len = beacon_encode (&msg, adv, sizeof(adv), BEACON_ADD_FLAGS_AD);
+    CHECK (len > 0);
+    bad = 0;
+    for (cut = 1;  cut < len;  cut++)
+      { rc = beacon_decode (adv, cut, &msg);
+        if (rc != BEACON_ERR_BAD_LENGTH  &&  rc != BEACON_ERR_NOT_BEACON)
+           bad++;
+      }
+    CHECK_EQ (bad, 0);
+
+       // random advertising data: any result, but no crash, and a decoded
+       // Beacon always has a sane reading count
+    srand (1);
+    bad = 0;
+    for (cut = 0;  cut < 200000;  cut++)
+      { len = rand() % (BEACON_ADV_MAX_LEN + 1);
+        for (rc = 0;  rc < len;  rc++)
+          adv[rc] = (uint8_t) rand();
+        if (len > 4  &&  (cut & 1))
+           { adv[1] = AD_TYPE_MANUF_SPECIFIC;   // bias towards our header
+             adv[2] = adv[3] = 0xFF;
+             adv[4] = (uint8_t) ((BEACON_VERSION << 4) | (adv[4] & 0x0F));
+           }
+        rc = beacon_decode (adv, len, &msg);
+        if (rc == 0  &&  msg.num_readings > BEACON_MAX_READINGS)
+           bad++;
+      }
+    CHECK_EQ (bad, 0);
+}
+
+
+//*****************************************************************************
+//  test_table
+//
+//          500 nodes, each heard 3 times per page (every advertising event
+//          is repeated on the 3 channels). Every third node skips a seq #
+//          each round, so shows 1 missed page per round.
+//*****************************************************************************
+static void  test_table (void)
+{
+    BEACON_TABLE  tbl;
+    BEACON_NODE   *node;
+    BEACON_MSG    msg;
+    uint32_t      now;
+    int           round;
+    int           id;
+    int           rep;
+    int           rc;
+    int           new_nodes;
+    int           news;
+    int           dups;
+    int           bad;
+
+    CHECK_EQ (beacon_table_init (&tbl, nodes, 500), BEACON_ERR_INVALID_PARM);
+    CHECK_EQ (beacon_table_init (&tbl, nodes, 0), BEACON_ERR_INVALID_PARM);
+    CHECK_EQ (beacon_table_init (&tbl, nodes, TABLE_SIZE), 0);
+
+    now = 0;
+    new_nodes = news = dups = 0;
+    for (round = 0;  round < 10;  round++)
+      for (id = 0;  id < NUM_NODES;  id++)
+        { memset (&msg, 0, sizeof(msg));
+          msg.node_id = (uint16_t) (id * 37 + 5);
+          msg.seq     = (uint8_t) (round * ((id % 3 == 0) ? 2 : 1));
+          msg.num_readings = 1;
+          msg.readings[0].id    = 3;
+          msg.readings[0].value = (uint16_t) round;
+          for (rep = 0;  rep < 3;  rep++)
+            { rc = beacon_table_update (&tbl, &msg, -60 - rep, now++);
+              if (rc == BEACON_NEW_NODE)
+                 new_nodes++;
+                 else if (rc == BEACON_NEW)
+                         news++;
+                 else if (rc == BEACON_DUPLICATE)
+                         dups++;
+            }
+        }
+    CHECK_EQ (new_nodes, NUM_NODES);
+    CHECK_EQ (news, 9 * NUM_NODES);
+    CHECK_EQ (dups, 2 * 10 * NUM_NODES);
+    CHECK_EQ (tbl.num_nodes, NUM_NODES);
+    CHECK_EQ (tbl.evictions, 0);
+
+    bad = 0;
+    for (id = 0;  id < NUM_NODES;  id++)
+      { node = beacon_table_find (&tbl, (uint16_t) (id * 37 + 5));
+        if (node == 0L  ||  node->pages_rcvd != 10  ||  node->duplicates != 20
+           || node->pages_missed != (uint32_t) ((id % 3 == 0) ? 9 : 0)
+           || node->values[3] != 9  ||  node->value_mask != (1UL << 3)
+           || node->rssi != -62)
+           bad++;
+      }
+    CHECK_EQ (bad, 0);
+    CHECK (beacon_table_find (&tbl, 6) == 0L);        // never heard
+
+       // node restart: seq # goes backwards, re-syncs without a miss count
+    node = beacon_table_find (&tbl, 5);
+    memset (&msg, 0, sizeof(msg));
+    msg.node_id = 5;
+    msg.seq     = 3;
+    CHECK_EQ (beacon_table_update (&tbl, &msg, -50, now++), BEACON_NEW);
+    CHECK_EQ (node->pages_missed, 9);
+    msg.seq = 4;
+    CHECK_EQ (beacon_table_update (&tbl, &msg, -50, now++), BEACON_NEW);
+    CHECK_EQ (node->pages_missed, 9);
+
+       // reading ids outside the tracked range are ignored
+    msg.seq = 5;
+    msg.num_readings = 1;
+    msg.readings[0].id    = BEACON_MAX_IDS;
+    msg.readings[0].value = 77;
+    CHECK_EQ (beacon_table_update (&tbl, &msg, -50, now++), BEACON_NEW);
+    CHECK_EQ (node->value_mask, 1UL << 3);
+}
+
+
+//*****************************************************************************
+//  test_eviction
+//*****************************************************************************
+static void  test_eviction (void)
+{
+    BEACON_NODE   small [8];
+    BEACON_TABLE  tbl;
+    BEACON_MSG    msg;
+    int           id;
+
+    CHECK_EQ (beacon_table_init (&tbl, small, 8), 0);
+    memset (&msg, 0, sizeof(msg));
+    for (id = 0;  id < 20;  id++)
+      { msg.node_id = (uint16_t) id;
+        CHECK_EQ (beacon_table_update (&tbl, &msg, 0, (uint32_t) id), BEACON_NEW_NODE);
+      }
+    CHECK_EQ (tbl.evictions, 12);
+    CHECK_EQ (tbl.num_nodes, 8);
+    for (id = 12;  id < 20;  id++)
+      CHECK (beacon_table_find (&tbl, (uint16_t) id) != 0L);
+    for (id = 0;  id < 12;  id++)
+      CHECK (beacon_table_find (&tbl, (uint16_t) id) == 0L);
+
+       // a node heard again stays; the silent one goes
+    msg.node_id = 12;
+    msg.seq     = 1;
+    CHECK_EQ (beacon_table_update (&tbl, &msg, 0, 100), BEACON_NEW);
+    msg.node_id = 99;
+    msg.seq     = 0;
+    CHECK_EQ (beacon_table_update (&tbl, &msg, 0, 101), BEACON_NEW_NODE);
+    CHECK (beacon_table_find (&tbl, 12) != 0L);
+    CHECK (beacon_table_find (&tbl, 13) == 0L);
+    CHECK (beacon_table_find (&tbl, 99) != 0L);
+
+       // the ms timestamp wraps: order is by elapsed time, not raw value
+    CHECK_EQ (beacon_table_init (&tbl, small, 8), 0);
+    for (id = 0;  id < 8;  id++)
+      { msg.node_id = (uint16_t) id;
+        beacon_table_update (&tbl, &msg, 0, 0xFFFFFFF8UL + (uint32_t) id);
+      }
+    msg.node_id = 50;
+    CHECK_EQ (beacon_table_update (&tbl, &msg, 0, 3), BEACON_NEW_NODE);
+    CHECK (beacon_table_find (&tbl, 0) == 0L);        // oldest, before wrap
+    CHECK (beacon_table_find (&tbl, 7) != 0L);
+}
+
+
+//*****************************************************************************
+//  bench
+//
+//          Observer cost per received advertisement: decode + table update,
+//          500 nodes, 3 repeats of each page. (Includes building each
+//          page once per round, as the nodes would.)
+//*****************************************************************************
+static void  bench (void)
+{
+    static uint8_t  advs [NUM_NODES][BEACON_ADV_MAX_LEN];
+    static int      lens [NUM_NODES];
+    BEACON_READING  rdg [6];
+    BEACON_TABLE    tbl;
+    BEACON_TX       tx;
+    BEACON_MSG      msg;
+    uint64_t        t0;
+    double          secs;
+    long            count;
+    int             round;
+    int             id;
+    int             i;
+
+    for (i = 0;  i < 6;  i++)
+      { rdg[i].id = (uint8_t) i;
+        rdg[i].value = (uint16_t) (i * 100);
+      }
+    beacon_table_init (&tbl, nodes, TABLE_SIZE);
+    count = 0;
+    t0 = host_nsec ();
+    for (round = 0;  round < 200;  round++)
+      { for (id = 0;  id < NUM_NODES;  id++)
+          { beacon_tx_init (&tx, (uint16_t) (id * 37 + 5), rdg, 6);
+            tx.seq = (uint8_t) round;
+            lens[id] = beacon_tx_next (&tx, advs[id], BEACON_ADV_MAX_LEN,
+                                       BEACON_ADD_FLAGS_AD);
+          }
+        for (i = 0;  i < 3;  i++)
+          for (id = 0;  id < NUM_NODES;  id++)
+            { if (beacon_decode (advs[id], lens[id], &msg) == 0)
+                 beacon_table_update (&tbl, &msg, -70, (uint32_t) count);
+              count++;
+            }
+      }
+    secs = (host_nsec () - t0) / 1e9;
+    printf ("benchmark: %ld advertisements (500 nodes), %.0f ns each, %.2f M/s\n",
+            count, secs * 1e9 / count, count / secs / 1e6);
+    CHECK_EQ (tbl.num_nodes, NUM_NODES);
+    CHECK_EQ (tbl.evictions, 0);
+}
+
+
+int  main (void)
+{
+    test_round_trip ();
+    test_malformed ();
+    test_table ();
+    test_eviction ();
+    bench ();
+    return (host_test_done ("test_ble_beacon"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,427 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_ble_stream.c
+//
+//
+//  Host test for ble_drivers/STM32_BlueNRG/ble_stream.c, against a
+//  simulated BlueNRG / HCI peer.
+//
+//  The simulated radio has a pool of TX buffers. Each connection interval
+//  the link layer sends up to N packets, frees their buffers, and raises a
+//  TX-Pool-Available event. Segments can be dropped on the way.
+//
+//    - round trip of SDUs at and around the segment boundaries, for the
+//      default 20 byte and the 244 byte (LE data length) segment sizes
+//    - flow control: segments queue until the pool is full, and resume on
+//      the pool available event
+//    - segment loss: no corrupted or out of order SDU is ever delivered
+//    - RX ring full (App not reading): SDUs are dropped whole
+//    - parameter / error returns, reset
+//    - benchmark: SDU throughput vs packets per connection interval
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "ble_stream.h"
+#include "host_test.h"
+#include <stdlib.h>
+
+#define  POOL_SIZE     8                // BlueNRG TX buffers
+#define  CI_MSEC       7.5              // connection interval
+
+typedef struct                          /* simulated radio + link */
+   {
+       uint8_t      q [POOL_SIZE][BLE_STREAM_MAX_SEG_SIZE];
+       int          q_len [POOL_SIZE];
+       int          q_head;
+       int          q_count;
+       int          per_ci;             // packets sent per connection interval
+       int          lose_every;         // drop every Nth segment (0 = none)
+       int          fail;               // 1 = radio returns an error
+       uint32_t     segs;               // # segments sent over the air
+       BLE_STREAM   *peer;              // receiving end
+   } SIM_LINK;
+
+static BLE_STREAM  strm_a;              // sender
+static BLE_STREAM  strm_b;              // receiver
+
+
+static int  sim_tx (void *tx_parm, uint8_t *seg, int seg_len)
+{
+    SIM_LINK  *link;
+    int       i;
+
+    link = (SIM_LINK*) tx_parm;
+    if (link->fail)
+       return (-5);
+    if (link->q_count == POOL_SIZE)
+       return (BLE_STREAM_TX_BUSY);
+    i = (link->q_head + link->q_count) % POOL_SIZE;
+    memcpy (link->q[i], seg, seg_len);
+    link->q_len[i] = seg_len;
+    link->q_count++;
+    return (BLE_STREAM_TX_OK);
+}
+
+static int  sim_tx_unused (void *tx_parm, uint8_t *seg, int seg_len)
+{
+    (void) tx_parm;  (void) seg;  (void) seg_len;
+    return (BLE_STREAM_TX_OK);
+}
+
+       // one connection interval: send up to per_ci packets, free buffers
+static void  sim_conn_interval (SIM_LINK *link, BLE_STREAM *sender)
+{
+    int   n;
+
+    for (n = 0;  link->q_count > 0 && n < link->per_ci;  n++)
+      { link->segs++;
+        if (link->lose_every == 0  ||  (link->segs % link->lose_every) != 0)
+           ble_stream_rx_segment (link->peer, link->q[link->q_head],
+                                  link->q_len[link->q_head]);
+        link->q_head = (link->q_head + 1) % POOL_SIZE;
+        link->q_count--;
+      }
+    if (n > 0)
+       ble_stream_tx_pool_available (sender);
+}
+
+static void  sim_init (SIM_LINK *link, int seg_size, int per_ci, int lose_every)
+{
+    memset (link, 0, sizeof(SIM_LINK));
+    link->per_ci     = per_ci;
+    link->lose_every = lose_every;
+    link->peer       = &strm_b;
+    ble_stream_init (&strm_a, sim_tx, link, seg_size);
+    ble_stream_init (&strm_b, sim_tx_unused, 0L, seg_size);
+}
+
+       // SDU k: 4 byte id, then a pattern that depends on id and offset
+static int  make_sdu (uint8_t *buf, uint32_t id, int len)
+{
+    int   i;
+
+    memcpy (buf, &id, 4);
+    for (i = 4;  i < len;  i++)
+      buf[i] = (uint8_t) ((id * 7 + i) * 131 + 7);
+    return (len);
+}
+
+static int  sdu_ok (uint8_t *buf, int len, uint32_t *id)
+{
+    int   i;
+
+    memcpy (id, buf, 4);
+    for (i = 4;  i < len;  i++)
+      if (buf[i] != (uint8_t) ((*id * 7 + i) * 131 + 7))
+         return (0);
+    return (1);
+}
+
+
+//*****************************************************************************
+//  test_round_trip
+//*****************************************************************************
+static void  test_round_trip (int seg_size)
+{
+    static const int  lens [] = { 4, 16, 17, 18, 19, 20, 21, 37, 38, 39,
+                                  240, 241, 242, 243, 244, 300, 509, 510 };
+    SIM_LINK  link;
+    uint8_t   buf [BLE_STREAM_TX_RING_SIZE];
+    uint8_t   rbuf [BLE_STREAM_RX_RING_SIZE];
+    uint32_t  id;
+    int       i;
+    int       len;
+    int       ci;
+    int       bad;
+
+    sim_init (&link, seg_size, 4, 0);
+    bad = 0;
+    for (i = 0;  i < (int) (sizeof(lens) / sizeof(lens[0]));  i++)
+      { make_sdu (buf, (uint32_t) i, lens[i]);
+        if (ble_stream_write (&strm_a, buf, lens[i]) != lens[i])
+           bad++;
+        for (ci = 0;  ci < 100 && ble_stream_tx_pending (&strm_a) + link.q_count > 0;  ci++)
+          sim_conn_interval (&link, &strm_a);
+        CHECK_EQ (ble_stream_check_for_recv_data (&strm_b), lens[i]);
+        len = ble_stream_read (&strm_b, rbuf, sizeof(rbuf));
+        if (len != lens[i]  ||  ! sdu_ok (rbuf, len, &id)  ||  id != (uint32_t) i)
+           bad++;
+        CHECK_EQ (ble_stream_read (&strm_b, rbuf, sizeof(rbuf)), 0);
+      }
+    CHECK_EQ (bad, 0);
+    CHECK_EQ (strm_b.stats.rx_seq_errors, 0);
+    CHECK_EQ (strm_b.stats.rx_drops, 0);
+    CHECK_EQ (strm_a.stats.tx_bytes, strm_b.stats.rx_bytes);
+    CHECK_EQ (strm_a.stats.tx_segments, strm_b.stats.rx_segments);
+
+       // a 20 byte segment holds the 3 byte first hdr + 17 data bytes
+    sim_init (&link, 20, 4, 0);
+    make_sdu (buf, 0, 17);
+    ble_stream_write (&strm_a, buf, 17);
+    CHECK_EQ (strm_a.stats.tx_segments, 1);    // 3 + 17 = 20
+    make_sdu (buf, 0, 18);
+    ble_stream_write (&strm_a, buf, 18);
+    CHECK_EQ (strm_a.stats.tx_segments, 3);    // 3 + 17, then 1 + 1
+}
+
+
+//*****************************************************************************
+//  test_flow_control
+//*****************************************************************************
+static void  test_flow_control (void)
+{
+    SIM_LINK  link;
+    uint8_t   buf [400];
+    uint8_t   rbuf [400];
+    uint32_t  id;
+    int       len;
+
+    sim_init (&link, 20, 6, 0);
+    make_sdu (buf, 1, 400);                   // 21 segments
+    CHECK_EQ (ble_stream_write (&strm_a, buf, 400), 400);
+    CHECK_EQ (link.q_count, POOL_SIZE);       // pool filled, then blocked
+    CHECK_EQ (strm_a.tx_blocked, 1);
+    CHECK_EQ (strm_a.stats.tx_pool_waits, 1);
+    CHECK_EQ (ble_stream_pump (&strm_a), 0);  // no event yet: stays blocked
+
+       // TX ring (512) has room for one more 100 byte SDU, not a 400 one
+    CHECK_EQ (ble_stream_write (&strm_a, buf, 400), 0);
+    make_sdu (buf, 2, 40);
+    CHECK_EQ (ble_stream_write (&strm_a, buf, 40), 40);
+
+    while (link.q_count > 0)
+      sim_conn_interval (&link, &strm_a);
+    CHECK_EQ (ble_stream_tx_pending (&strm_a), 0);
+    len = ble_stream_read (&strm_b, rbuf, sizeof(rbuf));
+    CHECK_EQ (len, 400);
+    CHECK (sdu_ok (rbuf, len, &id) && id == 1);
+    len = ble_stream_read (&strm_b, rbuf, sizeof(rbuf));
+    CHECK_EQ (len, 40);
+    CHECK (sdu_ok (rbuf, len, &id) && id == 2);
+    CHECK (strm_a.stats.tx_pool_waits >= 3);
+
+       // radio error is passed back, and nothing is consumed
+    sim_init (&link, 20, 6, 0);
+    link.fail = 1;
+    make_sdu (buf, 3, 30);
+    CHECK_EQ (ble_stream_write (&strm_a, buf, 30), 30);
+    CHECK_EQ (ble_stream_pump (&strm_a), -5);
+    CHECK_EQ (ble_stream_tx_pending (&strm_a), 32);
+    link.fail = 0;
+    CHECK_EQ (ble_stream_pump (&strm_a), 2);
+}
+
+
+//*****************************************************************************
+//  test_loss
+//
+//          Random SDUs over a lossy link. Delivered SDUs must be whole, and
+//          in order; every loss inside an SDU must be counted.
+//*****************************************************************************
+static void  test_loss (int lose_every)
+{
+    SIM_LINK  link;
+    uint8_t   buf [200];
+    uint8_t   rbuf [200];
+    uint32_t  id;
+    uint32_t  next_id;
+    int64_t   last_id;
+    int       len;
+    int       ci;
+    int       got;
+    int       bad;
+
+    srand (33);
+    sim_init (&link, 20, 6, lose_every);
+    next_id = 0;  last_id = -1;  got = 0;  bad = 0;
+    for (ci = 0;  ci < 4000;  ci++)
+      { for ( ; ; )
+          { len = 4 + rand() % 197;
+            make_sdu (buf, next_id, len);
+            if (ble_stream_write (&strm_a, buf, len) == 0)
+               break;
+            next_id++;
+          }
+        sim_conn_interval (&link, &strm_a);
+        while ((len = ble_stream_read (&strm_b, rbuf, sizeof(rbuf))) > 0)
+          { got++;
+            if ( ! sdu_ok (rbuf, len, &id)  ||  (int64_t) id <= last_id)
+               bad++;
+            last_id = id;
+          }
+      }
+    CHECK_EQ (bad, 0);
+    CHECK (got > 1000);
+    if (lose_every != 0)
+       { CHECK (got < (int) next_id);
+         CHECK (strm_b.stats.rx_seq_errors > 0);
+         CHECK (strm_b.stats.rx_seq_errors <= link.segs / lose_every);
+       }
+      else CHECK_EQ (strm_b.stats.rx_seq_errors, 0);
+}
+
+
+//*****************************************************************************
+//  test_rx_full
+//*****************************************************************************
+static void  test_rx_full (void)
+{
+    SIM_LINK  link;
+    uint8_t   buf [200];
+    uint8_t   rbuf [200];
+    uint32_t  id;
+    int       i;
+    int       len;
+
+    sim_init (&link, 20, 8, 0);
+    for (i = 0;  i < 6;  i++)                   // App does not read
+      { make_sdu (buf, (uint32_t) i, 200);
+        while (ble_stream_write (&strm_a, buf, 200) == 0)
+          sim_conn_interval (&link, &strm_a);
+      }
+    while (ble_stream_tx_pending (&strm_a) + link.q_count > 0)
+      sim_conn_interval (&link, &strm_a);
+
+       // RX ring is 512: two 200 byte SDUs (+ length hdrs) fit
+    CHECK_EQ (strm_b.stats.rx_drops, 4);
+    CHECK_EQ (strm_b.stats.rx_seq_errors, 0);
+    CHECK_EQ (ble_stream_read (&strm_b, rbuf, 100), -1);    // too small: kept
+    for (i = 0;  i < 2;  i++)
+      { len = ble_stream_read (&strm_b, rbuf, sizeof(rbuf));
+        CHECK_EQ (len, 200);
+        CHECK (sdu_ok (rbuf, len, &id) && id == (uint32_t) i);
+      }
+    CHECK_EQ (ble_stream_read (&strm_b, rbuf, sizeof(rbuf)), 0);
+
+       // App caught up: SDUs flow again
+    make_sdu (buf, 9, 50);
+    ble_stream_write (&strm_a, buf, 50);
+    while (link.q_count > 0)
+      sim_conn_interval (&link, &strm_a);
+    len = ble_stream_read (&strm_b, rbuf, sizeof(rbuf));
+    CHECK_EQ (len, 50);
+    CHECK (sdu_ok (rbuf, len, &id) && id == 9);
+}
+
+
+//*****************************************************************************
+//  test_parms_and_reset
+//*****************************************************************************
+static void  test_parms_and_reset (void)
+{
+    SIM_LINK  link;
+    uint8_t   buf [BLE_STREAM_TX_RING_SIZE];
+    uint8_t   seg [4];
+
+    sim_init (&link, 2, 4, 0);                 // bad seg size: default used
+    CHECK_EQ (strm_a.seg_size, BLE_STREAM_SEG_SIZE);
+    CHECK_EQ (ble_stream_write (&strm_a, buf, 0), -1);
+    CHECK_EQ (ble_stream_write (&strm_a, buf, BLE_STREAM_TX_RING_SIZE - 1), -1);
+
+       // a START segment too short to hold the length is discarded
+    seg[0] = BLE_STREAM_START;  seg[1] = 5;
+    ble_stream_rx_segment (&strm_b, seg, 2);
+    CHECK_EQ (ble_stream_check_for_recv_data (&strm_b), 0);
+       // more data than the SDU length said
+    seg[0] = BLE_STREAM_START | 1;  seg[1] = 0;  seg[2] = 0;
+    ble_stream_rx_segment (&strm_b, seg, 3);   // length 0: dropped
+    CHECK_EQ (strm_b.stats.rx_drops, 1);
+
+       // reset mid SDU: both sides restart at seq 0
+    make_sdu (buf, 4, 300);
+    ble_stream_write (&strm_a, buf, 300);
+    sim_conn_interval (&link, &strm_a);
+    ble_stream_reset (&strm_a);
+    ble_stream_reset (&strm_b);
+    link.q_count = 0;
+    CHECK_EQ (ble_stream_tx_pending (&strm_a), 0);
+    make_sdu (buf, 5, 60);
+    ble_stream_write (&strm_a, buf, 60);
+    while (link.q_count > 0)
+      sim_conn_interval (&link, &strm_a);
+    CHECK_EQ (ble_stream_check_for_recv_data (&strm_b), 60);
+}
+
+
+//*****************************************************************************
+//  bench
+//
+//          SDU bytes per second at a 7.5 ms connection interval, for 1..8
+//          packets per interval. The raw ATT payload limit is per_ci * 20
+//          bytes per interval.
+//
+//          The App reads once per interval, so the 512 byte RX ring must
+//          hold a completed SDU plus the next one being assembled: 200 byte
+//          SDUs. (With 300 byte SDUs the second one is dropped whenever one
+//          completes mid interval - raise BLE_STREAM_RX_RING_SIZE for that.)
+//*****************************************************************************
+static void  bench (void)
+{
+    static const int  per_ci [] = { 1, 2, 4, 6, 8 };
+    SIM_LINK  link;
+    uint8_t   buf [200];
+    double    secs;
+    double    rate;
+    int       p;
+    int       ci;
+
+    printf ("benchmark (simulated %.1f ms connection interval, 200 byte SDUs)\n", CI_MSEC);
+    for (p = 0;  p < (int) (sizeof(per_ci) / sizeof(per_ci[0]));  p++)
+      { sim_init (&link, 20, per_ci[p], 0);
+        make_sdu (buf, 0, 200);
+        for (ci = 0;  ci < 4000;  ci++)
+          { while (ble_stream_write (&strm_a, buf, 200) > 0)
+              ;
+            sim_conn_interval (&link, &strm_a);
+            while (ble_stream_read (&strm_b, buf, sizeof(buf)) > 0)
+              ;
+          }
+        secs = ci * CI_MSEC / 1000.0;
+        rate = strm_b.stats.rx_bytes / secs;
+        printf ("  %d pkt/interval: %7.0f bytes/s  (%2.0f %% of raw ATT payload)\n",
+                per_ci[p], rate, 100.0 * rate / (per_ci[p] * 20 / (CI_MSEC / 1000.0)));
+        CHECK (rate > 0.8 * per_ci[p] * 20 / (CI_MSEC / 1000.0));
+        CHECK_EQ (strm_b.stats.rx_drops, 0);
+      }
+}
+
+
+int  main (void)
+{
+    test_round_trip (20);
+    test_round_trip (244);
+    test_flow_control ();
+    test_loss (0);
+    test_loss (37);
+    test_loss (5);
+    test_rx_full ();
+    test_parms_and_reset ();
+    bench ();
+    return (host_test_done ("test_ble_stream"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,551 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_boot_seq.c
+//
+//
+//  Host test and simulation for common/boot_seq.c and common/boot_prof.c.
+//
+//  Step functions model device init: a piece of work, then a wait. The ms
+//  clock only moves when a step spends time, or the sequencer idles (the
+//  host __WFI() is one SysTick: 1 ms, and its cycles on the DWT counter),
+//  so every time below is exact.
+//
+//    - overlapped waits: tasks start together, a dependent task starts as
+//      soon as what it depends on is up, and the boot profile shows it
+//    - a failed task fails its dependents (their steps never run), and
+//      boot_seq_run() returns its code, unless it is BOOT_TASK_OPTIONAL
+//    - lazy tasks: left out of boot_seq_run(), brought up (with their
+//      dependencies) by boot_seq_require() or boot_seq_poll()
+//    - a boot_seq_run() timeout leaves tasks part way, and a later
+//      require carries on with them from where they were
+//    - warm boot: the backup register header written by boot_seq_commit(),
+//      warm steps only for tasks that were up at the commit, saved state
+//      words, and the cases that must fall back to a cold boot
+//    - boot profile: table overflow, dropped count, a step left running,
+//      time-to-first-sample, the JSON export
+//    - simulation: 4 sensor init, one after the other vs boot_seq
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "boot_seq.h"
+#include "boot_prof.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <string.h>
+
+            // what a step function does, per task: parm points to one
+typedef struct
+   {
+       char      id;                // letter, for the call log
+       int       work_ms;           // time spent in each step call
+       int       wait_ms;           // then wait this long (0 = done now)
+       int       pieces;            // # of waits before it is up
+       int       rc;                // < 0: fail on the first call
+       int       calls;
+       int       warm_calls;
+       uint32_t  up_ms;             // host_ms when it returned BOOT_DONE
+   } DEV;
+
+static char    call_log [64];
+static int     log_len;
+static BOOT_SEQ  seq;
+
+
+static void  spend_ms (int ms)
+{
+    host_ms         += ms;
+    host_dwt.CYCCNT += ms * (SystemCoreClock / 1000);
+}
+
+static int  dev_step (BOOT_SEQ *sq, BOOT_TASK *task)
+{
+    DEV  *dv = (DEV*) task->parm;
+
+    (void) sq;
+    dv->calls++;
+    if (log_len < (int) sizeof(call_log) - 1)
+       call_log [log_len++] = dv->id;
+    spend_ms (dv->work_ms);
+    if (dv->rc < 0)
+       return (dv->rc);
+    if (task->phase++ < dv->pieces)
+       return (BOOT_WAIT_MS(dv->wait_ms));
+    dv->up_ms = host_ms;
+    return (BOOT_DONE);
+}
+
+            // warm: the device stayed powered, no waits
+static int  dev_warm_step (BOOT_SEQ *sq, BOOT_TASK *task)
+{
+    DEV  *dv = (DEV*) task->parm;
+
+    (void) sq;
+    dv->warm_calls++;
+    if (log_len < (int) sizeof(call_log) - 1)
+       call_log [log_len++] = (char) (dv->id - 'A' + 'a');
+    dv->up_ms = host_ms;
+    return (BOOT_DONE);
+}
+
+static void  dev_set (DEV *dv, char id, int work_ms, int wait_ms, int pieces)
+{
+    memset (dv, 0, sizeof(DEV));
+    dv->id      = id;
+    dv->work_ms = work_ms;
+    dv->wait_ms = wait_ms;
+    dv->pieces  = pieces;
+}
+
+            // reset the simulated board: cold power on, clock at 0
+static void  board_reset (uint32_t reset_cause)
+{
+    host_ms          = 0;
+    host_dwt.CYCCNT  = 0;
+    host_reset_cause = reset_cause;
+    boot_prof_init ();
+    log_len = 0;
+    memset (call_log, 0, sizeof(call_log));
+}
+
+static int  prof_json (char *buf, int size)
+{
+    TCODEC_ENC  enc;
+
+    memset (buf, 0, size);
+    tcodec_enc_init (&enc, buf, size - 1, TCODEC_JSON);
+    boot_prof_encode (&enc);
+    return (tcodec_enc_finish (&enc));
+}
+
+
+//*****************************************************************************
+//  test_overlap
+//*****************************************************************************
+static void  test_overlap (void)
+{
+    DEV        dv [3];
+    BOOT_TASK  tasks [3];
+    BOOT_STEP  st;
+
+    memset (host_backup, 0, sizeof(host_backup));
+    board_reset (RESET_CAUSE_POWER_ON);
+    dev_set (&dv[0], 'A', 2, 40, 1);               // baro:  2 ms + 40 ms
+    dev_set (&dv[1], 'B', 3, 80, 1);               // hum:   3 ms + 80 ms
+    dev_set (&dv[2], 'C', 1, 10, 2);               // needs A: 2 x (1 + 10)
+    memset (tasks, 0, sizeof(tasks));
+    tasks[0].name = "A";  tasks[0].cold_step = dev_step;  tasks[0].parm = &dv[0];
+    tasks[1].name = "B";  tasks[1].cold_step = dev_step;  tasks[1].parm = &dv[1];
+    tasks[2].name = "C";  tasks[2].cold_step = dev_step;  tasks[2].parm = &dv[2];
+    tasks[2].depends = BOOT_TASK_BIT(0);
+
+    CHECK_EQ (boot_seq_init (&seq, tasks, 3), 0);
+    CHECK_EQ (seq.warm, 0);
+    CHECK_EQ (boot_seq_run (&seq, 500), 0);
+    CHECK_EQ (seq.up_mask, 7);
+
+       // A: 0-2, waits till 42.  B: 2-5, waits till 85.  C starts when
+       // A is up (42-43): 43-44 work, wait, 54-55, wait, 65-66 done.
+    CHECK (strcmp (call_log, "ABACCCB") == 0);
+    CHECK_EQ (dv[0].up_ms, 44);
+    CHECK_EQ (dv[2].up_ms, 67);
+    CHECK_EQ (dv[1].up_ms, 88);
+    CHECK_EQ (host_ms, 88);                        // vs 2+40+2 + 3+80+3 + 33
+    CHECK (boot_seq_is_up (&seq, 2)  &&  ! boot_seq_is_up (&seq, 3));
+
+       // the profile shows the overlap, in usec
+    CHECK_EQ (boot_prof_num_steps (), 3);
+    CHECK_EQ (boot_prof_get_step (0, &st), 0);
+    CHECK (strcmp (st.name, "A") == 0  &&  st.start_usec == 0  &&  st.dur_usec == 44000);
+    CHECK_EQ (boot_prof_get_step (1, &st), 0);
+    CHECK (st.start_usec == 2000  &&  st.dur_usec == 86000  &&  st.done == 1);
+    CHECK_EQ (boot_prof_get_step (2, &st), 0);
+    CHECK (st.start_usec == 44000  &&  st.dur_usec == 23000  &&  st.rc == 0);
+
+       // bad tables
+    CHECK_EQ (boot_seq_init (&seq, tasks, 0), ERR_BOOT_INVALID_PARM);
+    CHECK_EQ (boot_seq_init (&seq, tasks, BOOT_SEQ_MAX_TASKS + 1), ERR_BOOT_INVALID_PARM);
+    CHECK_EQ (boot_seq_init (0L, tasks, 3), ERR_BOOT_INVALID_PARM);
+    tasks[1].depends = BOOT_TASK_BIT(2);           // on a later task
+    CHECK_EQ (boot_seq_init (&seq, tasks, 3), ERR_BOOT_INVALID_PARM);
+    tasks[1].depends = BOOT_TASK_BIT(1);           // on itself
+    CHECK_EQ (boot_seq_init (&seq, tasks, 3), ERR_BOOT_INVALID_PARM);
+    tasks[1].depends   = 0;
+    tasks[1].cold_step = 0L;
+    CHECK_EQ (boot_seq_init (&seq, tasks, 3), ERR_BOOT_INVALID_PARM);
+}
+
+
+//*****************************************************************************
+//  test_failures
+//*****************************************************************************
+static void  test_failures (void)
+{
+    DEV        dv [4];
+    BOOT_TASK  tasks [4];
+    int        i;
+
+    memset (tasks, 0, sizeof(tasks));
+    for (i = 0;  i < 4;  i++)
+      { dev_set (&dv[i], (char) ('A' + i), 1, 5, 1);
+        tasks[i].cold_step = dev_step;
+        tasks[i].parm      = &dv[i];
+      }
+    dv[0].rc = -42;                                // A fails
+    tasks[1].depends = BOOT_TASK_BIT(0);           // B needs A
+    tasks[2].depends = BOOT_TASK_BIT(1);           // C needs B: fails too
+                                                   // D is independent
+    board_reset (RESET_CAUSE_PIN);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 4), 0);
+    CHECK_EQ (boot_seq_run (&seq, 500), -42);
+    CHECK_EQ (seq.failed_mask, 7);
+    CHECK_EQ (seq.up_mask, 8);
+    CHECK (dv[1].calls == 0  &&  dv[2].calls == 0);
+    CHECK_EQ (tasks[1].rc, ERR_BOOT_DEP_FAILED);
+    CHECK_EQ (tasks[2].rc, ERR_BOOT_DEP_FAILED);
+    CHECK_EQ (tasks[0].state, BOOT_STATE_FAILED);
+    CHECK_EQ (boot_prof_num_steps (), 4);          // failed ones are profiled too
+
+       // A optional: B's dependency failure is what fails the run
+    tasks[0].flags = BOOT_TASK_OPTIONAL;
+    board_reset (RESET_CAUSE_PIN);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 4), 0);
+    CHECK_EQ (boot_seq_run (&seq, 500), ERR_BOOT_DEP_FAILED);
+
+       // A, B and C all optional: the run is good, with D up
+    tasks[1].flags = BOOT_TASK_OPTIONAL;
+    tasks[2].flags = BOOT_TASK_OPTIONAL;
+    board_reset (RESET_CAUSE_PIN);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 4), 0);
+    CHECK_EQ (boot_seq_run (&seq, 500), 0);
+    CHECK (boot_seq_is_up (&seq, 3)  &&  ! boot_seq_is_up (&seq, 1));
+    CHECK_EQ (boot_seq_require (&seq, 2, 100), ERR_BOOT_DEP_FAILED);
+}
+
+
+//*****************************************************************************
+//  test_lazy
+//*****************************************************************************
+static void  test_lazy (void)
+{
+    DEV        dv [4];
+    BOOT_TASK  tasks [4];
+    int        i;
+
+    memset (tasks, 0, sizeof(tasks));
+    for (i = 0;  i < 4;  i++)
+      { tasks[i].cold_step = dev_step;
+        tasks[i].parm      = &dv[i];
+      }
+    dev_set (&dv[0], 'A', 1, 10, 1);
+    dev_set (&dv[1], 'B', 1, 20, 1);
+    dev_set (&dv[2], 'C', 1,  5, 1);               // lazy, needs B (lazy)
+    dev_set (&dv[3], 'D', 1,  5, 2);               // lazy, polled
+    tasks[1].flags   = BOOT_TASK_LAZY;
+    tasks[2].flags   = BOOT_TASK_LAZY;
+    tasks[2].depends = BOOT_TASK_BIT(1);
+    tasks[3].flags   = BOOT_TASK_LAZY;
+
+    board_reset (RESET_CAUSE_POWER_ON);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 4), 0);
+    CHECK_EQ (boot_seq_run (&seq, 500), 0);
+    CHECK_EQ (seq.up_mask, 1);
+    CHECK_EQ (host_ms, 12);
+    CHECK (dv[1].calls == 0  &&  dv[2].calls == 0  &&  dv[3].calls == 0);
+
+       // first use of C: brings up B, then C
+    CHECK_EQ (boot_seq_require (&seq, 2, 100), 0);
+    CHECK_EQ (seq.up_mask, 7);
+    CHECK (dv[1].up_ms == 12 + 22  &&  dv[2].up_ms == 34 + 7);
+    CHECK_EQ (boot_seq_require (&seq, 2, 100), 0);  // already up: no calls
+    CHECK_EQ (dv[2].calls, 2);
+    CHECK_EQ (boot_seq_require (&seq, 4, 100), ERR_BOOT_INVALID_PARM);
+
+       // D in the background, from the main loop
+    CHECK_EQ (boot_seq_poll (&seq, BOOT_TASK_BIT(3)), 1);
+    CHECK_EQ (dv[3].calls, 1);
+    CHECK_EQ (boot_seq_poll (&seq, BOOT_TASK_BIT(3)), 1);   // still waiting
+    CHECK_EQ (dv[3].calls, 1);
+    spend_ms (5);
+    CHECK_EQ (boot_seq_poll (&seq, BOOT_TASK_BIT(3)), 1);
+    spend_ms (5);
+    CHECK_EQ (boot_seq_poll (&seq, BOOT_TASK_BIT(3)), 0);
+    CHECK (boot_seq_is_up (&seq, 3)  &&  dv[3].calls == 3);
+    CHECK_EQ (boot_seq_poll (&seq, 0x0F), 0);
+}
+
+
+//*****************************************************************************
+//  test_timeout_resume
+//*****************************************************************************
+static void  test_timeout_resume (void)
+{
+    DEV        dv [2];
+    BOOT_TASK  tasks [2];
+
+    memset (tasks, 0, sizeof(tasks));
+    dev_set (&dv[0], 'A', 1, 100, 1);              // slow: 1 + 100 + 1
+    dev_set (&dv[1], 'B', 1, 5, 3);
+    tasks[0].cold_step = dev_step;  tasks[0].parm = &dv[0];
+    tasks[1].cold_step = dev_step;  tasks[1].parm = &dv[1];
+    tasks[1].flags     = BOOT_TASK_LAZY;
+
+    board_reset (RESET_CAUSE_POWER_ON);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 2), 0);
+    CHECK_EQ (boot_seq_run (&seq, 30), ERR_BOOT_TIMEOUT);
+    CHECK_EQ (host_ms, 30);
+    CHECK_EQ (tasks[0].state, BOOT_STATE_RUNNING);
+    CHECK_EQ (tasks[0].phase, 1);
+    CHECK_EQ (dv[0].calls, 1);
+
+       // require of B carries A along, from where it was
+    CHECK_EQ (boot_seq_require (&seq, 1, 10), ERR_BOOT_TIMEOUT);
+    CHECK_EQ (tasks[1].state, BOOT_STATE_RUNNING);
+    CHECK_EQ (boot_seq_require (&seq, 0, 500), 0);
+    CHECK_EQ (dv[0].calls, 2);                     // not restarted
+    CHECK_EQ (dv[0].up_ms, 102);
+    CHECK_EQ (seq.up_mask, 3);                     // B finished on the way
+    CHECK_EQ (dv[1].calls, 4);
+}
+
+
+//*****************************************************************************
+//  test_warm_boot
+//*****************************************************************************
+static void  test_warm_boot (void)
+{
+    DEV        dv [3];
+    BOOT_TASK  tasks [3];
+    uint32_t   state;
+    char       json [256];
+    int        i;
+
+    memset (tasks, 0, sizeof(tasks));
+    dev_set (&dv[0], 'A', 2, 40, 1);               // warm step, saves state
+    dev_set (&dv[1], 'B', 2, 60, 1);               // no warm step
+    dev_set (&dv[2], 'C', 2, 30, 1);               // lazy, warm step
+    for (i = 0;  i < 3;  i++)
+      { tasks[i].cold_step = dev_step;
+        tasks[i].parm      = &dv[i];
+      }
+    tasks[0].warm_step = dev_warm_step;
+    tasks[2].warm_step = dev_warm_step;
+    tasks[2].flags     = BOOT_TASK_LAZY;
+
+       // cold boot, then save A's state and commit, with C never used
+    memset (host_backup, 0, sizeof(host_backup));
+    board_reset (RESET_CAUSE_POWER_ON);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 3), 0);
+    CHECK_EQ (boot_seq_run (&seq, 500), 0);
+    CHECK_EQ (boot_seq_get_state (&seq, 0, &state), ERR_BOOT_NO_STATE);
+    CHECK_EQ (boot_seq_save_state (&seq, 0, 0x12345678), 0);
+    CHECK_EQ (boot_seq_save_state (&seq, 3, 0), ERR_BOOT_INVALID_PARM);
+    CHECK_EQ (boot_seq_commit (&seq), 0);
+    CHECK_EQ (host_backup[BOOT_SEQ_BKP_FIRST], BOOT_SEQ_BKP_MAGIC | (3 << 16) | 3);
+    CHECK_EQ (host_backup[BOOT_SEQ_BKP_FIRST + 1], 0x12345678);
+
+       // wakeup from standby: A warm, B cold (no warm step)
+    for (i = 0;  i < 3;  i++)
+      dv[i].calls = dv[i].warm_calls = 0;
+    board_reset (RESET_CAUSE_STANDBY);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 3), 0);
+    CHECK (seq.warm == 1  &&  seq.saved_mask == 3);
+    CHECK_EQ (host_backup[BOOT_SEQ_BKP_FIRST], 0);  // used up
+    CHECK_EQ (boot_seq_get_state (&seq, 0, &state), 0);
+    CHECK_EQ (state, 0x12345678);
+    CHECK_EQ (boot_seq_get_state (&seq, 2, &state), ERR_BOOT_NO_STATE);
+    CHECK_EQ (boot_seq_get_state (&seq, 0, 0L), ERR_BOOT_INVALID_PARM);
+    CHECK_EQ (boot_seq_run (&seq, 500), 0);
+    CHECK (dv[0].warm_calls == 1  &&  dv[0].calls == 0  &&  dv[0].up_ms == 0);
+    CHECK_EQ (dv[1].calls, 2);
+    CHECK_EQ (host_ms, 64);
+
+       // C was not up at the commit: its device was never set up, so
+       // it gets its cold step, even on a warm boot
+    CHECK_EQ (boot_seq_require (&seq, 2, 100), 0);
+    CHECK (dv[2].calls == 2  &&  dv[2].warm_calls == 0);
+    CHECK (strcmp (call_log, "aBBCC") == 0);
+    CHECK (prof_json (json, sizeof(json)) > 0);
+    CHECK (strstr (json, "\"warm\":1") != 0L);
+
+       // no fresh commit: the next standby wakeup is cold
+    board_reset (RESET_CAUSE_STANDBY);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 3), 0);
+    CHECK_EQ (seq.warm, 0);
+    CHECK (prof_json (json, sizeof(json)) > 0  &&  strstr (json, "\"warm\":0") != 0L);
+
+       // a commit, then a reset that is not a standby wakeup: cold, and
+       // the header is cleared
+    CHECK_EQ (boot_seq_commit (&seq), 0);
+    board_reset (RESET_CAUSE_PIN | RESET_CAUSE_WATCHDOG);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 3), 0);
+    CHECK_EQ (seq.warm, 0);
+    CHECK_EQ (host_backup[BOOT_SEQ_BKP_FIRST], 0);
+
+       // a header from a build with another task table: cold
+    CHECK_EQ (boot_seq_commit (&seq), 0);
+    board_reset (RESET_CAUSE_STANDBY);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 2), 0);
+    CHECK_EQ (seq.warm, 0);
+    CHECK_EQ (host_backup[BOOT_SEQ_BKP_FIRST], 0);
+
+       // no magic (backup domain lost): cold, and left alone
+    host_backup[BOOT_SEQ_BKP_FIRST] = 0x00030003;
+    board_reset (RESET_CAUSE_STANDBY);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 3), 0);
+    CHECK_EQ (seq.warm, 0);
+    CHECK_EQ (host_backup[BOOT_SEQ_BKP_FIRST], 0x00030003);
+}
+
+
+//*****************************************************************************
+//  test_profile
+//*****************************************************************************
+static void  test_profile (void)
+{
+    DEV        dv;
+    BOOT_TASK  task;
+    BOOT_STEP  st;
+    char       json [2048];
+    int        i;
+    int        id;
+
+    board_reset (RESET_CAUSE_POWER_ON);
+    CHECK_EQ (boot_prof_get_ttfs (), 0);
+    spend_ms (3);
+    id = boot_prof_begin ("clk");
+    spend_ms (2);
+    SystemCoreClock = 168000000;                   // PLL on: twice the rate
+    boot_prof_clock_changed ();
+    host_dwt.CYCCNT += 168000 * 4;                 // 4 ms at the new rate
+    host_ms += 4;
+    boot_prof_end (id, 0);
+    boot_prof_end (id, -9);                        // a 2nd end is ignored
+    CHECK_EQ (boot_prof_get_step (id, &st), 0);
+    CHECK (st.start_usec == 3000  &&  st.dur_usec == 6000  &&  st.rc == 0);
+    SystemCoreClock = 84000000;
+    boot_prof_clock_changed ();
+
+    boot_prof_begin (0L);                          // unnamed, never ended
+    for (i = 2;  i < BOOT_PROF_MAX_STEPS;  i++)
+      CHECK_EQ (boot_prof_begin ("s"), i);
+    CHECK_EQ (boot_prof_begin ("x"), ERR_BOOT_TABLE_FULL);
+    boot_prof_end (ERR_BOOT_TABLE_FULL, 0);        // ignored, no harm
+    CHECK_EQ (boot_prof_num_steps (), BOOT_PROF_MAX_STEPS);
+    CHECK_EQ (boot_prof_get_step (BOOT_PROF_MAX_STEPS, &st), ERR_BOOT_INVALID_PARM);
+    CHECK_EQ (boot_prof_get_step (0, 0L), ERR_BOOT_INVALID_PARM);
+
+       // a full table does not stop boot_seq: the task runs unprofiled
+    memset (&task, 0, sizeof(task));
+    dev_set (&dv, 'A', 1, 5, 1);
+    task.name = "late";  task.cold_step = dev_step;  task.parm = &dv;
+    CHECK_EQ (boot_seq_init (&seq, &task, 1), 0);
+    CHECK_EQ (boot_seq_run (&seq, 100), 0);
+    CHECK_EQ (task.prof_id, ERR_BOOT_TABLE_FULL);
+
+    spend_ms (1);
+    boot_prof_first_sample ();
+    CHECK_EQ (boot_prof_get_ttfs (), 17000);
+    spend_ms (10);
+    boot_prof_first_sample ();                     // only the first counts
+    CHECK_EQ (boot_prof_get_ttfs (), 17000);
+
+    CHECK (prof_json (json, sizeof(json)) > 0);
+    CHECK (strstr (json, "\"drop\":2") != 0L);
+    CHECK (strstr (json, "\"ttfs\":17000") != 0L);
+    CHECK (strstr (json, "[\"clk\",3000,6000,0]") != 0L);
+    CHECK (strstr (json, "[\"?\",9000,null,0]") != 0L);
+}
+
+
+//*****************************************************************************
+//  simulation
+//
+//          Lab_2c's sensors: pressure and hum/temp (first conversion waits
+//          of 40 and 80 ms), IMU and magnetometer, each with a few ms of
+//          I2C setup. One after the other, vs boot_seq with the IMU and
+//          magneto lazy (time to first sample).
+//*****************************************************************************
+static void  simulation (void)
+{
+    DEV        dv [4];
+    BOOT_TASK  tasks [4];
+    uint64_t   t0;
+    uint64_t   t1;
+    uint32_t   serial_ms;
+    uint32_t   seq_ms;
+    int        i;
+    int        runs;
+
+    memset (tasks, 0, sizeof(tasks));
+    dev_set (&dv[0], 'P', 3, 40, 1);
+    dev_set (&dv[1], 'H', 4, 80, 1);
+    dev_set (&dv[2], 'I', 5,  0, 0);
+    dev_set (&dv[3], 'M', 2,  0, 0);
+    for (i = 0;  i < 4;  i++)
+      { tasks[i].cold_step = dev_step;
+        tasks[i].parm      = &dv[i];
+      }
+    serial_ms = 0;
+    for (i = 0;  i < 4;  i++)                      // blocking init calls
+      serial_ms += dv[i].work_ms + dv[i].wait_ms + (dv[i].pieces ? dv[i].work_ms : 0);
+
+    tasks[2].flags = BOOT_TASK_LAZY;
+    tasks[3].flags = BOOT_TASK_LAZY;
+    board_reset (RESET_CAUSE_POWER_ON);
+    CHECK_EQ (boot_seq_init (&seq, tasks, 4), 0);
+    CHECK_EQ (boot_seq_run (&seq, 500), 0);
+    seq_ms = host_ms;
+    CHECK (seq_ms < serial_ms);
+
+       // host cost of the sequencer itself: a run of 4 tasks
+    runs = 20000;
+    t0 = host_nsec ();
+    for (i = 0;  i < runs;  i++)
+      { board_reset (RESET_CAUSE_POWER_ON);
+        boot_seq_init (&seq, tasks, 4);
+        boot_seq_run (&seq, 500);
+      }
+    t1 = host_nsec ();
+    printf ("benchmark: sensor init (simulated)  sequential %u ms   boot_seq "
+            "%u ms to first sample   host %.0f ns per run\n",
+            (unsigned) serial_ms, (unsigned) seq_ms, (double) (t1 - t0) / runs);
+}
+
+
+int  main (void)
+{
+    test_overlap ();
+    test_failures ();
+    test_lazy ();
+    test_timeout_resume ();
+    test_warm_boot ();
+    test_profile ();
+    simulation ();
+    return (host_test_done ("test_boot_seq"));
+}
+
+//*****************************************************************************
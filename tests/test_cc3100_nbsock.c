@@ -0,0 +1,323 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_cc3100_nbsock.c
+//
+//
+//  Host test for common/cc3100_nbsock.c, against a SimpleLink stand-in over
+//  host socketpairs (tests/host/simplelink/).
+//
+//    - open / close, socket table full, unregistered sockets
+//    - nothing waiting: recv returns EAGAIN at once
+//    - stalled peer: sends return EAGAIN instead of blocking, and the
+//      socket only reports writable again once the peer drains it
+//    - no head-of-line blocking: one poll reports another socket readable
+//      while the first is stalled
+//    - partial reads, peer close (recv 0, CLOSED is sticky), SimpleLink
+//      error status mapped to ECONNRESET
+//    - nbsock_wait() timeout and wake up
+//    - benchmark: bulk transfer through the poll / partial send loop
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "cc3100_nbsock.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define  SOCK_BUF_SIZE   4096           // kernel buffers, like the CC3100's few
+
+
+static void  make_pair (int sv[2])
+{
+    int  sz;
+
+    CHECK_EQ (socketpair (AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    sz = SOCK_BUF_SIZE;
+    setsockopt (sv[0], SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz));
+    setsockopt (sv[1], SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz));
+}
+
+
+//*****************************************************************************
+//  test_open_close
+//*****************************************************************************
+static void  test_open_close (void)
+{
+    int            sv [NBSOCK_MAX_SOCKETS + 1][2];
+    unsigned char  buf [8];
+    int            i;
+
+    for (i = 0;  i <= NBSOCK_MAX_SOCKETS;  i++)
+      make_pair (sv[i]);
+    for (i = 0;  i < NBSOCK_MAX_SOCKETS;  i++)
+      CHECK_EQ (nbsock_open (sv[i][0]), 0);
+    CHECK_EQ (nbsock_open (sv[0][0]), 0);          // re-open is harmless
+    errno = 0;
+    CHECK_EQ (nbsock_open (sv[NBSOCK_MAX_SOCKETS][0]), -1);
+    CHECK_EQ (errno, ENFILE);
+    errno = 0;
+    CHECK_EQ (nbsock_open (-1), -1);
+    CHECK_EQ (errno, EBADF);
+
+       // not registered
+    errno = 0;
+    CHECK_EQ (nbsock_recv (sv[NBSOCK_MAX_SOCKETS][0], buf, sizeof(buf)), -1);
+    CHECK_EQ (errno, EBADF);
+    CHECK_EQ (nbsock_ready (sv[NBSOCK_MAX_SOCKETS][0]), NBSOCK_CLOSED);
+    CHECK (nbsock_get (sv[NBSOCK_MAX_SOCKETS][0]) == 0L);
+
+       // closing one frees its slot
+    CHECK_EQ (nbsock_close (sv[3][0]), 0);
+    CHECK (nbsock_get (sv[3][0]) == 0L);
+    CHECK_EQ (nbsock_open (sv[NBSOCK_MAX_SOCKETS][0]), 0);
+
+    for (i = 0;  i <= NBSOCK_MAX_SOCKETS;  i++)
+      { if (i != 3)
+           nbsock_close (sv[i][0]);
+        close (sv[i][1]);
+      }
+    CHECK_EQ (nbsock_poll (0), 0);                 // nothing registered
+}
+
+
+//*****************************************************************************
+//  test_stalled_peer
+//
+//          Socket a's peer never reads. Socket b's peer sends. Neither must
+//          hold up the other.
+//*****************************************************************************
+static void  test_stalled_peer (void)
+{
+    static unsigned char  buf [65536];
+    int       a [2];
+    int       b [2];
+    NBSOCK    *sock;
+    uint64_t  t0;
+    int       total;
+    int       got;
+    int       rc;
+
+    make_pair (a);
+    make_pair (b);
+    CHECK_EQ (nbsock_open (a[0]), 0);
+    CHECK_EQ (nbsock_open (b[0]), 0);
+    memset (buf, 'x', sizeof(buf));
+
+       // nothing waiting
+    CHECK_EQ (nbsock_poll (0), 0);
+    errno = 0;
+    CHECK_EQ (nbsock_recv (a[0], buf, 10), -1);
+    CHECK_EQ (errno, EAGAIN);
+    CHECK_EQ (nbsock_get(a[0])->eagains, 1);
+
+       // fill a's buffers: must come back with EAGAIN, not block
+    t0 = host_nsec ();
+    total = 0;
+    while ((rc = nbsock_send (a[0], buf, sizeof(buf))) > 0)
+      total += rc;
+    CHECK_EQ (rc, -1);
+    CHECK_EQ (errno, EAGAIN);
+    CHECK (total > 0  &&  total < (int) sizeof(buf));
+    CHECK (host_nsec () - t0 < 100000000ULL);
+    sock = nbsock_get (a[0]);
+    CHECK_EQ (sock->tx_bytes, total);
+
+       // b's peer sends: one poll reports b readable, a still not writable
+    CHECK_EQ (write (b[1], "hello", 5), 5);
+    CHECK_EQ (nbsock_poll (0), 1);
+    CHECK (nbsock_ready (b[0]) & NBSOCK_READABLE);
+    CHECK ((nbsock_ready (a[0]) & NBSOCK_WRITABLE) == 0);
+
+       // partial reads, then EAGAIN clears READABLE
+    CHECK_EQ (nbsock_recv (b[0], buf, 3), 3);
+    CHECK_EQ (nbsock_recv (b[0], buf, 10), 2);
+    CHECK (memcmp (buf, "lo", 2) == 0);
+    CHECK_EQ (nbsock_recv (b[0], buf, 10), -1);
+    CHECK ((nbsock_ready (b[0]) & NBSOCK_READABLE) == 0);
+    CHECK_EQ (nbsock_get(b[0])->rx_bytes, 5);
+
+       // a's peer drains: a is writable after the next poll
+    got = 0;
+    while (got < total)
+      { rc = (int) read (a[1], buf, sizeof(buf));
+        CHECK (rc > 0);
+        if (rc <= 0)
+           break;
+        got += rc;
+      }
+    CHECK (nbsock_poll (100) >= 1);
+    CHECK (nbsock_ready (a[0]) & NBSOCK_WRITABLE);
+    CHECK_EQ (nbsock_send (a[0], buf, 100), 100);
+
+    nbsock_close (a[0]);
+    nbsock_close (b[0]);
+    close (a[1]);
+    close (b[1]);
+}
+
+
+//*****************************************************************************
+//  test_close_and_errors
+//*****************************************************************************
+static void  test_close_and_errors (void)
+{
+    unsigned char  buf [16];
+    int            c [2];
+    int            d [2];
+
+    make_pair (c);
+    make_pair (d);
+    CHECK_EQ (nbsock_open (c[0]), 0);
+    CHECK_EQ (nbsock_open (d[0]), 0);
+
+       // peer close: readable, recv 0, and CLOSED stays set across polls
+    close (c[1]);
+    CHECK_EQ (nbsock_poll (0), 1);
+    CHECK (nbsock_ready (c[0]) & NBSOCK_READABLE);
+    CHECK_EQ (nbsock_recv (c[0], buf, sizeof(buf)), 0);
+    CHECK (nbsock_ready (c[0]) & NBSOCK_CLOSED);
+    nbsock_poll (0);
+    CHECK (nbsock_ready (c[0]) & NBSOCK_CLOSED);
+    nbsock_close (c[0]);
+    CHECK_EQ (nbsock_ready (c[0]), NBSOCK_CLOSED);
+
+       // SimpleLink error status: -1 / ECONNRESET, error kept
+    host_sl_inject_error = SL_ECONNRESET;
+    errno = 0;
+    CHECK_EQ (nbsock_recv (d[0], buf, sizeof(buf)), -1);
+    CHECK_EQ (errno, ECONNRESET);
+    CHECK_EQ (nbsock_get(d[0])->last_error, SL_ECONNRESET);
+    CHECK (nbsock_ready (d[0]) & NBSOCK_CLOSED);
+
+    host_sl_inject_error = -57;
+    errno = 0;
+    CHECK_EQ (nbsock_send (d[0], buf, 4), -1);
+    CHECK_EQ (errno, ECONNRESET);
+    CHECK_EQ (nbsock_get(d[0])->last_error, -57);
+
+       // a 0 length send is a caller error
+    CHECK_EQ (nbsock_send (d[0], buf, 0), -1);
+    CHECK_EQ (errno, EBADF);
+
+    nbsock_close (d[0]);
+    close (d[1]);
+}
+
+
+//*****************************************************************************
+//  test_wait
+//*****************************************************************************
+static void  test_wait (void)
+{
+    uint64_t  t0;
+    uint64_t  elapsed;
+    int       e [2];
+
+    make_pair (e);
+    CHECK_EQ (nbsock_open (e[0]), 0);
+
+    t0 = host_nsec ();
+    CHECK_EQ (nbsock_wait (e[0], NBSOCK_READABLE, 30), 0);
+    elapsed = host_nsec () - t0;
+    CHECK (elapsed >= 25000000ULL  &&  elapsed < 500000000ULL);
+
+    CHECK_EQ (nbsock_wait (e[0], NBSOCK_WRITABLE, 0), 1);
+    CHECK_EQ (write (e[1], "z", 1), 1);
+    CHECK_EQ (nbsock_wait (e[0], NBSOCK_READABLE, 1000), 1);
+    CHECK_EQ (nbsock_wait (e[0], NBSOCK_READABLE, 1500), 1);    // > 1 sec timeval
+
+    nbsock_close (e[0]);
+    close (e[1]);
+}
+
+
+//*****************************************************************************
+//  bench
+//
+//          Move 64 MB from one nbsock to a peer through the 4 KB buffers,
+//          the way a main loop would: poll, send what fits. The peer reads
+//          at most 4 KB per pass, so it is the slower side, and the layer
+//          has to absorb short and EAGAIN sends.
+//*****************************************************************************
+static void  bench (void)
+{
+    static unsigned char  buf [16384];
+    static unsigned char  sink [16384];
+    NBSOCK    *sock;
+    uint64_t  t0;
+    double    secs;
+    long      sent;
+    long      rcvd;
+    long      polls;
+    long      shorts;
+    int       f [2];
+    int       rc;
+
+    make_pair (f);
+    CHECK_EQ (nbsock_open (f[0]), 0);
+    fcntl (f[1], F_SETFL, O_NONBLOCK);
+    memset (buf, 0x5A, sizeof(buf));
+    sent = rcvd = polls = shorts = 0;
+    t0 = host_nsec ();
+    while (rcvd < sent  ||  sent < 64L * 1024 * 1024)
+      { nbsock_poll (0);
+        polls++;
+        if (sent < 64L * 1024 * 1024)
+           { rc = nbsock_send (f[0], buf, sizeof(buf));
+             if (rc > 0)
+                sent += rc;
+             if (rc < (int) sizeof(buf))
+                shorts++;
+           }
+        rc = (int) read (f[1], sink, 4096);
+        if (rc > 0)
+           rcvd += rc;
+      }
+    secs = (host_nsec () - t0) / 1e9;
+    sock = nbsock_get (f[0]);
+    printf ("benchmark: %ld MB in %.3f s, %.0f MB/s, %ld polls, %ld short sends"
+            " (%lu EAGAIN)\n", rcvd >> 20, secs, rcvd / secs / 1e6, polls,
+            shorts, (unsigned long) sock->eagains);
+    CHECK_EQ (rcvd, sent);
+    CHECK_EQ (sock->tx_bytes, (uint32_t) sent);
+    nbsock_close (f[0]);
+    close (f[1]);
+}
+
+
+int  main (void)
+{
+    test_open_close ();
+    test_stalled_peer ();
+    test_close_and_errors ();
+    test_wait ();
+    bench ();
+    return (host_test_done ("test_cc3100_nbsock"));
+}
+
+//*****************************************************************************
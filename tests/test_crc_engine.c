@@ -0,0 +1,371 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_crc_engine.c
+//
+//
+//  Host test for common/crc_engine.c.
+//
+//  The module is built three ways (see CMakeLists.txt): the default table
+//  driven software CRC, CRC_SLICE_BY_8, and USES_CRC_HW against a bit level
+//  model of the two flavors of STM32 CRC unit (programmable polynomial,
+//  and the F1/F2/F4 fixed CRC-32 word unit with its seed word re-load).
+//
+//    - known answers for all 3 algorithms, in every build
+//    - all builds agree on random data, in one piece and split into random
+//      chunks at unaligned offsets
+//    - hardware model: the unit taking all, the front part, or nothing
+//      (busy) of each chunk
+//    - crc_self_test(), bad algo
+//    - benchmark: MB/s per algorithm, table vs slice by 8
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "crc_engine.h"
+#include "host_test.h"
+#include <stdlib.h>
+
+#define  BIG_LEN       (1 << 20)
+
+typedef struct                          /* one build of the module */
+   {
+       const char  *name;
+       int         (*init) (CRC_CTX *ctx, int algo);
+       int         (*update) (CRC_CTX *ctx, const void *buf, int length);
+       uint32_t    (*final) (CRC_CTX *ctx);
+       uint32_t    (*compute) (int algo, const void *buf, int length);
+       int         (*self_test) (void);
+   } CRC_BUILD;
+
+#define  CRC_BUILD_API(p)                                                    \
+    int       p##_crc_init (CRC_CTX *ctx, int algo);                         \
+    int       p##_crc_update (CRC_CTX *ctx, const void *buf, int length);    \
+    uint32_t  p##_crc_final (CRC_CTX *ctx);                                  \
+    uint32_t  p##_crc_compute (int algo, const void *buf, int length);       \
+    int       p##_crc_self_test (void);
+
+CRC_BUILD_API (table)
+CRC_BUILD_API (slice8)
+CRC_BUILD_API (hw)
+
+#define  CRC_BUILD_ENTRY(p)                                                  \
+    { #p, p##_crc_init, p##_crc_update, p##_crc_final, p##_crc_compute,      \
+      p##_crc_self_test }
+
+static const CRC_BUILD  builds [] =
+   { CRC_BUILD_ENTRY (table), CRC_BUILD_ENTRY (slice8), CRC_BUILD_ENTRY (hw) };
+
+#define  NUM_BUILDS    ((int) (sizeof(builds) / sizeof(builds[0])))
+
+#define  HW_NONE       0                // no CRC unit / always busy
+#define  HW_PROG       1                // programmable poly, byte fed
+#define  HW_F4         2                // fixed CRC-32, 32 bit words only
+
+static int       hw_mode;
+static long      hw_bytes;              // bytes the "unit" did
+static uint8_t   big [BIG_LEN];
+
+
+//*****************************************************************************
+//  Model of the STM32 CRC unit
+//
+//          An MSB first shift register of width 16 or 32, as the reference
+//          manuals describe it. Reflected algorithms are fed bit reversed
+//          bytes (REV_IN) and read out bit reversed (REV_OUT).
+//*****************************************************************************
+static uint32_t  bit_rev (uint32_t v, int width)
+{
+    uint32_t  r;
+    int       i;
+
+    for (r = 0, i = 0;  i < width;  i++, v >>= 1)
+      r = (r << 1) | (v & 1);
+    return (r);
+}
+
+static uint32_t  unit_shift (uint32_t dr, uint32_t poly, int width,
+                             uint32_t data, int nbits)
+{
+    uint32_t  top;
+    int       i;
+
+    for (i = nbits - 1;  i >= 0;  i--)
+      { top = (dr >> (width - 1)) & 1;
+        dr <<= 1;
+        if (width < 32)
+           dr &= (1UL << width) - 1;
+        if (top ^ ((data >> i) & 1))
+           dr ^= poly;
+      }
+    return (dr);
+}
+
+            // F4: the word that takes DR from 0xFFFFFFFF to target
+static uint32_t  unit_seed_word (uint32_t target)
+{
+    int  i;
+
+    for (i = 0;  i < 32;  i++)
+      target = (target & 1) ? ((target ^ 0x04C11DB7UL) >> 1) | 0x80000000UL
+                            : target >> 1;
+    return (target ^ 0xFFFFFFFFUL);
+}
+
+int  board_crc_hw_update (int algo, uint32_t *crc, const uint8_t *buf,
+                          int length)
+{
+    uint32_t  dr;
+    uint32_t  poly;
+    uint32_t  word;
+    int       width;
+    int       refl;
+    int       done;
+
+    if (hw_mode == HW_PROG)
+       { width = (algo == CRC_32) ? 32 : 16;
+         refl  = (algo != CRC_16_CCITT);
+         poly  = (algo == CRC_32) ? 0x04C11DB7UL
+               : (algo == CRC_16_CCITT) ? 0x1021 : 0x8005;
+         dr = refl ? bit_rev (*crc, width) : *crc;
+         for (done = 0;  done < length;  done++)
+           dr = unit_shift (dr, poly, width,
+                            refl ? bit_rev (buf[done], 8) : buf[done], 8);
+         *crc = refl ? bit_rev (dr, width) : dr;
+         hw_bytes += length;
+         return (length);
+       }
+    if (hw_mode != HW_F4  ||  algo != CRC_32  ||  length < 4)
+       return (ERR_CRC_HW_UNAVAILABLE);
+
+    dr = 0xFFFFFFFFUL;                  // DR after CR_RESET
+    if (*crc != 0xFFFFFFFFUL)
+       dr = unit_shift (dr, 0x04C11DB7UL, 32, unit_seed_word (bit_rev (*crc, 32)), 32);
+    for (done = 0;  done + 4 <= length;  done += 4)
+      { memcpy (&word, buf + done, 4);  // little endian load, then RBIT
+        dr = unit_shift (dr, 0x04C11DB7UL, 32, bit_rev (word, 32), 32);
+      }
+    *crc = bit_rev (dr, 32);
+    hw_bytes += done;
+    return (done);                      // trailing 1-3 bytes left for SW
+}
+
+
+//*****************************************************************************
+//  test_known_answers
+//*****************************************************************************
+static void  test_known_answers (void)
+{
+    static const struct
+       {
+           const char  *data;
+           int         len;
+           uint32_t    crc [CRC_NUM_ALGOS];     // Modbus, CCITT, CRC-32
+       } kat [] =
+       {
+         { "",          0,  { 0xFFFF, 0xFFFF, 0x00000000UL } },
+         { "A",         1,  { 0x707F, 0xB915, 0xD3D99E8BUL } },
+         { "123456789", 9,  { CRC_16_MODBUS_CHECK, CRC_16_CCITT_CHECK, CRC_32_CHECK } },
+         { "\x01\x03\x00\x00\x00\x0A", 6, { 0xCDC5, 0x0428, 0xDDEBE1C8UL } },
+         { "The quick brown fox jumps over the lazy dog", 43,
+                        { 0xA89C, 0x8FDD, 0x414FA339UL } },
+       };
+    int  b;
+    int  k;
+    int  a;
+    int  bad;
+
+    for (hw_mode = HW_NONE;  hw_mode <= HW_F4;  hw_mode++)
+      for (b = 0;  b < NUM_BUILDS;  b++)
+        { bad = 0;
+          for (k = 0;  k < (int) (sizeof(kat) / sizeof(kat[0]));  k++)
+            for (a = 0;  a < CRC_NUM_ALGOS;  a++)
+              if (builds[b].compute (a, kat[k].data, kat[k].len) != kat[k].crc[a])
+                 { printf ("  %s hw_mode %d: kat %d algo %d wrong\n",
+                           builds[b].name, hw_mode, k, a);
+                   bad++;
+                 }
+          CHECK_EQ (bad, 0);
+          CHECK_EQ (builds[b].self_test (), 0);
+        }
+    hw_mode = HW_NONE;
+}
+
+
+//*****************************************************************************
+//  test_chunks
+//
+//          Random buffers, split into random chunks (0..300 bytes) at any
+//          offset, through every build and hardware mode, must give the
+//          table build's one piece answer.
+//*****************************************************************************
+static void  test_chunks (void)
+{
+    CRC_CTX   ctx;
+    uint32_t  ref;
+    int       len;
+    int       off;
+    int       n;
+    int       chunk;
+    int       trial;
+    int       a;
+    int       b;
+    int       bad;
+
+    bad = 0;
+    hw_bytes = 0;
+    srand (7);
+    for (trial = 0;  trial < 200;  trial++)
+      { len = 1 + rand() % 5000;
+        off = rand() % 64;
+        for (a = 0;  a < CRC_NUM_ALGOS;  a++)
+          { hw_mode = HW_NONE;
+            ref = table_crc_compute (a, big + off, len);
+            for (hw_mode = HW_NONE;  hw_mode <= HW_F4;  hw_mode++)
+              for (b = 0;  b < NUM_BUILDS;  b++)
+                { if (builds[b].compute (a, big + off, len) != ref)
+                     bad++;
+                  builds[b].init (&ctx, a);
+                  for (n = 0;  n < len;  )
+                    { chunk = rand() % 301;
+                      if (n + chunk > len)
+                         chunk = len - n;
+                      CHECK_EQ (builds[b].update (&ctx, big + off + n, chunk), 0);
+                      n += chunk;
+                    }
+                  if (builds[b].final (&ctx) != ref)
+                     bad++;
+                }
+          }
+      }
+    CHECK_EQ (bad, 0);
+    CHECK (hw_bytes > 0);               // the unit model was really used
+    hw_mode = HW_NONE;
+}
+
+
+//*****************************************************************************
+//  test_hw_split
+//
+//          F4 unit: CRC-32 only, whole words only. A 4003 byte chunk is
+//          4000 bytes in the unit, 3 in software; CRC-16 all software.
+//*****************************************************************************
+static void  test_hw_split (void)
+{
+    CRC_CTX   ctx;
+    uint32_t  ref;
+
+    ref = table_crc_compute (CRC_32, big + 1, 4003);
+    hw_mode  = HW_F4;
+    hw_bytes = 0;
+    hw_crc_init (&ctx, CRC_32);
+    hw_crc_update (&ctx, big + 1, 10);            // below CRC_HW_MIN_LENGTH
+    CHECK_EQ (hw_bytes, 0);
+    hw_crc_update (&ctx, big + 11, 3993);
+    CHECK_EQ (hw_bytes, 3992);                    // re-seeded from a running CRC
+    CHECK_EQ (hw_crc_final (&ctx), ref);
+
+    hw_bytes = 0;
+    CHECK_EQ (hw_crc_compute (CRC_16_MODBUS, big, 4000),
+              table_crc_compute (CRC_16_MODBUS, big, 4000));
+    CHECK_EQ (hw_bytes, 0);
+
+    hw_mode = HW_PROG;
+    CHECK_EQ (hw_crc_compute (CRC_16_CCITT, big, 4000),
+              table_crc_compute (CRC_16_CCITT, big, 4000));
+    CHECK_EQ (hw_bytes, 4000);
+    hw_mode = HW_NONE;
+}
+
+
+//*****************************************************************************
+//  test_errors
+//*****************************************************************************
+static void  test_errors (void)
+{
+    CRC_CTX  ctx;
+    int      b;
+
+    for (b = 0;  b < NUM_BUILDS;  b++)
+      { CHECK_EQ (builds[b].init (&ctx, CRC_NUM_ALGOS), ERR_CRC_INVALID_ALGO);
+        CHECK_EQ (builds[b].init (&ctx, -1), ERR_CRC_INVALID_ALGO);
+        CHECK_EQ (builds[b].update (0L, big, 10), ERR_CRC_INVALID_ALGO);
+        CHECK_EQ (builds[b].init (&ctx, CRC_32), 0);
+        CHECK_EQ (builds[b].update (&ctx, big, 0), 0);
+        CHECK_EQ (builds[b].update (&ctx, big, -5), 0);
+        CHECK_EQ (builds[b].final (&ctx), 0);      // CRC-32 of nothing
+      }
+}
+
+
+//*****************************************************************************
+//  bench
+//
+//          Software CRC throughput on the host, 1 MB buffer. Compares table
+//          vs slice by 8; it does not predict MCU MB/s.
+//*****************************************************************************
+static void  bench (void)
+{
+    static const char  *algo_name [CRC_NUM_ALGOS] =
+                          { "CRC-16/Modbus", "CRC-16/CCITT", "CRC-32" };
+    uint64_t  t0;
+    uint32_t  x;
+    double    mbs [2];
+    int       b;
+    int       a;
+    int       r;
+
+    printf ("benchmark (1 MB buffer, host MB/s):   table   slice-by-8\n");
+    for (a = 0;  a < CRC_NUM_ALGOS;  a++)
+      { for (b = 0;  b < 2;  b++)
+          { x = 0;
+            t0 = host_nsec ();
+            for (r = 0;  r < 20;  r++)
+              x ^= builds[b].compute (a, big, BIG_LEN);
+            mbs[b] = 20.0 * BIG_LEN / ((host_nsec () - t0) / 1e9) / 1e6;
+            CHECK (x != 0x12345678UL);          // keep the result live
+          }
+        printf ("  %-14s                      %7.0f   %7.0f\n",
+                algo_name[a], mbs[0], mbs[1]);
+      }
+}
+
+
+int  main (void)
+{
+    int  i;
+
+    srand (1);
+    for (i = 0;  i < BIG_LEN;  i++)
+      big[i] = (uint8_t) rand();
+    test_known_answers ();
+    test_chunks ();
+    test_hw_split ();
+    test_errors ();
+    bench ();
+    return (host_test_done ("test_crc_engine"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,390 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_foc_engine.c
+//
+//
+//  Host test for common/foc_engine.c, closing the current loops around a
+//  simulated surface PMSM.
+//
+//  The plant: 3 star connected phases, R = 0.5 ohm, L = 1 mH, flux
+//  0.005 Wb, 4 pole pairs, 24 V bus, 20 kHz PWM (50 usec steps, plant
+//  integrated at 10 sub-steps), +/-10 A current sense on a 12 bit ADC.
+//  The PI gains are set for a 1 kHz current loop bandwidth.
+//
+//    - sin/cos table against libm, Clarke / Park / inverse Park against
+//      the double precision transforms
+//    - SVPWM: line to line voltages, 50 % centering, linear up to
+//      FOC_VMAX_LINEAR
+//    - PI anti-windup: no overshoot after a long saturation
+//    - closed loop: iq step, load speed step, steady state iq error, and
+//      id held at 0
+//    - out of voltage at high speed: vq is the one limited, id is kept
+//    - benchmark: foc_run() ns per call
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "foc_engine.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define  PLANT_R       0.5              // ohm
+#define  PLANT_L       1e-3             // H
+#define  PLANT_FLUX    0.005            // Wb (permanent magnet)
+#define  PLANT_PP      4                // pole pairs
+#define  VBUS          24.0             // V
+#define  I_FULL_SCALE  10.0             // A at ADC full scale
+#define  TS            50e-6            // PWM / control period
+#define  SUB_STEPS     10
+
+typedef struct                          /* simulated motor */
+   {
+       double   i [3];                  // phase currents, A
+       double   theta;                  // electrical angle, rad
+       double   we;                     // electrical speed, rad/s
+   } PLANT;
+
+
+static double  q15 (int v)   { return (v / 32767.0); }
+
+static int16_t  adc_sample (double amps)
+{
+    long  code;
+
+    code = lround (amps / I_FULL_SCALE * 2048);  // 12 bit signed
+    if (code > 2047)
+       code = 2047;
+    if (code < -2048)
+       code = -2048;
+    return ((int16_t) (code << 4));             // left justified to Q15
+}
+
+static uint16_t  angle_code (double theta)
+{
+    double  t;
+
+    t = fmod (theta, 2 * M_PI);
+    if (t < 0)
+       t += 2 * M_PI;
+    return ((uint16_t) (long) (t / (2 * M_PI) * 65536.0));
+}
+
+static void  plant_step (PLANT *m, const uint16_t *duty)
+{
+    double  v [3];
+    double  vn;
+    double  e;
+    int     s;
+    int     p;
+
+    for (p = 0;  p < 3;  p++)
+      v[p] = duty[p] / 32767.0 * VBUS;
+    vn = (v[0] + v[1] + v[2]) / 3;              // star point
+    for (s = 0;  s < SUB_STEPS;  s++)
+      { for (p = 0;  p < 3;  p++)
+          { e = -PLANT_FLUX * m->we * sin (m->theta - p * 2 * M_PI / 3);
+            m->i[p] += (v[p] - vn - PLANT_R * m->i[p] - e) / PLANT_L * TS / SUB_STEPS;
+          }
+        m->theta += m->we * TS / SUB_STEPS;
+      }
+}
+
+static void  plant_dq (PLANT *m, double *id, double *iq)
+{
+    double  alpha;
+    double  beta;
+
+    alpha = m->i[0];
+    beta  = (m->i[0] + 2 * m->i[1]) / sqrt (3.0);
+    *id =  alpha * cos (m->theta) + beta * sin (m->theta);
+    *iq = -alpha * sin (m->theta) + beta * cos (m->theta);
+}
+
+static void  foc_setup (FOC_CTL *foc)
+{
+    double  wc;
+    int     kp;
+    int     ki;
+
+    wc = 2 * M_PI * 1000;                       // 1 kHz bandwidth
+    kp = (int) (PLANT_L * wc * I_FULL_SCALE / VBUS * 4096 + 0.5);
+    ki = (int) (PLANT_R * wc * TS * I_FULL_SCALE / VBUS * 4096 + 0.5);
+    foc_init (foc, (int16_t) kp, (int16_t) ki, FOC_VMAX_LINEAR);
+}
+
+
+//*****************************************************************************
+//  test_transforms
+//*****************************************************************************
+static void  test_transforms (void)
+{
+    int16_t  sv;
+    int16_t  cv;
+    int16_t  al;
+    int16_t  be;
+    int16_t  d;
+    int16_t  q;
+    double   x;
+    double   err;
+    double   max_err;
+    int      a;
+    int      k;
+    int      bad;
+
+    max_err = 0;
+    for (a = 0;  a < 65536;  a++)
+      { foc_sin_cos ((uint16_t) a, &sv, &cv);
+        x = a * 2 * M_PI / 65536;
+        err = fmax (fabs (q15 (sv) - sin (x)), fabs (q15 (cv) - cos (x)));
+        if (err > max_err)
+           max_err = err;
+      }
+    printf ("sin/cos max error %.6f\n", max_err);
+    CHECK (max_err < 0.0002);
+
+       // Clarke + Park of a balanced set = (d,q) it was built from
+    srand (3);
+    bad = 0;
+    for (k = 0;  k < 100000;  k++)
+      { double  th  = (rand() % 65536) * 2 * M_PI / 65536;
+        double  mag = (rand() % 16000) / 32767.0;
+        double  ph  = (rand() % 65536) * 2 * M_PI / 65536;
+        double  ia  = mag * cos (th + ph);
+        double  ib  = mag * cos (th + ph - 2 * M_PI / 3);
+
+        foc_clarke ((int16_t) lround (ia * 32767), (int16_t) lround (ib * 32767), &al, &be);
+        foc_sin_cos (angle_code (th), &sv, &cv);
+        foc_park (al, be, sv, cv, &d, &q);
+        if (fabs (q15 (d) - mag * cos (ph)) > 0.001
+           || fabs (q15 (q) - mag * sin (ph)) > 0.001)
+           bad++;
+        foc_inv_park (d, q, sv, cv, &al, &be);  // and back to alpha/beta
+        if (fabs (q15 (al) - ia) > 0.001)
+           bad++;
+      }
+    CHECK_EQ (bad, 0);
+}
+
+
+//*****************************************************************************
+//  test_svpwm
+//*****************************************************************************
+static void  test_svpwm (void)
+{
+    uint16_t  duty [3];
+    double    th;
+    double    mag;
+    double    vab;
+    double    want;
+    int       k;
+    int       bad;
+    int       clipped;
+
+    bad = clipped = 0;
+    for (k = 0;  k < 3600;  k++)
+      { th  = k * 2 * M_PI / 3600;
+        mag = q15 (FOC_VMAX_LINEAR) - 0.001;
+        foc_svpwm ((int16_t) lround (mag * cos (th) * 32767),
+                   (int16_t) lround (mag * sin (th) * 32767), duty);
+        vab  = q15 (duty[0]) - q15 (duty[1]);
+        want = mag * (cos (th) - cos (th - 2 * M_PI / 3));
+        if (fabs (vab - want) > 0.001)
+           bad++;
+        if (duty[0] == 0 || duty[0] == FOC_Q15_ONE || duty[1] == 0
+           || duty[1] == FOC_Q15_ONE || duty[2] == 0 || duty[2] == FOC_Q15_ONE)
+           clipped++;
+                  // max and min phase are centered on 50 %
+        if (abs ((int) (duty[0] > duty[1] ? (duty[0] > duty[2] ? duty[0] : duty[2])
+                                          : (duty[1] > duty[2] ? duty[1] : duty[2]))
+                 + (int) (duty[0] < duty[1] ? (duty[0] < duty[2] ? duty[0] : duty[2])
+                                            : (duty[1] < duty[2] ? duty[1] : duty[2]))
+                 - 2 * FOC_DUTY_HALF) > 2)
+           bad++;
+      }
+    CHECK_EQ (bad, 0);
+    CHECK_EQ (clipped, 0);              // linear range reaches 1/sqrt(3)
+
+    foc_svpwm (0, 0, duty);
+    CHECK (abs (duty[0] - FOC_DUTY_HALF) <= 1  &&  abs (duty[1] - FOC_DUTY_HALF) <= 1
+           &&  abs (duty[2] - FOC_DUTY_HALF) <= 1);
+    foc_svpwm (32767, 0, duty);         // beyond the hexagon: clamped, not wrapped
+    CHECK_EQ (duty[0], FOC_Q15_ONE);
+    CHECK_EQ (duty[1], 0);
+}
+
+
+//*****************************************************************************
+//  test_pi_windup
+//*****************************************************************************
+static void  test_pi_windup (void)
+{
+    FOC_PI   pi;
+    int16_t  out;
+    int      k;
+
+    pi.kp = 2000;
+    pi.ki = 200;
+    pi.integ = 0;
+    for (k = 0;  k < 10000;  k++)                // saturated for a long time
+      out = foc_pi_run (&pi, 8000, 5000);
+    CHECK_EQ (out, 5000);
+    CHECK (pi.integ <= (5000L << 12));
+    out = foc_pi_run (&pi, -100, 5000);          // error reverses: responds at once
+    CHECK (out < 5000);
+    for (k = 0;  k < 200;  k++)
+      out = foc_pi_run (&pi, -1000, 5000);
+    CHECK (out < 0);
+    out = foc_pi_run (&pi, -32768, 32767);
+    CHECK (out >= -32767);
+}
+
+
+//*****************************************************************************
+//  test_closed_loop
+//
+//          iq 3 A at 50 rev/s, speed +50 % at 0.5 s, iq 4 A at 1 s. The
+//          first 10 msec after each step are skipped for the steady error.
+//*****************************************************************************
+static void  test_closed_loop (void)
+{
+    FOC_CTL  foc;
+    PLANT    m;
+    double   iq_ref;
+    double   id;
+    double   iq;
+    double   err2;
+    double   id_max;
+    double   rise_err;
+    long     n;
+    long     k;
+
+    foc_setup (&foc);
+    memset (&m, 0, sizeof(m));
+    m.we  = 2 * M_PI * 50 * PLANT_PP;
+    err2  = id_max = rise_err = 0;
+    n     = 0;
+    for (k = 0;  k < 30000;  k++)
+      { iq_ref = (k < 20000) ? 3.0 : 4.0;
+        if (k == 10000)
+           m.we *= 1.5;
+        foc_set_current_ref (&foc, 0, (int16_t) (iq_ref / I_FULL_SCALE * 32767));
+        foc_run (&foc, adc_sample (m.i[0]), adc_sample (m.i[1]), angle_code (m.theta));
+        plant_step (&m, foc.duty);
+        plant_dq (&m, &id, &iq);
+        if (k == 20 + 20000)                    // 1 msec after the 3->4 A step
+           rise_err = fabs (iq - iq_ref);
+        if (k % 10000 > 200)
+           { err2 += (iq - iq_ref) * (iq - iq_ref);
+             n++;
+             if (fabs (id) > id_max)
+                id_max = fabs (id);
+           }
+      }
+    printf ("closed loop: steady RMS iq error %.4f A, |id| max %.3f A,"
+            " 1 ms after step %.3f A, %u limited steps\n",
+            sqrt (err2 / n), id_max, rise_err, (unsigned) foc.v_limited);
+    CHECK (sqrt (err2 / n) < 0.05);
+    CHECK (id_max < 0.15);
+    CHECK (rise_err < 0.2);
+    CHECK (foc.v_limited < 100);               // only right after the steps
+    CHECK_EQ (foc.steps, 30000);
+}
+
+
+//*****************************************************************************
+//  test_voltage_limit
+//
+//          150 rev/s, id -4 A (field weakening), iq 3 A: needs about 14.3 V
+//          where 13.9 V is the linear limit. The q axis runs out of voltage,
+//          the d axis current is still held at its ref.
+//*****************************************************************************
+static void  test_voltage_limit (void)
+{
+    FOC_CTL  foc;
+    PLANT    m;
+    double   id;
+    double   iq;
+    long     k;
+
+    foc_setup (&foc);
+    memset (&m, 0, sizeof(m));
+    m.we = 2 * M_PI * 150 * PLANT_PP;           // bemf 18.8 V peak
+    foc_set_current_ref (&foc, (int16_t) (-4.0 / I_FULL_SCALE * 32767),
+                         (int16_t) (3.0 / I_FULL_SCALE * 32767));
+    for (k = 0;  k < 10000;  k++)
+      { foc_run (&foc, adc_sample (m.i[0]), adc_sample (m.i[1]), angle_code (m.theta));
+        plant_step (&m, foc.duty);
+      }
+    plant_dq (&m, &id, &iq);
+    printf ("voltage limit: id %.2f A (ref -4), iq %.2f A (ref 3), %u limited steps\n",
+            id, iq, (unsigned) foc.v_limited);
+    CHECK (foc.v_limited > 5000);
+    CHECK (fabs (id + 4.0) < 0.1);
+    CHECK (iq < 2.97);
+    CHECK ((long) foc.vd * foc.vd + (long) foc.vq * foc.vq
+           <= (long) FOC_VMAX_LINEAR * FOC_VMAX_LINEAR + 2 * FOC_VMAX_LINEAR);
+}
+
+
+//*****************************************************************************
+//  bench
+//*****************************************************************************
+static void  bench (void)
+{
+    FOC_CTL   foc;
+    uint64_t  t0;
+    uint32_t  sum;
+    double    ns;
+    long      k;
+
+    foc_setup (&foc);
+    foc_set_current_ref (&foc, 0, 5000);
+    sum = 0;
+    t0 = host_nsec ();
+    for (k = 0;  k < 10000000;  k++)
+      { foc_run (&foc, (int16_t) k, (int16_t) (k * 3), (uint16_t) (k * 7));
+        sum += foc.duty[0];
+      }
+    ns = (host_nsec () - t0) / 1e7;
+    printf ("benchmark: foc_run %.1f ns per call on the host (checksum %u)\n",
+            ns, (unsigned) sum);
+    CHECK_EQ (foc.steps, 10000000);
+}
+
+
+int  main (void)
+{
+    test_transforms ();
+    test_svpwm ();
+    test_pi_windup ();
+    test_closed_loop ();
+    test_voltage_limit ();
+    bench ();
+    return (host_test_done ("test_foc_engine"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,410 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_fram_ring.c
+//
+//
+//  Host test for common/fram_ring.c, over a RAM array standing in for FRAM.
+//
+//    - format / fill / read back, in overwrite (wrap) and STOP_WHEN_FULL
+//      modes, and recovery of the ring by a re-open (reboot)
+//    - power loss at every step of a header commit: a re-open must recover
+//      either the state before the commit or the state after it, never a
+//      mix, and never report the block being committed until it is done
+//    - a partially DMA'ed block is never reported after a reboot
+//    - clear / re-open keep the write position (wear levelling)
+//    - geometry change and FORCE_FORMAT start over, parameter checks
+//
+//  The ring's ERR_FRAM_RING_xxx codes are the TI boards' (the FRAM parts
+//  are MSP430s).
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "fram_ring.h"
+#include "host_test.h"
+#include <stddef.h>
+
+#define  BLOCK_SAMPLES   24              // 3 channels x 8 frames
+#define  CHANNELS        3
+#define  NUM_BLOCKS      10
+#define  REGION_BYTES    (2 * sizeof(FRAM_RING_HDR) \
+                          + NUM_BLOCKS * BLOCK_SAMPLES * sizeof(uint16_t))
+
+static uint32_t  fram [(REGION_BYTES + 3) / 4];    // the "FRAM"
+
+
+//*****************************************************************************
+//  fill_block / block_ok
+//
+//          The DMA's view: fill the head block with samples that identify
+//          block n.  block_ok checks a block read back from the ring.
+//*****************************************************************************
+static void  fill_block (FRAM_RING *ring, uint32_t n)
+{
+    uint16_t  *dst;
+    int       i;
+
+    dst = fram_ring_dma_addr (ring, 0);
+    for (i = 0;  i < BLOCK_SAMPLES;  i++)
+      dst[i] = (uint16_t) ((n * 97) + i);
+}
+
+static int  block_ok (uint16_t *blk, uint32_t n)
+{
+    int   i;
+
+    for (i = 0;  i < BLOCK_SAMPLES;  i++)
+      if (blk[i] != (uint16_t) ((n * 97) + i))
+         return (0);
+    return (1);
+}
+
+static int  open_ring (FRAM_RING *ring, int flags)
+{
+    memset (ring, 0xA5, sizeof(FRAM_RING));  // RAM state is lost on reboot
+    return (fram_ring_open (ring, fram, REGION_BYTES, BLOCK_SAMPLES, CHANNELS, flags));
+}
+
+       // check the ring holds blocks first..last (inclusive), oldest first
+static int  ring_holds (FRAM_RING *ring, uint32_t first, uint32_t last)
+{
+    uint16_t  *blk;
+    uint32_t  n;
+    int       i;
+
+    if (ring->count != (uint16_t) (last - first + 1))
+       return (0);
+    for (i = 0, n = first;  n <= last;  i++, n++)
+      if (fram_ring_read (ring, i, &blk) != BLOCK_SAMPLES  ||  ! block_ok (blk, n))
+         return (0);
+    return (fram_ring_read (ring, i, &blk) == ERR_FRAM_RING_NO_DATA);
+}
+
+
+//*****************************************************************************
+//  test_fill_and_recover
+//*****************************************************************************
+static void  test_fill_and_recover (void)
+{
+    FRAM_RING  ring;
+    uint16_t   *next;
+    uint32_t   n;
+
+    memset (fram, 0xFF, sizeof(fram));        // erased part
+    CHECK_EQ (open_ring (&ring, 0), FRAM_RING_FORMATTED);
+    CHECK_EQ (ring.num_blocks, NUM_BLOCKS);
+    CHECK_EQ (ring.count, 0);
+    CHECK (ring_holds (&ring, 1, 0));
+
+    for (n = 1;  n <= 5;  n++)
+      { fill_block (&ring, n);
+        next = fram_ring_commit (&ring, 1000 + n);
+        CHECK (next == fram_ring_dma_addr (&ring, 0));
+      }
+    CHECK (ring_holds (&ring, 1, 5));
+    CHECK_EQ (ring.last_stamp, 1005);
+
+       // reboot: everything recovered, logging resumes after block 5
+    CHECK_EQ (open_ring (&ring, 0), FRAM_RING_RECOVERED);
+    CHECK (ring_holds (&ring, 1, 5));
+    CHECK_EQ (ring.head, 5);
+    CHECK_EQ (ring.last_stamp, 1005);
+
+       // wrap: the ring keeps the newest NUM_BLOCKS - 1 (one is the DMA's)
+    for (n = 6;  n <= 37;  n++)
+      { fill_block (&ring, n);
+        fram_ring_commit (&ring, 1000 + n);
+      }
+    CHECK (ring_holds (&ring, 37 - (NUM_BLOCKS - 1) + 1, 37));
+    CHECK_EQ (ring.wraps, 3);
+    CHECK_EQ (open_ring (&ring, 0), FRAM_RING_RECOVERED);
+    CHECK (ring_holds (&ring, 37 - (NUM_BLOCKS - 1) + 1, 37));
+    CHECK_EQ (ring.wraps, 3);
+    CHECK_EQ (ring.last_stamp, 1037);
+}
+
+
+//*****************************************************************************
+//  test_stop_when_full
+//*****************************************************************************
+static void  test_stop_when_full (void)
+{
+    FRAM_RING  ring;
+    uint16_t   *next;
+    uint32_t   n;
+
+    memset (fram, 0, sizeof(fram));
+    CHECK_EQ (open_ring (&ring, FRAM_RING_STOP_WHEN_FULL), FRAM_RING_FORMATTED);
+    next = 0L;
+    for (n = 1;  n < NUM_BLOCKS;  n++)
+      { fill_block (&ring, n);
+        next = fram_ring_commit (&ring, n);
+        if (n < NUM_BLOCKS - 1)
+           CHECK (next != 0L);
+      }
+    CHECK (next == 0L);                       // full: stop the DMA
+    CHECK_EQ (ring.full, 1);
+    CHECK (fram_ring_commit (&ring, 99) == 0L);
+    CHECK (ring_holds (&ring, 1, NUM_BLOCKS - 1));
+    CHECK_EQ (ring.last_stamp, NUM_BLOCKS - 1);
+
+    CHECK_EQ (open_ring (&ring, FRAM_RING_STOP_WHEN_FULL), FRAM_RING_RECOVERED);
+    CHECK_EQ (ring.full, 1);                  // still full after a reboot
+    CHECK (fram_ring_commit (&ring, 99) == 0L);
+
+    CHECK_EQ (fram_ring_clear (&ring), 0);
+    CHECK_EQ (ring.full, 0);
+    CHECK_EQ (ring.count, 0);
+    fill_block (&ring, 50);
+    CHECK (fram_ring_commit (&ring, 50) != 0L);
+    CHECK (ring_holds (&ring, 50, 50));
+}
+
+
+//*****************************************************************************
+//  test_power_loss
+//
+//          Replay one header commit field by field, in the order
+//          fram_ring_write_hdr() stores them, "losing power" after each
+//          store. A re-open must see either the old or the new state.
+//*****************************************************************************
+typedef struct
+   {
+       size_t   offset;
+       size_t   size;
+   } HDR_FIELD;
+
+static const HDR_FIELD  hdr_write_order [] =
+   {
+     { offsetof(FRAM_RING_HDR, seq_chk),       4 },   // invalidate
+     { offsetof(FRAM_RING_HDR, magic),         2 },
+     { offsetof(FRAM_RING_HDR, block_samples), 2 },
+     { offsetof(FRAM_RING_HDR, num_blocks),    2 },
+     { offsetof(FRAM_RING_HDR, channels),      1 },
+     { offsetof(FRAM_RING_HDR, flags),         1 },
+     { offsetof(FRAM_RING_HDR, head),          2 },
+     { offsetof(FRAM_RING_HDR, count),         2 },
+     { offsetof(FRAM_RING_HDR, wraps),         4 },
+     { offsetof(FRAM_RING_HDR, last_stamp),    4 },
+     { offsetof(FRAM_RING_HDR, seq),           4 },
+     { offsetof(FRAM_RING_HDR, seq_chk),       4 },   // commit
+   };
+#define  NUM_HDR_WRITES  ((int) (sizeof(hdr_write_order) / sizeof(HDR_FIELD)))
+
+static void  test_power_loss (void)
+{
+    static uint32_t  before [sizeof(fram) / 4];
+    static uint32_t  after  [sizeof(fram) / 4];
+    FRAM_RING        ring;
+    FRAM_RING_HDR    *slot_before;
+    FRAM_RING_HDR    *slot_after;
+    FRAM_RING_HDR    *slot;
+    uint32_t         n;
+    uint32_t         invalid_chk;
+    int              k;
+    int              i;
+    int              slot_ix;
+    int              old_ok;
+    int              new_ok;
+    int              bad;
+
+    memset (fram, 0, sizeof(fram));
+    open_ring (&ring, 0);
+    bad = 0;
+    for (n = 1;  n <= 2 * NUM_BLOCKS + 3;  n++)   // through a wrap or two
+      { fill_block (&ring, n);                   // DMA fills the head block
+        memcpy (before, fram, sizeof(fram));
+        fram_ring_commit (&ring, n);
+        memcpy (after, fram, sizeof(fram));
+        slot_ix = (int) (ring.seq & 1);           // slot the commit wrote
+
+        for (k = 0;  k < NUM_HDR_WRITES;  k++)    // power lost after store k
+          { memcpy (fram, before, sizeof(fram));
+            slot_before = (FRAM_RING_HDR*) before + slot_ix;
+            slot_after  = (FRAM_RING_HDR*) after  + slot_ix;
+            slot        = (FRAM_RING_HDR*) fram   + slot_ix;
+            invalid_chk = slot_before->seq;       // what the 1st store writes
+            for (i = 0;  i <= k;  i++)
+              { if (i == 0)
+                   memcpy ((uint8_t*) slot + hdr_write_order[0].offset,
+                           &invalid_chk, 4);
+                   else memcpy ((uint8_t*) slot + hdr_write_order[i].offset,
+                                (uint8_t*) slot_after + hdr_write_order[i].offset,
+                                hdr_write_order[i].size);
+              }
+            if (open_ring (&ring, 0) != FRAM_RING_RECOVERED)
+               { bad++;  continue; }
+            old_ok = (n == 1) ? (ring.count == 0) : ring_holds (&ring, (n <= NUM_BLOCKS) ? 1 : n - NUM_BLOCKS + 1, n - 1);
+            new_ok = ring_holds (&ring, (n < NUM_BLOCKS) ? 1 : n - NUM_BLOCKS + 2, n);
+            if (k < NUM_HDR_WRITES - 1)
+               { if ( ! old_ok  ||  ring.last_stamp != n - 1)
+                    bad++;
+               }
+              else if ( ! new_ok  ||  ring.last_stamp != n)
+                      bad++;
+          }
+
+        memcpy (fram, after, sizeof(fram));      // power stays on: carry on
+        open_ring (&ring, 0);
+      }
+    CHECK_EQ (bad, 0);
+}
+
+
+//*****************************************************************************
+//  test_partial_block
+//*****************************************************************************
+static void  test_partial_block (void)
+{
+    FRAM_RING  ring;
+    uint16_t   *dst;
+    uint16_t   *blk;
+    uint32_t   n;
+
+    memset (fram, 0, sizeof(fram));
+    open_ring (&ring, 0);
+    for (n = 1;  n <= 4;  n++)
+      { fill_block (&ring, n);
+        fram_ring_commit (&ring, n);
+      }
+    dst = fram_ring_dma_addr (&ring, 0);
+    dst[0] = 0xDEAD;                          // DMA half way through block 5
+    dst[1] = 0xBEEF;
+
+    CHECK_EQ (open_ring (&ring, 0), FRAM_RING_RECOVERED);   // reboot
+    CHECK (ring_holds (&ring, 1, 4));
+    CHECK_EQ (fram_ring_read (&ring, 4, &blk), ERR_FRAM_RING_NO_DATA);
+    CHECK (fram_ring_dma_addr (&ring, 0) == dst);          // refill it
+}
+
+
+//*****************************************************************************
+//  test_wear
+//
+//          Clearing and re-opening must never rewind the head, so every
+//          block gets filled the same number of times.
+//*****************************************************************************
+static void  test_wear (void)
+{
+    FRAM_RING  ring;
+    uint32_t   fills [NUM_BLOCKS];
+    uint32_t   n;
+    int        blk;
+    int        bad;
+
+    memset (fram, 0, sizeof(fram));
+    memset (fills, 0, sizeof(fills));
+    open_ring (&ring, 0);
+    for (n = 1;  n <= 50 * NUM_BLOCKS;  n++)
+      { blk = (int) ((fram_ring_dma_addr (&ring, 0) - ring.blocks) / BLOCK_SAMPLES);
+        fills[blk]++;
+        fill_block (&ring, n);
+        fram_ring_commit (&ring, n);
+        if (n % 7 == 0)                       // short bursts, then a clear
+           fram_ring_clear (&ring);
+        if (n % 3 == 0)
+           open_ring (&ring, 0);              // and reboots
+      }
+    bad = 0;
+    for (blk = 0;  blk < NUM_BLOCKS;  blk++)
+      if (fills[blk] != 50)
+         bad++;
+    CHECK_EQ (bad, 0);
+}
+
+
+//*****************************************************************************
+//  test_format
+//*****************************************************************************
+static void  test_format (void)
+{
+    FRAM_RING  ring;
+    uint32_t   seq;
+    uint32_t   n;
+
+    memset (fram, 0, sizeof(fram));
+    open_ring (&ring, 0);
+    for (n = 1;  n <= 3;  n++)
+      { fill_block (&ring, n);
+        fram_ring_commit (&ring, n);
+      }
+    seq = ring.seq;
+
+       // new geometry: old contents dropped, sequence carried on
+    memset (&ring, 0, sizeof(ring));
+    CHECK_EQ (fram_ring_open (&ring, fram, REGION_BYTES, 12, CHANNELS, 0),
+              FRAM_RING_FORMATTED);
+    CHECK_EQ (ring.count, 0);
+    CHECK_EQ (ring.head, 0);
+    CHECK (ring.seq > seq);
+
+       // FORCE_FORMAT discards a valid ring
+    CHECK_EQ (open_ring (&ring, 0), FRAM_RING_FORMATTED);   // back to 24
+    fill_block (&ring, 1);
+    fram_ring_commit (&ring, 1);
+    CHECK_EQ (open_ring (&ring, FRAM_RING_FORCE_FORMAT), FRAM_RING_FORMATTED);
+    CHECK_EQ (ring.count, 0);
+    CHECK_EQ (open_ring (&ring, 0), FRAM_RING_RECOVERED);
+    CHECK_EQ (ring.count, 0);
+}
+
+
+//*****************************************************************************
+//  test_bad_parms
+//*****************************************************************************
+static void  test_bad_parms (void)
+{
+    FRAM_RING  ring;
+    uint16_t   *blk;
+
+    CHECK_EQ (fram_ring_open (0L, fram, REGION_BYTES, 24, 3, 0), ERR_FRAM_RING_INVALID_PARM);
+    CHECK_EQ (fram_ring_open (&ring, 0L, REGION_BYTES, 24, 3, 0), ERR_FRAM_RING_INVALID_PARM);
+    CHECK_EQ (fram_ring_open (&ring, fram, REGION_BYTES, 24, 0, 0), ERR_FRAM_RING_INVALID_PARM);
+    CHECK_EQ (fram_ring_open (&ring, fram, REGION_BYTES, 24, 33, 0), ERR_FRAM_RING_INVALID_PARM);
+    CHECK_EQ (fram_ring_open (&ring, fram, REGION_BYTES, 25, 3, 0), ERR_FRAM_RING_INVALID_PARM);
+    CHECK_EQ (fram_ring_open (&ring, fram, REGION_BYTES, 2, 3, 0), ERR_FRAM_RING_INVALID_PARM);
+    CHECK_EQ (fram_ring_open (&ring, fram, 2 * sizeof(FRAM_RING_HDR) + 24 * 2, 24, 3, 0),
+              ERR_FRAM_RING_INVALID_PARM);          // room for only 1 block
+    CHECK_EQ (fram_ring_clear (0L), ERR_FRAM_RING_INVALID_PARM);
+    CHECK_EQ (open_ring (&ring, 0) >= 0, 1);
+    CHECK_EQ (fram_ring_read (&ring, -1, &blk), ERR_FRAM_RING_INVALID_PARM);
+    CHECK_EQ (fram_ring_read (&ring, 0, 0L), ERR_FRAM_RING_INVALID_PARM);
+}
+
+
+int  main (void)
+{
+    test_fill_and_recover ();
+    test_stop_when_full ();
+    test_power_loss ();
+    test_partial_block ();
+    test_wear ();
+    test_format ();
+    test_bad_parms ();
+    return (host_test_done ("test_fram_ring"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,442 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_input_capture.c
+//
+//
+//  Host test for common/input_capture.c, driven by synthetic edge streams.
+//
+//  A small DMA model writes each edge's (16 or 32 bit) counter value into
+//  the ring and keeps the total # of DMA writes, the way the board layer's
+//  TC lap counter reports it to icap_update().
+//
+//    - steady frequency, across many 16-bit counter rollovers
+//    - 32-bit counter, across the 2^32 wrap
+//    - random period jitter, checked against a reference window model
+//    - duty cycle with ICAP_BOTH_EDGES
+//    - h/w input prescaler (ICAP_EVENT_DIV_4)
+//    - stall (signal stops) and recovery
+//    - overrun: the DMA laps the ring (once, and more than once) between
+//      updates; edges_lost must count the overwritten edges, and the stats
+//      must be correct again once the chain restarts
+//    - parameter checks
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "input_capture.h"
+#include "host_test.h"
+#include <stdlib.h>
+
+#define  TICK_HZ      1000000UL          // 1 MHz timer: 1 tick = 1 usec
+#define  RING_SIZE    16
+
+typedef struct                           /* DMA + timer model */
+   {
+       ICAP_ENGINE  icap;
+       uint16_t     ring16 [RING_SIZE];
+       uint32_t     ring32 [RING_SIZE];
+       uint32_t     produced;            // total # DMA writes into the ring
+       uint64_t     now;                 // "true" 64-bit counter value
+       int          is_32;
+   } ICAP_SIM;
+
+
+//*****************************************************************************
+//  sim_start / sim_edge / sim_update
+//
+//          sim_edge() is the timer capturing an edge at tick t, and the DMA
+//          moving CCRx into the ring. sim_update() is timer_Capture_Update().
+//*****************************************************************************
+static void  sim_start (ICAP_SIM *sim, uint64_t start, int flags)
+{
+    memset (sim, 0, sizeof(ICAP_SIM));
+    sim->is_32 = (flags & ICAP_32_BIT_COUNTER) != 0;
+    sim->now   = start;
+    CHECK_EQ (icap_init (&sim->icap,
+                         sim->is_32 ? (void*) sim->ring32 : (void*) sim->ring16,
+                         RING_SIZE, TICK_HZ, flags), 0);
+    sim->icap.last_count = (uint32_t) start & sim->icap.counter_mask;
+    sim->icap.now_ts     = start;
+}
+
+static void  sim_edge (ICAP_SIM *sim, uint64_t t)
+{
+    if (sim->is_32)
+       sim->ring32 [sim->produced % RING_SIZE] = (uint32_t) t;
+       else sim->ring16 [sim->produced % RING_SIZE] = (uint16_t) t;
+    sim->produced++;
+    sim->now = t;
+}
+
+static int  sim_update (ICAP_SIM *sim)
+{
+    return (icap_update (&sim->icap, sim->produced,
+                         (uint32_t) sim->now & sim->icap.counter_mask));
+}
+
+
+//*****************************************************************************
+//  run_square
+//
+//          Feed num_periods periods of a square wave (rising edges period
+//          ticks apart, falling edges high ticks after them when BOTH_EDGES),
+//          calling update every upd_every captured edges. Returns the time
+//          of the last rising edge.
+//*****************************************************************************
+static uint64_t  run_square (ICAP_SIM *sim, uint64_t t, uint32_t period,
+                             uint32_t high, int num_periods, int upd_every)
+{
+    int   i;
+    int   n;
+
+    n = 0;
+    for (i = 0;  i < num_periods;  i++)
+      { t += period;
+        sim_edge (sim, t);
+        if (++n % upd_every == 0)
+           sim_update (sim);
+        if (high != 0)
+           { sim_edge (sim, t + high);
+             sim->now = t + high;
+             if (++n % upd_every == 0)
+                sim_update (sim);
+           }
+      }
+    sim_update (sim);
+    return (t);
+}
+
+
+//*****************************************************************************
+//  test_steady_16
+//*****************************************************************************
+static void  test_steady_16 (void)
+{
+    ICAP_SIM    sim;
+    ICAP_STATS  st;
+
+    sim_start (&sim, 0, ICAP_RISING_EDGE);
+    CHECK_EQ (sim.icap.counter_mask, 0xFFFF);
+
+       // 1 kHz for 10 secs: 150+ rollovers of the 16-bit counter.
+       // Default window = 100 ms = 100 periods.
+    run_square (&sim, 0, 1000, 0, 10000, 8);
+    CHECK_EQ (icap_get_stats (&sim.icap, &st), 1);
+    CHECK_EQ (st.period_count, 100);
+    CHECK_EQ (st.period_avg_ticks, 1000);
+    CHECK_EQ (st.period_min_ticks, 1000);
+    CHECK_EQ (st.period_max_ticks, 1000);
+    CHECK_EQ (st.freq_millihz, 1000000);
+    CHECK_EQ (st.window_ms, 100);
+    CHECK_EQ (st.window_end_ts, 9901ULL * 1000);    // 1st edge only starts the chain
+    CHECK_EQ (icap_get_last_edge (&sim.icap), 10000ULL * 1000);
+    CHECK_EQ (sim.icap.edges_total, 10000);
+    CHECK_EQ (sim.icap.edges_lost, 0);
+    CHECK_EQ (sim.icap.stalls, 0);
+    CHECK_EQ (icap_get_stats (&sim.icap, &st), 0);    // no new window yet
+
+       // 2.5 kHz: 400 ticks
+    run_square (&sim, sim.now, 400, 0, 1000, 5);
+    icap_get_stats (&sim.icap, &st);
+    CHECK_EQ (st.period_avg_ticks, 400);
+    CHECK_EQ (st.freq_millihz, 2500000);
+}
+
+
+//*****************************************************************************
+//  test_steady_32
+//
+//          84 MHz 32-bit counter (TIM2/TIM5), running across the 2^32 wrap.
+//*****************************************************************************
+static void  test_steady_32 (void)
+{
+    ICAP_SIM    sim;
+    ICAP_STATS  st;
+    uint64_t    t;
+
+    sim_start (&sim, 0xFFF00000ULL, ICAP_32_BIT_COUNTER);
+    sim.icap.tick_hz = 84000000UL;
+    CHECK_EQ (icap_set_window (&sim.icap, 50, 0), 0);
+    CHECK_EQ (sim.icap.counter_mask, 0xFFFFFFFF);
+
+    t = run_square (&sim, 0xFFF00000ULL, 84000, 0, 200, 4);  // 1 kHz
+    CHECK (t > 0x100000000ULL);
+    CHECK_EQ (icap_get_stats (&sim.icap, &st), 1);
+    CHECK_EQ (st.period_count, 50);
+    CHECK_EQ (st.period_avg_ticks, 84000);
+    CHECK_EQ (st.freq_millihz, 1000000);
+    CHECK_EQ (st.window_end_ts, 0xFFF00000ULL + (151ULL * 84000));
+    CHECK_EQ (icap_get_last_edge (&sim.icap), t);
+}
+
+
+//*****************************************************************************
+//  test_jitter
+//
+//          Random periods, checked window by window against a reference.
+//*****************************************************************************
+static void  test_jitter (void)
+{
+    ICAP_SIM    sim;
+    ICAP_STATS  st;
+    uint64_t    t;
+    uint64_t    sum;
+    uint32_t    period;
+    uint32_t    pmin;
+    uint32_t    pmax;
+    uint32_t    count;
+    int         i;
+    int         windows;
+    int         bad;
+
+    srand (27);
+    sim_start (&sim, 12345, ICAP_RISING_EDGE);
+    t = 12345;
+    sim_edge (&sim, t);                         // first edge: starts the chain
+    sim_update (&sim);
+
+    sum = 0;  count = 0;  pmin = 0xFFFFFFFF;  pmax = 0;
+    windows = 0;  bad = 0;
+    for (i = 0;  i < 20000;  i++)
+      { period = 500 + (uint32_t) (rand() % 1001);
+        t += period;
+        sim_edge (&sim, t);
+        sim_update (&sim);
+        sum += period;
+        count++;
+        if (period < pmin) pmin = period;
+        if (period > pmax) pmax = period;
+        if (sum >= 100000)                      // reference window closes
+           { windows++;
+             if (icap_get_stats (&sim.icap, &st) != 1
+                || st.period_count != count
+                || st.period_avg_ticks != (uint32_t) (sum / count)
+                || st.period_min_ticks != pmin
+                || st.period_max_ticks != pmax
+                || st.freq_millihz != (uint32_t) ((count * TICK_HZ * 1000ULL) / sum)
+                || st.window_end_ts != t)
+                bad++;
+             sum = 0;  count = 0;  pmin = 0xFFFFFFFF;  pmax = 0;
+           }
+          else if (icap_get_stats (&sim.icap, &st) != 0)
+                  bad++;
+      }
+    CHECK (windows > 100);
+    CHECK_EQ (bad, 0);
+}
+
+
+//*****************************************************************************
+//  test_duty
+//*****************************************************************************
+static void  test_duty (void)
+{
+    ICAP_SIM    sim;
+    ICAP_STATS  st;
+
+    sim_start (&sim, 0, ICAP_BOTH_EDGES);
+    run_square (&sim, 0, 1000, 250, 1000, 6);   // 25 % duty
+    CHECK_EQ (icap_get_stats (&sim.icap, &st), 1);
+    CHECK_EQ (st.period_avg_ticks, 1000);
+    CHECK_EQ (st.freq_millihz, 1000000);
+    CHECK_EQ (st.duty_centi_pct, 2500);
+    CHECK_EQ (sim.icap.edges_total, 2000);
+
+       // 1st DMA'ed edge is a fall: same signal, seen from the high phase
+    sim_start (&sim, 0, ICAP_BOTH_EDGES | ICAP_FIRST_EDGE_FALLING);
+    sim_edge (&sim, 750);                       // falling edge first
+    run_square (&sim, 1000, 1000, 100, 1000, 7);  // 10 % duty
+    CHECK_EQ (icap_get_stats (&sim.icap, &st), 1);
+    CHECK_EQ (st.duty_centi_pct, 1000);
+}
+
+
+//*****************************************************************************
+//  test_event_div
+//
+//          h/w prescaler: one capture per 4 input edges. Stats are per input
+//          edge.
+//*****************************************************************************
+static void  test_event_div (void)
+{
+    ICAP_SIM    sim;
+    ICAP_STATS  st;
+
+    sim_start (&sim, 0, ICAP_EVENT_DIV_4);
+    run_square (&sim, 0, 4000, 0, 500, 3);      // 1 kHz input
+    CHECK_EQ (icap_get_stats (&sim.icap, &st), 1);
+    CHECK_EQ (st.period_count, 100);
+    CHECK_EQ (st.period_avg_ticks, 1000);
+    CHECK_EQ (st.period_min_ticks, 1000);
+    CHECK_EQ (st.period_max_ticks, 1000);
+    CHECK_EQ (st.freq_millihz, 1000000);
+}
+
+
+//*****************************************************************************
+//  test_stall
+//*****************************************************************************
+static void  test_stall (void)
+{
+    ICAP_SIM    sim;
+    ICAP_STATS  st;
+    uint64_t    t;
+    int         i;
+
+    sim_start (&sim, 0, ICAP_RISING_EDGE);
+    t = run_square (&sim, 0, 1000, 0, 250, 8);
+    icap_get_stats (&sim.icap, &st);
+    CHECK_EQ (st.freq_millihz, 1000000);
+
+       // signal stops. Stall time = 1 counter rollover (65535 ticks) here,
+       // as 2 windows (200 ms) is longer. Keep updating twice per rollover.
+    for (i = 0;  i < 2;  i++)
+      { sim.now += 30000;
+        CHECK_EQ (sim_update (&sim), 0);
+        CHECK_EQ (sim.icap.stalls, 0);
+      }
+    sim.now += 30000;
+    sim_update (&sim);
+    CHECK_EQ (sim.icap.stalls, 1);
+    CHECK_EQ (icap_get_stats (&sim.icap, &st), 1);
+    CHECK_EQ (st.freq_millihz, 0);
+    CHECK_EQ (st.period_count, 0);
+    sim.now += 30000;
+    sim_update (&sim);
+    CHECK_EQ (sim.icap.stalls, 1);                // only declared once
+
+       // signal comes back: the first edge only restarts the chain, so the
+       // gap is never measured as a (too long) period
+    t = run_square (&sim, sim.now + 77, 1000, 0, 300, 8);
+    CHECK_EQ (icap_get_stats (&sim.icap, &st), 1);
+    CHECK_EQ (st.period_avg_ticks, 1000);
+    CHECK_EQ (st.period_max_ticks, 1000);
+    CHECK_EQ (st.freq_millihz, 1000000);
+    CHECK_EQ (icap_get_last_edge (&sim.icap), t);
+}
+
+
+//*****************************************************************************
+//  test_overrun
+//
+//          The DMA laps the ring between updates. produced_total then runs
+//          more than ring_size ahead of what the engine consumed, which is
+//          what the board layer's TC lap counter makes visible.
+//*****************************************************************************
+static void  test_overrun (void)
+{
+    ICAP_SIM    sim;
+    ICAP_STATS  st;
+    uint64_t    t;
+    int         i;
+
+    sim_start (&sim, 0, ICAP_RISING_EDGE);
+    CHECK_EQ (icap_set_window (&sim.icap, 20, 0), 0);
+    t = run_square (&sim, 0, 1000, 0, 100, 8);
+    CHECK_EQ (sim.icap.edges_lost, 0);
+
+       // exactly one ring's worth: nothing lost
+    for (i = 0;  i < RING_SIZE;  i++)
+      { t += 1000;  sim_edge (&sim, t); }
+    CHECK_EQ (sim_update (&sim), RING_SIZE);
+    CHECK_EQ (sim.icap.edges_lost, 0);
+
+       // one ring + 3: the 3 oldest are overwritten
+    for (i = 0;  i < RING_SIZE + 3;  i++)
+      { t += 1000;  sim_edge (&sim, t); }
+    CHECK_EQ (sim_update (&sim), RING_SIZE);
+    CHECK_EQ (sim.icap.edges_lost, 3);
+    CHECK_EQ (sim.icap.consumed, sim.produced);
+    CHECK_EQ (icap_get_last_edge (&sim.icap), t);
+
+       // more than two laps (a late update that a head < last_head lap
+       // check would have seen as a fraction of one lap)
+    for (i = 0;  i < (2 * RING_SIZE) + 5;  i++)
+      { t += 1000;  sim_edge (&sim, t); }
+    CHECK_EQ (sim_update (&sim), RING_SIZE);
+    CHECK_EQ (sim.icap.edges_lost, 3 + RING_SIZE + 5);
+    CHECK_EQ (sim.icap.consumed, sim.produced);
+    CHECK_EQ (sim.icap.edges_total, sim.produced - sim.icap.edges_lost);
+
+       // the chain restarts at the oldest surviving edge, so the lost
+       // edges never show up as a long period
+    icap_get_stats (&sim.icap, &st);
+    run_square (&sim, t, 1000, 0, 100, 8);
+    CHECK_EQ (icap_get_stats (&sim.icap, &st), 1);
+    CHECK_EQ (st.period_count, 20);
+    CHECK_EQ (st.period_avg_ticks, 1000);
+    CHECK_EQ (st.period_min_ticks, 1000);
+    CHECK_EQ (st.period_max_ticks, 1000);
+    CHECK_EQ (st.freq_millihz, 1000000);
+    CHECK_EQ (sim.icap.stalls, 0);
+
+       // produced_total wraps at 2^32
+    sim.icap.consumed = 0xFFFFFFF8UL;
+    sim.produced      = 0xFFFFFFF8UL;
+    for (i = 0;  i < RING_SIZE + 9;  i++)
+      { t += 1000;  sim_edge (&sim, t); }
+    CHECK_EQ (sim.produced, 0x11);
+    CHECK_EQ (sim_update (&sim), RING_SIZE);
+    CHECK_EQ (sim.icap.edges_lost, 3 + RING_SIZE + 5 + 9);
+    CHECK_EQ (sim.icap.consumed, sim.produced);
+}
+
+
+//*****************************************************************************
+//  test_bad_parms
+//*****************************************************************************
+static void  test_bad_parms (void)
+{
+    ICAP_ENGINE  icap;
+    uint16_t     ring [4];
+
+    CHECK_EQ (icap_init (&icap, 0L, 4, TICK_HZ, 0), ERR_TIMER_CAPTURE_INVALID_PARM);
+    CHECK_EQ (icap_init (&icap, ring, 1, TICK_HZ, 0), ERR_TIMER_CAPTURE_INVALID_PARM);
+    CHECK_EQ (icap_init (&icap, ring, 4, 0, 0), ERR_TIMER_CAPTURE_INVALID_PARM);
+    CHECK_EQ (icap_init (&icap, ring, 4, TICK_HZ, ICAP_BOTH_EDGES | ICAP_EVENT_DIV_2),
+              ERR_TIMER_CAPTURE_INVALID_PARM);
+    CHECK_EQ (icap_init (&icap, ring, 4, TICK_HZ, 0), 0);
+    CHECK_EQ (icap_set_window (&icap, 0, 0), ERR_TIMER_CAPTURE_INVALID_PARM);
+    CHECK_EQ (icap_set_window (&icap, -1, 1000), ERR_TIMER_CAPTURE_INVALID_PARM);
+    CHECK_EQ (icap_set_window (&icap, 70000, 0), ERR_TIMER_CAPTURE_INVALID_PARM);
+    CHECK_EQ (icap_set_window (&icap, 10, 0), 0);
+}
+
+
+int  main (void)
+{
+    test_steady_16 ();
+    test_steady_32 ();
+    test_jitter ();
+    test_duty ();
+    test_event_div ();
+    test_stall ();
+    test_overrun ();
+    test_bad_parms ();
+    return (host_test_done ("test_input_capture"));
+}
+
+//*****************************************************************************
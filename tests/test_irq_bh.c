@@ -0,0 +1,310 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_irq_bh.c
+//
+//
+//  Host test and benchmark for the bottom half (PendSV) dispatcher and the
+//  ISR timing stats in boards/STM32_Bds/board_STM32_irq.c, built with
+//  USES_IRQ_BOTTOM_HALF and USES_IRQ_STATS on the Cortex-M4 path.
+//
+//  "ISRs" are plain calls to board_bh_schedule(); "PendSV" is the test
+//  running board_bh_dispatch() while SCB->ICSR has PENDSVSET, as the core
+//  would once the last ISR returns. Cycles are the simulated DWT CYCCNT,
+//  which the test and the handlers step by hand.
+//
+//    - register / schedule parameter checks, the table limit
+//    - schedules from "ISRs" in any order run lowest id first, only when
+//      PendSV runs, with the events each was given
+//    - a handler scheduled again before it runs: one run, events ORed,
+//      counted as coalesced, latency from the first schedule
+//    - re-entry: an "ISR" during a handler schedules a more urgent one,
+//      and the running one again: both run, in priority order
+//    - PRIMASK is left as the caller had it
+//    - per handler and IRQ_CLASS_BOTTOM_HALF stats
+//    - benchmark: ns per schedule + dispatch
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "user_api.h"
+#include "host_test.h"
+#include <stdio.h>
+
+#define  RUN_LOG_SIZE     32
+
+static int       run_log [RUN_LOG_SIZE];       // handler ids, in run order
+static uint32_t  run_events [RUN_LOG_SIZE];
+static int       run_count;
+
+static int       reenter_id = -1;              // handler that "gets interrupted"
+static int       reenter_done;
+
+
+//*****************************************************************************
+//  handler
+//
+//          Every bottom half: log the run, take 50 * (id + 1) cycles.
+//*****************************************************************************
+static void  handler (void *parm, uint32_t events)
+{
+    int  id = (int) (intptr_t) parm;
+
+    if (run_count < RUN_LOG_SIZE)
+       { run_log [run_count]    = id;
+         run_events [run_count] = events;
+       }
+    run_count++;
+    CHECK_EQ (host_primask, 0);               // PendSV runs with IRQs on
+
+    if (id == reenter_id  &&  ! reenter_done)
+       {    // an ISR pre-empts the handler, and schedules a more urgent
+            // handler and this one again
+         reenter_done = 1;
+         CHECK_EQ (board_bh_schedule (1, 0x10), 0);
+         CHECK_EQ (board_bh_schedule (id, 0x20), 0);
+       }
+    host_dwt.CYCCNT += 50 * (uint32_t) (id + 1);
+}
+
+
+//*****************************************************************************
+//  run_pendsv
+//
+//          Take PendSV if it is pending, as the core would.
+//*****************************************************************************
+static int  run_pendsv (void)
+{
+    int  taken = 0;
+
+    while (host_scb.ICSR & SCB_ICSR_PENDSVSET_Msk)
+      { host_scb.ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+        board_bh_dispatch ();
+        taken++;
+      }
+    return (taken);
+}
+
+
+static void  clear_log (void)
+{
+    run_count    = 0;
+    reenter_id   = -1;
+    reenter_done = 0;
+}
+
+
+//*****************************************************************************
+//  test_register
+//*****************************************************************************
+static void  test_register (void)
+{
+    int  i;
+
+    CHECK_EQ (board_bh_schedule (0, 1), ERR_IRQ_INVALID_PARM);    // none yet
+    CHECK_EQ (board_bh_register (0L, 0L), ERR_IRQ_INVALID_PARM);
+
+    for (i = 0;  i < BH_MAX_HANDLERS;  i++)
+      CHECK_EQ (board_bh_register (handler, (void *) (intptr_t) i), i);
+    CHECK_EQ (board_bh_register (handler, 0L), ERR_IRQ_BH_TABLE_FULL);
+
+    CHECK_EQ (board_bh_schedule (-1, 1), ERR_IRQ_INVALID_PARM);
+    CHECK_EQ (board_bh_schedule (BH_MAX_HANDLERS, 1), ERR_IRQ_INVALID_PARM);
+    CHECK_EQ (board_bh_schedule (0, 0), ERR_IRQ_INVALID_PARM);    // no events
+    CHECK_EQ (host_scb.ICSR, 0);
+    CHECK_EQ (host_primask, 0);
+}
+
+
+//*****************************************************************************
+//  test_isr_order
+//
+//          Handlers run lowest id first, whatever order the ISRs scheduled
+//          them in, and only when PendSV is taken.
+//*****************************************************************************
+static void  test_isr_order (void)
+{
+    static const int  sched [4] = { 5, 2, 7, 0 };
+    int  i;
+
+    clear_log ();
+    for (i = 0;  i < 4;  i++)
+      CHECK_EQ (board_bh_schedule (sched[i], 1UL << sched[i]), 0);
+    CHECK (host_scb.ICSR & SCB_ICSR_PENDSVSET_Msk);
+    CHECK_EQ (run_count, 0);                   // nothing runs inside the ISRs
+
+    CHECK_EQ (run_pendsv (), 1);
+    CHECK_EQ (run_count, 4);
+    CHECK (run_log[0] == 0  &&  run_log[1] == 2  &&  run_log[2] == 5  &&  run_log[3] == 7);
+    for (i = 0;  i < 4;  i++)
+      CHECK_EQ (run_events[i], 1UL << run_log[i]);
+
+    board_bh_dispatch ();                      // a spurious PendSV: nothing to do
+    CHECK_EQ (run_count, 4);
+    CHECK_EQ (host_primask, 0);
+}
+
+
+//*****************************************************************************
+//  test_coalesce
+//
+//          Scheduled three times before it runs: one run, events ORed,
+//          latency from the first schedule.
+//*****************************************************************************
+static void  test_coalesce (void)
+{
+    BH_STATS  st;
+
+    clear_log ();
+    CHECK_EQ (board_bh_get_stats (3, &st, 1), 0);  // start clean
+
+    host_dwt.CYCCNT = 1000;
+    CHECK_EQ (board_bh_schedule (3, 0x1), 0);
+    host_dwt.CYCCNT = 1500;
+    CHECK_EQ (board_bh_schedule (3, 0x4), 0);
+    host_primask = 1;                          // from an ISR with IRQs off
+    CHECK_EQ (board_bh_schedule (3, 0x1), 0);
+    CHECK_EQ (host_primask, 1);                // left as it was
+    host_primask = 0;
+
+    host_dwt.CYCCNT = 3000;
+    run_pendsv ();
+    CHECK_EQ (run_count, 1);
+    CHECK_EQ (run_events[0], 0x5);
+
+    CHECK_EQ (board_bh_get_stats (3, &st, 0), 0);
+    CHECK_EQ (st.runs, 1);
+    CHECK_EQ (st.coalesced, 2);
+    CHECK_EQ (st.last_latency_cycles, 2000);
+    CHECK_EQ (st.max_latency_cycles, 2000);
+    CHECK_EQ (st.max_run_cycles, 200);         // 50 * (3 + 1)
+
+       // the next schedule starts a new run, and a new latency
+    host_dwt.CYCCNT = 10000;
+    CHECK_EQ (board_bh_schedule (3, 0x2), 0);
+    host_dwt.CYCCNT = 10100;
+    run_pendsv ();
+    CHECK_EQ (board_bh_get_stats (3, &st, 1), 0);
+    CHECK (st.runs == 2  &&  st.coalesced == 2);
+    CHECK (st.last_latency_cycles == 100  &&  st.max_latency_cycles == 2000);
+    CHECK_EQ (board_bh_get_stats (3, &st, 0), 0);
+    CHECK (st.runs == 0  &&  st.max_latency_cycles == 0);
+}
+
+
+//*****************************************************************************
+//  test_reentry
+//
+//          While handler 4 runs, an "ISR" schedules handler 1 and handler 4
+//          again. Dispatch rescans after each handler, so 1 runs next
+//          (ahead of 6, which was already waiting), then 4's second run.
+//*****************************************************************************
+static void  test_reentry (void)
+{
+    clear_log ();
+    reenter_id = 4;
+    CHECK_EQ (board_bh_schedule (6, 0x1), 0);
+    CHECK_EQ (board_bh_schedule (4, 0x1), 0);
+
+    run_pendsv ();
+    CHECK_EQ (run_count, 4);
+    CHECK (run_log[0] == 4  &&  run_log[1] == 1  &&  run_log[2] == 4  &&  run_log[3] == 6);
+    CHECK_EQ (run_events[0], 0x1);
+    CHECK_EQ (run_events[1], 0x10);
+    CHECK_EQ (run_events[2], 0x20);            // not merged into the run in progress
+    CHECK_EQ (run_events[3], 0x1);
+}
+
+
+//*****************************************************************************
+//  test_class_stats
+//
+//          The dispatcher records every run as IRQ_CLASS_BOTTOM_HALF; ISRs
+//          record theirs, with or without a latency.
+//*****************************************************************************
+static void  test_class_stats (void)
+{
+    IRQ_CLASS_STATS  st;
+
+    CHECK_EQ (board_irq_get_stats (IRQ_NUM_CLASSES, &st, 0), ERR_IRQ_INVALID_PARM);
+    CHECK_EQ (board_irq_get_stats (IRQ_CLASS_HARD_RT, 0L, 0), ERR_IRQ_INVALID_PARM);
+    CHECK_EQ (board_bh_get_stats (BH_MAX_HANDLERS, (BH_STATS *) 0L, 0), ERR_IRQ_INVALID_PARM);
+
+    CHECK_EQ (board_irq_get_stats (IRQ_CLASS_BOTTOM_HALF, &st, 1), 0);
+    CHECK_EQ (st.count, 4 + 2 + 4);            // every run so far
+    CHECK_EQ (st.latency_samples, st.count);
+    CHECK_EQ (st.max_latency_cycles, 2000);
+    CHECK_EQ (st.max_run_cycles, 50 * 8);      // handler 7
+    CHECK_EQ (board_irq_get_stats (IRQ_CLASS_BOTTOM_HALF, &st, 0), 0);
+    CHECK_EQ (st.count, 0);
+
+    board_irq_stats_record (IRQ_CLASS_HARD_RT, 120, 300);
+    board_irq_stats_record (IRQ_CLASS_HARD_RT, IRQ_LATENCY_UNKNOWN, 900);
+    board_irq_stats_record (IRQ_CLASS_HARD_RT, 40, 100);
+    board_irq_stats_record (IRQ_NUM_CLASSES, 1, 1);       // ignored
+    CHECK_EQ (board_irq_get_stats (IRQ_CLASS_HARD_RT, &st, 1), 0);
+    CHECK_EQ (st.count, 3);
+    CHECK_EQ (st.latency_samples, 2);
+    CHECK (st.min_latency_cycles == 40  &&  st.max_latency_cycles == 120);
+    CHECK (st.last_run_cycles == 100  &&  st.max_run_cycles == 900);
+    CHECK_EQ (host_primask, 0);
+}
+
+
+//*****************************************************************************
+//  bench
+//*****************************************************************************
+static void  bench (void)
+{
+    uint64_t  t0, t1;
+    long      k;
+    const long N = 2000000;
+
+    clear_log ();
+    t0 = host_nsec ();
+    for (k = 0;  k < N;  k++)
+      { board_bh_schedule ((int) (k & 7), 1);
+        if ((k & 7) == 7)
+           run_pendsv ();
+      }
+    t1 = host_nsec ();
+    CHECK_EQ (run_count, N);
+    printf ("benchmark: schedule + dispatch (8 per PendSV) %.1f ns per handler run\n",
+            (double) (t1 - t0) / N);
+}
+
+
+int  main (void)
+{
+    test_register ();
+    test_isr_order ();
+    test_coalesce ();
+    test_reentry ();
+    test_class_stats ();
+    bench ();
+    return (host_test_done ("test_irq_bh"));
+}
+
+//*****************************************************************************
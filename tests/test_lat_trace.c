@@ -0,0 +1,410 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_lat_trace.c
+//
+//
+//  Host replay test and benchmark for common/lat_trace.c.
+//
+//  Built with USES_TIMESTAMP, so LAT_TRACE_NOW() is the board default,
+//  sys_Get_Timestamp_Ticks(), which reads the simulated DWT cycle counter
+//  (host_dwt.CYCCNT). The test moves it forward by hand as a 216 MHz part
+//  would, so every latency is known exactly. The 32-bit counter wraps many times over a
+//  run, as it does on the board.
+//
+//    - histograms: p50 / p90 / p99 / max of 20000 random latencies, from
+//      1 usec to 0.5 secs, within the 25% bucket bound of the exact values
+//    - pipeline replay: fixed per-stage delays with 1% late pickups, each
+//      payload encoded with the telemetry codec and put in an MQTT PUBLISH
+//      that a loopback "transport" decodes; the PUBLISH / XMIT stamps are
+//      taken through lat_trace_stamp_current(), the way MQTTPublish takes
+//      them (MQTTClient.c needs the board's timer / network headers and is
+//      not built here)
+//    - first stamp wins, skipped stages, incomplete samples, worst sample
+//    - lat_trace_encode() as JSON and CBOR, decoded back
+//    - benchmark: ns per stamp and per close
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "lat_trace.h"
+#include "MQTTPacket.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define  SIM_HZ           216000000u
+#define  HIST_SAMPLES     20000
+#define  PIPE_SAMPLES     5000
+#define  LATE_EVERY       100          // 1 sample in 100 is picked up late
+#define  LATE_USEC        2000
+
+typedef struct
+   {
+       uint32_t  v;
+   } V_REC;
+
+static const TCODEC_FIELD  v_fields [] =
+   { TCODEC_FIELD_NAMED ("v", V_REC, v, TCODEC_T_UINT32, 0) };
+
+typedef struct
+   {
+       uint32_t  n;
+       uint32_t  inc;
+   } REPORT_REC;
+
+static const TCODEC_FIELD  report_fields [] =
+   { TCODEC_FIELD (REPORT_REC, n,   TCODEC_T_UINT32, 0),
+     TCODEC_FIELD (REPORT_REC, inc, TCODEC_T_UINT32, 0) };
+
+static uint32_t  hist_lat [HIST_SAMPLES];
+
+            // loopback transport
+static uint32_t  xmit_usec;
+static uint32_t  last_val;
+static int       pubs_seen;
+
+
+//*****************************************************************************
+//  sim_advance_usec
+//
+//          Let usec pass on the simulated 216 MHz counter.
+//*****************************************************************************
+static void  sim_advance_usec (uint32_t usec)
+{
+    host_dwt.CYCCNT += usec * (SIM_HZ / 1000000u);
+}
+
+
+static int  cmp_u32 (const void *a, const void *b)
+{
+    uint32_t  x = *(const uint32_t *) a;
+    uint32_t  y = *(const uint32_t *) b;
+
+    return ((x < y) ? -1 : (x > y));
+}
+
+
+//*****************************************************************************
+//  test_histogram
+//
+//          Percentiles from the log-linear histogram against exact ones.
+//*****************************************************************************
+static void  test_histogram (void)
+{
+    LAT_TRACE  t;
+    LAT_STATS  st;
+    uint32_t   exact;
+    uint32_t   got;
+    double     worst;
+    int        per_mille [4] = { 500, 900, 990, 1000 };
+    int        i;
+
+    CHECK_EQ (lat_trace_init (999999), ERR_LAT_TRACE_INVALID_PARM);
+    SystemCoreClock = SIM_HZ;
+    CHECK_EQ (lat_trace_init (LAT_TRACE_TICK_HZ), 0);
+
+    srand (1);
+    host_dwt.CYCCNT = 0xFFFF0000u;          // wrap on the first sample
+    for (i = 0;  i < HIST_SAMPLES;  i++)
+      { hist_lat[i] = (1u << (rand() % 20)) + (uint32_t) (rand() % 1000);
+        lat_trace_begin (&t, host_dwt.CYCCNT);
+        sim_advance_usec (hist_lat[i]);
+        lat_trace_stamp (&t, LAT_STAGE_PROCESS);
+        lat_trace_close (&t);
+      }
+    qsort (hist_lat, HIST_SAMPLES, sizeof(uint32_t), cmp_u32);
+
+    worst = 1.0;
+    for (i = 0;  i < 4;  i++)
+      { exact = hist_lat [(HIST_SAMPLES * per_mille[i] + 999) / 1000 - 1];
+        got   = lat_trace_get_percentile (LAT_HIST_END_TO_END, per_mille[i]);
+        CHECK (got + 1 >= exact  &&  got <= exact + exact / 4 + 1);
+        if ((double) got / exact > worst)
+           worst = (double) got / exact;
+      }
+
+    CHECK_EQ (lat_trace_get_stats (LAT_STAGE_PROCESS, &st), 0);
+    CHECK_EQ (st.count, HIST_SAMPLES);
+    CHECK (st.min_usec + 1 >= hist_lat[0]);
+    CHECK (st.max_usec <= hist_lat[HIST_SAMPLES - 1]);
+    CHECK (lat_trace_get_stats (LAT_NUM_STAGES, &st) < 0);
+
+    printf ("histogram: %d samples, p50 / p90 / p99 / max within %.1f%% of exact\n",
+            HIST_SAMPLES, (worst - 1.0) * 100.0);
+}
+
+
+//*****************************************************************************
+//  loopback_write
+//
+//          The "transport": takes xmit_usec, then decodes the PUBLISH it was
+//          handed and checks the payload is the sample being sent.
+//*****************************************************************************
+static void  loopback_write (unsigned char *pkt, int len)
+{
+    unsigned char   dup;
+    unsigned char   retained;
+    unsigned short  msg_id;
+    unsigned char   *payload;
+    int             payload_len;
+    int             qos;
+    MQTTString      topic;
+    V_REC           rec;
+    uint32_t        mask;
+
+    sim_advance_usec (xmit_usec);
+
+    CHECK_EQ (MQTTDeserialize_publish (&dup, &qos, &retained, &msg_id, &topic,
+                                       &payload, &payload_len, pkt, len), 1);
+    CHECK (topic.lenstring.len == 3  &&  memcmp (topic.lenstring.data, "s/a", 3) == 0);
+
+    rec.v = ~last_val;
+    CHECK (tcodec_dec_record (payload, payload_len, TCODEC_AUTO, v_fields,
+                              TCODEC_NUM_FIELDS(v_fields), &rec, &mask) >= 0);
+    CHECK_EQ (rec.v, last_val);
+    pubs_seen++;
+}
+
+
+//*****************************************************************************
+//  publish
+//
+//          What MQTTPublish does for a QoS 0 message: build the packet,
+//          stamp PUBLISH, write it, stamp XMIT. It only sees the current
+//          trace, never the sample.
+//*****************************************************************************
+static void  publish (unsigned char *payload, int payload_len, uint32_t build_usec)
+{
+    unsigned char  pkt [64];
+    MQTTString     topic = MQTTString_initializer;
+    int            len;
+
+    topic.cstring = (char *) "s/a";
+    len = MQTTSerialize_publish (pkt, sizeof(pkt), 0, 0, 0, 0, topic,
+                                 payload, payload_len);
+    CHECK (len > 0);
+    sim_advance_usec (build_usec);
+    lat_trace_stamp_current (LAT_STAGE_PUBLISH);
+
+    loopback_write (pkt, len);
+    lat_trace_stamp_current (LAT_STAGE_XMIT);
+}
+
+
+//*****************************************************************************
+//  test_pipeline
+//
+//          Replay of the sensor -> broker pipeline with fixed stage delays:
+//          every stage's percentiles have to land on its delay.
+//*****************************************************************************
+static void  test_pipeline (void)
+{
+    static const uint32_t  delay [LAT_NUM_STAGES] = { 0, 40, 15, 3, 300 };
+    LAT_TRACE      t;
+    LAT_TRACE      w;
+    LAT_STATS      st;
+    TCODEC_ENC     e;
+    unsigned char  pl [32];
+    uint32_t       frame;
+    uint16_t       seq0;
+    int            n;
+    int            i;
+
+    lat_trace_reset ();
+    pubs_seen = 0;
+    seq0      = 0;
+    xmit_usec = delay [LAT_STAGE_XMIT];
+    for (i = 0;  i < PIPE_SAMPLES;  i++)
+      { frame = host_dwt.CYCCNT;                  // the DMA ISR's stamp
+        sim_advance_usec (delay[LAT_STAGE_PROCESS]
+                          + ((i % LATE_EVERY) == 0 ? LATE_USEC : 0));
+        lat_trace_begin (&t, frame);
+        lat_trace_stamp (&t, LAT_STAGE_PROCESS);
+        if (i == 0)
+           seq0 = t.seq;
+
+        last_val = (uint32_t) i;
+        tcodec_enc_init (&e, pl, sizeof(pl), (i & 1) ? TCODEC_CBOR : TCODEC_JSON);
+        tcodec_enc_map_begin (&e, 1);
+        tcodec_enc_key (&e, "v");
+        tcodec_enc_uint (&e, (uint32_t) i);
+        tcodec_enc_map_end (&e);
+        n = tcodec_enc_finish (&e);
+        CHECK (n > 0);
+        sim_advance_usec (delay[LAT_STAGE_ENCODE]);
+        lat_trace_stamp (&t, LAT_STAGE_ENCODE);
+
+        lat_trace_set_current (&t);
+        publish (pl, n, delay[LAT_STAGE_PUBLISH]);
+        lat_trace_close (&t);
+        lat_trace_stamp_current (LAT_STAGE_XMIT);   // none current: ignored
+      }
+    CHECK_EQ (pubs_seen, PIPE_SAMPLES);
+
+    CHECK_EQ (lat_trace_get_stats (LAT_STAGE_XMIT, &st), 0);
+    CHECK_EQ (st.count, PIPE_SAMPLES);
+    CHECK (st.min_usec >= 299  &&  st.max_usec <= 300);
+    CHECK_EQ (lat_trace_get_stats (LAT_STAGE_PUBLISH, &st), 0);
+    CHECK (st.min_usec >= 2  &&  st.max_usec <= 3);
+    CHECK_EQ (lat_trace_get_stats (LAT_STAGE_PROCESS, &st), 0);
+    CHECK (st.p50_usec >= 40  &&  st.p50_usec <= 50  &&  st.p99_usec <= 50);
+    CHECK (st.max_usec >= 2039);
+    CHECK_EQ (lat_trace_get_stats (LAT_HIST_END_TO_END, &st), 0);
+    CHECK (st.p50_usec >= 358  &&  st.p50_usec <= 358 + 358 / 4);
+    CHECK_EQ (st.max_usec, LATE_USEC + 358);
+
+       // the worst sample is one of the late ones, stamped all the way
+    CHECK_EQ (lat_trace_get_worst (&w), 0);
+    CHECK_EQ ((uint16_t) (w.seq - seq0) % LATE_EVERY, 0);
+    CHECK_EQ (w.stamped, 0x1F);
+    CHECK_EQ (w.stamp[LAT_STAGE_XMIT] - w.stamp[LAT_STAGE_SAMPLE],
+              (LATE_USEC + 358) * (SIM_HZ / 1000000u));
+}
+
+
+//*****************************************************************************
+//  test_partial
+//
+//          First stamp wins; a skipped stage is timed from the one before
+//          it; a sample with nothing past the origin is not counted.
+//*****************************************************************************
+static void  test_partial (void)
+{
+    LAT_TRACE  t;
+    LAT_STATS  st;
+
+    lat_trace_reset ();
+    lat_trace_begin (&t, host_dwt.CYCCNT);
+    sim_advance_usec (10);
+    lat_trace_stamp (&t, LAT_STAGE_PROCESS);
+    sim_advance_usec (20);
+    lat_trace_stamp (&t, LAT_STAGE_PUBLISH);      // no ENCODE stamp
+    sim_advance_usec (500);
+    lat_trace_stamp (&t, LAT_STAGE_PUBLISH);      // a retry: does not move it
+    lat_trace_stamp (&t, LAT_NUM_STAGES);         // bad stage: ignored
+    lat_trace_close (&t);
+
+    lat_trace_begin (&t, host_dwt.CYCCNT);        // origin only
+    lat_trace_close (&t);
+
+    lat_trace_get_stats (LAT_STAGE_ENCODE, &st);
+    CHECK_EQ (st.count, 0);
+    lat_trace_get_stats (LAT_STAGE_PUBLISH, &st);
+    CHECK (st.count == 1  &&  st.min_usec >= 19  &&  st.max_usec <= 20);
+    lat_trace_get_stats (LAT_HIST_END_TO_END, &st);
+    CHECK (st.count == 1  &&  st.max_usec == 30);
+
+    lat_trace_stamp (0L, LAT_STAGE_PROCESS);      // no trace: ignored
+    lat_trace_close (0L);
+}
+
+
+//*****************************************************************************
+//  test_encode
+//
+//          The stats report, as JSON and CBOR; the CBOR decodes back.
+//*****************************************************************************
+static void  test_encode (void)
+{
+    unsigned char  out [512];
+    TCODEC_ENC     e;
+    REPORT_REC     rep;
+    uint32_t       mask;
+    int            n;
+    int            i;
+
+    test_pipeline ();
+
+    tcodec_enc_init (&e, out, sizeof(out) - 1, TCODEC_JSON);
+    lat_trace_encode (&e);
+    n = tcodec_enc_finish (&e);
+    CHECK (n > 0);
+    if (n > 0)
+       { out[n] = '\0';
+         CHECK (strstr ((char *) out, ",2358]") != 0L);      // e2e max
+         printf ("json %d bytes: %s\n", n, out);
+       }
+
+    tcodec_enc_init (&e, out, sizeof(out), TCODEC_CBOR);
+    lat_trace_encode (&e);
+    n = tcodec_enc_finish (&e);
+    CHECK (n > 0);
+    printf ("cbor %d bytes\n", n);
+    memset (&rep, 0xFF, sizeof(rep));
+    CHECK (tcodec_dec_record (out, n, TCODEC_AUTO, report_fields,
+                              TCODEC_NUM_FIELDS(report_fields), &rep, &mask) >= 0);
+    CHECK_EQ (mask, 3);
+    CHECK_EQ (rep.inc, 0);
+
+       // too small a buffer is an error, not a truncated report
+    for (i = 1;  i < 16;  i++)
+      { tcodec_enc_init (&e, out, i, TCODEC_CBOR);
+        lat_trace_encode (&e);
+        CHECK (tcodec_enc_finish (&e) < 0);
+      }
+}
+
+
+//*****************************************************************************
+//  bench
+//*****************************************************************************
+static void  bench (void)
+{
+    LAT_TRACE  t;
+    uint64_t   t0, t1, t2;
+    long       k;
+    const long N = 10000000;
+
+    lat_trace_begin (&t, 0);
+    t0 = host_nsec ();
+    for (k = 0;  k < N;  k++)
+      { t.stamped = 1;                    // keep every stamp a first one
+        lat_trace_stamp (&t, 1 + (int) (k & 3));
+      }
+    t1 = host_nsec ();
+    for (k = 0;  k < N / 10;  k++)
+      { lat_trace_begin (&t, 0);
+        t.stamp [LAT_STAGE_XMIT] = (uint32_t) k * 50;
+        t.stamped = 0x11;
+        lat_trace_close (&t);
+      }
+    t2 = host_nsec ();
+    printf ("benchmark: stamp %.1f ns   close %.1f ns\n",
+            (double) (t1 - t0) / N, (double) (t2 - t1) / (N / 10));
+}
+
+
+int  main (void)
+{
+    test_histogram ();
+    test_pipeline ();
+    test_partial ();
+    test_encode ();
+    bench ();
+    return (host_test_done ("test_lat_trace"));
+}
+
+//*****************************************************************************
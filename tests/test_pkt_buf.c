@@ -0,0 +1,256 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_pkt_buf.c
+//
+//
+//  Host test and benchmark for common/pkt_buf.c.
+//
+//    - push / pull / put limits against the headroom and tailroom
+//    - append across a chain of blocks, copy_out at any offset
+//    - shared references: a block kept by a second owner survives the free
+//      of the chain it was in, and the rest goes back to the pool
+//    - pool exhaustion, alloc_fails, high water mark and its reset
+//    - built with HOST_CORTEX_M=4: the PRIMASK critical sections restore the
+//      caller's mask, so the calls are safe from a masked (ISR) context
+//    - benchmark: a radio frame (96 bytes, 5 byte header) to an MQTT
+//      PUBLISH, copied through per layer buffers as the SPIRIT1 and MQTT
+//      code did, against received once into a PKT_BUF with the MQTT
+//      header pushed in front
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "pkt_buf.h"
+#include "MQTTPacket.h"
+#include "host_test.h"
+#include <stdio.h>
+
+static uint8_t   sock_buf [512];        // simulated socket send
+static volatile uint32_t  sink;
+
+
+static void  sock_write (const uint8_t *buf, int len)
+{
+    memcpy (sock_buf, buf, len);
+    sink += buf[len - 1];
+}
+
+static int  pool_in_use (void)
+{
+    PKTBUF_STATS  st;
+
+    pktbuf_get_stats (&st, 0);
+    return (st.in_use);
+}
+
+
+//*****************************************************************************
+//  test_block_ops
+//*****************************************************************************
+static void  test_block_ops (void)
+{
+    PKT_BUF  *a;
+    uint8_t  *h;
+    uint8_t  tmp [600];
+    uint8_t  out [611];
+    int      used;
+    int      room;
+    int      i;
+
+    pktbuf_init ();
+    a = pktbuf_alloc (PKTBUF_HEADROOM);
+    CHECK (a != 0L);
+    CHECK_EQ (pktbuf_headroom (a), PKTBUF_HEADROOM);
+    CHECK_EQ (a->len, 0);
+    CHECK_EQ (a->refs, 1);
+    CHECK (pktbuf_alloc (PKTBUF_BLOCK_SIZE + 1) == 0L);
+    CHECK (pktbuf_alloc (-1) == 0L);
+
+    CHECK (pktbuf_put (a, PKTBUF_BLOCK_SIZE - PKTBUF_HEADROOM + 1) == 0L);
+    memcpy (pktbuf_put (a, 10), "0123456789", 10);
+    CHECK (pktbuf_pull (a, 11) == 0L);
+    CHECK (pktbuf_pull (a, 2) == pktbuf_data (a));
+    CHECK (a->len == 8  &&  pktbuf_data (a)[0] == '2');
+    h = pktbuf_push (a, 3);
+    memcpy (h, "HDR", 3);
+    CHECK_EQ (a->len, 11);
+    CHECK (pktbuf_push (a, PKTBUF_HEADROOM + 3) == 0L);
+    CHECK_EQ (pktbuf_tailroom (a), PKTBUF_BLOCK_SIZE - pktbuf_headroom (a) - 11);
+    room = pktbuf_tailroom (a);
+
+       // append spills into a chain; copy_out reads across it
+    for (i = 0;  i < 600;  i++)
+      tmp[i] = (uint8_t) (i * 7);
+    CHECK_EQ (pktbuf_append (a, tmp, 600), 0);
+    CHECK_EQ (pktbuf_total_len (a), 611);
+    CHECK (a->next != 0L);
+    CHECK_EQ (pktbuf_copy_out (a, 0, out, 611), 611);
+    CHECK (memcmp (out, "HDR23456789", 11) == 0  &&  memcmp (out + 11, tmp, 600) == 0);
+    CHECK_EQ (pktbuf_copy_out (a, 300, out, 1000), 311);
+    CHECK (memcmp (out, tmp + 289, 311) == 0);
+    CHECK_EQ (pktbuf_copy_out (a, 611, out, 10), 0);
+    used = pool_in_use ();              // new blocks have no headroom
+    CHECK_EQ (used, 1 + (600 - room + PKTBUF_BLOCK_SIZE - 1) / PKTBUF_BLOCK_SIZE);
+
+       // a second owner of the 2nd block keeps it (and what follows it)
+    pktbuf_ref (a->next);
+    h = (uint8_t*) a->next;
+    pktbuf_free (a);
+    CHECK_EQ (pool_in_use (), used - 1);
+    pktbuf_free ((PKT_BUF*) h);
+    CHECK_EQ (pool_in_use (), 0);
+
+       // trim, and chain two single blocks: one free releases both
+    a = pktbuf_alloc (0);
+    pktbuf_put (a, 50);
+    pktbuf_trim (a, 20);
+    CHECK_EQ (a->len, 20);
+    pktbuf_chain (a, pktbuf_alloc (0));
+    CHECK_EQ (pool_in_use (), 2);
+    pktbuf_free (a);
+    CHECK_EQ (pool_in_use (), 0);
+
+    CHECK_EQ (pktbuf_append (0L, tmp, 1), ERR_PKTBUF_INVALID_PARM);
+    CHECK_EQ (host_primask, 0);
+}
+
+
+//*****************************************************************************
+//  test_pool
+//*****************************************************************************
+static void  test_pool (void)
+{
+    PKTBUF_STATS  st;
+    PKT_BUF       *all [PKTBUF_NUM_BLOCKS];
+    uint8_t       tmp [PKTBUF_BLOCK_SIZE + 1];
+    int           i;
+
+    pktbuf_init ();
+    pktbuf_get_stats (&st, 1);
+    CHECK_EQ (st.num_blocks, PKTBUF_NUM_BLOCKS);
+
+       // allocate from a masked (ISR) context: the mask is left as it was
+    host_primask = 1;
+    for (i = 0;  i < PKTBUF_NUM_BLOCKS;  i++)
+      { all[i] = pktbuf_alloc (0);
+        CHECK (all[i] != 0L);
+      }
+    CHECK_EQ (host_primask, 1);
+    host_primask = 0;
+
+    CHECK (pktbuf_alloc (0) == 0L);
+    memset (tmp, 0, sizeof(tmp));
+    CHECK_EQ (pktbuf_append (all[0], tmp, sizeof(tmp)), ERR_PKTBUF_NO_BUFFERS);
+    CHECK_EQ (all[0]->len, PKTBUF_BLOCK_SIZE);      // what fit was appended
+
+    pktbuf_get_stats (&st, 1);                      // read, then reset
+    CHECK_EQ (st.alloc_fails, 2);
+    CHECK_EQ (st.high_water, PKTBUF_NUM_BLOCKS);
+    CHECK_EQ (st.in_use, PKTBUF_NUM_BLOCKS);
+    for (i = 0;  i < PKTBUF_NUM_BLOCKS;  i++)
+      pktbuf_free (all[i]);
+    pktbuf_get_stats (&st, 0);
+    CHECK_EQ (st.in_use, 0);
+    CHECK_EQ (st.alloc_fails, 0);
+    CHECK_EQ (st.high_water, PKTBUF_NUM_BLOCKS);    // reset to in_use at the time
+    CHECK_EQ (host_primask, 0);
+}
+
+
+//*****************************************************************************
+//  bench
+//*****************************************************************************
+static void  bench (void)
+{
+    static const char  topic_name [] = "plant/boiler/temp";
+    MQTTString  topic = MQTTString_initializer;
+    uint8_t     fifo [96];
+    uint8_t     rx_frame [96];
+    uint8_t     data_buf [96];
+    uint8_t     pkt [256];
+    uint8_t     *q;
+    PKT_BUF     *pb;
+    uint64_t    t0,  t1,  t2,  t3;
+    long        k;
+    int         i;
+    int         n;
+    int         rem;
+    const long  N = 2000000;
+
+    pktbuf_init ();
+    topic.cstring = (char*) topic_name;
+    for (i = 0;  i < 96;  i++)
+      fifo[i] = (uint8_t) i;
+
+       // per layer buffers: FIFO -> rx frame -> app data -> MQTT packet
+    t0 = host_nsec ();
+    for (k = 0;  k < N;  k++)
+      { fifo[0] = (uint8_t) k;
+        memcpy (rx_frame, fifo, 96);
+        for (i = 5;  i < 96;  i++)
+          data_buf[i - 5] = rx_frame[i];
+        n = MQTTSerialize_publish (pkt, sizeof(pkt), 0, 0, 0, 0, topic, data_buf, 91);
+        sock_write (pkt, n);
+      }
+    t1 = host_nsec ();
+    memcpy (data_buf, sock_buf, n);     // keep for the compare below
+
+       // PKT_BUF: one copy out of the FIFO, header pushed in front
+    for (k = 0;  k < N;  k++)
+      { fifo[0] = (uint8_t) k;
+        pb = pktbuf_alloc (PKTBUF_HEADROOM);
+        memcpy (pktbuf_put (pb, 96), fifo, 96);
+        pktbuf_pull (pb, 5);
+        rem = 2 + strlen (topic_name) + pb->len;
+        q = pktbuf_push (pb, MQTTPacket_len (rem) - pb->len);
+        *q++ = 0x30;                    // PUBLISH, QoS 0
+        q += MQTTPacket_encode (q, rem);
+        writeMQTTString (&q, topic);
+        sock_write (pktbuf_data (pb), pb->len);
+        pktbuf_free (pb);
+      }
+    t2 = host_nsec ();
+    CHECK (memcmp (sock_buf, data_buf, n) == 0);    // same bytes on the wire
+    CHECK_EQ (pool_in_use (), 0);
+
+    for (k = 0;  k < N;  k++)
+      pktbuf_free (pktbuf_alloc (0));
+    t3 = host_nsec ();
+    printf ("benchmark: radio frame -> MQTT PUBLISH  per layer copies %.1f ns   "
+            "PKT_BUF %.1f ns   (alloc + free %.1f ns)\n",
+            (double) (t1 - t0) / N, (double) (t2 - t1) / N, (double) (t3 - t2) / N);
+}
+
+
+int  main (void)
+{
+    test_block_ops ();
+    test_pool ();
+    bench ();
+    return (host_test_done ("test_pkt_buf"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,493 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_ring_buf.c
+//
+//
+//  Host test, pthread stress test and benchmark for common/ring_buf.h,
+//  built on its GCC atomics (host) path.
+//
+//    - RING_BUF: put / get / unput, bulk write / read, poke / peek at an
+//      offset, write / read spans across the end of the storage, and the
+//      free running indexes wrapping past 2^32
+//    - RING_BUF stress: a producer and a consumer thread move a counting
+//      byte pattern through a small ring a byte, a block and a span at a
+//      time; every byte is checked
+//    - RING_MPSC stress: 4 producer threads and a consumer, each record
+//      checked for its producer's sequence
+//    - ring_atomic_reserve / ring_atomic_inc from 4 threads: no run is
+//      handed out twice, no count is lost
+//    - benchmark: MB/s per SPSC mode against a modulo indexed ring of the
+//      kind the library replaced, MPSC records/s, uncontended put + get
+//
+//  Threads yield when the ring is full / empty, so the stress runs also
+//  make progress on a single CPU, where they interleave by preemption.
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "user_api.h"
+#include "ring_buf.h"
+#include "host_test.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#define  SPSC_BYTES       8000000u
+#define  MPSC_PRODUCERS   4
+#define  MPSC_RECS        500000u
+#define  RESERVE_THREADS  4
+#define  RESERVE_RUNS     200000u
+
+#define  MODE_BYTE        0
+#define  MODE_BULK        1
+#define  MODE_SPAN        2
+
+typedef struct
+   {
+       uint32_t  who;
+       uint32_t  n;
+   } TEST_REC;
+
+RING_BUF_DEFINE (spsc_ring, 1024);
+RING_MPSC_DEFINE (mpsc_ring, TEST_REC, 256);
+
+static int                spsc_mode;
+static volatile uint32_t  spsc_bad;     // first bad byte + 1, 0 = none
+
+            // the modulo indexed ring the drivers used before (one slot unused)
+#define  OLD_RING_SIZE    128
+static volatile int  old_head;
+static volatile int  old_tail;
+static uint8_t       old_buf [OLD_RING_SIZE];
+
+            // ring_atomic_reserve stress
+static volatile uint32_t  res_head;
+static volatile uint32_t  res_tail;
+static volatile uint32_t  res_count;
+static uint8_t            res_claims [RESERVE_THREADS * RESERVE_RUNS * 4];
+
+
+//*****************************************************************************
+//  test_spsc_unit
+//*****************************************************************************
+static void  test_spsc_unit (void)
+{
+    RING_BUF  r;
+    uint8_t   st [8];
+    uint8_t   o [8];
+    uint8_t   c;
+    uint8_t   *p;
+    int       len;
+    int       i;
+
+    CHECK_EQ (ring_buf_init (&r, st, 6), -1);
+    CHECK_EQ (ring_buf_init (&r, st, 1), -1);
+    CHECK_EQ (ring_buf_init (&r, st, 8), 0);
+    CHECK_EQ (ring_buf_size (&r), 8);
+
+    CHECK_EQ (ring_buf_write (&r, "abcdefghij", 10), 8);        // all 8 slots used
+    CHECK_EQ (ring_buf_put (&r, 'x'), 0);
+    CHECK_EQ (ring_buf_space (&r), 0);
+    CHECK_EQ (ring_buf_unput (&r), 1);
+    CHECK_EQ (ring_buf_count (&r), 7);
+    CHECK_EQ (ring_buf_read (&r, o, 5), 5);
+    CHECK (memcmp (o, "abcde", 5) == 0);
+
+       // poke past the head, then publish: wraps the end of the storage
+    CHECK_EQ (ring_buf_poke (&r, 1, "XY", 2), 2);
+    CHECK_EQ (ring_buf_poke (&r, 0, "123456789", 9), 0);      // no room
+    ring_buf_write_commit (&r, 3);
+    CHECK_EQ (ring_buf_count (&r), 5);
+    CHECK_EQ (ring_buf_peek (&r, 3, o, 8), 2);
+    CHECK (o[0] == 'X'  &&  o[1] == 'Y');
+    CHECK_EQ (ring_buf_read (&r, o, 8), 5);
+    CHECK (o[0] == 'f'  &&  o[1] == 'g'  &&  o[3] == 'X'  &&  o[4] == 'Y');
+    CHECK (ring_buf_is_empty (&r));
+    CHECK_EQ (ring_buf_get (&r, &c), 0);
+    CHECK_EQ (ring_buf_unput (&r), 0);
+
+       // spans stop at the end of the storage
+    p = ring_buf_write_span (&r, &len);         // head at 10 -> slot 2
+    CHECK (p == &st[2]  &&  len == 6);
+    memset (p, 'S', len);
+    ring_buf_write_commit (&r, len);
+    p = ring_buf_write_span (&r, &len);
+    CHECK (p == &st[0]  &&  len == 2);
+    p = ring_buf_read_span (&r, &len);
+    CHECK (p == &st[2]  &&  len == 6);
+    ring_buf_read_commit (&r, len);
+    p = ring_buf_read_span (&r, &len);
+    CHECK_EQ (len, 0);
+
+       // free running indexes wrap past 2^32
+    r.head = r.tail = 0xFFFFFFF0;
+    for (i = 0;  i < 64;  i++)
+      { CHECK_EQ (ring_buf_put (&r, (uint8_t) i), 1);
+        CHECK_EQ (ring_buf_count (&r), 1);
+        CHECK (ring_buf_get (&r, &c) == 1  &&  c == (uint8_t) i);
+      }
+    CHECK_EQ (ring_buf_write (&r, "abcdefgh", 8), 8);
+    CHECK (ring_buf_read (&r, o, 8) == 8  &&  memcmp (o, "abcdefgh", 8) == 0);
+
+    ring_buf_reset (&spsc_ring);        // the DEFINEd ring starts out usable
+    CHECK_EQ (ring_buf_size (&spsc_ring), 1024);
+    CHECK_EQ (ring_buf_space (&spsc_ring), 1024);
+}
+
+
+//*****************************************************************************
+//  spsc_producer / spsc_consumer
+//*****************************************************************************
+static void  *spsc_producer (void *arg)
+{
+    uint8_t   blk [61];
+    uint8_t   *p;
+    uint32_t  i;
+    int       n;
+    int       k;
+
+    (void) arg;
+    for (i = 0;  i < SPSC_BYTES;  )
+      { if (spsc_mode == MODE_BYTE)
+           n = ring_buf_put (&spsc_ring, (uint8_t) i);
+           else if (spsc_mode == MODE_BULK)
+                   { n = (SPSC_BYTES - i < sizeof(blk)) ? (int) (SPSC_BYTES - i) : (int) sizeof(blk);
+                     for (k = 0;  k < n;  k++)
+                       blk[k] = (uint8_t) (i + k);
+                     n = ring_buf_write (&spsc_ring, blk, n);
+                   }
+           else { p = ring_buf_write_span (&spsc_ring, &n);
+                  if (n > (int) (SPSC_BYTES - i))
+                     n = SPSC_BYTES - i;
+                  for (k = 0;  k < n;  k++)
+                    p[k] = (uint8_t) (i + k);
+                  ring_buf_write_commit (&spsc_ring, n);
+                }
+        i += n;
+        if (n == 0)
+           sched_yield ();
+      }
+    return (0L);
+}
+
+static void  *spsc_consumer (void *arg)
+{
+    uint8_t   blk [97];
+    uint8_t   *p;
+    uint32_t  i;
+    int       n;
+    int       k;
+
+    (void) arg;
+    for (i = 0;  i < SPSC_BYTES;  )
+      { if (spsc_mode == MODE_BYTE)
+           { n = ring_buf_get (&spsc_ring, blk);
+             p = blk;
+           }
+           else if (spsc_mode == MODE_BULK)
+                   { n = ring_buf_read (&spsc_ring, blk, sizeof(blk));
+                     p = blk;
+                   }
+           else p = ring_buf_read_span (&spsc_ring, &n);
+        for (k = 0;  k < n;  k++)
+          if (p[k] != (uint8_t) (i + k)  &&  spsc_bad == 0)
+             spsc_bad = i + k + 1;
+        if (spsc_mode == MODE_SPAN)
+           ring_buf_read_commit (&spsc_ring, n);
+        i += n;
+        if (n == 0)
+           sched_yield ();
+      }
+    return (0L);
+}
+
+
+//*****************************************************************************
+//  old_producer / old_consumer      modulo indexed ring, for the benchmark
+//*****************************************************************************
+static void  *old_producer (void *arg)
+{
+    uint32_t  i;
+    int       h;
+    int       next;
+
+    (void) arg;
+    for (i = 0;  i < SPSC_BYTES;  )
+      { h    = old_head;
+        next = (h + 1) % (OLD_RING_SIZE - 1);
+        if (next == old_tail)
+           { sched_yield ();
+             continue;
+           }
+        old_buf[h] = (uint8_t) i;
+        __atomic_thread_fence (__ATOMIC_RELEASE);
+        old_head = next;
+        i++;
+      }
+    return (0L);
+}
+
+static void  *old_consumer (void *arg)
+{
+    uint32_t  i;
+    int       t;
+
+    (void) arg;
+    for (i = 0;  i < SPSC_BYTES;  )
+      { t = old_tail;
+        if (t == old_head)
+           { sched_yield ();
+             continue;
+           }
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);
+        if (old_buf[t] != (uint8_t) i  &&  spsc_bad == 0)
+           spsc_bad = i + 1;
+        old_tail = (t + 1) % (OLD_RING_SIZE - 1);
+        i++;
+      }
+    return (0L);
+}
+
+
+static double  run_pair (void *(*prod)(void*), void *(*cons)(void*))
+{
+    pthread_t  a;
+    pthread_t  b;
+    uint64_t   t0;
+
+    t0 = host_nsec ();
+    pthread_create (&a, 0L, prod, 0L);
+    pthread_create (&b, 0L, cons, 0L);
+    pthread_join (a, 0L);
+    pthread_join (b, 0L);
+    return (SPSC_BYTES / ((host_nsec () - t0) / 1e9) / 1e6);     // MB/s
+}
+
+
+//*****************************************************************************
+//  test_spsc_stress
+//*****************************************************************************
+static void  test_spsc_stress (void)
+{
+    static const char  *names [] = { "byte", "bulk", "span" };
+    double  mbs [3];
+    double  old_mbs;
+
+    for (spsc_mode = MODE_BYTE;  spsc_mode <= MODE_SPAN;  spsc_mode++)
+      { ring_buf_reset (&spsc_ring);
+        spsc_bad = 0;
+        mbs[spsc_mode] = run_pair (spsc_producer, spsc_consumer);
+        CHECK_EQ (spsc_bad, 0);
+        CHECK (ring_buf_is_empty (&spsc_ring));
+      }
+    spsc_bad = 0;
+    old_mbs  = run_pair (old_producer, old_consumer);
+    CHECK_EQ (spsc_bad, 0);
+
+    printf ("benchmark: SPSC 2 threads, %u bytes:  %s %.1f MB/s   %s %.1f MB/s   "
+            "%s %.1f MB/s   old modulo ring (byte) %.1f MB/s\n",
+            SPSC_BYTES, names[0], mbs[0], names[1], mbs[1], names[2], mbs[2], old_mbs);
+}
+
+
+//*****************************************************************************
+//  test_mpsc_stress
+//*****************************************************************************
+static void  *mpsc_producer (void *arg)
+{
+    TEST_REC  rec;
+    uint32_t  i;
+
+    rec.who = (uint32_t) (uintptr_t) arg;
+    for (i = 0;  i < MPSC_RECS;  )
+      { rec.n = i;
+        if (ring_mpsc_push (&mpsc_ring, &rec))
+           i++;
+           else sched_yield ();
+      }
+    return (0L);
+}
+
+static void  test_mpsc_stress (void)
+{
+    pthread_t  th [MPSC_PRODUCERS];
+    uint32_t   next [MPSC_PRODUCERS];
+    TEST_REC   rec;
+    TEST_REC   probe;
+    uint32_t   got;
+    uint32_t   bad;
+    uint64_t   t0;
+    double     secs;
+    int        i;
+
+    CHECK_EQ (RING_MPSC_INIT (mpsc_ring), 0);
+    CHECK_EQ (ring_mpsc_pop (&mpsc_ring, &rec), 0);
+
+       // single thread: fills to exactly slots, then refuses
+    probe.who = probe.n = 7;
+    for (i = 0;  i < 256;  i++)
+      CHECK_EQ (ring_mpsc_push (&mpsc_ring, &probe), 1);
+    CHECK_EQ (ring_mpsc_push (&mpsc_ring, &probe), 0);
+    CHECK_EQ (ring_mpsc_count (&mpsc_ring), 256);
+    while (ring_mpsc_pop (&mpsc_ring, &rec))
+      ;
+    CHECK_EQ (ring_mpsc_count (&mpsc_ring), 0);
+
+    memset (next, 0, sizeof(next));
+    bad = 0;
+    t0  = host_nsec ();
+    for (i = 0;  i < MPSC_PRODUCERS;  i++)
+      pthread_create (&th[i], 0L, mpsc_producer, (void*) (uintptr_t) i);
+    for (got = 0;  got < MPSC_PRODUCERS * MPSC_RECS;  )
+      { if ( ! ring_mpsc_pop (&mpsc_ring, &rec))
+           { sched_yield ();
+             continue;
+           }
+        if (rec.who >= MPSC_PRODUCERS  ||  rec.n != next[rec.who])
+           { bad++;
+             if (rec.who >= MPSC_PRODUCERS)
+                break;
+           }
+        next[rec.who] = rec.n + 1;
+        got++;
+      }
+    for (i = 0;  i < MPSC_PRODUCERS;  i++)
+      pthread_join (th[i], 0L);
+    secs = (host_nsec () - t0) / 1e9;
+    CHECK_EQ (bad, 0);
+    for (i = 0;  i < MPSC_PRODUCERS;  i++)
+      CHECK_EQ (next[i], MPSC_RECS);
+    printf ("           MPSC %d producers: %.1f M records/s, each producer's records in order\n",
+            MPSC_PRODUCERS, got / secs / 1e6);
+}
+
+
+//*****************************************************************************
+//  test_reserve_stress
+//
+//          Threads claim 1..4 unit runs of a ring the size of all claims, so
+//          it never fills, and count each unit they were handed. A run
+//          handed out twice shows up as a unit counted twice.
+//*****************************************************************************
+static void  *reserve_worker (void *arg)
+{
+    uint32_t  start;
+    uint32_t  i;
+    uint32_t  k;
+    uint32_t  n;
+
+    (void) arg;
+    for (i = 0;  i < RESERVE_RUNS;  i++)
+      { n = 1 + (i % 4);
+        start = ring_atomic_reserve (&res_head, &res_tail, sizeof(res_claims), n);
+        if (start == RING_RESERVE_FULL)
+           continue;
+        for (k = 0;  k < n;  k++)
+          __atomic_fetch_add (&res_claims[start + k], 1, __ATOMIC_RELAXED);
+        ring_atomic_inc (&res_count);
+      }
+    return (0L);
+}
+
+static void  test_reserve_stress (void)
+{
+    pthread_t  th [RESERVE_THREADS];
+    uint32_t   units;
+    uint32_t   multi;
+    uint32_t   i;
+
+    res_head = res_tail = res_count = 0;
+    memset (res_claims, 0, sizeof(res_claims));
+    for (i = 0;  i < RESERVE_THREADS;  i++)
+      pthread_create (&th[i], 0L, reserve_worker, (void*) (uintptr_t) i);
+    for (i = 0;  i < RESERVE_THREADS;  i++)
+      pthread_join (th[i], 0L);
+
+    CHECK_EQ (res_count, RESERVE_THREADS * RESERVE_RUNS);
+    units = RESERVE_THREADS * (RESERVE_RUNS / 4) * (1 + 2 + 3 + 4);
+    CHECK_EQ (res_head, units);
+    for (multi = 0, i = 0;  i < units;  i++)
+      if (res_claims[i] != 1)
+         multi++;                       // unclaimed, or handed out twice
+    CHECK_EQ (multi, 0);
+
+       // a claim bigger than the free room is refused, head unchanged
+    res_tail = 0;
+    CHECK_EQ (ring_atomic_reserve (&res_head, &res_tail, units, 1), RING_RESERVE_FULL);
+    CHECK_EQ (res_head, units);
+}
+
+
+//*****************************************************************************
+//  bench_uncontended
+//*****************************************************************************
+static void  bench_uncontended (void)
+{
+    volatile int  old_h = 0;
+    volatile int  old_t = 0;
+    uint64_t  t0,  t1,  t2;
+    uint32_t  sum;
+    uint32_t  expect;
+    uint8_t   c;
+    long      k;
+    const long  N = 20000000;
+
+    ring_buf_reset (&spsc_ring);
+    sum = expect = 0;
+    c = 0;
+    t0  = host_nsec ();
+    for (k = 0;  k < N;  k++)
+      { ring_buf_put (&spsc_ring, (uint8_t) k);
+        ring_buf_get (&spsc_ring, &c);
+        sum    += c;
+        expect += (uint8_t) k;
+      }
+    t1 = host_nsec ();
+    for (k = 0;  k < N;  k++)
+      { old_buf[old_h] = (uint8_t) k;
+        old_h = (old_h + 1) % (OLD_RING_SIZE - 1);
+        c = old_buf[old_t];
+        old_t = (old_t + 1) % (OLD_RING_SIZE - 1);
+        sum += c;
+      }
+    t2 = host_nsec ();
+    CHECK_EQ (sum, 2 * expect);
+    printf ("           uncontended put + get: %.1f ns   old modulo ring %.1f ns\n",
+            (double) (t1 - t0) / N, (double) (t2 - t1) / N);
+}
+
+
+int  main (void)
+{
+    test_spsc_unit ();
+    test_spsc_stress ();
+    test_mpsc_stress ();
+    test_reserve_stress ();
+    bench_uncontended ();
+    return (host_test_done ("test_ring_buf"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,461 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_spi_bus.c
+//
+//
+//  Host test for common/spi_bus.c, with several simulated slaves sharing
+//  one simulated SPI controller.
+//
+//  The slaves: a register file (mode 0, 20 MHz; first byte is the address,
+//  bit 7 = write), an echo + 1 device (mode 3, 5 MHz), a counter (mode 1,
+//  1 MHz), and a device with an active high CS that uses the register
+//  file's settings. Every byte checks that exactly one CS is asserted and
+//  that the bus is set to that slave's mode and clock.
+//
+//  The controller completes segments either later from an "ISR" (as with
+//  DMA), or synchronously from inside ops->start().
+//
+//  Built with HOST_CORTEX_M=4, so the PRIMASK critical sections are live:
+//  the bus ops must never be called with interrupts masked, and every call
+//  must leave them as it found them.
+//
+//    - write then read back through a multi segment transaction
+//    - priority order, same priority FIFO, resubmit from the callback
+//    - busy and cancel, empty segments, parameter checks
+//    - start / configure failures end the transaction and release CS
+//    - SPI reconfigured only when the mode or clock changes
+//    - benchmark: submit + complete cost, and reconfigs for mixed traffic
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "spi_bus.h"
+#include "host_test.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define  NUM_SLAVES    4
+#define  DEV_REGS      0                // CS pin # = slave #
+#define  DEV_ECHO      1
+#define  DEV_COUNT     2
+#define  DEV_HI_CS     3
+
+static SPI_BUS   bus;
+static int       cs_level [NUM_SLAVES];
+static int       cur_mode;
+static uint32_t  cur_clk;
+static int       sync_mode;             // 1 = segments complete inside start()
+static int       pending;               // async segment waiting for the "ISR"
+static const uint8_t  *p_tx;
+static uint8_t        *p_rx;
+static uint16_t       p_len;
+static int       fail_start;
+static int       fail_config;
+static long      ops_masked;            // bus ops called with PRIMASK set
+static long      bad_bytes;             // byte with wrong CS / mode / clock
+
+static uint8_t   regs [128];
+static int       reg_ptr;
+static int       reg_wr;
+static uint8_t   count_val;
+
+static int       order [64];
+static int       num_order;
+static int       resubmits;
+
+
+static int  cs_asserted (int s)
+{
+    return (s == DEV_HI_CS) ? cs_level[s] == 1 : cs_level[s] == 0;
+}
+
+static int  num_selected (void)
+{
+    int  n;
+    int  s;
+
+    for (n = 0, s = 0;  s < NUM_SLAVES;  s++)
+      if (cs_asserted (s))
+         n++;
+    return (n);
+}
+
+static uint8_t  slave_byte (uint8_t in)
+{
+    uint8_t  out;
+    int      sel;
+    int      s;
+
+    for (sel = -1, s = 0;  s < NUM_SLAVES;  s++)
+      if (cs_asserted (s))
+         sel = s;
+    if (num_selected () != 1)
+       { bad_bytes++;
+         return (0xFF);
+       }
+    out = 0;
+    switch (sel)
+      {
+        case DEV_REGS:
+        case DEV_HI_CS:
+            if (cur_mode != 0  ||  cur_clk != 20000000)
+               bad_bytes++;
+            if (reg_ptr < 0)
+               { reg_wr  = in & 0x80;
+                 reg_ptr = in & 0x7F;
+               }
+              else
+               { if (reg_wr)
+                    regs[reg_ptr] = in;
+                    else out = regs[reg_ptr];
+                 reg_ptr = (reg_ptr + 1) & 0x7F;
+               }
+            break;
+        case DEV_ECHO:
+            if (cur_mode != 3  ||  cur_clk != 5000000)
+               bad_bytes++;
+            out = (uint8_t) (in + 1);
+            break;
+        default:
+            if (cur_mode != 1  ||  cur_clk != 1000000)
+               bad_bytes++;
+            out = count_val++;
+            break;
+      }
+    return (out);
+}
+
+static void  run_segment (void)
+{
+    uint16_t  i;
+    uint8_t   out;
+
+    for (i = 0;  i < p_len;  i++)
+      { out = slave_byte (p_tx ? p_tx[i] : (p_rx ? p_rx[i] : 0xFF));
+        if (p_rx)
+           p_rx[i] = out;
+      }
+}
+
+static int  op_configure (void *hw, int mode, uint32_t clock_hz)
+{
+    (void) hw;
+    if (host_primask)
+       ops_masked++;
+    if (num_selected () != 0)
+       bad_bytes++;                     // reconfigured with a CS asserted
+    if (fail_config)
+       { fail_config = 0;
+         return (-1);
+       }
+    cur_mode = mode;
+    cur_clk  = clock_hz;
+    return (0);
+}
+
+static int  op_start (void *hw, const uint8_t *tx, uint8_t *rx, uint16_t length)
+{
+    (void) hw;
+    if (host_primask)
+       ops_masked++;
+    CHECK (pending == 0);
+    if (fail_start)
+       { fail_start = 0;
+         return (-1);
+       }
+    p_tx  = tx;
+    p_rx  = rx;
+    p_len = length;
+    if (sync_mode)
+       { run_segment ();
+         spibus_segment_done (&bus, 0);
+       }
+      else pending = 1;
+    return (0);
+}
+
+static void  op_set_cs (void *hw, int cs_pin, int level)
+{
+    (void) hw;
+    if (host_primask)
+       ops_masked++;
+    cs_level[cs_pin] = level;
+    if ((cs_pin == DEV_REGS || cs_pin == DEV_HI_CS)  &&  cs_asserted (cs_pin))
+       reg_ptr = -1;                    // new command
+}
+
+static const SPI_BUS_OPS  sim_ops = { op_configure, op_start, op_set_cs };
+
+static void  sim_isr (void)             // SPI / DMA complete interrupt
+{
+    while (pending)
+      { pending = 0;
+        host_primask = 1;               // as on entry to an ISR, masked
+        host_primask = 0;               //   ... then the board's ISR runs
+        run_segment ();
+        spibus_segment_done (&bus, 0);
+      }
+}
+
+static void  xfer_done (SPI_BUS_XFER *xfer, int status)
+{
+    (void) status;
+    order[num_order++] = (int) (intptr_t) xfer->cb_parm;
+    if ((intptr_t) xfer->cb_parm == 99  &&  resubmits < 3)
+       { resubmits++;
+         CHECK_EQ (spibus_submit (xfer->dev, xfer), 0);
+       }
+}
+
+static void  bus_setup (SPI_BUS_DEV *dev)
+{
+    int  s;
+
+    for (s = 0;  s < NUM_SLAVES;  s++)
+      cs_level[s] = (s == DEV_HI_CS) ? 0 : 1;
+    cur_mode = -1;
+    cur_clk  = 0;
+    pending  = num_order = resubmits = 0;
+    spibus_init (&bus, &sim_ops, 0L);
+    CHECK_EQ (spibus_add_device (&bus, &dev[DEV_REGS], 0, 20000000, DEV_REGS, 1, 0), 0);
+    CHECK_EQ (spibus_add_device (&bus, &dev[DEV_ECHO], 3, 5000000, DEV_ECHO, 5, 0), 0);
+    CHECK_EQ (spibus_add_device (&bus, &dev[DEV_COUNT], 1, 1000000, DEV_COUNT, 1, 0), 0);
+    CHECK_EQ (spibus_add_device (&bus, &dev[DEV_HI_CS], 0, 20000000, DEV_HI_CS, 1,
+                                 SPIBUS_CS_ACTIVE_HIGH), 0);
+    CHECK_EQ (num_selected (), 0);
+}
+
+
+//*****************************************************************************
+//  test_transactions
+//*****************************************************************************
+static void  test_transactions (int sync)
+{
+    static const int  expect [] = { 1, 99, 99, 99, 99, 2, 4 };
+    SPI_BUS_DEV   dev [NUM_SLAVES];
+    SPI_BUS_XFER  xw,  xr,  xe,  xc,  xlow;
+    uint8_t       wcmd [5] = { 0x80 | 0x10, 1, 2, 3, 4 };
+    uint8_t       rcmd [1] = { 0x10 };
+    uint8_t       rbuf [4];
+    uint8_t       etx [3] = { 10, 20, 30 };
+    uint8_t       erx [3];
+    uint8_t       cbuf [2];
+    SPI_BUS_SEG   ws [1] = { { wcmd, 0L, 5 } };
+    SPI_BUS_SEG   rs [3] = { { rcmd, 0L, 1 }, { 0L, 0L, 0 }, { 0L, rbuf, 4 } };
+    SPI_BUS_SEG   es [2] = { { etx, erx, 3 }, { 0L, 0L, 0 } };
+    SPI_BUS_SEG   cs [1] = { { 0L, cbuf, 2 } };
+    int           i;
+
+    sync_mode = sync;
+    bus_setup (dev);
+    spibus_xfer_init (&xw, ws, 1, xfer_done, (void*) 1);
+    spibus_xfer_init (&xr, rs, 3, xfer_done, (void*) 2);
+    spibus_xfer_init (&xe, es, 2, xfer_done, (void*) 99);
+    spibus_xfer_init (&xc, cs, 1, xfer_done, (void*) 4);
+    spibus_xfer_init (&xlow, cs, 1, xfer_done, (void*) 5);
+
+    CHECK_EQ (spibus_submit (&dev[DEV_REGS], &xw), 0);    // starts at once
+    CHECK_EQ (spibus_submit (&dev[DEV_REGS], &xr), 0);
+    CHECK_EQ (spibus_submit (&dev[DEV_COUNT], &xc), 0);
+    CHECK_EQ (spibus_submit (&dev[DEV_COUNT], &xlow), 0);
+    CHECK_EQ (spibus_submit (&dev[DEV_ECHO], &xe), 0);    // high prio jumps the queue
+    if ( ! sync)
+       { CHECK_EQ (spibus_submit (&dev[DEV_ECHO], &xe), ERR_SPIBUS_XFER_BUSY);
+         CHECK_EQ (bus.queue_depth, 4);
+         CHECK_EQ (spibus_cancel (&xw), ERR_SPIBUS_XFER_BUSY);   // on the wire
+         CHECK_EQ (spibus_cancel (&xlow), 0);
+         CHECK_EQ (xlow.status, ERR_SPIBUS_CANCELLED);
+         CHECK (spibus_is_done (&xlow));
+         CHECK_EQ (spibus_cancel (&xlow), 0);                    // harmless twice
+       }
+    sim_isr ();
+
+    CHECK_EQ (xr.status, 0);
+    CHECK (rbuf[0] == 1  &&  rbuf[1] == 2  &&  rbuf[2] == 3  &&  rbuf[3] == 4);
+    CHECK (erx[0] == 11  &&  erx[1] == 21  &&  erx[2] == 31);
+    CHECK (spibus_is_done (&xw)  &&  spibus_is_done (&xr)  &&  spibus_is_done (&xe)
+           &&  spibus_is_done (&xc));
+    CHECK_EQ (num_selected (), 0);
+    CHECK (bus.active == 0L  &&  bus.queue == 0L);
+    CHECK_EQ (bus.queue_depth, 0);
+    CHECK_EQ (resubmits, 3);
+    if ( ! sync)
+       { CHECK_EQ (num_order, 7);
+         for (i = 0;  i < 7;  i++)
+           CHECK_EQ (order[i], expect[i]);
+         CHECK_EQ (bus.max_queue_depth, 4);
+       }
+      else CHECK_EQ (num_order, 8);     // nothing queues: xlow runs too
+
+       // active high CS device shares the register file's settings
+    wcmd[0] = 0x20;                     // read 4 bytes at 0x20
+    memset (rbuf, 0xEE, sizeof(rbuf));
+    regs[0x20] = 0x5A;
+    rs[0].tx = wcmd;
+    spibus_xfer_init (&xr, rs, 3, 0L, 0L);
+    i = (int) bus.reconfigs;
+    CHECK_EQ (spibus_submit (&dev[DEV_REGS], &xr), 0);
+    sim_isr ();
+    spibus_xfer_init (&xr, rs, 3, 0L, 0L);
+    CHECK_EQ (spibus_submit (&dev[DEV_HI_CS], &xr), 0);
+    sim_isr ();
+    CHECK_EQ (rbuf[0], 0x5A);
+    CHECK_EQ (cs_level[DEV_HI_CS], 0);                    // released low
+    CHECK ((int) bus.reconfigs - i <= 1);                 // at most to get to mode 0
+
+    CHECK_EQ (bad_bytes, 0);
+    CHECK_EQ (ops_masked, 0);
+    CHECK_EQ (host_primask, 0);
+}
+
+
+//*****************************************************************************
+//  test_errors
+//*****************************************************************************
+static void  test_errors (void)
+{
+    SPI_BUS_DEV   dev [NUM_SLAVES];
+    SPI_BUS_XFER  x;
+    SPI_BUS_XFER  y;
+    uint8_t       buf [4];
+    SPI_BUS_SEG   two [2] = { { 0L, buf, 2 }, { 0L, buf + 2, 2 } };
+    SPI_BUS_SEG   none [2] = { { 0L, 0L, 0 }, { 0L, 0L, 0 } };
+
+    sync_mode = 0;
+    bus_setup (dev);
+
+       // start fails on the second segment: ended, CS released, counted
+    spibus_xfer_init (&x, two, 2, xfer_done, (void*) 7);
+    CHECK_EQ (spibus_submit (&dev[DEV_COUNT], &x), 0);
+    fail_start = 1;
+    sim_isr ();
+    CHECK_EQ (x.status, ERR_SPIBUS_XFER_FAILED);
+    CHECK_EQ (num_selected (), 0);
+    CHECK_EQ (dev[DEV_COUNT].errors, 1);
+    CHECK_EQ (bus.errors, 1);
+    CHECK_EQ (spibus_submit (&dev[DEV_COUNT], &x), 0);  // can be resubmitted
+    sim_isr ();
+    CHECK_EQ (x.status, 0);
+
+       // the board reports a failed segment
+    CHECK_EQ (spibus_submit (&dev[DEV_COUNT], &x), 0);
+    pending = 0;
+    spibus_segment_done (&bus, -5);
+    CHECK_EQ (x.status, ERR_SPIBUS_XFER_FAILED);
+    CHECK_EQ (num_selected (), 0);
+
+       // configure fails: CS never asserted, next transaction still runs
+    spibus_xfer_init (&x, two, 2, 0L, 0L);
+    spibus_xfer_init (&y, two, 2, 0L, 0L);
+    fail_config = 1;
+    CHECK_EQ (spibus_submit (&dev[DEV_ECHO], &x), 0);
+    CHECK_EQ (x.status, ERR_SPIBUS_XFER_FAILED);
+    memset (buf, 0, sizeof(buf));
+    CHECK_EQ (spibus_submit (&dev[DEV_ECHO], &y), 0);
+    sim_isr ();
+    CHECK_EQ (y.status, 0);
+    CHECK_EQ (buf[0], 1);               // echo + 1 of the preset rx byte
+
+       // all segments empty: done at once, no bus traffic
+    spibus_xfer_init (&x, none, 2, 0L, 0L);
+    CHECK_EQ (spibus_submit (&dev[DEV_REGS], &x), 0);
+    CHECK (spibus_is_done (&x));
+    CHECK_EQ (x.status, 0);
+    CHECK_EQ (pending, 0);
+
+       // parameter checks
+    spibus_xfer_init (&x, two, 0, 0L, 0L);
+    CHECK_EQ (spibus_submit (&dev[DEV_REGS], &x), ERR_SPIBUS_INVALID_PARM);
+    CHECK_EQ (spibus_submit (0L, &x), ERR_SPIBUS_INVALID_PARM);
+    CHECK_EQ (spibus_add_device (&bus, &dev[0], 4, 1000, 0, 1, 0), ERR_SPIBUS_INVALID_PARM);
+    CHECK_EQ (spibus_add_device (&bus, &dev[0], 0, 0, 0, 1, 0), ERR_SPIBUS_INVALID_PARM);
+    CHECK_EQ (spibus_add_device (&bus, &dev[0], 0, 1000, 0, 256, 0), ERR_SPIBUS_INVALID_PARM);
+    CHECK_EQ (spibus_cancel (0L), ERR_SPIBUS_INVALID_PARM);
+
+    CHECK_EQ (bad_bytes, 0);
+    CHECK_EQ (ops_masked, 0);
+    CHECK_EQ (host_primask, 0);
+}
+
+
+//*****************************************************************************
+//  bench
+//
+//          Cost of the bus layer per transaction, with a controller that
+//          completes synchronously (includes the simulated slave). Then
+//          reconfigs for 3 devices with different settings, submitted in
+//          bursts: the queue groups by priority, not by settings.
+//*****************************************************************************
+static void  bench (void)
+{
+    SPI_BUS_DEV   dev [NUM_SLAVES];
+    SPI_BUS_XFER  x [3];
+    uint8_t       t [4] = { 1, 2, 3, 4 };
+    uint8_t       r [3][4];
+    SPI_BUS_SEG   s [3][1] = { { { t, r[0], 4 } }, { { t, r[1], 4 } },
+                               { { t, r[2], 4 } } };
+    uint64_t      t0;
+    double        ns;
+    long          k;
+    int           d;
+
+    sync_mode = 1;
+    bus_setup (dev);
+    spibus_xfer_init (&x[0], s[0], 1, 0L, 0L);
+    t0 = host_nsec ();
+    for (k = 0;  k < 1000000;  k++)
+      spibus_submit (&dev[DEV_ECHO], &x[0]);
+    ns = (host_nsec () - t0) / 1e6;
+    printf ("benchmark: %.1f ns per submit + complete (sync controller, 4 bytes)\n", ns);
+    CHECK_EQ (dev[DEV_ECHO].xfers, 1000000);
+    CHECK_EQ (bus.reconfigs, 1);
+
+    sync_mode = 0;
+    bus_setup (dev);
+    for (k = 0;  k < 1000;  k++)
+      { for (d = 0;  d < 3;  d++)
+          { spibus_xfer_init (&x[d], s[d], 1, 0L, 0L);
+            spibus_submit (&dev[d], &x[d]);
+          }
+        sim_isr ();
+      }
+    printf ("           3 devices x 1000 rounds: %u transactions, %u SPI reconfigs\n",
+            (unsigned) bus.xfers, (unsigned) bus.reconfigs);
+    CHECK_EQ (bus.xfers, 3000);
+    CHECK_EQ (bad_bytes, 0);
+}
+
+
+int  main (void)
+{
+    test_transactions (0);
+    test_transactions (1);
+    test_errors ();
+    bench ();
+    return (host_test_done ("test_spi_bus"));
+}
+
+//*****************************************************************************
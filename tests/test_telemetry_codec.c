@@ -0,0 +1,356 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_telemetry_codec.c
+//
+//
+//  Host test and benchmark for common/telemetry_codec.c.
+//
+//    - encode a record to CBOR and JSON, compare with known bytes / text
+//      (CBOR decimal fractions per RFC 8949 tag 4), decode it back
+//    - every buffer size short of the payload gives ERR_TCODEC_OVERFLOW
+//      and never writes past the buffer
+//    - JSON decode: unknown keys and nested values skipped, null leaves a
+//      field alone, range / type / syntax errors, truncated payloads
+//    - fixed point decimals are rounded to the field's scale
+//    - random and mutated payloads: no crash, no read past the end
+//    - benchmark: encode / decode ns per record, against sprintf and a
+//      strncpy + strtok parser of the kind the codec replaced
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "telemetry_codec.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct
+   {
+       int16_t     temp;
+       uint16_t    hum;
+       uint32_t    count;
+       int32_t     press;
+       uint8_t     on;
+       TCODEC_STR  id;
+   } ENV_REC;
+
+static const TCODEC_FIELD  env_fields [] =
+   { TCODEC_FIELD_NAMED ("t", ENV_REC, temp,  TCODEC_T_FIXED16, 1),
+     TCODEC_FIELD_NAMED ("h", ENV_REC, hum,   TCODEC_T_UINT16,  0),
+     TCODEC_FIELD       (ENV_REC, count,      TCODEC_T_UINT32,  0),
+     TCODEC_FIELD_NAMED ("p", ENV_REC, press, TCODEC_T_FIXED32, 2),
+     TCODEC_FIELD       (ENV_REC, on,         TCODEC_T_BOOL,    0),
+     TCODEC_FIELD       (ENV_REC, id,         TCODEC_T_STR,     0) };
+
+typedef struct
+   {
+       uint8_t  r,  g,  b;
+   } RGB_CMD;
+
+static const TCODEC_FIELD  rgb_fields [] =
+   { TCODEC_FIELD (RGB_CMD, r, TCODEC_T_UINT8, 0),
+     TCODEC_FIELD (RGB_CMD, g, TCODEC_T_UINT8, 0),
+     TCODEC_FIELD (RGB_CMD, b, TCODEC_T_UINT8, 0) };
+
+static const ENV_REC  env_sample = { -234, 41, 17, 101325, 1, { "node\"1", 6 } };
+
+            // {"t": 4([-1, -234]), "h": 41, "count": 17, "p": 4([-2, 101325]),
+            //  "on": true, "id": "node\"1"}
+static const uint8_t  env_cbor [] =
+   { 0xA6, 0x61, 't', 0xC4, 0x82, 0x20, 0x38, 0xE9,
+           0x61, 'h', 0x18, 0x29,
+           0x65, 'c', 'o', 'u', 'n', 't', 0x11,
+           0x61, 'p', 0xC4, 0x82, 0x21, 0x1A, 0x00, 0x01, 0x8B, 0xCD,
+           0x62, 'o', 'n', 0xF5,
+           0x62, 'i', 'd', 0x66, 'n', 'o', 'd', 'e', '"', '1' };
+
+static const char  env_json [] =
+    "{\"t\":-23.4,\"h\":41,\"count\":17,\"p\":1013.25,\"on\":true,\"id\":\"node\\\"1\"}";
+
+
+static int  encode_env (uint8_t *buf, int size, int format, const ENV_REC *rec)
+{
+    TCODEC_ENC  enc;
+
+    tcodec_enc_init (&enc, buf, size, format);
+    tcodec_enc_record (&enc, env_fields, TCODEC_NUM_FIELDS(env_fields), rec);
+    return (tcodec_enc_finish (&enc));
+}
+
+
+//*****************************************************************************
+//  test_record_round_trip
+//*****************************************************************************
+static void  test_record_round_trip (void)
+{
+    uint8_t   buf [128];
+    ENV_REC   rec;
+    uint32_t  mask;
+    int       n;
+    int       k;
+    int       format;
+
+    n = encode_env (buf, sizeof(buf), TCODEC_CBOR, &env_sample);
+    CHECK_EQ (n, (int) sizeof(env_cbor));
+    CHECK (memcmp (buf, env_cbor, sizeof(env_cbor)) == 0);
+
+    n = encode_env (buf, sizeof(buf), TCODEC_JSON, &env_sample);
+    CHECK_EQ (n, (int) strlen (env_json));
+    CHECK (memcmp (buf, env_json, n) == 0);
+
+    for (format = TCODEC_CBOR;  format <= TCODEC_JSON;  format++)
+      { n = encode_env (buf, sizeof(buf), format, &env_sample);
+        memset (&rec, 0, sizeof(rec));
+        CHECK_EQ (tcodec_dec_record (buf, n, TCODEC_AUTO, env_fields,
+                                     TCODEC_NUM_FIELDS(env_fields), &rec, &mask), 6);
+        CHECK_EQ (mask, 0x3F);
+        CHECK_EQ (rec.temp, -234);
+        CHECK_EQ (rec.hum, 41);
+        CHECK_EQ (rec.count, 17);
+        CHECK_EQ (rec.press, 101325);
+        CHECK_EQ (rec.on, 1);
+        CHECK (rec.id.ptr >= (const char*) buf  &&  rec.id.ptr < (const char*) buf + n);
+        if (format == TCODEC_CBOR)          // JSON strings are returned raw
+           CHECK (rec.id.len == 6  &&  memcmp (rec.id.ptr, "node\"1", 6) == 0);
+           else CHECK (rec.id.len == 7  &&  memcmp (rec.id.ptr, "node\\\"1", 7) == 0);
+
+           // too small a buffer: overflow, and nothing written past it
+        for (k = 1;  k < n;  k++)
+          { memset (buf, 0xEE, sizeof(buf));
+            CHECK_EQ (encode_env (buf, k, format, &env_sample), ERR_TCODEC_OVERFLOW);
+            CHECK_EQ (buf[k], 0xEE);
+          }
+      }
+
+       // extremes survive the round trip
+    rec = env_sample;
+    rec.temp  = -32768;
+    rec.count = 0xFFFFFFFF;
+    rec.press = -2147483647 - 1;
+    for (format = TCODEC_CBOR;  format <= TCODEC_JSON;  format++)
+      { ENV_REC  out;
+
+        n = encode_env (buf, sizeof(buf), format, &rec);
+        CHECK (n > 0);
+        memset (&out, 0, sizeof(out));
+        CHECK_EQ (tcodec_dec_record (buf, n, format, env_fields,
+                                     TCODEC_NUM_FIELDS(env_fields), &out, 0L), 6);
+        CHECK_EQ (out.temp, -32768);
+        CHECK_EQ (out.count, 0xFFFFFFFF);
+        CHECK_EQ (out.press, -2147483647 - 1);
+      }
+}
+
+
+//*****************************************************************************
+//  test_json_decode
+//*****************************************************************************
+static void  test_json_decode (void)
+{
+    static const struct { const char *json;  int rc;  uint32_t mask;  int r, g, b; }  cases [] =
+       { { "{\"r\":255, \"g\" : 0,\"x\":{\"a\":[1,2,{\"q\":\"}\"}]},\"b\":12.0}",
+                                        3,                      7, 255,  0, 12 },
+         { "{}",                        0,                      0,   9,  9,  9 },
+         { " \r\n{\"b\":true}",         ERR_TCODEC_TYPE,        0,   9,  9,  9 },
+         { "{\"r\":256}",               ERR_TCODEC_RANGE,       0,   9,  9,  9 },
+         { "{\"r\":-1}",                ERR_TCODEC_RANGE,       0,   9,  9,  9 },
+         { "{\"r\":1.5}",               ERR_TCODEC_TYPE,        0,   9,  9,  9 },
+         { "{\"r\":\"a\"}",             ERR_TCODEC_TYPE,        0,   9,  9,  9 },
+         { "{\"r\":1e3}",               ERR_TCODEC_UNSUPPORTED, 0,   9,  9,  9 },
+         { "{\"r\":null,\"g\":3}",      1,                      2,   9,  3,  9 },
+         { "{\"r\":1,}",                ERR_TCODEC_SYNTAX,      1,   1,  9,  9 },
+         { "{\"r\":1",                  ERR_TCODEC_SYNTAX,      1,   1,  9,  9 },
+         { "{\"x\":[1,2",               ERR_TCODEC_SYNTAX,      0,   9,  9,  9 },
+         { "{\"x\":\"abc",              ERR_TCODEC_SYNTAX,      0,   9,  9,  9 } };
+    RGB_CMD   c;
+    ENV_REC   rec;
+    uint32_t  mask;
+    unsigned  i;
+    const char  *s;
+
+    for (i = 0;  i < sizeof(cases) / sizeof(cases[0]);  i++)
+      { c.r = c.g = c.b = 9;
+        CHECK_EQ (tcodec_dec_record (cases[i].json, strlen (cases[i].json), TCODEC_AUTO,
+                                     rgb_fields, 3, &c, &mask), cases[i].rc);
+        CHECK_EQ (mask, cases[i].mask);
+        CHECK (c.r == cases[i].r  &&  c.g == cases[i].g  &&  c.b == cases[i].b);
+      }
+
+       // decimals rounded to the field's scale
+    s = "{\"t\":-0.05,\"p\":12.345}";
+    CHECK_EQ (tcodec_dec_record (s, strlen (s), TCODEC_JSON, env_fields,
+                                 TCODEC_NUM_FIELDS(env_fields), &rec, 0L), 2);
+    CHECK_EQ (rec.temp, -1);
+    CHECK_EQ (rec.press, 1235);
+
+       // parameter checks
+    CHECK_EQ (tcodec_dec_record (s, 0, TCODEC_JSON, env_fields, 6, &rec, 0L),
+              ERR_TCODEC_INVALID_PARM);
+    CHECK_EQ (tcodec_dec_record (s, strlen (s), 7, env_fields, 6, &rec, 0L),
+              ERR_TCODEC_INVALID_PARM);
+}
+
+
+//*****************************************************************************
+//  test_fuzz
+//
+//          Random bytes, and random bytes behind a JSON / CBOR map start: the
+//          decoder must return a count or an ERR_TCODEC_xxx code, without
+//          crashing or hanging. Each payload sits at the end of a malloc'd
+//          block of exactly its length, so an address sanitizer build also
+//          catches any read past the end.
+//*****************************************************************************
+static void  test_fuzz (void)
+{
+    uint8_t   *fb;
+    uint8_t   good [128];
+    RGB_CMD   c;
+    uint32_t  mask;
+    long      it;
+    int       len;
+    int       n;
+    int       i;
+    int       rc;
+    int       bad_rc;
+
+    srand (1);
+    bad_rc = 0;
+    for (it = 0;  it < 1000000;  it++)
+      { len = rand () % 64 + 1;
+        fb  = (uint8_t*) malloc (len);
+        for (i = 0;  i < len;  i++)
+          fb[i] = (uint8_t) rand ();
+        if (it & 1)
+           fb[0] = (it & 2) ? '{' : 0xA3;
+        rc = tcodec_dec_record (fb, len, TCODEC_AUTO, rgb_fields, 3, &c, &mask);
+        free (fb);
+        if (rc > 3  ||  (rc < 0  &&  (rc < ERR_TCODEC_INVALID_PARM  ||  rc > ERR_TCODEC_OVERFLOW)))
+           bad_rc++;
+      }
+    CHECK_EQ (bad_rc, 0);
+
+       // every truncation of a valid payload is an error, never a success
+    for (i = TCODEC_CBOR;  i <= TCODEC_JSON;  i++)
+      { n = encode_env (good, sizeof(good), i, &env_sample);
+        for (len = 1;  len < n;  len++)
+          { ENV_REC  rec;
+
+            CHECK (tcodec_dec_record (good, len, i, env_fields, 6, &rec, 0L) < 0);
+          }
+      }
+}
+
+
+//*****************************************************************************
+//  bench
+//*****************************************************************************
+static void  bench (void)
+{
+    static const char  cmd [] = "{\"r\":200,\"g\":100,\"b\":50}";
+    TCODEC_ENC  enc;
+    ENV_REC     v;
+    RGB_CMD     c;
+    RGB_CMD     cc = { 200, 100, 50 };
+    uint8_t     buf [128];
+    uint8_t     cbor [32];
+    char        sb [128];
+    char        db [64];
+    char        *tk;
+    uint64_t    t0,  t1,  t2,  t3;
+    volatile int  sink;
+    int         r,  g,  b;
+    int         n;
+    long        i;
+    const long  N = 1000000;
+
+    v = env_sample;
+    sink = 0;
+    t0 = host_nsec ();
+    for (i = 0;  i < N;  i++)
+      { v.count = (uint32_t) i;
+        sink += encode_env (buf, sizeof(buf), TCODEC_JSON, &v);
+      }
+    t1 = host_nsec ();
+    for (i = 0;  i < N;  i++)
+      { v.count = (uint32_t) i;
+        sink += encode_env (buf, sizeof(buf), TCODEC_CBOR, &v);
+      }
+    t2 = host_nsec ();
+    for (i = 0;  i < N;  i++)
+      { v.count = (uint32_t) i;
+        sink += sprintf (sb, "{\"t\":%d.%d,\"h\":%u,\"count\":%u,\"p\":%ld.%02ld,"
+                             "\"on\":%s,\"id\":\"%.*s\"}",
+                         v.temp / 10, abs (v.temp % 10), v.hum, (unsigned) v.count,
+                         (long) v.press / 100, (long) v.press % 100,
+                         v.on ? "true" : "false", v.id.len, v.id.ptr);
+      }
+    t3 = host_nsec ();
+    printf ("benchmark: encode  JSON %.0f ns   CBOR %.0f ns   sprintf %.0f ns  per record\n",
+            (double) (t1 - t0) / N, (double) (t2 - t1) / N, (double) (t3 - t2) / N);
+
+    tcodec_enc_init (&enc, cbor, sizeof(cbor), TCODEC_CBOR);
+    tcodec_enc_record (&enc, rgb_fields, 3, &cc);
+    n = tcodec_enc_finish (&enc);
+    t0 = host_nsec ();
+    for (i = 0;  i < N;  i++)
+      sink += tcodec_dec_record (cmd, sizeof(cmd) - 1, TCODEC_AUTO, rgb_fields, 3, &c, 0L);
+    t1 = host_nsec ();
+    for (i = 0;  i < N;  i++)
+      sink += tcodec_dec_record (cbor, n, TCODEC_AUTO, rgb_fields, 3, &c, 0L);
+    t2 = host_nsec ();
+    for (i = 0;  i < N;  i++)
+      { strncpy (db, cmd, sizeof(db));
+        r = g = b = 0;
+        for (tk = strtok (db, "{\":,}");  tk != 0L;  tk = strtok (0L, "{\":,}"))
+          { if (strcmp (tk, "r") == 0)
+               r = strtol (strtok (0L, "{\":,}"), 0L, 10);
+               else if (strcmp (tk, "g") == 0)
+                       g = strtol (strtok (0L, "{\":,}"), 0L, 10);
+               else if (strcmp (tk, "b") == 0)
+                       b = strtol (strtok (0L, "{\":,}"), 0L, 10);
+          }
+        sink += r + g + b;
+      }
+    t3 = host_nsec ();
+    printf ("           decode  JSON %.0f ns   CBOR %.0f ns (%d bytes vs %d)   "
+            "strncpy + strtok %.0f ns\n",
+            (double) (t1 - t0) / N, (double) (t2 - t1) / N, n, (int) sizeof(cmd) - 1,
+            (double) (t3 - t2) / N);
+    CHECK (c.r == 200  &&  c.g == 100  &&  c.b == 50);
+    (void) sink;
+}
+
+
+int  main (void)
+{
+    test_record_round_trip ();
+    test_json_decode ();
+    test_fuzz ();
+    bench ();
+    return (host_test_done ("test_telemetry_codec"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,341 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_timestamp.c
+//
+//
+//  Host test for common/timestamp.c
+//
+//    - 64-bit extension of a 32-bit counter (DWT CYCCNT model, 216 MHz) is
+//      exact and monotonic across many 2^32 wraps, with tstamp_tick() run
+//      from a 1 ms "SysTick", including readers that sample half_periods
+//      just before the counter crosses a half (tick not yet run)
+//    - tick -> usec conversion accuracy over long runs
+//    - discipline: a 100 ppm fast crystal is slewed onto the reference,
+//      monotonic usec never goes backwards across rate changes, reference
+//      steps only re-baseline (and move wall clock time)
+//    - tstamp_advance(): time the counter missed (CYCCNT stopped in STOP
+//      mode) is added without a step back, and the rate is kept
+//    - parameter checks
+//    - benchmark: host nsec per extend + convert
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "timestamp.h"
+#include "host_test.h"
+#include <stdlib.h>
+
+#define  CPU_HZ          216000000UL
+#define  TICKS_PER_MS    (CPU_HZ / 1000)
+
+
+//*****************************************************************************
+//  test_extend
+//
+//          Run a simulated 64-bit "true" counter, of which the 32-bit raw
+//          value is all the hardware shows. SysTick calls tstamp_tick()
+//          every ms; readers in between must get the true 64-bit value.
+//*****************************************************************************
+static void  test_extend (void)
+{
+    TSTAMP_CLOCK  clk;
+    uint64_t      truth;
+    uint64_t      prev;
+    uint64_t      ext;
+    uint32_t      half;
+    int           ms;
+    int           step;
+    int           bad;
+    int           backwards;
+
+    truth = 0xFFFF0000ULL;                     // start just below a wrap
+    CHECK_EQ (tstamp_init (&clk, CPU_HZ, (uint32_t) truth), 0);
+    CHECK_EQ (clk.half_periods, 1);
+
+    bad = 0;  backwards = 0;  prev = 0;
+       // 5 minutes of ms ticks at 216 MHz: ~15 wraps of the 32-bit counter
+    for (ms = 0;  ms < 5 * 60 * 1000;  ms++)
+      { for (step = 0;  step < 4;  step++)
+          { truth += TICKS_PER_MS / 4;
+            half = clk.half_periods;           // reader: half_periods first
+            ext  = tstamp_extend (half, (uint32_t) truth);
+            if (ext != truth)
+               bad++;
+            if (ext < prev)
+               backwards++;
+            prev = ext;
+          }
+        tstamp_tick (&clk, (uint32_t) truth);  // SysTick
+      }
+    CHECK (truth > (15ULL << 32));
+    CHECK_EQ (bad, 0);
+    CHECK_EQ (backwards, 0);
+
+       // reader preempted: half_periods sampled just before each half
+       // boundary, the counter read just after it, before SysTick ran
+    CHECK_EQ (tstamp_init (&clk, CPU_HZ, 0), 0);
+    truth = 0;
+    bad = 0;
+    for (step = 0;  step < 40;  step++)
+      { truth += 0x80000000ULL - 10;           // just below the next half
+        tstamp_tick (&clk, (uint32_t) truth);
+        half = clk.half_periods;
+        truth += 20;                           // crosses it, no tick yet
+        if (tstamp_extend (half, (uint32_t) truth) != truth)
+           bad++;
+        tstamp_tick (&clk, (uint32_t) truth);
+        truth -= 10;
+      }
+    CHECK_EQ (bad, 0);
+    CHECK_EQ (clk.half_periods, 40);
+}
+
+
+//*****************************************************************************
+//  test_convert
+//*****************************************************************************
+static void  test_convert (void)
+{
+    TSTAMP_CLOCK  clk;
+    uint64_t      usec;
+    uint64_t      ticks;
+    int64_t       err;
+
+    CHECK_EQ (tstamp_init (&clk, CPU_HZ, 1000), 0);
+    CHECK_EQ (tstamp_ticks_to_usec (&clk, 1000), 0);
+    CHECK_EQ (tstamp_ticks_to_usec (&clk, 1000 + 216), 0);    // < 1 usec
+    CHECK_EQ (tstamp_ticks_to_usec (&clk, 1000 + 2160), 9);   // truncates
+    usec = tstamp_ticks_to_usec (&clk, 1000 + CPU_HZ);        // 1 sec
+    CHECK (usec >= 999999 && usec <= 1000000);
+
+       // Q32 rate: < 0.1 ppm error, so 10 days is within 0.1 sec
+    ticks = 10ULL * 86400 * CPU_HZ;
+    usec  = tstamp_ticks_to_usec (&clk, 1000 + ticks);
+    err   = (int64_t) (10ULL * 86400 * 1000000) - (int64_t) usec;
+    CHECK (err >= 0 && err < 86400);
+
+       // a reader that took its ticks just before the base (preempted by
+       // a rebase) still gets a slightly earlier time
+    CHECK_EQ (tstamp_discipline (&clk, 1000 + ticks, 5000000), TSTAMP_DISCIPLINE_BASELINE);
+    CHECK (tstamp_ticks_to_usec (&clk, 1000 + ticks - CPU_HZ) < usec);
+    CHECK (usec - tstamp_ticks_to_usec (&clk, 1000 + ticks - CPU_HZ) <= 1000000);
+}
+
+
+//*****************************************************************************
+//  test_discipline
+//
+//          The crystal runs 100 ppm fast: the counter makes CPU_HZ * 1.0001
+//          ticks per real second. The reference is exact (e.g. SNTP), so
+//          the rate should settle on 1/1.0001 = -99990 ppb.
+//*****************************************************************************
+static void  test_discipline (void)
+{
+    TSTAMP_CLOCK  clk;
+    uint64_t      ticks;
+    uint64_t      real_usec;
+    uint64_t      mono;
+    uint64_t      prev_mono;
+    uint64_t      wall;
+    uint64_t      mono_before;
+    int64_t       err_start;
+    int64_t       err_end;
+    int           rc;
+    int           i;
+    int           backwards;
+
+    CHECK_EQ (tstamp_init (&clk, CPU_HZ, 0), 0);
+
+#define  TICKS_AT(usec)   (((uint64_t) (usec) * (CPU_HZ / 1000000) * 10001) / 10000)
+#define  RTC_REF(usec)    (usec)
+
+    real_usec = 3600ULL * 1000000;                      // RTC says 01:00:00
+    rc = tstamp_discipline (&clk, TICKS_AT(real_usec), RTC_REF(real_usec));
+    CHECK_EQ (rc, TSTAMP_DISCIPLINE_BASELINE);
+    CHECK_EQ (clk.rebaselines, 1);
+    rc = tstamp_discipline (&clk, TICKS_AT(real_usec + 500000),
+                            RTC_REF(real_usec + 500000));
+    CHECK_EQ (rc, TSTAMP_DISCIPLINE_TOO_SOON);
+
+    err_start = 0;
+    prev_mono = 0;  backwards = 0;
+    for (i = 1;  i <= 60;  i++)
+      { real_usec += 10000000;                          // every 10 secs
+        ticks = TICKS_AT(real_usec);
+        mono  = tstamp_ticks_to_usec (&clk, ticks);
+        if (mono < prev_mono)
+           backwards++;
+        rc = tstamp_discipline (&clk, ticks, RTC_REF(real_usec));
+        if (rc != TSTAMP_DISCIPLINE_SLEWED)
+           break;
+        if (tstamp_ticks_to_usec (&clk, ticks) < mono)  // publish never steps back
+           backwards++;
+        prev_mono = mono;
+        if (i == 1)
+           err_start = (int64_t) (clk.conv[clk.conv_gen & 1].usec_per_tick_q32)
+                     - (int64_t) clk.nominal_q32;
+      }
+    CHECK_EQ (i, 61);
+    CHECK_EQ (backwards, 0);
+    CHECK_EQ (clk.disciplines, 60);
+    CHECK (err_start < 0);                              // slowed down
+
+       // converged on -99990 ppb, to within the 1 usec / 10 sec (100 ppb)
+       // resolution of the error measurement
+    CHECK (clk.rate_adj_ppb > -99990 - 200 && clk.rate_adj_ppb < -99990 + 200);
+
+       // over the next 10 secs, monotonic time now tracks real time
+    ticks = TICKS_AT(real_usec);
+    mono  = tstamp_ticks_to_usec (&clk, TICKS_AT(real_usec + 10000000));
+    err_end = (int64_t) (mono - tstamp_ticks_to_usec (&clk, ticks)) - 10000000;
+    CHECK (err_end > -5 && err_end < 5);                // was +1000 usec
+
+       // wall time is in the reference's epoch
+    wall = tstamp_get_wall_usec (&clk, ticks);
+    CHECK ((int64_t) (wall - real_usec) > -5000 && (int64_t) (wall - real_usec) < 5000);
+
+       // reference steps (RTC set to midnight): rate and monotonic time
+       // are left alone, wall time follows the reference
+    mono_before = tstamp_ticks_to_usec (&clk, ticks);
+    rc = tstamp_discipline (&clk, ticks, 0);
+    CHECK_EQ (rc, TSTAMP_DISCIPLINE_BASELINE);
+    CHECK_EQ (clk.rebaselines, 2);
+    CHECK (clk.rate_adj_ppb > -99990 - 200 && clk.rate_adj_ppb < -99990 + 200);
+    CHECK_EQ (tstamp_ticks_to_usec (&clk, ticks), mono_before);
+    CHECK_EQ (tstamp_get_wall_usec (&clk, ticks), 0);
+
+       // a wildly wrong reference interval (> 10 %) also re-baselines
+    rc = tstamp_discipline (&clk, TICKS_AT(real_usec + 10000000), 20000000);
+    CHECK_EQ (rc, TSTAMP_DISCIPLINE_BASELINE);
+
+       // slew is clamped to TSTAMP_MAX_SLEW_PPM, however bad the crystal
+    CHECK_EQ (tstamp_init (&clk, CPU_HZ, 0), 0);
+    for (i = 0;  i < 40;  i++)
+      tstamp_discipline (&clk, (uint64_t) i * 10 * CPU_HZ * 102 / 100,
+                         (uint64_t) i * 10000000);
+    CHECK (clk.rate_adj_ppb >= -(TSTAMP_MAX_SLEW_PPM * 1000L));
+    CHECK_EQ (clk.rate_adj_ppb, -(TSTAMP_MAX_SLEW_PPM * 1000L));
+
+#undef   TICKS_AT
+#undef   RTC_REF
+}
+
+
+//*****************************************************************************
+//  test_advance
+//
+//          CYCCNT stops for 2.5 secs of STOP mode, then carries on from where
+//          it stopped. Monotonic and wall time must include the 2.5 secs.
+//*****************************************************************************
+static void  test_advance (void)
+{
+    TSTAMP_CLOCK  clk;
+    uint64_t      ticks;
+    uint64_t      before;
+    uint64_t      wall_before;
+    uint64_t      delta;
+    uint32_t      rate;
+
+    CHECK_EQ (tstamp_init (&clk, CPU_HZ, 0), 0);
+    ticks = 3ULL * CPU_HZ;
+    CHECK_EQ (tstamp_discipline (&clk, ticks, 1000000000ULL), TSTAMP_DISCIPLINE_BASELINE);
+    rate = clk.conv[clk.conv_gen & 1].usec_per_tick_q32;
+
+    ticks += CPU_HZ;                            // 1 sec later, enter STOP
+    before      = tstamp_ticks_to_usec (&clk, ticks);
+    wall_before = tstamp_get_wall_usec (&clk, ticks);
+    tstamp_advance (&clk, ticks, 2500000);     // woke 2.5 secs later
+    CHECK_EQ (tstamp_ticks_to_usec (&clk, ticks), before + 2500000);
+    CHECK_EQ (tstamp_get_wall_usec (&clk, ticks), wall_before + 2500000);
+    CHECK (tstamp_get_wall_usec (&clk, ticks) - (1000000000ULL + 3500000) + 1 <= 1);  // -1/+0 usec (Q32)
+    CHECK_EQ (clk.conv[clk.conv_gen & 1].usec_per_tick_q32, rate);
+
+       // time after the wakeup carries on at the same rate
+    delta = tstamp_ticks_to_usec (&clk, ticks + CPU_HZ) - tstamp_ticks_to_usec (&clk, ticks);
+    CHECK (delta >= 999999 && delta <= 1000000);
+
+       // the next discipline sees no error: the reference also moved on
+       // by the STOP time
+    CHECK_EQ (tstamp_discipline (&clk, ticks + 10ULL * CPU_HZ, 1000000000ULL + 13500000),
+              TSTAMP_DISCIPLINE_SLEWED);
+    CHECK (clk.rate_adj_ppb > -200 && clk.rate_adj_ppb < 200);
+}
+
+
+//*****************************************************************************
+//  test_bad_parms
+//*****************************************************************************
+static void  test_bad_parms (void)
+{
+    TSTAMP_CLOCK  clk;
+
+    CHECK_EQ (tstamp_init (0L, CPU_HZ, 0), ERR_TIMESTAMP_INVALID_PARM);
+    CHECK_EQ (tstamp_init (&clk, 1000000, 0), ERR_TIMESTAMP_INVALID_PARM);
+    CHECK_EQ (tstamp_init (&clk, 1000001, 0), 0);
+}
+
+
+//*****************************************************************************
+//  bench
+//*****************************************************************************
+static void  bench (void)
+{
+    TSTAMP_CLOCK  clk;
+    uint64_t      t0;
+    uint64_t      t1;
+    uint64_t      sink;
+    uint32_t      raw;
+    int           i;
+
+    tstamp_init (&clk, CPU_HZ, 0);
+    sink = 0;
+    raw  = 0;
+    t0 = host_nsec();
+    for (i = 0;  i < 10000000;  i++)
+      { raw += 12345;
+        sink += tstamp_ticks_to_usec (&clk, tstamp_extend (clk.half_periods, raw));
+        if ((i & 1023) == 0)
+           tstamp_tick (&clk, raw);
+      }
+    t1 = host_nsec();
+    printf ("benchmark: extend + ticks_to_usec  %.1f host nsec\n",
+            (double) (t1 - t0) / 10000000.0);
+    (void) sink;
+}
+
+
+int  main (void)
+{
+    test_extend ();
+    test_convert ();
+    test_discipline ();
+    test_advance ();
+    test_bad_parms ();
+    bench ();
+    return (host_test_done ("test_timestamp"));
+}
+
+//*****************************************************************************
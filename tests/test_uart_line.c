@@ -0,0 +1,285 @@
+//*******1*********2*********3*********4*********5*********6*********7**********
+//
+//                              tests/test_uart_line.c
+//
+//
+//  Host test and benchmark for common/uart_line.c, the thread level text
+//  line assembly behind the STM32 UART read calls.
+//
+//    - the RX ring is filled a few bytes at a time, as the RX ISR would,
+//      and the line carried on over several assemble calls
+//    - a \r\n pair split across calls (and across lines): the \n is
+//      dropped, a lone \r or \n still ends a line
+//    - backspace and DEL, including at the start of a line
+//    - a null line (just \r or \n) is handed up as "\n"
+//    - a line longer than the buffer is cut at max_length - 1, flagged
+//      truncated, and the rest starts the next line
+//    - every char is echoed, in order, including the ones dropped
+//    - benchmark: assemble time per char, for 80 char lines
+//
+//  History:
+//    10/19/26 - Created.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//*****************************************************************************
+
+#include "uart_line.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <string.h>
+
+RING_BUF_DEFINE (rx_ring, 64);
+
+static UART_LINE  ln;
+static uint8_t    echo_buf [256];
+static int        echo_len;
+
+
+static void  echo_char (void *echo_parm, uint8_t out_char)
+{
+    (void) echo_parm;
+    if (echo_len < (int) sizeof(echo_buf))
+       echo_buf [echo_len++] = out_char;
+}
+
+            // queue chars, as the RX ISR would
+static void  rx (const char *chars)
+{
+    while (*chars)
+      CHECK (ring_buf_put (&rx_ring, (uint8_t) *chars++));
+}
+
+            // queue chars, then assemble what is there
+static int  rx_assemble (const char *chars)
+{
+    rx (chars);
+    return (uart_line_assemble (&ln, &rx_ring, echo_char, 0L));
+}
+
+
+//*****************************************************************************
+//  test_split_crlf
+//*****************************************************************************
+static void  test_split_crlf (void)
+{
+    uint8_t  line [32];
+
+    ring_buf_reset (&rx_ring);
+    uart_line_reset (&ln);
+    echo_len = 0;
+
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("AT+C"), 0);          // partial: kept in ln
+    CHECK (ln.buf == line  &&  ln.len == 4);
+    CHECK (strcmp ((char*) line, "AT+C") == 0);
+    CHECK_EQ (rx_assemble ("WJAP?"), 0);
+    CHECK_EQ (rx_assemble ("\r"), 1);            // the \r ends it
+    CHECK (strcmp ((char*) line, "AT+CWJAP?") == 0);
+    CHECK (ln.buf == 0L  &&  ln.truncated == 0);
+
+       // the \n of the pair arrives after the line was handed up
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("\n"), 0);            // dropped, not a null line
+    CHECK_EQ (ln.len, 0);
+    CHECK_EQ (rx_assemble ("OK\r\nnext"), 1);
+    CHECK (strcmp ((char*) line, "OK") == 0);
+    CHECK_EQ (ring_buf_count (&rx_ring), 5);     // \n + "next" still queued
+
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("\n"), 1);            // a lone \n ends it
+    CHECK (strcmp ((char*) line, "next") == 0);
+
+       // \n\r is two line ends: a \r after a \n is not dropped
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("x\n\r"), 1);
+    CHECK (strcmp ((char*) line, "x") == 0);
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble (""), 1);
+    CHECK (strcmp ((char*) line, "\n") == 0);
+
+       // a flush drops the \r\n state too
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("y\r"), 1);
+    ring_buf_reset (&rx_ring);
+    uart_line_reset (&ln);
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("\n"), 1);
+    CHECK (strcmp ((char*) line, "\n") == 0);
+
+       // everything was echoed, dropped \n's included
+    CHECK_EQ (echo_len, 26);
+    CHECK (memcmp (echo_buf, "AT+CWJAP?\r\nOK\r\nnext\nx\n\ry\r\n", 26) == 0);
+}
+
+
+//*****************************************************************************
+//  test_backspace
+//*****************************************************************************
+static void  test_backspace (void)
+{
+    uint8_t  line [32];
+
+    ring_buf_reset (&rx_ring);
+    uart_line_reset (&ln);
+
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("\b\x7F" "abd"), 0);  // at the start: ignored
+    CHECK_EQ (rx_assemble ("\b"), 0);
+    CHECK (strcmp ((char*) line, "ab") == 0);
+    CHECK_EQ (rx_assemble ("c\x7F\x7F\x7F\x7F" "xy\r"), 1);
+    CHECK (strcmp ((char*) line, "xy") == 0);
+
+       // erased back to empty: the line end makes it a null line
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("q\b\n"), 1);
+    CHECK (strcmp ((char*) line, "\n") == 0);
+
+       // a backspace between \r and \n: the \n is no longer a pair
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("a\r"), 1);
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble ("\b\n"), 1);
+    CHECK (strcmp ((char*) line, "\n") == 0);
+}
+
+
+//*****************************************************************************
+//  test_null_line
+//*****************************************************************************
+static void  test_null_line (void)
+{
+    uint8_t  line [8];
+    int      i;
+
+    ring_buf_reset (&rx_ring);
+    uart_line_reset (&ln);
+
+    for (i = 0;  i < 3;  i++)
+      { uart_line_begin (&ln, line, sizeof(line));
+        CHECK_EQ (rx_assemble (i == 0 ? "\r\n\r\n\n" : ""), 1);
+        CHECK (strcmp ((char*) line, "\n") == 0);
+        CHECK_EQ (ln.len, 1);
+      }
+    CHECK (ring_buf_is_empty (&rx_ring));
+
+       // nothing queued: not complete, the line stays empty
+    uart_line_begin (&ln, line, sizeof(line));
+    CHECK_EQ (rx_assemble (""), 0);
+    CHECK (line[0] == '\0'  &&  ln.buf == line);
+}
+
+
+//*****************************************************************************
+//  test_truncation
+//*****************************************************************************
+static void  test_truncation (void)
+{
+    uint8_t  line [8];
+    uint8_t  big [0x10000 + 2];
+
+    ring_buf_reset (&rx_ring);
+    uart_line_reset (&ln);
+    memset (line, 0x55, sizeof(line));
+
+    uart_line_begin (&ln, line, 6);               // room for 5 chars + \0
+    CHECK_EQ (rx_assemble ("1234"), 0);
+    CHECK_EQ (ln.truncated, 0);
+    CHECK_EQ (rx_assemble ("56789\r"), 1);
+    CHECK (strcmp ((char*) line, "12345") == 0);
+    CHECK_EQ (ln.truncated, 1);
+    CHECK_EQ (line[6], 0x55);                     // nothing past the buffer
+    CHECK_EQ (ring_buf_count (&rx_ring), 5);      // "6789\r" starts the next
+
+    uart_line_begin (&ln, line, 6);               // begin clears the flag
+    CHECK_EQ (ln.truncated, 0);
+    CHECK_EQ (uart_line_assemble (&ln, &rx_ring, 0L, 0L), 1);
+    CHECK (strcmp ((char*) line, "6789") == 0);
+    CHECK_EQ (ln.truncated, 0);
+
+       // exactly fills: the line end is not needed, and not consumed
+    uart_line_begin (&ln, line, 6);
+    CHECK_EQ (rx_assemble ("abcde\r"), 1);
+    CHECK (strcmp ((char*) line, "abcde") == 0  &&  ln.truncated == 1);
+    uart_line_begin (&ln, line, 6);
+    CHECK_EQ (rx_assemble (""), 1);               // the left over \r
+    CHECK (strcmp ((char*) line, "\n") == 0);
+
+       // smallest buffer: one char per line
+    uart_line_begin (&ln, line, 2);
+    CHECK_EQ (rx_assemble ("zz"), 1);
+    CHECK (strcmp ((char*) line, "z") == 0  &&  ln.truncated == 1);
+    ring_buf_reset (&rx_ring);
+
+       // sizes over 64K are clamped to the 16 bit length
+    uart_line_begin (&ln, big, sizeof(big));
+    CHECK_EQ (ln.max_length, 0xFFFF);
+}
+
+
+//*****************************************************************************
+//  bench
+//*****************************************************************************
+static void  bench (void)
+{
+    static const char  text [] =
+        "+IPD,0,72:GET /sensors/temp HTTP/1.1 Host: 192.168.1.20 Accept: */*\r\n";
+    uint8_t   line [128];
+    uint64_t  t0;
+    uint64_t  t1;
+    long      chars;
+    int       lines;
+    int       i;
+
+    ring_buf_reset (&rx_ring);
+    uart_line_reset (&ln);
+    lines = 200000;
+    chars = 0;
+    t0 = host_nsec ();
+    for (i = 0;  i < lines;  i++)
+      { uart_line_begin (&ln, line, sizeof(line));
+        ring_buf_write (&rx_ring, (const uint8_t*) text, 40);
+        uart_line_assemble (&ln, &rx_ring, 0L, 0L);
+        ring_buf_write (&rx_ring, (const uint8_t*) text + 40, sizeof(text) - 41);
+        if (uart_line_assemble (&ln, &rx_ring, 0L, 0L) != 1)
+           break;
+        chars += sizeof(text) - 1;
+      }
+    t1 = host_nsec ();
+    CHECK_EQ (i, lines);
+    CHECK (strlen ((char*) line) == sizeof(text) - 3);
+    printf ("benchmark: line assembly  %.2f ns/char  (%d lines of %d chars)\n",
+            (double) (t1 - t0) / chars, lines, (int) sizeof(text) - 1);
+}
+
+
+int  main (void)
+{
+    test_split_crlf ();
+    test_backspace ();
+    test_null_line ();
+    test_truncation ();
+    bench ();
+    return (host_test_done ("test_uart_line"));
+}
+
+//*****************************************************************************
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+#*******1*********2*********3*********4*********5*********6*********7**********
+#
+#                              binlog_decode.py
+#
+#
+#  Host side decoder for the Binary Log  (common/binlog.c).
+#
+#  The MCU only sends the address of each BLOG() format string, a timestamp,
+#  and the raw 32-bit arguments. This tool reads the format strings back out
+#  of the firmware's .elf file, and does the printf formatting on the host.
+#
+#  Usage:
+#      binlog_decode.py  firmware.elf  [capture_file | /dev/ttyACMx]
+#
+#  With no capture file, the binary log is read from stdin. For a live
+#  serial port, set the baud rate first, e.g.
+#      stty -F /dev/ttyACM0 115200 raw -echo
+#
+#  The .elf MUST be the exact image that is running on the board, or the
+#  format string addresses will not line up.
+#
+#  History:
+#    10/19/26 - Created.
+#
+# The MIT License (MIT)
+#
+# Copyright (c) 2014-2015 Wayne Duquaine / Grandview Systems
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#*****************************************************************************
+
+import re
+import struct
+import sys
+
+BINLOG_SYNC      = 0xA5          # must match common/binlog.h
+BINLOG_MAX_ARGS  = 6
+BINLOG_HDR_WORDS = 3
+BINLOG_TS_USEC   = 0x01
+
+SHF_ALLOC        = 0x2
+SHT_PROGBITS     = 1
+
+FMT_SPEC = re.compile(r'%([-+ #0]*)(\d+|\*)?(\.\d+)?(hh|h|ll|l|z|j|t|L)?([diouxXcsfFeEgGp%])')
+
+
+#*****************************************************************************
+#  ElfImage
+#
+#          Minimal ELF reader: just enough to find the bytes that live at
+#          a given target address (in .rodata, .text, ...).
+#*****************************************************************************
+class ElfImage:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[0:4] != b'\x7fELF' or self.data[4] not in (1, 2):
+            raise ValueError('%s is not an ELF file' % path)
+        self.endian = '<' if self.data[5] == 1 else '>'
+        e = self.endian
+        if self.data[4] == 1:           # ELF32 (MCU images)
+            shoff, = struct.unpack_from(e + 'I', self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(e + 'HH', self.data, 0x2E)
+            shdr = e + 'IIIIII'
+        else:                           # ELF64 (host builds of portable code)
+            shoff, = struct.unpack_from(e + 'Q', self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(e + 'HH', self.data, 0x3A)
+            shdr = e + 'IIQQQQ'
+        self.sections = []              # (addr, size, file_offset)
+        for i in range(shnum):
+            (name, stype, flags, addr, offset,
+             size) = struct.unpack_from(shdr, self.data, shoff + i * shentsize)
+            if stype == SHT_PROGBITS and (flags & SHF_ALLOC) and size > 0:
+                self.sections.append((addr, size, offset))
+
+    def read_string(self, addr):
+        for (base, size, offset) in self.sections:
+            if base <= addr < base + size:
+                start = offset + (addr - base)
+                end = self.data.find(b'\0', start, offset + size)
+                if end < 0:
+                    return None
+                return self.data[start:end].decode('latin-1')
+        return None
+
+
+#*****************************************************************************
+#  render
+#
+#          Apply a C printf format string to the raw 32-bit args.
+#*****************************************************************************
+def render(elf, fmt, args):
+    out = []
+    pos = 0
+    argi = 0
+    for m in FMT_SPEC.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, _, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        if argi >= len(args):
+            out.append('<missing>')
+            continue
+        raw = args[argi]
+        argi += 1
+        spec = '%' + flags + (width or '') + (prec or '')
+        if conv in 'di':
+            val = raw - (1 << 32) if raw & 0x80000000 else raw
+            out.append((spec + 'd') % val)
+        elif conv in 'ouxX':
+            out.append((spec + ('d' if conv == 'u' else conv)) % raw)
+        elif conv == 'c':
+            out.append((spec + 'c') % chr(raw & 0xFF))
+        elif conv in 'fFeEgG':
+            val, = struct.unpack('<f', struct.pack('<I', raw))
+            out.append((spec + conv) % val)
+        elif conv == 's':
+            s = elf.read_string(raw)
+            out.append((spec + 's') % (s if s is not None else '<ptr 0x%08x>' % raw))
+        else:
+            out.append('0x%08x' % raw)
+    out.append(fmt[pos:])
+    return ''.join(out)
+
+
+#*****************************************************************************
+#  decode
+#
+#          Walk the byte stream, re-syncing on the header byte if any bytes
+#          were lost, and print each record.
+#*****************************************************************************
+def decode(elf, stream, outf):
+    buf = b''
+    next_seq = None
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            break
+        buf += chunk
+        while len(buf) >= BINLOG_HDR_WORDS * 4:
+            hdr, fmt_addr, tstamp = struct.unpack_from('<III', buf, 0)
+            nargs = (hdr >> 8) & 0x07
+            hflags = (hdr >> 11) & 0x1F
+            fmt = elf.read_string(fmt_addr) if fmt_addr != 0 else ''
+            if (hdr & 0xFF) != BINLOG_SYNC or nargs > BINLOG_MAX_ARGS or fmt is None:
+                buf = buf[1:]           # not a record: slide forward 1 byte
+                continue
+            rec_len = (BINLOG_HDR_WORDS + nargs) * 4
+            if len(buf) < rec_len:
+                break                   # wait for rest of record
+            args = list(struct.unpack_from('<%dI' % nargs, buf, BINLOG_HDR_WORDS * 4))
+            buf = buf[rec_len:]
+
+            seq = hdr >> 16
+            if next_seq is not None and seq != next_seq:
+                outf.write('<lost %d words>\n' % ((seq - next_seq) & 0xFFFF))
+            next_seq = (seq + BINLOG_HDR_WORDS + nargs) & 0xFFFF
+
+            if hflags & BINLOG_TS_USEC:
+                stamp = '[%10.6f] ' % (tstamp / 1000000.0)
+            else:
+                stamp = '[%10.3f] ' % (tstamp / 1000.0)
+            if fmt_addr == 0:
+                text = '<%d log records dropped>\n' % (args[0] if args else 0)
+            else:
+                text = render(elf, fmt, args)
+            outf.write(stamp + text.rstrip('\r\n') + '\n')
+            outf.flush()
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write('usage: binlog_decode.py firmware.elf [capture | serial_device]\n')
+        return 1
+    elf = ElfImage(argv[1])
+    if len(argv) > 2:
+        with open(argv[2], 'rb', buffering=0) as stream:
+            decode(elf, stream, sys.stdout)
+    else:
+        decode(elf, sys.stdin.buffer, sys.stdout)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))